@@ -0,0 +1,240 @@
+#!/usr/bin/env python3
+
+"""Generate synthetic JSON traces of configurable size and shape for the
+generated monitor systems.
+
+Usage: gen_traces.py <system> [name=value ...] [-o <file>]
+
+Systems and their parameters (defaults in parentheses):
+
+auction      items (10000)    number of auctions
+             bids (10)        bids per item
+             open (100)       auctions running at the same time
+             eod (500)        events between endOfDay broadcasts
+             period (30)      auction length in days
+             sold (0.8)       fraction of items that are sold
+candidate    voters (10000)   number of voters
+             candidates (20)  number of candidates
+             parties (5)      number of parties
+             rank (0.9)       chance a voter ranks a candidate of their party
+enum         vectors (2000)   number of vectors
+             open (100)       vectors in use at the same time
+             enums (5)        enumerations per vector
+             visits (10)      elements visited per enumeration
+             modify (0.05)    chance the vector is modified during a visit
+mapiterator  maps (400)       number of maps
+             colls (5)        collections per map
+             iters (5)        iterators per collection
+             traversals (10)  traversals per iterator
+             update (0.02)    chance the map is updated between traversals
+
+Every system also takes seed (1). The trace goes to stdout unless -o is given.
+"""
+
+import random
+import sys
+
+DEFAULTS = {
+    'auction': {'items': 10000, 'bids': 10, 'open': 100, 'eod': 500,
+        'period': 30, 'sold': 0.8},
+    'candidate': {'voters': 10000, 'candidates': 20, 'parties': 5,
+        'rank': 0.9},
+    'enum': {'vectors': 2000, 'open': 100, 'enums': 5, 'visits': 10,
+        'modify': 0.05},
+    'mapiterator': {'maps': 400, 'colls': 5, 'iters': 5, 'traversals': 10,
+        'update': 0.02},
+}
+
+# Parameters that set the size of a workload, scaled by run_bench.py
+SIZE_PARAMS = {
+    'auction': ['items'],
+    'candidate': ['voters'],
+    'enum': ['vectors'],
+    'mapiterator': ['maps'],
+}
+
+
+class TraceWriter:
+    """Write events in the format read by the generated file adapters"""
+
+    def __init__(self, out):
+        self.out = out
+        self.count = 0
+
+    def event(self, channel, name, params):
+        self.count += 1
+        self.out.write('{"fmt_version": [2, 0], "channel": "%s", '
+                '"event": "%s", "params": [%s], "aux": {"line": %d}}\n' %
+                (channel, name, ', '.join(params), self.count))
+
+
+def key(i):
+    """Spread sequential numbers over the positive ints (bijective mod 2^31)"""
+    return (i * 2654435761) % (1 << 31)
+
+
+def pointer(i):
+    """A distinct, 16-byte aligned pointer value as a hex string"""
+    return '"%x"' % (0x10000 + i * 16)
+
+
+def gen_auction(w, rng, items, bids, open, eod, period, sold):
+    """Auctions open on a rolling window. Each receives increasing bids and is
+    then sold or left to expire, with endOfDay broadcast to all of them at a
+    fixed rate."""
+    next_item = 0
+    active = []
+    since_eod = 0
+    while next_item < items or active:
+        while len(active) < open and next_item < items:
+            item = key(next_item)
+            minimum = rng.randint(10, 1000)
+            w.event('ch1', 'create_auction',
+                    [str(item), str(minimum), str(period)])
+            active.append([item, bids, minimum // 2])
+            next_item += 1
+        i = rng.randrange(len(active))
+        a = active[i]
+        if a[1] > 0:
+            a[2] += rng.randint(1, 100)
+            w.event('ch2', 'bid', [str(a[0]), str(a[2])])
+            a[1] -= 1
+        else:
+            if rng.random() < sold:
+                w.event('ch3', 'sold', [str(a[0])])
+            active[i] = active[-1]
+            active.pop()
+        since_eod += 1
+        if since_eod >= eod:
+            w.event('ch4', 'endOfDay', [])
+            since_eod = 0
+
+
+def gen_candidate(w, rng, voters, candidates, parties, rank):
+    """Every voter joins a party and every candidate stands for one. Voters
+    then rank the candidates of their party in random order, and the election
+    ends."""
+    voter_party = [rng.randrange(parties) for _ in range(voters)]
+    cand_party = [rng.randrange(parties) for _ in range(candidates)]
+    for v, p in enumerate(voter_party):
+        w.event('ch1', 'member', ['"v%d"' % v, '"party %d"' % p])
+    by_party = [[] for _ in range(parties)]
+    for c, p in enumerate(cand_party):
+        w.event('ch2', 'candidate', ['"c%d"' % c, '"party %d"' % p])
+        by_party[p].append(c)
+    ranks = []
+    for v, p in enumerate(voter_party):
+        for r, c in enumerate(by_party[p]):
+            if rng.random() < rank:
+                ranks.append((v, c, r + 1))
+    rng.shuffle(ranks)
+    for v, c, r in ranks:
+        w.event('ch7', 'rank', ['"v%d"' % v, '"c%d"' % c, str(r)])
+    w.event('ch3', 'end', [])
+
+
+def gen_enum(w, rng, vectors, open, enums, visits, modify):
+    """Vectors are created on a rolling window and enumerated repeatedly, and
+    are sometimes modified in the middle of an enumeration."""
+    next_vec = 0
+    active = []
+    while next_vec < vectors or active:
+        while len(active) < open and next_vec < vectors:
+            v = key(next_vec)
+            w.event('ch1', 'new_v', [str(v)])
+            active.append([v, enums])
+            next_vec += 1
+        i = rng.randrange(len(active))
+        a = active[i]
+        v = str(a[0])
+        w.event('ch2', 'create_e', [v])
+        for _ in range(visits):
+            if rng.random() < modify:
+                w.event('ch4', 'add_v', [v])
+            w.event('ch3', 'visit_e', [v])
+        a[1] -= 1
+        if a[1] == 0:
+            active[i] = active[-1]
+            active.pop()
+
+
+def gen_mapiterator(w, rng, maps, colls, iters, traversals, update):
+    """Each map gets collections and each collection iterators. The iterators
+    are then traversed in random order, with the map sometimes updated in
+    between."""
+    next_ptr = 0
+    for _ in range(maps):
+        m = pointer(next_ptr)
+        next_ptr += 1
+        iterators = []
+        for _ in range(colls):
+            c = pointer(next_ptr)
+            next_ptr += 1
+            w.event('ch1', 'new_mc', [m, c])
+            for _ in range(iters):
+                i = pointer(next_ptr)
+                next_ptr += 1
+                w.event('ch2', 'new_ci', [c, i])
+                iterators.extend([i] * traversals)
+        rng.shuffle(iterators)
+        for i in iterators:
+            if rng.random() < update:
+                w.event('ch4', 'traverse_m', [m])
+            w.event('ch5', 'traverse_i', [i])
+
+
+GENERATORS = {
+    'auction': gen_auction,
+    'candidate': gen_candidate,
+    'enum': gen_enum,
+    'mapiterator': gen_mapiterator,
+}
+
+
+def generate(system, out, **params):
+    """Write a trace for the named system to the file object out and return
+    the number of events written. Missing params take their defaults."""
+    args = dict(DEFAULTS[system])
+    seed = int(params.pop('seed', 1))
+    for name, value in params.items():
+        if name not in args:
+            raise ValueError('Unknown parameter %s for %s' % (name, system))
+        args[name] = type(args[name])(value)
+    w = TraceWriter(out)
+    GENERATORS[system](w, random.Random(seed), **args)
+    return w.count
+
+
+def main():
+    args = sys.argv[1:]
+    if not args or args[0] not in GENERATORS:
+        print(__doc__, file=sys.stderr)
+        sys.exit(1)
+    system = args.pop(0)
+    fname = None
+    params = {}
+    while args:
+        arg = args.pop(0)
+        if arg == '-o' and args:
+            fname = args.pop(0)
+        elif '=' in arg:
+            name, value = arg.split('=', 1)
+            params[name] = int(value) if name == 'seed' else value
+        else:
+            print(__doc__, file=sys.stderr)
+            sys.exit(1)
+
+    try:
+        if fname is None:
+            count = generate(system, sys.stdout, **params)
+        else:
+            with open(fname, 'w') as out:
+                count = generate(system, out, **params)
+    except ValueError as e:
+        print(e, file=sys.stderr)
+        sys.exit(1)
+    print('Wrote %d events' % count, file=sys.stderr)
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,186 @@
+/* Monitor maps with plain linear probing, for comparison with the Robin Hood
+ * maps of the generated monitor_map.c. Entries are never displaced on insert,
+ * and removal shifts later entries of the probe run back into the hole
+ * instead of using tombstones. The MonitorMap layout is unchanged; dib is
+ * only 1 (occupied) or 0 (empty). */
+
+/* Reuse murmur(), dummy_instance and the map constants from the generated
+ * implementation, renaming its map functions out of the way */
+#define monitormap_init robinhood_init
+#define monitormap_insert robinhood_insert
+#define monitormap_lookup robinhood_lookup
+#define monitormap_remove robinhood_remove
+#define monitormap_removeinst robinhood_removeinst
+#define monitormap_free robinhood_free
+#include "monitor_map.c"
+#undef monitormap_init
+#undef monitormap_insert
+#undef monitormap_lookup
+#undef monitormap_remove
+#undef monitormap_removeinst
+#undef monitormap_free
+
+void monitormap_removeinst(MonitorMap *map, MonitorInstance *inst);
+
+/* Return the bucket holding the list for the given identities, or the empty
+ * bucket where it would go */
+static size_t lp_find(MonitorMap *map, uint64_t hash, const void *ids) {
+    size_t i = hash & map->mask;
+    while (map->table[i].dib != 0) {
+        if (map->table[i].hash == hash &&
+                map->equals(ids, IDS_OF(map->table[i].head->mon))) {
+            break;
+        }
+        i = (i + 1) & map->mask;
+    }
+    return i;
+}
+
+/* Grow or shrink the map to the new capacity, a power of two. Return nonzero
+ * on success, zero on failure. */
+static int lp_resize(MonitorMap *map, size_t capacity) {
+    MonitorList *new_table = calloc(capacity, sizeof(MonitorList));
+    if (new_table == NULL) {
+        return 0;
+    }
+
+    size_t mask = capacity - 1;
+    for (size_t i = 0; i < map->capacity; i++) {
+        if (map->table[i].dib == 0) {
+            continue;
+        }
+        size_t j = map->table[i].hash & mask;
+        while (new_table[j].dib != 0) {
+            j = (j + 1) & mask;
+        }
+        new_table[j] = map->table[i];
+    }
+    free(map->table);
+    map->table = new_table;
+    map->capacity = capacity;
+    map->mask = mask;
+    map->grow_at = map->capacity * GROW_THRESHOLD;
+    map->shrink_at = map->capacity * SHRINK_THRESHOLD;
+    return 1;
+}
+
+int monitormap_init(MonitorMap *map, size_t offset,
+                    uint64_t(*hash)(const void *ids),
+                    int (*equals)(const void *ids1, const void *ids2)) {
+    return robinhood_init(map, offset, hash, equals);
+}
+
+MonitorInstance * monitormap_insert(MonitorMap *map, void *mon,
+                                    MonitorInstance *next_inst,
+                                    MonitorMap *next_map) {
+    if (map->count == map->grow_at) {
+        if (!lp_resize(map, map->capacity * 2)) {
+            return NULL;
+        }
+    }
+
+    MonitorInstance *inst = malloc(sizeof(MonitorInstance));
+    if (inst == NULL) {
+        return NULL;
+    }
+    inst->mon = mon;
+    inst->prev = NULL;
+    inst->next_inst = next_inst;
+    inst->next_map = next_map;
+
+    uint64_t hash = map->hash(IDS_OF(mon));
+    size_t i = lp_find(map, hash, IDS_OF(mon));
+    if (map->table[i].dib != 0) {
+        inst->next = map->table[i].head;
+        map->table[i].head->prev = inst;
+    } else {
+        inst->next = NULL;
+        map->table[i].hash = hash;
+        map->table[i].dib = 1;
+        map->count++;
+    }
+    map->table[i].head = inst;
+    return inst;
+}
+
+MonitorInstance * monitormap_lookup(MonitorMap *map, const void *ids) {
+    size_t i = lp_find(map, map->hash(ids), ids);
+    return map->table[i].head;
+}
+
+/* Unlink a MonitorInstance from the list in bucket i, remove it from the next
+ * map, and free it. Then remove the list if it is empty, moving later entries
+ * of the probe run back so no lookup stops early at the hole. */
+static void lp_remove(MonitorMap *map, MonitorInstance *inst, size_t i) {
+    if (inst->prev != NULL) {
+        inst->prev->next = inst->next;
+    } else {
+        map->table[i].head = inst->next;
+    }
+    if (inst->next != NULL) {
+        inst->next->prev = inst->prev;
+    }
+    if (inst->next_map != NULL) {
+        monitormap_removeinst(inst->next_map, inst->next_inst);
+    }
+    free(inst);
+
+    if (map->table[i].head != NULL) {
+        return;
+    }
+    size_t j = i;
+    while (1) {
+        j = (j + 1) & map->mask;
+        if (map->table[j].dib == 0) {
+            break;
+        }
+        /* Move it back if the hole is on its probe path */
+        size_t home = map->table[j].hash & map->mask;
+        if (((j - home) & map->mask) >= ((j - i) & map->mask)) {
+            map->table[i] = map->table[j];
+            i = j;
+        }
+    }
+    map->table[i].dib = 0;
+    map->table[i].head = NULL;
+    map->count--;
+    if (map->capacity > MIN_CAPACITY && map->count <= map->shrink_at) {
+        lp_resize(map, map->capacity / 2);
+    }
+}
+
+void monitormap_removeinst(MonitorMap *map, MonitorInstance *inst) {
+    size_t i = lp_find(map, map->hash(IDS_OF(inst->mon)), IDS_OF(inst->mon));
+    assert(map->table[i].dib != 0);     // Not found
+    lp_remove(map, inst, i);
+}
+
+void monitormap_remove(MonitorMap *map, void *mon) {
+    size_t i = lp_find(map, map->hash(IDS_OF(mon)), IDS_OF(mon));
+    assert(map->table[i].dib != 0);     // Not found
+    MonitorInstance *curr = map->table[i].head;
+    for (; curr != NULL && curr->mon != mon; curr = curr->next);
+    assert(curr != NULL);   // Not found
+    lp_remove(map, curr, i);
+}
+
+MonitorInstance * monitormap_free(MonitorMap *map, int free_contents) {
+    MonitorInstance *result = NULL;
+    if (free_contents) {
+        for (size_t i = 0; i < map->capacity; i++) {
+            MonitorInstance *inst = map->table[i].dib ? map->table[i].head :
+                NULL;
+            while (inst != NULL) {
+                if (inst->next_map != NULL) {
+                    monitormap_removeinst(inst->next_map, inst->next_inst);
+                }
+                MonitorInstance *tmp = inst->next;
+                inst->next = result;
+                result = inst;
+                inst = tmp;
+            }
+        }
+    }
+    free(map->table);
+    return result;
+}
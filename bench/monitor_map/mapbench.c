@@ -0,0 +1,653 @@
+/* Microbenchmark for the monitor maps (monitor_map.h)
+ *
+ * Exercises monitormap_init/insert/lookup/remove/removeinst/free with the key
+ * types the generated local wrappers use: int, pointer and string identities,
+ * plus a multi-identity monitor stored in three linked maps the way CreateMCI
+ * is (one map on each wildcard pattern, chained for removal).
+ *
+ * Reports, as JSON on stdout:
+ * - Cycles per operation for each phase (TSC ticks on x86, nanoseconds
+ *   elsewhere)
+ * - Probe-length histograms after filling each map, measured from where each
+ *   list sits relative to its home bucket
+ * - Heap bytes per entry (tables plus MonitorInstance nodes, not counting the
+ *   monitors themselves)
+ *
+ * Any implementation of monitor_map.h can be linked in instead of the
+ * generated one (see the Makefile). It must keep the MonitorMap and
+ * MonitorList layout, with a nonzero dib marking an occupied bucket, so the
+ * probe lengths can be measured. */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+#include <malloc.h>
+#include <unistd.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+#include "smedl_types.h"
+#include "monitor_map.h"
+
+#ifndef MAP_IMPL_NAME
+#define MAP_IMPL_NAME "monitor_map"
+#endif
+
+/* Longest probe length with its own histogram bucket. Longer probes are
+ * counted in the last bucket. */
+#define MAX_PROBE 64
+
+/* Hit ratios to run the lookup phase at */
+static const double hit_ratios[] = {1.0, 0.9, 0.5, 0.0};
+#define HIT_RATIOS (sizeof(hit_ratios) / sizeof(hit_ratios[0]))
+
+/*****************************************************************************
+ * Measurement
+ *****************************************************************************/
+
+/* Read the cycle counter, or a nanosecond clock where there is none */
+static inline uint64_t cycles(void) {
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * 1000000000 + ts.tv_nsec;
+#endif
+}
+
+/* Bytes currently allocated from the heap */
+static size_t heap_in_use(void) {
+    struct mallinfo2 mi = mallinfo2();
+    return mi.uordblks + mi.hblkhd;
+}
+
+/* Keeps lookup results alive so the loops are not optimized out */
+static volatile uintptr_t sink;
+
+/* xorshift64* */
+static uint64_t rng_state;
+
+static uint64_t rng(void) {
+    rng_state ^= rng_state >> 12;
+    rng_state ^= rng_state << 25;
+    rng_state ^= rng_state >> 27;
+    return rng_state * UINT64_C(2685821657736338717);
+}
+
+/* Uniform double in [0, 1) */
+static double rng_unit(void) {
+    return (rng() >> 11) * (1.0 / (UINT64_C(1) << 53));
+}
+
+/* Fill perm with a random permutation of 0..n-1 */
+static void shuffle(size_t *perm, size_t n) {
+    for (size_t i = 0; i < n; i++) {
+        perm[i] = i;
+    }
+    for (size_t i = n; i > 1; i--) {
+        size_t j = rng() % i;
+        size_t tmp = perm[i - 1];
+        perm[i - 1] = perm[j];
+        perm[j] = tmp;
+    }
+}
+
+/* Print the probe-length histogram of a map as a JSON object */
+static void print_probes(MonitorMap *map) {
+    size_t hist[MAX_PROBE] = {0};
+    size_t lists = 0, total = 0, max = 0, longest = 0;
+    for (size_t i = 0; i < map->capacity; i++) {
+        if (map->table[i].dib == 0) {
+            continue;
+        }
+        size_t probe = ((i - (map->table[i].hash & map->mask)) & map->mask) + 1;
+        hist[(probe < MAX_PROBE ? probe : MAX_PROBE) - 1]++;
+        lists++;
+        total += probe;
+        if (probe > max) {
+            max = probe;
+        }
+        size_t len = 0;
+        for (MonitorInstance *inst = map->table[i].head; inst != NULL;
+                inst = inst->next) {
+            len++;
+        }
+        if (len > longest) {
+            longest = len;
+        }
+    }
+
+    size_t last = MAX_PROBE;
+    while (last > 0 && hist[last - 1] == 0) {
+        last--;
+    }
+    printf("{\"capacity\": %zu, \"lists\": %zu, \"load\": %.3f, "
+            "\"longest_list\": %zu, \"probe_mean\": %.3f, \"probe_max\": %zu, "
+            "\"probe_histogram\": [", map->capacity, lists,
+            (double) lists / map->capacity, longest,
+            lists ? (double) total / lists : 0.0, max);
+    for (size_t i = 0; i < last; i++) {
+        printf(i ? ", %zu" : "%zu", hist[i]);
+    }
+    printf("]}");
+}
+
+/*****************************************************************************
+ * Key types
+ *****************************************************************************/
+
+/* A monitor with the identities of each key type. Only the identities matter
+ * to the maps. */
+typedef struct {
+    union {
+        struct { int id0; } i;
+        struct { void *id0; } p;
+        struct { char *id0; } s;
+        struct { void *id0, *id1, *id2; } m;
+    } ids;
+} BenchMon;
+
+/* Spread sequential numbers over the ints (bijective mod 2^31) */
+static int int_key(size_t i) {
+    return (int) ((i * UINT64_C(2654435761)) & 0x7fffffff);
+}
+
+/* A distinct, 16-byte aligned pointer */
+static void * ptr_key(size_t i) {
+    return (void *) (uintptr_t) (0x10000 + i * 16);
+}
+
+static uint64_t hash_int(const void *key) {
+    const BenchMon *mon = key;
+    murmur_state s = MURMUR_INIT(0);
+    murmur(&mon->ids.i.id0, sizeof(mon->ids.i.id0), &s);
+    return murmur_f(&s);
+}
+
+static int equals_int(const void *key1, const void *key2) {
+    const BenchMon *mon1 = key1, *mon2 = key2;
+    return mon1->ids.i.id0 == mon2->ids.i.id0;
+}
+
+static void make_int(BenchMon *mon, size_t i) {
+    mon->ids.i.id0 = int_key(i);
+}
+
+static uint64_t hash_ptr(const void *key) {
+    const BenchMon *mon = key;
+    murmur_state s = MURMUR_INIT(0);
+    murmur(&mon->ids.p.id0, sizeof(mon->ids.p.id0), &s);
+    return murmur_f(&s);
+}
+
+static int equals_ptr(const void *key1, const void *key2) {
+    const BenchMon *mon1 = key1, *mon2 = key2;
+    return mon1->ids.p.id0 == mon2->ids.p.id0;
+}
+
+static void make_ptr(BenchMon *mon, size_t i) {
+    mon->ids.p.id0 = ptr_key(i);
+}
+
+static uint64_t hash_str(const void *key) {
+    const BenchMon *mon = key;
+    murmur_state s = MURMUR_INIT(0);
+    murmur(mon->ids.s.id0, strlen(mon->ids.s.id0), &s);
+    return murmur_f(&s);
+}
+
+static int equals_str(const void *key1, const void *key2) {
+    const BenchMon *mon1 = key1, *mon2 = key2;
+    return !strcmp(mon1->ids.s.id0, mon2->ids.s.id0);
+}
+
+static void make_str(BenchMon *mon, size_t i) {
+    if (asprintf(&mon->ids.s.id0, "voter %zu", i) < 0) {
+        fprintf(stderr, "Out of memory\n");
+        exit(1);
+    }
+}
+
+/* Multi-identity maps: (map, collection, iterator) like CreateMCI, with a map
+ * on the first identity, one on the last, and one on all three */
+
+static uint64_t hash_m0(const void *key) {
+    const BenchMon *mon = key;
+    murmur_state s = MURMUR_INIT(0);
+    murmur(&mon->ids.m.id0, sizeof(mon->ids.m.id0), &s);
+    return murmur_f(&s);
+}
+
+static int equals_m0(const void *key1, const void *key2) {
+    const BenchMon *mon1 = key1, *mon2 = key2;
+    return mon1->ids.m.id0 == mon2->ids.m.id0;
+}
+
+static uint64_t hash_m2(const void *key) {
+    const BenchMon *mon = key;
+    murmur_state s = MURMUR_INIT(0);
+    murmur(&mon->ids.m.id2, sizeof(mon->ids.m.id2), &s);
+    return murmur_f(&s);
+}
+
+static int equals_m2(const void *key1, const void *key2) {
+    const BenchMon *mon1 = key1, *mon2 = key2;
+    return mon1->ids.m.id2 == mon2->ids.m.id2;
+}
+
+static uint64_t hash_mall(const void *key) {
+    const BenchMon *mon = key;
+    murmur_state s = MURMUR_INIT(0);
+    murmur(&mon->ids.m.id0, sizeof(mon->ids.m.id0), &s);
+    murmur(&mon->ids.m.id1, sizeof(mon->ids.m.id1), &s);
+    murmur(&mon->ids.m.id2, sizeof(mon->ids.m.id2), &s);
+    return murmur_f(&s);
+}
+
+static int equals_mall(const void *key1, const void *key2) {
+    const BenchMon *mon1 = key1, *mon2 = key2;
+    return mon1->ids.m.id0 == mon2->ids.m.id0 &&
+        mon1->ids.m.id1 == mon2->ids.m.id1 &&
+        mon1->ids.m.id2 == mon2->ids.m.id2;
+}
+
+typedef struct {
+    const char *name;
+    uint64_t (*hash)(const void *ids);
+    int (*equals)(const void *ids1, const void *ids2);
+    void (*make)(BenchMon *mon, size_t i);  /* Give mon the i-th key */
+} KeyType;
+
+static const KeyType key_types[] = {
+    {"int", hash_int, equals_int, make_int},
+    {"pointer", hash_ptr, equals_ptr, make_ptr},
+    {"string", hash_str, equals_str, make_str},
+};
+#define KEY_TYPES (sizeof(key_types) / sizeof(key_types[0]))
+
+/*****************************************************************************
+ * Benchmarks
+ *****************************************************************************/
+
+static void * xmalloc(size_t size) {
+    void *p = malloc(size);
+    if (p == NULL) {
+        fprintf(stderr, "Out of memory\n");
+        exit(1);
+    }
+    return p;
+}
+
+/* Free a list of instances returned by monitormap_free() */
+static void free_instances(MonitorInstance *inst) {
+    while (inst != NULL) {
+        MonitorInstance *tmp = inst->next;
+        free(inst);
+        inst = tmp;
+    }
+}
+
+static void fail(const char *what) {
+    fflush(stdout);
+    fprintf(stderr, "\n%s failed\n", what);
+    exit(1);
+}
+
+/* Check that monitors from..to-1 can be found in the map, and the same number
+ * starting at miss cannot. Each list must hold just the one monitor. */
+static void check_single(MonitorMap *map, BenchMon *mons, size_t from,
+        size_t to, size_t miss) {
+    for (size_t i = from; i < to; i++) {
+        MonitorInstance *inst = monitormap_lookup(map, &mons[i]);
+        if (inst == NULL || inst->mon != &mons[i] || inst->next != NULL) {
+            fail("Lookup check");
+        }
+        if (monitormap_lookup(map, &mons[miss + i - from]) != NULL) {
+            fail("Missing key check");
+        }
+    }
+}
+
+/* Benchmark one single-identity key type with n entries:
+ * - insert: fill the map
+ * - lookup: n lookups at each hit ratio, misses using keys never inserted
+ * - churn: n rounds of removing a random monitor and inserting a new one
+ * - sawtooth: remove 90% with monitormap_removeinst (shrinking the table) and
+ *   insert them again (growing it)
+ * - free: monitormap_free with the instances returned */
+static void bench_single(const KeyType *kt, size_t n) {
+    /* Keys 0..n-1 start in the map, n..2n-1 come in with churn, and
+     * 2n..3n-1 are never inserted */
+    size_t total = 3 * n;
+    BenchMon *mons = xmalloc(total * sizeof(BenchMon));
+    for (size_t i = 0; i < total; i++) {
+        kt->make(&mons[i], i);
+    }
+    BenchMon **live = xmalloc(n * sizeof(BenchMon *));
+    MonitorInstance **insts = xmalloc(n * sizeof(MonitorInstance *));
+    size_t *perm = xmalloc(n * sizeof(size_t));
+    MonitorMap map;
+    uint64_t start;
+
+    printf("  {\"keys\": \"%s\", \"entries\": %zu,\n", kt->name, n);
+
+    size_t heap_before = heap_in_use();
+    if (!monitormap_init(&map, 0, kt->hash, kt->equals)) {
+        fail("monitormap_init");
+    }
+    start = cycles();
+    for (size_t i = 0; i < n; i++) {
+        if (monitormap_insert(&map, &mons[i], NULL, NULL) == NULL) {
+            fail("monitormap_insert");
+        }
+    }
+    printf("   \"insert\": %.1f,\n", (double) (cycles() - start) / n);
+    printf("   \"bytes_per_entry\": %.1f,\n",
+            (double) (heap_in_use() - heap_before) / n);
+    check_single(&map, mons, 0, n, 2 * n);
+    printf("   \"table\": ");
+    print_probes(&map);
+    printf(",\n");
+
+    printf("   \"lookup\": [");
+    for (size_t r = 0; r < HIT_RATIOS; r++) {
+        /* Pick the keys first so only the lookups are timed */
+        for (size_t i = 0; i < n; i++) {
+            size_t k = rng() % n;
+            live[i] = rng_unit() < hit_ratios[r] ? &mons[k] : &mons[2 * n + k];
+        }
+        uintptr_t found = 0;
+        start = cycles();
+        for (size_t i = 0; i < n; i++) {
+            found += (uintptr_t) monitormap_lookup(&map, live[i]);
+        }
+        uint64_t elapsed = cycles() - start;
+        sink = found;
+        printf("%s{\"hit_ratio\": %.2f, \"cycles_per_op\": %.1f}",
+                r ? ", " : "", hit_ratios[r], (double) elapsed / n);
+    }
+    printf("],\n");
+
+    /* Steady-state churn. live[] holds the monitors in the map. */
+    for (size_t i = 0; i < n; i++) {
+        live[i] = &mons[i];
+    }
+    start = cycles();
+    for (size_t i = 0; i < n; i++) {
+        size_t victim = rng() % n;
+        monitormap_remove(&map, live[victim]);
+        live[victim] = &mons[n + i];
+        if (monitormap_insert(&map, live[victim], NULL, NULL) == NULL) {
+            fail("monitormap_insert");
+        }
+    }
+    printf("   \"churn\": %.1f,\n", (double) (cycles() - start) / (2 * n));
+    for (size_t i = 0; i < n; i++) {
+        if (monitormap_lookup(&map, live[i]) == NULL) {
+            fail("Lookup after churn");
+        }
+    }
+
+    /* Sawtooth. Rebuild with known instances for monitormap_removeinst. */
+    free_instances(monitormap_free(&map, 1));
+    if (!monitormap_init(&map, 0, kt->hash, kt->equals)) {
+        fail("monitormap_init");
+    }
+    for (size_t i = 0; i < n; i++) {
+        insts[i] = monitormap_insert(&map, &mons[i], NULL, NULL);
+        if (insts[i] == NULL) {
+            fail("monitormap_insert");
+        }
+    }
+    size_t keep = n / 10;
+    shuffle(perm, n);
+    start = cycles();
+    for (size_t i = keep; i < n; i++) {
+        monitormap_removeinst(&map, insts[perm[i]]);
+    }
+    uint64_t remove_cycles = cycles() - start;
+    start = cycles();
+    for (size_t i = keep; i < n; i++) {
+        insts[perm[i]] = monitormap_insert(&map, &mons[perm[i]], NULL, NULL);
+        if (insts[perm[i]] == NULL) {
+            fail("monitormap_insert");
+        }
+    }
+    uint64_t insert_cycles = cycles() - start;
+    check_single(&map, mons, 0, n, 2 * n);
+    printf("   \"sawtooth\": {\"removeinst\": %.1f, \"insert\": %.1f},\n",
+            (double) remove_cycles / (n - keep),
+            (double) insert_cycles / (n - keep));
+
+    start = cycles();
+    free_instances(monitormap_free(&map, 1));
+    printf("   \"free\": %.1f}", (double) (cycles() - start) / n);
+
+    if (kt->make == make_str) {
+        for (size_t i = 0; i < total; i++) {
+            free(mons[i].ids.s.id0);
+        }
+    }
+    free(mons);
+    free(live);
+    free(insts);
+    free(perm);
+}
+
+/* Benchmark linked multi-identity maps, CreateMCI style: about n monitors in
+ * groups of colls x iters sharing the first identity. Each monitor is in
+ * map_2 (last identity), map_0 (first identity, a list of colls x iters
+ * monitors) and map_all, chained in that order for removal.
+ * - insert: add a monitor to all three maps
+ * - lookup_all, lookup_2: full and last-identity lookups (all hits)
+ * - lookup_0: first-identity lookup, walking the list it returns
+ * - remove: monitormap_remove from map_all, which removes from all three
+ * - free: monitormap_free of map_all then the others */
+static void bench_multi(size_t n, size_t colls, size_t iters) {
+    size_t fanout = colls * iters;
+    size_t groups = n / fanout ? n / fanout : 1;
+    n = groups * fanout;
+    BenchMon *mons = xmalloc(n * sizeof(BenchMon));
+    size_t next_ptr = 0;
+    for (size_t g = 0; g < groups; g++) {
+        void *m = ptr_key(next_ptr++);
+        for (size_t c = 0; c < colls; c++) {
+            void *coll = ptr_key(next_ptr++);
+            for (size_t i = 0; i < iters; i++) {
+                BenchMon *mon = &mons[(g * colls + c) * iters + i];
+                mon->ids.m.id0 = m;
+                mon->ids.m.id1 = coll;
+                mon->ids.m.id2 = ptr_key(next_ptr++);
+            }
+        }
+    }
+    BenchMon **order = xmalloc(n * sizeof(BenchMon *));
+    size_t *perm = xmalloc(n * sizeof(size_t));
+    MonitorMap map_0, map_2, map_all;
+    uint64_t start;
+
+    printf("  {\"keys\": \"multi\", \"entries\": %zu, \"fanout\": %zu,\n",
+            n, fanout);
+
+    size_t heap_before = heap_in_use();
+    if (!monitormap_init(&map_0, 0, hash_m0, equals_m0) ||
+            !monitormap_init(&map_2, 0, hash_m2, equals_m2) ||
+            !monitormap_init(&map_all, 0, hash_mall, equals_mall)) {
+        fail("monitormap_init");
+    }
+    shuffle(perm, n);
+    start = cycles();
+    for (size_t i = 0; i < n; i++) {
+        BenchMon *mon = &mons[perm[i]];
+        MonitorInstance *inst_2, *inst_0;
+        inst_2 = monitormap_insert(&map_2, mon, NULL, NULL);
+        if (inst_2 == NULL) {
+            fail("monitormap_insert");
+        }
+        inst_0 = monitormap_insert(&map_0, mon, inst_2, &map_2);
+        if (inst_0 == NULL) {
+            fail("monitormap_insert");
+        }
+        if (monitormap_insert(&map_all, mon, inst_0, &map_0) == NULL) {
+            fail("monitormap_insert");
+        }
+    }
+    printf("   \"insert\": %.1f,\n", (double) (cycles() - start) / n);
+    printf("   \"bytes_per_entry\": %.1f,\n",
+            (double) (heap_in_use() - heap_before) / n);
+    printf("   \"table_0\": ");
+    print_probes(&map_0);
+    printf(",\n   \"table_2\": ");
+    print_probes(&map_2);
+    printf(",\n   \"table_all\": ");
+    print_probes(&map_all);
+    printf(",\n");
+
+    for (size_t i = 0; i < n; i++) {
+        order[i] = &mons[rng() % n];
+    }
+    uintptr_t found = 0;
+    start = cycles();
+    for (size_t i = 0; i < n; i++) {
+        found += (uintptr_t) monitormap_lookup(&map_all, order[i]);
+    }
+    printf("   \"lookup_all\": %.1f,\n", (double) (cycles() - start) / n);
+    start = cycles();
+    for (size_t i = 0; i < n; i++) {
+        found += (uintptr_t) monitormap_lookup(&map_2, order[i]);
+    }
+    printf("   \"lookup_2\": %.1f,\n", (double) (cycles() - start) / n);
+    start = cycles();
+    for (size_t i = 0; i < n; i++) {
+        for (MonitorInstance *inst = monitormap_lookup(&map_0, order[i]);
+                inst != NULL; inst = inst->next) {
+            found += (uintptr_t) inst->mon;
+        }
+    }
+    printf("   \"lookup_0\": %.1f,\n", (double) (cycles() - start) / n);
+    sink = found;
+    for (size_t i = 0; i < n; i++) {
+        size_t len = 0;
+        for (MonitorInstance *inst = monitormap_lookup(&map_0, &mons[i]);
+                inst != NULL; inst = inst->next) {
+            len++;
+        }
+        if (len != fanout || monitormap_lookup(&map_all, &mons[i])->mon !=
+                &mons[i] || monitormap_lookup(&map_2, &mons[i])->mon !=
+                &mons[i]) {
+            fail("Lookup check");
+        }
+    }
+
+    /* Remove half, then free the rest */
+    shuffle(perm, n);
+    start = cycles();
+    for (size_t i = 0; i < n / 2; i++) {
+        monitormap_remove(&map_all, &mons[perm[i]]);
+    }
+    printf("   \"remove\": %.1f,\n", (double) (cycles() - start) / (n / 2));
+    for (size_t i = 0; i < n; i++) {
+        int present = i >= n / 2;
+        BenchMon *mon = &mons[perm[i]];
+        if ((monitormap_lookup(&map_all, mon) != NULL) != present ||
+                (monitormap_lookup(&map_2, mon) != NULL) != present) {
+            fail("Remove check");
+        }
+    }
+
+    start = cycles();
+    free_instances(monitormap_free(&map_all, 1));
+    monitormap_free(&map_0, 0);
+    monitormap_free(&map_2, 0);
+    printf("   \"free\": %.1f}", (double) (cycles() - start) / (n - n / 2));
+
+    free(mons);
+    free(order);
+    free(perm);
+}
+
+static void usage(const char *name) {
+    fprintf(stderr,
+            "Usage: %s [-n entries] [-k keys] [-c colls] [-i iters] "
+            "[-s seed]\n"
+            "  -n  entries per map (default 1000000)\n"
+            "  -k  comma-separated key types from int, pointer, string and "
+            "multi (default all)\n"
+            "  -c  collections per map for multi keys (default 5)\n"
+            "  -i  iterators per collection for multi keys (default 5)\n"
+            "  -s  random seed (default 1)\n", name);
+    exit(1);
+}
+
+int main(int argc, char **argv) {
+    size_t n = 1000000, colls = 5, iters = 5;
+    const char *keys = "int,pointer,string,multi";
+    unsigned long long seed = 1;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "n:k:c:i:s:")) != -1) {
+        switch (opt) {
+            case 'n':
+                n = strtoull(optarg, NULL, 10);
+                break;
+            case 'k':
+                keys = optarg;
+                break;
+            case 'c':
+                colls = strtoull(optarg, NULL, 10);
+                break;
+            case 'i':
+                iters = strtoull(optarg, NULL, 10);
+                break;
+            case 's':
+                seed = strtoull(optarg, NULL, 10);
+                break;
+            default:
+                usage(argv[0]);
+        }
+    }
+    if (optind != argc || n < 10 || colls == 0 || iters == 0) {
+        usage(argv[0]);
+    }
+    rng_state = seed * UINT64_C(0x9e3779b97f4a7c15) + 1;
+
+    printf("{\"implementation\": \"%s\", \"seed\": %llu, \"unit\": \"%s\",\n"
+            " \"results\": [\n", MAP_IMPL_NAME, seed,
+#if defined(__x86_64__) || defined(__i386__)
+            "tsc_cycles"
+#else
+            "ns"
+#endif
+            );
+
+    int first = 1;
+    char *list = strdup(keys);
+    for (char *key = strtok(list, ","); key != NULL; key = strtok(NULL, ",")) {
+        if (!first) {
+            printf(",\n");
+        }
+        first = 0;
+        if (!strcmp(key, "multi")) {
+            bench_multi(n, colls, iters);
+            continue;
+        }
+        size_t k;
+        for (k = 0; k < KEY_TYPES; k++) {
+            if (!strcmp(key, key_types[k].name)) {
+                break;
+            }
+        }
+        if (k == KEY_TYPES) {
+            usage(argv[0]);
+        }
+        bench_single(&key_types[k], n);
+        fflush(stdout);
+    }
+    free(list);
+    printf("\n]}\n");
+    return 0;
+}
@@ -0,0 +1,217 @@
+#!/usr/bin/env python3
+
+"""Replay synthetic workloads through the generated monitor systems and report
+throughput, latency, memory and monitor population as JSON.
+
+Each system is built into the build directory with SMEDL_PROGRESS_INTERVAL
+defined, so the monitor prints its progress to stderr every --interval
+messages. Each workload is generated once per scale into the traces directory
+(see gen_traces.py) and replayed --repeat times. For every run the report has:
+
+events             messages processed
+seconds            time spent in read_events()
+events_per_sec     events / seconds
+ns_per_event       percentiles of the mean time per event over each interval
+peak_rss_kb        maximum resident set size of the monitor process
+timeline           [messages, ns, live monitors of each type] per interval
+
+Usage: run_bench.py [options]
+  --systems a,b,...   systems to run (default: all)
+  --scales 1,4,16     multiply the size parameter of each workload
+  --param s.name=v    set a workload parameter, e.g. auction.bids=50
+  --interval N        messages per progress report (default 10000)
+  --repeat N          runs per workload (default 3)
+  --cflags FLAGS      compiler flags (default "-O2 -DDEBUG=0")
+  --build-dir DIR     where to build the systems (default ./build)
+  --trace-dir DIR     where to keep generated traces (default ./traces)
+  --out FILE          write the report to FILE instead of stdout
+"""
+
+import json
+import math
+import os
+import subprocess
+import sys
+import time
+
+import gen_traces
+
+BENCH_DIR = os.path.dirname(os.path.abspath(__file__))
+REPO_DIR = os.path.dirname(BENCH_DIR)
+
+# Generated code directory, executable, and make variables for each system.
+# The MOP examples are normally linked into their target program, which is not
+# part of the repository, so they are built with a main() that just calls the
+# adapter's main1().
+SYSTEMS = {
+    'auction': ('qea_eval/auction/generated_code', 'Auction', []),
+    'candidate': ('qea_eval/candidate/generated_code', 'CanSys', []),
+    'enum': ('mop_eval/Enum/generated_code', 'Unsafe', [
+        'SMEDL_SOURCES=$(COMMON_SOURCES) Unsafe_file.c $(SOURCES_CreateVec)']),
+    'mapiterator': ('mop_eval/MapIterator/generated_code', 'MapArch', [
+        'SMEDL_SOURCES=$(COMMON_SOURCES) MapArch_file.c $(SOURCES_sync)']),
+}
+
+STUB_MAIN = '''int main1(int argc, char **argv);
+int main(int argc, char **argv) { return main1(argc, argv); }
+'''
+
+
+def build(system, build_dir, cflags, interval):
+    """Build the system and return the path of its executable"""
+    src, exe, make_vars = SYSTEMS[system]
+    out_dir = os.path.join(build_dir, system)
+    os.makedirs(out_dir, exist_ok=True)
+    if system in ('enum', 'mapiterator'):
+        stub = os.path.join(out_dir, 'stub_main.c')
+        with open(stub, 'w') as f:
+            f.write(STUB_MAIN)
+        make_vars = make_vars + ['EXTRA_SOURCES=' + stub]
+    cmd = ['make', '-s', '-C', os.path.join(REPO_DIR, src),
+            'BUILD_DIR=' + out_dir, 'CFLAGS=' + cflags,
+            'CPPFLAGS=-DSMEDL_PROGRESS_INTERVAL=%d' % interval] + make_vars
+    subprocess.run(cmd, check=True, stdout=subprocess.DEVNULL)
+    return os.path.join(out_dir, exe)
+
+
+def make_trace(system, params, trace_dir):
+    """Generate the trace for a workload unless it already exists. Return its
+    path."""
+    name = system + ''.join('-%s%s' % (k, params[k]) for k in sorted(params))
+    path = os.path.join(trace_dir, name + '.json')
+    if not os.path.exists(path):
+        os.makedirs(trace_dir, exist_ok=True)
+        tmp = path + '.tmp'
+        with open(tmp, 'w') as out:
+            gen_traces.generate(system, out, **params)
+        os.rename(tmp, path)
+    return path
+
+
+def percentile(values, p):
+    """Nearest-rank percentile of a sorted list"""
+    if not values:
+        return None
+    rank = max(0, math.ceil(p / 100 * len(values)) - 1)
+    return values[rank]
+
+
+def run(exe, trace):
+    """Replay the trace through the monitor once and return the results"""
+    start = time.monotonic()
+    proc = subprocess.Popen([exe, '--', trace], stdout=subprocess.DEVNULL,
+            stderr=subprocess.PIPE, universal_newlines=True)
+    timeline = []
+    for line in proc.stderr:
+        if line.startswith('{"progress"'):
+            p = json.loads(line)['progress']
+            timeline.append([p['messages'], p['ns'], p['monitors']])
+    _, status, rusage = os.wait4(proc.pid, 0)
+    wall = time.monotonic() - start
+    if not os.WIFEXITED(status) or os.WEXITSTATUS(status) != 0:
+        raise RuntimeError('%s failed on %s' % (exe, trace))
+    if not timeline:
+        raise RuntimeError('%s reported no progress. Was it built with '
+                'SMEDL_PROGRESS_INTERVAL?' % exe)
+
+    per_event = sorted((ns1 - ns0) / (m1 - m0) for (m0, ns0, _), (m1, ns1, _)
+            in zip(timeline, timeline[1:]) if m1 > m0)
+    events, ns, _ = timeline[-1]
+    return {
+        'events': events,
+        'seconds': ns / 1e9,
+        'wall_seconds': wall,
+        'events_per_sec': events / (ns / 1e9) if ns else None,
+        'ns_per_event': {
+            'p50': percentile(per_event, 50),
+            'p90': percentile(per_event, 90),
+            'p99': percentile(per_event, 99),
+            'max': per_event[-1] if per_event else None,
+        },
+        'peak_rss_kb': rusage.ru_maxrss,
+        'timeline': timeline,
+    }
+
+
+def usage():
+    print(__doc__, file=sys.stderr)
+    sys.exit(1)
+
+
+def main():
+    systems = list(SYSTEMS)
+    scales = [1]
+    overrides = {s: {} for s in SYSTEMS}
+    interval = 10000
+    repeat = 3
+    cflags = '-O2 -DDEBUG=0'
+    build_dir = os.path.join(BENCH_DIR, 'build')
+    trace_dir = os.path.join(BENCH_DIR, 'traces')
+    out_file = None
+
+    args = sys.argv[1:]
+    while args:
+        opt = args.pop(0)
+        if not args:
+            usage()
+        val = args.pop(0)
+        if opt == '--systems':
+            systems = val.split(',')
+            if any(s not in SYSTEMS for s in systems):
+                usage()
+        elif opt == '--scales':
+            scales = [float(x) for x in val.replace(' ', ',').split(',') if x]
+        elif opt == '--param':
+            name, value = val.split('=', 1)
+            system, name = name.split('.', 1)
+            if system not in SYSTEMS:
+                usage()
+            overrides[system][name] = value
+        elif opt == '--interval':
+            interval = int(val)
+        elif opt == '--repeat':
+            repeat = int(val)
+        elif opt == '--cflags':
+            cflags = val
+        elif opt == '--build-dir':
+            build_dir = os.path.abspath(val)
+        elif opt == '--trace-dir':
+            trace_dir = os.path.abspath(val)
+        elif opt == '--out':
+            out_file = val
+        else:
+            usage()
+
+    results = []
+    for system in systems:
+        print('Building %s' % system, file=sys.stderr)
+        exe = build(system, build_dir, cflags, interval)
+        for scale in scales:
+            params = dict(gen_traces.DEFAULTS[system])
+            params.update(overrides[system])
+            for name in gen_traces.SIZE_PARAMS[system]:
+                params[name] = int(int(params[name]) * scale)
+            trace = make_trace(system, params, trace_dir)
+            for i in range(repeat):
+                print('Running %s at scale %g (%d/%d)' %
+                        (system, scale, i + 1, repeat), file=sys.stderr)
+                result = {'system': system, 'scale': scale,
+                        'params': params, 'run': i}
+                result.update(run(exe, trace))
+                results.append(result)
+                print('  %d events, %.0f events/s, peak RSS %d KiB' %
+                        (result['events'], result['events_per_sec'] or 0,
+                        result['peak_rss_kb']), file=sys.stderr)
+
+    report = {'cflags': cflags, 'interval': interval, 'results': results}
+    if out_file is None:
+        json.dump(report, sys.stdout, indent=1)
+        print()
+    else:
+        with open(out_file, 'w') as f:
+            json.dump(report, f, indent=1)
+            f.write('\n')
+
+
+if __name__ == '__main__':
+    main()
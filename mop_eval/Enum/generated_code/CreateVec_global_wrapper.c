@@ -4,6 +4,7 @@
 #include <stdlib.h>
 #include "smedl_types.h"
 #include "global_event_queue.h"
+#include "profile.h"
 #include "CreateVec_global_wrapper.h"
 #include "CreateVec_local_wrapper.h"
 #include "CreateVec_mon.h"
@@ -37,6 +38,23 @@ void free_CreateVec_syncset() {
     cb_CreateVec_violation = NULL;
 }
 
+/* Snapshot interface - Write the monitors of every local wrapper to the
+ * snapshot (see snapshot.h). Return nonzero on success, zero on failure. */
+int snapshot_CreateVec_syncset(SMEDLSnapshotWriter *w) {
+    return snapshot_CreateVec_monitors(w);
+}
+
+/* Restore interfaces - Reserve room in the restore block for the monitors of
+ * every local wrapper in the snapshot, then restore them. Return nonzero on
+ * success, zero on failure. */
+int reserve_CreateVec_syncset(SMEDLSnapshot *snap) {
+    return reserve_CreateVec_monitors(snap);
+}
+
+int restore_CreateVec_syncset(SMEDLSnapshot *snap) {
+    return restore_CreateVec_monitors(snap);
+}
+
 /* Intra routing function - Called by import interface functions and intra queue
  * processing function to route events to the local wrappers.
  * Return nonzero on success, zero on failure. */
@@ -44,69 +62,77 @@ int route_CreateVec_ch1(SMEDLValue *identities, SMEDLValue *params, void *aux) {
     #if DEBUG >= 4
     fprintf(stderr, "Global wrapper 'CreateVec' routing for conn 'ch1'\n");
     #endif
+    SMEDL_PROFILE_ROUTE("ch1");
     {
-        SMEDLValue new_identities[1] = {
-                params[0],
-            };
+        SMEDLValue *new_identities = params;
 
         SMEDLValue *new_params = NULL;
 
         if (!process_CreateVec_new_v(new_identities, new_params, aux)) {
             /* malloc fail */
+            SMEDL_PROFILE_POP();
             return 0;
         }
     }
+    SMEDL_PROFILE_POP();
+    return 1;
 }
 int route_CreateVec_ch2(SMEDLValue *identities, SMEDLValue *params, void *aux) {
     #if DEBUG >= 4
     fprintf(stderr, "Global wrapper 'CreateVec' routing for conn 'ch2'\n");
     #endif
+    SMEDL_PROFILE_ROUTE("ch2");
     {
-        SMEDLValue new_identities[1] = {
-                params[0],
-            };
+        SMEDLValue *new_identities = params;
 
         SMEDLValue *new_params = NULL;
 
         if (!process_CreateVec_create_e(new_identities, new_params, aux)) {
             /* malloc fail */
+            SMEDL_PROFILE_POP();
             return 0;
         }
     }
+    SMEDL_PROFILE_POP();
+    return 1;
 }
 int route_CreateVec_ch3(SMEDLValue *identities, SMEDLValue *params, void *aux) {
     #if DEBUG >= 4
     fprintf(stderr, "Global wrapper 'CreateVec' routing for conn 'ch3'\n");
     #endif
+    SMEDL_PROFILE_ROUTE("ch3");
     {
-        SMEDLValue new_identities[1] = {
-                params[0],
-            };
+        SMEDLValue *new_identities = params;
 
         SMEDLValue *new_params = NULL;
 
         if (!process_CreateVec_visit_e(new_identities, new_params, aux)) {
             /* malloc fail */
+            SMEDL_PROFILE_POP();
             return 0;
         }
     }
+    SMEDL_PROFILE_POP();
+    return 1;
 }
 int route_CreateVec_ch4(SMEDLValue *identities, SMEDLValue *params, void *aux) {
     #if DEBUG >= 4
     fprintf(stderr, "Global wrapper 'CreateVec' routing for conn 'ch4'\n");
     #endif
+    SMEDL_PROFILE_ROUTE("ch4");
     {
-        SMEDLValue new_identities[1] = {
-                params[0],
-            };
+        SMEDLValue *new_identities = params;
 
         SMEDLValue *new_params = NULL;
 
         if (!process_CreateVec_add_v(new_identities, new_params, aux)) {
             /* malloc fail */
+            SMEDL_PROFILE_POP();
             return 0;
         }
     }
+    SMEDL_PROFILE_POP();
+    return 1;
 }
 
 /* Intra queue processing function - Route events to the local wrappers. Return
@@ -186,6 +212,7 @@ int raise_CreateVec_violation(SMEDLValue *identities, SMEDLValue *params, void *
         smedl_free_array(params_inter, 0);
         return 0;
     }
+    return 1;
 }
 
 /* Global wrapper import interface - Called by the environment (other
@@ -221,6 +248,26 @@ int import_CreateVec_ch4(SMEDLValue *identities, SMEDLValue *params, void *aux)
     return handle_CreateVec_queues() && success;
 }
 
+/* Routing functions for the batch import interface, indexed by import
+ * channel */
+static const SMEDLCallback import_routes[] = {
+    [IMPORT_CreateVec_ch1] = route_CreateVec_ch1,
+    [IMPORT_CreateVec_ch2] = route_CreateVec_ch2,
+    [IMPORT_CreateVec_ch3] = route_CreateVec_ch3,
+    [IMPORT_CreateVec_ch4] = route_CreateVec_ch4,
+};
+
+int import_CreateVec_batch(SMEDLImportEvent *events, size_t count) {
+    int success = 1;
+
+    for (size_t i = 0; i < count; i++) {
+        SMEDLImportEvent *ev = &events[i];
+        success = import_routes[ev->channel](ev->identities, ev->params,
+                ev->aux) && success;
+    }
+    return handle_CreateVec_inter() && success;
+}
+
 /* Global wrapper callback interface - Used to register callback functions to be
  * called by this global wrapper when it has an event to export to the
  * environment (other synchronous sets, the target system).
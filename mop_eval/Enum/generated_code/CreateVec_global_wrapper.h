@@ -2,6 +2,7 @@
 #define CreateVec_GLOBAL_WRAPPER_H
 
 #include "smedl_types.h"
+#include "snapshot.h"
 
 /******************************************************************************
  * External Interface                                                         *
@@ -15,6 +16,17 @@ int init_CreateVec_syncset();
  * wrapper and all the local wrappers and monitors it manages. */
 void free_CreateVec_syncset();
 
+/* Snapshot interface - Write the monitors of every local wrapper to the
+ * snapshot (see snapshot.h). Return nonzero on success, zero on failure. */
+int snapshot_CreateVec_syncset(SMEDLSnapshotWriter *w);
+
+/* Restore interfaces - Reserve room in the restore block for the monitors of
+ * every local wrapper in the snapshot, then restore them, between
+ * smedl_restore_begin() and smedl_restore_end() (see snapshot.h). Return
+ * nonzero on success, zero on failure. */
+int reserve_CreateVec_syncset(SMEDLSnapshot *snap);
+int restore_CreateVec_syncset(SMEDLSnapshot *snap);
+
 /* Global wrapper export interfaces - Called by monitors to place exported
  * events into the appropriate export queues, where they will later be routed to
  * the proper destinations inside and outside the synchronous set.
@@ -46,6 +58,27 @@ int import_CreateVec_ch2(SMEDLValue *identities, SMEDLValue *params, void *aux);
 int import_CreateVec_ch3(SMEDLValue *identities, SMEDLValue *params, void *aux);
 int import_CreateVec_ch4(SMEDLValue *identities, SMEDLValue *params, void *aux);
 
+/* Import channels for the batch import interface */
+typedef enum {
+    IMPORT_CreateVec_ch1,
+    IMPORT_CreateVec_ch2,
+    IMPORT_CreateVec_ch3,
+    IMPORT_CreateVec_ch4,
+} CreateVecImportID;
+
+/* Global wrapper batch import interface - Called by the environment to import
+ * several events with one call. Events are routed in order. Events exported to
+ * the environment are queued and the export callbacks are called once, after
+ * the last event is routed.
+ * Returns nonzero on success, zero on failure.
+ *
+ * Parameters:
+ * events - An array of events. Each channel is a value from the import channel
+ *   enum above. identities, params, and aux are as for the single-event import
+ *   functions.
+ * count - The number of events in the array */
+int import_CreateVec_batch(SMEDLImportEvent *events, size_t count);
+
 /* Global wrapper callback interface - Used to register callback functions to be
  * called by this global wrapper when it has an event to export to the
  * environment (other synchronous sets, the target system).
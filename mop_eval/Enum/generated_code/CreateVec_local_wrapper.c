@@ -6,6 +6,7 @@
 #include <string.h>
 #include "smedl_types.h"
 #include "monitor_map.h"
+#include "profile.h"
 #include "CreateVec_global_wrapper.h"
 #include "CreateVec_local_wrapper.h"
 #include "CreateVec_mon.h"
@@ -31,37 +32,58 @@
  */
 static MonitorMap monitor_map_all;
 
+/* Population counters for the stats interface */
+static uint64_t dynamic_count, created_count, recycled_count;
+
 /* Monitor map hash functions - One for each monitor map */
 
-static uint64_t hash_all(SMEDLValue *ids) {
+static uint64_t hash_all(const void *key) {
+    const CreateVecIdentities *ids = key;
     murmur_state s = MURMUR_INIT(0);
-    murmur(&ids[0].v.i, sizeof(ids[0].v.i), &s);
+    murmur(&ids->id0, sizeof(ids->id0), &s);
     return murmur_f(&s);
 }
 
 /* Monitor map equals functions - One for each monitor map */
 
-static int equals_all(SMEDLValue *ids1, SMEDLValue *ids2) {
-    if (ids1[0].v.i != ids2[0].v.i) {
+static int equals_all(const void *key1, const void *key2) {
+    const CreateVecIdentities *ids1 = key1, *ids2 = key2;
+    if (ids1->id0 != ids2->id0) {
         return 0;
     }
     return 1;
 }
 
-/* Register the global wrapper's export callbacks with the monitor */
-static void setup_CreateVec_callbacks(CreateVecMonitor *mon) {
-    register_CreateVec_violation(mon, raise_CreateVec_violation);
-    registercleanup_CreateVec(mon, recycle_CreateVec_monitor);
+/* Identity conversion - Fill in an identity tuple from an array of SMEDLValue
+ * as given to the import interfaces. Wildcard identities are left as they
+ * are in the array; lookups with wildcards use monitor maps that ignore them. */
+static void load_CreateVec_ids(CreateVecIdentities *ids, SMEDLValue *identities) {
+    ids->id0 = identities[0].v.i;
+}
+
+/* Register the global wrapper's export callbacks in the callback table shared
+ * by all CreateVec monitors */
+static void setup_CreateVec_callbacks() {
+    CreateVecCallbacks callbacks = {
+        .callback_violation = raise_CreateVec_violation,
+        .cleanup = recycle_CreateVec_monitor,
+    };
+    registershared_CreateVec(&callbacks);
 }
 
 /* Initialization interface - Initialize the local wrapper. Must be called once
  * before creating any monitors or importing any events.
  * Return nonzero on success, zero on failure. */
 int init_CreateVec_local_wrapper() {
+    /* Count the monitor maps with the monitors (see memstats.h) */
+    SMEDL_MEM_REGISTER(&CreateVec_memory);
+    monitor_map_all.account = &CreateVec_memory;
     if (!monitormap_init(&monitor_map_all, offsetof(CreateVecMonitor, identities), hash_all, equals_all)) {
         goto fail_init_monitor_map_all;
     }
 
+    setup_CreateVec_callbacks();
+
     return 1;
 
 fail_init_monitor_map_all:
@@ -75,13 +97,87 @@ void free_CreateVec_local_wrapper() {
 
     while (instances != NULL) {
         MonitorInstance *tmp = instances->next;
-        smedl_free_array(((CreateVecMonitor *) instances->mon)->identities, 1);
         free_CreateVec_monitor(instances->mon);
-        free(instances);
+        SMEDL_FREE_OBJECT(&CreateVec_memory, SMEDL_MEM_MAP_INSTANCE, instances);
         instances = tmp;
     }
 }
 
+/* Count interface - Return the number of live CreateVec monitors */
+size_t count_CreateVec_monitors() {
+    return monitor_map_all.count;
+}
+
+/* Stats interface - Fill in the population of CreateVec monitors and the
+ * health of its monitor maps */
+void stats_CreateVec_monitors(MonitorStats *stats) {
+    stats->live = monitor_map_all.count;
+    stats->spilled = 0;
+    stats->dynamic = dynamic_count;
+    stats->created = created_count;
+    stats->recycled = recycled_count;
+    stats->map_count = 1;
+    stats->maps[0].name = "all";
+    monitormap_stats(&monitor_map_all, &stats->maps[0].stats);
+}
+
+/* Bytes in the snapshot record of a CreateVec monitor: its identities, then
+ * its scenario states and state variables */
+#define CreateVec_RECORD_SIZE (SMEDL_SNAPSHOT_INT + CreateVec_SNAPSHOT_SIZE)
+
+/* Snapshot interface - Write the section for CreateVec monitors to the snapshot
+ * (see snapshot.h). Return nonzero on success, zero on failure. */
+int snapshot_CreateVec_monitors(SMEDLSnapshotWriter *w) {
+    smedl_snapshot_begin(w, "CreateVec", CreateVec_RECORD_SIZE, monitor_map_all.count,
+            dynamic_count, created_count, recycled_count);
+    for (size_t i = 0; i < monitor_map_all.capacity; i++) {
+        if (monitor_map_all.table[i].dib == 0) {
+            continue;
+        }
+        for (MonitorInstance *inst = monitor_map_all.table[i].head; inst != NULL; inst = inst->next) {
+            CreateVecMonitor *mon = inst->mon;
+            smedl_snapshot_put_int(w, mon->identities.id0);
+            snapshot_CreateVec_monitor(mon, w);
+        }
+    }
+    return smedl_snapshot_end(w);
+}
+
+/* Restore interfaces - Reserve room in the restore block for the CreateVec
+ * monitors in the snapshot, then restore them. Return nonzero on success,
+ * zero on failure. */
+int reserve_CreateVec_monitors(SMEDLSnapshot *snap) {
+    return smedl_restore_reserve(snap, "CreateVec", CreateVec_RECORD_SIZE, sizeof(CreateVecMonitor), 1);
+}
+
+int restore_CreateVec_monitors(SMEDLSnapshot *snap) {
+    const SMEDLSnapshotSection *section = smedl_snapshot_section(snap, "CreateVec", CreateVec_RECORD_SIZE);
+    if (section == NULL) {
+        return 0;
+    }
+    if (!monitormap_reserve(&monitor_map_all, section->count)) {
+        return 0;
+    }
+    for (uint64_t i = 0; i < section->count; i++) {
+        /* The monitor struct and map nodes come from the restore block. */
+        CreateVecIdentities ids;
+        ids.id0 = smedl_snapshot_get_int(snap);
+        CreateVecMonitor *mon = init_CreateVec_monitor(&ids);
+        if (mon == NULL) {
+            return 0;
+        }
+        restore_CreateVec_monitor(mon, snap);
+        if (add_CreateVec_monitor(mon) == NULL) {
+            free_CreateVec_monitor(mon);
+            return 0;
+        }
+    }
+    dynamic_count = section->dynamic;
+    created_count = section->created;
+    recycled_count = section->recycled;
+    return !snap->error;
+}
+
 /* Creation interface - Instantiate a new CreateVec monitor.
  * Return nonzero on success or if monitor already exists, zero on failure.
  *
@@ -93,8 +189,11 @@ void free_CreateVec_local_wrapper() {
  *   state can be retrieved with default_CreateVec_state()
  *   and then just the desired variables can be updated. */
 int create_CreateVec_monitor(SMEDLValue *identities, CreateVecState *init_state) {
+    CreateVecIdentities ids;
+    load_CreateVec_ids(&ids, identities);
+
     /* Check if monitor with identities already exists */
-    if (monitormap_lookup(&monitor_map_all, identities) != NULL) {
+    if (MONITORMAP_LOOKUP(&monitor_map_all, &ids, hash_all, equals_all) != NULL) {
 #if DEBUG >= 4
         fprintf(stderr, "Local wrapper 'CreateVec' skipping explicit creation for existing monitor\n");
 #endif
@@ -105,26 +204,19 @@ int create_CreateVec_monitor(SMEDLValue *identities, CreateVecState *init_state)
 #endif
 
     /* Initialize new monitor with identities and state */
-    SMEDLValue *ids_copy = smedl_copy_array(identities, 1);
-    if (ids_copy == NULL) {
-        /* malloc fail */
-        return 0;
-    }
-    CreateVecMonitor *mon = init_CreateVec_with_state(ids_copy, init_state);
+    CreateVecMonitor *mon = init_CreateVec_with_state(&ids, init_state);
     if (mon == NULL) {
         /* malloc fail */
-        smedl_free_array(ids_copy, 1);
         return 0;
     }
-    setup_CreateVec_callbacks(mon);
 
     /* Store monitor in maps */
     if (add_CreateVec_monitor(mon) == NULL) {
         /* malloc fail */
         free_CreateVec_monitor(mon);
-        smedl_free_array(ids_copy, 1);
         return 0;
     }
+    created_count++;
     return 1;
 }
 
@@ -144,7 +236,9 @@ int process_CreateVec_new_v(SMEDLValue *identities, SMEDLValue *params, void *au
 #endif
     /* Fetch the monitors to send the event to or do dynamic instantiation if
      * necessary */
-    MonitorInstance *instances = get_CreateVec_monitors(identities);
+    SMEDL_PROFILE_PUSH(SMEDL_PROFILE_STAGE_LOOKUP);
+    MonitorInstance *instances = get_CreateVec_monitors(identities, 1);
+    SMEDL_PROFILE_POP();
     if (instances == INVALID_INSTANCE) {
         /* malloc fail */
         return 0;
@@ -155,9 +249,11 @@ int process_CreateVec_new_v(SMEDLValue *identities, SMEDLValue *params, void *au
     while (instances != NULL) {
         CreateVecMonitor *mon = instances->mon;
         instances = instances->next;
+        SMEDL_PROFILE_PUSH(SMEDL_PROFILE_STAGE_EXECUTE);
         if (!execute_CreateVec_new_v(mon, params, aux)) {
             success = 0;
         }
+        SMEDL_PROFILE_POP();
     }
     return success;
 }
@@ -166,9 +262,11 @@ int process_CreateVec_create_e(SMEDLValue *identities, SMEDLValue *params, void
 #if DEBUG >= 4
     fprintf(stderr, "Local wrapper 'CreateVec' processing event 'create_e'\n");
 #endif
-    /* Fetch the monitors to send the event to or do dynamic instantiation if
-     * necessary */
-    MonitorInstance *instances = get_CreateVec_monitors(identities);
+    /* Fetch the monitors to send the event to. 'create_e' is not a creation
+     * event, so no dynamic instantiation is done */
+    SMEDL_PROFILE_PUSH(SMEDL_PROFILE_STAGE_LOOKUP);
+    MonitorInstance *instances = get_CreateVec_monitors(identities, 0);
+    SMEDL_PROFILE_POP();
     if (instances == INVALID_INSTANCE) {
         /* malloc fail */
         return 0;
@@ -179,9 +277,11 @@ int process_CreateVec_create_e(SMEDLValue *identities, SMEDLValue *params, void
     while (instances != NULL) {
         CreateVecMonitor *mon = instances->mon;
         instances = instances->next;
+        SMEDL_PROFILE_PUSH(SMEDL_PROFILE_STAGE_EXECUTE);
         if (!execute_CreateVec_create_e(mon, params, aux)) {
             success = 0;
         }
+        SMEDL_PROFILE_POP();
     }
     return success;
 }
@@ -190,9 +290,11 @@ int process_CreateVec_visit_e(SMEDLValue *identities, SMEDLValue *params, void *
 #if DEBUG >= 4
     fprintf(stderr, "Local wrapper 'CreateVec' processing event 'visit_e'\n");
 #endif
-    /* Fetch the monitors to send the event to or do dynamic instantiation if
-     * necessary */
-    MonitorInstance *instances = get_CreateVec_monitors(identities);
+    /* Fetch the monitors to send the event to. 'visit_e' is not a creation
+     * event, so no dynamic instantiation is done */
+    SMEDL_PROFILE_PUSH(SMEDL_PROFILE_STAGE_LOOKUP);
+    MonitorInstance *instances = get_CreateVec_monitors(identities, 0);
+    SMEDL_PROFILE_POP();
     if (instances == INVALID_INSTANCE) {
         /* malloc fail */
         return 0;
@@ -203,9 +305,11 @@ int process_CreateVec_visit_e(SMEDLValue *identities, SMEDLValue *params, void *
     while (instances != NULL) {
         CreateVecMonitor *mon = instances->mon;
         instances = instances->next;
+        SMEDL_PROFILE_PUSH(SMEDL_PROFILE_STAGE_EXECUTE);
         if (!execute_CreateVec_visit_e(mon, params, aux)) {
             success = 0;
         }
+        SMEDL_PROFILE_POP();
     }
     return success;
 }
@@ -214,9 +318,11 @@ int process_CreateVec_add_v(SMEDLValue *identities, SMEDLValue *params, void *au
 #if DEBUG >= 4
     fprintf(stderr, "Local wrapper 'CreateVec' processing event 'add_v'\n");
 #endif
-    /* Fetch the monitors to send the event to or do dynamic instantiation if
-     * necessary */
-    MonitorInstance *instances = get_CreateVec_monitors(identities);
+    /* Fetch the monitors to send the event to. 'add_v' is not a creation
+     * event, so no dynamic instantiation is done */
+    SMEDL_PROFILE_PUSH(SMEDL_PROFILE_STAGE_LOOKUP);
+    MonitorInstance *instances = get_CreateVec_monitors(identities, 0);
+    SMEDL_PROFILE_POP();
     if (instances == INVALID_INSTANCE) {
         /* malloc fail */
         return 0;
@@ -227,9 +333,11 @@ int process_CreateVec_add_v(SMEDLValue *identities, SMEDLValue *params, void *au
     while (instances != NULL) {
         CreateVecMonitor *mon = instances->mon;
         instances = instances->next;
+        SMEDL_PROFILE_PUSH(SMEDL_PROFILE_STAGE_EXECUTE);
         if (!execute_CreateVec_add_v(mon, params, aux)) {
             success = 0;
         }
+        SMEDL_PROFILE_POP();
     }
     return success;
 }
@@ -241,8 +349,8 @@ int recycle_CreateVec_monitor(CreateVecMonitor *mon) {
         fprintf(stderr, "Recycling an instance of 'CreateVec'\n");
 #endif
     monitormap_remove(&monitor_map_all, mon);
-    smedl_free_array(mon->identities, 1);
     free_CreateVec_monitor(mon);
+    recycled_count++;
     return 1;
 }
 
@@ -253,7 +361,7 @@ MonitorInstance * add_CreateVec_monitor(CreateVecMonitor *mon) {
     MonitorMap *prev_map = NULL;
     MonitorInstance *inst;
 
-    inst = monitormap_insert(&monitor_map_all, mon, prev_inst, prev_map);
+    inst = MONITORMAP_INSERT(&monitor_map_all, mon, prev_inst, prev_map, hash_all, equals_all);
     if (inst == NULL) {
         return NULL;
     }
@@ -268,16 +376,22 @@ MonitorInstance * add_CreateVec_monitor(CreateVecMonitor *mon) {
  *
  * If there are no matching monitor instances but the identity list is fully
  * specified (i.e. there are no wildcards), create an instance with those
- * identities and return it.
+ * identities and return it. This is only done when create is nonzero, i.e.
+ * for creation events: events with a transition out of the initial state of
+ * at least one scenario. An instance created by any other event could never
+ * leave its initial states, so the event is simply dropped.
  *
  * Returns a linked list of MonitorInstance (which may be empty, i.e. NULL).
  * If dynamic instantiation fails, returns INVALID_INSTANCE. */
-MonitorInstance * get_CreateVec_monitors(SMEDLValue *identities) {
+MonitorInstance * get_CreateVec_monitors(SMEDLValue *identities, int create) {
+    CreateVecIdentities ids;
+    load_CreateVec_ids(&ids, identities);
+
     /* Look up from the proper monitor map */
     MonitorInstance *instances;
     int dynamic_instantiation = 0;
-    instances = monitormap_lookup(&monitor_map_all, identities);
-    dynamic_instantiation = 1;
+    instances = MONITORMAP_LOOKUP(&monitor_map_all, &ids, hash_all, equals_all);
+    dynamic_instantiation = create;
 
     /* Do dynamic instantiation if wildcards were fully specified and there
      * are no matching monitors */
@@ -285,25 +399,18 @@ MonitorInstance * get_CreateVec_monitors(SMEDLValue *identities) {
 #if DEBUG >= 4
         fprintf(stderr, "Dynamic instantiation for 'CreateVec'\n");
 #endif
-        SMEDLValue *ids_copy = smedl_copy_array(identities, 1);
-        if (ids_copy == NULL) {
-            /* malloc fail */
-            return INVALID_INSTANCE;
-        }
-        CreateVecMonitor *mon = init_CreateVec_monitor(ids_copy);
+        CreateVecMonitor *mon = init_CreateVec_monitor(&ids);
         if (mon == NULL) {
             /* malloc fail */
-            smedl_free_array(ids_copy, 1);
             return INVALID_INSTANCE;
         }
-        setup_CreateVec_callbacks(mon);
         instances = add_CreateVec_monitor(mon);
         if (instances == NULL) {
             /* malloc fail */
             free_CreateVec_monitor(mon);
-            smedl_free_array(ids_copy, 1);
             return INVALID_INSTANCE;
         }
+        dynamic_count++;
     }
 
     return instances;
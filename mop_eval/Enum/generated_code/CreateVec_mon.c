@@ -7,18 +7,66 @@
 #include "event_queue.h"
 #include "CreateVec_mon.h"
 
+/* Memory counted for CreateVec monitors */
+SMEDLMemAccount CreateVec_memory = {"CreateVec"};
+
+/* Callback table shared by all CreateVec monitors without their own */
+static CreateVecCallbacks shared_callbacks;
+
+/* The callback table in effect for a monitor. In a unity build, the export
+ * functions call the global wrapper's raise_*() functions directly for
+ * monitors without a table of their own, since those are the shared callbacks
+ * the local wrapper registers. */
+#define CALLBACKS(mon) ((mon)->callbacks != NULL ? (mon)->callbacks : &shared_callbacks)
+
+/* Convert the monitor's identities to an array of SMEDLValue for the export
+ * callbacks */
+static void get_CreateVec_id_values(CreateVecMonitor *mon, SMEDLValue *values) {
+    values[0].t = SMEDL_INT;
+    values[0].v.i = mon->identities.id0;
+}
+
+/* Shared callback registration function - Set the callback table used by all
+ * CreateVec monitors that have not registered callbacks of their own */
+void registershared_CreateVec(const CreateVecCallbacks *callbacks) {
+    shared_callbacks = *callbacks;
+}
+
+/* Give the monitor its own copy of the shared callback table so its callbacks
+ * can be changed without affecting other monitors. Return nonzero on success,
+ * zero on malloc failure. */
+static int own_CreateVec_callbacks(CreateVecMonitor *mon) {
+    if (mon->callbacks == NULL) {
+        mon->callbacks = SMEDL_MALLOC(&CreateVec_memory, SMEDL_MEM_CALLBACKS,
+                sizeof(CreateVecCallbacks));
+        if (mon->callbacks == NULL) {
+            return 0;
+        }
+        *mon->callbacks = shared_callbacks;
+    }
+    return 1;
+}
+
 /* Callback registration functions - Set the export callback for an exported
- * event */
+ * event on a single monitor */
 
-void register_CreateVec_violation(CreateVecMonitor *mon, SMEDLCallback cb_func) {
-    mon->callback_violation = cb_func;
+int register_CreateVec_violation(CreateVecMonitor *mon, SMEDLCallback cb_func) {
+    if (!own_CreateVec_callbacks(mon)) {
+        return 0;
+    }
+    mon->callbacks->callback_violation = cb_func;
+    return 1;
 }
 
 /* Cleanup callback registration function - Set the callback for when the
  * monitor is ready to be recycled. The callback is responsible for calling
  * free_CreateVec_monitor(). */
-void registercleanup_CreateVec(CreateVecMonitor *mon, int (*cleanup_func)(CreateVecMonitor *mon)) {
-    mon->cleanup = cleanup_func;
+int registercleanup_CreateVec(CreateVecMonitor *mon, int (*cleanup_func)(CreateVecMonitor *mon)) {
+    if (!own_CreateVec_callbacks(mon)) {
+        return 0;
+    }
+    mon->callbacks->cleanup = cleanup_func;
+    return 1;
 }
 
 /* Queue processing function - Call the handlers for all the events in the
@@ -30,6 +78,13 @@ static int handle_CreateVec_queue(CreateVecMonitor *mon) {
     SMEDLValue *params;
     void *aux;
 
+    /* Scenario execution flags only guard events raised within a macro-step.
+     * If nothing was raised, there is nothing to handle and no flags to
+     * reset. */
+    if (mon->event_queue.head == NULL) {
+        return 1;
+    }
+
     while (pop_event(&mon->event_queue, &event, &params, &aux)) {
         switch (event) {
             case EVENT_CreateVec_violation:
@@ -227,8 +282,18 @@ int queue_CreateVec_violation(CreateVecMonitor *mon, SMEDLValue *params, void *a
 }
 
 int export_CreateVec_violation(CreateVecMonitor *mon, SMEDLValue *params, void *aux) {
-    if (mon->callback_violation != NULL) {
-        return (mon->callback_violation)(mon->identities, params, aux);
+#ifdef SMEDL_UNITY
+    if (mon->callbacks == NULL) {
+        SMEDLValue identities[1];
+        get_CreateVec_id_values(mon, identities);
+        return raise_CreateVec_violation(identities, params, aux);
+    }
+#endif
+    SMEDLCallback cb_func = CALLBACKS(mon)->callback_violation;
+    if (cb_func != NULL) {
+        SMEDLValue identities[1];
+        get_CreateVec_id_values(mon, identities);
+        return cb_func(identities, params, aux);
     }
     return 1;
 }
@@ -239,7 +304,7 @@ int export_CreateVec_violation(CreateVecMonitor *mon, SMEDLValue *params, void *
  * Return a pointer to the monitor. Must be freed with
  * free_CreateVec_monitor() when no longer needed.
  * Returns NULL on malloc failure. */
-CreateVecMonitor * init_CreateVec_monitor(SMEDLValue *identities) {
+CreateVecMonitor * init_CreateVec_monitor(CreateVecIdentities *identities) {
     CreateVecState init_state;
 
     /* Initialize the monitor with default state */
@@ -274,14 +339,15 @@ int default_CreateVec_state(CreateVecState *state) {
  * Return a pointer to the monitor. Must be freed with
  * free_CreateVec_monitor() when no longer needed.
  * Returns NULL on malloc failure. */
-CreateVecMonitor * init_CreateVec_with_state(SMEDLValue *identities, CreateVecState *init_state) {
-    CreateVecMonitor *mon = malloc(sizeof(CreateVecMonitor));
+CreateVecMonitor * init_CreateVec_with_state(CreateVecIdentities *identities, CreateVecState *init_state) {
+    CreateVecMonitor *mon = SMEDL_ALLOC_OBJECT(&CreateVec_memory, SMEDL_MEM_MONITOR,
+            sizeof(CreateVecMonitor));
     if (mon == NULL) {
         return NULL;
     }
 
     /* Store the assigned identities */
-    mon->identities = identities;
+    mon->identities = *identities;
 
     /* Copy initial state vars in */
     mon->s = *init_state;
@@ -292,8 +358,8 @@ CreateVecMonitor * init_CreateVec_with_state(SMEDLValue *identities, CreateVecSt
     /* Reset all scenario execution flags */
     memset(&mon->ef, 0, sizeof(mon->ef));
 
-    /* Set all export callbacks to NULL */
-    mon->callback_violation = NULL;
+    /* Use the shared callback table */
+    mon->callbacks = NULL;
 
     /* Initialize event queue */
     mon->event_queue = (EventQueue){0};
@@ -303,5 +369,18 @@ CreateVecMonitor * init_CreateVec_with_state(SMEDLValue *identities, CreateVecSt
 
 /* Free a CreateVec monitor */
 void free_CreateVec_monitor(CreateVecMonitor *mon) {
-    free(mon);
+    SMEDL_FREE(&CreateVec_memory, SMEDL_MEM_CALLBACKS, mon->callbacks);
+    SMEDL_FREE_OBJECT(&CreateVec_memory, SMEDL_MEM_MONITOR, mon);
+}
+
+/* Append the monitor's scenario states and state variables to its snapshot
+ * record */
+void snapshot_CreateVec_monitor(CreateVecMonitor *mon, SMEDLSnapshotWriter *w) {
+    smedl_snapshot_put_state(w, mon->sce1_state);
+}
+
+/* Get the monitor's scenario states and state variables back from its
+ * snapshot record */
+void restore_CreateVec_monitor(CreateVecMonitor *mon, SMEDLSnapshot *snap) {
+    mon->sce1_state = smedl_snapshot_get_state(snap);
 }
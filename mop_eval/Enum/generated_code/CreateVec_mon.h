@@ -3,6 +3,11 @@
 
 #include "smedl_types.h"
 #include "event_queue.h"
+#include "memstats.h"
+#include "snapshot.h"
+
+/* Memory counted for CreateVec monitors (see memstats.h) */
+extern SMEDLMemAccount CreateVec_memory;
 
 /* Internal/exported event enum for action queues */
 typedef enum {
@@ -23,14 +28,31 @@ typedef enum {
 typedef struct CreateVecState {
 } CreateVecState;
 
+/* Identities of a CreateVec monitor.
+ * Stored inline in the CreateVecMonitor struct. They are only converted to
+ * an array of SMEDLValue at the import and export interfaces. */
+typedef struct CreateVecIdentities {
+    int id0;
+} CreateVecIdentities;
+
+/* Callback table for CreateVec monitors.
+ * Holds the exported event callbacks and the cleanup callback. One table is
+ * shared by all CreateVec monitors; a monitor only gets its own copy once one of
+ * its callbacks is registered individually. */
+struct CreateVecMonitor;
+typedef struct CreateVecCallbacks {
+    SMEDLCallback callback_violation;
+    int (*cleanup)(struct CreateVecMonitor *mon);
+} CreateVecCallbacks;
+
 /* CreateVec monitor struct.
  * Maintains all of the internal state for the monitor. */
 typedef struct CreateVecMonitor {
-    /* Array of monitor's identities */
-    SMEDLValue *identities;
+    /* Monitor's identities */
+    CreateVecIdentities identities;
 
-    /* Scenario states */
-    CreateVec_sce1_State sce1_state;
+    /* Scenario states (CreateVec_*_State values, one byte each) */
+    unsigned char sce1_state;
 
     /* Scenario execution flags (ensures each scenario only processes one event
      * per macro-step) */
@@ -41,11 +63,9 @@ typedef struct CreateVecMonitor {
     /* State variables */
     CreateVecState s;
 
-    /* Exported event callback pointers */
-    SMEDLCallback callback_violation;
-
-    /* Cleanup callback pointer */
-    int (*cleanup)(struct CreateVecMonitor *mon);
+    /* Callback table, or NULL to use the table shared by all CreateVec
+     * monitors */
+    CreateVecCallbacks *callbacks;
 
     /* Local event queue */
     EventQueue event_queue;
@@ -53,15 +73,23 @@ typedef struct CreateVecMonitor {
     //TODO mutex?
 } CreateVecMonitor;
 
+/* Shared callback registration function - Set the callback table used by all
+ * CreateVec monitors that have not registered callbacks of their own. The
+ * table is copied. */
+void registershared_CreateVec(const CreateVecCallbacks *callbacks);
+
 /* Callback registration functions - Set the export callback for an exported
- * event. Set to NULL to unregister a callback. */
-void register_CreateVec_violation(CreateVecMonitor *mon, SMEDLCallback cb_func);
+ * event on a single monitor. Set to NULL to unregister a callback. Return
+ * nonzero on success, zero on malloc failure. */
+int register_CreateVec_violation(CreateVecMonitor *mon, SMEDLCallback cb_func);
 
 /* Cleanup callback registration function - Set the callback for when the
  * monitor is ready to be recycled. The callback is responsible for calling
  * free_CreateVec_monitor(). It must accept the monitor pointer as a
- * parameter and return nonzero on success, zero on failure. */
-void registercleanup_CreateVec(CreateVecMonitor *mon, int (*cleanup_func)(CreateVecMonitor *mon));
+ * parameter and return nonzero on success, zero on failure.
+ * Like the callback registration functions, this affects a single monitor and
+ * returns nonzero on success, zero on malloc failure. */
+int registercleanup_CreateVec(CreateVecMonitor *mon, int (*cleanup_func)(CreateVecMonitor *mon));
 
 /* Event handling functions:
  *
@@ -94,7 +122,7 @@ int export_CreateVec_violation(CreateVecMonitor *mon, SMEDLValue *params, void *
  * Return a pointer to the monitor. Must be freed with
  * free_CreateVec_monitor() when no longer needed.
  * Returns NULL on malloc failure. */
-CreateVecMonitor * init_CreateVec_monitor(SMEDLValue *identities);
+CreateVecMonitor * init_CreateVec_monitor(CreateVecIdentities *identities);
 
 /* Fill the provided CreateVecState
  * with the default initial values for the monitor. Note that strings and
@@ -114,10 +142,17 @@ int default_CreateVec_state(CreateVecState *state);
  * Return a pointer to the monitor. Must be freed with
  * free_CreateVec_monitor() when no longer needed.
  * Returns NULL on malloc failure. */
-CreateVecMonitor * init_CreateVec_with_state(SMEDLValue *identities, CreateVecState *init_state);
+CreateVecMonitor * init_CreateVec_with_state(CreateVecIdentities *identities, CreateVecState *init_state);
 
-/* Free a CreateVec monitor. NOTE: Does not free the identities. That must
- * be done by the caller, if necessary. */
+/* Free a CreateVec monitor */
 void free_CreateVec_monitor(CreateVecMonitor *mon);
 
+/* Snapshot functions (see snapshot.h) - snapshot_CreateVec_monitor() appends
+ * the monitor's scenario states and state variables to its record,
+ * CreateVec_SNAPSHOT_SIZE bytes. restore_CreateVec_monitor() gets them back into a
+ * monitor initialized with the same identities. */
+#define CreateVec_SNAPSHOT_SIZE (SMEDL_SNAPSHOT_STATE)
+void snapshot_CreateVec_monitor(CreateVecMonitor *mon, SMEDLSnapshotWriter *w);
+void restore_CreateVec_monitor(CreateVecMonitor *mon, SMEDLSnapshot *snap);
+
 #endif /* CreateVec_MON_H */
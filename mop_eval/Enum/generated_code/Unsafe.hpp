@@ -0,0 +1,102 @@
+#ifndef Unsafe_HPP
+#define Unsafe_HPP
+
+#include "smedl.hpp"
+
+extern "C" {
+#include "CreateVec_global_wrapper.h"
+}
+
+/* C++ interface to the CreateVec synchronous set (see smedl.hpp). Link against
+ * libUnsafe.a. */
+
+namespace smedl::Unsafe {
+
+/* Owns the global wrapper */
+using System = Syncset<init_CreateVec_syncset, free_CreateVec_syncset>;
+
+/* Import channels */
+enum class Channel {
+    ch1,
+    ch2,
+    ch3,
+    ch4,
+};
+
+inline constexpr Channel ch1 = Channel::ch1;
+inline constexpr Channel ch2 = Channel::ch2;
+inline constexpr Channel ch3 = Channel::ch3;
+inline constexpr Channel ch4 = Channel::ch4;
+
+template <Channel C>
+struct ChannelTraits;
+
+template <>
+struct ChannelTraits<Channel::ch1> {
+    using Params = std::tuple<int>;
+    static constexpr auto import = import_CreateVec_ch1;
+};
+
+template <>
+struct ChannelTraits<Channel::ch2> {
+    using Params = std::tuple<int>;
+    static constexpr auto import = import_CreateVec_ch2;
+};
+
+template <>
+struct ChannelTraits<Channel::ch3> {
+    using Params = std::tuple<int>;
+    static constexpr auto import = import_CreateVec_ch3;
+};
+
+template <>
+struct ChannelTraits<Channel::ch4> {
+    using Params = std::tuple<int>;
+    static constexpr auto import = import_CreateVec_ch4;
+};
+
+/* Import an event on channel C. Return true on success, false on failure. */
+template <Channel C, typename... Args>
+inline bool emit(Args &&...args) {
+    return emit_on<ChannelTraits<C>>(std::forward<Args>(args)...);
+}
+
+/* Events exported to the environment */
+enum class Export {
+    CreateVec_violation,
+};
+
+inline constexpr Export CreateVec_violation = Export::CreateVec_violation;
+
+template <Export E>
+struct ExportTraits;
+
+template <>
+struct ExportTraits<Export::CreateVec_violation> {
+    using Identities = std::tuple<int>;
+    using Params = std::tuple<>;
+    static constexpr auto connect = callback_CreateVec_CreateVec_violation;
+};
+
+/* Set the handler for exported event E, or unregister it with an empty
+ * handler */
+template <Export E>
+inline void on(typename detail::Export<ExportTraits<E>>::Handler handler) {
+    on_export<ExportTraits<E>>(std::move(handler));
+}
+
+/* Set the handler for exported event E when exported by the monitor with the
+ * given identities, or unregister it with an empty handler */
+template <Export E>
+inline void on(typename detail::Export<ExportTraits<E>>::Handlers::Key key,
+        typename detail::Export<ExportTraits<E>>::Handler handler) {
+    on_export<ExportTraits<E>>(std::move(key), std::move(handler));
+}
+
+/* Maps keyed by the identities of each monitor */
+template <typename T>
+using CreateVecMap = MonitorMap<T, int>;
+
+} /* namespace smedl::Unsafe */
+
+#endif /* Unsafe_HPP */
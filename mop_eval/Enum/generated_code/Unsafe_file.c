@@ -1,14 +1,33 @@
+#ifdef SMEDL_PROGRESS_INTERVAL
+/* For clock_gettime() */
+#define _POSIX_C_SOURCE 200809L
+#endif
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
 #include <stdint.h>
 #include <inttypes.h>
 #include <errno.h>
+#include <signal.h>
 #include "global_event_queue.h"
 #include "file.h"
 #include "json.h"
+#include "event_codec.h"
+#include "shm_ring.h"
+#include "server.h"
+#include "latency.h"
+#include "profile.h"
+#include "memstats.h"
+#include "telemetry.h"
+#include "snapshot.h"
 #include "CreateVec_global_wrapper.h"
 #include "Unsafe_file.h"
+#ifdef SMEDL_PROGRESS_INTERVAL
+#include <time.h>
+#endif
+#if defined(SMEDL_PROGRESS_INTERVAL) || defined(SMEDL_STATS_INTERVAL)
+#include "CreateVec_local_wrapper.h"
+#endif
 
 static GlobalEventQueue queue = {0};
 
@@ -22,6 +41,7 @@ int handle_queue() {
     void *aux;
 
     while (pop_global_event(&queue, &channel, &identities, &params, &aux)) {
+        SMEDL_LATENCY_TIMER(start);
         switch (channel) {
             case SYSCHANNEL_ch1:
                 success = import_CreateVec_ch1(identities, params, aux) && success;
@@ -36,7 +56,10 @@ int handle_queue() {
                 success = import_CreateVec_ch4(identities, params, aux) && success;
                 break;
             case SYSCHANNEL_CreateVec_violation:
+                SMEDL_PROFILE_OUTPUT(SYSCHANNEL_CreateVec_violation);
                 success = write_CreateVec_violation(identities, params, aux) && success;
+                SMEDL_PROFILE_POP();
+                SMEDL_LATENCY_RECORD(SYSCHANNEL_CreateVec_violation, SMEDL_STAGE_WRITE, start);
                 break;
         }
         /* Event params and identities were malloc'd in the enqueue_*()
@@ -113,25 +136,31 @@ int enqueue_CreateVec_violation(SMEDLValue *identities, SMEDLValue *params,
     return 1;
 }
 
+/* Stream the output functions write to, or NULL for stdout. Set while a frame
+ * received over a socket is being handled so its events go back to the client
+ * that sent it. */
+static FILE *output;
+
 /* Output functions for events that are "sent back to the target system."
  * Return nonzero on success, zero on failure. */
 
 int write_CreateVec_violation(SMEDLValue *identities, SMEDLValue *params, void *aux) {
-    /*printf("{\n"
+    FILE *out = output != NULL ? output : stdout;
+    /*fprintf(out, "{\n"
         "\t\"fmt_version\": [%d, %d],\n"
         "\t\"channel\": \"CreateVec_violation\",\n"
         "\t\"event\": \"CreateVec.violation\",\n"
         "\t\"identities\": [",
         FMT_VERSION_MAJOR, FMT_VERSION_MINOR);
-    printf("%d", identities[0].v.i);
-    printf("],\n"
+    fprintf(out, "%d", identities[0].v.i);
+    fprintf(out, "],\n"
         "\t\"params\": [");
     AuxData *aux_data = aux;
-    printf("],\n"
+    fprintf(out, "],\n"
         "\t\"aux\": %.*s\n", (int) aux_data->len, aux_data->data);
-    printf("}\n");
+    fprintf(out, "}\n");
     */
-    printf("violation\n");
+    fprintf(out, "violation\n");
     return 1;
 }
 
@@ -187,15 +216,114 @@ int get_json_components(const char *str, jsmntok_t *msg,
     return 1;
 }
 
+/* Channels that can be read from the input file, placed by a perfect hash of
+ * their names. See lookup_channel(). */
+#define INPUT_CHANNEL_SLOTS 4
+static const struct {
+    const char *name;
+    size_t len;
+    int channel;
+} input_channels[INPUT_CHANNEL_SLOTS] = {
+    [0] = {"ch1", 3, SYSCHANNEL_ch1},
+    [1] = {"ch2", 3, SYSCHANNEL_ch2},
+    [2] = {"ch3", 3, SYSCHANNEL_ch3},
+    [3] = {"ch4", 3, SYSCHANNEL_ch4},
+};
+
+/* Return the system channel with the given name, or -1 if no input channel has
+ * that name */
+static int lookup_channel(const char *name, size_t len) {
+    if (len == 0) {
+        return -1;
+    }
+    size_t slot = ((unsigned char) name[len - 1] + len) &
+        (INPUT_CHANNEL_SLOTS - 1);
+    if (input_channels[slot].len != len ||
+            memcmp(input_channels[slot].name, name, len)) {
+        return -1;
+    }
+    return input_channels[slot].channel;
+}
+
+#ifdef SMEDL_PROGRESS_INTERVAL
+/* When read_events() started */
+static struct timespec progress_start;
+
+/* Print the number of messages processed, the time taken so far and the number
+ * of live monitors of each type to stderr, as one line of JSON */
+static void report_progress(size_t msg) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    long long ns = (now.tv_sec - progress_start.tv_sec) * 1000000000LL +
+        (now.tv_nsec - progress_start.tv_nsec);
+    fprintf(stderr, "{\"progress\": {\"messages\": %zu, \"ns\": %lld, "
+            "\"monitors\": {\"CreateVec\": %zu}}}\n",
+            msg, ns,
+            count_CreateVec_monitors());
+}
+#endif
+
+#ifdef SMEDL_STATS_INTERVAL
+/* Write the population and monitor map health of each monitor type to the
+ * stats file (see telemetry.h) */
+static void write_monitor_stats(FILE *f) {
+    MonitorStats stats;
+    stats_CreateVec_monitors(&stats);
+    smedl_stats_write_monitors(f, "CreateVec", &stats);
+}
+#endif
+
+/* Number of messages before the last snapshot taken or restored */
+static size_t snapshot_at;
+
+#ifdef SMEDL_SNAPSHOT_INTERVAL
+/* Write the monitors of each synchronous set to a snapshot (see snapshot.h) */
+static int write_snapshot(SMEDLSnapshotWriter *w) {
+    return snapshot_CreateVec_syncset(w);
+}
+#endif
+
 /* Receive and process events from the provided JSON parser. Any malformed
  * events are skipped (with a warning printed to stderr). */
 void read_events(JSONParser *parser) {
     jsmntok_t *msg;
     char *str;
+#ifdef SMEDL_PROGRESS_INTERVAL
+    clock_gettime(CLOCK_MONOTONIC, &progress_start);
+#endif
 
-    for (msg = next_message(parser, &str);
+    for (SMEDL_LATENCY_START(), SMEDL_PROFILE_START(),
+            msg = next_message(parser, &str);
             msg != NULL;
+            SMEDL_LATENCY_START(), SMEDL_PROFILE_START(),
             msg = next_message(parser, &str)) {
+        /* Time spent between events is not counted toward any stage */
+        SMEDL_LATENCY_PAUSE();
+        SMEDL_PROFILE_PAUSE();
+#ifdef SMEDL_PROGRESS_INTERVAL
+        if ((parser->msg_count - 1) % SMEDL_PROGRESS_INTERVAL == 0) {
+            report_progress(parser->msg_count - 1);
+        }
+#endif
+#ifdef SMEDL_STATS_INTERVAL
+        smedl_stats_poll(parser->msg_count - 1);
+#endif
+#ifdef SMEDL_SNAPSHOT_INTERVAL
+        if ((parser->msg_count - 1) % SMEDL_SNAPSHOT_INTERVAL == 0 &&
+                parser->msg_count - 1 > snapshot_at) {
+            /* The queue is handled after each message, so it is empty */
+            snapshot_at = parser->msg_count - 1;
+            if (!smedl_snapshot_fork(SMEDL_SNAPSHOT_FILE, parser->msg_offset,
+                        snapshot_at, write_snapshot)) {
+                err("\nWarning: Could not start snapshot after message %zu",
+                        snapshot_at);
+            }
+        }
+#endif
+        SMEDL_LATENCY_POLL();
+        SMEDL_LATENCY_RESUME();
+        SMEDL_PROFILE_RESUME();
+
         /* Get components from JSON */
         jsmntok_t *chan_tok, *params_tok, *aux_tok;
         if (!get_json_components(str, msg, &chan_tok, &params_tok, &aux_tok)) {
@@ -222,139 +350,173 @@ void read_events(JSONParser *parser) {
             err("\nStopping: Out of memory.");
             break;
         }
-        if (chan_len == strlen("ch1") &&
-                !strncmp(chan, "ch1", chan_len)) {
-            /* Check param array length */
-            if (params_tok->size < 1) {
-            }
-            /* Convert params to SMEDLValue array */
-            int tmp_i;
-            char *tmp_s;
-            SMEDLValue params[1];
-            params_tok++;
-            if (json_to_int(str, params_tok, &params[0].v.i)) {
-                params[0].t = SMEDL_INT;
-            } else {
-                err("\nWarning: Skipping message %d: Bad format, overflow, or "
-                        "out-of-memory\n", parser->msg_count);
-                smedl_free_array_contents(params, 0);
-                continue;
-            }
+        switch (lookup_channel(chan, chan_len)) {
+            case SYSCHANNEL_ch1: {
+                /* Check param array length */
+                if (params_tok->size < 1) {
+                }
+                /* Convert params to SMEDLValue array */
+                int tmp_i;
+                char *tmp_s;
+                SMEDLValue params[1];
+                params_tok++;
+                if (json_to_int(str, params_tok, &params[0].v.i)) {
+                    params[0].t = SMEDL_INT;
+                } else {
+                    err("\nWarning: Skipping message %d: Bad format, overflow, or "
+                            "out-of-memory\n", parser->msg_count);
+                    smedl_free_array_contents(params, 0);
+                    continue;
+                }
 
-            /* Process the event */
-            int result = enqueue_ch1(NULL, params, &aux);
-            smedl_free_array_contents(params, 1);
-            if (result) {
-                if (!handle_queue()) {
-                    err("\nWarning: Problem processing queue after message %d",
+                /* Process the event */
+                SMEDL_LATENCY_LAP(SYSCHANNEL_ch1, SMEDL_STAGE_PARSE);
+                SMEDL_PROFILE_PARSED(SYSCHANNEL_ch1);
+                int result = enqueue_ch1(NULL, params, &aux);
+                SMEDL_LATENCY_LAP(SYSCHANNEL_ch1, SMEDL_STAGE_ENQUEUE);
+                smedl_free_array_contents(params, 1);
+                if (result) {
+                    if (!handle_queue()) {
+                        err("\nWarning: Problem processing queue after message %d",
+                                parser->msg_count);
+                    }
+                    SMEDL_LATENCY_LAP(SYSCHANNEL_ch1, SMEDL_STAGE_HANDLE);
+                } else {
+                    err("\nWarning: Skipping message %d: "
+                            "enqueue_ch1() failed\n",
                             parser->msg_count);
                 }
-            } else {
-                err("\nWarning: Skipping message %d: "
-                        "enqueue_ch1() failed\n",
-                        parser->msg_count);
-            }
-        } else if (chan_len == strlen("ch2") &&
-                !strncmp(chan, "ch2", chan_len)) {
-            /* Check param array length */
-            if (params_tok->size < 1) {
-            }
-            /* Convert params to SMEDLValue array */
-            int tmp_i;
-            char *tmp_s;
-            SMEDLValue params[1];
-            params_tok++;
-            if (json_to_int(str, params_tok, &params[0].v.i)) {
-                params[0].t = SMEDL_INT;
-            } else {
-                err("\nWarning: Skipping message %d: Bad format, overflow, or "
-                        "out-of-memory\n", parser->msg_count);
-                smedl_free_array_contents(params, 0);
-                continue;
+                break;
             }
+            case SYSCHANNEL_ch2: {
+                /* Check param array length */
+                if (params_tok->size < 1) {
+                }
+                /* Convert params to SMEDLValue array */
+                int tmp_i;
+                char *tmp_s;
+                SMEDLValue params[1];
+                params_tok++;
+                if (json_to_int(str, params_tok, &params[0].v.i)) {
+                    params[0].t = SMEDL_INT;
+                } else {
+                    err("\nWarning: Skipping message %d: Bad format, overflow, or "
+                            "out-of-memory\n", parser->msg_count);
+                    smedl_free_array_contents(params, 0);
+                    continue;
+                }
 
-            /* Process the event */
-            int result = enqueue_ch2(NULL, params, &aux);
-            smedl_free_array_contents(params, 1);
-            if (result) {
-                if (!handle_queue()) {
-                    err("\nWarning: Problem processing queue after message %d",
+                /* Process the event */
+                SMEDL_LATENCY_LAP(SYSCHANNEL_ch2, SMEDL_STAGE_PARSE);
+                SMEDL_PROFILE_PARSED(SYSCHANNEL_ch2);
+                int result = enqueue_ch2(NULL, params, &aux);
+                SMEDL_LATENCY_LAP(SYSCHANNEL_ch2, SMEDL_STAGE_ENQUEUE);
+                smedl_free_array_contents(params, 1);
+                if (result) {
+                    if (!handle_queue()) {
+                        err("\nWarning: Problem processing queue after message %d",
+                                parser->msg_count);
+                    }
+                    SMEDL_LATENCY_LAP(SYSCHANNEL_ch2, SMEDL_STAGE_HANDLE);
+                } else {
+                    err("\nWarning: Skipping message %d: "
+                            "enqueue_ch2() failed\n",
                             parser->msg_count);
                 }
-            } else {
-                err("\nWarning: Skipping message %d: "
-                        "enqueue_ch2() failed\n",
-                        parser->msg_count);
-            }
-        } else if (chan_len == strlen("ch3") &&
-                !strncmp(chan, "ch3", chan_len)) {
-            /* Check param array length */
-            if (params_tok->size < 1) {
-            }
-            /* Convert params to SMEDLValue array */
-            int tmp_i;
-            char *tmp_s;
-            SMEDLValue params[1];
-            params_tok++;
-            if (json_to_int(str, params_tok, &params[0].v.i)) {
-                params[0].t = SMEDL_INT;
-            } else {
-                err("\nWarning: Skipping message %d: Bad format, overflow, or "
-                        "out-of-memory\n", parser->msg_count);
-                smedl_free_array_contents(params, 0);
-                continue;
+                break;
             }
+            case SYSCHANNEL_ch3: {
+                /* Check param array length */
+                if (params_tok->size < 1) {
+                }
+                /* Convert params to SMEDLValue array */
+                int tmp_i;
+                char *tmp_s;
+                SMEDLValue params[1];
+                params_tok++;
+                if (json_to_int(str, params_tok, &params[0].v.i)) {
+                    params[0].t = SMEDL_INT;
+                } else {
+                    err("\nWarning: Skipping message %d: Bad format, overflow, or "
+                            "out-of-memory\n", parser->msg_count);
+                    smedl_free_array_contents(params, 0);
+                    continue;
+                }
 
-            /* Process the event */
-            int result = enqueue_ch3(NULL, params, &aux);
-            smedl_free_array_contents(params, 1);
-            if (result) {
-                if (!handle_queue()) {
-                    err("\nWarning: Problem processing queue after message %d",
+                /* Process the event */
+                SMEDL_LATENCY_LAP(SYSCHANNEL_ch3, SMEDL_STAGE_PARSE);
+                SMEDL_PROFILE_PARSED(SYSCHANNEL_ch3);
+                int result = enqueue_ch3(NULL, params, &aux);
+                SMEDL_LATENCY_LAP(SYSCHANNEL_ch3, SMEDL_STAGE_ENQUEUE);
+                smedl_free_array_contents(params, 1);
+                if (result) {
+                    if (!handle_queue()) {
+                        err("\nWarning: Problem processing queue after message %d",
+                                parser->msg_count);
+                    }
+                    SMEDL_LATENCY_LAP(SYSCHANNEL_ch3, SMEDL_STAGE_HANDLE);
+                } else {
+                    err("\nWarning: Skipping message %d: "
+                            "enqueue_ch3() failed\n",
                             parser->msg_count);
                 }
-            } else {
-                err("\nWarning: Skipping message %d: "
-                        "enqueue_ch3() failed\n",
-                        parser->msg_count);
-            }
-        } else if (chan_len == strlen("ch4") &&
-                !strncmp(chan, "ch4", chan_len)) {
-            /* Check param array length */
-            if (params_tok->size < 1) {
-            }
-            /* Convert params to SMEDLValue array */
-            int tmp_i;
-            char *tmp_s;
-            SMEDLValue params[1];
-            params_tok++;
-            if (json_to_int(str, params_tok, &params[0].v.i)) {
-                params[0].t = SMEDL_INT;
-            } else {
-                err("\nWarning: Skipping message %d: Bad format, overflow, or "
-                        "out-of-memory\n", parser->msg_count);
-                smedl_free_array_contents(params, 0);
-                continue;
+                break;
             }
+            case SYSCHANNEL_ch4: {
+                /* Check param array length */
+                if (params_tok->size < 1) {
+                }
+                /* Convert params to SMEDLValue array */
+                int tmp_i;
+                char *tmp_s;
+                SMEDLValue params[1];
+                params_tok++;
+                if (json_to_int(str, params_tok, &params[0].v.i)) {
+                    params[0].t = SMEDL_INT;
+                } else {
+                    err("\nWarning: Skipping message %d: Bad format, overflow, or "
+                            "out-of-memory\n", parser->msg_count);
+                    smedl_free_array_contents(params, 0);
+                    continue;
+                }
 
-            /* Process the event */
-            int result = enqueue_ch4(NULL, params, &aux);
-            smedl_free_array_contents(params, 1);
-            if (result) {
-                if (!handle_queue()) {
-                    err("\nWarning: Problem processing queue after message %d",
+                /* Process the event */
+                SMEDL_LATENCY_LAP(SYSCHANNEL_ch4, SMEDL_STAGE_PARSE);
+                SMEDL_PROFILE_PARSED(SYSCHANNEL_ch4);
+                int result = enqueue_ch4(NULL, params, &aux);
+                SMEDL_LATENCY_LAP(SYSCHANNEL_ch4, SMEDL_STAGE_ENQUEUE);
+                smedl_free_array_contents(params, 1);
+                if (result) {
+                    if (!handle_queue()) {
+                        err("\nWarning: Problem processing queue after message %d",
+                                parser->msg_count);
+                    }
+                    SMEDL_LATENCY_LAP(SYSCHANNEL_ch4, SMEDL_STAGE_HANDLE);
+                } else {
+                    err("\nWarning: Skipping message %d: "
+                            "enqueue_ch4() failed\n",
                             parser->msg_count);
                 }
-            } else {
-                err("\nWarning: Skipping message %d: "
-                        "enqueue_ch4() failed\n",
-                        parser->msg_count);
+                break;
             }
         }
         if (ch_result < 0) {
             free(chan);
         }
     }
+    /* The last read found no message */
+    SMEDL_PROFILE_PARSED(SMEDL_PROFILE_NONE);
+#ifdef SMEDL_PROGRESS_INTERVAL
+    report_progress(parser->msg_count);
+#endif
+#ifdef SMEDL_STATS_INTERVAL
+    smedl_stats_close(parser->msg_count);
+#endif
+#ifdef SMEDL_SNAPSHOT_INTERVAL
+    if (!smedl_snapshot_wait()) {
+        err("\nWarning: Could not write snapshot to %s", SMEDL_SNAPSHOT_FILE);
+    }
+#endif
 
     if (parser->status == JSONSTATUS_READERR) {
         err("\nStopping: Read error.");
@@ -368,6 +530,119 @@ void read_events(JSONParser *parser) {
     err("Processed %d messages.", parser->msg_count);
 }
 
+/* Param types and enqueue functions of the input channels, indexed by system
+ * channel, for events received in binary form (see event_codec.h) */
+static const struct {
+    size_t count;
+    SMEDLType types[1];
+    SMEDLCallback enqueue;
+} binary_inputs[] = {
+    [SYSCHANNEL_ch1] = {1, {SMEDL_INT}, enqueue_ch1},
+    [SYSCHANNEL_ch2] = {1, {SMEDL_INT}, enqueue_ch2},
+    [SYSCHANNEL_ch3] = {1, {SMEDL_INT}, enqueue_ch3},
+    [SYSCHANNEL_ch4] = {1, {SMEDL_INT}, enqueue_ch4},
+};
+
+/* Set by SIGINT or SIGTERM to stop serving shared memory or a socket */
+static volatile sig_atomic_t stopping;
+
+static void stop_serving(int sig) {
+    (void) sig;
+    stopping = 1;
+}
+
+/* Process one binary event. msg is its message number for warnings. A
+ * malformed event is skipped (with a warning printed to stderr). */
+static void process_binary(SMEDLDecoder *dec, size_t msg) {
+    SMEDL_LATENCY_START();
+    SMEDL_PROFILE_START();
+
+    /* Convert params to SMEDLValue array */
+    SMEDLValue params[1];
+    AuxData aux;
+    int channel = lookup_channel(dec->channel, dec->channel_len);
+    if (channel < 0 || !smedl_decode_params(dec, binary_inputs[channel].types,
+                binary_inputs[channel].count, params, &aux.data, &aux.len)) {
+        err("\nWarning: Skipping message %d: Unknown channel or bad "
+                "params\n", msg);
+        return;
+    }
+    if (aux.data == NULL) {
+        aux.data = "null";
+        aux.len = 4;
+    }
+
+    SMEDL_LATENCY_LAP(channel, SMEDL_STAGE_PARSE);
+    SMEDL_PROFILE_PARSED(channel);
+    int result = binary_inputs[channel].enqueue(NULL, params, &aux);
+    SMEDL_LATENCY_LAP(channel, SMEDL_STAGE_ENQUEUE);
+    if (result) {
+        if (!handle_queue()) {
+            err("\nWarning: Problem processing queue after message %d", msg);
+        }
+        SMEDL_LATENCY_LAP(channel, SMEDL_STAGE_HANDLE);
+    } else {
+        err("\nWarning: Skipping message %d: enqueue failed\n", msg);
+    }
+}
+
+/* Receive and process events from the provided shared-memory segment until
+ * SIGINT or SIGTERM, then process the events already published. The caller
+ * must be attached as the segment's monitor. Any malformed events are skipped
+ * (with a warning printed to stderr). */
+void read_shm_events(SMEDLShm *shm) {
+    size_t msg_count = 0;
+    SMEDLShmReader r;
+
+    for (;;) {
+#ifdef SMEDL_STATS_INTERVAL
+        smedl_stats_poll(msg_count);
+#endif
+        if (!smedl_shm_next(shm, &r, stopping ? 0 : 1000)) {
+            if (stopping) {
+                break;
+            }
+            continue;
+        }
+        msg_count++;
+        SMEDL_LATENCY_POLL();
+
+        /* The aux data points into the cell, so it is released afterward */
+        process_binary(&r.dec, msg_count);
+        smedl_shm_release(shm, &r);
+    }
+
+#ifdef SMEDL_STATS_INTERVAL
+    smedl_stats_close(msg_count);
+#endif
+    err("\nFinished.");
+    err("Processed %d messages.", msg_count);
+}
+
+/* Number of events received over sockets so far */
+static size_t socket_msg_count;
+
+/* Process the events in a frame received over a socket, writing the events
+ * they cause to out. Malformed events are skipped (with a warning printed to
+ * stderr). Return nonzero on success, zero if the frame is malformed. */
+static int handle_frame(const unsigned char *frame, size_t len, FILE *out) {
+    SMEDLDecoder dec;
+    size_t off = 0;
+    int status;
+
+    output = out;
+    while ((status = smedl_frame_next(frame, len, &off, &dec)) > 0) {
+        socket_msg_count++;
+        SMEDL_LATENCY_POLL();
+#ifdef SMEDL_STATS_INTERVAL
+        smedl_stats_poll(socket_msg_count);
+#endif
+        process_binary(&dec, socket_msg_count);
+    }
+    output = NULL;
+    return status == 0;
+}
+
 /* Initialize the global wrappers and register callback functions with them.
  * Return nonzero on success, zero on failure. */
 int init_global_wrappers() {
@@ -386,13 +661,110 @@ fail_init_CreateVec:
 /* Cleanup the global wrappers and the local wrappers and monitors within */
 void free_global_wrappers() {
     free_CreateVec_syncset();
+    smedl_restore_free();
+}
+
+/* Restore the monitors of each synchronous set from the snapshot at path and
+ * store the input position it was taken at in offset and msg_count. Return
+ * nonzero on success, zero on failure. */
+static int restore_snapshot(const char *path, uint64_t *offset,
+        uint64_t *msg_count) {
+    SMEDLSnapshot snap;
+    if (!smedl_snapshot_open(&snap, path)) {
+        err("Could not open snapshot %s", path);
+        return 0;
+    }
+    if (!reserve_CreateVec_syncset(&snap)) {
+        err("Snapshot %s does not match these monitors", path);
+        smedl_snapshot_close(&snap);
+        return 0;
+    }
+    if (!smedl_restore_begin()) {
+        err("Out of memory restoring %s", path);
+        smedl_snapshot_close(&snap);
+        return 0;
+    }
+    int success = restore_CreateVec_syncset(&snap);
+    smedl_restore_end();
+    smedl_snapshot_close(&snap);
+    if (!success) {
+        err("Could not restore snapshot %s", path);
+        return 0;
+    }
+    *offset = snap.offset;
+    *msg_count = snap.msg_count;
+    snapshot_at = snap.msg_count;
+    return 1;
 }
 
+/* Attach to the named shared-memory segment as its monitor and process events
+ * until SIGINT or SIGTERM. Return nonzero on success, zero on failure. */
+static int serve_shm(const char *name) {
+    SMEDLShm shm;
+    if (!smedl_shm_open(&shm, name)) {
+        err("Could not open shared memory segment %s", name);
+        return 0;
+    }
+    if (!smedl_shm_serve(&shm)) {
+        err("Another monitor is attached to %s", name);
+        smedl_shm_close(&shm);
+        return 0;
+    }
+
+    signal(SIGINT, stop_serving);
+    signal(SIGTERM, stop_serving);
+    read_shm_events(&shm);
+
+    smedl_shm_unserve(&shm);
+    smedl_shm_close(&shm);
+    return 1;
+}
+
+/* Listen on the Unix-domain socket at path and process the frames of events
+ * clients send until SIGINT or SIGTERM. Return nonzero on success, zero on
+ * failure. */
+static int serve_socket(const char *path) {
+    signal(SIGINT, stop_serving);
+    signal(SIGTERM, stop_serving);
+    if (!smedl_serve_socket(path, handle_frame, &stopping)) {
+        return 0;
+    }
+
+#ifdef SMEDL_STATS_INTERVAL
+    smedl_stats_close(socket_msg_count);
+#endif
+    err("\nFinished.");
+    err("Processed %d messages.", socket_msg_count);
+    return 1;
+}
+
+#if defined(SMEDL_LATENCY) || defined(SMEDL_PROFILE)
+/* Names of the system channels, for the latency histograms and the profile */
+static const char *const channel_names[] = {
+    [SYSCHANNEL_ch1] = "ch1",
+    [SYSCHANNEL_ch2] = "ch2",
+    [SYSCHANNEL_ch3] = "ch3",
+    [SYSCHANNEL_ch4] = "ch4",
+    [SYSCHANNEL_CreateVec_violation] = "CreateVec_violation",
+};
+#endif
+
 /* Print a help message to stderr */
 static void usage(const char *name) {
     err("Usage: %s [--] [input.json]", name);
+    err("       %s --shm <name>", name);
+    err("       %s --listen <path>", name);
+    err("       %s --restore <snapshot> [input.json]", name);
     err("Read messages from the provided input file (or stdin if not provided) "
             "and print\nthe messages emitted back to the environment");
+    err("With --shm, read binary events from the named shared memory segment "
+            "(see\nshm_ring.h) until interrupted");
+    err("With --listen, accept clients on the named Unix-domain socket and "
+            "send each\nthe messages emitted for the events it sends (see "
+            "server.h) until interrupted");
+    err("With --restore, restore the monitors from the snapshot (see "
+            "snapshot.h) and\ncarry on reading the input file from where the "
+            "snapshot was taken");
 }
 
 
@@ -418,6 +790,9 @@ void call_monitor(int parameter, int type){
 int main1(int argc, char **argv) {
     /* Check for a file name argument */
     const char *fname = NULL;
+    const char *shm_name = NULL;
+    const char *socket_path = NULL;
+    const char *snapshot_path = NULL;
     if (argc >= 2) {
         if (!strcmp(argv[1], "--help")) {
             usage(argv[0]);
@@ -429,6 +804,28 @@ int main1(int argc, char **argv) {
                 usage(argv[0]);
                 return 1;
             }
+        } else if (!strcmp(argv[1], "--shm")) {
+            if (argc == 3) {
+                shm_name = argv[2];
+            } else {
+                usage(argv[0]);
+                return 1;
+            }
+        } else if (!strcmp(argv[1], "--listen")) {
+            if (argc == 3) {
+                socket_path = argv[2];
+            } else {
+                usage(argv[0]);
+                return 1;
+            }
+        } else if (!strcmp(argv[1], "--restore")) {
+            if (argc == 3 || argc == 4) {
+                snapshot_path = argv[2];
+                fname = argc == 4 ? argv[3] : NULL;
+            } else {
+                usage(argv[0]);
+                return 1;
+            }
         }
     }
 
@@ -440,9 +837,62 @@ int main1(int argc, char **argv) {
         return 1;
     }
 
+#ifdef SMEDL_LATENCY
+    /* Time the stages of handling each event (see latency.h) */
+    if (!smedl_latency_init(channel_names,
+                sizeof(channel_names) / sizeof(channel_names[0]))) {
+        err("Could not initialize latency histograms");
+        return 1;
+    }
+#endif
+
+#ifdef SMEDL_PROFILE
+    /* Count hardware events in each stage of handling events (see profile.h) */
+    if (!smedl_profile_init(channel_names,
+                sizeof(channel_names) / sizeof(channel_names[0]))) {
+        err("Could not open any performance counters");
+        return 1;
+    }
+#endif
+
+#ifdef SMEDL_MEMSTATS
+    /* Report the memory counted for each monitor type at exit (see
+     * memstats.h) */
+    if (!smedl_mem_init()) {
+        err("Could not initialize memory accounting");
+        return 1;
+    }
+#endif
+
+    /* Pick up from a snapshot, if asked */
+    uint64_t offset = 0, msg_count = 0;
+    if (snapshot_path != NULL &&
+            !restore_snapshot(snapshot_path, &offset, &msg_count)) {
+        return 1;
+    }
+
+#ifdef SMEDL_STATS_INTERVAL
+    /* Write monitor telemetry periodically (see telemetry.h) */
+    if (!smedl_stats_open(SMEDL_STATS_FILE, SMEDL_STATS_INTERVAL,
+                write_monitor_stats)) {
+        err("Could not open %s", SMEDL_STATS_FILE);
+        return 1;
+    }
+#endif
+
+    /* Read from shared memory instead of a file, if asked */
+    if (shm_name != NULL) {
+        return serve_shm(shm_name) ? 0 : 1;
+    }
+
+    /* Or serve clients over a socket */
+    if (socket_path != NULL) {
+        return serve_socket(socket_path) ? 0 : 1;
+    }
+
     /* Initialize the parser */
     JSONParser parser;
-    result = init_parser(&parser, fname);
+    result = init_parser_at(&parser, fname, offset, msg_count);
     if (!result) {
         err("Could not initialize JSON parser");
         return 1;
@@ -3,6 +3,7 @@
 
 #include "smedl_types.h"
 #include "file.h"
+#include "shm_ring.h"
 
 /* Current message format version. Increment the major version whenever making
  * a backward-incompatible change to the message format. Increment the minor
@@ -74,6 +75,12 @@ void free_global_wrappers();
  * events are skipped (with a warning printed to stderr). */
 void read_events(JSONParser *parser);
 
+/* Receive and process events from the provided shared-memory segment until
+ * SIGINT or SIGTERM, then process the events already published. The caller
+ * must be attached as the segment's monitor. Any malformed events are skipped
+ * (with a warning printed to stderr). */
+void read_shm_events(SMEDLShm *shm);
+
 /* Verify the fmt_version and retrieve the other necessary components
  * (channel, params, aux). Return nonzero if successful, zero if something is
  * missing or incorrect.
@@ -0,0 +1,124 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdlib.h>
+#include <stdio.h>
+#include <time.h>
+#include <pthread.h>
+#include "smedl_types.h"
+#include "event_ring.h"
+#include "Unsafe_lib.h"
+#include "CreateVec_global_wrapper.h"
+
+/* Maximum number of records imported with one call to the batch import
+ * interface */
+#ifndef LIB_BATCH_SIZE
+#define LIB_BATCH_SIZE 256
+#endif
+
+/* How long the monitor thread sleeps when every ring is empty */
+#ifndef LIB_IDLE_NS
+#define LIB_IDLE_NS 50000
+#endif
+
+/* Every channel must fit in a record (the largest has 1 param) */
+typedef char lib_params_fit[SMEDL_RECORD_PARAMS >= 1 ? 1 : -1];
+
+/* Import channel and param types for each library channel */
+static const struct {
+    int import;
+    size_t param_count;
+    SMEDLType types[SMEDL_RECORD_PARAMS];
+} lib_channels[] = {
+    [LIBCHANNEL_ch1] = {IMPORT_CreateVec_ch1, 1, {SMEDL_INT}},
+    [LIBCHANNEL_ch2] = {IMPORT_CreateVec_ch2, 1, {SMEDL_INT}},
+    [LIBCHANNEL_ch3] = {IMPORT_CreateVec_ch3, 1, {SMEDL_INT}},
+    [LIBCHANNEL_ch4] = {IMPORT_CreateVec_ch4, 1, {SMEDL_INT}},
+};
+
+static pthread_t monitor_thread;
+static int stopping;
+
+/* Convert a batch of records and import them into the global wrapper */
+static void import_records(SMEDLRecord *records, size_t count) {
+    static SMEDLValue params[LIB_BATCH_SIZE][SMEDL_RECORD_PARAMS];
+    static SMEDLImportEvent events[LIB_BATCH_SIZE];
+
+    for (size_t i = 0; i < count; i++) {
+        int channel = records[i].channel;
+        for (size_t j = 0; j < lib_channels[channel].param_count; j++) {
+            SMEDLValue *val = &params[i][j];
+            val->t = lib_channels[channel].types[j];
+            switch (val->t) {
+                case SMEDL_INT:
+                    val->v.i = records[i].params[j].i;
+                    break;
+                case SMEDL_FLOAT:
+                    val->v.d = records[i].params[j].d;
+                    break;
+                case SMEDL_CHAR:
+                    val->v.c = records[i].params[j].c;
+                    break;
+                default:
+                    val->v.p = records[i].params[j].p;
+                    break;
+            }
+        }
+        events[i].channel = lib_channels[channel].import;
+        events[i].identities = NULL;
+        events[i].params = params[i];
+        events[i].aux = NULL;
+    }
+
+    if (!import_CreateVec_batch(events, count)) {
+        fprintf(stderr, "Warning: Problem importing %zu events from the "
+                "rings\n", count);
+    }
+}
+
+/* Monitor thread - Merge the rings and import the records until stopped and
+ * every ring is drained */
+static void * run_monitor(void *arg) {
+    static SMEDLRecord records[LIB_BATCH_SIZE];
+    struct timespec idle = {0, LIB_IDLE_NS};
+    (void) arg;
+
+    for (;;) {
+        /* Read before merging: once stopping is seen, every emitted record is
+         * older than the next watermark */
+        int stop = __atomic_load_n(&stopping, __ATOMIC_ACQUIRE);
+        size_t count = smedl_ring_merge(records, LIB_BATCH_SIZE);
+        if (count > 0) {
+            import_records(records, count);
+        } else if (stop) {
+            break;
+        } else {
+            nanosleep(&idle, NULL);
+        }
+    }
+    return NULL;
+}
+
+/* Initialize the global wrappers and start the monitor thread. Must be called
+ * once before emitting any events. Register export callbacks after this.
+ * Return nonzero on success, zero on failure. */
+int init_Unsafe_lib() {
+    if (!init_CreateVec_syncset()) {
+        return 0;
+    }
+
+    stopping = 0;
+    if (pthread_create(&monitor_thread, NULL, run_monitor, NULL)) {
+        free_CreateVec_syncset();
+        return 0;
+    }
+    return 1;
+}
+
+/* Stop the monitor thread once every event emitted so far has been processed,
+ * then free the rings and the global wrappers. No thread may emit events
+ * during or after this call. */
+void free_Unsafe_lib() {
+    __atomic_store_n(&stopping, 1, __ATOMIC_RELEASE);
+    pthread_join(monitor_thread, NULL);
+    smedl_ring_free_all();
+    free_CreateVec_syncset();
+}
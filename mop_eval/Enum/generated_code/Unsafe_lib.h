@@ -0,0 +1,78 @@
+#ifndef Unsafe_LIB_H
+#define Unsafe_LIB_H
+
+#include "smedl_types.h"
+#include "event_ring.h"
+
+/* In-process library interface - Link the target program against libUnsafe.a
+ * (with -pthread) and call the emit functions below at the instrumentation
+ * points. Emitting only writes a record into the calling thread's ring; a
+ * monitor thread started by init_Unsafe_lib() merges the rings in timestamp
+ * order and imports the events into the global wrappers.
+ *
+ * Events exported to the target system are delivered to the callbacks
+ * registered through the global wrapper's callback interface (e.g.
+ * callback_CreateVec_CreateVec_violation()). They are called on the monitor
+ * thread. */
+
+/* Library channel enum */
+typedef enum {
+    LIBCHANNEL_ch1,
+    LIBCHANNEL_ch2,
+    LIBCHANNEL_ch3,
+    LIBCHANNEL_ch4,
+} LibChannelID;
+
+/* Initialize the global wrappers and start the monitor thread. Must be called
+ * once before emitting any events. Register export callbacks after this.
+ * Return nonzero on success, zero on failure. */
+int init_Unsafe_lib();
+
+/* Stop the monitor thread once every event emitted so far has been processed,
+ * then free the rings and the global wrappers. No thread may emit events
+ * during or after this call. */
+void free_Unsafe_lib();
+
+/* Emit functions - One per channel from the target system. Do not block unless
+ * the calling thread's ring is full. */
+static inline void smedl_emit_ch1(int p0) {
+    SMEDLRecord *rec = smedl_ring_reserve();
+    if (rec == NULL) {
+        return;
+    }
+    rec->channel = LIBCHANNEL_ch1;
+    rec->params[0].i = p0;
+    smedl_ring_commit(rec);
+}
+
+static inline void smedl_emit_ch2(int p0) {
+    SMEDLRecord *rec = smedl_ring_reserve();
+    if (rec == NULL) {
+        return;
+    }
+    rec->channel = LIBCHANNEL_ch2;
+    rec->params[0].i = p0;
+    smedl_ring_commit(rec);
+}
+
+static inline void smedl_emit_ch3(int p0) {
+    SMEDLRecord *rec = smedl_ring_reserve();
+    if (rec == NULL) {
+        return;
+    }
+    rec->channel = LIBCHANNEL_ch3;
+    rec->params[0].i = p0;
+    smedl_ring_commit(rec);
+}
+
+static inline void smedl_emit_ch4(int p0) {
+    SMEDLRecord *rec = smedl_ring_reserve();
+    if (rec == NULL) {
+        return;
+    }
+    rec->channel = LIBCHANNEL_ch4;
+    rec->params[0].i = p0;
+    smedl_ring_commit(rec);
+}
+
+#endif /* Unsafe_LIB_H */
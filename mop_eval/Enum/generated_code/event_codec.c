@@ -0,0 +1,219 @@
+#include <string.h>
+#include <stdint.h>
+#include <limits.h>
+#include "event_codec.h"
+
+/* Tags for the values in an event */
+#define TAG_INT 'i'
+#define TAG_FLOAT 'f'
+#define TAG_CHAR 'c'
+#define TAG_STRING 's'
+#define TAG_POINTER 'p'
+#define TAG_AUX 'a'
+
+/* Reserve n bytes at the end of the event. Return a pointer to them, or NULL
+ * if they do not fit. */
+static unsigned char * reserve(SMEDLEncoder *e, size_t n) {
+    if (e->overflow || n > e->cap - e->len) {
+        e->overflow = 1;
+        return NULL;
+    }
+    unsigned char *p = e->buf + e->len;
+    e->len += n;
+    return p;
+}
+
+/* Start encoding an event on the named channel into buf, which holds cap
+ * bytes */
+void smedl_encode_init(SMEDLEncoder *e, void *buf, size_t cap,
+        const char *channel) {
+    e->buf = buf;
+    e->cap = cap;
+    e->len = 0;
+    e->overflow = 0;
+
+    size_t len = strlen(channel);
+    if (len > UCHAR_MAX) {
+        e->overflow = 1;
+        return;
+    }
+    unsigned char *p = reserve(e, 1 + len);
+    if (p != NULL) {
+        p[0] = len;
+        memcpy(p + 1, channel, len);
+    }
+}
+
+/* Add a param to the event. Params must be added in order. */
+
+void smedl_encode_int(SMEDLEncoder *e, int i) {
+    unsigned char *p = reserve(e, 1 + sizeof(i));
+    if (p != NULL) {
+        p[0] = TAG_INT;
+        memcpy(p + 1, &i, sizeof(i));
+    }
+}
+
+void smedl_encode_float(SMEDLEncoder *e, double d) {
+    unsigned char *p = reserve(e, 1 + sizeof(d));
+    if (p != NULL) {
+        p[0] = TAG_FLOAT;
+        memcpy(p + 1, &d, sizeof(d));
+    }
+}
+
+void smedl_encode_char(SMEDLEncoder *e, char c) {
+    unsigned char *p = reserve(e, 2);
+    if (p != NULL) {
+        p[0] = TAG_CHAR;
+        p[1] = c;
+    }
+}
+
+void smedl_encode_string(SMEDLEncoder *e, const char *s) {
+    uint32_t len = strlen(s);
+    unsigned char *p = reserve(e, 1 + sizeof(len) + len + 1);
+    if (p != NULL) {
+        p[0] = TAG_STRING;
+        memcpy(p + 1, &len, sizeof(len));
+        memcpy(p + 1 + sizeof(len), s, len + 1);
+    }
+}
+
+void smedl_encode_pointer(SMEDLEncoder *e, void *ptr) {
+    unsigned char *p = reserve(e, 1 + sizeof(ptr));
+    if (p != NULL) {
+        p[0] = TAG_POINTER;
+        memcpy(p + 1, &ptr, sizeof(ptr));
+    }
+}
+
+/* Attach aux data to the event. Must be valid JSON text and be added after
+ * the last param. */
+void smedl_encode_aux(SMEDLEncoder *e, const char *json, size_t len) {
+    uint32_t len32 = len;
+    unsigned char *p = reserve(e, 1 + sizeof(len32) + len);
+    if (p != NULL) {
+        p[0] = TAG_AUX;
+        memcpy(p + 1, &len32, sizeof(len32));
+        memcpy(p + 1 + sizeof(len32), json, len);
+    }
+}
+
+/* Start decoding the len-byte event at data. Return nonzero on success, zero
+ * if it does not even hold a channel name. */
+int smedl_decode_init(SMEDLDecoder *d, const void *data, size_t len) {
+    d->data = data;
+    d->len = len;
+    if (len == 0 || d->data[0] + 1u > len) {
+        return 0;
+    }
+    d->channel = (const char *) d->data + 1;
+    d->channel_len = d->data[0];
+    d->off = 1 + d->channel_len;
+    return 1;
+}
+
+/* Convert the event's params to an array of SMEDLValue of the given types, and
+ * get its aux data (NULL if none). Strings point into the event data. Return
+ * nonzero on success, zero if the event does not have exactly those params. */
+int smedl_decode_params(SMEDLDecoder *d, const SMEDLType *types, size_t count,
+        SMEDLValue *params, const char **aux, size_t *aux_len) {
+    const unsigned char *data = d->data;
+    size_t len = d->len;
+    size_t off = d->off;
+    uint32_t n;
+
+    for (size_t i = 0; i < count; i++) {
+        if (off >= len) {
+            return 0;
+        }
+        unsigned char tag = data[off++];
+        switch (types[i]) {
+            case SMEDL_INT:
+                if (tag != TAG_INT || off + sizeof(int) > len) {
+                    return 0;
+                }
+                memcpy(&params[i].v.i, data + off, sizeof(int));
+                off += sizeof(int);
+                break;
+            case SMEDL_FLOAT:
+                if (tag != TAG_FLOAT || off + sizeof(double) > len) {
+                    return 0;
+                }
+                memcpy(&params[i].v.d, data + off, sizeof(double));
+                off += sizeof(double);
+                break;
+            case SMEDL_CHAR:
+                if (tag != TAG_CHAR || off + 1 > len) {
+                    return 0;
+                }
+                params[i].v.c = data[off++];
+                break;
+            case SMEDL_STRING:
+                if (tag != TAG_STRING || off + sizeof(n) > len) {
+                    return 0;
+                }
+                memcpy(&n, data + off, sizeof(n));
+                off += sizeof(n);
+                if (n >= len - off || data[off + n] != '\0') {
+                    return 0;
+                }
+                params[i].v.s = (char *) data + off;
+                off += n + 1;
+                break;
+            case SMEDL_POINTER:
+                if (tag != TAG_POINTER || off + sizeof(void *) > len) {
+                    return 0;
+                }
+                memcpy(&params[i].v.p, data + off, sizeof(void *));
+                off += sizeof(void *);
+                break;
+            default:
+                return 0;
+        }
+        params[i].t = types[i];
+    }
+
+    *aux = NULL;
+    *aux_len = 0;
+    if (off < len) {
+        if (data[off++] != TAG_AUX || off + sizeof(n) > len) {
+            return 0;
+        }
+        memcpy(&n, data + off, sizeof(n));
+        off += sizeof(n);
+        if (n > len - off) {
+            return 0;
+        }
+        *aux = (const char *) data + off;
+        *aux_len = n;
+        off += n;
+    }
+    return off == len;
+}
+
+/* Start decoding the next event in a frame (without its length header),
+ * where *off is the offset of the event's length. Advance *off past it.
+ * Return 1 if there was an event, 0 at the end of the frame, -1 if the frame
+ * is malformed. */
+int smedl_frame_next(const void *frame, size_t len, size_t *off,
+        SMEDLDecoder *d) {
+    const unsigned char *data = frame;
+    uint16_t event_len;
+
+    if (*off == len) {
+        return 0;
+    }
+    if (len - *off < sizeof(event_len)) {
+        return -1;
+    }
+    memcpy(&event_len, data + *off, sizeof(event_len));
+    *off += sizeof(event_len);
+    if (event_len > len - *off ||
+            !smedl_decode_init(d, data + *off, event_len)) {
+        return -1;
+    }
+    *off += event_len;
+    return 1;
+}
@@ -0,0 +1,171 @@
+#define _POSIX_C_SOURCE 200809L
+#include <stdlib.h>
+#include <stdint.h>
+#include <sched.h>
+#include <time.h>
+#include <pthread.h>
+#include "event_ring.h"
+
+/* States of a ring. Whichever of the exiting thread and
+ * smedl_ring_free_all() gets to a ring last frees it. */
+#define RING_LIVE 0     /* Its thread may still emit */
+#define RING_RETIRED 1  /* Its thread has exited; free it once drained */
+#define RING_DETACHED 2 /* Out of the list; its thread frees it on exit */
+
+__thread SMEDLRing *smedl_thread_ring;
+
+/* Every ring that has been attached and not yet freed. Threads only ever push
+ * onto the front, and only the monitor thread unlinks rings, so it can walk
+ * the list while threads attach. */
+static SMEDLRing *rings;
+
+/* Retires the calling thread's ring when it exits */
+static pthread_key_t ring_key;
+static pthread_once_t ring_key_once = PTHREAD_ONCE_INIT;
+static int ring_key_ok;
+
+/* Destructor of ring_key, run when a thread with a ring exits */
+static void retire_ring(void *arg) {
+    SMEDLRing *ring = arg;
+    smedl_thread_ring = NULL;
+    /* Publishes the last tail stored to the monitor thread */
+    if (__atomic_exchange_n(&ring->state, RING_RETIRED, __ATOMIC_ACQ_REL) ==
+            RING_DETACHED) {
+        free(ring);
+    }
+}
+
+static void create_ring_key(void) {
+    ring_key_ok = !pthread_key_create(&ring_key, retire_ring);
+}
+
+/* Read CLOCK_MONOTONIC in nanoseconds. Used in place of the TSC where there is
+ * none. */
+uint64_t smedl_monotonic_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+/* Create the calling thread's ring and register it with the monitor thread.
+ * Return the ring, or NULL if out of memory. */
+SMEDLRing * smedl_ring_attach(void) {
+    SMEDLRing *ring = malloc(sizeof(SMEDLRing));
+    if (ring == NULL) {
+        return NULL;
+    }
+    ring->head = 0;
+    ring->tail = 0;
+    ring->state = RING_LIVE;
+    pthread_once(&ring_key_once, create_ring_key);
+    if (!ring_key_ok || pthread_setspecific(ring_key, ring)) {
+        free(ring);
+        return NULL;
+    }
+
+    ring->next = __atomic_load_n(&rings, __ATOMIC_RELAXED);
+    while (!__atomic_compare_exchange_n(&rings, &ring->next, ring, 1,
+                __ATOMIC_RELEASE, __ATOMIC_RELAXED)) {
+    }
+    smedl_thread_ring = ring;
+    return ring;
+}
+
+/* Wait until the ring has room for another record */
+void smedl_ring_wait(SMEDLRing *ring) {
+    while (ring->tail - __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE) ==
+            SMEDL_RING_SIZE) {
+        sched_yield();
+    }
+}
+
+/* Unlink and free the rings whose threads have exited and which have been
+ * drained. Only the monitor thread unlinks rings, so next pointers only change
+ * here; a thread attaching may only change the front of the list. */
+static void free_retired(void) {
+    SMEDLRing **link = &rings;
+    SMEDLRing *ring = __atomic_load_n(link, __ATOMIC_ACQUIRE);
+    while (ring != NULL) {
+        SMEDLRing *next = ring->next;
+        if (__atomic_load_n(&ring->state, __ATOMIC_ACQUIRE) != RING_RETIRED ||
+                ring->head != ring->tail) {
+            link = &ring->next;
+        } else if (link != &rings) {
+            *link = next;
+            free(ring);
+        } else if (__atomic_compare_exchange_n(&rings, &ring, next, 0,
+                    __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+            free(ring);
+        } else {
+            /* A thread attached in front of it; walk up to it again. ring now
+             * holds the new front of the list. */
+            continue;
+        }
+        ring = next;
+    }
+}
+
+/* Copy up to max records out of the rings into out, oldest first, and return
+ * how many were copied. Only call from one thread at a time. */
+size_t smedl_ring_merge(SMEDLRecord *out, size_t max) {
+    free_retired();
+    SMEDLRing *all = __atomic_load_n(&rings, __ATOMIC_ACQUIRE);
+    size_t count = 0;
+
+    while (count < max) {
+        /* Only records stamped before this are merged: one stamped after it
+         * may belong after a record that is still on its way into a ring
+         * already scanned. A record stamped before it may still be published
+         * after the scan, since there is a window between stamping a record
+         * and storing the tail, so concurrent events can be merged out of
+         * timestamp order. Events ordered in the target program are not: a
+         * record's tail is stored before its thread synchronizes with the
+         * thread that emits next, so it is visible by the time that thread
+         * stamps its record. */
+        uint64_t watermark = smedl_tsc();
+        __atomic_thread_fence(__ATOMIC_SEQ_CST);
+
+        /* Find the oldest record at the head of any ring */
+        SMEDLRing *oldest = NULL;
+        SMEDLRecord *oldest_rec = NULL;
+        for (SMEDLRing *ring = all; ring != NULL; ring = ring->next) {
+            if (ring->head == __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE)) {
+                continue;
+            }
+            SMEDLRecord *rec =
+                &ring->records[ring->head & (SMEDL_RING_SIZE - 1)];
+            if (rec->tsc < watermark &&
+                    (oldest_rec == NULL || rec->tsc < oldest_rec->tsc)) {
+                oldest = ring;
+                oldest_rec = rec;
+            }
+        }
+        if (oldest == NULL) {
+            break;
+        }
+
+        out[count++] = *oldest_rec;
+        __atomic_store_n(&oldest->head, oldest->head + 1, __ATOMIC_RELEASE);
+    }
+    return count;
+}
+
+/* Free every ring, or leave it for its thread to free on exit if the thread
+ * is still running. No thread may emit or merge afterward. */
+void smedl_ring_free_all(void) {
+    SMEDLRing *ring = __atomic_exchange_n(&rings, NULL, __ATOMIC_ACQUIRE);
+    while (ring != NULL) {
+        SMEDLRing *next = ring->next;
+        if (__atomic_exchange_n(&ring->state, RING_DETACHED,
+                    __ATOMIC_ACQ_REL) == RING_RETIRED) {
+            free(ring);
+        }
+        ring = next;
+    }
+    if (smedl_thread_ring != NULL) {
+        /* The calling thread's own ring is freed now, not when it exits */
+        pthread_setspecific(ring_key, NULL);
+        free(smedl_thread_ring);
+        smedl_thread_ring = NULL;
+    }
+}
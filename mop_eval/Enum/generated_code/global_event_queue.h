@@ -11,6 +11,9 @@ typedef struct GlobalEvent {
     SMEDLValue *ids;
     /* Same for params (event parameters) */
     SMEDLValue *params;
+    /* Used instead of ids and params for events pushed with
+     * push_global_shared() */
+    SMEDLEvent *ev;
     void *aux;
     struct GlobalEvent *next;
 } GlobalEvent;
@@ -45,4 +48,31 @@ int push_global_event(GlobalEventQueue *q, int channel, SMEDLValue *ids,
 int pop_global_event(GlobalEventQueue *q, int *channel, SMEDLValue **ids,
         SMEDLValue **params, void **aux);
 
+/* Add a reference-counted event to the queue. The queue takes over the caller's
+ * reference. Return 1 if successful, 0 if malloc fails (in which case the
+ * caller still owns its reference).
+ *
+ * A queue should be used with either push_global_event()/pop_global_event()
+ * or push_global_shared()/pop_global_shared(), not both.
+ *
+ * Parameters:
+ * q - Pointer to the EventQueue to push to
+ * channel - Channel ID (from the global wrapper's channel enum)
+ * ev - The event
+ * aux - Aux data to pass through */
+int push_global_shared(GlobalEventQueue *q, int channel, SMEDLEvent *ev,
+        void *aux);
+
+/* Remove a reference-counted event from the queue. The caller takes over the
+ * queue's reference to the event and must release it. Return 1 if successful,
+ * 0 if the queue is empty.
+ *
+ * Parameters:
+ * q - Pointer to the EventQueue to pop from
+ * channel - Pointer to store the channel ID at
+ * ev - Pointer at which to store the event
+ * aux - Pointer to an Aux pointer to store the aux data in */
+int pop_global_shared(GlobalEventQueue *q, int *channel, SMEDLEvent **ev,
+        void **aux);
+
 #endif /* GLOBAL_EVENT_QUEUE_H */
@@ -0,0 +1,117 @@
+#ifndef MEMSTATS_H
+#define MEMSTATS_H
+
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+/* Heap accounting by monitor type and category. Define SMEDL_MEMSTATS to
+ * enable it. Otherwise, the SMEDL_MALLOC() family below are plain malloc(),
+ * calloc(), realloc() and free() and nothing is counted.
+ *
+ * Each allocation site names the account (a monitor type, or
+ * smedl_mem_shared for memory not owned by one) and the category its blocks
+ * are counted in. Blocks are counted at their usable size
+ * (malloc_usable_size()), which includes the allocator's rounding, so the
+ * C library must be glibc or musl.
+ *
+ * Strings, opaques and SMEDLValue arrays carried by events or held in state
+ * variables are not counted, nor are the adapters' buffers. heap_bytes (the
+ * heap in use, where glibc's mallinfo2() is available, otherwise null) shows
+ * how much memory that leaves out.
+ *
+ * The report is printed to stderr as one line of JSON at exit, and is the
+ * "memory" member of each telemetry line (see telemetry.h) when that is
+ * enabled too:
+ * {"memory": {"heap_bytes": 9120000, "counted_bytes": 8810000,
+ *     "live": 81000, "bytes_per_monitor": 108.77, "accounts": {
+ *         "<monitor>": {"live": 812, "bytes": 88000,
+ *             "bytes_per_monitor": 108.37, "categories": {
+ *                 "monitors": {"bytes": 64960, "blocks": 812},
+ *                 ...
+ *             }},
+ *         ...
+ *         "shared": {...}
+ * }}}
+ * live is the number of monitor structs. bytes_per_monitor is all the bytes
+ * counted for a monitor type (or for all of them, including shared) over its
+ * live monitors, or null if there are none. Only categories with blocks are
+ * listed. */
+
+/* What the blocks are for */
+typedef enum {
+    SMEDL_MEM_MONITOR,      /* Monitor structs */
+    SMEDL_MEM_CALLBACKS,    /* Callback tables of individual monitors */
+    SMEDL_MEM_STORE,        /* Columnar state stores */
+    SMEDL_MEM_IDENTITY,     /* Identity strings owned by monitors */
+    SMEDL_MEM_MAP_TABLE,    /* MonitorList tables of monitor maps */
+    SMEDL_MEM_MAP_INSTANCE, /* MonitorInstance nodes */
+    SMEDL_MEM_EVENT,        /* SMEDLEvent blocks */
+    SMEDL_MEM_QUEUE,        /* Event queue nodes */
+    SMEDL_MEM_RESTORED,     /* Block holding restored monitors (see
+                               snapshot.h). They are not counted as live. */
+    SMEDL_MEM_CATEGORIES
+} SMEDLMemCategory;
+
+/* Blocks counted for a monitor type (or for smedl_mem_shared) */
+typedef struct SMEDLMemAccount {
+    const char *name;
+    size_t bytes[SMEDL_MEM_CATEGORIES];
+    size_t blocks[SMEDL_MEM_CATEGORIES];
+    /* Next account in the report */
+    struct SMEDLMemAccount *next;
+    int registered;
+} SMEDLMemAccount;
+
+/* Account for memory not owned by any monitor type */
+extern SMEDLMemAccount smedl_mem_shared;
+
+/* Print the report to stderr at exit. Return nonzero on success, zero on
+ * failure. */
+int smedl_mem_init(void);
+
+/* Add an account to the report. Does nothing if it is already there. */
+void smedl_mem_register(SMEDLMemAccount *account);
+
+/* Allocate and free blocks like the standard functions, counting them in the
+ * account and category. A block must be freed with the same account and
+ * category it was allocated with. */
+void * smedl_mem_malloc(SMEDLMemAccount *account, SMEDLMemCategory category,
+        size_t size);
+void * smedl_mem_calloc(SMEDLMemAccount *account, SMEDLMemCategory category,
+        size_t n, size_t size);
+void * smedl_mem_realloc(SMEDLMemAccount *account, SMEDLMemCategory category,
+        void *ptr, size_t size);
+void smedl_mem_free(SMEDLMemAccount *account, SMEDLMemCategory category,
+        void *ptr);
+
+/* Count a block allocated elsewhere (such as by smedl_assign_string()) in
+ * the account and category. It must then be freed with smedl_mem_free(). */
+void smedl_mem_adopt(SMEDLMemAccount *account, SMEDLMemCategory category,
+        void *ptr);
+
+/* Print the report as a JSON object (without the "memory" key) */
+void smedl_mem_write(FILE *f);
+
+#ifdef SMEDL_MEMSTATS
+#define SMEDL_MALLOC(account, category, size) \
+    smedl_mem_malloc(account, category, size)
+#define SMEDL_CALLOC(account, category, n, size) \
+    smedl_mem_calloc(account, category, n, size)
+#define SMEDL_REALLOC(account, category, ptr, size) \
+    smedl_mem_realloc(account, category, ptr, size)
+#define SMEDL_FREE(account, category, ptr) \
+    smedl_mem_free(account, category, ptr)
+#define SMEDL_MEM_ADOPT(account, category, ptr) \
+    smedl_mem_adopt(account, category, ptr)
+#define SMEDL_MEM_REGISTER(account) smedl_mem_register(account)
+#else
+#define SMEDL_MALLOC(account, category, size) malloc(size)
+#define SMEDL_CALLOC(account, category, n, size) calloc(n, size)
+#define SMEDL_REALLOC(account, category, ptr, size) realloc(ptr, size)
+#define SMEDL_FREE(account, category, ptr) free(ptr)
+#define SMEDL_MEM_ADOPT(account, category, ptr) ((void) 0)
+#define SMEDL_MEM_REGISTER(account) ((void) 0)
+#endif
+
+#endif /* MEMSTATS_H */
@@ -0,0 +1,479 @@
+#define _GNU_SOURCE
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include "monitor_map.h"
+#include "memstats.h"
+#include "snapshot.h"
+
+/* Alignment of everything allocated from the restore block */
+#define RESTORE_ALIGN 16
+
+#define ALIGN_UP(n, a) (((n) + (a) - 1) & ~((size_t) (a) - 1))
+
+/* Writing */
+
+static void put(SMEDLSnapshotWriter *w, const void *data, size_t size) {
+    if (fwrite(data, 1, size, w->f) != size) {
+        w->error = 1;
+    }
+    w->record_bytes += size;
+}
+
+/* Pad the file with zeros to an 8-byte boundary */
+static void pad(SMEDLSnapshotWriter *w) {
+    static const char zeros[8];
+    long pos = ftell(w->f);
+    if (pos < 0) {
+        w->error = 1;
+    } else if (pos % 8 != 0 &&
+            fwrite(zeros, 1, 8 - pos % 8, w->f) != 8 - (size_t) pos % 8) {
+        w->error = 1;
+    }
+}
+
+/* Write data at the given file position, then go back to the end */
+static void patch(SMEDLSnapshotWriter *w, long pos, const void *data,
+        size_t size) {
+    long end = ftell(w->f);
+    if (end < 0 || fseek(w->f, pos, SEEK_SET) ||
+            fwrite(data, 1, size, w->f) != size ||
+            fseek(w->f, end, SEEK_SET)) {
+        w->error = 1;
+    }
+}
+
+int smedl_snapshot_create(SMEDLSnapshotWriter *w, const char *path,
+        uint64_t offset, uint64_t msg_count) {
+    memset(w, 0, sizeof(*w));
+    memcpy(w->header.magic, SMEDL_SNAPSHOT_MAGIC, sizeof(w->header.magic));
+    w->header.version = SMEDL_SNAPSHOT_VERSION;
+    w->header.offset = offset;
+    w->header.msg_count = msg_count;
+    w->f = fopen(path, "wb");
+    if (w->f == NULL) {
+        w->error = 1;
+        return 0;
+    }
+    /* Completed by smedl_snapshot_finish() */
+    if (fwrite(&w->header, sizeof(w->header), 1, w->f) != 1) {
+        w->error = 1;
+    }
+    return !w->error;
+}
+
+void smedl_snapshot_begin(SMEDLSnapshotWriter *w, const char *name,
+        size_t record_size, uint64_t count, uint64_t dynamic,
+        uint64_t created, uint64_t recycled) {
+    pad(w);
+    w->section_pos = ftell(w->f);
+    memset(&w->section, 0, sizeof(w->section));
+    strncpy(w->section.name, name, sizeof(w->section.name) - 1);
+    w->section.count = count;
+    w->section.record_size = record_size;
+    w->section.dynamic = dynamic;
+    w->section.created = created;
+    w->section.recycled = recycled;
+    /* strings_size is filled in by smedl_snapshot_end() */
+    if (fwrite(&w->section, sizeof(w->section), 1, w->f) != 1) {
+        w->error = 1;
+    }
+    w->record_bytes = 0;
+    w->strings_len = 0;
+}
+
+void smedl_snapshot_put_int(SMEDLSnapshotWriter *w, int value) {
+    int32_t v = value;
+    put(w, &v, SMEDL_SNAPSHOT_INT);
+}
+
+void smedl_snapshot_put_float(SMEDLSnapshotWriter *w, double value) {
+    put(w, &value, SMEDL_SNAPSHOT_FLOAT);
+}
+
+void smedl_snapshot_put_pointer(SMEDLSnapshotWriter *w, void *value) {
+    uint64_t v = (uintptr_t) value;
+    put(w, &v, SMEDL_SNAPSHOT_POINTER);
+}
+
+void smedl_snapshot_put_string(SMEDLSnapshotWriter *w, const char *value) {
+    size_t len = strlen(value) + 1;
+    if (w->strings_len + len > w->strings_size) {
+        size_t new_size = w->strings_size ? w->strings_size : 4096;
+        while (w->strings_len + len > new_size) {
+            new_size *= 2;
+        }
+        char *tmp = realloc(w->strings, new_size);
+        if (tmp == NULL) {
+            w->error = 1;
+            return;
+        }
+        w->strings = tmp;
+        w->strings_size = new_size;
+    }
+    uint64_t v = w->strings_len;
+    memcpy(w->strings + w->strings_len, value, len);
+    w->strings_len += len;
+    put(w, &v, SMEDL_SNAPSHOT_STRING);
+}
+
+void smedl_snapshot_put_state(SMEDLSnapshotWriter *w, unsigned int value) {
+    unsigned char v = value;
+    put(w, &v, SMEDL_SNAPSHOT_STATE);
+}
+
+int smedl_snapshot_end(SMEDLSnapshotWriter *w) {
+    if (w->record_bytes != w->section.count * w->section.record_size) {
+        w->error = 1;
+    }
+    if (w->strings_len > 0 &&
+            fwrite(w->strings, 1, w->strings_len, w->f) != w->strings_len) {
+        w->error = 1;
+    }
+    w->section.strings_size = w->strings_len;
+    patch(w, w->section_pos, &w->section, sizeof(w->section));
+    w->header.sections++;
+    return !w->error;
+}
+
+int smedl_snapshot_finish(SMEDLSnapshotWriter *w) {
+    free(w->strings);
+    w->strings = NULL;
+    if (w->f == NULL) {
+        return 0;
+    }
+    pad(w);
+    long size = ftell(w->f);
+    if (size < 0) {
+        w->error = 1;
+    }
+    w->header.size = size;
+    patch(w, 0, &w->header, sizeof(w->header));
+    if (fflush(w->f) || fsync(fileno(w->f))) {
+        w->error = 1;
+    }
+    if (fclose(w->f)) {
+        w->error = 1;
+    }
+    w->f = NULL;
+    return !w->error;
+}
+
+int smedl_snapshot_save(const char *path, uint64_t offset, uint64_t msg_count,
+        int (*write_monitors)(SMEDLSnapshotWriter *w)) {
+    size_t len = strlen(path);
+    char *tmp_path = malloc(len + sizeof(".tmp"));
+    if (tmp_path == NULL) {
+        return 0;
+    }
+    memcpy(tmp_path, path, len);
+    memcpy(tmp_path + len, ".tmp", sizeof(".tmp"));
+
+    SMEDLSnapshotWriter w;
+    int success = smedl_snapshot_create(&w, tmp_path, offset, msg_count);
+    success = success && write_monitors(&w);
+    success = smedl_snapshot_finish(&w) && success;
+    success = success && rename(tmp_path, path) == 0;
+    if (!success) {
+        unlink(tmp_path);
+    }
+    free(tmp_path);
+    return success;
+}
+
+/* Child writing a snapshot in the background, or 0 */
+static pid_t snapshot_child;
+
+/* A snapshot written in the background failed */
+static int snapshot_failed;
+
+/* Collect the child writing a snapshot if it has exited, or wait for it to if
+ * block is nonzero */
+static void reap(int block) {
+    if (snapshot_child == 0) {
+        return;
+    }
+    int status;
+    pid_t pid;
+    do {
+        pid = waitpid(snapshot_child, &status, block ? 0 : WNOHANG);
+    } while (pid < 0 && errno == EINTR);
+    if (pid == 0) {
+        /* Still running */
+        return;
+    }
+    if (pid < 0 || !WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+        snapshot_failed = 1;
+    }
+    snapshot_child = 0;
+}
+
+int smedl_snapshot_fork(const char *path, uint64_t offset, uint64_t msg_count,
+        int (*write_monitors)(SMEDLSnapshotWriter *w)) {
+    reap(0);
+    if (snapshot_child != 0) {
+        return 1;
+    }
+
+    pid_t pid = fork();
+    if (pid < 0) {
+        return 0;
+    } else if (pid == 0) {
+        /* _exit() so the parent's atexit() handlers (reports) are not run */
+        _exit(smedl_snapshot_save(path, offset, msg_count, write_monitors) ?
+                0 : 1);
+    }
+    snapshot_child = pid;
+    return 1;
+}
+
+int smedl_snapshot_wait(void) {
+    reap(1);
+    return !snapshot_failed;
+}
+
+/* Restoring */
+
+int smedl_restoring;
+uintptr_t smedl_restored_base;
+size_t smedl_restored_size;
+
+/* Room reserved with smedl_restore_reserve() */
+static size_t restore_reserved;
+
+/* The restore block and the bytes allocated from it */
+static char *restore_block;
+static size_t restore_used;
+
+int smedl_snapshot_open(SMEDLSnapshot *s, const char *path) {
+    memset(s, 0, sizeof(*s));
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return 0;
+    }
+    struct stat st;
+    if (fstat(fd, &st) || (size_t) st.st_size < sizeof(SMEDLSnapshotHeader)) {
+        close(fd);
+        return 0;
+    }
+    void *data = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) {
+        return 0;
+    }
+    s->data = data;
+    s->size = st.st_size;
+
+    SMEDLSnapshotHeader header;
+    memcpy(&header, s->data, sizeof(header));
+    if (memcmp(header.magic, SMEDL_SNAPSHOT_MAGIC, sizeof(header.magic)) ||
+            header.version != SMEDL_SNAPSHOT_VERSION ||
+            header.size != s->size) {
+        goto fail;
+    }
+    s->offset = header.offset;
+    s->msg_count = header.msg_count;
+
+    /* Check that every section lies within the file, so the rest of the
+     * restore only has to check fields against their section */
+    size_t pos = sizeof(header);
+    for (uint32_t i = 0; i < header.sections; i++) {
+        pos = ALIGN_UP(pos, 8);
+        if (s->size - pos < sizeof(SMEDLSnapshotSection)) {
+            goto fail;
+        }
+        SMEDLSnapshotSection section;
+        memcpy(&section, s->data + pos, sizeof(section));
+        pos += sizeof(section);
+        if (memchr(section.name, '\0', sizeof(section.name)) == NULL) {
+            goto fail;
+        }
+        if (section.record_size == 0 ? section.count > 1 :
+                section.count > (s->size - pos) / section.record_size) {
+            goto fail;
+        }
+        pos += section.count * section.record_size;
+        if (section.strings_size > s->size - pos) {
+            goto fail;
+        }
+        pos += section.strings_size;
+        /* Every string ends within the section */
+        if (section.strings_size > 0 && s->data[pos - 1] != '\0') {
+            goto fail;
+        }
+    }
+    if (ALIGN_UP(pos, 8) != s->size) {
+        goto fail;
+    }
+    return 1;
+
+fail:
+    smedl_snapshot_close(s);
+    return 0;
+}
+
+void smedl_snapshot_close(SMEDLSnapshot *s) {
+    if (s->data != NULL) {
+        munmap((void *) s->data, s->size);
+        s->data = NULL;
+    }
+}
+
+/* Find the section for a monitor type. Return a pointer to its header, or NULL
+ * if there is none or its records are not record_size bytes. */
+static const unsigned char * find_section(SMEDLSnapshot *s, const char *name,
+        size_t record_size, SMEDLSnapshotSection *section) {
+    SMEDLSnapshotHeader header;
+    memcpy(&header, s->data, sizeof(header));
+    size_t pos = sizeof(header);
+    for (uint32_t i = 0; i < header.sections; i++) {
+        pos = ALIGN_UP(pos, 8);
+        memcpy(section, s->data + pos, sizeof(*section));
+        if (!strcmp(section->name, name)) {
+            if (section->record_size != record_size) {
+                return NULL;
+            }
+            return s->data + pos;
+        }
+        pos += sizeof(*section) + section->count * section->record_size +
+            section->strings_size;
+    }
+    return NULL;
+}
+
+int smedl_restore_reserve(SMEDLSnapshot *s, const char *name,
+        size_t record_size, size_t monitor_size, size_t maps) {
+    SMEDLSnapshotSection section;
+    if (find_section(s, name, record_size, &section) == NULL) {
+        return 0;
+    }
+    size_t per_monitor = 0;
+    if (monitor_size > 0) {
+        per_monitor = ALIGN_UP(monitor_size, RESTORE_ALIGN) +
+            maps * ALIGN_UP(sizeof(MonitorInstance), RESTORE_ALIGN);
+    }
+    restore_reserved += section.count * per_monitor +
+        ALIGN_UP(section.strings_size, RESTORE_ALIGN);
+    return 1;
+}
+
+int smedl_restore_begin(void) {
+    if (restore_block != NULL) {
+        /* Only one snapshot can be restored */
+        return 0;
+    }
+    if (restore_reserved > 0) {
+        restore_block = SMEDL_MALLOC(&smedl_mem_shared, SMEDL_MEM_RESTORED,
+                restore_reserved);
+        if (restore_block == NULL) {
+            return 0;
+        }
+    }
+    restore_used = 0;
+    smedl_restored_base = (uintptr_t) restore_block;
+    smedl_restored_size = restore_reserved;
+    smedl_restoring = 1;
+    return 1;
+}
+
+const SMEDLSnapshotSection * smedl_snapshot_section(SMEDLSnapshot *s,
+        const char *name, size_t record_size) {
+    static SMEDLSnapshotSection section;
+    const unsigned char *p = find_section(s, name, record_size, &section);
+    if (p == NULL) {
+        return NULL;
+    }
+    s->pos = p + sizeof(section);
+    s->end = s->pos + section.count * section.record_size;
+    s->strings = NULL;
+    s->strings_size = section.strings_size;
+    if (section.strings_size > 0) {
+        char *strings = smedl_restore_alloc(section.strings_size);
+        if (strings == NULL) {
+            return NULL;
+        }
+        memcpy(strings, s->end, section.strings_size);
+        s->strings = strings;
+    }
+    return &section;
+}
+
+/* Copy the next size bytes of the current record to dest. Zero them and flag
+ * an error if they run past the section's records. */
+static void get(SMEDLSnapshot *s, void *dest, size_t size) {
+    if ((size_t) (s->end - s->pos) < size) {
+        s->error = 1;
+        memset(dest, 0, size);
+        return;
+    }
+    memcpy(dest, s->pos, size);
+    s->pos += size;
+}
+
+int smedl_snapshot_get_int(SMEDLSnapshot *s) {
+    int32_t v;
+    get(s, &v, SMEDL_SNAPSHOT_INT);
+    return v;
+}
+
+double smedl_snapshot_get_float(SMEDLSnapshot *s) {
+    double v;
+    get(s, &v, SMEDL_SNAPSHOT_FLOAT);
+    return v;
+}
+
+void * smedl_snapshot_get_pointer(SMEDLSnapshot *s) {
+    uint64_t v;
+    get(s, &v, SMEDL_SNAPSHOT_POINTER);
+    return (void *) (uintptr_t) v;
+}
+
+char * smedl_snapshot_get_string(SMEDLSnapshot *s) {
+    static char empty[1];
+    uint64_t v;
+    get(s, &v, SMEDL_SNAPSHOT_STRING);
+    if (v >= s->strings_size) {
+        s->error = 1;
+        return empty;
+    }
+    return (char *) s->strings + v;
+}
+
+unsigned int smedl_snapshot_get_state(SMEDLSnapshot *s) {
+    unsigned char v;
+    get(s, &v, SMEDL_SNAPSHOT_STATE);
+    return v;
+}
+
+void * smedl_restore_alloc(size_t size) {
+    size = ALIGN_UP(size, RESTORE_ALIGN);
+    if (size > restore_reserved - restore_used) {
+        return NULL;
+    }
+    void *ptr = restore_block + restore_used;
+    restore_used += size;
+    return ptr;
+}
+
+void smedl_restore_end(void) {
+    smedl_restoring = 0;
+}
+
+void smedl_restore_free(void) {
+    SMEDL_FREE(&smedl_mem_shared, SMEDL_MEM_RESTORED, restore_block);
+    restore_block = NULL;
+    restore_reserved = 0;
+    restore_used = 0;
+    smedl_restored_base = 0;
+    smedl_restored_size = 0;
+}
+
+/* Arena */
+
+SMEDLArena *smedl_arena;
@@ -0,0 +1,649 @@
+#define _GNU_SOURCE
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <errno.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <linux/io_uring.h>
+#ifdef SMEDL_GZIP
+#include <zlib.h>
+#endif
+#ifdef SMEDL_ZSTD
+#include <zstd.h>
+#endif
+#include "trace_reader.h"
+
+#define BUF_ALIGN 4096
+
+/* io_uring */
+
+#ifndef SMEDL_NO_IO_URING
+
+/* Map the rings of a new io_uring with room for one read per buffer. Return
+ * nonzero on success, zero if io_uring is not available. */
+static int uring_setup(SMEDLUring *ring) {
+    struct io_uring_params p;
+    memset(&p, 0, sizeof(p));
+    ring->fd = syscall(__NR_io_uring_setup, SMEDL_READ_BUFFERS, &p);
+    if (ring->fd < 0) {
+        return 0;
+    }
+
+    ring->sq_ring_size = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+    ring->cq_ring_size = p.cq_off.cqes +
+        p.cq_entries * sizeof(struct io_uring_cqe);
+    if (p.features & IORING_FEAT_SINGLE_MMAP) {
+        /* Both rings are in one mapping */
+        if (ring->cq_ring_size > ring->sq_ring_size) {
+            ring->sq_ring_size = ring->cq_ring_size;
+        }
+        ring->cq_ring_size = ring->sq_ring_size;
+    }
+    ring->sq_ring = mmap(NULL, ring->sq_ring_size, PROT_READ | PROT_WRITE,
+            MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_SQ_RING);
+    if (ring->sq_ring == MAP_FAILED) {
+        goto fail_sq;
+    }
+    if (p.features & IORING_FEAT_SINGLE_MMAP) {
+        ring->cq_ring = ring->sq_ring;
+    } else {
+        ring->cq_ring = mmap(NULL, ring->cq_ring_size, PROT_READ | PROT_WRITE,
+                MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_CQ_RING);
+        if (ring->cq_ring == MAP_FAILED) {
+            goto fail_cq;
+        }
+    }
+    ring->sqes_size = p.sq_entries * sizeof(struct io_uring_sqe);
+    ring->sqes = mmap(NULL, ring->sqes_size, PROT_READ | PROT_WRITE,
+            MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_SQES);
+    if (ring->sqes == MAP_FAILED) {
+        goto fail_sqes;
+    }
+
+    char *sq = ring->sq_ring;
+    ring->sq_head = (unsigned *) (sq + p.sq_off.head);
+    ring->sq_tail = (unsigned *) (sq + p.sq_off.tail);
+    ring->sq_mask = (unsigned *) (sq + p.sq_off.ring_mask);
+    ring->sq_array = (unsigned *) (sq + p.sq_off.array);
+    char *cq = ring->cq_ring;
+    ring->cq_head = (unsigned *) (cq + p.cq_off.head);
+    ring->cq_tail = (unsigned *) (cq + p.cq_off.tail);
+    ring->cq_mask = (unsigned *) (cq + p.cq_off.ring_mask);
+    ring->cqes = (struct io_uring_cqe *) (cq + p.cq_off.cqes);
+    return 1;
+
+fail_sqes:
+    if (ring->cq_ring != ring->sq_ring) {
+        munmap(ring->cq_ring, ring->cq_ring_size);
+    }
+fail_cq:
+    munmap(ring->sq_ring, ring->sq_ring_size);
+fail_sq:
+    close(ring->fd);
+    return 0;
+}
+
+static void uring_free(SMEDLUring *ring) {
+    munmap(ring->sqes, ring->sqes_size);
+    if (ring->cq_ring != ring->sq_ring) {
+        munmap(ring->cq_ring, ring->cq_ring_size);
+    }
+    munmap(ring->sq_ring, ring->sq_ring_size);
+    close(ring->fd);
+}
+
+/* Queue a read for the rest of the buffer and submit it. Return nonzero on
+ * success, zero on failure. */
+static int uring_read(SMEDLTraceReader *r, SMEDLReadBuf *b) {
+    SMEDLUring *ring = &r->ring;
+    unsigned tail = *ring->sq_tail;
+    unsigned index = tail & *ring->sq_mask;
+    struct io_uring_sqe *sqe = &ring->sqes[index];
+    memset(sqe, 0, sizeof(*sqe));
+    sqe->opcode = IORING_OP_READ;
+    sqe->fd = r->fd;
+    sqe->addr = (uintptr_t) (b->data + b->len);
+    sqe->len = SMEDL_READ_BUFFER_SIZE - b->len;
+    sqe->off = b->offset + b->len;
+    sqe->user_data = b - r->buf;
+    ring->sq_array[index] = index;
+    __atomic_store_n(ring->sq_tail, tail + 1, __ATOMIC_RELEASE);
+
+    b->state = SMEDL_BUF_READING;
+    while (syscall(__NR_io_uring_enter, ring->fd, 1, 0, 0, NULL, 0) < 0) {
+        if (errno != EINTR && errno != EAGAIN) {
+            b->state = SMEDL_BUF_FULL;
+            b->failed = 1;
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/* Start reading into a free buffer at the next file offset, unless the end of
+ * the file has been reached */
+static void uring_refill(SMEDLTraceReader *r, SMEDLReadBuf *b) {
+    b->len = 0;
+    b->failed = 0;
+    if (r->read_eof) {
+        /* Nothing left to read. Hand it out empty. */
+        b->state = SMEDL_BUF_FULL;
+        return;
+    }
+    b->offset = r->next_offset;
+    r->next_offset += SMEDL_READ_BUFFER_SIZE;
+    uring_read(r, b);
+}
+
+/* Wait for at least one read to complete and process every completion.
+ * Return nonzero on success, zero on failure. */
+static int uring_reap(SMEDLTraceReader *r) {
+    SMEDLUring *ring = &r->ring;
+    unsigned head = *ring->cq_head;
+    if (head == __atomic_load_n(ring->cq_tail, __ATOMIC_ACQUIRE)) {
+        if (syscall(__NR_io_uring_enter, ring->fd, 0, 1,
+                    IORING_ENTER_GETEVENTS, NULL, 0) < 0 && errno != EINTR) {
+            return 0;
+        }
+    }
+
+    while (head != __atomic_load_n(ring->cq_tail, __ATOMIC_ACQUIRE)) {
+        struct io_uring_cqe *cqe = &ring->cqes[head & *ring->cq_mask];
+        SMEDLReadBuf *b = &r->buf[cqe->user_data];
+        int res = cqe->res;
+        head++;
+        __atomic_store_n(ring->cq_head, head, __ATOMIC_RELEASE);
+
+        if (res == -EINTR || res == -EAGAIN) {
+            uring_read(r, b);
+        } else if (res < 0) {
+            b->failed = 1;
+            b->state = SMEDL_BUF_FULL;
+        } else if (res == 0) {
+            r->read_eof = 1;
+            b->state = SMEDL_BUF_FULL;
+        } else {
+            b->len += res;
+            if (b->len < SMEDL_READ_BUFFER_SIZE) {
+                /* Short read. Get the rest, or find the end of the file. */
+                uring_read(r, b);
+            } else {
+                b->state = SMEDL_BUF_FULL;
+            }
+        }
+    }
+    return 1;
+}
+
+#endif /* SMEDL_NO_IO_URING */
+
+/* Reader thread */
+
+/* Read up to len bytes of raw input, starting with any bytes that were read to
+ * detect the format. Return the number read, 0 at the end of the input, or -1
+ * on failure. */
+static ssize_t source_read(SMEDLTraceReader *r, char *dst, size_t len) {
+    if (r->head_pos < r->head_len) {
+        size_t n = r->head_len - r->head_pos;
+        if (n > len) {
+            n = len;
+        }
+        memcpy(dst, r->head + r->head_pos, n);
+        r->head_pos += n;
+        return n;
+    }
+
+    for (;;) {
+        /* Only a blocking read may be cancelled (see smedl_reader_close()) */
+        pthread_setcancelstate(PTHREAD_CANCEL_ENABLE, NULL);
+        ssize_t n = read(r->fd, dst, len);
+        pthread_setcancelstate(PTHREAD_CANCEL_DISABLE, NULL);
+        if (n >= 0 || errno != EINTR) {
+            return n;
+        }
+    }
+}
+
+#if defined(SMEDL_GZIP) || defined(SMEDL_ZSTD)
+/* Make sure there is compressed input left to decompress. Return nonzero if
+ * there is, zero at the end of the input or on failure (with *failed set). */
+static int refill_input(SMEDLTraceReader *r, int *failed) {
+    if (r->in_pos < r->in_len) {
+        return 1;
+    }
+    ssize_t n = source_read(r, r->in, SMEDL_COMPRESSED_BUFFER_SIZE);
+    if (n <= 0) {
+        /* A stream cut off in the middle is an error too */
+        if (n < 0 || r->in_frame) {
+            *failed = 1;
+        }
+        return 0;
+    }
+    r->in_len = n;
+    r->in_pos = 0;
+    return 1;
+}
+#endif
+
+#ifdef SMEDL_GZIP
+/* Decompress gzip input into dst until it is full. Concatenated gzip members
+ * are read as one stream, like gunzip does. */
+static size_t gzip_fill(SMEDLTraceReader *r, char *dst, int *failed) {
+    z_stream *zs = r->codec;
+    zs->next_out = (unsigned char *) dst;
+    zs->avail_out = SMEDL_READ_BUFFER_SIZE;
+    while (zs->avail_out > 0 && refill_input(r, failed)) {
+        zs->next_in = (unsigned char *) r->in + r->in_pos;
+        zs->avail_in = r->in_len - r->in_pos;
+        r->in_frame = 1;
+        int result = inflate(zs, Z_NO_FLUSH);
+        r->in_pos = r->in_len - zs->avail_in;
+        if (result == Z_STREAM_END) {
+            r->in_frame = 0;
+            inflateReset(zs);
+        } else if (result != Z_OK && result != Z_BUF_ERROR) {
+            *failed = 1;
+            break;
+        }
+    }
+    return SMEDL_READ_BUFFER_SIZE - zs->avail_out;
+}
+#endif
+
+#ifdef SMEDL_ZSTD
+/* Decompress zstd input into dst until it is full */
+static size_t zstd_fill(SMEDLTraceReader *r, char *dst, int *failed) {
+    ZSTD_outBuffer out = {dst, SMEDL_READ_BUFFER_SIZE, 0};
+    while (out.pos < out.size && refill_input(r, failed)) {
+        ZSTD_inBuffer in = {r->in, r->in_len, r->in_pos};
+        size_t result = ZSTD_decompressStream(r->codec, &out, &in);
+        r->in_pos = in.pos;
+        if (ZSTD_isError(result)) {
+            *failed = 1;
+            break;
+        }
+        /* 0 means a frame was finished and completely flushed */
+        r->in_frame = result != 0;
+    }
+    return out.pos;
+}
+#endif
+
+/* Fill a buffer from the input. Return its length, which is less than the
+ * buffer size only at the end of the input or on failure (with *failed set). */
+static size_t fill_buffer(SMEDLTraceReader *r, char *dst, int *failed) {
+    switch (r->format) {
+#ifdef SMEDL_GZIP
+        case SMEDL_TRACE_GZIP:
+            return gzip_fill(r, dst, failed);
+#endif
+#ifdef SMEDL_ZSTD
+        case SMEDL_TRACE_ZSTD:
+            return zstd_fill(r, dst, failed);
+#endif
+        default:
+            break;
+    }
+
+    size_t len = 0;
+    while (len < SMEDL_READ_BUFFER_SIZE) {
+        ssize_t n = source_read(r, dst + len, SMEDL_READ_BUFFER_SIZE - len);
+        if (n > 0) {
+            len += n;
+        } else {
+            *failed = n < 0;
+            break;
+        }
+    }
+    return len;
+}
+
+/* Fill the buffers in order until the end of the input or stopped */
+static void * reader_thread(void *arg) {
+    SMEDLTraceReader *r = arg;
+    size_t i = 0;
+
+    pthread_setcancelstate(PTHREAD_CANCEL_DISABLE, NULL);
+    pthread_mutex_lock(&r->lock);
+    for (;;) {
+        SMEDLReadBuf *b = &r->buf[i];
+        while (!r->stopping && b->state != SMEDL_BUF_FREE) {
+            pthread_cond_wait(&r->cond, &r->lock);
+        }
+        if (r->stopping) {
+            break;
+        }
+        b->state = SMEDL_BUF_READING;
+        pthread_mutex_unlock(&r->lock);
+
+        int failed = 0;
+        size_t len = fill_buffer(r, b->data, &failed);
+
+        pthread_mutex_lock(&r->lock);
+        b->len = len;
+        b->failed = failed;
+        b->state = SMEDL_BUF_FULL;
+        pthread_cond_broadcast(&r->cond);
+        if (len < SMEDL_READ_BUFFER_SIZE) {
+            /* End of the input (or a failure) */
+            break;
+        }
+        i = (i + 1) % SMEDL_READ_BUFFERS;
+    }
+    r->thread_done = 1;
+    pthread_mutex_unlock(&r->lock);
+    return NULL;
+}
+
+/* Peek at the first bytes of the input to see if it is compressed. Bytes
+ * read from a file that cannot be rewound are kept in r->head. */
+static void detect_format(SMEDLTraceReader *r, int seekable) {
+    static const unsigned char gzip_magic[] = {0x1f, 0x8b};
+    static const unsigned char zstd_magic[] = {0x28, 0xb5, 0x2f, 0xfd};
+    unsigned char *head = r->head;
+    size_t len = 0;
+
+    if (seekable) {
+        off_t pos = lseek(r->fd, 0, SEEK_CUR);
+        ssize_t n = pread(r->fd, head, sizeof(r->head), pos > 0 ? pos : 0);
+        len = n > 0 ? n : 0;
+    } else {
+        while (len < sizeof(r->head)) {
+            ssize_t n = read(r->fd, head + len, sizeof(r->head) - len);
+            if (n > 0) {
+                len += n;
+            } else if (n == 0 || errno != EINTR) {
+                /* Errors are reported when the reader thread reads */
+                break;
+            }
+        }
+        r->head_len = len;
+    }
+
+    if (len >= sizeof(gzip_magic) &&
+            memcmp(head, gzip_magic, sizeof(gzip_magic)) == 0) {
+        r->format = SMEDL_TRACE_GZIP;
+    } else if (len >= sizeof(zstd_magic) &&
+            memcmp(head, zstd_magic, sizeof(zstd_magic)) == 0) {
+        r->format = SMEDL_TRACE_ZSTD;
+    } else {
+        r->format = SMEDL_TRACE_PLAIN;
+    }
+}
+
+/* Free the decompressor, if any */
+static void codec_free(SMEDLTraceReader *r) {
+    switch (r->format) {
+#ifdef SMEDL_GZIP
+        case SMEDL_TRACE_GZIP:
+            inflateEnd(r->codec);
+            free(r->codec);
+            break;
+#endif
+#ifdef SMEDL_ZSTD
+        case SMEDL_TRACE_ZSTD:
+            ZSTD_freeDStream(r->codec);
+            break;
+#endif
+        default:
+            break;
+    }
+    free(r->in);
+    r->codec = NULL;
+    r->in = NULL;
+}
+
+/* Create the decompressor for r->format, if any. Return nonzero on success,
+ * zero on failure (with r->unsupported set if it was not compiled in). */
+static int codec_init(SMEDLTraceReader *r) {
+    r->codec = NULL;
+    r->in = NULL;
+    r->in_len = 0;
+    r->in_pos = 0;
+    r->in_frame = 0;
+    switch (r->format) {
+        case SMEDL_TRACE_PLAIN:
+            return 1;
+#ifdef SMEDL_GZIP
+        case SMEDL_TRACE_GZIP:
+            r->codec = calloc(1, sizeof(z_stream));
+            if (r->codec == NULL) {
+                return 0;
+            }
+            /* 15 + 16: Maximum window size, gzip header */
+            if (inflateInit2((z_stream *) r->codec, 15 + 16) != Z_OK) {
+                free(r->codec);
+                return 0;
+            }
+            break;
+#endif
+#ifdef SMEDL_ZSTD
+        case SMEDL_TRACE_ZSTD:
+            r->codec = ZSTD_createDStream();
+            if (r->codec == NULL) {
+                return 0;
+            }
+            break;
+#endif
+        default:
+            r->unsupported = 1;
+            return 0;
+    }
+
+    r->in = malloc(SMEDL_COMPRESSED_BUFFER_SIZE);
+    if (r->in == NULL) {
+        codec_free(r);
+        return 0;
+    }
+    return 1;
+}
+
+/* Start reading from fd, which the reader takes ownership of. Return nonzero
+ * on success, zero on failure (with r->unsupported set if the input is
+ * compressed in a format that was not compiled in). Cleanup with
+ * smedl_reader_close(). */
+int smedl_reader_open(SMEDLTraceReader *r, int fd) {
+    return smedl_reader_open_at(r, fd, 0);
+}
+
+/* Like smedl_reader_open(), but start offset bytes into the input */
+int smedl_reader_open_at(SMEDLTraceReader *r, int fd, unsigned long long offset) {
+    size_t i;
+    r->fd = fd;
+    r->next = 0;
+    r->cur = NULL;
+    r->eof = 0;
+    r->error = 0;
+    r->unsupported = 0;
+    r->head_len = 0;
+    r->head_pos = 0;
+    r->skip = 0;
+    r->use_uring = 0;
+    r->next_offset = 0;
+    r->read_eof = 0;
+    r->stopping = 0;
+    r->thread_done = 0;
+
+    for (i = 0; i < SMEDL_READ_BUFFERS; i++) {
+        void *data;
+        if (posix_memalign(&data, BUF_ALIGN, SMEDL_READ_BUFFER_SIZE)) {
+            goto fail_buf;
+        }
+        r->buf[i].data = data;
+        r->buf[i].len = 0;
+        r->buf[i].failed = 0;
+        r->buf[i].state = SMEDL_BUF_FREE;
+    }
+
+    /* Reads at explicit offsets only make sense for regular files */
+    struct stat st;
+    int regular = fstat(fd, &st) == 0 && S_ISREG(st.st_mode);
+    detect_format(r, regular);
+    if (!codec_init(r)) {
+        goto fail_buf;
+    }
+
+    /* Seek past the start of a plain file. Otherwise, the bytes before offset
+     * have to be read (and decompressed) to get past them. */
+    if (offset > 0) {
+        if (regular && r->format == SMEDL_TRACE_PLAIN &&
+                lseek(fd, offset, SEEK_CUR) >= 0) {
+            offset = 0;
+        }
+        r->skip = offset;
+    }
+
+#ifndef SMEDL_NO_IO_URING
+    /* Compressed input goes through the reader thread to be decompressed */
+    if (regular && r->format == SMEDL_TRACE_PLAIN && uring_setup(&r->ring)) {
+        /* Start where the file was left, in case it is a redirected stdin
+         * that was partly read */
+        off_t pos = lseek(fd, 0, SEEK_CUR);
+        r->next_offset = pos > 0 ? pos : 0;
+        r->use_uring = 1;
+        for (size_t j = 0; j < SMEDL_READ_BUFFERS; j++) {
+            uring_refill(r, &r->buf[j]);
+        }
+        return 1;
+    }
+#endif
+
+    if (pthread_mutex_init(&r->lock, NULL)) {
+        goto fail_codec;
+    }
+    if (pthread_cond_init(&r->cond, NULL)) {
+        goto fail_cond;
+    }
+    if (pthread_create(&r->thread, NULL, reader_thread, r)) {
+        goto fail_thread;
+    }
+    return 1;
+
+fail_thread:
+    pthread_cond_destroy(&r->cond);
+fail_cond:
+    pthread_mutex_destroy(&r->lock);
+fail_codec:
+    codec_free(r);
+fail_buf:
+    while (i-- > 0) {
+        free(r->buf[i].data);
+    }
+    close(fd);
+    return 0;
+}
+
+/* Give the previous buffer back and get the next one, waiting for it to be
+ * read if necessary. Return its length and point *data at it, or return 0 at
+ * the end of the input. */
+static size_t next_buffer(SMEDLTraceReader *r, const char **data) {
+    SMEDLReadBuf *b = &r->buf[r->next];
+
+    if (r->use_uring) {
+#ifndef SMEDL_NO_IO_URING
+        if (r->cur != NULL) {
+            uring_refill(r, r->cur);
+            r->cur = NULL;
+        }
+        if (r->eof || r->error) {
+            return 0;
+        }
+        while (b->state != SMEDL_BUF_FULL) {
+            if (!uring_reap(r)) {
+                r->error = 1;
+                return 0;
+            }
+        }
+        b->state = SMEDL_BUF_IN_USE;
+#endif
+    } else {
+        pthread_mutex_lock(&r->lock);
+        if (r->cur != NULL) {
+            r->cur->state = SMEDL_BUF_FREE;
+            r->cur = NULL;
+            pthread_cond_broadcast(&r->cond);
+        }
+        if (r->eof || r->error) {
+            pthread_mutex_unlock(&r->lock);
+            return 0;
+        }
+        while (b->state != SMEDL_BUF_FULL) {
+            pthread_cond_wait(&r->cond, &r->lock);
+        }
+        b->state = SMEDL_BUF_IN_USE;
+        pthread_mutex_unlock(&r->lock);
+    }
+
+    r->cur = b;
+    if (b->failed) {
+        r->error = 1;
+        return 0;
+    }
+    r->next = (r->next + 1) % SMEDL_READ_BUFFERS;
+    if (b->len < SMEDL_READ_BUFFER_SIZE) {
+        r->eof = 1;
+    }
+    *data = b->data;
+    return b->len;
+}
+
+/* Give the previous buffer back and get the next one, waiting for it to be
+ * read if necessary. Return its length and point *data at it, or return 0 at
+ * the end of the input. Check r->error to tell a read error from the end. The
+ * data stays valid until the next call. */
+size_t smedl_reader_next(SMEDLTraceReader *r, const char **data) {
+    size_t len = next_buffer(r, data);
+    /* Discard the input before the offset given to smedl_reader_open_at() */
+    while (r->skip > 0 && len > 0) {
+        if (len > r->skip) {
+            *data += r->skip;
+            len -= r->skip;
+            r->skip = 0;
+        } else {
+            r->skip -= len;
+            len = next_buffer(r, data);
+        }
+    }
+    return len;
+}
+
+/* Stop reading, free the buffers, and close the file. Return nonzero on
+ * success, zero if the file could not be closed. */
+int smedl_reader_close(SMEDLTraceReader *r) {
+    if (r->use_uring) {
+#ifndef SMEDL_NO_IO_URING
+        /* The kernel may still write into buffers with reads in flight */
+        for (size_t i = 0; i < SMEDL_READ_BUFFERS; i++) {
+            while (r->buf[i].state == SMEDL_BUF_READING) {
+                if (!uring_reap(r)) {
+                    break;
+                }
+            }
+        }
+        uring_free(&r->ring);
+#endif
+    } else {
+        pthread_mutex_lock(&r->lock);
+        r->stopping = 1;
+        pthread_cond_broadcast(&r->cond);
+        int done = r->thread_done;
+        pthread_mutex_unlock(&r->lock);
+        if (!done) {
+            /* It may be blocked reading a pipe that will never be closed */
+            pthread_cancel(r->thread);
+        }
+        pthread_join(r->thread, NULL);
+        pthread_cond_destroy(&r->cond);
+        pthread_mutex_destroy(&r->lock);
+        codec_free(r);
+    }
+
+    for (size_t i = 0; i < SMEDL_READ_BUFFERS; i++) {
+        free(r->buf[i].data);
+    }
+    return close(r->fd) == 0;
+}
@@ -0,0 +1,138 @@
+#ifndef TRACE_READER_H
+#define TRACE_READER_H
+
+#include <stddef.h>
+#include <pthread.h>
+
+/* Asynchronous sequential reader for trace files.
+ *
+ * The input is read into several large, page-aligned buffers that are kept in
+ * flight at once, so the disk works on the next buffers while the parser works
+ * on the current one. Completed buffers are handed out in file order. A buffer
+ * goes back to the disk as soon as the caller moves on to the next one.
+ *
+ * Regular files are read with io_uring, with a read queued for every free
+ * buffer at its own file offset. Anything else (pipes, terminals), or a kernel
+ * without io_uring, uses a thread that fills the buffers in order with read().
+ *
+ * gzip and zstd compressed input is recognized by its magic bytes and
+ * decompressed by the reader thread straight into the buffers, so
+ * decompression overlaps with parsing. Support for each is compiled in with
+ * SMEDL_GZIP (link with -lz) and SMEDL_ZSTD (link with -lzstd).
+ */
+
+/* Number of buffers */
+#ifndef SMEDL_READ_BUFFERS
+#define SMEDL_READ_BUFFERS 4
+#endif
+
+/* Size of each buffer in bytes. Must be a multiple of the page size. */
+#ifndef SMEDL_READ_BUFFER_SIZE
+#define SMEDL_READ_BUFFER_SIZE (1 << 20)
+#endif
+
+/* Define SMEDL_NO_IO_URING to always use the reader thread */
+
+/* Size of the buffer for compressed input */
+#ifndef SMEDL_COMPRESSED_BUFFER_SIZE
+#define SMEDL_COMPRESSED_BUFFER_SIZE (256 << 10)
+#endif
+
+typedef enum {
+    SMEDL_TRACE_PLAIN,
+    SMEDL_TRACE_GZIP,
+    SMEDL_TRACE_ZSTD
+} SMEDLTraceFormat;
+
+typedef enum {
+    SMEDL_BUF_FREE,     /* Waiting to be read into */
+    SMEDL_BUF_READING,  /* Read in progress */
+    SMEDL_BUF_FULL,     /* Read complete, waiting for the caller */
+    SMEDL_BUF_IN_USE    /* Handed out to the caller */
+} SMEDLBufState;
+
+typedef struct {
+    char *data;
+    size_t len;
+    SMEDLBufState state;
+    int failed;                 /* The read failed */
+    unsigned long long offset;  /* File offset of data[0] (io_uring only) */
+} SMEDLReadBuf;
+
+/* The io_uring submission and completion rings, mapped from the kernel */
+typedef struct {
+    int fd;
+    void *sq_ring;
+    size_t sq_ring_size;
+    void *cq_ring;
+    size_t cq_ring_size;
+    struct io_uring_sqe *sqes;
+    size_t sqes_size;
+    unsigned *sq_head, *sq_tail, *sq_mask, *sq_array;
+    unsigned *cq_head, *cq_tail, *cq_mask;
+    struct io_uring_cqe *cqes;
+} SMEDLUring;
+
+/* Reader state. Initialize with smedl_reader_open(). */
+typedef struct {
+    int fd;
+    int use_uring;
+    SMEDLReadBuf buf[SMEDL_READ_BUFFERS];
+    size_t next;        /* Index of the next buffer to hand out */
+    SMEDLReadBuf *cur;  /* Buffer handed out, or NULL */
+    int eof;            /* The end of the input has been handed out */
+    int error;          /* A read failed */
+    SMEDLTraceFormat format;
+    int unsupported;    /* Compressed in a format that was not compiled in */
+
+    /* Bytes read to detect the format from a file that cannot be rewound,
+     * still to be handed out or decompressed */
+    unsigned char head[4];
+    size_t head_len, head_pos;
+
+    /* Bytes of input still to be discarded before handing any out (see
+     * smedl_reader_open_at()) */
+    unsigned long long skip;
+
+    /* Decompression (reader thread only) */
+    void *codec;        /* z_stream or ZSTD_DStream */
+    char *in;           /* Compressed input */
+    size_t in_len, in_pos;
+    int in_frame;       /* In the middle of a compressed stream */
+
+    /* io_uring */
+    SMEDLUring ring;
+    unsigned long long next_offset;  /* File offset of the next read queued */
+    int read_eof;       /* A read reached the end of the file */
+
+    /* Reader thread */
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    int stopping;
+    int thread_done;
+} SMEDLTraceReader;
+
+/* Start reading from fd, which the reader takes ownership of. Return nonzero
+ * on success, zero on failure (with r->unsupported set if the input is
+ * compressed in a format that was not compiled in). Cleanup with
+ * smedl_reader_close(). */
+int smedl_reader_open(SMEDLTraceReader *r, int fd);
+
+/* Like smedl_reader_open(), but start offset bytes into the input (into the
+ * decompressed input, if it is compressed). A plain regular file is read from
+ * there. Anything else is read from the start and the bytes before offset are
+ * discarded. */
+int smedl_reader_open_at(SMEDLTraceReader *r, int fd, unsigned long long offset);
+
+/* Give the previous buffer back and get the next one, waiting for it to be
+ * read if necessary. Return its length and point *data at it, or return 0 at
+ * the end of the input. Check r->error to tell a read error from the end. The
+ * data stays valid until the next call. */
+size_t smedl_reader_next(SMEDLTraceReader *r, const char **data);
+
+/* Stop reading, free the buffers, and close the file. Return nonzero on
+ * success, zero if the file could not be closed. */
+int smedl_reader_close(SMEDLTraceReader *r);
+
+#endif /* TRACE_READER_H */
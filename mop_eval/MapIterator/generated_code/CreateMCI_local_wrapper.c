@@ -6,6 +6,7 @@
 #include <string.h>
 #include "smedl_types.h"
 #include "monitor_map.h"
+#include "profile.h"
 #include "sync_global_wrapper.h"
 #include "CreateMCI_local_wrapper.h"
 #include "CreateMCI_mon.h"
@@ -33,67 +34,94 @@ static MonitorMap monitor_map_0;
 static MonitorMap monitor_map_2;
 static MonitorMap monitor_map_all;
 
+/* Population counters for the stats interface */
+static uint64_t dynamic_count, created_count, recycled_count;
+
 /* Monitor map hash functions - One for each monitor map */
 
-static uint64_t hash_0(SMEDLValue *ids) {
+static uint64_t hash_0(const void *key) {
+    const CreateMCIIdentities *ids = key;
     murmur_state s = MURMUR_INIT(0);
-    murmur(&ids[0].v.p, sizeof(ids[0].v.p), &s);
+    murmur(&ids->id0, sizeof(ids->id0), &s);
     return murmur_f(&s);
 }
 
-static uint64_t hash_2(SMEDLValue *ids) {
+static uint64_t hash_2(const void *key) {
+    const CreateMCIIdentities *ids = key;
     murmur_state s = MURMUR_INIT(0);
-    murmur(&ids[2].v.p, sizeof(ids[2].v.p), &s);
+    murmur(&ids->id2, sizeof(ids->id2), &s);
     return murmur_f(&s);
 }
 
-static uint64_t hash_all(SMEDLValue *ids) {
+static uint64_t hash_all(const void *key) {
+    const CreateMCIIdentities *ids = key;
     murmur_state s = MURMUR_INIT(0);
-    murmur(&ids[0].v.p, sizeof(ids[0].v.p), &s);
-    murmur(&ids[1].v.p, sizeof(ids[1].v.p), &s);
-    murmur(&ids[2].v.p, sizeof(ids[2].v.p), &s);
+    murmur(&ids->id0, sizeof(ids->id0), &s);
+    murmur(&ids->id1, sizeof(ids->id1), &s);
+    murmur(&ids->id2, sizeof(ids->id2), &s);
     return murmur_f(&s);
 }
 
 /* Monitor map equals functions - One for each monitor map */
 
-static int equals_0(SMEDLValue *ids1, SMEDLValue *ids2) {
-    if (ids1[0].v.p != ids2[0].v.p) {
+static int equals_0(const void *key1, const void *key2) {
+    const CreateMCIIdentities *ids1 = key1, *ids2 = key2;
+    if (ids1->id0 != ids2->id0) {
         return 0;
     }
     return 1;
 }
 
-static int equals_2(SMEDLValue *ids1, SMEDLValue *ids2) {
-    if (ids1[2].v.p != ids2[2].v.p) {
+static int equals_2(const void *key1, const void *key2) {
+    const CreateMCIIdentities *ids1 = key1, *ids2 = key2;
+    if (ids1->id2 != ids2->id2) {
         return 0;
     }
     return 1;
 }
 
-static int equals_all(SMEDLValue *ids1, SMEDLValue *ids2) {
-    if (ids1[0].v.p != ids2[0].v.p) {
+static int equals_all(const void *key1, const void *key2) {
+    const CreateMCIIdentities *ids1 = key1, *ids2 = key2;
+    if (ids1->id0 != ids2->id0) {
         return 0;
     }
-    if (ids1[1].v.p != ids2[1].v.p) {
+    if (ids1->id1 != ids2->id1) {
         return 0;
     }
-    if (ids1[2].v.p != ids2[2].v.p) {
+    if (ids1->id2 != ids2->id2) {
         return 0;
     }
     return 1;
 }
 
-/* Register the global wrapper's export callbacks with the monitor */
-static void setup_CreateMCI_callbacks(CreateMCIMonitor *mon) {
-    register_CreateMCI_violation(mon, raise_CreateMCI_violation);
-    registercleanup_CreateMCI(mon, recycle_CreateMCI_monitor);
+/* Identity conversion - Fill in an identity tuple from an array of SMEDLValue
+ * as given to the import interfaces. Wildcard identities are left as they
+ * are in the array; lookups with wildcards use monitor maps that ignore them. */
+static void load_CreateMCI_ids(CreateMCIIdentities *ids, SMEDLValue *identities) {
+    ids->id0 = identities[0].v.p;
+    ids->id1 = identities[1].v.p;
+    ids->id2 = identities[2].v.p;
+}
+
+/* Register the global wrapper's export callbacks in the callback table shared
+ * by all CreateMCI monitors */
+static void setup_CreateMCI_callbacks() {
+    CreateMCICallbacks callbacks = {
+        .callback_violation = raise_CreateMCI_violation,
+        .cleanup = recycle_CreateMCI_monitor,
+    };
+    registershared_CreateMCI(&callbacks);
 }
 
 /* Initialization interface - Initialize the local wrapper. Must be called once
  * before creating any monitors or importing any events.
  * Return nonzero on success, zero on failure. */
 int init_CreateMCI_local_wrapper() {
+    /* Count the monitor maps with the monitors (see memstats.h) */
+    SMEDL_MEM_REGISTER(&CreateMCI_memory);
+    monitor_map_0.account = &CreateMCI_memory;
+    monitor_map_2.account = &CreateMCI_memory;
+    monitor_map_all.account = &CreateMCI_memory;
     if (!monitormap_init(&monitor_map_0, offsetof(CreateMCIMonitor, identities), hash_0, equals_0)) {
         goto fail_init_monitor_map_0;
     }
@@ -104,6 +132,8 @@ int init_CreateMCI_local_wrapper() {
         goto fail_init_monitor_map_all;
     }
 
+    setup_CreateMCI_callbacks();
+
     return 1;
 
 fail_init_monitor_map_all:
@@ -123,13 +153,95 @@ void free_CreateMCI_local_wrapper() {
 
     while (instances != NULL) {
         MonitorInstance *tmp = instances->next;
-        smedl_free_array(((CreateMCIMonitor *) instances->mon)->identities, 3);
         free_CreateMCI_monitor(instances->mon);
-        free(instances);
+        SMEDL_FREE_OBJECT(&CreateMCI_memory, SMEDL_MEM_MAP_INSTANCE, instances);
         instances = tmp;
     }
 }
 
+/* Count interface - Return the number of live CreateMCI monitors */
+size_t count_CreateMCI_monitors() {
+    return monitor_map_all.count;
+}
+
+/* Stats interface - Fill in the population of CreateMCI monitors and the
+ * health of its monitor maps */
+void stats_CreateMCI_monitors(MonitorStats *stats) {
+    stats->live = monitor_map_all.count;
+    stats->spilled = 0;
+    stats->dynamic = dynamic_count;
+    stats->created = created_count;
+    stats->recycled = recycled_count;
+    stats->map_count = 3;
+    stats->maps[0].name = "0";
+    monitormap_stats(&monitor_map_0, &stats->maps[0].stats);
+    stats->maps[1].name = "2";
+    monitormap_stats(&monitor_map_2, &stats->maps[1].stats);
+    stats->maps[2].name = "all";
+    monitormap_stats(&monitor_map_all, &stats->maps[2].stats);
+}
+
+/* Bytes in the snapshot record of a CreateMCI monitor: its identities, then
+ * its scenario states and state variables */
+#define CreateMCI_RECORD_SIZE (3 * SMEDL_SNAPSHOT_POINTER + CreateMCI_SNAPSHOT_SIZE)
+
+/* Snapshot interface - Write the section for CreateMCI monitors to the snapshot
+ * (see snapshot.h). Return nonzero on success, zero on failure. */
+int snapshot_CreateMCI_monitors(SMEDLSnapshotWriter *w) {
+    smedl_snapshot_begin(w, "CreateMCI", CreateMCI_RECORD_SIZE, monitor_map_all.count,
+            dynamic_count, created_count, recycled_count);
+    for (size_t i = 0; i < monitor_map_all.capacity; i++) {
+        if (monitor_map_all.table[i].dib == 0) {
+            continue;
+        }
+        for (MonitorInstance *inst = monitor_map_all.table[i].head; inst != NULL; inst = inst->next) {
+            CreateMCIMonitor *mon = inst->mon;
+            smedl_snapshot_put_pointer(w, mon->identities.id0);
+            smedl_snapshot_put_pointer(w, mon->identities.id1);
+            smedl_snapshot_put_pointer(w, mon->identities.id2);
+            snapshot_CreateMCI_monitor(mon, w);
+        }
+    }
+    return smedl_snapshot_end(w);
+}
+
+/* Restore interfaces - Reserve room in the restore block for the CreateMCI
+ * monitors in the snapshot, then restore them. Return nonzero on success,
+ * zero on failure. */
+int reserve_CreateMCI_monitors(SMEDLSnapshot *snap) {
+    return smedl_restore_reserve(snap, "CreateMCI", CreateMCI_RECORD_SIZE, sizeof(CreateMCIMonitor), 3);
+}
+
+int restore_CreateMCI_monitors(SMEDLSnapshot *snap) {
+    const SMEDLSnapshotSection *section = smedl_snapshot_section(snap, "CreateMCI", CreateMCI_RECORD_SIZE);
+    if (section == NULL) {
+        return 0;
+    }
+    if (!monitormap_reserve(&monitor_map_all, section->count)) {
+        return 0;
+    }
+    for (uint64_t i = 0; i < section->count; i++) {
+        /* The monitor struct and map nodes come from the restore block. */
+        CreateMCIIdentities ids;
+        ids.id0 = smedl_snapshot_get_pointer(snap);
+        ids.id1 = smedl_snapshot_get_pointer(snap);
+        ids.id2 = smedl_snapshot_get_pointer(snap);
+        CreateMCIMonitor *mon = init_CreateMCI_monitor(&ids);
+        if (mon == NULL) {
+            return 0;
+        }
+        restore_CreateMCI_monitor(mon, snap);
+        if (add_CreateMCI_monitor(mon) == NULL) {
+            free_CreateMCI_monitor(mon);
+            return 0;
+        }
+    }
+    dynamic_count = section->dynamic;
+    created_count = section->created;
+    recycled_count = section->recycled;
+    return !snap->error;
+}
+
 /* Creation interface - Instantiate a new CreateMCI monitor.
  * Return nonzero on success or if monitor already exists, zero on failure.
  *
@@ -141,8 +253,11 @@ void free_CreateMCI_local_wrapper() {
  *   state can be retrieved with default_CreateMCI_state()
  *   and then just the desired variables can be updated. */
 int create_CreateMCI_monitor(SMEDLValue *identities, CreateMCIState *init_state) {
+    CreateMCIIdentities ids;
+    load_CreateMCI_ids(&ids, identities);
+
     /* Check if monitor with identities already exists */
-    if (monitormap_lookup(&monitor_map_all, identities) != NULL) {
+    if (MONITORMAP_LOOKUP(&monitor_map_all, &ids, hash_all, equals_all) != NULL) {
 #if DEBUG >= 4
         fprintf(stderr, "Local wrapper 'CreateMCI' skipping explicit creation for existing monitor\n");
 #endif
@@ -153,26 +268,19 @@ int create_CreateMCI_monitor(SMEDLValue *identities, CreateMCIState *init_state)
 #endif
 
     /* Initialize new monitor with identities and state */
-    SMEDLValue *ids_copy = smedl_copy_array(identities, 3);
-    if (ids_copy == NULL) {
-        /* malloc fail */
-        return 0;
-    }
-    CreateMCIMonitor *mon = init_CreateMCI_with_state(ids_copy, init_state);
+    CreateMCIMonitor *mon = init_CreateMCI_with_state(&ids, init_state);
     if (mon == NULL) {
         /* malloc fail */
-        smedl_free_array(ids_copy, 3);
         return 0;
     }
-    setup_CreateMCI_callbacks(mon);
 
     /* Store monitor in maps */
     if (add_CreateMCI_monitor(mon) == NULL) {
         /* malloc fail */
         free_CreateMCI_monitor(mon);
-        smedl_free_array(ids_copy, 3);
         return 0;
     }
+    created_count++;
     return 1;
 }
 
@@ -192,7 +300,9 @@ int process_CreateMCI_new_mci(SMEDLValue *identities, SMEDLValue *params, void *
 #endif
     /* Fetch the monitors to send the event to or do dynamic instantiation if
      * necessary */
-    MonitorInstance *instances = get_CreateMCI_monitors(identities);
+    SMEDL_PROFILE_PUSH(SMEDL_PROFILE_STAGE_LOOKUP);
+    MonitorInstance *instances = get_CreateMCI_monitors(identities, 1);
+    SMEDL_PROFILE_POP();
     if (instances == INVALID_INSTANCE) {
         /* malloc fail */
         return 0;
@@ -203,9 +313,11 @@ int process_CreateMCI_new_mci(SMEDLValue *identities, SMEDLValue *params, void *
     while (instances != NULL) {
         CreateMCIMonitor *mon = instances->mon;
         instances = instances->next;
+        SMEDL_PROFILE_PUSH(SMEDL_PROFILE_STAGE_EXECUTE);
         if (!execute_CreateMCI_new_mci(mon, params, aux)) {
             success = 0;
         }
+        SMEDL_PROFILE_POP();
     }
     return success;
 }
@@ -214,9 +326,11 @@ int process_CreateMCI_traverse_m(SMEDLValue *identities, SMEDLValue *params, voi
 #if DEBUG >= 4
     fprintf(stderr, "Local wrapper 'CreateMCI' processing event 'traverse_m'\n");
 #endif
-    /* Fetch the monitors to send the event to or do dynamic instantiation if
-     * necessary */
-    MonitorInstance *instances = get_CreateMCI_monitors(identities);
+    /* Fetch the monitors to send the event to. 'traverse_m' is not a creation
+     * event, so no dynamic instantiation is done */
+    SMEDL_PROFILE_PUSH(SMEDL_PROFILE_STAGE_LOOKUP);
+    MonitorInstance *instances = get_CreateMCI_monitors(identities, 0);
+    SMEDL_PROFILE_POP();
     if (instances == INVALID_INSTANCE) {
         /* malloc fail */
         return 0;
@@ -227,9 +341,11 @@ int process_CreateMCI_traverse_m(SMEDLValue *identities, SMEDLValue *params, voi
     while (instances != NULL) {
         CreateMCIMonitor *mon = instances->mon;
         instances = instances->next;
+        SMEDL_PROFILE_PUSH(SMEDL_PROFILE_STAGE_EXECUTE);
         if (!execute_CreateMCI_traverse_m(mon, params, aux)) {
             success = 0;
         }
+        SMEDL_PROFILE_POP();
     }
     return success;
 }
@@ -238,9 +354,11 @@ int process_CreateMCI_traverse_i(SMEDLValue *identities, SMEDLValue *params, voi
 #if DEBUG >= 4
     fprintf(stderr, "Local wrapper 'CreateMCI' processing event 'traverse_i'\n");
 #endif
-    /* Fetch the monitors to send the event to or do dynamic instantiation if
-     * necessary */
-    MonitorInstance *instances = get_CreateMCI_monitors(identities);
+    /* Fetch the monitors to send the event to. 'traverse_i' is not a creation
+     * event, so no dynamic instantiation is done */
+    SMEDL_PROFILE_PUSH(SMEDL_PROFILE_STAGE_LOOKUP);
+    MonitorInstance *instances = get_CreateMCI_monitors(identities, 0);
+    SMEDL_PROFILE_POP();
     if (instances == INVALID_INSTANCE) {
         /* malloc fail */
         return 0;
@@ -251,9 +369,11 @@ int process_CreateMCI_traverse_i(SMEDLValue *identities, SMEDLValue *params, voi
     while (instances != NULL) {
         CreateMCIMonitor *mon = instances->mon;
         instances = instances->next;
+        SMEDL_PROFILE_PUSH(SMEDL_PROFILE_STAGE_EXECUTE);
         if (!execute_CreateMCI_traverse_i(mon, params, aux)) {
             success = 0;
         }
+        SMEDL_PROFILE_POP();
     }
     return success;
 }
@@ -265,8 +385,8 @@ int recycle_CreateMCI_monitor(CreateMCIMonitor *mon) {
         fprintf(stderr, "Recycling an instance of 'CreateMCI'\n");
 #endif
     monitormap_remove(&monitor_map_all, mon);
-    smedl_free_array(mon->identities, 3);
     free_CreateMCI_monitor(mon);
+    recycled_count++;
     return 1;
 }
 
@@ -277,14 +397,14 @@ MonitorInstance * add_CreateMCI_monitor(CreateMCIMonitor *mon) {
     MonitorMap *prev_map = NULL;
     MonitorInstance *inst;
 
-    inst = monitormap_insert(&monitor_map_0, mon, prev_inst, prev_map);
+    inst = MONITORMAP_INSERT(&monitor_map_0, mon, prev_inst, prev_map, hash_0, equals_0);
     if (inst == NULL) {
         return NULL;
     }
     prev_inst = inst;
     prev_map = &monitor_map_0;
 
-    inst = monitormap_insert(&monitor_map_2, mon, prev_inst, prev_map);
+    inst = MONITORMAP_INSERT(&monitor_map_2, mon, prev_inst, prev_map, hash_2, equals_2);
     if (inst == NULL) {
         monitormap_removeinst(prev_map, prev_inst);
         return NULL;
@@ -292,7 +412,7 @@ MonitorInstance * add_CreateMCI_monitor(CreateMCIMonitor *mon) {
     prev_inst = inst;
     prev_map = &monitor_map_2;
 
-    inst = monitormap_insert(&monitor_map_all, mon, prev_inst, prev_map);
+    inst = MONITORMAP_INSERT(&monitor_map_all, mon, prev_inst, prev_map, hash_all, equals_all);
     if (inst == NULL) {
         monitormap_removeinst(prev_map, prev_inst);
         return NULL;
@@ -308,22 +428,28 @@ MonitorInstance * add_CreateMCI_monitor(CreateMCIMonitor *mon) {
  *
  * If there are no matching monitor instances but the identity list is fully
  * specified (i.e. there are no wildcards), create an instance with those
- * identities and return it.
+ * identities and return it. This is only done when create is nonzero, i.e.
+ * for creation events: events with a transition out of the initial state of
+ * at least one scenario. An instance created by any other event could never
+ * leave its initial states, so the event is simply dropped.
  *
  * Returns a linked list of MonitorInstance (which may be empty, i.e. NULL).
  * If dynamic instantiation fails, returns INVALID_INSTANCE. */
-MonitorInstance * get_CreateMCI_monitors(SMEDLValue *identities) {
+MonitorInstance * get_CreateMCI_monitors(SMEDLValue *identities, int create) {
+    CreateMCIIdentities ids;
+    load_CreateMCI_ids(&ids, identities);
+
     /* Look up from the proper monitor map */
     MonitorInstance *instances;
     int dynamic_instantiation = 0;
     if (identities[0].t == SMEDL_NULL) {
-        instances = monitormap_lookup(&monitor_map_2, identities);
+        instances = MONITORMAP_LOOKUP(&monitor_map_2, &ids, hash_2, equals_2);
     } else {
         if (identities[1].t == SMEDL_NULL) {
-            instances = monitormap_lookup(&monitor_map_0, identities);
+            instances = MONITORMAP_LOOKUP(&monitor_map_0, &ids, hash_0, equals_0);
         } else {
-            instances = monitormap_lookup(&monitor_map_all, identities);
-            dynamic_instantiation = 1;
+            instances = MONITORMAP_LOOKUP(&monitor_map_all, &ids, hash_all, equals_all);
+            dynamic_instantiation = create;
         }
     }
 
@@ -333,25 +459,18 @@ MonitorInstance * get_CreateMCI_monitors(SMEDLValue *identities) {
 #if DEBUG >= 4
         fprintf(stderr, "Dynamic instantiation for 'CreateMCI'\n");
 #endif
-        SMEDLValue *ids_copy = smedl_copy_array(identities, 3);
-        if (ids_copy == NULL) {
-            /* malloc fail */
-            return INVALID_INSTANCE;
-        }
-        CreateMCIMonitor *mon = init_CreateMCI_monitor(ids_copy);
+        CreateMCIMonitor *mon = init_CreateMCI_monitor(&ids);
         if (mon == NULL) {
             /* malloc fail */
-            smedl_free_array(ids_copy, 3);
             return INVALID_INSTANCE;
         }
-        setup_CreateMCI_callbacks(mon);
         instances = add_CreateMCI_monitor(mon);
         if (instances == NULL) {
             /* malloc fail */
             free_CreateMCI_monitor(mon);
-            smedl_free_array(ids_copy, 3);
             return INVALID_INSTANCE;
         }
+        dynamic_count++;
     }
 
     return instances;
@@ -7,18 +7,70 @@
 #include "event_queue.h"
 #include "CreateMCI_mon.h"
 
+/* Memory counted for CreateMCI monitors */
+SMEDLMemAccount CreateMCI_memory = {"CreateMCI"};
+
+/* Callback table shared by all CreateMCI monitors without their own */
+static CreateMCICallbacks shared_callbacks;
+
+/* The callback table in effect for a monitor. In a unity build, the export
+ * functions call the global wrapper's raise_*() functions directly for
+ * monitors without a table of their own, since those are the shared callbacks
+ * the local wrapper registers. */
+#define CALLBACKS(mon) ((mon)->callbacks != NULL ? (mon)->callbacks : &shared_callbacks)
+
+/* Convert the monitor's identities to an array of SMEDLValue for the export
+ * callbacks */
+static void get_CreateMCI_id_values(CreateMCIMonitor *mon, SMEDLValue *values) {
+    values[0].t = SMEDL_POINTER;
+    values[0].v.p = mon->identities.id0;
+    values[1].t = SMEDL_POINTER;
+    values[1].v.p = mon->identities.id1;
+    values[2].t = SMEDL_POINTER;
+    values[2].v.p = mon->identities.id2;
+}
+
+/* Shared callback registration function - Set the callback table used by all
+ * CreateMCI monitors that have not registered callbacks of their own */
+void registershared_CreateMCI(const CreateMCICallbacks *callbacks) {
+    shared_callbacks = *callbacks;
+}
+
+/* Give the monitor its own copy of the shared callback table so its callbacks
+ * can be changed without affecting other monitors. Return nonzero on success,
+ * zero on malloc failure. */
+static int own_CreateMCI_callbacks(CreateMCIMonitor *mon) {
+    if (mon->callbacks == NULL) {
+        mon->callbacks = SMEDL_MALLOC(&CreateMCI_memory, SMEDL_MEM_CALLBACKS,
+                sizeof(CreateMCICallbacks));
+        if (mon->callbacks == NULL) {
+            return 0;
+        }
+        *mon->callbacks = shared_callbacks;
+    }
+    return 1;
+}
+
 /* Callback registration functions - Set the export callback for an exported
- * event */
+ * event on a single monitor */
 
-void register_CreateMCI_violation(CreateMCIMonitor *mon, SMEDLCallback cb_func) {
-    mon->callback_violation = cb_func;
+int register_CreateMCI_violation(CreateMCIMonitor *mon, SMEDLCallback cb_func) {
+    if (!own_CreateMCI_callbacks(mon)) {
+        return 0;
+    }
+    mon->callbacks->callback_violation = cb_func;
+    return 1;
 }
 
 /* Cleanup callback registration function - Set the callback for when the
  * monitor is ready to be recycled. The callback is responsible for calling
  * free_CreateMCI_monitor(). */
-void registercleanup_CreateMCI(CreateMCIMonitor *mon, int (*cleanup_func)(CreateMCIMonitor *mon)) {
-    mon->cleanup = cleanup_func;
+int registercleanup_CreateMCI(CreateMCIMonitor *mon, int (*cleanup_func)(CreateMCIMonitor *mon)) {
+    if (!own_CreateMCI_callbacks(mon)) {
+        return 0;
+    }
+    mon->callbacks->cleanup = cleanup_func;
+    return 1;
 }
 
 /* Queue processing function - Call the handlers for all the events in the
@@ -30,6 +82,13 @@ static int handle_CreateMCI_queue(CreateMCIMonitor *mon) {
     SMEDLValue *params;
     void *aux;
 
+    /* Scenario execution flags only guard events raised within a macro-step.
+     * If nothing was raised, there is nothing to handle and no flags to
+     * reset. */
+    if (mon->event_queue.head == NULL) {
+        return 1;
+    }
+
     while (pop_event(&mon->event_queue, &event, &params, &aux)) {
         switch (event) {
             case EVENT_CreateMCI_violation:
@@ -197,8 +256,18 @@ int queue_CreateMCI_violation(CreateMCIMonitor *mon, SMEDLValue *params, void *a
 }
 
 int export_CreateMCI_violation(CreateMCIMonitor *mon, SMEDLValue *params, void *aux) {
-    if (mon->callback_violation != NULL) {
-        return (mon->callback_violation)(mon->identities, params, aux);
+#ifdef SMEDL_UNITY
+    if (mon->callbacks == NULL) {
+        SMEDLValue identities[3];
+        get_CreateMCI_id_values(mon, identities);
+        return raise_CreateMCI_violation(identities, params, aux);
+    }
+#endif
+    SMEDLCallback cb_func = CALLBACKS(mon)->callback_violation;
+    if (cb_func != NULL) {
+        SMEDLValue identities[3];
+        get_CreateMCI_id_values(mon, identities);
+        return cb_func(identities, params, aux);
     }
     return 1;
 }
@@ -209,7 +278,7 @@ int export_CreateMCI_violation(CreateMCIMonitor *mon, SMEDLValue *params, void *
  * Return a pointer to the monitor. Must be freed with
  * free_CreateMCI_monitor() when no longer needed.
  * Returns NULL on malloc failure. */
-CreateMCIMonitor * init_CreateMCI_monitor(SMEDLValue *identities) {
+CreateMCIMonitor * init_CreateMCI_monitor(CreateMCIIdentities *identities) {
     CreateMCIState init_state;
 
     /* Initialize the monitor with default state */
@@ -244,14 +313,15 @@ int default_CreateMCI_state(CreateMCIState *state) {
  * Return a pointer to the monitor. Must be freed with
  * free_CreateMCI_monitor() when no longer needed.
  * Returns NULL on malloc failure. */
-CreateMCIMonitor * init_CreateMCI_with_state(SMEDLValue *identities, CreateMCIState *init_state) {
-    CreateMCIMonitor *mon = malloc(sizeof(CreateMCIMonitor));
+CreateMCIMonitor * init_CreateMCI_with_state(CreateMCIIdentities *identities, CreateMCIState *init_state) {
+    CreateMCIMonitor *mon = SMEDL_ALLOC_OBJECT(&CreateMCI_memory, SMEDL_MEM_MONITOR,
+            sizeof(CreateMCIMonitor));
     if (mon == NULL) {
         return NULL;
     }
 
     /* Store the assigned identities */
-    mon->identities = identities;
+    mon->identities = *identities;
 
     /* Copy initial state vars in */
     mon->s = *init_state;
@@ -262,8 +332,8 @@ CreateMCIMonitor * init_CreateMCI_with_state(SMEDLValue *identities, CreateMCISt
     /* Reset all scenario execution flags */
     memset(&mon->ef, 0, sizeof(mon->ef));
 
-    /* Set all export callbacks to NULL */
-    mon->callback_violation = NULL;
+    /* Use the shared callback table */
+    mon->callbacks = NULL;
 
     /* Initialize event queue */
     mon->event_queue = (EventQueue){0};
@@ -273,5 +343,18 @@ CreateMCIMonitor * init_CreateMCI_with_state(SMEDLValue *identities, CreateMCISt
 
 /* Free a CreateMCI monitor */
 void free_CreateMCI_monitor(CreateMCIMonitor *mon) {
-    free(mon);
+    SMEDL_FREE(&CreateMCI_memory, SMEDL_MEM_CALLBACKS, mon->callbacks);
+    SMEDL_FREE_OBJECT(&CreateMCI_memory, SMEDL_MEM_MONITOR, mon);
+}
+
+/* Append the monitor's scenario states and state variables to its snapshot
+ * record */
+void snapshot_CreateMCI_monitor(CreateMCIMonitor *mon, SMEDLSnapshotWriter *w) {
+    smedl_snapshot_put_state(w, mon->sce1_state);
+}
+
+/* Get the monitor's scenario states and state variables back from its
+ * snapshot record */
+void restore_CreateMCI_monitor(CreateMCIMonitor *mon, SMEDLSnapshot *snap) {
+    mon->sce1_state = smedl_snapshot_get_state(snap);
 }
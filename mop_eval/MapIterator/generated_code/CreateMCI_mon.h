@@ -3,6 +3,11 @@
 
 #include "smedl_types.h"
 #include "event_queue.h"
+#include "memstats.h"
+#include "snapshot.h"
+
+/* Memory counted for CreateMCI monitors (see memstats.h) */
+extern SMEDLMemAccount CreateMCI_memory;
 
 /* Internal/exported event enum for action queues */
 typedef enum {
@@ -22,14 +27,33 @@ typedef enum {
 typedef struct CreateMCIState {
 } CreateMCIState;
 
+/* Identities of a CreateMCI monitor.
+ * Stored inline in the CreateMCIMonitor struct. They are only converted to
+ * an array of SMEDLValue at the import and export interfaces. */
+typedef struct CreateMCIIdentities {
+    void *id0;
+    void *id1;
+    void *id2;
+} CreateMCIIdentities;
+
+/* Callback table for CreateMCI monitors.
+ * Holds the exported event callbacks and the cleanup callback. One table is
+ * shared by all CreateMCI monitors; a monitor only gets its own copy once one of
+ * its callbacks is registered individually. */
+struct CreateMCIMonitor;
+typedef struct CreateMCICallbacks {
+    SMEDLCallback callback_violation;
+    int (*cleanup)(struct CreateMCIMonitor *mon);
+} CreateMCICallbacks;
+
 /* CreateMCI monitor struct.
  * Maintains all of the internal state for the monitor. */
 typedef struct CreateMCIMonitor {
-    /* Array of monitor's identities */
-    SMEDLValue *identities;
+    /* Monitor's identities */
+    CreateMCIIdentities identities;
 
-    /* Scenario states */
-    CreateMCI_sce1_State sce1_state;
+    /* Scenario states (CreateMCI_*_State values, one byte each) */
+    unsigned char sce1_state;
 
     /* Scenario execution flags (ensures each scenario only processes one event
      * per macro-step) */
@@ -40,11 +64,9 @@ typedef struct CreateMCIMonitor {
     /* State variables */
     CreateMCIState s;
 
-    /* Exported event callback pointers */
-    SMEDLCallback callback_violation;
-
-    /* Cleanup callback pointer */
-    int (*cleanup)(struct CreateMCIMonitor *mon);
+    /* Callback table, or NULL to use the table shared by all CreateMCI
+     * monitors */
+    CreateMCICallbacks *callbacks;
 
     /* Local event queue */
     EventQueue event_queue;
@@ -52,15 +74,23 @@ typedef struct CreateMCIMonitor {
     //TODO mutex?
 } CreateMCIMonitor;
 
+/* Shared callback registration function - Set the callback table used by all
+ * CreateMCI monitors that have not registered callbacks of their own. The
+ * table is copied. */
+void registershared_CreateMCI(const CreateMCICallbacks *callbacks);
+
 /* Callback registration functions - Set the export callback for an exported
- * event. Set to NULL to unregister a callback. */
-void register_CreateMCI_violation(CreateMCIMonitor *mon, SMEDLCallback cb_func);
+ * event on a single monitor. Set to NULL to unregister a callback. Return
+ * nonzero on success, zero on malloc failure. */
+int register_CreateMCI_violation(CreateMCIMonitor *mon, SMEDLCallback cb_func);
 
 /* Cleanup callback registration function - Set the callback for when the
  * monitor is ready to be recycled. The callback is responsible for calling
  * free_CreateMCI_monitor(). It must accept the monitor pointer as a
- * parameter and return nonzero on success, zero on failure. */
-void registercleanup_CreateMCI(CreateMCIMonitor *mon, int (*cleanup_func)(CreateMCIMonitor *mon));
+ * parameter and return nonzero on success, zero on failure.
+ * Like the callback registration functions, this affects a single monitor and
+ * returns nonzero on success, zero on malloc failure. */
+int registercleanup_CreateMCI(CreateMCIMonitor *mon, int (*cleanup_func)(CreateMCIMonitor *mon));
 
 /* Event handling functions:
  *
@@ -92,7 +122,7 @@ int export_CreateMCI_violation(CreateMCIMonitor *mon, SMEDLValue *params, void *
  * Return a pointer to the monitor. Must be freed with
  * free_CreateMCI_monitor() when no longer needed.
  * Returns NULL on malloc failure. */
-CreateMCIMonitor * init_CreateMCI_monitor(SMEDLValue *identities);
+CreateMCIMonitor * init_CreateMCI_monitor(CreateMCIIdentities *identities);
 
 /* Fill the provided CreateMCIState
  * with the default initial values for the monitor. Note that strings and
@@ -112,10 +142,17 @@ int default_CreateMCI_state(CreateMCIState *state);
  * Return a pointer to the monitor. Must be freed with
  * free_CreateMCI_monitor() when no longer needed.
  * Returns NULL on malloc failure. */
-CreateMCIMonitor * init_CreateMCI_with_state(SMEDLValue *identities, CreateMCIState *init_state);
+CreateMCIMonitor * init_CreateMCI_with_state(CreateMCIIdentities *identities, CreateMCIState *init_state);
 
-/* Free a CreateMCI monitor. NOTE: Does not free the identities. That must
- * be done by the caller, if necessary. */
+/* Free a CreateMCI monitor */
 void free_CreateMCI_monitor(CreateMCIMonitor *mon);
 
+/* Snapshot functions (see snapshot.h) - snapshot_CreateMCI_monitor() appends
+ * the monitor's scenario states and state variables to its record,
+ * CreateMCI_SNAPSHOT_SIZE bytes. restore_CreateMCI_monitor() gets them back into a
+ * monitor initialized with the same identities. */
+#define CreateMCI_SNAPSHOT_SIZE (SMEDL_SNAPSHOT_STATE)
+void snapshot_CreateMCI_monitor(CreateMCIMonitor *mon, SMEDLSnapshotWriter *w);
+void restore_CreateMCI_monitor(CreateMCIMonitor *mon, SMEDLSnapshot *snap);
+
 #endif /* CreateMCI_MON_H */
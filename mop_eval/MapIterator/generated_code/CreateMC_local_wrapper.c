@@ -6,6 +6,7 @@
 #include <string.h>
 #include "smedl_types.h"
 #include "monitor_map.h"
+#include "profile.h"
 #include "sync_global_wrapper.h"
 #include "CreateMC_local_wrapper.h"
 #include "CreateMC_mon.h"
@@ -32,50 +33,73 @@
 static MonitorMap monitor_map_all;
 static MonitorMap monitor_map_1;
 
+/* Population counters for the stats interface */
+static uint64_t dynamic_count, created_count, recycled_count;
+
 /* Monitor map hash functions - One for each monitor map */
 
-static uint64_t hash_all(SMEDLValue *ids) {
+static uint64_t hash_all(const void *key) {
+    const CreateMCIdentities *ids = key;
     murmur_state s = MURMUR_INIT(0);
-    murmur(&ids[0].v.p, sizeof(ids[0].v.p), &s);
-    murmur(&ids[1].v.p, sizeof(ids[1].v.p), &s);
+    murmur(&ids->id0, sizeof(ids->id0), &s);
+    murmur(&ids->id1, sizeof(ids->id1), &s);
     return murmur_f(&s);
 }
 
-static uint64_t hash_1(SMEDLValue *ids) {
+static uint64_t hash_1(const void *key) {
+    const CreateMCIdentities *ids = key;
     murmur_state s = MURMUR_INIT(0);
-    murmur(&ids[1].v.p, sizeof(ids[1].v.p), &s);
+    murmur(&ids->id1, sizeof(ids->id1), &s);
     return murmur_f(&s);
 }
 
 /* Monitor map equals functions - One for each monitor map */
 
-static int equals_all(SMEDLValue *ids1, SMEDLValue *ids2) {
-    if (ids1[0].v.p != ids2[0].v.p) {
+static int equals_all(const void *key1, const void *key2) {
+    const CreateMCIdentities *ids1 = key1, *ids2 = key2;
+    if (ids1->id0 != ids2->id0) {
         return 0;
     }
-    if (ids1[1].v.p != ids2[1].v.p) {
+    if (ids1->id1 != ids2->id1) {
         return 0;
     }
     return 1;
 }
 
-static int equals_1(SMEDLValue *ids1, SMEDLValue *ids2) {
-    if (ids1[1].v.p != ids2[1].v.p) {
+static int equals_1(const void *key1, const void *key2) {
+    const CreateMCIdentities *ids1 = key1, *ids2 = key2;
+    if (ids1->id1 != ids2->id1) {
         return 0;
     }
     return 1;
 }
 
-/* Register the global wrapper's export callbacks with the monitor */
-static void setup_CreateMC_callbacks(CreateMCMonitor *mon) {
-    register_CreateMC_new_mci(mon, raise_CreateMC_new_mci);
-    registercleanup_CreateMC(mon, recycle_CreateMC_monitor);
+/* Identity conversion - Fill in an identity tuple from an array of SMEDLValue
+ * as given to the import interfaces. Wildcard identities are left as they
+ * are in the array; lookups with wildcards use monitor maps that ignore them. */
+static void load_CreateMC_ids(CreateMCIdentities *ids, SMEDLValue *identities) {
+    ids->id0 = identities[0].v.p;
+    ids->id1 = identities[1].v.p;
+}
+
+/* Register the global wrapper's export callbacks in the callback table shared
+ * by all CreateMC monitors */
+static void setup_CreateMC_callbacks() {
+    CreateMCCallbacks callbacks = {
+        .callback_new_mci = raise_CreateMC_new_mci,
+        .cleanup = recycle_CreateMC_monitor,
+    };
+    registershared_CreateMC(&callbacks);
 }
 
 /* Initialization interface - Initialize the local wrapper. Must be called once
  * before creating any monitors or importing any events.
  * Return nonzero on success, zero on failure. */
 int init_CreateMC_local_wrapper() {
+    /* Count the monitor maps with the monitors (see memstats.h) */
+    SMEDL_MEM_REGISTER(&CreateMC_memory);
+    monitor_map_all.account = &CreateMC_memory;
+    monitor_map_1.account = &CreateMC_memory;
     if (!monitormap_init(&monitor_map_all, offsetof(CreateMCMonitor, identities), hash_all, equals_all)) {
         goto fail_init_monitor_map_all;
     }
@@ -83,6 +107,8 @@ int init_CreateMC_local_wrapper() {
         goto fail_init_monitor_map_1;
     }
 
+    setup_CreateMC_callbacks();
+
     return 1;
 
 fail_init_monitor_map_1:
@@ -99,13 +125,91 @@ void free_CreateMC_local_wrapper() {
 
     while (instances != NULL) {
         MonitorInstance *tmp = instances->next;
-        smedl_free_array(((CreateMCMonitor *) instances->mon)->identities, 2);
         free_CreateMC_monitor(instances->mon);
-        free(instances);
+        SMEDL_FREE_OBJECT(&CreateMC_memory, SMEDL_MEM_MAP_INSTANCE, instances);
         instances = tmp;
     }
 }
 
+/* Count interface - Return the number of live CreateMC monitors */
+size_t count_CreateMC_monitors() {
+    return monitor_map_all.count;
+}
+
+/* Stats interface - Fill in the population of CreateMC monitors and the
+ * health of its monitor maps */
+void stats_CreateMC_monitors(MonitorStats *stats) {
+    stats->live = monitor_map_all.count;
+    stats->spilled = 0;
+    stats->dynamic = dynamic_count;
+    stats->created = created_count;
+    stats->recycled = recycled_count;
+    stats->map_count = 2;
+    stats->maps[0].name = "all";
+    monitormap_stats(&monitor_map_all, &stats->maps[0].stats);
+    stats->maps[1].name = "1";
+    monitormap_stats(&monitor_map_1, &stats->maps[1].stats);
+}
+
+/* Bytes in the snapshot record of a CreateMC monitor: its identities, then
+ * its scenario states and state variables */
+#define CreateMC_RECORD_SIZE (2 * SMEDL_SNAPSHOT_POINTER + CreateMC_SNAPSHOT_SIZE)
+
+/* Snapshot interface - Write the section for CreateMC monitors to the snapshot
+ * (see snapshot.h). Return nonzero on success, zero on failure. */
+int snapshot_CreateMC_monitors(SMEDLSnapshotWriter *w) {
+    smedl_snapshot_begin(w, "CreateMC", CreateMC_RECORD_SIZE, monitor_map_all.count,
+            dynamic_count, created_count, recycled_count);
+    for (size_t i = 0; i < monitor_map_all.capacity; i++) {
+        if (monitor_map_all.table[i].dib == 0) {
+            continue;
+        }
+        for (MonitorInstance *inst = monitor_map_all.table[i].head; inst != NULL; inst = inst->next) {
+            CreateMCMonitor *mon = inst->mon;
+            smedl_snapshot_put_pointer(w, mon->identities.id0);
+            smedl_snapshot_put_pointer(w, mon->identities.id1);
+            snapshot_CreateMC_monitor(mon, w);
+        }
+    }
+    return smedl_snapshot_end(w);
+}
+
+/* Restore interfaces - Reserve room in the restore block for the CreateMC
+ * monitors in the snapshot, then restore them. Return nonzero on success,
+ * zero on failure. */
+int reserve_CreateMC_monitors(SMEDLSnapshot *snap) {
+    return smedl_restore_reserve(snap, "CreateMC", CreateMC_RECORD_SIZE, sizeof(CreateMCMonitor), 2);
+}
+
+int restore_CreateMC_monitors(SMEDLSnapshot *snap) {
+    const SMEDLSnapshotSection *section = smedl_snapshot_section(snap, "CreateMC", CreateMC_RECORD_SIZE);
+    if (section == NULL) {
+        return 0;
+    }
+    if (!monitormap_reserve(&monitor_map_all, section->count)) {
+        return 0;
+    }
+    for (uint64_t i = 0; i < section->count; i++) {
+        /* The monitor struct and map nodes come from the restore block. */
+        CreateMCIdentities ids;
+        ids.id0 = smedl_snapshot_get_pointer(snap);
+        ids.id1 = smedl_snapshot_get_pointer(snap);
+        CreateMCMonitor *mon = init_CreateMC_monitor(&ids);
+        if (mon == NULL) {
+            return 0;
+        }
+        restore_CreateMC_monitor(mon, snap);
+        if (add_CreateMC_monitor(mon) == NULL) {
+            free_CreateMC_monitor(mon);
+            return 0;
+        }
+    }
+    dynamic_count = section->dynamic;
+    created_count = section->created;
+    recycled_count = section->recycled;
+    return !snap->error;
+}
+
 /* Creation interface - Instantiate a new CreateMC monitor.
  * Return nonzero on success or if monitor already exists, zero on failure.
  *
@@ -117,8 +221,11 @@ void free_CreateMC_local_wrapper() {
  *   state can be retrieved with default_CreateMC_state()
  *   and then just the desired variables can be updated. */
 int create_CreateMC_monitor(SMEDLValue *identities, CreateMCState *init_state) {
+    CreateMCIdentities ids;
+    load_CreateMC_ids(&ids, identities);
+
     /* Check if monitor with identities already exists */
-    if (monitormap_lookup(&monitor_map_all, identities) != NULL) {
+    if (MONITORMAP_LOOKUP(&monitor_map_all, &ids, hash_all, equals_all) != NULL) {
 #if DEBUG >= 4
         fprintf(stderr, "Local wrapper 'CreateMC' skipping explicit creation for existing monitor\n");
 #endif
@@ -129,26 +236,19 @@ int create_CreateMC_monitor(SMEDLValue *identities, CreateMCState *init_state) {
 #endif
 
     /* Initialize new monitor with identities and state */
-    SMEDLValue *ids_copy = smedl_copy_array(identities, 2);
-    if (ids_copy == NULL) {
-        /* malloc fail */
-        return 0;
-    }
-    CreateMCMonitor *mon = init_CreateMC_with_state(ids_copy, init_state);
+    CreateMCMonitor *mon = init_CreateMC_with_state(&ids, init_state);
     if (mon == NULL) {
         /* malloc fail */
-        smedl_free_array(ids_copy, 2);
         return 0;
     }
-    setup_CreateMC_callbacks(mon);
 
     /* Store monitor in maps */
     if (add_CreateMC_monitor(mon) == NULL) {
         /* malloc fail */
         free_CreateMC_monitor(mon);
-        smedl_free_array(ids_copy, 2);
         return 0;
     }
+    created_count++;
     return 1;
 }
 
@@ -168,7 +268,9 @@ int process_CreateMC_new_mc(SMEDLValue *identities, SMEDLValue *params, void *au
 #endif
     /* Fetch the monitors to send the event to or do dynamic instantiation if
      * necessary */
-    MonitorInstance *instances = get_CreateMC_monitors(identities);
+    SMEDL_PROFILE_PUSH(SMEDL_PROFILE_STAGE_LOOKUP);
+    MonitorInstance *instances = get_CreateMC_monitors(identities, 1);
+    SMEDL_PROFILE_POP();
     if (instances == INVALID_INSTANCE) {
         /* malloc fail */
         return 0;
@@ -179,9 +281,11 @@ int process_CreateMC_new_mc(SMEDLValue *identities, SMEDLValue *params, void *au
     while (instances != NULL) {
         CreateMCMonitor *mon = instances->mon;
         instances = instances->next;
+        SMEDL_PROFILE_PUSH(SMEDL_PROFILE_STAGE_EXECUTE);
         if (!execute_CreateMC_new_mc(mon, params, aux)) {
             success = 0;
         }
+        SMEDL_PROFILE_POP();
     }
     return success;
 }
@@ -190,9 +294,11 @@ int process_CreateMC_new_ci(SMEDLValue *identities, SMEDLValue *params, void *au
 #if DEBUG >= 4
     fprintf(stderr, "Local wrapper 'CreateMC' processing event 'new_ci'\n");
 #endif
-    /* Fetch the monitors to send the event to or do dynamic instantiation if
-     * necessary */
-    MonitorInstance *instances = get_CreateMC_monitors(identities);
+    /* Fetch the monitors to send the event to. 'new_ci' is not a creation
+     * event, so no dynamic instantiation is done */
+    SMEDL_PROFILE_PUSH(SMEDL_PROFILE_STAGE_LOOKUP);
+    MonitorInstance *instances = get_CreateMC_monitors(identities, 0);
+    SMEDL_PROFILE_POP();
     if (instances == INVALID_INSTANCE) {
         /* malloc fail */
         return 0;
@@ -203,9 +309,11 @@ int process_CreateMC_new_ci(SMEDLValue *identities, SMEDLValue *params, void *au
     while (instances != NULL) {
         CreateMCMonitor *mon = instances->mon;
         instances = instances->next;
+        SMEDL_PROFILE_PUSH(SMEDL_PROFILE_STAGE_EXECUTE);
         if (!execute_CreateMC_new_ci(mon, params, aux)) {
             success = 0;
         }
+        SMEDL_PROFILE_POP();
     }
     return success;
 }
@@ -217,8 +325,8 @@ int recycle_CreateMC_monitor(CreateMCMonitor *mon) {
         fprintf(stderr, "Recycling an instance of 'CreateMC'\n");
 #endif
     monitormap_remove(&monitor_map_all, mon);
-    smedl_free_array(mon->identities, 2);
     free_CreateMC_monitor(mon);
+    recycled_count++;
     return 1;
 }
 
@@ -229,14 +337,14 @@ MonitorInstance * add_CreateMC_monitor(CreateMCMonitor *mon) {
     MonitorMap *prev_map = NULL;
     MonitorInstance *inst;
 
-    inst = monitormap_insert(&monitor_map_1, mon, prev_inst, prev_map);
+    inst = MONITORMAP_INSERT(&monitor_map_1, mon, prev_inst, prev_map, hash_1, equals_1);
     if (inst == NULL) {
         return NULL;
     }
     prev_inst = inst;
     prev_map = &monitor_map_1;
 
-    inst = monitormap_insert(&monitor_map_all, mon, prev_inst, prev_map);
+    inst = MONITORMAP_INSERT(&monitor_map_all, mon, prev_inst, prev_map, hash_all, equals_all);
     if (inst == NULL) {
         monitormap_removeinst(prev_map, prev_inst);
         return NULL;
@@ -252,19 +360,25 @@ MonitorInstance * add_CreateMC_monitor(CreateMCMonitor *mon) {
  *
  * If there are no matching monitor instances but the identity list is fully
  * specified (i.e. there are no wildcards), create an instance with those
- * identities and return it.
+ * identities and return it. This is only done when create is nonzero, i.e.
+ * for creation events: events with a transition out of the initial state of
+ * at least one scenario. An instance created by any other event could never
+ * leave its initial states, so the event is simply dropped.
  *
  * Returns a linked list of MonitorInstance (which may be empty, i.e. NULL).
  * If dynamic instantiation fails, returns INVALID_INSTANCE. */
-MonitorInstance * get_CreateMC_monitors(SMEDLValue *identities) {
+MonitorInstance * get_CreateMC_monitors(SMEDLValue *identities, int create) {
+    CreateMCIdentities ids;
+    load_CreateMC_ids(&ids, identities);
+
     /* Look up from the proper monitor map */
     MonitorInstance *instances;
     int dynamic_instantiation = 0;
     if (identities[0].t == SMEDL_NULL) {
-        instances = monitormap_lookup(&monitor_map_1, identities);
+        instances = MONITORMAP_LOOKUP(&monitor_map_1, &ids, hash_1, equals_1);
     } else {
-        instances = monitormap_lookup(&monitor_map_all, identities);
-        dynamic_instantiation = 1;
+        instances = MONITORMAP_LOOKUP(&monitor_map_all, &ids, hash_all, equals_all);
+        dynamic_instantiation = create;
     }
 
     /* Do dynamic instantiation if wildcards were fully specified and there
@@ -273,25 +387,18 @@ MonitorInstance * get_CreateMC_monitors(SMEDLValue *identities) {
 #if DEBUG >= 4
         fprintf(stderr, "Dynamic instantiation for 'CreateMC'\n");
 #endif
-        SMEDLValue *ids_copy = smedl_copy_array(identities, 2);
-        if (ids_copy == NULL) {
-            /* malloc fail */
-            return INVALID_INSTANCE;
-        }
-        CreateMCMonitor *mon = init_CreateMC_monitor(ids_copy);
+        CreateMCMonitor *mon = init_CreateMC_monitor(&ids);
         if (mon == NULL) {
             /* malloc fail */
-            smedl_free_array(ids_copy, 2);
             return INVALID_INSTANCE;
         }
-        setup_CreateMC_callbacks(mon);
         instances = add_CreateMC_monitor(mon);
         if (instances == NULL) {
             /* malloc fail */
             free_CreateMC_monitor(mon);
-            smedl_free_array(ids_copy, 2);
             return INVALID_INSTANCE;
         }
+        dynamic_count++;
     }
 
     return instances;
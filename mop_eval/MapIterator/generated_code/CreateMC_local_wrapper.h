@@ -4,6 +4,7 @@
 #include <stdint.h>
 #include "smedl_types.h"
 #include "monitor_map.h"
+#include "snapshot.h"
 #include "CreateMC_mon.h"
 
 /******************************************************************************
@@ -19,6 +20,24 @@ int init_CreateMC_local_wrapper();
  * wrapper and all the monitors it manages */
 void free_CreateMC_local_wrapper();
 
+/* Count interface - Return the number of live CreateMC monitors */
+size_t count_CreateMC_monitors();
+
+/* Stats interface - Fill in the population of CreateMC monitors and the
+ * health of its monitor maps */
+void stats_CreateMC_monitors(MonitorStats *stats);
+
+/* Snapshot interface - Write the section for CreateMC monitors to the snapshot
+ * (see snapshot.h). Return nonzero on success, zero on failure. */
+int snapshot_CreateMC_monitors(SMEDLSnapshotWriter *w);
+
+/* Restore interfaces - Reserve room in the restore block for the CreateMC
+ * monitors in the snapshot, then restore them, between smedl_restore_begin()
+ * and smedl_restore_end(). There must be no CreateMC monitors yet. Return
+ * nonzero on success, zero on failure. */
+int reserve_CreateMC_monitors(SMEDLSnapshot *snap);
+int restore_CreateMC_monitors(SMEDLSnapshot *snap);
+
 /* Creation interface - Instantiate a new CreateMC monitor.
  * Return nonzero on success or if monitor already exists, zero on failure.
  *
@@ -60,10 +79,13 @@ MonitorInstance * add_CreateMC_monitor(CreateMCMonitor *mon);
  *
  * If there are no matching monitor instances but the identity list is fully
  * specified (i.e. there are no wildcards), create an instance with those
- * identities and return it.
+ * identities and return it. This is only done when create is nonzero, i.e.
+ * for creation events: events with a transition out of the initial state of
+ * at least one scenario. An instance created by any other event could never
+ * leave its initial states, so the event is simply dropped.
  *
  * Returns a linked list of MonitorInstance (which may be empty, i.e. NULL).
  * If dynamic instantiation fails, returns INVALID_INSTANCE. */
-MonitorInstance * get_CreateMC_monitors(SMEDLValue *identities);
+MonitorInstance * get_CreateMC_monitors(SMEDLValue *identities, int create);
 
 #endif /* CreateMC_LOCAL_WRAPPER_H */
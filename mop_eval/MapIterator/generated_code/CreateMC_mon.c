@@ -7,18 +7,68 @@
 #include "event_queue.h"
 #include "CreateMC_mon.h"
 
+/* Memory counted for CreateMC monitors */
+SMEDLMemAccount CreateMC_memory = {"CreateMC"};
+
+/* Callback table shared by all CreateMC monitors without their own */
+static CreateMCCallbacks shared_callbacks;
+
+/* The callback table in effect for a monitor. In a unity build, the export
+ * functions call the global wrapper's raise_*() functions directly for
+ * monitors without a table of their own, since those are the shared callbacks
+ * the local wrapper registers. */
+#define CALLBACKS(mon) ((mon)->callbacks != NULL ? (mon)->callbacks : &shared_callbacks)
+
+/* Convert the monitor's identities to an array of SMEDLValue for the export
+ * callbacks */
+static void get_CreateMC_id_values(CreateMCMonitor *mon, SMEDLValue *values) {
+    values[0].t = SMEDL_POINTER;
+    values[0].v.p = mon->identities.id0;
+    values[1].t = SMEDL_POINTER;
+    values[1].v.p = mon->identities.id1;
+}
+
+/* Shared callback registration function - Set the callback table used by all
+ * CreateMC monitors that have not registered callbacks of their own */
+void registershared_CreateMC(const CreateMCCallbacks *callbacks) {
+    shared_callbacks = *callbacks;
+}
+
+/* Give the monitor its own copy of the shared callback table so its callbacks
+ * can be changed without affecting other monitors. Return nonzero on success,
+ * zero on malloc failure. */
+static int own_CreateMC_callbacks(CreateMCMonitor *mon) {
+    if (mon->callbacks == NULL) {
+        mon->callbacks = SMEDL_MALLOC(&CreateMC_memory, SMEDL_MEM_CALLBACKS,
+                sizeof(CreateMCCallbacks));
+        if (mon->callbacks == NULL) {
+            return 0;
+        }
+        *mon->callbacks = shared_callbacks;
+    }
+    return 1;
+}
+
 /* Callback registration functions - Set the export callback for an exported
- * event */
+ * event on a single monitor */
 
-void register_CreateMC_new_mci(CreateMCMonitor *mon, SMEDLCallback cb_func) {
-    mon->callback_new_mci = cb_func;
+int register_CreateMC_new_mci(CreateMCMonitor *mon, SMEDLCallback cb_func) {
+    if (!own_CreateMC_callbacks(mon)) {
+        return 0;
+    }
+    mon->callbacks->callback_new_mci = cb_func;
+    return 1;
 }
 
 /* Cleanup callback registration function - Set the callback for when the
  * monitor is ready to be recycled. The callback is responsible for calling
  * free_CreateMC_monitor(). */
-void registercleanup_CreateMC(CreateMCMonitor *mon, int (*cleanup_func)(CreateMCMonitor *mon)) {
-    mon->cleanup = cleanup_func;
+int registercleanup_CreateMC(CreateMCMonitor *mon, int (*cleanup_func)(CreateMCMonitor *mon)) {
+    if (!own_CreateMC_callbacks(mon)) {
+        return 0;
+    }
+    mon->callbacks->cleanup = cleanup_func;
+    return 1;
 }
 
 /* Queue processing function - Call the handlers for all the events in the
@@ -30,6 +80,13 @@ static int handle_CreateMC_queue(CreateMCMonitor *mon) {
     SMEDLValue *params;
     void *aux;
 
+    /* Scenario execution flags only guard events raised within a macro-step.
+     * If nothing was raised, there is nothing to handle and no flags to
+     * reset. */
+    if (mon->event_queue.head == NULL) {
+        return 1;
+    }
+
     while (pop_event(&mon->event_queue, &event, &params, &aux)) {
         switch (event) {
             case EVENT_CreateMC_new_mci:
@@ -159,8 +216,18 @@ int queue_CreateMC_new_mci(CreateMCMonitor *mon, SMEDLValue *params, void *aux)
 }
 
 int export_CreateMC_new_mci(CreateMCMonitor *mon, SMEDLValue *params, void *aux) {
-    if (mon->callback_new_mci != NULL) {
-        return (mon->callback_new_mci)(mon->identities, params, aux);
+#ifdef SMEDL_UNITY
+    if (mon->callbacks == NULL) {
+        SMEDLValue identities[2];
+        get_CreateMC_id_values(mon, identities);
+        return raise_CreateMC_new_mci(identities, params, aux);
+    }
+#endif
+    SMEDLCallback cb_func = CALLBACKS(mon)->callback_new_mci;
+    if (cb_func != NULL) {
+        SMEDLValue identities[2];
+        get_CreateMC_id_values(mon, identities);
+        return cb_func(identities, params, aux);
     }
     return 1;
 }
@@ -171,7 +238,7 @@ int export_CreateMC_new_mci(CreateMCMonitor *mon, SMEDLValue *params, void *aux)
  * Return a pointer to the monitor. Must be freed with
  * free_CreateMC_monitor() when no longer needed.
  * Returns NULL on malloc failure. */
-CreateMCMonitor * init_CreateMC_monitor(SMEDLValue *identities) {
+CreateMCMonitor * init_CreateMC_monitor(CreateMCIdentities *identities) {
     CreateMCState init_state;
 
     /* Initialize the monitor with default state */
@@ -206,14 +273,15 @@ int default_CreateMC_state(CreateMCState *state) {
  * Return a pointer to the monitor. Must be freed with
  * free_CreateMC_monitor() when no longer needed.
  * Returns NULL on malloc failure. */
-CreateMCMonitor * init_CreateMC_with_state(SMEDLValue *identities, CreateMCState *init_state) {
-    CreateMCMonitor *mon = malloc(sizeof(CreateMCMonitor));
+CreateMCMonitor * init_CreateMC_with_state(CreateMCIdentities *identities, CreateMCState *init_state) {
+    CreateMCMonitor *mon = SMEDL_ALLOC_OBJECT(&CreateMC_memory, SMEDL_MEM_MONITOR,
+            sizeof(CreateMCMonitor));
     if (mon == NULL) {
         return NULL;
     }
 
     /* Store the assigned identities */
-    mon->identities = identities;
+    mon->identities = *identities;
 
     /* Copy initial state vars in */
     mon->s = *init_state;
@@ -224,8 +292,8 @@ CreateMCMonitor * init_CreateMC_with_state(SMEDLValue *identities, CreateMCState
     /* Reset all scenario execution flags */
     memset(&mon->ef, 0, sizeof(mon->ef));
 
-    /* Set all export callbacks to NULL */
-    mon->callback_new_mci = NULL;
+    /* Use the shared callback table */
+    mon->callbacks = NULL;
 
     /* Initialize event queue */
     mon->event_queue = (EventQueue){0};
@@ -235,5 +303,18 @@ CreateMCMonitor * init_CreateMC_with_state(SMEDLValue *identities, CreateMCState
 
 /* Free a CreateMC monitor */
 void free_CreateMC_monitor(CreateMCMonitor *mon) {
-    free(mon);
+    SMEDL_FREE(&CreateMC_memory, SMEDL_MEM_CALLBACKS, mon->callbacks);
+    SMEDL_FREE_OBJECT(&CreateMC_memory, SMEDL_MEM_MONITOR, mon);
+}
+
+/* Append the monitor's scenario states and state variables to its snapshot
+ * record */
+void snapshot_CreateMC_monitor(CreateMCMonitor *mon, SMEDLSnapshotWriter *w) {
+    smedl_snapshot_put_state(w, mon->sce1_state);
+}
+
+/* Get the monitor's scenario states and state variables back from its
+ * snapshot record */
+void restore_CreateMC_monitor(CreateMCMonitor *mon, SMEDLSnapshot *snap) {
+    mon->sce1_state = smedl_snapshot_get_state(snap);
 }
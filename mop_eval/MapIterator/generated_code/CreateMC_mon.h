@@ -3,6 +3,11 @@
 
 #include "smedl_types.h"
 #include "event_queue.h"
+#include "memstats.h"
+#include "snapshot.h"
+
+/* Memory counted for CreateMC monitors (see memstats.h) */
+extern SMEDLMemAccount CreateMC_memory;
 
 /* Internal/exported event enum for action queues */
 typedef enum {
@@ -21,14 +26,32 @@ typedef enum {
 typedef struct CreateMCState {
 } CreateMCState;
 
+/* Identities of a CreateMC monitor.
+ * Stored inline in the CreateMCMonitor struct. They are only converted to
+ * an array of SMEDLValue at the import and export interfaces. */
+typedef struct CreateMCIdentities {
+    void *id0;
+    void *id1;
+} CreateMCIdentities;
+
+/* Callback table for CreateMC monitors.
+ * Holds the exported event callbacks and the cleanup callback. One table is
+ * shared by all CreateMC monitors; a monitor only gets its own copy once one of
+ * its callbacks is registered individually. */
+struct CreateMCMonitor;
+typedef struct CreateMCCallbacks {
+    SMEDLCallback callback_new_mci;
+    int (*cleanup)(struct CreateMCMonitor *mon);
+} CreateMCCallbacks;
+
 /* CreateMC monitor struct.
  * Maintains all of the internal state for the monitor. */
 typedef struct CreateMCMonitor {
-    /* Array of monitor's identities */
-    SMEDLValue *identities;
+    /* Monitor's identities */
+    CreateMCIdentities identities;
 
-    /* Scenario states */
-    CreateMC_sce1_State sce1_state;
+    /* Scenario states (CreateMC_*_State values, one byte each) */
+    unsigned char sce1_state;
 
     /* Scenario execution flags (ensures each scenario only processes one event
      * per macro-step) */
@@ -39,11 +62,9 @@ typedef struct CreateMCMonitor {
     /* State variables */
     CreateMCState s;
 
-    /* Exported event callback pointers */
-    SMEDLCallback callback_new_mci;
-
-    /* Cleanup callback pointer */
-    int (*cleanup)(struct CreateMCMonitor *mon);
+    /* Callback table, or NULL to use the table shared by all CreateMC
+     * monitors */
+    CreateMCCallbacks *callbacks;
 
     /* Local event queue */
     EventQueue event_queue;
@@ -51,15 +72,23 @@ typedef struct CreateMCMonitor {
     //TODO mutex?
 } CreateMCMonitor;
 
+/* Shared callback registration function - Set the callback table used by all
+ * CreateMC monitors that have not registered callbacks of their own. The
+ * table is copied. */
+void registershared_CreateMC(const CreateMCCallbacks *callbacks);
+
 /* Callback registration functions - Set the export callback for an exported
- * event. Set to NULL to unregister a callback. */
-void register_CreateMC_new_mci(CreateMCMonitor *mon, SMEDLCallback cb_func);
+ * event on a single monitor. Set to NULL to unregister a callback. Return
+ * nonzero on success, zero on malloc failure. */
+int register_CreateMC_new_mci(CreateMCMonitor *mon, SMEDLCallback cb_func);
 
 /* Cleanup callback registration function - Set the callback for when the
  * monitor is ready to be recycled. The callback is responsible for calling
  * free_CreateMC_monitor(). It must accept the monitor pointer as a
- * parameter and return nonzero on success, zero on failure. */
-void registercleanup_CreateMC(CreateMCMonitor *mon, int (*cleanup_func)(CreateMCMonitor *mon));
+ * parameter and return nonzero on success, zero on failure.
+ * Like the callback registration functions, this affects a single monitor and
+ * returns nonzero on success, zero on malloc failure. */
+int registercleanup_CreateMC(CreateMCMonitor *mon, int (*cleanup_func)(CreateMCMonitor *mon));
 
 /* Event handling functions:
  *
@@ -90,7 +119,7 @@ int export_CreateMC_new_mci(CreateMCMonitor *mon, SMEDLValue *params, void *aux)
  * Return a pointer to the monitor. Must be freed with
  * free_CreateMC_monitor() when no longer needed.
  * Returns NULL on malloc failure. */
-CreateMCMonitor * init_CreateMC_monitor(SMEDLValue *identities);
+CreateMCMonitor * init_CreateMC_monitor(CreateMCIdentities *identities);
 
 /* Fill the provided CreateMCState
  * with the default initial values for the monitor. Note that strings and
@@ -110,10 +139,17 @@ int default_CreateMC_state(CreateMCState *state);
  * Return a pointer to the monitor. Must be freed with
  * free_CreateMC_monitor() when no longer needed.
  * Returns NULL on malloc failure. */
-CreateMCMonitor * init_CreateMC_with_state(SMEDLValue *identities, CreateMCState *init_state);
+CreateMCMonitor * init_CreateMC_with_state(CreateMCIdentities *identities, CreateMCState *init_state);
 
-/* Free a CreateMC monitor. NOTE: Does not free the identities. That must
- * be done by the caller, if necessary. */
+/* Free a CreateMC monitor */
 void free_CreateMC_monitor(CreateMCMonitor *mon);
 
+/* Snapshot functions (see snapshot.h) - snapshot_CreateMC_monitor() appends
+ * the monitor's scenario states and state variables to its record,
+ * CreateMC_SNAPSHOT_SIZE bytes. restore_CreateMC_monitor() gets them back into a
+ * monitor initialized with the same identities. */
+#define CreateMC_SNAPSHOT_SIZE (SMEDL_SNAPSHOT_STATE)
+void snapshot_CreateMC_monitor(CreateMCMonitor *mon, SMEDLSnapshotWriter *w);
+void restore_CreateMC_monitor(CreateMCMonitor *mon, SMEDLSnapshot *snap);
+
 #endif /* CreateMC_MON_H */
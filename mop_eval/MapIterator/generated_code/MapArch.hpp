@@ -0,0 +1,104 @@
+#ifndef MapArch_HPP
+#define MapArch_HPP
+
+#include "smedl.hpp"
+
+extern "C" {
+#include "sync_global_wrapper.h"
+}
+
+/* C++ interface to the sync synchronous set (see smedl.hpp). Link against
+ * libMapArch.a. */
+
+namespace smedl::MapArch {
+
+/* Owns the global wrapper */
+using System = Syncset<init_sync_syncset, free_sync_syncset>;
+
+/* Import channels */
+enum class Channel {
+    ch1,
+    ch2,
+    ch4,
+    ch5,
+};
+
+inline constexpr Channel ch1 = Channel::ch1;
+inline constexpr Channel ch2 = Channel::ch2;
+inline constexpr Channel ch4 = Channel::ch4;
+inline constexpr Channel ch5 = Channel::ch5;
+
+template <Channel C>
+struct ChannelTraits;
+
+template <>
+struct ChannelTraits<Channel::ch1> {
+    using Params = std::tuple<void *, void *>;
+    static constexpr auto import = import_sync_ch1;
+};
+
+template <>
+struct ChannelTraits<Channel::ch2> {
+    using Params = std::tuple<void *, void *>;
+    static constexpr auto import = import_sync_ch2;
+};
+
+template <>
+struct ChannelTraits<Channel::ch4> {
+    using Params = std::tuple<void *>;
+    static constexpr auto import = import_sync_ch4;
+};
+
+template <>
+struct ChannelTraits<Channel::ch5> {
+    using Params = std::tuple<void *>;
+    static constexpr auto import = import_sync_ch5;
+};
+
+/* Import an event on channel C. Return true on success, false on failure. */
+template <Channel C, typename... Args>
+inline bool emit(Args &&...args) {
+    return emit_on<ChannelTraits<C>>(std::forward<Args>(args)...);
+}
+
+/* Events exported to the environment */
+enum class Export {
+    CreateMCI_violation,
+};
+
+inline constexpr Export CreateMCI_violation = Export::CreateMCI_violation;
+
+template <Export E>
+struct ExportTraits;
+
+template <>
+struct ExportTraits<Export::CreateMCI_violation> {
+    using Identities = std::tuple<void *, void *, void *>;
+    using Params = std::tuple<>;
+    static constexpr auto connect = callback_sync_CreateMCI_violation;
+};
+
+/* Set the handler for exported event E, or unregister it with an empty
+ * handler */
+template <Export E>
+inline void on(typename detail::Export<ExportTraits<E>>::Handler handler) {
+    on_export<ExportTraits<E>>(std::move(handler));
+}
+
+/* Set the handler for exported event E when exported by the monitor with the
+ * given identities, or unregister it with an empty handler */
+template <Export E>
+inline void on(typename detail::Export<ExportTraits<E>>::Handlers::Key key,
+        typename detail::Export<ExportTraits<E>>::Handler handler) {
+    on_export<ExportTraits<E>>(std::move(key), std::move(handler));
+}
+
+/* Maps keyed by the identities of each monitor */
+template <typename T>
+using CreateMCMap = MonitorMap<T, void *, void *>;
+template <typename T>
+using CreateMCIMap = MonitorMap<T, void *, void *, void *>;
+
+} /* namespace smedl::MapArch */
+
+#endif /* MapArch_HPP */
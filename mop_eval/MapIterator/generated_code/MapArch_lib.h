@@ -0,0 +1,80 @@
+#ifndef MapArch_LIB_H
+#define MapArch_LIB_H
+
+#include "smedl_types.h"
+#include "event_ring.h"
+
+/* In-process library interface - Link the target program against libMapArch.a
+ * (with -pthread) and call the emit functions below at the instrumentation
+ * points. Emitting only writes a record into the calling thread's ring; a
+ * monitor thread started by init_MapArch_lib() merges the rings in timestamp
+ * order and imports the events into the global wrappers.
+ *
+ * Events exported to the target system are delivered to the callbacks
+ * registered through the global wrapper's callback interface (e.g.
+ * callback_sync_CreateMCI_violation()). They are called on the monitor
+ * thread. */
+
+/* Library channel enum */
+typedef enum {
+    LIBCHANNEL_ch1,
+    LIBCHANNEL_ch2,
+    LIBCHANNEL_ch4,
+    LIBCHANNEL_ch5,
+} LibChannelID;
+
+/* Initialize the global wrappers and start the monitor thread. Must be called
+ * once before emitting any events. Register export callbacks after this.
+ * Return nonzero on success, zero on failure. */
+int init_MapArch_lib();
+
+/* Stop the monitor thread once every event emitted so far has been processed,
+ * then free the rings and the global wrappers. No thread may emit events
+ * during or after this call. */
+void free_MapArch_lib();
+
+/* Emit functions - One per channel from the target system. Do not block unless
+ * the calling thread's ring is full. */
+static inline void smedl_emit_ch1(void *p0, void *p1) {
+    SMEDLRecord *rec = smedl_ring_reserve();
+    if (rec == NULL) {
+        return;
+    }
+    rec->channel = LIBCHANNEL_ch1;
+    rec->params[0].p = p0;
+    rec->params[1].p = p1;
+    smedl_ring_commit(rec);
+}
+
+static inline void smedl_emit_ch2(void *p0, void *p1) {
+    SMEDLRecord *rec = smedl_ring_reserve();
+    if (rec == NULL) {
+        return;
+    }
+    rec->channel = LIBCHANNEL_ch2;
+    rec->params[0].p = p0;
+    rec->params[1].p = p1;
+    smedl_ring_commit(rec);
+}
+
+static inline void smedl_emit_ch4(void *p0) {
+    SMEDLRecord *rec = smedl_ring_reserve();
+    if (rec == NULL) {
+        return;
+    }
+    rec->channel = LIBCHANNEL_ch4;
+    rec->params[0].p = p0;
+    smedl_ring_commit(rec);
+}
+
+static inline void smedl_emit_ch5(void *p0) {
+    SMEDLRecord *rec = smedl_ring_reserve();
+    if (rec == NULL) {
+        return;
+    }
+    rec->channel = LIBCHANNEL_ch5;
+    rec->params[0].p = p0;
+    smedl_ring_commit(rec);
+}
+
+#endif /* MapArch_LIB_H */
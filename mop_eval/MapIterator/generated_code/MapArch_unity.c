@@ -0,0 +1,75 @@
+/* Unity build of the MapArch system ("make unity"): all of its source files in
+ * one translation unit, so that the compiler can inline across them. The
+ * local wrappers call their monitor maps' hash and equals functions directly
+ * (see MONITORMAP_LOOKUP() in monitor_map.h), and the monitors call the global
+ * wrapper's export functions directly (see CALLBACKS() in the *_mon.c
+ * files). */
+
+/* The feature test macros of all the files, which must come before any
+ * system header */
+#define _GNU_SOURCE
+#define SMEDL_UNITY
+
+/* First, since it includes the implementation of jsmn.h, which the other files
+ * include (through json.h) for the declarations only */
+#include "json.c"
+#include "smedl_types.c"
+#include "event_queue.c"
+#include "monitor_map.c"
+#include "global_event_queue.c"
+#include "file.c"
+#include "trace_reader.c"
+#include "event_codec.c"
+#include "shm_ring.c"
+#include "server.c"
+#include "latency.c"
+#include "telemetry.c"
+#include "profile.c"
+#include "memstats.c"
+#include "snapshot.c"
+#include "spill.c"
+#include "MapArch_file.c"
+
+/* Called directly by the monitors' export functions */
+#include "sync_global_wrapper.h"
+
+/* The files of each monitor use the same names for their static variables
+ * and functions, so they are prefixed with the monitor's name */
+
+#define shared_callbacks CreateMCI_shared_callbacks
+#include "CreateMCI_mon.c"
+#undef shared_callbacks
+
+#define shared_callbacks CreateMC_shared_callbacks
+#include "CreateMC_mon.c"
+#undef shared_callbacks
+
+#define monitor_map_all CreateMCI_monitor_map_all
+#define dynamic_count CreateMCI_dynamic_count
+#define created_count CreateMCI_created_count
+#define recycled_count CreateMCI_recycled_count
+#define hash_all CreateMCI_hash_all
+#define equals_all CreateMCI_equals_all
+#include "CreateMCI_local_wrapper.c"
+#undef monitor_map_all
+#undef dynamic_count
+#undef created_count
+#undef recycled_count
+#undef hash_all
+#undef equals_all
+
+#define monitor_map_all CreateMC_monitor_map_all
+#define dynamic_count CreateMC_dynamic_count
+#define created_count CreateMC_created_count
+#define recycled_count CreateMC_recycled_count
+#define hash_all CreateMC_hash_all
+#define equals_all CreateMC_equals_all
+#include "CreateMC_local_wrapper.c"
+#undef monitor_map_all
+#undef dynamic_count
+#undef created_count
+#undef recycled_count
+#undef hash_all
+#undef equals_all
+
+#include "sync_global_wrapper.c"
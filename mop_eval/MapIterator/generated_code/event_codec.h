@@ -0,0 +1,77 @@
+#ifndef EVENT_CODEC_H
+#define EVENT_CODEC_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "smedl_types.h"
+
+/* Binary event encoding shared by the shared-memory and socket transports.
+ *
+ * An event is the channel name followed by tagged params and optionally aux
+ * data, all in host byte order:
+ *
+ *     u8 name length, name bytes
+ *     'i' int | 'f' double | 'c' char | 'p' void *
+ *     | 's' u32 length, bytes, '\0'        (once per param, in order)
+ *     ['a' u32 length, JSON text]          (aux, optional)
+ *
+ * The format is self-describing, so a monitor checks every event against the
+ * channel it names just as it would a JSON message.
+ *
+ * Over a socket, events are sent in frames:
+ *
+ *     u32 frame length (not counting itself)
+ *     u16 event length, event bytes        (repeated to the end of the frame)
+ */
+
+/* An event being encoded into a caller-provided buffer */
+typedef struct {
+    unsigned char *buf;
+    size_t cap;
+    size_t len;
+    int overflow;
+} SMEDLEncoder;
+
+/* An event being decoded */
+typedef struct {
+    const unsigned char *data;
+    size_t len;
+    size_t off;
+    const char *channel;
+    size_t channel_len;
+} SMEDLDecoder;
+
+/* Start encoding an event on the named channel into buf, which holds cap
+ * bytes */
+void smedl_encode_init(SMEDLEncoder *e, void *buf, size_t cap,
+        const char *channel);
+
+/* Add a param to the event. Params must be added in order. */
+void smedl_encode_int(SMEDLEncoder *e, int i);
+void smedl_encode_float(SMEDLEncoder *e, double d);
+void smedl_encode_char(SMEDLEncoder *e, char c);
+void smedl_encode_string(SMEDLEncoder *e, const char *s);
+void smedl_encode_pointer(SMEDLEncoder *e, void *p);
+
+/* Attach aux data to the event. Must be valid JSON text and be added after
+ * the last param. */
+void smedl_encode_aux(SMEDLEncoder *e, const char *json, size_t len);
+
+/* Start decoding the len-byte event at data. Return nonzero on success, zero
+ * if it does not even hold a channel name. */
+int smedl_decode_init(SMEDLDecoder *d, const void *data, size_t len);
+
+/* Convert the event's params to an array of SMEDLValue of the given types, and
+ * get its aux data (NULL if none). Strings point into the event data. Return
+ * nonzero on success, zero if the event does not have exactly those params. */
+int smedl_decode_params(SMEDLDecoder *d, const SMEDLType *types, size_t count,
+        SMEDLValue *params, const char **aux, size_t *aux_len);
+
+/* Start decoding the next event in a frame (without its length header),
+ * where *off is the offset of the event's length. Advance *off past it.
+ * Return 1 if there was an event, 0 at the end of the frame, -1 if the frame
+ * is malformed. */
+int smedl_frame_next(const void *frame, size_t len, size_t *off,
+        SMEDLDecoder *d);
+
+#endif /* EVENT_CODEC_H */
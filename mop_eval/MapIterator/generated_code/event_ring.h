@@ -0,0 +1,128 @@
+#ifndef EVENT_RING_H
+#define EVENT_RING_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "smedl_types.h"
+
+/* Per-thread event rings for the in-process library target.
+ *
+ * Each thread of the target program that emits events gets its own
+ * single-producer, single-consumer ring, created on its first emit. Emitting
+ * stamps a record with the TSC and publishes it with one release store; no
+ * locks are taken. The monitor thread drains all the rings with
+ * smedl_ring_merge(), which hands back records in timestamp order. When a
+ * thread exits, its ring is retired, and freed by smedl_ring_merge() once it
+ * has been drained.
+ *
+ * Records are only merged once they are older than a watermark sampled before
+ * the rings are scanned. Events that are ordered in the target program (one
+ * thread emits, then releases a lock or otherwise synchronizes with a thread
+ * that emits next) are therefore always delivered in that order. Concurrent
+ * events are delivered in the order of their timestamps as seen so far. */
+
+/* Maximum number of params in a record. Every channel emitted through the rings
+ * must have at most this many params. Must be the same in every translation
+ * unit. */
+#ifndef SMEDL_RECORD_PARAMS
+#define SMEDL_RECORD_PARAMS 2
+#endif
+
+/* Number of records in each thread's ring. Must be a power of two. */
+#ifndef SMEDL_RING_SIZE
+#define SMEDL_RING_SIZE 4096
+#endif
+
+/* A single param in a record. Strings and opaques are not supported: the
+ * record must be self-contained. */
+typedef union {
+    int i;
+    double d;
+    char c;
+    void *p;
+} SMEDLRecordValue;
+
+/* A compact binary event record */
+typedef struct {
+    uint64_t tsc;
+    int channel;
+    SMEDLRecordValue params[SMEDL_RECORD_PARAMS];
+} SMEDLRecord;
+
+/* A thread's ring. head and tail are free-running counters; each is written by
+ * one side only and kept on its own cache line. */
+typedef struct SMEDLRing {
+    size_t tail; /* Written by the emitting thread */
+    char pad_tail[64 - sizeof(size_t)];
+    size_t head; /* Written by the monitor thread */
+    char pad_head[64 - sizeof(size_t)];
+    struct SMEDLRing *next;
+    int state;   /* Who still needs the ring (see event_ring.c) */
+    SMEDLRecord records[SMEDL_RING_SIZE];
+} SMEDLRing;
+
+/* The calling thread's ring, or NULL before its first emit */
+extern __thread SMEDLRing *smedl_thread_ring;
+
+/* Create the calling thread's ring and register it with the monitor thread.
+ * Return the ring, or NULL if out of memory. */
+SMEDLRing * smedl_ring_attach(void);
+
+/* Wait until the ring has room for another record */
+void smedl_ring_wait(SMEDLRing *ring);
+
+/* Read CLOCK_MONOTONIC in nanoseconds. Used in place of the TSC where there is
+ * none. */
+uint64_t smedl_monotonic_ns(void);
+
+/* Read the TSC, fenced on both sides. The leading lfence keeps an event from
+ * being stamped before whatever synchronized it with an earlier event. The
+ * trailing one keeps later loads from running ahead of the read: the merge
+ * loads ring tails after taking its watermark, and a tail loaded before the
+ * watermark was read could miss a record stamped below it. */
+static inline uint64_t smedl_tsc(void) {
+#if defined(__x86_64__) || defined(__i386__)
+    uint32_t lo, hi;
+    __asm__ __volatile__ ("lfence\n\trdtsc\n\tlfence"
+            : "=a" (lo), "=d" (hi) :: "memory");
+    return ((uint64_t) hi << 32) | lo;
+#else
+    return smedl_monotonic_ns();
+#endif
+}
+
+/* Reserve the next record in the calling thread's ring. Return NULL if the
+ * ring could not be created. Fill in the channel and params, then call
+ * smedl_ring_commit(). */
+static inline SMEDLRecord * smedl_ring_reserve(void) {
+    SMEDLRing *ring = smedl_thread_ring;
+    if (__builtin_expect(ring == NULL, 0)) {
+        ring = smedl_ring_attach();
+        if (ring == NULL) {
+            return NULL;
+        }
+    }
+    if (__builtin_expect(ring->tail -
+                __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE) ==
+                SMEDL_RING_SIZE, 0)) {
+        smedl_ring_wait(ring);
+    }
+    return &ring->records[ring->tail & (SMEDL_RING_SIZE - 1)];
+}
+
+/* Stamp and publish the record returned by smedl_ring_reserve() */
+static inline void smedl_ring_commit(SMEDLRecord *rec) {
+    SMEDLRing *ring = smedl_thread_ring;
+    rec->tsc = smedl_tsc();
+    __atomic_store_n(&ring->tail, ring->tail + 1, __ATOMIC_RELEASE);
+}
+
+/* Copy up to max records out of the rings into out, oldest first, and return
+ * how many were copied. Only call from one thread at a time. */
+size_t smedl_ring_merge(SMEDLRecord *out, size_t max);
+
+/* Free every ring, or leave it for its thread to free on exit if the thread
+ * is still running. No thread may emit or merge afterward. */
+void smedl_ring_free_all(void);
+
+#endif /* EVENT_RING_H */
@@ -0,0 +1,123 @@
+#ifndef LATENCY_H
+#define LATENCY_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+/* Per-channel latency histograms for the stages of handling an event. Define
+ * SMEDL_LATENCY to enable them. Otherwise, the SMEDL_LATENCY_* macros below
+ * expand to nothing and nothing is timed.
+ *
+ * Stages are timed with the CPU timestamp counter where there is one (and with
+ * clock_gettime() elsewhere). Ticks are converted to nanoseconds with a rate
+ * that is calibrated against CLOCK_MONOTONIC at startup and recalibrated every
+ * SMEDL_LATENCY_CALIBRATE_INTERVAL events.
+ *
+ * Each histogram has log-linear buckets, like HdrHistogram: every power of two
+ * is split into 2^SMEDL_LATENCY_SUB_BITS buckets, so values are exact below
+ * 2^(SMEDL_LATENCY_SUB_BITS + 1) ns and within 1 part in
+ * 2^SMEDL_LATENCY_SUB_BITS above. Values from 2^SMEDL_LATENCY_MAX_BITS ns up
+ * are counted in the last bucket.
+ *
+ * The histograms are printed to stderr as one line of JSON at exit and
+ * whenever the process receives SIGUSR1 (checked between events):
+ * {"latency": {"ns_per_tick": 0.3125, "channels": {
+ *     "<channel>": {
+ *         "<stage>": {"count": 1000, "mean": 412.5, "p50": 380, "p90": 520,
+ *             "p99": 1630, "p99.9": 9984, "max": 21011},
+ *         ...
+ *     },
+ *     ...
+ * }}}
+ * Times are in nanoseconds. Only stages with events are listed. */
+
+#ifndef SMEDL_LATENCY_SUB_BITS
+#define SMEDL_LATENCY_SUB_BITS 6
+#endif
+
+#ifndef SMEDL_LATENCY_MAX_BITS
+#define SMEDL_LATENCY_MAX_BITS 40
+#endif
+
+#ifndef SMEDL_LATENCY_CALIBRATE_INTERVAL
+#define SMEDL_LATENCY_CALIBRATE_INTERVAL 65536
+#endif
+
+/* Stages of handling an event */
+typedef enum {
+    SMEDL_STAGE_PARSE,      /* Reading and converting the message */
+    SMEDL_STAGE_ENQUEUE,    /* Adding the event to the global queue */
+    SMEDL_STAGE_HANDLE,     /* Draining the queue (including writes) */
+    SMEDL_STAGE_WRITE,      /* Writing an event out of the system */
+    SMEDL_STAGES
+} SMEDLStage;
+
+/* Channel for a batch with events from more than one channel. Listed as
+ * "mixed". */
+#define SMEDL_CHANNEL_MIXED (-1)
+
+/* Start collecting histograms for the channels with the given names, indexed
+ * by system channel. The names must stay valid. Installs the SIGUSR1 handler
+ * and prints the histograms at exit. Return nonzero on success, zero on
+ * failure. */
+int smedl_latency_init(const char *const *channels, size_t count);
+
+/* Record a time in ticks for a stage on a channel. Does nothing before
+ * smedl_latency_init(). */
+void smedl_latency_record(int channel, SMEDLStage stage, uint64_t ticks);
+
+/* Record the time in ticks to handle a batch. It is counted for the channel
+ * of the events enqueued since the last batch, or for SMEDL_CHANNEL_MIXED if
+ * they came from more than one. */
+void smedl_latency_record_batch(uint64_t ticks);
+
+/* Stopwatch for the stages of the event currently being read. Start it before
+ * reading the event and lap it at the end of each stage. Time while it is
+ * paused (such as handling the previous batch) counts toward no stage. */
+void smedl_latency_start(void);
+void smedl_latency_pause(void);
+void smedl_latency_resume(void);
+void smedl_latency_lap(int channel, SMEDLStage stage);
+
+/* Call between events. Prints the histograms if SIGUSR1 was received and
+ * recalibrates the timestamp counter periodically. */
+void smedl_latency_poll(void);
+
+/* Print the histograms as one line of JSON */
+void smedl_latency_dump(FILE *f);
+
+/* Current time in ticks */
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+static inline uint64_t smedl_ticks(void) {
+    return __rdtsc();
+}
+#else
+uint64_t smedl_ticks(void);
+#endif
+
+#ifdef SMEDL_LATENCY
+#define SMEDL_LATENCY_START() smedl_latency_start()
+#define SMEDL_LATENCY_PAUSE() smedl_latency_pause()
+#define SMEDL_LATENCY_RESUME() smedl_latency_resume()
+#define SMEDL_LATENCY_LAP(channel, stage) smedl_latency_lap(channel, stage)
+#define SMEDL_LATENCY_POLL() smedl_latency_poll()
+/* Declare a timer t started now, and record the time since */
+#define SMEDL_LATENCY_TIMER(t) uint64_t t = smedl_ticks()
+#define SMEDL_LATENCY_RECORD(channel, stage, t) \
+    smedl_latency_record(channel, stage, smedl_ticks() - (t))
+#define SMEDL_LATENCY_RECORD_BATCH(t) \
+    smedl_latency_record_batch(smedl_ticks() - (t))
+#else
+#define SMEDL_LATENCY_START() ((void) 0)
+#define SMEDL_LATENCY_PAUSE() ((void) 0)
+#define SMEDL_LATENCY_RESUME() ((void) 0)
+#define SMEDL_LATENCY_LAP(channel, stage) ((void) 0)
+#define SMEDL_LATENCY_POLL() ((void) 0)
+#define SMEDL_LATENCY_TIMER(t)
+#define SMEDL_LATENCY_RECORD(channel, stage, t) ((void) 0)
+#define SMEDL_LATENCY_RECORD_BATCH(t) ((void) 0)
+#endif
+
+#endif /* LATENCY_H */
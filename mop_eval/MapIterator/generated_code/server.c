@@ -0,0 +1,492 @@
+#define _GNU_SOURCE
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/epoll.h>
+#include "file.h"
+#include "server.h"
+
+#define MAX_EVENTS 64
+
+/* A connected client */
+typedef struct Client {
+    int fd;
+    /* Bytes received but not processed yet. The frames start at in_off. */
+    unsigned char *in;
+    size_t in_off;
+    size_t in_len;
+    size_t in_cap;
+    /* Responses waiting to be sent. The unsent bytes start at out_off. */
+    unsigned char *out;
+    size_t out_off;
+    size_t out_len;
+    size_t out_cap;
+    uint32_t events;    /* epoll events registered for the socket */
+    int eof;            /* The client will send nothing more */
+    int throttled;      /* Not read until its responses drain */
+    int ready;          /* On the ready list */
+    struct Client *next_ready;
+    struct Client *prev, *next;
+} Client;
+
+typedef struct {
+    int epfd;
+    int listen_fd;
+    SMEDLFrameHandler handler;
+    /* All clients */
+    Client *clients;
+    /* Clients with a complete frame waiting, in the order they are served */
+    Client *ready_head;
+    Client *ready_tail;
+    /* Responses are written here, then copied to the client */
+    FILE *response;
+    char *response_buf;
+    size_t response_size;
+} Server;
+
+/* Length of the frame at the start of the client's unprocessed input, not
+ * counting the header, or SIZE_MAX if the header has not arrived yet */
+static size_t frame_len(Client *c) {
+    uint32_t len;
+    if (c->in_len - c->in_off < sizeof(len)) {
+        return SIZE_MAX;
+    }
+    memcpy(&len, c->in + c->in_off, sizeof(len));
+    return len;
+}
+
+/* Return nonzero if a complete frame is waiting to be processed */
+static int frame_ready(Client *c) {
+    size_t len = frame_len(c);
+    return len != SIZE_MAX && len <= c->in_len - c->in_off - sizeof(uint32_t);
+}
+
+static void push_ready(Server *s, Client *c) {
+    c->ready = 1;
+    c->next_ready = NULL;
+    if (s->ready_tail == NULL) {
+        s->ready_head = c;
+    } else {
+        s->ready_tail->next_ready = c;
+    }
+    s->ready_tail = c;
+}
+
+static Client * pop_ready(Server *s) {
+    Client *c = s->ready_head;
+    s->ready_head = c->next_ready;
+    if (s->ready_head == NULL) {
+        s->ready_tail = NULL;
+    }
+    c->ready = 0;
+    return c;
+}
+
+static void remove_ready(Server *s, Client *c) {
+    Client **link = &s->ready_head;
+    Client *prev = NULL;
+    while (*link != c) {
+        prev = *link;
+        link = &(*link)->next_ready;
+    }
+    *link = c->next_ready;
+    if (s->ready_tail == c) {
+        s->ready_tail = prev;
+    }
+    c->ready = 0;
+}
+
+/* Disconnect the client and free it */
+static void close_client(Server *s, Client *c) {
+    if (c->ready) {
+        remove_ready(s, c);
+    }
+    if (c->prev == NULL) {
+        s->clients = c->next;
+    } else {
+        c->prev->next = c->next;
+    }
+    if (c->next != NULL) {
+        c->next->prev = c->prev;
+    }
+    close(c->fd);
+    free(c->in);
+    free(c->out);
+    free(c);
+}
+
+/* Accept every pending connection */
+static void accept_clients(Server *s) {
+    for (;;) {
+        int fd = accept4(s->listen_fd, NULL, NULL,
+                SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0) {
+            if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+                err("Warning: Could not accept connection: %s",
+                        strerror(errno));
+            }
+            return;
+        }
+
+        Client *c = calloc(1, sizeof(Client));
+        if (c != NULL) {
+            c->in = malloc(SMEDL_SERVER_BUF_SIZE);
+            c->in_cap = SMEDL_SERVER_BUF_SIZE;
+        }
+        if (c == NULL || c->in == NULL) {
+            err("Warning: Out of memory, refusing connection");
+            free(c);
+            close(fd);
+            continue;
+        }
+        c->fd = fd;
+        c->events = EPOLLIN;
+        struct epoll_event ev = {.events = c->events, .data.ptr = c};
+        if (epoll_ctl(s->epfd, EPOLL_CTL_ADD, fd, &ev)) {
+            err("Warning: Could not watch connection: %s", strerror(errno));
+            free(c->in);
+            free(c);
+            close(fd);
+            continue;
+        }
+        c->next = s->clients;
+        if (s->clients != NULL) {
+            s->clients->prev = c;
+        }
+        s->clients = c;
+    }
+}
+
+/* Check the header of the next frame and make room in the input buffer for
+ * the whole frame. Return nonzero on success, zero if the client must be
+ * disconnected. */
+static int prepare_frame(Client *c) {
+    size_t len = frame_len(c);
+    if (len == SIZE_MAX) {
+        return 1;
+    }
+    if (len > SMEDL_SERVER_MAX_FRAME) {
+        err("Warning: Disconnecting client: Frame of %zu bytes is too large",
+                len);
+        return 0;
+    }
+    size_t needed = sizeof(uint32_t) + len;
+    if (needed > c->in_cap - c->in_off && c->in_off > 0) {
+        memmove(c->in, c->in + c->in_off, c->in_len - c->in_off);
+        c->in_len -= c->in_off;
+        c->in_off = 0;
+    }
+    if (needed > c->in_cap) {
+        unsigned char *tmp = realloc(c->in, needed);
+        if (tmp == NULL) {
+            err("Warning: Disconnecting client: Out of memory");
+            return 0;
+        }
+        c->in = tmp;
+        c->in_cap = needed;
+    }
+    return 1;
+}
+
+/* Receive what the client has sent, as far as there is room for it. Return
+ * nonzero on success, zero if the client must be disconnected. */
+static int read_client(Server *s, Client *c) {
+    /* Move the unprocessed bytes to the front of the buffer */
+    if (c->in_off > 0) {
+        memmove(c->in, c->in + c->in_off, c->in_len - c->in_off);
+        c->in_len -= c->in_off;
+        c->in_off = 0;
+    }
+    if (c->in_len == c->in_cap) {
+        return 1;
+    }
+
+    ssize_t n = recv(c->fd, c->in + c->in_len, c->in_cap - c->in_len, 0);
+    if (n > 0) {
+        c->in_len += n;
+    } else if (n == 0) {
+        c->eof = 1;
+    } else if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+        return 0;
+    }
+
+    if (!prepare_frame(c)) {
+        return 0;
+    }
+    if (!c->ready && frame_ready(c)) {
+        push_ready(s, c);
+    }
+    return 1;
+}
+
+/* Add len bytes to the client's responses. Return nonzero on success, zero if
+ * out of memory. */
+static int queue_output(Client *c, const void *data, size_t len) {
+    if (c->out_off == c->out_len) {
+        c->out_off = c->out_len = 0;
+    }
+    if (len > c->out_cap - c->out_len && c->out_off > 0) {
+        memmove(c->out, c->out + c->out_off, c->out_len - c->out_off);
+        c->out_len -= c->out_off;
+        c->out_off = 0;
+    }
+    if (len > c->out_cap - c->out_len) {
+        size_t cap = c->out_cap ? c->out_cap : SMEDL_SERVER_BUF_SIZE;
+        while (len > cap - c->out_len) {
+            cap *= 2;
+        }
+        unsigned char *tmp = realloc(c->out, cap);
+        if (tmp == NULL) {
+            return 0;
+        }
+        c->out = tmp;
+        c->out_cap = cap;
+    }
+    memcpy(c->out + c->out_len, data, len);
+    c->out_len += len;
+    return 1;
+}
+
+/* Send as much of the client's responses as the socket will take. Return
+ * nonzero on success, zero if the client must be disconnected. */
+static int flush_client(Client *c) {
+    while (c->out_off < c->out_len) {
+        ssize_t n = send(c->fd, c->out + c->out_off, c->out_len - c->out_off,
+                MSG_NOSIGNAL | MSG_DONTWAIT);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return errno == EAGAIN || errno == EWOULDBLOCK;
+        }
+        c->out_off += n;
+    }
+    return 1;
+}
+
+/* Process the next frame from the client and queue its response. Return
+ * nonzero on success, zero if the client must be disconnected. */
+static int process_frame(Server *s, Client *c) {
+    uint32_t len = frame_len(c);
+    const unsigned char *frame = c->in + c->in_off + sizeof(len);
+    c->in_off += sizeof(len) + len;
+
+    /* The response stream is rewound for each frame. Its length is the
+     * position it was written to. */
+    fseeko(s->response, 0, SEEK_SET);
+    int success = s->handler(frame, len, s->response);
+    fflush(s->response);
+    if (!success) {
+        err("Warning: Disconnecting client: Malformed frame");
+        return 0;
+    }
+    off_t pos = ftello(s->response);
+    uint32_t response_len = pos;
+    if (pos < 0 || !queue_output(c, &response_len, sizeof(response_len)) ||
+            !queue_output(c, s->response_buf, response_len)) {
+        err("Warning: Disconnecting client: Out of memory");
+        return 0;
+    }
+    return 1;
+}
+
+/* Register interest in the events the client is ready for. Return nonzero on
+ * success, zero if the client is finished or must be disconnected. */
+static int update_client(Server *s, Client *c) {
+    size_t pending = c->out_len - c->out_off;
+    if (pending >= SMEDL_SERVER_OUT_HIGH) {
+        c->throttled = 1;
+    } else if (pending < SMEDL_SERVER_OUT_LOW) {
+        c->throttled = 0;
+    }
+
+    if (c->eof && !c->ready && pending == 0) {
+        if (c->in_off < c->in_len) {
+            err("Warning: Client disconnected in the middle of a frame");
+        }
+        return 0;
+    }
+
+    uint32_t events = 0;
+    if (!c->eof && !c->throttled &&
+            (c->in_len < c->in_cap || c->in_off > 0)) {
+        events |= EPOLLIN;
+    }
+    if (pending > 0) {
+        events |= EPOLLOUT;
+    }
+    if (events != c->events) {
+        struct epoll_event ev = {.events = events, .data.ptr = c};
+        if (epoll_ctl(s->epfd, EPOLL_CTL_MOD, c->fd, &ev)) {
+            return 0;
+        }
+        c->events = events;
+    }
+    return 1;
+}
+
+/* Give each client with a complete frame waiting one turn */
+static void serve_ready(Server *s) {
+    Client *last = s->ready_tail;
+    while (s->ready_head != NULL) {
+        Client *c = pop_ready(s);
+        int ok = 1;
+        for (int i = 0; ok && i < SMEDL_SERVER_FRAMES_PER_TURN &&
+                frame_ready(c); i++) {
+            ok = process_frame(s, c);
+        }
+        ok = ok && prepare_frame(c) && flush_client(c);
+        if (ok && frame_ready(c)) {
+            push_ready(s, c);
+        }
+        if (!ok || !update_client(s, c)) {
+            close_client(s, c);
+        }
+        if (c == last) {
+            break;
+        }
+    }
+}
+
+/* Bind the listening socket to path, replacing a stale socket. Return the
+ * socket, or -1 on failure. */
+static int listen_socket(const char *path) {
+    struct sockaddr_un addr = {.sun_family = AF_UNIX};
+    if (strlen(path) >= sizeof(addr.sun_path)) {
+        err("Socket path too long: %s", path);
+        return -1;
+    }
+    strcpy(addr.sun_path, path);
+
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        err("Could not create socket: %s", strerror(errno));
+        return -1;
+    }
+    int bound = bind(fd, (struct sockaddr *) &addr, sizeof(addr)) == 0;
+    if (!bound && errno == EADDRINUSE) {
+        /* Only replace the socket if no server answers on it */
+        int probe = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        int stale = probe >= 0 && connect(probe, (struct sockaddr *) &addr,
+                sizeof(addr)) && errno == ECONNREFUSED;
+        if (probe >= 0) {
+            close(probe);
+        }
+        if (!stale) {
+            err("Another server is listening on %s", path);
+            close(fd);
+            return -1;
+        }
+        unlink(path);
+        bound = bind(fd, (struct sockaddr *) &addr, sizeof(addr)) == 0;
+    }
+    if (!bound) {
+        err("Could not bind %s: %s", path, strerror(errno));
+        close(fd);
+        return -1;
+    }
+    if (listen(fd, SOMAXCONN)) {
+        err("Could not listen on %s: %s", path, strerror(errno));
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+/* Listen on the Unix-domain socket at path and pass every frame received to
+ * handler until *stopping becomes nonzero. A stale socket left at path by a
+ * server that is no longer running is replaced. The socket is removed on
+ * return. Return nonzero on success, zero on failure. */
+int smedl_serve_socket(const char *path, SMEDLFrameHandler handler,
+        volatile sig_atomic_t *stopping) {
+    Server s = {.handler = handler};
+
+    s.response = open_memstream(&s.response_buf, &s.response_size);
+    if (s.response == NULL) {
+        err("Could not create response buffer");
+        return 0;
+    }
+    s.epfd = epoll_create1(EPOLL_CLOEXEC);
+    if (s.epfd < 0) {
+        err("Could not create epoll instance: %s", strerror(errno));
+        goto fail_epoll;
+    }
+    s.listen_fd = listen_socket(path);
+    if (s.listen_fd < 0) {
+        goto fail_listen;
+    }
+    struct epoll_event listen_ev = {.events = EPOLLIN, .data.ptr = NULL};
+    if (epoll_ctl(s.epfd, EPOLL_CTL_ADD, s.listen_fd, &listen_ev)) {
+        err("Could not watch socket: %s", strerror(errno));
+        goto fail_watch;
+    }
+    err("Listening on %s", path);
+
+    struct epoll_event events[MAX_EVENTS];
+    while (!*stopping) {
+        /* Wake up now and then to notice *stopping in case the signal came
+         * just before the wait */
+        int timeout = s.ready_head != NULL ? 0 : 1000;
+        int n = epoll_wait(s.epfd, events, MAX_EVENTS, timeout);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            err("Stopping: epoll_wait failed: %s", strerror(errno));
+            break;
+        }
+
+        for (int i = 0; i < n; i++) {
+            Client *c = events[i].data.ptr;
+            if (c == NULL) {
+                accept_clients(&s);
+                continue;
+            }
+            int ok = 1;
+            if (events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR) &&
+                    !c->eof && (c->events & EPOLLIN)) {
+                ok = read_client(&s, c);
+            }
+            if (ok && events[i].events & (EPOLLOUT | EPOLLERR)) {
+                ok = flush_client(c);
+            }
+            if (!ok || !update_client(&s, c)) {
+                close_client(&s, c);
+            }
+        }
+
+        serve_ready(&s);
+    }
+
+    /* Answer the frames already received before disconnecting */
+    while (s.ready_head != NULL) {
+        serve_ready(&s);
+    }
+    while (s.clients != NULL) {
+        flush_client(s.clients);
+        close_client(&s, s.clients);
+    }
+
+    unlink(path);
+    close(s.listen_fd);
+    close(s.epfd);
+    fclose(s.response);
+    free(s.response_buf);
+    return 1;
+
+fail_watch:
+    unlink(path);
+    close(s.listen_fd);
+fail_listen:
+    close(s.epfd);
+fail_epoll:
+    fclose(s.response);
+    free(s.response_buf);
+    return 0;
+}
@@ -0,0 +1,68 @@
+#ifndef SERVER_H
+#define SERVER_H
+
+#include <stddef.h>
+#include <stdio.h>
+#include <signal.h>
+
+/* Unix-domain socket server for long-running monitors.
+ *
+ * Any number of local clients connect to the socket and send frames of events
+ * in the encoding described in event_codec.h. One thread multiplexes all of
+ * them with epoll. Each frame is handed to the monitor as a batch, and the
+ * events it causes that leave the system are sent back to the client that
+ * sent the frame as a response frame:
+ *
+ *     u32 length (not counting itself), JSON text
+ *
+ * Every request frame gets exactly one response frame, possibly empty, in the
+ * order the requests were sent. All clients feed the same monitors.
+ *
+ * Backpressure is per client. A client's frames are read into a bounded
+ * buffer and processed a few at a time in turn with the other clients, and
+ * the server stops reading from the client while its buffer is full or while
+ * too many of its responses are waiting to be sent. The socket buffers then
+ * fill and the client's writes block (or fail with EAGAIN) until the monitor
+ * catches up, so a fast client cannot starve the others or grow the server's
+ * memory without bound. */
+
+/* Largest frame accepted, in bytes. A client that announces a larger one is
+ * disconnected. */
+#ifndef SMEDL_SERVER_MAX_FRAME
+#define SMEDL_SERVER_MAX_FRAME (1 << 20)
+#endif
+
+/* Initial size of each client's input buffer. It grows as needed to hold one
+ * frame. */
+#ifndef SMEDL_SERVER_BUF_SIZE
+#define SMEDL_SERVER_BUF_SIZE (64 * 1024)
+#endif
+
+/* Frames processed from one client before moving on to the next */
+#ifndef SMEDL_SERVER_FRAMES_PER_TURN
+#define SMEDL_SERVER_FRAMES_PER_TURN 16
+#endif
+
+/* Stop reading from a client once this many bytes of responses are waiting
+ * to be sent to it, and resume once fewer than SMEDL_SERVER_OUT_LOW are */
+#ifndef SMEDL_SERVER_OUT_HIGH
+#define SMEDL_SERVER_OUT_HIGH (1 << 20)
+#endif
+#ifndef SMEDL_SERVER_OUT_LOW
+#define SMEDL_SERVER_OUT_LOW (256 * 1024)
+#endif
+
+/* Process the len-byte frame (without its length header), writing the
+ * response to out. Return nonzero on success, zero if the frame is malformed,
+ * in which case the client is disconnected. */
+typedef int (*SMEDLFrameHandler)(const unsigned char *frame, size_t len,
+        FILE *out);
+
+/* Listen on the Unix-domain socket at path and pass every frame received to
+ * handler until *stopping becomes nonzero. A stale socket left at path by a
+ * server that is no longer running is replaced. The socket is removed on
+ * return. Return nonzero on success, zero on failure. */
+int smedl_serve_socket(const char *path, SMEDLFrameHandler handler,
+        volatile sig_atomic_t *stopping);
+
+#endif /* SERVER_H */
@@ -0,0 +1,445 @@
+#define _GNU_SOURCE
+#include <stdlib.h>
+#include <stdint.h>
+#include <errno.h>
+#include <limits.h>
+#include <time.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+#include "shm_ring.h"
+
+#define SHM_MAGIC UINT64_C(0x52485344454d53) /* "SMEDSHR" */
+#define SHM_VERSION 2
+#define SHM_MASK (SMEDL_SHM_CELLS - 1)
+
+/* Segment states. While it is being initialized, the state is SHM_INITIALIZING
+ * with the initializing process's ID above it, so that if that process dies,
+ * another can tell and take over. */
+#define SHM_NEW 0
+#define SHM_INITIALIZING 1
+#define SHM_READY 2
+#define SHM_INIT_STATE(pid) (SHM_INITIALIZING | (uint32_t) (pid) << 2)
+#define SHM_INIT_PID(state) ((pid_t) ((state) >> 2))
+
+/* A cell's claim word says who owns it in the current lap: the low 32 bits of
+ * the position it was claimed for, and the process ID of the producer that
+ * claimed it, or SHM_SKIPPED if the monitor took it instead. Producer and
+ * monitor both claim the cell with a compare-and-swap from the previous lap's
+ * value, so exactly one of them owns it, and only the owner writes to it. */
+#define SHM_SKIPPED 0
+#define SHM_CLAIM(pos, pid) \
+    ((uint64_t) (uint32_t) (pos) << 32 | (uint32_t) (pid))
+#define SHM_CLAIM_POS(claim) ((uint32_t) ((claim) >> 32))
+#define SHM_CLAIM_PID(claim) ((pid_t) (uint32_t) (claim))
+
+/* Process ID of this process, refreshed in the child after a fork so it need
+ * not be fetched for every event */
+static pid_t self_pid;
+static pthread_once_t self_pid_once = PTHREAD_ONCE_INIT;
+
+static void refresh_self_pid(void) {
+    self_pid = getpid();
+}
+
+static void init_self_pid(void) {
+    refresh_self_pid();
+    pthread_atfork(NULL, NULL, refresh_self_pid);
+}
+
+/* Futexes in the segment are shared between processes, so the private
+ * variants cannot be used */
+static int futex_wait(uint32_t *addr, uint32_t val, int timeout_ms) {
+    struct timespec ts = {timeout_ms / 1000, (timeout_ms % 1000) * 1000000L};
+    return syscall(SYS_futex, addr, FUTEX_WAIT, val, &ts, NULL, 0);
+}
+
+static void futex_wake(uint32_t *addr, int count) {
+    syscall(SYS_futex, addr, FUTEX_WAKE, count, NULL, NULL, 0);
+}
+
+/* Return nonzero if the process exists */
+static int process_alive(pid_t pid) {
+    return pid > 0 && (kill(pid, 0) == 0 || errno == EPERM);
+}
+
+/* Milliseconds on the monotonic clock */
+static uint64_t now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+/* Initialize a new segment, or one whose initializer died, and mark it
+ * ready */
+static void init_ring(SMEDLShmRing *ring) {
+    ring->magic = SHM_MAGIC;
+    ring->version = SHM_VERSION;
+    ring->cell_size = SMEDL_SHM_CELL_SIZE;
+    ring->cells = SMEDL_SHM_CELLS;
+    ring->enqueue_pos = 0;
+    ring->space_futex = 0;
+    ring->producers_waiting = 0;
+    ring->dropped = 0;
+    ring->dequeue_pos = 0;
+    ring->data_futex = 0;
+    ring->consumer_waiting = 0;
+    ring->consumer = 0;
+    for (uint64_t i = 0; i < SMEDL_SHM_CELLS; i++) {
+        ring->cell[i].seq = i;
+        /* As if claimed in the lap before the first */
+        ring->cell[i].claim = SHM_CLAIM(i - SMEDL_SHM_CELLS, SHM_SKIPPED);
+    }
+    __atomic_store_n(&ring->state, SHM_READY, __ATOMIC_RELEASE);
+}
+
+/* Open the named segment (e.g. "/auction"), creating and initializing it if it
+ * does not exist yet. Return nonzero on success, zero on failure (including a
+ * segment with a different layout). Cleanup with smedl_shm_close(). */
+int smedl_shm_open(SMEDLShm *shm, const char *name) {
+    pthread_once(&self_pid_once, init_self_pid);
+
+    int fd = shm_open(name, O_RDWR | O_CREAT, 0600);
+    if (fd < 0) {
+        return 0;
+    }
+    struct stat st;
+    if (fstat(fd, &st)) {
+        goto fail_fd;
+    }
+    shm->size = sizeof(SMEDLShmRing);
+    if (st.st_size == 0) {
+        if (ftruncate(fd, shm->size)) {
+            goto fail_fd;
+        }
+    } else if ((size_t) st.st_size != shm->size) {
+        goto fail_fd;
+    }
+    shm->ring = mmap(NULL, shm->size, PROT_READ | PROT_WRITE, MAP_SHARED, fd,
+            0);
+    if (shm->ring == MAP_FAILED) {
+        goto fail_fd;
+    }
+    close(fd);
+
+    /* The first process to get here initializes the ring. The rest wait for
+     * it to finish, or take over if it dies first. */
+    SMEDLShmRing *ring = shm->ring;
+    uint32_t state = SHM_NEW;
+    struct timespec ms = {0, 1000000};
+    for (int i = 0; i < 1000; i++) {
+        if (state == SHM_NEW || ((state & SHM_INITIALIZING) &&
+                    !process_alive(SHM_INIT_PID(state)))) {
+            if (__atomic_compare_exchange_n(&ring->state, &state,
+                        SHM_INIT_STATE(self_pid), 0, __ATOMIC_ACQUIRE,
+                        __ATOMIC_ACQUIRE)) {
+                init_ring(ring);
+                break;
+            }
+            continue;
+        }
+        if (state == SHM_READY) {
+            break;
+        }
+        nanosleep(&ms, NULL);
+        state = __atomic_load_n(&ring->state, __ATOMIC_ACQUIRE);
+    }
+
+    if (__atomic_load_n(&ring->state, __ATOMIC_ACQUIRE) != SHM_READY ||
+            ring->magic != SHM_MAGIC || ring->version != SHM_VERSION ||
+            ring->cell_size != SMEDL_SHM_CELL_SIZE ||
+            ring->cells != SMEDL_SHM_CELLS) {
+        munmap(shm->ring, shm->size);
+        return 0;
+    }
+    return 1;
+
+fail_fd:
+    close(fd);
+    return 0;
+}
+
+/* Unmap the segment. The segment itself remains. */
+void smedl_shm_close(SMEDLShm *shm) {
+    munmap(shm->ring, shm->size);
+}
+
+/* Remove the named segment. Return nonzero on success, zero on failure. */
+int smedl_shm_unlink(const char *name) {
+    return shm_unlink(name) == 0;
+}
+
+/* Wait for the monitor to release the cell at pos. Return nonzero once it may
+ * have, zero if no monitor is attached to release it. */
+static int wait_for_space(SMEDLShmRing *ring, SMEDLShmCell *cell,
+        uint64_t pos) {
+    if (!process_alive(__atomic_load_n(&ring->consumer, __ATOMIC_RELAXED))) {
+        return 0;
+    }
+    __atomic_add_fetch(&ring->producers_waiting, 1, __ATOMIC_SEQ_CST);
+    uint32_t seen = __atomic_load_n(&ring->space_futex, __ATOMIC_SEQ_CST);
+    if ((int64_t) (__atomic_load_n(&cell->seq, __ATOMIC_SEQ_CST) - pos) < 0) {
+        futex_wait(&ring->space_futex, seen, SMEDL_SHM_STALL_MS);
+    }
+    __atomic_sub_fetch(&ring->producers_waiting, 1, __ATOMIC_SEQ_CST);
+    return 1;
+}
+
+/* Claim a cell for an event on the named channel. If the ring is full, wait
+ * for the monitor to make room. Return nonzero on success, zero if the event
+ * had to be dropped because no monitor is attached. The params and aux
+ * functions and smedl_shm_commit() may still be called after a failure; they
+ * do nothing. */
+int smedl_shm_begin(SMEDLShm *shm, SMEDLShmWriter *w, const char *channel) {
+    SMEDLShmRing *ring = shm->ring;
+    w->shm = shm;
+    w->cell = NULL;
+    /* Nothing can be encoded until a cell is claimed */
+    smedl_encode_init(&w->enc, NULL, 0, "");
+
+    uint64_t pos = __atomic_load_n(&ring->enqueue_pos, __ATOMIC_RELAXED);
+    for (;;) {
+        SMEDLShmCell *cell = &ring->cell[pos & SHM_MASK];
+        int64_t dif = (int64_t) (__atomic_load_n(&cell->seq, __ATOMIC_ACQUIRE)
+                - pos);
+        if (dif == 0) {
+            if (__atomic_compare_exchange_n(&ring->enqueue_pos, &pos, pos + 1,
+                        1, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+                /* Claim the cell before writing anything to it, recording
+                 * the owner so the monitor can tell if it dies before
+                 * publishing. If the monitor took the cell first, take
+                 * another position. */
+                uint64_t prev = SHM_CLAIM(pos - SMEDL_SHM_CELLS, 0);
+                uint64_t claim = __atomic_load_n(&cell->claim,
+                        __ATOMIC_ACQUIRE);
+                if (SHM_CLAIM_POS(claim) == SHM_CLAIM_POS(prev) &&
+                        __atomic_compare_exchange_n(&cell->claim, &claim,
+                            SHM_CLAIM(pos, self_pid), 0, __ATOMIC_ACQ_REL,
+                            __ATOMIC_RELAXED)) {
+                    w->cell = cell;
+                    w->pos = pos;
+                    smedl_encode_init(&w->enc, cell->data, sizeof(cell->data),
+                            channel);
+                    return 1;
+                }
+                pos = __atomic_load_n(&ring->enqueue_pos, __ATOMIC_RELAXED);
+            }
+        } else if (dif < 0) {
+            /* Full */
+            if (!wait_for_space(ring, cell, pos)) {
+                __atomic_add_fetch(&ring->dropped, 1, __ATOMIC_RELAXED);
+                return 0;
+            }
+            pos = __atomic_load_n(&ring->enqueue_pos, __ATOMIC_RELAXED);
+        } else {
+            pos = __atomic_load_n(&ring->enqueue_pos, __ATOMIC_RELAXED);
+        }
+    }
+}
+
+/* Add a param to the event. Params must be added in order. */
+
+void smedl_shm_put_int(SMEDLShmWriter *w, int i) {
+    smedl_encode_int(&w->enc, i);
+}
+
+void smedl_shm_put_float(SMEDLShmWriter *w, double d) {
+    smedl_encode_float(&w->enc, d);
+}
+
+void smedl_shm_put_char(SMEDLShmWriter *w, char c) {
+    smedl_encode_char(&w->enc, c);
+}
+
+void smedl_shm_put_string(SMEDLShmWriter *w, const char *s) {
+    smedl_encode_string(&w->enc, s);
+}
+
+void smedl_shm_put_pointer(SMEDLShmWriter *w, void *p) {
+    smedl_encode_pointer(&w->enc, p);
+}
+
+/* Attach aux data to the event. Must be valid JSON text and be added after
+ * the last param. */
+void smedl_shm_put_aux(SMEDLShmWriter *w, const char *json, size_t len) {
+    smedl_encode_aux(&w->enc, json, len);
+}
+
+/* Publish the event. Return nonzero on success, zero if it was dropped (it
+ * did not fit in a cell, or smedl_shm_begin() failed). */
+int smedl_shm_commit(SMEDLShmWriter *w) {
+    if (w->cell == NULL) {
+        return 0;
+    }
+    SMEDLShmRing *ring = w->shm->ring;
+    int success = !w->enc.overflow;
+
+    /* An event that did not fit still has to give up its cell. It is
+     * published empty and the monitor skips it. The cell is ours until
+     * then: the monitor only skips cells whose owner is gone. */
+    w->cell->len = success ? w->enc.len : 0;
+    __atomic_store_n(&w->cell->seq, w->pos + 1, __ATOMIC_SEQ_CST);
+    if (!success) {
+        __atomic_add_fetch(&ring->dropped, 1, __ATOMIC_RELAXED);
+    }
+
+    if (__atomic_load_n(&ring->consumer_waiting, __ATOMIC_SEQ_CST)) {
+        __atomic_add_fetch(&ring->data_futex, 1, __ATOMIC_SEQ_CST);
+        futex_wake(&ring->data_futex, 1);
+    }
+    w->cell = NULL;
+    return success;
+}
+
+/* Attach as the segment's monitor. Return nonzero on success, zero if another
+ * live process is already attached. */
+int smedl_shm_serve(SMEDLShm *shm) {
+    SMEDLShmRing *ring = shm->ring;
+    int32_t current = __atomic_load_n(&ring->consumer, __ATOMIC_ACQUIRE);
+    do {
+        if (current != 0 && current != self_pid && process_alive(current)) {
+            return 0;
+        }
+    } while (!__atomic_compare_exchange_n(&ring->consumer, &current, self_pid,
+                0, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE));
+
+    /* A monitor that died between releasing a cell and moving past it left
+     * dequeue_pos one behind */
+    uint64_t pos = __atomic_load_n(&ring->dequeue_pos, __ATOMIC_ACQUIRE);
+    uint64_t seq = __atomic_load_n(&ring->cell[pos & SHM_MASK].seq,
+            __ATOMIC_ACQUIRE);
+    if ((int64_t) (seq - pos) > 1) {
+        __atomic_store_n(&ring->dequeue_pos, pos + 1, __ATOMIC_RELEASE);
+    }
+    shm->stall_since = 0;
+    return 1;
+}
+
+/* Detach as the segment's monitor */
+void smedl_shm_unserve(SMEDLShm *shm) {
+    SMEDLShmRing *ring = shm->ring;
+    int32_t self = self_pid;
+    __atomic_compare_exchange_n(&ring->consumer, &self, 0, 0,
+            __ATOMIC_RELEASE, __ATOMIC_RELAXED);
+
+    /* Let waiting producers see there is no one to wait for */
+    __atomic_add_fetch(&ring->space_futex, 1, __ATOMIC_SEQ_CST);
+    futex_wake(&ring->space_futex, INT_MAX);
+}
+
+/* Free the cell at pos for the producers' next lap and move past it */
+static void release_cell(SMEDLShmRing *ring, SMEDLShmCell *cell,
+        uint64_t pos) {
+    /* Released before moving past, so a monitor that dies in between can
+     * tell (see smedl_shm_serve()) */
+    __atomic_store_n(&cell->seq, pos + SMEDL_SHM_CELLS, __ATOMIC_SEQ_CST);
+    __atomic_store_n(&ring->dequeue_pos, pos + 1, __ATOMIC_RELEASE);
+    if (__atomic_load_n(&ring->producers_waiting, __ATOMIC_SEQ_CST)) {
+        __atomic_add_fetch(&ring->space_futex, 1, __ATOMIC_SEQ_CST);
+        futex_wake(&ring->space_futex, INT_MAX);
+    }
+}
+
+/* The cell at pos has been claimed but not published. Skip it if it has been
+ * that way too long and its producer is gone. Return nonzero if skipped. */
+static int skip_stalled(SMEDLShm *shm, SMEDLShmCell *cell, uint64_t pos) {
+    uint64_t now = now_ms();
+    if (shm->stall_since == 0 || shm->stall_pos != pos) {
+        shm->stall_pos = pos;
+        shm->stall_since = now;
+        return 0;
+    }
+    uint64_t stalled = now - shm->stall_since;
+    if (stalled < SMEDL_SHM_STALL_MS) {
+        return 0;
+    }
+
+    uint64_t claim = __atomic_load_n(&cell->claim, __ATOMIC_ACQUIRE);
+    if (SHM_CLAIM_POS(claim) == (uint32_t) pos) {
+        /* Claimed: skip it only once the owner is gone (or if a monitor
+         * that died had already taken it) */
+        if (SHM_CLAIM_PID(claim) != SHM_SKIPPED &&
+                process_alive(SHM_CLAIM_PID(claim))) {
+            return 0;
+        }
+    } else if (stalled < 10 * SMEDL_SHM_STALL_MS) {
+        /* The producer took the position but has not claimed the cell yet.
+         * It may have died, or be very slow to do so. */
+        return 0;
+    }
+
+    /* Take the cell. If the producer claims it first, wait for it. */
+    if (!__atomic_compare_exchange_n(&cell->claim, &claim,
+                SHM_CLAIM(pos, SHM_SKIPPED), 0, __ATOMIC_ACQ_REL,
+                __ATOMIC_RELAXED)) {
+        return 0;
+    }
+    __atomic_add_fetch(&shm->ring->dropped, 1, __ATOMIC_RELAXED);
+    release_cell(shm->ring, cell, pos);
+    shm->stall_since = 0;
+    return 1;
+}
+
+/* Get the next event, waiting up to timeout_ms milliseconds for one to be
+ * published (zero to not wait). Return nonzero and fill in r if there is one,
+ * zero if not (or if interrupted by a signal). Events that producers dropped
+ * are skipped. Release the event with smedl_shm_release() when done with it. */
+int smedl_shm_next(SMEDLShm *shm, SMEDLShmReader *r, int timeout_ms) {
+    SMEDLShmRing *ring = shm->ring;
+    uint64_t deadline = timeout_ms > 0 ? now_ms() + timeout_ms : 0;
+
+    for (;;) {
+        uint64_t pos = __atomic_load_n(&ring->dequeue_pos, __ATOMIC_RELAXED);
+        SMEDLShmCell *cell = &ring->cell[pos & SHM_MASK];
+        uint64_t seq = __atomic_load_n(&cell->seq, __ATOMIC_ACQUIRE);
+
+        if (seq == pos + 1) {
+            shm->stall_since = 0;
+            if (!smedl_decode_init(&r->dec, cell->data, cell->len)) {
+                /* Dropped by the producer */
+                release_cell(ring, cell, pos);
+                continue;
+            }
+            r->cell = cell;
+            return 1;
+        }
+        if (seq == pos &&
+                __atomic_load_n(&ring->enqueue_pos, __ATOMIC_RELAXED) > pos &&
+                skip_stalled(shm, cell, pos)) {
+            continue;
+        }
+
+        /* Nothing to read yet */
+        uint64_t now = now_ms();
+        if (now >= deadline) {
+            return 0;
+        }
+        uint64_t wait = deadline - now;
+        if (wait > SMEDL_SHM_STALL_MS) {
+            wait = SMEDL_SHM_STALL_MS;
+        }
+        __atomic_store_n(&ring->consumer_waiting, 1, __ATOMIC_SEQ_CST);
+        uint32_t seen = __atomic_load_n(&ring->data_futex, __ATOMIC_SEQ_CST);
+        int interrupted = 0;
+        if (__atomic_load_n(&cell->seq, __ATOMIC_SEQ_CST) != pos + 1) {
+            interrupted = futex_wait(&ring->data_futex, seen, wait) != 0 &&
+                errno == EINTR;
+        }
+        __atomic_store_n(&ring->consumer_waiting, 0, __ATOMIC_RELAXED);
+        if (interrupted) {
+            return 0;
+        }
+    }
+}
+
+/* Give the cell back to the producers */
+void smedl_shm_release(SMEDLShm *shm, SMEDLShmReader *r) {
+    SMEDLShmRing *ring = shm->ring;
+    release_cell(ring, r->cell,
+            __atomic_load_n(&ring->dequeue_pos, __ATOMIC_RELAXED));
+}
@@ -0,0 +1,734 @@
+#ifndef SMEDL_HPP
+#define SMEDL_HPP
+
+/* Header-only C++17 front-end to the generated C code. Each system has its own
+ * header (e.g. Auction.hpp) that declares its channels and exported events with
+ * their C++ types, so that events are emitted and received without building
+ * arrays of SMEDLValue by hand:
+ *
+ *     smedl::Auction::System system;
+ *     smedl::Auction::on<smedl::Auction::Auctionmonitor_alarm_low_bid>(
+ *         [](int item) { ... });
+ *     smedl::Auction::emit<smedl::Auction::ch2>(item, amount);
+ *
+ * Arguments are checked against the channel's parameters at compile time.
+ * Strings are passed to the monitors as pointers to the caller's own storage
+ * (std::string or const char *) for the duration of the call, without copies.
+ * Export handlers get the exporting monitor's identities, then the event's
+ * parameters; strings among them are std::string_view and only valid during
+ * the call.
+ *
+ * A handler can also be set for one monitor, by its identities:
+ *
+ *     smedl::Auction::on<smedl::Auction::Auctionmonitor_alarm_low_bid>(
+ *         {item}, [](int item) { ... });
+ *
+ * Such handlers are kept in a MonitorMap, a hash table keyed by identities
+ * whose hash and equality are generated for the exact identity types at
+ * compile time. Programs can use MonitorMap for their own per-monitor data
+ * too; each system's header has an alias for each monitor's identities.
+ *
+ * While a synchronous set exists, the C runtime allocates the monitor structs
+ * and monitor map nodes from a MonitorArena that it holds, instead of one by
+ * one from the heap.
+ *
+ * Everything else is still done by the C runtime, so a program using these
+ * headers is linked against the system's library ("make lib") and compiled
+ * with -std=c++17 or later. Like the C interfaces, they are not thread-safe. */
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <sys/mman.h>
+
+extern "C" {
+#include "smedl_types.h"
+#include "snapshot.h"
+}
+
+/* Address space reserved for the monitor arena. Memory is only committed as it
+ * is used. */
+#ifndef SMEDL_ARENA_RESERVE
+#define SMEDL_ARENA_RESERVE \
+    (sizeof(void *) >= 8 ? (std::size_t) 1 << 36 : (std::size_t) 1 << 28)
+#endif
+
+namespace smedl {
+
+/******************************************************************************
+ * Value conversion                                                           *
+ ******************************************************************************/
+
+/* Conversions between the C++ type of a SMEDL parameter or identity and
+ * SMEDLValue. make() builds the value from an argument and get() reads it
+ * back as the type handed to export handlers. */
+template <typename T>
+struct Value;
+
+template <>
+struct Value<int> {
+    using Arg = int;
+    static SMEDLValue make(int i) {
+        SMEDLValue v;
+        v.t = SMEDL_INT;
+        v.v.i = i;
+        return v;
+    }
+    static Arg get(const SMEDLValue &v) { return v.v.i; }
+};
+
+template <>
+struct Value<double> {
+    using Arg = double;
+    static SMEDLValue make(double d) {
+        SMEDLValue v;
+        v.t = SMEDL_FLOAT;
+        v.v.d = d;
+        return v;
+    }
+    static Arg get(const SMEDLValue &v) { return v.v.d; }
+};
+
+template <>
+struct Value<char> {
+    using Arg = char;
+    static SMEDLValue make(char c) {
+        SMEDLValue v;
+        v.t = SMEDL_CHAR;
+        v.v.c = c;
+        return v;
+    }
+    static Arg get(const SMEDLValue &v) { return v.v.c; }
+};
+
+/* The monitors copy strings they keep, so the value only borrows the
+ * caller's. std::string_view is not accepted since it need not be
+ * null-terminated. */
+template <>
+struct Value<std::string> {
+    using Arg = std::string_view;
+    static SMEDLValue make(const std::string &s) { return make(s.c_str()); }
+    static SMEDLValue make(const char *s) {
+        SMEDLValue v;
+        v.t = SMEDL_STRING;
+        v.v.s = const_cast<char *>(s);
+        return v;
+    }
+    static SMEDLValue make(std::string_view s) = delete;
+    static Arg get(const SMEDLValue &v) { return v.v.s; }
+};
+
+template <>
+struct Value<void *> {
+    using Arg = void *;
+    static SMEDLValue make(const void *p) {
+        SMEDLValue v;
+        v.t = SMEDL_POINTER;
+        v.v.p = const_cast<void *>(p);
+        return v;
+    }
+    static Arg get(const SMEDLValue &v) { return v.v.p; }
+};
+
+/******************************************************************************
+ * Monitor arena                                                              *
+ ******************************************************************************/
+
+/* Storage for the C runtime's monitor structs and monitor map nodes (see
+ * SMEDLArena in snapshot.h). Address space is reserved up front, and committed
+ * a run of RunSize bytes at a time. Each run holds blocks of one size, a
+ * multiple of Granule up to MaxBlock, and freed blocks are reused for later
+ * ones of the same size. Larger blocks, and any once the reservation is used
+ * up, come from the heap as before. All the memory is released at once when
+ * the arena is destroyed.
+ *
+ * Only one arena can be installed at a time. Each Syncset holds the shared one,
+ * so it is created with the first synchronous set and destroyed once the last
+ * one has freed its monitors. */
+class MonitorArena {
+public:
+    static constexpr std::size_t Granule = 16;
+    static constexpr std::size_t MaxBlock = 1024;
+    static constexpr std::size_t RunSize = 64 * 1024;
+
+    /* Return the installed arena, creating and installing it if there is none.
+     * Throws std::bad_alloc if the address space cannot be reserved. */
+    static std::shared_ptr<MonitorArena> shared() {
+        static std::weak_ptr<MonitorArena> installed;
+        std::shared_ptr<MonitorArena> arena = installed.lock();
+        if (arena == nullptr) {
+            arena.reset(new MonitorArena(SMEDL_ARENA_RESERVE));
+            installed = arena;
+        }
+        return arena;
+    }
+
+    ~MonitorArena() {
+        smedl_arena = NULL;
+        current_ = nullptr;
+        munmap(base_, arena_.size);
+    }
+    MonitorArena(const MonitorArena &) = delete;
+    MonitorArena & operator=(const MonitorArena &) = delete;
+
+    /* Blocks in use */
+    std::size_t live() const { return live_; }
+
+    /* Bytes committed to runs */
+    std::size_t committed() const { return committed_; }
+
+private:
+    static constexpr std::size_t Classes = MaxBlock / Granule;
+    static_assert(Granule % alignof(std::max_align_t) == 0,
+            "blocks must be aligned for any type");
+
+    struct FreeBlock {
+        FreeBlock *next;
+    };
+
+    explicit MonitorArena(std::size_t reserve) {
+        reserve -= reserve % RunSize;
+        void *p = mmap(NULL, reserve, PROT_NONE,
+                MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+        if (p == MAP_FAILED) {
+            throw std::bad_alloc();
+        }
+        base_ = static_cast<unsigned char *>(p);
+        arena_.base = reinterpret_cast<uintptr_t>(p);
+        arena_.size = reserve;
+        arena_.alloc = arena_alloc;
+        arena_.free = arena_free;
+        current_ = this;
+        smedl_arena = &arena_;
+    }
+
+    /* Commit the next run for blocks of class c. The first Granule bytes of
+     * the run hold c. Return false if there is no room left. */
+    bool new_run(std::size_t c) {
+        if (arena_.size - committed_ < RunSize) {
+            return false;
+        }
+        unsigned char *run = base_ + committed_;
+        if (mprotect(run, RunSize, PROT_READ | PROT_WRITE) != 0) {
+            return false;
+        }
+        committed_ += RunSize;
+        run[0] = static_cast<unsigned char>(c);
+        next_[c] = run + Granule;
+        end_[c] = run + RunSize;
+        return true;
+    }
+
+    static void * arena_alloc(std::size_t size) {
+        MonitorArena *a = current_;
+        if (size > MaxBlock) {
+            return NULL;
+        }
+        std::size_t c = size == 0 ? 0 : (size - 1) / Granule;
+        FreeBlock *b = a->free_[c];
+        if (b != nullptr) {
+            a->free_[c] = b->next;
+            a->live_++;
+            return b;
+        }
+        std::size_t block_size = (c + 1) * Granule;
+        if (static_cast<std::size_t>(a->end_[c] - a->next_[c]) < block_size &&
+                !a->new_run(c)) {
+            return NULL;
+        }
+        void *p = a->next_[c];
+        a->next_[c] += block_size;
+        a->live_++;
+        return p;
+    }
+
+    static void arena_free(void *ptr) {
+        MonitorArena *a = current_;
+        std::size_t offset = static_cast<unsigned char *>(ptr) - a->base_;
+        std::size_t c = a->base_[offset - offset % RunSize];
+        FreeBlock *b = static_cast<FreeBlock *>(ptr);
+        b->next = a->free_[c];
+        a->free_[c] = b;
+        a->live_--;
+    }
+
+    static inline MonitorArena *current_;
+
+    SMEDLArena arena_;
+    unsigned char *base_;
+    std::size_t committed_ = 0;
+    std::size_t live_ = 0;
+    /* For each class, the free blocks and the unused part of its last run */
+    FreeBlock *free_[Classes] = {};
+    unsigned char *next_[Classes] = {};
+    unsigned char *end_[Classes] = {};
+};
+
+/******************************************************************************
+ * Monitor maps                                                               *
+ ******************************************************************************/
+
+namespace detail {
+
+/* The type an identity is looked up by: strings by std::string_view, so that
+ * lookups do not copy them */
+template <typename T>
+struct KeyOf {
+    using type = T;
+};
+
+template <>
+struct KeyOf<std::string> {
+    using type = std::string_view;
+};
+
+/* Hashing of identities, one value at a time. Everything but doubles and
+ * pointers hashes in constant expressions. */
+constexpr uint64_t hash_mix(uint64_t h, uint64_t v) {
+    h ^= v + UINT64_C(0x9e3779b97f4a7c15);
+    h ^= h >> 30;
+    h *= UINT64_C(0xbf58476d1ce4e5b9);
+    h ^= h >> 27;
+    h *= UINT64_C(0x94d049bb133111eb);
+    h ^= h >> 31;
+    return h;
+}
+
+constexpr uint64_t hash_one(uint64_t h, int i) {
+    return hash_mix(h, static_cast<uint32_t>(i));
+}
+
+constexpr uint64_t hash_one(uint64_t h, char c) {
+    return hash_mix(h, static_cast<unsigned char>(c));
+}
+
+/* FNV-1a over the characters, then mixed in with the length */
+constexpr uint64_t hash_one(uint64_t h, std::string_view str) {
+    uint64_t f = UINT64_C(0xcbf29ce484222325);
+    for (char c : str) {
+        f = (f ^ static_cast<unsigned char>(c)) * UINT64_C(0x100000001b3);
+    }
+    return hash_mix(hash_mix(h, f), str.size());
+}
+
+inline uint64_t hash_one(uint64_t h, double d) {
+    /* Equal values must hash the same, and 0.0 == -0.0 */
+    if (d == 0.0) {
+        d = 0.0;
+    }
+    uint64_t bits;
+    std::memcpy(&bits, &d, sizeof(bits));
+    return hash_mix(h, bits);
+}
+
+inline uint64_t hash_one(uint64_t h, void *p) {
+    return hash_mix(h, reinterpret_cast<uintptr_t>(p));
+}
+
+/* Hash and equality of a tuple of identities, composed for its exact types */
+template <typename KeyView>
+struct IdentityTraits;
+
+template <typename... Keys>
+struct IdentityTraits<std::tuple<Keys...>> {
+    using KeyView = std::tuple<Keys...>;
+
+    template <std::size_t... I>
+    static constexpr uint64_t hash(const KeyView &k,
+            std::index_sequence<I...>) {
+        uint64_t h = sizeof...(Keys);
+        ((h = hash_one(h, std::get<I>(k))), ...);
+        return h;
+    }
+
+    static constexpr uint64_t hash(const KeyView &k) {
+        return hash(k, std::index_sequence_for<Keys...>());
+    }
+
+    static constexpr bool equal(const KeyView &a, const KeyView &b) {
+        return a == b;
+    }
+};
+
+} /* namespace detail */
+
+/* A hash table of T keyed by identities of the types Ids..., like the monitor
+ * maps of the C runtime: open addressing with Robin Hood hashing, doubling when
+ * 3/4 full. Its hash and equality are composed for the exact identity types at
+ * compile time (see detail::IdentityTraits), so lookups do not go through
+ * SMEDLValue or function pointers.
+ *
+ * Identities may be given as anything convertible to their types. Lookups
+ * never copy strings; inserting stores the identities in the entry, moving
+ * strings given as rvalue std::string. Entries never move, so pointers to
+ * values stay valid until they are erased. */
+template <typename T, typename... Ids>
+class MonitorMap {
+public:
+    using Key = std::tuple<Ids...>;
+    using KeyView = std::tuple<typename detail::KeyOf<Ids>::type...>;
+
+private:
+    using Traits = detail::IdentityTraits<KeyView>;
+
+    struct Entry {
+        template <typename... Args>
+        Entry(Key &&k, Args &&...args)
+            : key(std::move(k)), value(std::forward<Args>(args)...) {}
+
+        KeyView view() const {
+            return std::apply(
+                    [](const Ids &...ids) { return KeyView(ids...); }, key);
+        }
+
+        Key key;
+        T value;
+    };
+
+    /* dib is the distance from the entry's ideal slot plus one, or 0 for an
+     * empty slot */
+    struct Slot {
+        Entry *entry;
+        uint64_t hash;
+        std::size_t dib;
+    };
+
+    static constexpr std::size_t InitialCapacity = 16;
+
+public:
+    MonitorMap() = default;
+    MonitorMap(const MonitorMap &) = delete;
+    MonitorMap & operator=(const MonitorMap &) = delete;
+    MonitorMap(MonitorMap &&other) noexcept
+        : table_(std::move(other.table_)),
+          capacity_(std::exchange(other.capacity_, 0)),
+          count_(std::exchange(other.count_, 0)) {}
+    MonitorMap & operator=(MonitorMap &&other) noexcept {
+        if (this != &other) {
+            clear();
+            table_ = std::move(other.table_);
+            capacity_ = std::exchange(other.capacity_, 0);
+            count_ = std::exchange(other.count_, 0);
+        }
+        return *this;
+    }
+    ~MonitorMap() { clear(); }
+
+    /* Return the value for the identities, or nullptr if there is none */
+    template <typename... Args>
+    T * find(const Args &...ids) {
+        static_assert(sizeof...(Args) == sizeof...(Ids),
+                "wrong number of identities for map");
+        Slot *slot = lookup(KeyView(ids...));
+        return slot != nullptr ? &slot->entry->value : nullptr;
+    }
+
+    /* Return the value for the identities, inserting a default-constructed
+     * one if there is none. Throws std::bad_alloc if there is no memory. */
+    template <typename... Args>
+    T & get(Args &&...ids) {
+        return *try_emplace(Key(std::forward<Args>(ids)...)).first;
+    }
+
+    /* Insert a value constructed from args for the identities in key,
+     * unless there is one already. Return the value and whether it was
+     * inserted. Throws std::bad_alloc if there is no memory. */
+    template <typename... Args>
+    std::pair<T *, bool> try_emplace(Key key, Args &&...args) {
+        KeyView k = std::apply(
+                [](const Ids &...ids) { return KeyView(ids...); }, key);
+        Slot *slot = lookup(k);
+        if (slot != nullptr) {
+            return {&slot->entry->value, false};
+        }
+        if (count_ >= capacity_ / 4 * 3) {
+            grow();
+        }
+        uint64_t hash = Traits::hash(k);
+        Entry *e = new Entry(std::move(key), std::forward<Args>(args)...);
+        place(Slot{e, hash, 1});
+        count_++;
+        return {&e->value, true};
+    }
+
+    /* Remove the value for the identities. Return whether there was one. */
+    template <typename... Args>
+    bool erase(const Args &...ids) {
+        static_assert(sizeof...(Args) == sizeof...(Ids),
+                "wrong number of identities for map");
+        Slot *slot = lookup(KeyView(ids...));
+        if (slot == nullptr) {
+            return false;
+        }
+        delete slot->entry;
+        count_--;
+
+        /* Backward shift: move each following entry that is not in its ideal
+         * slot back by one */
+        std::size_t mask = capacity_ - 1;
+        std::size_t i = slot - table_.get();
+        std::size_t next = (i + 1) & mask;
+        while (table_[next].dib > 1) {
+            table_[i] = table_[next];
+            table_[i].dib--;
+            i = next;
+            next = (next + 1) & mask;
+        }
+        table_[i] = Slot{nullptr, 0, 0};
+        return true;
+    }
+
+    /* Call f(key, value) for every entry, in no particular order. f must not
+     * insert or erase entries. */
+    template <typename F>
+    void for_each(F &&f) {
+        for (std::size_t i = 0; i < capacity_; i++) {
+            if (table_[i].dib != 0) {
+                Entry *e = table_[i].entry;
+                f(static_cast<const Key &>(e->key), e->value);
+            }
+        }
+    }
+
+    std::size_t size() const { return count_; }
+
+    /* Remove every entry and free the table */
+    void clear() {
+        for (std::size_t i = 0; i < capacity_; i++) {
+            if (table_[i].dib != 0) {
+                delete table_[i].entry;
+            }
+        }
+        table_.reset();
+        capacity_ = 0;
+        count_ = 0;
+    }
+
+private:
+    Slot * lookup(const KeyView &k) {
+        if (count_ == 0) {
+            return nullptr;
+        }
+        uint64_t hash = Traits::hash(k);
+        std::size_t mask = capacity_ - 1;
+        std::size_t i = hash & mask;
+        for (std::size_t dib = 1; dib <= table_[i].dib; dib++) {
+            if (table_[i].hash == hash &&
+                    Traits::equal(table_[i].entry->view(), k)) {
+                return &table_[i];
+            }
+            i = (i + 1) & mask;
+        }
+        return nullptr;
+    }
+
+    /* Put a slot's entry in the table, displacing entries closer to their
+     * ideal slots. There must be room for it. */
+    void place(Slot s) {
+        std::size_t mask = capacity_ - 1;
+        std::size_t i = s.hash & mask;
+        while (table_[i].dib != 0) {
+            if (table_[i].dib < s.dib) {
+                std::swap(table_[i], s);
+            }
+            s.dib++;
+            i = (i + 1) & mask;
+        }
+        table_[i] = s;
+    }
+
+    void grow() {
+        std::size_t old_capacity = capacity_;
+        std::unique_ptr<Slot[]> old = std::move(table_);
+        capacity_ = old_capacity == 0 ? InitialCapacity : old_capacity * 2;
+        try {
+            table_.reset(new Slot[capacity_]());
+        } catch (...) {
+            table_ = std::move(old);
+            capacity_ = old_capacity;
+            throw;
+        }
+        for (std::size_t i = 0; i < old_capacity; i++) {
+            if (old[i].dib != 0) {
+                place(Slot{old[i].entry, old[i].hash, 1});
+            }
+        }
+    }
+
+    std::unique_ptr<Slot[]> table_;
+    std::size_t capacity_ = 0;
+    std::size_t count_ = 0;
+};
+
+/******************************************************************************
+ * Synchronous sets, import channels and exported events                      *
+ ******************************************************************************/
+
+/* Owns a synchronous set's global wrapper: initializes it on construction,
+ * throwing std::runtime_error if that fails, and frees it on destruction.
+ * Holds the shared MonitorArena while it exists. There must be only one at a
+ * time for each synchronous set. */
+template <int (*Init)(), void (*Free)()>
+class Syncset {
+public:
+    Syncset() : arena_(MonitorArena::shared()) {
+        if (!Init()) {
+            throw std::runtime_error("Could not initialize synchronous set");
+        }
+    }
+    ~Syncset() { Free(); }
+    Syncset(const Syncset &) = delete;
+    Syncset & operator=(const Syncset &) = delete;
+
+private:
+    std::shared_ptr<MonitorArena> arena_;
+};
+
+namespace detail {
+
+template <typename Params, std::size_t... I, typename... Args>
+bool import(int (*import_func)(SMEDLValue *, SMEDLValue *, void *),
+        std::index_sequence<I...>, Args &&...args) {
+    /* One more than needed, so that there is an array for no parameters */
+    SMEDLValue params[sizeof...(I) + 1] = {
+        Value<std::tuple_element_t<I, Params>>::make(
+                std::forward<Args>(args))...
+    };
+    return import_func(NULL, params, NULL) != 0;
+}
+
+template <typename Ids, typename Params>
+struct HandlerOf;
+
+template <typename... Ids, typename... Params>
+struct HandlerOf<std::tuple<Ids...>, std::tuple<Params...>> {
+    using type = std::function<void(typename Value<Ids>::Arg...,
+            typename Value<Params>::Arg...)>;
+};
+
+template <typename T, typename Ids>
+struct MapOf;
+
+template <typename T, typename... Ids>
+struct MapOf<T, std::tuple<Ids...>> {
+    using type = MonitorMap<T, Ids...>;
+};
+
+/* Holds the handlers for one exported event and the C callback that calls
+ * them: the handler for the exporting monitor if it has one, otherwise the
+ * handler for all monitors. The handlers must not let exceptions escape into
+ * the C code, so one thrown is reported to the global wrapper as a failure. */
+template <typename Traits>
+struct Export {
+    using Ids = typename Traits::Identities;
+    using Params = typename Traits::Params;
+    using Handler = typename HandlerOf<Ids, Params>::type;
+    using Handlers = typename MapOf<Handler, Ids>::type;
+
+    static inline Handler handler;
+    static inline Handlers monitor_handlers;
+
+    template <std::size_t... I>
+    static const Handler & handler_for(SMEDLValue *identities,
+            std::index_sequence<I...>) {
+        if (monitor_handlers.size() != 0) {
+            const Handler *h = monitor_handlers.find(
+                    Value<std::tuple_element_t<I, Ids>>::get(identities[I])...);
+            if (h != nullptr) {
+                return *h;
+            }
+        }
+        return handler;
+    }
+
+    template <std::size_t... I, std::size_t... J>
+    static void call(SMEDLValue *identities, SMEDLValue *params,
+            std::index_sequence<I...> ids, std::index_sequence<J...>) {
+        const Handler &h = handler_for(identities, ids);
+        if (h) {
+            h(Value<std::tuple_element_t<I, Ids>>::get(identities[I])...,
+                    Value<std::tuple_element_t<J, Params>>::get(params[J])...);
+        }
+    }
+
+    static int callback(SMEDLValue *identities, SMEDLValue *params,
+            void *) {
+        try {
+            call(identities, params,
+                    std::make_index_sequence<std::tuple_size_v<Ids>>(),
+                    std::make_index_sequence<std::tuple_size_v<Params>>());
+            return 1;
+        } catch (...) {
+            return 0;
+        }
+    }
+
+    /* Register the callback while there is any handler */
+    static void update() {
+        Traits::connect(handler || monitor_handlers.size() != 0 ?
+                &callback : nullptr);
+    }
+
+    static void connect(Handler h) {
+        handler = std::move(h);
+        update();
+    }
+
+    static void connect(typename Handlers::Key key, Handler h) {
+        if (h) {
+            *monitor_handlers.try_emplace(std::move(key)).first = std::move(h);
+        } else {
+            std::apply([](const auto &...ids) {
+                monitor_handlers.erase(ids...);
+            }, key);
+        }
+        update();
+    }
+};
+
+} /* namespace detail */
+
+/* Import an event on the channel described by Traits, which has the channel's
+ * parameter types (Params) and its import function (import). Return true on
+ * success, false on failure. */
+template <typename Traits, typename... Args>
+bool emit_on(Args &&...args) {
+    using Params = typename Traits::Params;
+    static_assert(sizeof...(Args) == std::tuple_size_v<Params>,
+            "wrong number of parameters for channel");
+    return detail::import<Params>(Traits::import,
+            std::make_index_sequence<sizeof...(Args)>(),
+            std::forward<Args>(args)...);
+}
+
+/* Set the handler for the exported event described by Traits, which has the
+ * types of the exporting monitor's identities (Identities) and the event's
+ * parameters (Params) and its callback registration function (connect). An
+ * empty handler unregisters it. */
+template <typename Traits>
+void on_export(typename detail::Export<Traits>::Handler handler) {
+    detail::Export<Traits>::connect(std::move(handler));
+}
+
+/* Set the handler for the exported event described by Traits when exported by
+ * the monitor with the identities in key, in place of the handler for all
+ * monitors. An empty handler unregisters it. It is kept until then, even if
+ * the monitor goes away. Throws std::bad_alloc if there is no memory. */
+template <typename Traits>
+void on_export(typename detail::Export<Traits>::Handlers::Key key,
+        typename detail::Export<Traits>::Handler handler) {
+    detail::Export<Traits>::connect(std::move(key), std::move(handler));
+}
+
+} /* namespace smedl */
+
+#endif /* SMEDL_HPP */
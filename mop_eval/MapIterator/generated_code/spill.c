@@ -0,0 +1,240 @@
+#define _GNU_SOURCE
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include "monitor_map.h"
+#include "spill.h"
+
+/* SPILL_MIN_CAPACITY *must* be a power of 2! */
+#define SPILL_MIN_CAPACITY 1024
+#define SPILL_GROW_THRESHOLD 0.75
+
+/* Header of each slot, followed by the key and the value */
+typedef struct SpillSlot {
+    uint32_t dib;   /* Slots probed to reach this one, plus one. 0 if empty. */
+    uint32_t hash;  /* Low bits of the key's hash */
+} SpillSlot;
+
+#define SPILL_SLOT(table, i, size) ((SpillSlot *) ((table) + (i) * (size)))
+#define SPILL_KEY(slot) ((unsigned char *) (slot) + sizeof(SpillSlot))
+#define SPILL_VALUE(spill, slot) ((unsigned char *) (slot) + (spill)->value_offset)
+
+#define SPILL_ALIGN(n) (((n) + 7) & ~(size_t) 7)
+
+static uint32_t spill_hash(const SMEDLSpill *spill, const void *key) {
+    murmur_state s = MURMUR_INIT(0);
+    murmur(key, spill->key_size, &s);
+    return (uint32_t) murmur_f(&s);
+}
+
+/* Create a new file for a table of the given capacity, named spill->path with a
+ * unique suffix, remove it again and map it. Return the mapping, or NULL on
+ * failure. */
+static unsigned char * spill_map(SMEDLSpill *spill, size_t capacity, int *fd) {
+    size_t size = capacity * spill->slot_size;
+    /* mkostemp() creates the file exclusively (never opening an existing file
+     * or following a symlink), so every table has a file of its own */
+    size_t len = strlen(spill->path);
+    char *name = malloc(len + sizeof(".XXXXXX"));
+    if (name == NULL) {
+        return NULL;
+    }
+    memcpy(name, spill->path, len);
+    memcpy(name + len, ".XXXXXX", sizeof(".XXXXXX"));
+    *fd = mkostemp(name, O_CLOEXEC);
+    if (*fd < 0) {
+        free(name);
+        return NULL;
+    }
+    unlink(name);
+    free(name);
+    /* The file starts out sparse and zero-filled, i.e. with every slot empty */
+    if (ftruncate(*fd, size) != 0) {
+        close(*fd);
+        return NULL;
+    }
+    void *table = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, *fd, 0);
+    if (table == MAP_FAILED) {
+        close(*fd);
+        return NULL;
+    }
+    return table;
+}
+
+/* Insert a whole slot into a table with the given mask, moving entries
+ * closer to their initial slots along the way. entry is the first slot of
+ * spill->scratch; both scratch slots are overwritten. */
+static void spill_insert(SMEDLSpill *spill, unsigned char *table, size_t mask,
+        SpillSlot *entry) {
+    SpillSlot *tmp = (SpillSlot *) ((unsigned char *) entry + spill->slot_size);
+    size_t i = entry->hash & mask;
+    entry->dib = 1;
+    for (;;) {
+        SpillSlot *slot = SPILL_SLOT(table, i, spill->slot_size);
+        if (slot->dib == 0) {
+            memcpy(slot, entry, spill->slot_size);
+            return;
+        }
+        if (slot->dib < entry->dib) {
+            memcpy(tmp, slot, spill->slot_size);
+            memcpy(slot, entry, spill->slot_size);
+            memcpy(entry, tmp, spill->slot_size);
+        }
+        i = (i + 1) & mask;
+        entry->dib++;
+    }
+}
+
+/* Double the capacity, moving the table to a new file. Return nonzero on
+ * success, zero on failure, in which case the table is unchanged. */
+static int spill_grow(SMEDLSpill *spill) {
+    size_t capacity = spill->capacity * 2;
+    int fd;
+    unsigned char *table = spill_map(spill, capacity, &fd);
+    if (table == NULL) {
+        return 0;
+    }
+    SpillSlot *entry = (SpillSlot *) spill->scratch;
+    for (size_t i = 0; i < spill->capacity; i++) {
+        SpillSlot *slot = SPILL_SLOT(spill->table, i, spill->slot_size);
+        if (slot->dib != 0) {
+            memcpy(entry, slot, spill->slot_size);
+            spill_insert(spill, table, capacity - 1, entry);
+        }
+    }
+
+    munmap(spill->table, spill->capacity * spill->slot_size);
+    close(spill->fd);
+    spill->fd = fd;
+    spill->table = table;
+    spill->capacity = capacity;
+    spill->mask = capacity - 1;
+    spill->grow_at = capacity * SPILL_GROW_THRESHOLD;
+    spill->scan = 0;
+    return 1;
+}
+
+int smedl_spill_open(SMEDLSpill *spill, const char *path, size_t key_size,
+        size_t value_size) {
+    spill->path = path;
+    spill->key_size = key_size;
+    spill->value_size = value_size;
+    spill->value_offset = SPILL_ALIGN(sizeof(SpillSlot) + key_size);
+    spill->slot_size = SPILL_ALIGN(spill->value_offset + value_size);
+    /* Zeroed so that the padding in slots is written as zeros */
+    spill->scratch = calloc(2, spill->slot_size);
+    if (spill->scratch == NULL) {
+        return 0;
+    }
+    spill->table = spill_map(spill, SPILL_MIN_CAPACITY, &spill->fd);
+    if (spill->table == NULL) {
+        free(spill->scratch);
+        return 0;
+    }
+    spill->capacity = SPILL_MIN_CAPACITY;
+    spill->mask = SPILL_MIN_CAPACITY - 1;
+    spill->count = 0;
+    spill->grow_at = SPILL_MIN_CAPACITY * SPILL_GROW_THRESHOLD;
+    spill->scan = 0;
+    return 1;
+}
+
+void smedl_spill_close(SMEDLSpill *spill) {
+    if (spill->table != NULL) {
+        munmap(spill->table, spill->capacity * spill->slot_size);
+        close(spill->fd);
+        free(spill->scratch);
+        spill->table = NULL;
+    }
+    spill->count = 0;
+}
+
+int smedl_spill_put(SMEDLSpill *spill, const void *key, const void *value) {
+    if (spill->count >= spill->grow_at && !spill_grow(spill)) {
+        return 0;
+    }
+    SpillSlot *entry = (SpillSlot *) spill->scratch;
+    entry->hash = spill_hash(spill, key);
+    memcpy(SPILL_KEY(entry), key, spill->key_size);
+    memcpy(SPILL_VALUE(spill, entry), value, spill->value_size);
+    spill_insert(spill, spill->table, spill->mask, entry);
+    spill->count++;
+    return 1;
+}
+
+void * smedl_spill_find(SMEDLSpill *spill, const void *key) {
+    if (spill->count == 0) {
+        return NULL;
+    }
+    uint32_t hash = spill_hash(spill, key);
+    size_t i = hash & spill->mask;
+    for (uint32_t dib = 1; ; dib++) {
+        SpillSlot *slot = SPILL_SLOT(spill->table, i, spill->slot_size);
+        if (slot->dib < dib) {
+            /* Empty, or the key would have displaced this entry */
+            return NULL;
+        }
+        if (slot->hash == hash &&
+                memcmp(SPILL_KEY(slot), key, spill->key_size) == 0) {
+            return SPILL_VALUE(spill, slot);
+        }
+        i = (i + 1) & spill->mask;
+    }
+}
+
+/* Remove the entry in slot i by shifting the entries after it back by one,
+ * up to the next empty slot or entry in its initial slot */
+static void spill_remove_at(SMEDLSpill *spill, size_t i) {
+    for (;;) {
+        SpillSlot *slot = SPILL_SLOT(spill->table, i, spill->slot_size);
+        size_t next_i = (i + 1) & spill->mask;
+        SpillSlot *next = SPILL_SLOT(spill->table, next_i, spill->slot_size);
+        if (next->dib <= 1) {
+            slot->dib = 0;
+            break;
+        }
+        memcpy(slot, next, spill->slot_size);
+        slot->dib--;
+        i = next_i;
+    }
+    spill->count--;
+}
+
+void smedl_spill_remove(SMEDLSpill *spill, void *value) {
+    size_t offset = (unsigned char *) value - spill->table;
+    spill_remove_at(spill, offset / spill->slot_size);
+}
+
+int smedl_spill_pop(SMEDLSpill *spill, void *key, void *value) {
+    if (spill->count == 0) {
+        return 0;
+    }
+    SpillSlot *slot = SPILL_SLOT(spill->table, spill->scan, spill->slot_size);
+    while (slot->dib == 0) {
+        spill->scan = (spill->scan + 1) & spill->mask;
+        slot = SPILL_SLOT(spill->table, spill->scan, spill->slot_size);
+    }
+    memcpy(key, SPILL_KEY(slot), spill->key_size);
+    memcpy(value, SPILL_VALUE(spill, slot), spill->value_size);
+    spill_remove_at(spill, spill->scan);
+    return 1;
+}
+
+int smedl_spill_next(const SMEDLSpill *spill, size_t *pos, const void **key,
+        const void **value) {
+    if (spill->count == 0) {
+        return 0;
+    }
+    for (; *pos < spill->capacity; (*pos)++) {
+        SpillSlot *slot = SPILL_SLOT(spill->table, *pos, spill->slot_size);
+        if (slot->dib != 0) {
+            *key = SPILL_KEY(slot);
+            *value = SPILL_VALUE(spill, slot);
+            (*pos)++;
+            return 1;
+        }
+    }
+    return 0;
+}
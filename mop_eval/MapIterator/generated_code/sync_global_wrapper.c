@@ -4,6 +4,7 @@
 #include <stdlib.h>
 #include "smedl_types.h"
 #include "global_event_queue.h"
+#include "profile.h"
 #include "sync_global_wrapper.h"
 #include "CreateMCI_local_wrapper.h"
 #include "CreateMC_local_wrapper.h"
@@ -43,6 +44,26 @@ void free_sync_syncset() {
     cb_CreateMCI_violation = NULL;
 }
 
+/* Snapshot interface - Write the monitors of every local wrapper to the
+ * snapshot (see snapshot.h). Return nonzero on success, zero on failure. */
+int snapshot_sync_syncset(SMEDLSnapshotWriter *w) {
+    return snapshot_CreateMC_monitors(w) &&
+        snapshot_CreateMCI_monitors(w);
+}
+
+/* Restore interfaces - Reserve room in the restore block for the monitors of
+ * every local wrapper in the snapshot, then restore them. Return nonzero on
+ * success, zero on failure. */
+int reserve_sync_syncset(SMEDLSnapshot *snap) {
+    return reserve_CreateMC_monitors(snap) &&
+        reserve_CreateMCI_monitors(snap);
+}
+
+int restore_sync_syncset(SMEDLSnapshot *snap) {
+    return restore_CreateMC_monitors(snap) &&
+        restore_CreateMCI_monitors(snap);
+}
+
 /* Intra routing function - Called by import interface functions and intra queue
  * processing function to route events to the local wrappers.
  * Return nonzero on success, zero on failure. */
@@ -50,44 +71,48 @@ int route_sync_ch1(SMEDLValue *identities, SMEDLValue *params, void *aux) {
     #if DEBUG >= 4
     fprintf(stderr, "Global wrapper 'sync' routing for conn 'ch1'\n");
     #endif
+    SMEDL_PROFILE_ROUTE("ch1");
     {
-        SMEDLValue new_identities[2] = {
-                params[0],
-                params[1],
-            };
+        SMEDLValue *new_identities = params;
 
         SMEDLValue *new_params = NULL;
 
         if (!process_CreateMC_new_mc(new_identities, new_params, aux)) {
             /* malloc fail */
+            SMEDL_PROFILE_POP();
             return 0;
         }
     }
+    SMEDL_PROFILE_POP();
+    return 1;
 }
 int route_sync_ch2(SMEDLValue *identities, SMEDLValue *params, void *aux) {
     #if DEBUG >= 4
     fprintf(stderr, "Global wrapper 'sync' routing for conn 'ch2'\n");
     #endif
+    SMEDL_PROFILE_ROUTE("ch2");
     {
         SMEDLValue new_identities[2] = {
                 {SMEDL_NULL},
                 params[0],
             };
 
-        SMEDLValue new_params[1] = {
-                params[1],
-            };
+        SMEDLValue *new_params = params + 1;
 
         if (!process_CreateMC_new_ci(new_identities, new_params, aux)) {
             /* malloc fail */
+            SMEDL_PROFILE_POP();
             return 0;
         }
     }
+    SMEDL_PROFILE_POP();
+    return 1;
 }
 int route_sync_ch4(SMEDLValue *identities, SMEDLValue *params, void *aux) {
     #if DEBUG >= 4
     fprintf(stderr, "Global wrapper 'sync' routing for conn 'ch4'\n");
     #endif
+    SMEDL_PROFILE_ROUTE("ch4");
     {
         SMEDLValue new_identities[3] = {
                 params[0],
@@ -99,14 +124,18 @@ int route_sync_ch4(SMEDLValue *identities, SMEDLValue *params, void *aux) {
 
         if (!process_CreateMCI_traverse_m(new_identities, new_params, aux)) {
             /* malloc fail */
+            SMEDL_PROFILE_POP();
             return 0;
         }
     }
+    SMEDL_PROFILE_POP();
+    return 1;
 }
 int route_sync_ch5(SMEDLValue *identities, SMEDLValue *params, void *aux) {
     #if DEBUG >= 4
     fprintf(stderr, "Global wrapper 'sync' routing for conn 'ch5'\n");
     #endif
+    SMEDL_PROFILE_ROUTE("ch5");
     {
         SMEDLValue new_identities[3] = {
                 {SMEDL_NULL},
@@ -118,14 +147,18 @@ int route_sync_ch5(SMEDLValue *identities, SMEDLValue *params, void *aux) {
 
         if (!process_CreateMCI_traverse_i(new_identities, new_params, aux)) {
             /* malloc fail */
+            SMEDL_PROFILE_POP();
             return 0;
         }
     }
+    SMEDL_PROFILE_POP();
+    return 1;
 }
 int route_sync_ch3(SMEDLValue *identities, SMEDLValue *params, void *aux) {
     #if DEBUG >= 4
     fprintf(stderr, "Global wrapper 'sync' routing for conn 'ch3'\n");
     #endif
+    SMEDL_PROFILE_ROUTE("ch3");
     {
         SMEDLValue new_identities[3] = {
                 identities[0],
@@ -137,9 +170,12 @@ int route_sync_ch3(SMEDLValue *identities, SMEDLValue *params, void *aux) {
 
         if (!process_CreateMCI_new_mci(new_identities, new_params, aux)) {
             /* malloc fail */
+            SMEDL_PROFILE_POP();
             return 0;
         }
     }
+    SMEDL_PROFILE_POP();
+    return 1;
 }
 
 /* Intra queue processing function - Route events to the local wrappers. Return
@@ -223,6 +259,7 @@ int raise_CreateMCI_violation(SMEDLValue *identities, SMEDLValue *params, void *
         smedl_free_array(params_inter, 0);
         return 0;
     }
+    return 1;
 }
 int raise_CreateMC_new_mci(SMEDLValue *identities, SMEDLValue *params, void *aux) {
     SMEDLValue *ids_copy = smedl_copy_array(identities, 2);
@@ -233,6 +270,7 @@ int raise_CreateMC_new_mci(SMEDLValue *identities, SMEDLValue *params, void *aux
         smedl_free_array(params_intra, 1);
         return 0;
     }
+    return 1;
 }
 
 /* Global wrapper import interface - Called by the environment (other
@@ -268,6 +306,29 @@ int import_sync_ch5(SMEDLValue *identities, SMEDLValue *params, void *aux) {
     return handle_sync_queues() && success;
 }
 
+/* Routing functions for the batch import interface, indexed by import
+ * channel */
+static const SMEDLCallback import_routes[] = {
+    [IMPORT_sync_ch1] = route_sync_ch1,
+    [IMPORT_sync_ch2] = route_sync_ch2,
+    [IMPORT_sync_ch4] = route_sync_ch4,
+    [IMPORT_sync_ch5] = route_sync_ch5,
+};
+
+int import_sync_batch(SMEDLImportEvent *events, size_t count) {
+    int success = 1;
+
+    for (size_t i = 0; i < count; i++) {
+        SMEDLImportEvent *ev = &events[i];
+        success = import_routes[ev->channel](ev->identities, ev->params,
+                ev->aux) && success;
+        /* Events raised within the synchronous set must be handled before
+         * the next import can observe their effects */
+        success = handle_sync_intra() && success;
+    }
+    return handle_sync_inter() && success;
+}
+
 /* Global wrapper callback interface - Used to register callback functions to be
  * called by this global wrapper when it has an event to export to the
  * environment (other synchronous sets, the target system).
@@ -2,6 +2,7 @@
 #define sync_GLOBAL_WRAPPER_H
 
 #include "smedl_types.h"
+#include "snapshot.h"
 
 /******************************************************************************
  * External Interface                                                         *
@@ -15,6 +16,17 @@ int init_sync_syncset();
  * wrapper and all the local wrappers and monitors it manages. */
 void free_sync_syncset();
 
+/* Snapshot interface - Write the monitors of every local wrapper to the
+ * snapshot (see snapshot.h). Return nonzero on success, zero on failure. */
+int snapshot_sync_syncset(SMEDLSnapshotWriter *w);
+
+/* Restore interfaces - Reserve room in the restore block for the monitors of
+ * every local wrapper in the snapshot, then restore them, between
+ * smedl_restore_begin() and smedl_restore_end() (see snapshot.h). Return
+ * nonzero on success, zero on failure. */
+int reserve_sync_syncset(SMEDLSnapshot *snap);
+int restore_sync_syncset(SMEDLSnapshot *snap);
+
 /* Global wrapper export interfaces - Called by monitors to place exported
  * events into the appropriate export queues, where they will later be routed to
  * the proper destinations inside and outside the synchronous set.
@@ -47,6 +59,29 @@ int import_sync_ch2(SMEDLValue *identities, SMEDLValue *params, void *aux);
 int import_sync_ch4(SMEDLValue *identities, SMEDLValue *params, void *aux);
 int import_sync_ch5(SMEDLValue *identities, SMEDLValue *params, void *aux);
 
+/* Import channels for the batch import interface */
+typedef enum {
+    IMPORT_sync_ch1,
+    IMPORT_sync_ch2,
+    IMPORT_sync_ch4,
+    IMPORT_sync_ch5,
+} syncImportID;
+
+/* Global wrapper batch import interface - Called by the environment to import
+ * several events with one call. Events are routed in order. Events exported to
+ * the environment are queued and the export callbacks are called once, after
+ * the last event is routed.
+ * Any events a routed event raises within this synchronous set are handled
+ * before the next event is routed, since they may affect it.
+ * Returns nonzero on success, zero on failure.
+ *
+ * Parameters:
+ * events - An array of events. Each channel is a value from the import channel
+ *   enum above. identities, params, and aux are as for the single-event import
+ *   functions.
+ * count - The number of events in the array */
+int import_sync_batch(SMEDLImportEvent *events, size_t count);
+
 /* Global wrapper callback interface - Used to register callback functions to be
  * called by this global wrapper when it has an event to export to the
  * environment (other synchronous sets, the target system).
@@ -0,0 +1,56 @@
+#ifndef TELEMETRY_H
+#define TELEMETRY_H
+
+#include <stddef.h>
+#include <stdio.h>
+#include "monitor_map.h"
+
+/* Periodic monitor-population telemetry.
+ *
+ * When built with SMEDL_STATS_INTERVAL defined (in milliseconds), the file
+ * adapters write one line of JSON to SMEDL_STATS_FILE at startup, every
+ * SMEDL_STATS_INTERVAL milliseconds after that (checked between events), and
+ * once more when they finish:
+ * {"ms": 1000, "messages": 52311, "rss_kb": 10240, "monitors": {
+ *     "<monitor>": {"live": 812, "dynamic": 9000, "created": 0,
+ *         "recycled": 8188, "maps": {
+ *             "all": {"capacity": 2048, "lists": 812, "instances": 812,
+ *                 "max_list": 1, "mean_list": 1.00, "max_dib": 4,
+ *                 "mean_dib": 1.31, "grows": 7, "shrinks": 0,
+ *                 "resize_ns": 81234, "max_resize_ns": 40110},
+ *             ...
+ *         }},
+ *     ...
+ * }}
+ * ms is the time since startup. rss_kb is the resident set size (null where
+ * it cannot be read). The monitor and map fields are those of MonitorStats
+ * and MonitorMapStats (see monitor_map.h). When built with SMEDL_MEMSTATS
+ * too, each line also has the memory report (see memstats.h) as "memory",
+ * after rss_kb. */
+
+#ifndef SMEDL_STATS_FILE
+#define SMEDL_STATS_FILE "smedl_stats.json"
+#endif
+
+/* Create (or truncate) the file at path and write the first line. Every line
+ * calls write_monitors, which must call smedl_stats_write_monitors() for each
+ * monitor type. Return nonzero on success, zero on failure. */
+int smedl_stats_open(const char *path, long interval_ms,
+        void (*write_monitors)(FILE *f));
+
+/* Write a line if the interval has passed since the last one. messages is the
+ * number of messages processed so far. Does nothing if the file is not
+ * open. */
+void smedl_stats_poll(size_t messages);
+
+/* Write a line now. Does nothing if the file is not open. */
+void smedl_stats_write(size_t messages);
+
+/* Write a final line and close the file */
+void smedl_stats_close(size_t messages);
+
+/* Write the stats of one monitor type as a member of the "monitors" object */
+void smedl_stats_write_monitors(FILE *f, const char *name,
+        const MonitorStats *stats);
+
+#endif /* TELEMETRY_H */
@@ -0,0 +1,147 @@
+#ifndef Auction_HPP
+#define Auction_HPP
+
+#include "smedl.hpp"
+
+extern "C" {
+#include "Auctionmonitor_global_wrapper.h"
+}
+
+/* C++ interface to the Auctionmonitor synchronous set (see smedl.hpp). Link against
+ * libAuction.a. */
+
+namespace smedl::Auction {
+
+/* Owns the global wrapper */
+using System = Syncset<init_Auctionmonitor_syncset, free_Auctionmonitor_syncset>;
+
+/* Import channels */
+enum class Channel {
+    ch1,
+    ch2,
+    ch3,
+    ch4,
+};
+
+inline constexpr Channel ch1 = Channel::ch1;
+inline constexpr Channel ch2 = Channel::ch2;
+inline constexpr Channel ch3 = Channel::ch3;
+inline constexpr Channel ch4 = Channel::ch4;
+
+template <Channel C>
+struct ChannelTraits;
+
+template <>
+struct ChannelTraits<Channel::ch1> {
+    using Params = std::tuple<int, int, int>;
+    static constexpr auto import = import_Auctionmonitor_ch1;
+};
+
+template <>
+struct ChannelTraits<Channel::ch2> {
+    using Params = std::tuple<int, int>;
+    static constexpr auto import = import_Auctionmonitor_ch2;
+};
+
+template <>
+struct ChannelTraits<Channel::ch3> {
+    using Params = std::tuple<int>;
+    static constexpr auto import = import_Auctionmonitor_ch3;
+};
+
+template <>
+struct ChannelTraits<Channel::ch4> {
+    using Params = std::tuple<>;
+    static constexpr auto import = import_Auctionmonitor_ch4;
+};
+
+/* Import an event on channel C. Return true on success, false on failure. */
+template <Channel C, typename... Args>
+inline bool emit(Args &&...args) {
+    return emit_on<ChannelTraits<C>>(std::forward<Args>(args)...);
+}
+
+/* Events exported to the environment */
+enum class Export {
+    Auctionmonitor_alarm_recreation,
+    Auctionmonitor_alarm_low_bid,
+    Auctionmonitor_alarm_sold_early,
+    Auctionmonitor_alarm_not_sold,
+    Auctionmonitor_alarm_action_after_end,
+    Auctionmonitor_alarm_action_before_start,
+};
+
+inline constexpr Export Auctionmonitor_alarm_recreation = Export::Auctionmonitor_alarm_recreation;
+inline constexpr Export Auctionmonitor_alarm_low_bid = Export::Auctionmonitor_alarm_low_bid;
+inline constexpr Export Auctionmonitor_alarm_sold_early = Export::Auctionmonitor_alarm_sold_early;
+inline constexpr Export Auctionmonitor_alarm_not_sold = Export::Auctionmonitor_alarm_not_sold;
+inline constexpr Export Auctionmonitor_alarm_action_after_end = Export::Auctionmonitor_alarm_action_after_end;
+inline constexpr Export Auctionmonitor_alarm_action_before_start = Export::Auctionmonitor_alarm_action_before_start;
+
+template <Export E>
+struct ExportTraits;
+
+template <>
+struct ExportTraits<Export::Auctionmonitor_alarm_recreation> {
+    using Identities = std::tuple<int>;
+    using Params = std::tuple<>;
+    static constexpr auto connect = callback_Auctionmonitor_Auctionmonitor_alarm_recreation;
+};
+
+template <>
+struct ExportTraits<Export::Auctionmonitor_alarm_low_bid> {
+    using Identities = std::tuple<int>;
+    using Params = std::tuple<>;
+    static constexpr auto connect = callback_Auctionmonitor_Auctionmonitor_alarm_low_bid;
+};
+
+template <>
+struct ExportTraits<Export::Auctionmonitor_alarm_sold_early> {
+    using Identities = std::tuple<int>;
+    using Params = std::tuple<>;
+    static constexpr auto connect = callback_Auctionmonitor_Auctionmonitor_alarm_sold_early;
+};
+
+template <>
+struct ExportTraits<Export::Auctionmonitor_alarm_not_sold> {
+    using Identities = std::tuple<int>;
+    using Params = std::tuple<>;
+    static constexpr auto connect = callback_Auctionmonitor_Auctionmonitor_alarm_not_sold;
+};
+
+template <>
+struct ExportTraits<Export::Auctionmonitor_alarm_action_after_end> {
+    using Identities = std::tuple<int>;
+    using Params = std::tuple<>;
+    static constexpr auto connect = callback_Auctionmonitor_Auctionmonitor_alarm_action_after_end;
+};
+
+template <>
+struct ExportTraits<Export::Auctionmonitor_alarm_action_before_start> {
+    using Identities = std::tuple<int>;
+    using Params = std::tuple<>;
+    static constexpr auto connect = callback_Auctionmonitor_Auctionmonitor_alarm_action_before_start;
+};
+
+/* Set the handler for exported event E, or unregister it with an empty
+ * handler */
+template <Export E>
+inline void on(typename detail::Export<ExportTraits<E>>::Handler handler) {
+    on_export<ExportTraits<E>>(std::move(handler));
+}
+
+/* Set the handler for exported event E when exported by the monitor with the
+ * given identities, or unregister it with an empty handler */
+template <Export E>
+inline void on(typename detail::Export<ExportTraits<E>>::Handlers::Key key,
+        typename detail::Export<ExportTraits<E>>::Handler handler) {
+    on_export<ExportTraits<E>>(std::move(key), std::move(handler));
+}
+
+/* Maps keyed by the identities of each monitor */
+template <typename T>
+using AuctionmonitorMap = MonitorMap<T, int>;
+
+} /* namespace smedl::Auction */
+
+#endif /* Auction_HPP */
@@ -1,64 +1,124 @@
+#ifdef SMEDL_PROGRESS_INTERVAL
+/* For clock_gettime() */
+#define _POSIX_C_SOURCE 200809L
+#endif
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
 #include <stdint.h>
 #include <inttypes.h>
 #include <errno.h>
+#include <signal.h>
 #include "global_event_queue.h"
 #include "file.h"
 #include "json.h"
+#include "event_codec.h"
+#include "shm_ring.h"
+#include "server.h"
+#include "latency.h"
+#include "profile.h"
+#include "memstats.h"
+#include "telemetry.h"
+#include "snapshot.h"
 #include "Auctionmonitor_global_wrapper.h"
 #include "Auction_file.h"
+#ifdef SMEDL_PROGRESS_INTERVAL
+#include <time.h>
+#endif
+#if defined(SMEDL_PROGRESS_INTERVAL) || defined(SMEDL_STATS_INTERVAL)
+#include "Auctionmonitor_local_wrapper.h"
+#endif
 
 static GlobalEventQueue queue = {0};
 
+/* Events popped off the queue for the Auctionmonitor syncset that have not been
+ * imported yet */
+static SMEDLImportEvent Auctionmonitor_batch[FILE_BATCH_SIZE];
+static SMEDLEvent *Auctionmonitor_batch_events[FILE_BATCH_SIZE];
+static size_t Auctionmonitor_batch_len;
+
+/* Import the pending events into the Auctionmonitor syncset with one call and free
+ * them. Return nonzero on success, zero on failure. */
+static int flush_Auctionmonitor_batch() {
+    int success = import_Auctionmonitor_batch(Auctionmonitor_batch, Auctionmonitor_batch_len);
+    for (size_t i = 0; i < Auctionmonitor_batch_len; i++) {
+        smedl_event_release(Auctionmonitor_batch_events[i]);
+    }
+    Auctionmonitor_batch_len = 0;
+    return success;
+}
+
+/* Add an event to the pending batch for the Auctionmonitor syncset, importing the
+ * batch first if it is full. Return nonzero on success, zero on failure. */
+static int batch_Auctionmonitor(int channel, SMEDLEvent *ev, void *aux) {
+    int success = 1;
+    if (Auctionmonitor_batch_len == FILE_BATCH_SIZE) {
+        success = flush_Auctionmonitor_batch();
+    }
+    SMEDLImportEvent *import = &Auctionmonitor_batch[Auctionmonitor_batch_len];
+    import->channel = channel;
+    import->identities = ev->ids;
+    import->params = ev->params;
+    import->aux = aux;
+    Auctionmonitor_batch_events[Auctionmonitor_batch_len++] = ev;
+    return success;
+}
+
+/* Dispatch table, indexed by system channel. Events on channels into a
+ * synchronous set are added to its batch on the given import channel. Events
+ * on channels out of the system are written. */
+static const struct {
+    int (*batch)(int channel, SMEDLEvent *ev, void *aux);
+    int import;
+    SMEDLCallback write;
+} dispatch[] = {
+    [SYSCHANNEL_ch1] = {batch_Auctionmonitor, IMPORT_Auctionmonitor_ch1, NULL},
+    [SYSCHANNEL_ch2] = {batch_Auctionmonitor, IMPORT_Auctionmonitor_ch2, NULL},
+    [SYSCHANNEL_ch3] = {batch_Auctionmonitor, IMPORT_Auctionmonitor_ch3, NULL},
+    [SYSCHANNEL_ch4] = {batch_Auctionmonitor, IMPORT_Auctionmonitor_ch4, NULL},
+    [SYSCHANNEL_Auctionmonitor_alarm_recreation] = {NULL, 0, write_Auctionmonitor_alarm_recreation},
+    [SYSCHANNEL_Auctionmonitor_alarm_low_bid] = {NULL, 0, write_Auctionmonitor_alarm_low_bid},
+    [SYSCHANNEL_Auctionmonitor_alarm_sold_early] = {NULL, 0, write_Auctionmonitor_alarm_sold_early},
+    [SYSCHANNEL_Auctionmonitor_alarm_not_sold] = {NULL, 0, write_Auctionmonitor_alarm_not_sold},
+    [SYSCHANNEL_Auctionmonitor_alarm_action_after_end] = {NULL, 0, write_Auctionmonitor_alarm_action_after_end},
+    [SYSCHANNEL_Auctionmonitor_alarm_action_before_start] = {NULL, 0, write_Auctionmonitor_alarm_action_before_start},
+};
+
 /* Queue processing function - Pop events off the queue and send them to the
  * proper synchronous sets (or to be written to the output file) until the
  * queue is empty */
 int handle_queue() {
     int success = 1;
     int channel;
-    SMEDLValue *identities, *params;
+    SMEDLEvent *ev;
     void *aux;
 
-    while (pop_global_event(&queue, &channel, &identities, &params, &aux)) {
-        switch (channel) {
-            case SYSCHANNEL_ch1:
-                success = import_Auctionmonitor_ch1(identities, params, aux) && success;
-                break;
-            case SYSCHANNEL_ch2:
-                success = import_Auctionmonitor_ch2(identities, params, aux) && success;
-                break;
-            case SYSCHANNEL_ch3:
-                success = import_Auctionmonitor_ch3(identities, params, aux) && success;
-                break;
-            case SYSCHANNEL_ch4:
-                success = import_Auctionmonitor_ch4(identities, params, aux) && success;
-                break;
-            case SYSCHANNEL_Auctionmonitor_alarm_recreation:
-                success = write_Auctionmonitor_alarm_recreation(identities, params, aux) && success;
-                break;
-            case SYSCHANNEL_Auctionmonitor_alarm_low_bid:
-                success = write_Auctionmonitor_alarm_low_bid(identities, params, aux) && success;
-                break;
-            case SYSCHANNEL_Auctionmonitor_alarm_sold_early:
-                success = write_Auctionmonitor_alarm_sold_early(identities, params, aux) && success;
-                break;
-            case SYSCHANNEL_Auctionmonitor_alarm_not_sold:
-                success = write_Auctionmonitor_alarm_not_sold(identities, params, aux) && success;
-                break;
-            case SYSCHANNEL_Auctionmonitor_alarm_action_after_end:
-                success = write_Auctionmonitor_alarm_action_after_end(identities, params, aux) && success;
-                break;
-            case SYSCHANNEL_Auctionmonitor_alarm_action_before_start:
-                success = write_Auctionmonitor_alarm_action_before_start(identities, params, aux) && success;
+    for (;;) {
+        if (!pop_global_shared(&queue, &channel, &ev, &aux)) {
+            /* Importing the pending batch may queue more events */
+            if (Auctionmonitor_batch_len == 0) {
                 break;
+            }
+            success = flush_Auctionmonitor_batch() && success;
+            continue;
         }
-        /* Event params and identities were malloc'd in the enqueue_*()
-         * functions. They are no longer needed. (String and opaque data were
-         * already free'd in the switch.) */
-        free(identities);
-        free(params);
+
+        /* Imported events are held until the queue runs dry (or the batch
+         * fills). Written events need not wait for them: anything the pending
+         * events export is queued behind them. */
+        if (dispatch[channel].batch != NULL) {
+            success = dispatch[channel].batch(dispatch[channel].import, ev,
+                    aux) && success;
+            continue;
+        }
+        SMEDL_LATENCY_TIMER(write_start);
+        SMEDL_PROFILE_OUTPUT(channel);
+        success = dispatch[channel].write(ev->ids, ev->params, aux) && success;
+        SMEDL_PROFILE_POP();
+        SMEDL_LATENCY_RECORD(channel, SMEDL_STAGE_WRITE, write_start);
+        /* Drop the queue's reference. Imported events are released once
+         * their batch is imported. */
+        smedl_event_release(ev);
     }
 
     return success;
@@ -70,11 +130,14 @@ int handle_queue() {
 
 int enqueue_ch1(SMEDLValue *identities, SMEDLValue *params,
         void *aux) {
-    SMEDLValue *ids_copy = NULL;
-    SMEDLValue *params_copy = smedl_copy_array(params, 3);
-    if (!push_global_event(&queue, SYSCHANNEL_ch1, ids_copy, params_copy, aux)) {
+    SMEDLEvent *ev = smedl_event_new(identities, 0, params, 3);
+    if (ev == NULL) {
         /* malloc fail */
-        smedl_free_array(params_copy, 3);
+        return 0;
+    }
+    if (!push_global_shared(&queue, SYSCHANNEL_ch1, ev, aux)) {
+        /* malloc fail */
+        smedl_event_release(ev);
         return 0;
     }
     return 1;
@@ -82,11 +145,14 @@ int enqueue_ch1(SMEDLValue *identities, SMEDLValue *params,
 
 int enqueue_ch2(SMEDLValue *identities, SMEDLValue *params,
         void *aux) {
-    SMEDLValue *ids_copy = NULL;
-    SMEDLValue *params_copy = smedl_copy_array(params, 2);
-    if (!push_global_event(&queue, SYSCHANNEL_ch2, ids_copy, params_copy, aux)) {
+    SMEDLEvent *ev = smedl_event_new(identities, 0, params, 2);
+    if (ev == NULL) {
+        /* malloc fail */
+        return 0;
+    }
+    if (!push_global_shared(&queue, SYSCHANNEL_ch2, ev, aux)) {
         /* malloc fail */
-        smedl_free_array(params_copy, 2);
+        smedl_event_release(ev);
         return 0;
     }
     return 1;
@@ -94,11 +160,14 @@ int enqueue_ch2(SMEDLValue *identities, SMEDLValue *params,
 
 int enqueue_ch3(SMEDLValue *identities, SMEDLValue *params,
         void *aux) {
-    SMEDLValue *ids_copy = NULL;
-    SMEDLValue *params_copy = smedl_copy_array(params, 1);
-    if (!push_global_event(&queue, SYSCHANNEL_ch3, ids_copy, params_copy, aux)) {
+    SMEDLEvent *ev = smedl_event_new(identities, 0, params, 1);
+    if (ev == NULL) {
         /* malloc fail */
-        smedl_free_array(params_copy, 1);
+        return 0;
+    }
+    if (!push_global_shared(&queue, SYSCHANNEL_ch3, ev, aux)) {
+        /* malloc fail */
+        smedl_event_release(ev);
         return 0;
     }
     return 1;
@@ -106,11 +175,14 @@ int enqueue_ch3(SMEDLValue *identities, SMEDLValue *params,
 
 int enqueue_ch4(SMEDLValue *identities, SMEDLValue *params,
         void *aux) {
-    SMEDLValue *ids_copy = NULL;
-    SMEDLValue *params_copy = smedl_copy_array(params, 0);
-    if (!push_global_event(&queue, SYSCHANNEL_ch4, ids_copy, params_copy, aux)) {
+    SMEDLEvent *ev = smedl_event_new(identities, 0, params, 0);
+    if (ev == NULL) {
         /* malloc fail */
-        smedl_free_array(params_copy, 0);
+        return 0;
+    }
+    if (!push_global_shared(&queue, SYSCHANNEL_ch4, ev, aux)) {
+        /* malloc fail */
+        smedl_event_release(ev);
         return 0;
     }
     return 1;
@@ -118,11 +190,14 @@ int enqueue_ch4(SMEDLValue *identities, SMEDLValue *params,
 
 int enqueue_Auctionmonitor_alarm_recreation(SMEDLValue *identities, SMEDLValue *params,
         void *aux) {
-    SMEDLValue *ids_copy = smedl_copy_array(identities, 1);
-    SMEDLValue *params_copy = smedl_copy_array(params, 0);
-    if (!push_global_event(&queue, SYSCHANNEL_Auctionmonitor_alarm_recreation, ids_copy, params_copy, aux)) {
+    SMEDLEvent *ev = smedl_event_new(identities, 1, params, 0);
+    if (ev == NULL) {
+        /* malloc fail */
+        return 0;
+    }
+    if (!push_global_shared(&queue, SYSCHANNEL_Auctionmonitor_alarm_recreation, ev, aux)) {
         /* malloc fail */
-        smedl_free_array(params_copy, 0);
+        smedl_event_release(ev);
         return 0;
     }
     return 1;
@@ -130,11 +205,14 @@ int enqueue_Auctionmonitor_alarm_recreation(SMEDLValue *identities, SMEDLValue *
 
 int enqueue_Auctionmonitor_alarm_low_bid(SMEDLValue *identities, SMEDLValue *params,
         void *aux) {
-    SMEDLValue *ids_copy = smedl_copy_array(identities, 1);
-    SMEDLValue *params_copy = smedl_copy_array(params, 0);
-    if (!push_global_event(&queue, SYSCHANNEL_Auctionmonitor_alarm_low_bid, ids_copy, params_copy, aux)) {
+    SMEDLEvent *ev = smedl_event_new(identities, 1, params, 0);
+    if (ev == NULL) {
         /* malloc fail */
-        smedl_free_array(params_copy, 0);
+        return 0;
+    }
+    if (!push_global_shared(&queue, SYSCHANNEL_Auctionmonitor_alarm_low_bid, ev, aux)) {
+        /* malloc fail */
+        smedl_event_release(ev);
         return 0;
     }
     return 1;
@@ -142,11 +220,14 @@ int enqueue_Auctionmonitor_alarm_low_bid(SMEDLValue *identities, SMEDLValue *par
 
 int enqueue_Auctionmonitor_alarm_sold_early(SMEDLValue *identities, SMEDLValue *params,
         void *aux) {
-    SMEDLValue *ids_copy = smedl_copy_array(identities, 1);
-    SMEDLValue *params_copy = smedl_copy_array(params, 0);
-    if (!push_global_event(&queue, SYSCHANNEL_Auctionmonitor_alarm_sold_early, ids_copy, params_copy, aux)) {
+    SMEDLEvent *ev = smedl_event_new(identities, 1, params, 0);
+    if (ev == NULL) {
         /* malloc fail */
-        smedl_free_array(params_copy, 0);
+        return 0;
+    }
+    if (!push_global_shared(&queue, SYSCHANNEL_Auctionmonitor_alarm_sold_early, ev, aux)) {
+        /* malloc fail */
+        smedl_event_release(ev);
         return 0;
     }
     return 1;
@@ -154,11 +235,14 @@ int enqueue_Auctionmonitor_alarm_sold_early(SMEDLValue *identities, SMEDLValue *
 
 int enqueue_Auctionmonitor_alarm_not_sold(SMEDLValue *identities, SMEDLValue *params,
         void *aux) {
-    SMEDLValue *ids_copy = smedl_copy_array(identities, 1);
-    SMEDLValue *params_copy = smedl_copy_array(params, 0);
-    if (!push_global_event(&queue, SYSCHANNEL_Auctionmonitor_alarm_not_sold, ids_copy, params_copy, aux)) {
+    SMEDLEvent *ev = smedl_event_new(identities, 1, params, 0);
+    if (ev == NULL) {
         /* malloc fail */
-        smedl_free_array(params_copy, 0);
+        return 0;
+    }
+    if (!push_global_shared(&queue, SYSCHANNEL_Auctionmonitor_alarm_not_sold, ev, aux)) {
+        /* malloc fail */
+        smedl_event_release(ev);
         return 0;
     }
     return 1;
@@ -166,11 +250,14 @@ int enqueue_Auctionmonitor_alarm_not_sold(SMEDLValue *identities, SMEDLValue *pa
 
 int enqueue_Auctionmonitor_alarm_action_after_end(SMEDLValue *identities, SMEDLValue *params,
         void *aux) {
-    SMEDLValue *ids_copy = smedl_copy_array(identities, 1);
-    SMEDLValue *params_copy = smedl_copy_array(params, 0);
-    if (!push_global_event(&queue, SYSCHANNEL_Auctionmonitor_alarm_action_after_end, ids_copy, params_copy, aux)) {
+    SMEDLEvent *ev = smedl_event_new(identities, 1, params, 0);
+    if (ev == NULL) {
         /* malloc fail */
-        smedl_free_array(params_copy, 0);
+        return 0;
+    }
+    if (!push_global_shared(&queue, SYSCHANNEL_Auctionmonitor_alarm_action_after_end, ev, aux)) {
+        /* malloc fail */
+        smedl_event_release(ev);
         return 0;
     }
     return 1;
@@ -178,118 +265,196 @@ int enqueue_Auctionmonitor_alarm_action_after_end(SMEDLValue *identities, SMEDLV
 
 int enqueue_Auctionmonitor_alarm_action_before_start(SMEDLValue *identities, SMEDLValue *params,
         void *aux) {
-    SMEDLValue *ids_copy = smedl_copy_array(identities, 1);
-    SMEDLValue *params_copy = smedl_copy_array(params, 0);
-    if (!push_global_event(&queue, SYSCHANNEL_Auctionmonitor_alarm_action_before_start, ids_copy, params_copy, aux)) {
+    SMEDLEvent *ev = smedl_event_new(identities, 1, params, 0);
+    if (ev == NULL) {
         /* malloc fail */
-        smedl_free_array(params_copy, 0);
+        return 0;
+    }
+    if (!push_global_shared(&queue, SYSCHANNEL_Auctionmonitor_alarm_action_before_start, ev, aux)) {
+        /* malloc fail */
+        smedl_event_release(ev);
+        return 0;
+    }
+    return 1;
+}
+
+/* Borrowed callbacks for events exported from global wrappers. These keep a
+ * reference to the exported event instead of copying it.
+ * Return nonzero on success, zero on failure. */
+
+int enqueue_borrowed_Auctionmonitor_alarm_recreation(SMEDLEvent *ev, void *aux) {
+    smedl_event_retain(ev);
+    if (!push_global_shared(&queue, SYSCHANNEL_Auctionmonitor_alarm_recreation, ev, aux)) {
+        /* malloc fail */
+        smedl_event_release(ev);
         return 0;
     }
     return 1;
 }
 
+int enqueue_borrowed_Auctionmonitor_alarm_low_bid(SMEDLEvent *ev, void *aux) {
+    smedl_event_retain(ev);
+    if (!push_global_shared(&queue, SYSCHANNEL_Auctionmonitor_alarm_low_bid, ev, aux)) {
+        /* malloc fail */
+        smedl_event_release(ev);
+        return 0;
+    }
+    return 1;
+}
+
+int enqueue_borrowed_Auctionmonitor_alarm_sold_early(SMEDLEvent *ev, void *aux) {
+    smedl_event_retain(ev);
+    if (!push_global_shared(&queue, SYSCHANNEL_Auctionmonitor_alarm_sold_early, ev, aux)) {
+        /* malloc fail */
+        smedl_event_release(ev);
+        return 0;
+    }
+    return 1;
+}
+
+int enqueue_borrowed_Auctionmonitor_alarm_not_sold(SMEDLEvent *ev, void *aux) {
+    smedl_event_retain(ev);
+    if (!push_global_shared(&queue, SYSCHANNEL_Auctionmonitor_alarm_not_sold, ev, aux)) {
+        /* malloc fail */
+        smedl_event_release(ev);
+        return 0;
+    }
+    return 1;
+}
+
+int enqueue_borrowed_Auctionmonitor_alarm_action_after_end(SMEDLEvent *ev, void *aux) {
+    smedl_event_retain(ev);
+    if (!push_global_shared(&queue, SYSCHANNEL_Auctionmonitor_alarm_action_after_end, ev, aux)) {
+        /* malloc fail */
+        smedl_event_release(ev);
+        return 0;
+    }
+    return 1;
+}
+
+int enqueue_borrowed_Auctionmonitor_alarm_action_before_start(SMEDLEvent *ev, void *aux) {
+    smedl_event_retain(ev);
+    if (!push_global_shared(&queue, SYSCHANNEL_Auctionmonitor_alarm_action_before_start, ev, aux)) {
+        /* malloc fail */
+        smedl_event_release(ev);
+        return 0;
+    }
+    return 1;
+}
+
+/* Stream the output functions write to, or NULL for stdout. Set while a frame
+ * received over a socket is being handled so its events go back to the client
+ * that sent it. */
+static FILE *output;
+
 /* Output functions for events that are "sent back to the target system."
  * Return nonzero on success, zero on failure. */
 
 int write_Auctionmonitor_alarm_recreation(SMEDLValue *identities, SMEDLValue *params, void *aux) {
-    printf("{\n"
+    FILE *out = output != NULL ? output : stdout;
+    fprintf(out, "{\n"
         "\t\"fmt_version\": [%d, %d],\n"
         "\t\"channel\": \"Auctionmonitor_alarm_recreation\",\n"
         "\t\"event\": \"Auctionmonitor.alarm_recreation\",\n"
         "\t\"identities\": [",
         FMT_VERSION_MAJOR, FMT_VERSION_MINOR);
-    printf("%d", identities[0].v.i);
-    printf("],\n"
+    fprintf(out, "%d", identities[0].v.i);
+    fprintf(out, "],\n"
         "\t\"params\": [");
     AuxData *aux_data = aux;
-    printf("],\n"
+    fprintf(out, "],\n"
         "\t\"aux\": %.*s\n", (int) aux_data->len, aux_data->data);
-    printf("}\n");
+    fprintf(out, "}\n");
     return 1;
 }
 
 int write_Auctionmonitor_alarm_low_bid(SMEDLValue *identities, SMEDLValue *params, void *aux) {
-    printf("{\n"
+    FILE *out = output != NULL ? output : stdout;
+    fprintf(out, "{\n"
         "\t\"fmt_version\": [%d, %d],\n"
         "\t\"channel\": \"Auctionmonitor_alarm_low_bid\",\n"
         "\t\"event\": \"Auctionmonitor.alarm_low_bid\",\n"
         "\t\"identities\": [",
         FMT_VERSION_MAJOR, FMT_VERSION_MINOR);
-    printf("%d", identities[0].v.i);
-    printf("],\n"
+    fprintf(out, "%d", identities[0].v.i);
+    fprintf(out, "],\n"
         "\t\"params\": [");
     AuxData *aux_data = aux;
-    printf("],\n"
+    fprintf(out, "],\n"
         "\t\"aux\": %.*s\n", (int) aux_data->len, aux_data->data);
-    printf("}\n");
+    fprintf(out, "}\n");
     return 1;
 }
 
 int write_Auctionmonitor_alarm_sold_early(SMEDLValue *identities, SMEDLValue *params, void *aux) {
-    printf("{\n"
+    FILE *out = output != NULL ? output : stdout;
+    fprintf(out, "{\n"
         "\t\"fmt_version\": [%d, %d],\n"
         "\t\"channel\": \"Auctionmonitor_alarm_sold_early\",\n"
         "\t\"event\": \"Auctionmonitor.alarm_sold_early\",\n"
         "\t\"identities\": [",
         FMT_VERSION_MAJOR, FMT_VERSION_MINOR);
-    printf("%d", identities[0].v.i);
-    printf("],\n"
+    fprintf(out, "%d", identities[0].v.i);
+    fprintf(out, "],\n"
         "\t\"params\": [");
     AuxData *aux_data = aux;
-    printf("],\n"
+    fprintf(out, "],\n"
         "\t\"aux\": %.*s\n", (int) aux_data->len, aux_data->data);
-    printf("}\n");
+    fprintf(out, "}\n");
     return 1;
 }
 
 int write_Auctionmonitor_alarm_not_sold(SMEDLValue *identities, SMEDLValue *params, void *aux) {
-    printf("{\n"
+    FILE *out = output != NULL ? output : stdout;
+    fprintf(out, "{\n"
         "\t\"fmt_version\": [%d, %d],\n"
         "\t\"channel\": \"Auctionmonitor_alarm_not_sold\",\n"
         "\t\"event\": \"Auctionmonitor.alarm_not_sold\",\n"
         "\t\"identities\": [",
         FMT_VERSION_MAJOR, FMT_VERSION_MINOR);
-    printf("%d", identities[0].v.i);
-    printf("],\n"
+    fprintf(out, "%d", identities[0].v.i);
+    fprintf(out, "],\n"
         "\t\"params\": [");
     AuxData *aux_data = aux;
-    printf("],\n"
+    fprintf(out, "],\n"
         "\t\"aux\": %.*s\n", (int) aux_data->len, aux_data->data);
-    printf("}\n");
+    fprintf(out, "}\n");
     return 1;
 }
 
 int write_Auctionmonitor_alarm_action_after_end(SMEDLValue *identities, SMEDLValue *params, void *aux) {
-    printf("{\n"
+    FILE *out = output != NULL ? output : stdout;
+    fprintf(out, "{\n"
         "\t\"fmt_version\": [%d, %d],\n"
         "\t\"channel\": \"Auctionmonitor_alarm_action_after_end\",\n"
         "\t\"event\": \"Auctionmonitor.alarm_action_after_end\",\n"
         "\t\"identities\": [",
         FMT_VERSION_MAJOR, FMT_VERSION_MINOR);
-    printf("%d", identities[0].v.i);
-    printf("],\n"
+    fprintf(out, "%d", identities[0].v.i);
+    fprintf(out, "],\n"
         "\t\"params\": [");
     AuxData *aux_data = aux;
-    printf("],\n"
+    fprintf(out, "],\n"
         "\t\"aux\": %.*s\n", (int) aux_data->len, aux_data->data);
-    printf("}\n");
+    fprintf(out, "}\n");
     return 1;
 }
 
 int write_Auctionmonitor_alarm_action_before_start(SMEDLValue *identities, SMEDLValue *params, void *aux) {
-    printf("{\n"
+    FILE *out = output != NULL ? output : stdout;
+    fprintf(out, "{\n"
         "\t\"fmt_version\": [%d, %d],\n"
         "\t\"channel\": \"Auctionmonitor_alarm_action_before_start\",\n"
         "\t\"event\": \"Auctionmonitor.alarm_action_before_start\",\n"
         "\t\"identities\": [",
         FMT_VERSION_MAJOR, FMT_VERSION_MINOR);
-    printf("%d", identities[0].v.i);
-    printf("],\n"
+    fprintf(out, "%d", identities[0].v.i);
+    fprintf(out, "],\n"
         "\t\"params\": [");
     AuxData *aux_data = aux;
-    printf("],\n"
+    fprintf(out, "],\n"
         "\t\"aux\": %.*s\n", (int) aux_data->len, aux_data->data);
-    printf("}\n");
+    fprintf(out, "}\n");
     return 1;
 }
 
@@ -345,15 +510,150 @@ int get_json_components(const char *str, jsmntok_t *msg,
     return 1;
 }
 
+/* Channels that can be read from the input file, placed by a perfect hash of
+ * their names. See lookup_channel(). */
+#define INPUT_CHANNEL_SLOTS 4
+static const struct {
+    const char *name;
+    size_t len;
+    int channel;
+} input_channels[INPUT_CHANNEL_SLOTS] = {
+    [0] = {"ch1", 3, SYSCHANNEL_ch1},
+    [1] = {"ch2", 3, SYSCHANNEL_ch2},
+    [2] = {"ch3", 3, SYSCHANNEL_ch3},
+    [3] = {"ch4", 3, SYSCHANNEL_ch4},
+};
+
+/* Return the system channel with the given name, or -1 if no input channel has
+ * that name */
+static int lookup_channel(const char *name, size_t len) {
+    if (len == 0) {
+        return -1;
+    }
+    size_t slot = ((unsigned char) name[len - 1] + len) &
+        (INPUT_CHANNEL_SLOTS - 1);
+    if (input_channels[slot].len != len ||
+            memcmp(input_channels[slot].name, name, len)) {
+        return -1;
+    }
+    return input_channels[slot].channel;
+}
+
+/* Aux data for the messages read since the queue was last handled */
+static AuxBatch aux_batch;
+
+/* Handle the events read since the last batch, then start a new batch.
+ * last_msg is the number of the last message in the batch. */
+static void handle_batch(size_t last_msg) {
+    SMEDL_LATENCY_TIMER(start);
+    seal_aux_batch(&aux_batch);
+    if (!handle_queue()) {
+        err("\nWarning: Problem processing queue after message %d", last_msg);
+    }
+    reset_aux_batch(&aux_batch);
+    SMEDL_LATENCY_RECORD_BATCH(start);
+}
+
+#ifdef SMEDL_PROGRESS_INTERVAL
+/* When read_events() started */
+static struct timespec progress_start;
+
+/* Print the number of messages processed, the time taken so far and the number
+ * of live monitors of each type to stderr, as one line of JSON */
+static void report_progress(size_t msg) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    long long ns = (now.tv_sec - progress_start.tv_sec) * 1000000000LL +
+        (now.tv_nsec - progress_start.tv_nsec);
+    fprintf(stderr, "{\"progress\": {\"messages\": %zu, \"ns\": %lld, "
+            "\"monitors\": {\"Auctionmonitor\": %zu}}}\n",
+            msg, ns,
+            count_Auctionmonitor_monitors());
+}
+#endif
+
+#ifdef SMEDL_STATS_INTERVAL
+/* Write the population and monitor map health of each monitor type to the
+ * stats file (see telemetry.h) */
+static void write_monitor_stats(FILE *f) {
+    MonitorStats stats;
+    stats_Auctionmonitor_monitors(&stats);
+    smedl_stats_write_monitors(f, "Auctionmonitor", &stats);
+}
+#endif
+
+/* Number of messages before the last snapshot taken or restored */
+static size_t snapshot_at;
+
+#ifdef SMEDL_SNAPSHOT_INTERVAL
+/* Write the monitors of each synchronous set to a snapshot (see snapshot.h) */
+static int write_snapshot(SMEDLSnapshotWriter *w) {
+    return snapshot_Auctionmonitor_syncset(w);
+}
+#endif
+
 /* Receive and process events from the provided JSON parser. Any malformed
  * events are skipped (with a warning printed to stderr). */
 void read_events(JSONParser *parser) {
     jsmntok_t *msg;
     char *str;
+#ifdef SMEDL_PROGRESS_INTERVAL
+    clock_gettime(CLOCK_MONOTONIC, &progress_start);
+#endif
 
-    for (msg = next_message(parser, &str);
+    for (SMEDL_LATENCY_START(), SMEDL_PROFILE_START(),
+            msg = next_message(parser, &str);
             msg != NULL;
+            SMEDL_LATENCY_START(), SMEDL_PROFILE_START(),
             msg = next_message(parser, &str)) {
+        /* Time spent between events is not counted toward any stage */
+        SMEDL_LATENCY_PAUSE();
+        SMEDL_PROFILE_PAUSE();
+        /* Handle the events read so far once the batch is full */
+        if (aux_batch.count == FILE_BATCH_SIZE) {
+            handle_batch(parser->msg_count - 1);
+        }
+#ifdef SMEDL_PROGRESS_INTERVAL
+        if ((parser->msg_count - 1) % SMEDL_PROGRESS_INTERVAL == 0) {
+            /* Handle the partial batch first so the report is up to date */
+            if (aux_batch.count > 0) {
+                handle_batch(parser->msg_count - 1);
+            }
+            report_progress(parser->msg_count - 1);
+        }
+#endif
+#ifdef SMEDL_STATS_INTERVAL
+        smedl_stats_poll(parser->msg_count - 1);
+#endif
+#ifdef SMEDL_SNAPSHOT_INTERVAL
+        if ((parser->msg_count - 1) % SMEDL_SNAPSHOT_INTERVAL == 0 &&
+                parser->msg_count - 1 > snapshot_at) {
+            /* Snapshots are only taken with the queues empty */
+            if (aux_batch.count > 0) {
+                handle_batch(parser->msg_count - 1);
+            }
+            snapshot_at = parser->msg_count - 1;
+#ifdef SMEDL_SPILL_BUDGET
+            /* The spill table is a shared mapping, so a forked child would see
+             * it change under it. Write the snapshot here instead. */
+            if (!smedl_snapshot_save(SMEDL_SNAPSHOT_FILE, parser->msg_offset,
+                        snapshot_at, write_snapshot)) {
+                err("\nWarning: Could not write snapshot after message %zu",
+                        snapshot_at);
+            }
+#else
+            if (!smedl_snapshot_fork(SMEDL_SNAPSHOT_FILE, parser->msg_offset,
+                        snapshot_at, write_snapshot)) {
+                err("\nWarning: Could not start snapshot after message %zu",
+                        snapshot_at);
+            }
+#endif
+        }
+#endif
+        SMEDL_LATENCY_POLL();
+        SMEDL_LATENCY_RESUME();
+        SMEDL_PROFILE_RESUME();
+
         /* Get components from JSON */
         jsmntok_t *chan_tok, *params_tok, *aux_tok;
         if (!get_json_components(str, msg, &chan_tok, &params_tok, &aux_tok)) {
@@ -363,13 +663,17 @@ void read_events(JSONParser *parser) {
             continue;
         }
 
-        /* Create aux struct */
-        AuxData aux;
-        aux.data = str + aux_tok->start;
-        aux.len = aux_tok->end - aux_tok->start;
+        /* Copy the aux data into the batch */
+        const char *aux_data = str + aux_tok->start;
+        size_t aux_len = aux_tok->end - aux_tok->start;
         if (aux_tok->type == JSMN_STRING) {
-            aux.data--;
-            aux.len += 2;
+            aux_data--;
+            aux_len += 2;
+        }
+        AuxData *aux = add_aux(&aux_batch, aux_data, aux_len);
+        if (aux == NULL) {
+            err("\nStopping: Out of memory.");
+            break;
         }
 
         /* Import the event */
@@ -380,151 +684,148 @@ void read_events(JSONParser *parser) {
             err("\nStopping: Out of memory.");
             break;
         }
-        if (chan_len == strlen("ch1") &&
-                !strncmp(chan, "ch1", chan_len)) {
-            /* Check param array length */
-            if (params_tok->size < 3) {
-            }
-            /* Convert params to SMEDLValue array */
-            int tmp_i;
-            char *tmp_s;
-            SMEDLValue params[3];
-            params_tok++;
-            if (json_to_int(str, params_tok, &params[0].v.i)) {
-                params[0].t = SMEDL_INT;
-            } else {
-                err("\nWarning: Skipping message %d: Bad format, overflow, or "
-                        "out-of-memory\n", parser->msg_count);
-                smedl_free_array_contents(params, 0);
-                continue;
-            }
-            params_tok++;
-            if (json_to_int(str, params_tok, &params[1].v.i)) {
-                params[1].t = SMEDL_INT;
-            } else {
-                err("\nWarning: Skipping message %d: Bad format, overflow, or "
-                        "out-of-memory\n", parser->msg_count);
-                smedl_free_array_contents(params, 1);
-                continue;
-            }
-            params_tok++;
-            if (json_to_int(str, params_tok, &params[2].v.i)) {
-                params[2].t = SMEDL_INT;
-            } else {
-                err("\nWarning: Skipping message %d: Bad format, overflow, or "
-                        "out-of-memory\n", parser->msg_count);
-                smedl_free_array_contents(params, 2);
-                continue;
-            }
+        switch (lookup_channel(chan, chan_len)) {
+            case SYSCHANNEL_ch1: {
+                /* Check param array length */
+                if (params_tok->size < 3) {
+                }
+                /* Convert params to SMEDLValue array */
+                int tmp_i;
+                char *tmp_s;
+                SMEDLValue params[3];
+                params_tok++;
+                if (json_to_int(str, params_tok, &params[0].v.i)) {
+                    params[0].t = SMEDL_INT;
+                } else {
+                    err("\nWarning: Skipping message %d: Bad format, overflow, or "
+                            "out-of-memory\n", parser->msg_count);
+                    smedl_free_array_contents(params, 0);
+                    continue;
+                }
+                params_tok++;
+                if (json_to_int(str, params_tok, &params[1].v.i)) {
+                    params[1].t = SMEDL_INT;
+                } else {
+                    err("\nWarning: Skipping message %d: Bad format, overflow, or "
+                            "out-of-memory\n", parser->msg_count);
+                    smedl_free_array_contents(params, 1);
+                    continue;
+                }
+                params_tok++;
+                if (json_to_int(str, params_tok, &params[2].v.i)) {
+                    params[2].t = SMEDL_INT;
+                } else {
+                    err("\nWarning: Skipping message %d: Bad format, overflow, or "
+                            "out-of-memory\n", parser->msg_count);
+                    smedl_free_array_contents(params, 2);
+                    continue;
+                }
 
-            /* Process the event */
-            int result = enqueue_ch1(NULL, params, &aux);
-            smedl_free_array_contents(params, 3);
-            if (result) {
-                if (!handle_queue()) {
-                    err("\nWarning: Problem processing queue after message %d",
+                /* Process the event */
+                SMEDL_LATENCY_LAP(SYSCHANNEL_ch1, SMEDL_STAGE_PARSE);
+                SMEDL_PROFILE_PARSED(SYSCHANNEL_ch1);
+                int result = enqueue_ch1(NULL, params, aux);
+                SMEDL_LATENCY_LAP(SYSCHANNEL_ch1, SMEDL_STAGE_ENQUEUE);
+                smedl_free_array_contents(params, 3);
+                if (!result) {
+                    err("\nWarning: Skipping message %d: "
+                            "enqueue_ch1() failed\n",
                             parser->msg_count);
                 }
-            } else {
-                err("\nWarning: Skipping message %d: "
-                        "enqueue_ch1() failed\n",
-                        parser->msg_count);
-            }
-        } else if (chan_len == strlen("ch2") &&
-                !strncmp(chan, "ch2", chan_len)) {
-            /* Check param array length */
-            if (params_tok->size < 2) {
-            }
-            /* Convert params to SMEDLValue array */
-            int tmp_i;
-            char *tmp_s;
-            SMEDLValue params[2];
-            params_tok++;
-            if (json_to_int(str, params_tok, &params[0].v.i)) {
-                params[0].t = SMEDL_INT;
-            } else {
-                err("\nWarning: Skipping message %d: Bad format, overflow, or "
-                        "out-of-memory\n", parser->msg_count);
-                smedl_free_array_contents(params, 0);
-                continue;
-            }
-            params_tok++;
-            if (json_to_int(str, params_tok, &params[1].v.i)) {
-                params[1].t = SMEDL_INT;
-            } else {
-                err("\nWarning: Skipping message %d: Bad format, overflow, or "
-                        "out-of-memory\n", parser->msg_count);
-                smedl_free_array_contents(params, 1);
-                continue;
+                break;
             }
+            case SYSCHANNEL_ch2: {
+                /* Check param array length */
+                if (params_tok->size < 2) {
+                }
+                /* Convert params to SMEDLValue array */
+                int tmp_i;
+                char *tmp_s;
+                SMEDLValue params[2];
+                params_tok++;
+                if (json_to_int(str, params_tok, &params[0].v.i)) {
+                    params[0].t = SMEDL_INT;
+                } else {
+                    err("\nWarning: Skipping message %d: Bad format, overflow, or "
+                            "out-of-memory\n", parser->msg_count);
+                    smedl_free_array_contents(params, 0);
+                    continue;
+                }
+                params_tok++;
+                if (json_to_int(str, params_tok, &params[1].v.i)) {
+                    params[1].t = SMEDL_INT;
+                } else {
+                    err("\nWarning: Skipping message %d: Bad format, overflow, or "
+                            "out-of-memory\n", parser->msg_count);
+                    smedl_free_array_contents(params, 1);
+                    continue;
+                }
 
-            /* Process the event */
-            int result = enqueue_ch2(NULL, params, &aux);
-            smedl_free_array_contents(params, 2);
-            if (result) {
-                if (!handle_queue()) {
-                    err("\nWarning: Problem processing queue after message %d",
+                /* Process the event */
+                SMEDL_LATENCY_LAP(SYSCHANNEL_ch2, SMEDL_STAGE_PARSE);
+                SMEDL_PROFILE_PARSED(SYSCHANNEL_ch2);
+                int result = enqueue_ch2(NULL, params, aux);
+                SMEDL_LATENCY_LAP(SYSCHANNEL_ch2, SMEDL_STAGE_ENQUEUE);
+                smedl_free_array_contents(params, 2);
+                if (!result) {
+                    err("\nWarning: Skipping message %d: "
+                            "enqueue_ch2() failed\n",
                             parser->msg_count);
                 }
-            } else {
-                err("\nWarning: Skipping message %d: "
-                        "enqueue_ch2() failed\n",
-                        parser->msg_count);
-            }
-        } else if (chan_len == strlen("ch3") &&
-                !strncmp(chan, "ch3", chan_len)) {
-            /* Check param array length */
-            if (params_tok->size < 1) {
-            }
-            /* Convert params to SMEDLValue array */
-            int tmp_i;
-            char *tmp_s;
-            SMEDLValue params[1];
-            params_tok++;
-            if (json_to_int(str, params_tok, &params[0].v.i)) {
-                params[0].t = SMEDL_INT;
-            } else {
-                err("\nWarning: Skipping message %d: Bad format, overflow, or "
-                        "out-of-memory\n", parser->msg_count);
-                smedl_free_array_contents(params, 0);
-                continue;
+                break;
             }
+            case SYSCHANNEL_ch3: {
+                /* Check param array length */
+                if (params_tok->size < 1) {
+                }
+                /* Convert params to SMEDLValue array */
+                int tmp_i;
+                char *tmp_s;
+                SMEDLValue params[1];
+                params_tok++;
+                if (json_to_int(str, params_tok, &params[0].v.i)) {
+                    params[0].t = SMEDL_INT;
+                } else {
+                    err("\nWarning: Skipping message %d: Bad format, overflow, or "
+                            "out-of-memory\n", parser->msg_count);
+                    smedl_free_array_contents(params, 0);
+                    continue;
+                }
 
-            /* Process the event */
-            int result = enqueue_ch3(NULL, params, &aux);
-            smedl_free_array_contents(params, 1);
-            if (result) {
-                if (!handle_queue()) {
-                    err("\nWarning: Problem processing queue after message %d",
+                /* Process the event */
+                SMEDL_LATENCY_LAP(SYSCHANNEL_ch3, SMEDL_STAGE_PARSE);
+                SMEDL_PROFILE_PARSED(SYSCHANNEL_ch3);
+                int result = enqueue_ch3(NULL, params, aux);
+                SMEDL_LATENCY_LAP(SYSCHANNEL_ch3, SMEDL_STAGE_ENQUEUE);
+                smedl_free_array_contents(params, 1);
+                if (!result) {
+                    err("\nWarning: Skipping message %d: "
+                            "enqueue_ch3() failed\n",
                             parser->msg_count);
                 }
-            } else {
-                err("\nWarning: Skipping message %d: "
-                        "enqueue_ch3() failed\n",
-                        parser->msg_count);
-            }
-        } else if (chan_len == strlen("ch4") &&
-                !strncmp(chan, "ch4", chan_len)) {
-            /* Check param array length */
-            if (params_tok->size < 0) {
+                break;
             }
-            /* Convert params to SMEDLValue array */
-            int tmp_i;
-            char *tmp_s;
-            SMEDLValue params[0];
-
-            /* Process the event */
-            int result = enqueue_ch4(NULL, params, &aux);
-            smedl_free_array_contents(params, 0);
-            if (result) {
-                if (!handle_queue()) {
-                    err("\nWarning: Problem processing queue after message %d",
+            case SYSCHANNEL_ch4: {
+                /* Check param array length */
+                if (params_tok->size < 0) {
+                }
+                /* Convert params to SMEDLValue array */
+                int tmp_i;
+                char *tmp_s;
+                SMEDLValue params[0];
+
+                /* Process the event */
+                SMEDL_LATENCY_LAP(SYSCHANNEL_ch4, SMEDL_STAGE_PARSE);
+                SMEDL_PROFILE_PARSED(SYSCHANNEL_ch4);
+                int result = enqueue_ch4(NULL, params, aux);
+                SMEDL_LATENCY_LAP(SYSCHANNEL_ch4, SMEDL_STAGE_ENQUEUE);
+                smedl_free_array_contents(params, 0);
+                if (!result) {
+                    err("\nWarning: Skipping message %d: "
+                            "enqueue_ch4() failed\n",
                             parser->msg_count);
                 }
-            } else {
-                err("\nWarning: Skipping message %d: "
-                        "enqueue_ch4() failed\n",
-                        parser->msg_count);
+                break;
             }
         }
         if (ch_result < 0) {
@@ -532,6 +833,24 @@ void read_events(JSONParser *parser) {
         }
     }
 
+    /* The last read found no message */
+    SMEDL_PROFILE_PARSED(SMEDL_PROFILE_NONE);
+
+    /* Handle the events in the last batch */
+    handle_batch(parser->msg_count);
+    free_aux_batch(&aux_batch);
+#ifdef SMEDL_PROGRESS_INTERVAL
+    report_progress(parser->msg_count);
+#endif
+#ifdef SMEDL_STATS_INTERVAL
+    smedl_stats_close(parser->msg_count);
+#endif
+#ifdef SMEDL_SNAPSHOT_INTERVAL
+    if (!smedl_snapshot_wait()) {
+        err("\nWarning: Could not write snapshot to %s", SMEDL_SNAPSHOT_FILE);
+    }
+#endif
+
     if (parser->status == JSONSTATUS_READERR) {
         err("\nStopping: Read error.");
     } else if (parser->status == JSONSTATUS_INVALID) {
@@ -544,6 +863,154 @@ void read_events(JSONParser *parser) {
     err("Processed %d messages.", parser->msg_count);
 }
 
+/* Param types and enqueue functions of the input channels, indexed by system
+ * channel, for events received in binary form (see event_codec.h) */
+static const struct {
+    size_t count;
+    SMEDLType types[3];
+    SMEDLCallback enqueue;
+} binary_inputs[] = {
+    [SYSCHANNEL_ch1] = {3, {SMEDL_INT, SMEDL_INT, SMEDL_INT}, enqueue_ch1},
+    [SYSCHANNEL_ch2] = {2, {SMEDL_INT, SMEDL_INT}, enqueue_ch2},
+    [SYSCHANNEL_ch3] = {1, {SMEDL_INT}, enqueue_ch3},
+    [SYSCHANNEL_ch4] = {0, {0}, enqueue_ch4},
+};
+
+/* Set by SIGINT or SIGTERM to stop serving shared memory or a socket */
+static volatile sig_atomic_t stopping;
+
+static void stop_serving(int sig) {
+    (void) sig;
+    stopping = 1;
+}
+
+/* Import one binary event into the current batch. msg is its message number
+ * for warnings. Strings are copied, so the event data may be reused as soon as
+ * this returns. Return nonzero on success (including a malformed event, which
+ * is skipped with a warning), zero if out of memory. */
+static int import_binary(SMEDLDecoder *dec, size_t msg) {
+    SMEDL_LATENCY_START();
+    SMEDL_PROFILE_START();
+
+    /* Convert params to SMEDLValue array */
+    SMEDLValue params[3];
+    const char *aux_data;
+    size_t aux_len;
+    int channel = lookup_channel(dec->channel, dec->channel_len);
+    if (channel < 0 || !smedl_decode_params(dec, binary_inputs[channel].types,
+                binary_inputs[channel].count, params, &aux_data, &aux_len)) {
+        err("\nWarning: Skipping message %d: Unknown channel or bad "
+                "params\n", msg);
+        return 1;
+    }
+
+    /* Copy the aux data into the batch */
+    if (aux_data == NULL) {
+        aux_data = "null";
+        aux_len = 4;
+    }
+    AuxData *aux = add_aux(&aux_batch, aux_data, aux_len);
+    if (aux == NULL) {
+        return 0;
+    }
+
+    SMEDL_LATENCY_LAP(channel, SMEDL_STAGE_PARSE);
+    SMEDL_PROFILE_PARSED(channel);
+    int result = binary_inputs[channel].enqueue(NULL, params, aux);
+    SMEDL_LATENCY_LAP(channel, SMEDL_STAGE_ENQUEUE);
+    if (!result) {
+        err("\nWarning: Skipping message %d: enqueue failed\n", msg);
+    }
+    return 1;
+}
+
+/* Receive and process events from the provided shared-memory segment until
+ * SIGINT or SIGTERM, then process the events already published. The caller
+ * must be attached as the segment's monitor. Any malformed events are skipped
+ * (with a warning printed to stderr). */
+void read_shm_events(SMEDLShm *shm) {
+    size_t msg_count = 0;
+    SMEDLShmReader r;
+
+    for (;;) {
+#ifdef SMEDL_STATS_INTERVAL
+        smedl_stats_poll(msg_count);
+#endif
+        /* Handle the events read so far as soon as the ring runs dry */
+        int wait = aux_batch.count > 0 || stopping ? 0 : 1000;
+        if (!smedl_shm_next(shm, &r, wait)) {
+            if (aux_batch.count > 0) {
+                handle_batch(msg_count);
+            } else if (stopping) {
+                break;
+            }
+            continue;
+        }
+        msg_count++;
+        SMEDL_LATENCY_POLL();
+
+        /* Handle the events read so far once the batch is full */
+        if (aux_batch.count == FILE_BATCH_SIZE) {
+            handle_batch(msg_count - 1);
+        }
+
+        int success = import_binary(&r.dec, msg_count);
+        smedl_shm_release(shm, &r);
+        if (!success) {
+            err("\nStopping: Out of memory.");
+            break;
+        }
+    }
+
+    /* Handle the events in the last batch */
+    handle_batch(msg_count);
+    free_aux_batch(&aux_batch);
+
+#ifdef SMEDL_STATS_INTERVAL
+    smedl_stats_close(msg_count);
+#endif
+    err("\nFinished.");
+    err("Processed %d messages.", msg_count);
+}
+
+/* Number of events received over sockets so far */
+static size_t socket_msg_count;
+
+/* Process the events in a frame received over a socket as one batch (or more,
+ * if there are more than FILE_BATCH_SIZE), writing the events they cause to
+ * out. Malformed events are skipped (with a warning printed to stderr). Return
+ * nonzero on success, zero if the frame is malformed or out of memory. */
+static int handle_frame(const unsigned char *frame, size_t len, FILE *out) {
+    SMEDLDecoder dec;
+    size_t off = 0;
+    int status;
+
+    output = out;
+    while ((status = smedl_frame_next(frame, len, &off, &dec)) > 0) {
+        socket_msg_count++;
+        SMEDL_LATENCY_POLL();
+#ifdef SMEDL_STATS_INTERVAL
+        smedl_stats_poll(socket_msg_count);
+#endif
+
+        /* Handle the events read so far once the batch is full */
+        if (aux_batch.count == FILE_BATCH_SIZE) {
+            handle_batch(socket_msg_count - 1);
+        }
+
+        if (!import_binary(&dec, socket_msg_count)) {
+            err("\nWarning: Out of memory.");
+            status = -1;
+            break;
+        }
+    }
+
+    /* Handle the events in the frame, even if it ended badly */
+    handle_batch(socket_msg_count);
+    output = NULL;
+    return status == 0;
+}
+
 /* Initialize the global wrappers and register callback functions with them.
  * Return nonzero on success, zero on failure. */
 int init_global_wrappers() {
@@ -551,12 +1018,12 @@ int init_global_wrappers() {
     if (!init_Auctionmonitor_syncset()) {
         goto fail_init_Auctionmonitor;
     }
-    callback_Auctionmonitor_Auctionmonitor_alarm_recreation(enqueue_Auctionmonitor_alarm_recreation);
-    callback_Auctionmonitor_Auctionmonitor_alarm_low_bid(enqueue_Auctionmonitor_alarm_low_bid);
-    callback_Auctionmonitor_Auctionmonitor_alarm_sold_early(enqueue_Auctionmonitor_alarm_sold_early);
-    callback_Auctionmonitor_Auctionmonitor_alarm_not_sold(enqueue_Auctionmonitor_alarm_not_sold);
-    callback_Auctionmonitor_Auctionmonitor_alarm_action_after_end(enqueue_Auctionmonitor_alarm_action_after_end);
-    callback_Auctionmonitor_Auctionmonitor_alarm_action_before_start(enqueue_Auctionmonitor_alarm_action_before_start);
+    callback_borrowed_Auctionmonitor_Auctionmonitor_alarm_recreation(enqueue_borrowed_Auctionmonitor_alarm_recreation);
+    callback_borrowed_Auctionmonitor_Auctionmonitor_alarm_low_bid(enqueue_borrowed_Auctionmonitor_alarm_low_bid);
+    callback_borrowed_Auctionmonitor_Auctionmonitor_alarm_sold_early(enqueue_borrowed_Auctionmonitor_alarm_sold_early);
+    callback_borrowed_Auctionmonitor_Auctionmonitor_alarm_not_sold(enqueue_borrowed_Auctionmonitor_alarm_not_sold);
+    callback_borrowed_Auctionmonitor_Auctionmonitor_alarm_action_after_end(enqueue_borrowed_Auctionmonitor_alarm_action_after_end);
+    callback_borrowed_Auctionmonitor_Auctionmonitor_alarm_action_before_start(enqueue_borrowed_Auctionmonitor_alarm_action_before_start);
 
     return 1;
 
@@ -567,18 +1034,124 @@ fail_init_Auctionmonitor:
 /* Cleanup the global wrappers and the local wrappers and monitors within */
 void free_global_wrappers() {
     free_Auctionmonitor_syncset();
+    smedl_restore_free();
+}
+
+/* Restore the monitors of each synchronous set from the snapshot at path and
+ * store the input position it was taken at in offset and msg_count. Return
+ * nonzero on success, zero on failure. */
+static int restore_snapshot(const char *path, uint64_t *offset,
+        uint64_t *msg_count) {
+    SMEDLSnapshot snap;
+    if (!smedl_snapshot_open(&snap, path)) {
+        err("Could not open snapshot %s", path);
+        return 0;
+    }
+    if (!reserve_Auctionmonitor_syncset(&snap)) {
+        err("Snapshot %s does not match these monitors", path);
+        smedl_snapshot_close(&snap);
+        return 0;
+    }
+    if (!smedl_restore_begin()) {
+        err("Out of memory restoring %s", path);
+        smedl_snapshot_close(&snap);
+        return 0;
+    }
+    int success = restore_Auctionmonitor_syncset(&snap);
+    smedl_restore_end();
+    smedl_snapshot_close(&snap);
+    if (!success) {
+        err("Could not restore snapshot %s", path);
+        return 0;
+    }
+    *offset = snap.offset;
+    *msg_count = snap.msg_count;
+    snapshot_at = snap.msg_count;
+    return 1;
 }
 
+/* Attach to the named shared-memory segment as its monitor and process events
+ * until SIGINT or SIGTERM. Return nonzero on success, zero on failure. */
+static int serve_shm(const char *name) {
+    SMEDLShm shm;
+    if (!smedl_shm_open(&shm, name)) {
+        err("Could not open shared memory segment %s", name);
+        return 0;
+    }
+    if (!smedl_shm_serve(&shm)) {
+        err("Another monitor is attached to %s", name);
+        smedl_shm_close(&shm);
+        return 0;
+    }
+
+    signal(SIGINT, stop_serving);
+    signal(SIGTERM, stop_serving);
+    read_shm_events(&shm);
+
+    smedl_shm_unserve(&shm);
+    smedl_shm_close(&shm);
+    return 1;
+}
+
+/* Listen on the Unix-domain socket at path and process the frames of events
+ * clients send until SIGINT or SIGTERM. Return nonzero on success, zero on
+ * failure. */
+static int serve_socket(const char *path) {
+    signal(SIGINT, stop_serving);
+    signal(SIGTERM, stop_serving);
+    if (!smedl_serve_socket(path, handle_frame, &stopping)) {
+        return 0;
+    }
+    free_aux_batch(&aux_batch);
+
+#ifdef SMEDL_STATS_INTERVAL
+    smedl_stats_close(socket_msg_count);
+#endif
+    err("\nFinished.");
+    err("Processed %d messages.", socket_msg_count);
+    return 1;
+}
+
+#if defined(SMEDL_LATENCY) || defined(SMEDL_PROFILE)
+/* Names of the system channels, for the latency histograms and the profile */
+static const char *const channel_names[] = {
+    [SYSCHANNEL_ch1] = "ch1",
+    [SYSCHANNEL_ch2] = "ch2",
+    [SYSCHANNEL_ch3] = "ch3",
+    [SYSCHANNEL_ch4] = "ch4",
+    [SYSCHANNEL_Auctionmonitor_alarm_recreation] = "Auctionmonitor_alarm_recreation",
+    [SYSCHANNEL_Auctionmonitor_alarm_low_bid] = "Auctionmonitor_alarm_low_bid",
+    [SYSCHANNEL_Auctionmonitor_alarm_sold_early] = "Auctionmonitor_alarm_sold_early",
+    [SYSCHANNEL_Auctionmonitor_alarm_not_sold] = "Auctionmonitor_alarm_not_sold",
+    [SYSCHANNEL_Auctionmonitor_alarm_action_after_end] = "Auctionmonitor_alarm_action_after_end",
+    [SYSCHANNEL_Auctionmonitor_alarm_action_before_start] = "Auctionmonitor_alarm_action_before_start",
+};
+#endif
+
 /* Print a help message to stderr */
 static void usage(const char *name) {
     err("Usage: %s [--] [input.json]", name);
+    err("       %s --shm <name>", name);
+    err("       %s --listen <path>", name);
+    err("       %s --restore <snapshot> [input.json]", name);
     err("Read messages from the provided input file (or stdin if not provided) "
             "and print\nthe messages emitted back to the environment");
+    err("With --shm, read binary events from the named shared memory segment "
+            "(see\nshm_ring.h) until interrupted");
+    err("With --listen, accept clients on the named Unix-domain socket and "
+            "send each\nthe messages emitted for the events it sends (see "
+            "server.h) until interrupted");
+    err("With --restore, restore the monitors from the snapshot (see "
+            "snapshot.h) and\ncarry on reading the input file from where the "
+            "snapshot was taken");
 }
 
 int main(int argc, char **argv) {
     /* Check for a file name argument */
     const char *fname = NULL;
+    const char *shm_name = NULL;
+    const char *socket_path = NULL;
+    const char *snapshot_path = NULL;
     if (argc >= 2) {
         if (!strcmp(argv[1], "--help")) {
             usage(argv[0]);
@@ -590,6 +1163,28 @@ int main(int argc, char **argv) {
                 usage(argv[0]);
                 return 1;
             }
+        } else if (!strcmp(argv[1], "--shm")) {
+            if (argc == 3) {
+                shm_name = argv[2];
+            } else {
+                usage(argv[0]);
+                return 1;
+            }
+        } else if (!strcmp(argv[1], "--listen")) {
+            if (argc == 3) {
+                socket_path = argv[2];
+            } else {
+                usage(argv[0]);
+                return 1;
+            }
+        } else if (!strcmp(argv[1], "--restore")) {
+            if (argc == 3 || argc == 4) {
+                snapshot_path = argv[2];
+                fname = argc == 4 ? argv[3] : NULL;
+            } else {
+                usage(argv[0]);
+                return 1;
+            }
         }
     }
 
@@ -601,9 +1196,62 @@ int main(int argc, char **argv) {
         return 1;
     }
 
+#ifdef SMEDL_LATENCY
+    /* Time the stages of handling each event (see latency.h) */
+    if (!smedl_latency_init(channel_names,
+                sizeof(channel_names) / sizeof(channel_names[0]))) {
+        err("Could not initialize latency histograms");
+        return 1;
+    }
+#endif
+
+#ifdef SMEDL_PROFILE
+    /* Count hardware events in each stage of handling events (see profile.h) */
+    if (!smedl_profile_init(channel_names,
+                sizeof(channel_names) / sizeof(channel_names[0]))) {
+        err("Could not open any performance counters");
+        return 1;
+    }
+#endif
+
+#ifdef SMEDL_MEMSTATS
+    /* Report the memory counted for each monitor type at exit (see
+     * memstats.h) */
+    if (!smedl_mem_init()) {
+        err("Could not initialize memory accounting");
+        return 1;
+    }
+#endif
+
+    /* Pick up from a snapshot, if asked */
+    uint64_t offset = 0, msg_count = 0;
+    if (snapshot_path != NULL &&
+            !restore_snapshot(snapshot_path, &offset, &msg_count)) {
+        return 1;
+    }
+
+#ifdef SMEDL_STATS_INTERVAL
+    /* Write monitor telemetry periodically (see telemetry.h) */
+    if (!smedl_stats_open(SMEDL_STATS_FILE, SMEDL_STATS_INTERVAL,
+                write_monitor_stats)) {
+        err("Could not open %s", SMEDL_STATS_FILE);
+        return 1;
+    }
+#endif
+
+    /* Read from shared memory instead of a file, if asked */
+    if (shm_name != NULL) {
+        return serve_shm(shm_name) ? 0 : 1;
+    }
+
+    /* Or serve clients over a socket */
+    if (socket_path != NULL) {
+        return serve_socket(socket_path) ? 0 : 1;
+    }
+
     /* Initialize the parser */
     JSONParser parser;
-    result = init_parser(&parser, fname);
+    result = init_parser_at(&parser, fname, offset, msg_count);
     if (!result) {
         err("Could not initialize JSON parser");
         return 1;
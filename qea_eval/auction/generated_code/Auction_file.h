@@ -2,6 +2,7 @@
 #define Auction_FILE_H
 
 #include "file.h"
+#include "shm_ring.h"
 
 /* Current message format version. Increment the major version whenever making
  * a backward-incompatible change to the message format. Increment the minor
@@ -66,6 +67,16 @@ int enqueue_Auctionmonitor_alarm_not_sold(SMEDLValue *identities, SMEDLValue *pa
 int enqueue_Auctionmonitor_alarm_action_after_end(SMEDLValue *identities, SMEDLValue *params, void *aux);
 int enqueue_Auctionmonitor_alarm_action_before_start(SMEDLValue *identities, SMEDLValue *params, void *aux);
 
+/* Borrowed callbacks for events exported from global wrappers. These keep a
+ * reference to the exported event instead of copying it.
+ * Return nonzero on success, zero on failure. */
+int enqueue_borrowed_Auctionmonitor_alarm_recreation(SMEDLEvent *ev, void *aux);
+int enqueue_borrowed_Auctionmonitor_alarm_low_bid(SMEDLEvent *ev, void *aux);
+int enqueue_borrowed_Auctionmonitor_alarm_sold_early(SMEDLEvent *ev, void *aux);
+int enqueue_borrowed_Auctionmonitor_alarm_not_sold(SMEDLEvent *ev, void *aux);
+int enqueue_borrowed_Auctionmonitor_alarm_action_after_end(SMEDLEvent *ev, void *aux);
+int enqueue_borrowed_Auctionmonitor_alarm_action_before_start(SMEDLEvent *ev, void *aux);
+
 /* Output functions for events that are "sent back to the target system."
  * Return nonzero on success, zero on failure. */
 int write_Auctionmonitor_alarm_recreation(SMEDLValue *identities, SMEDLValue *params, void *aux);
@@ -86,6 +97,12 @@ void free_global_wrappers();
  * events are skipped (with a warning printed to stderr). */
 void read_events(JSONParser *parser);
 
+/* Receive and process events from the provided shared-memory segment until
+ * SIGINT or SIGTERM, then process the events already published. The caller
+ * must be attached as the segment's monitor. Any malformed events are skipped
+ * (with a warning printed to stderr). */
+void read_shm_events(SMEDLShm *shm);
+
 /* Verify the fmt_version and retrieve the other necessary components
  * (channel, params, aux). Return nonzero if successful, zero if something is
  * missing or incorrect.
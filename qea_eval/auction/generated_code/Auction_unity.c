@@ -0,0 +1,38 @@
+/* Unity build of the Auction system ("make unity"): all of its source files in
+ * one translation unit, so that the compiler can inline across them. The
+ * local wrappers call their monitor maps' hash and equals functions directly
+ * (see MONITORMAP_LOOKUP() in monitor_map.h), and the monitors call the global
+ * wrapper's export functions directly (see CALLBACKS() in the *_mon.c
+ * files). */
+
+/* The feature test macros of all the files, which must come before any
+ * system header */
+#define _GNU_SOURCE
+#define SMEDL_UNITY
+
+/* First, since it includes the implementation of jsmn.h, which the other files
+ * include (through json.h) for the declarations only */
+#include "json.c"
+#include "smedl_types.c"
+#include "event_queue.c"
+#include "monitor_map.c"
+#include "global_event_queue.c"
+#include "file.c"
+#include "trace_reader.c"
+#include "event_codec.c"
+#include "shm_ring.c"
+#include "server.c"
+#include "latency.c"
+#include "telemetry.c"
+#include "profile.c"
+#include "memstats.c"
+#include "snapshot.c"
+#include "spill.c"
+#include "Auction_file.c"
+
+/* Called directly by the monitors' export functions */
+#include "Auctionmonitor_global_wrapper.h"
+
+#include "Auctionmonitor_mon.c"
+#include "Auctionmonitor_local_wrapper.c"
+#include "Auctionmonitor_global_wrapper.c"
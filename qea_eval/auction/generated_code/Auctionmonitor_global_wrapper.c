@@ -4,6 +4,7 @@
 #include <stdlib.h>
 #include "smedl_types.h"
 #include "global_event_queue.h"
+#include "profile.h"
 #include "Auctionmonitor_global_wrapper.h"
 #include "Auctionmonitor_local_wrapper.h"
 #include "Auctionmonitor_mon.h"
@@ -20,6 +21,15 @@ static SMEDLCallback cb_Auctionmonitor_alarm_not_sold;
 static SMEDLCallback cb_Auctionmonitor_alarm_action_after_end;
 static SMEDLCallback cb_Auctionmonitor_alarm_action_before_start;
 
+/* Borrowed callback function pointers. Used instead of the callbacks above
+ * when set. */
+static SMEDLBorrowCallback bcb_Auctionmonitor_alarm_recreation;
+static SMEDLBorrowCallback bcb_Auctionmonitor_alarm_low_bid;
+static SMEDLBorrowCallback bcb_Auctionmonitor_alarm_sold_early;
+static SMEDLBorrowCallback bcb_Auctionmonitor_alarm_not_sold;
+static SMEDLBorrowCallback bcb_Auctionmonitor_alarm_action_after_end;
+static SMEDLBorrowCallback bcb_Auctionmonitor_alarm_action_before_start;
+
 /* Initialization interface - Initialize the global wrapper. Must be called once
  * before importing any events. Return nonzero on success, zero on failure. */
 int init_Auctionmonitor_syncset() {
@@ -45,6 +55,29 @@ void free_Auctionmonitor_syncset() {
     cb_Auctionmonitor_alarm_not_sold = NULL;
     cb_Auctionmonitor_alarm_action_after_end = NULL;
     cb_Auctionmonitor_alarm_action_before_start = NULL;
+    bcb_Auctionmonitor_alarm_recreation = NULL;
+    bcb_Auctionmonitor_alarm_low_bid = NULL;
+    bcb_Auctionmonitor_alarm_sold_early = NULL;
+    bcb_Auctionmonitor_alarm_not_sold = NULL;
+    bcb_Auctionmonitor_alarm_action_after_end = NULL;
+    bcb_Auctionmonitor_alarm_action_before_start = NULL;
+}
+
+/* Snapshot interface - Write the monitors of every local wrapper to the
+ * snapshot (see snapshot.h). Return nonzero on success, zero on failure. */
+int snapshot_Auctionmonitor_syncset(SMEDLSnapshotWriter *w) {
+    return snapshot_Auctionmonitor_monitors(w);
+}
+
+/* Restore interfaces - Reserve room in the restore block for the monitors of
+ * every local wrapper in the snapshot, then restore them. Return nonzero on
+ * success, zero on failure. */
+int reserve_Auctionmonitor_syncset(SMEDLSnapshot *snap) {
+    return reserve_Auctionmonitor_monitors(snap);
+}
+
+int restore_Auctionmonitor_syncset(SMEDLSnapshot *snap) {
+    return restore_Auctionmonitor_monitors(snap);
 }
 
 /* Intra routing function - Called by import interface functions and intra queue
@@ -54,66 +87,64 @@ int route_Auctionmonitor_ch1(SMEDLValue *identities, SMEDLValue *params, void *a
     #if DEBUG >= 4
     fprintf(stderr, "Global wrapper 'Auctionmonitor' routing for conn 'ch1'\n");
     #endif
+    SMEDL_PROFILE_ROUTE("ch1");
     {
-        SMEDLValue new_identities[1] = {
-                params[0],
-            };
+        SMEDLValue *new_identities = params;
 
-        SMEDLValue new_params[3] = {
-                params[0],
-                params[1],
-                params[2],
-            };
+        SMEDLValue *new_params = params;
 
         if (!process_Auctionmonitor_create_auction(new_identities, new_params, aux)) {
             /* malloc fail */
+            SMEDL_PROFILE_POP();
             return 0;
         }
     }
+    SMEDL_PROFILE_POP();
+    return 1;
 }
 int route_Auctionmonitor_ch2(SMEDLValue *identities, SMEDLValue *params, void *aux) {
     #if DEBUG >= 4
     fprintf(stderr, "Global wrapper 'Auctionmonitor' routing for conn 'ch2'\n");
     #endif
+    SMEDL_PROFILE_ROUTE("ch2");
     {
-        SMEDLValue new_identities[1] = {
-                params[0],
-            };
+        SMEDLValue *new_identities = params;
 
-        SMEDLValue new_params[2] = {
-                params[0],
-                params[1],
-            };
+        SMEDLValue *new_params = params;
 
         if (!process_Auctionmonitor_bid(new_identities, new_params, aux)) {
             /* malloc fail */
+            SMEDL_PROFILE_POP();
             return 0;
         }
     }
+    SMEDL_PROFILE_POP();
+    return 1;
 }
 int route_Auctionmonitor_ch3(SMEDLValue *identities, SMEDLValue *params, void *aux) {
     #if DEBUG >= 4
     fprintf(stderr, "Global wrapper 'Auctionmonitor' routing for conn 'ch3'\n");
     #endif
+    SMEDL_PROFILE_ROUTE("ch3");
     {
-        SMEDLValue new_identities[1] = {
-                params[0],
-            };
+        SMEDLValue *new_identities = params;
 
-        SMEDLValue new_params[1] = {
-                params[0],
-            };
+        SMEDLValue *new_params = params;
 
         if (!process_Auctionmonitor_sold(new_identities, new_params, aux)) {
             /* malloc fail */
+            SMEDL_PROFILE_POP();
             return 0;
         }
     }
+    SMEDL_PROFILE_POP();
+    return 1;
 }
 int route_Auctionmonitor_ch4(SMEDLValue *identities, SMEDLValue *params, void *aux) {
     #if DEBUG >= 4
     fprintf(stderr, "Global wrapper 'Auctionmonitor' routing for conn 'ch4'\n");
     #endif
+    SMEDL_PROFILE_ROUTE("ch4");
     {
         SMEDLValue new_identities[1] = {
                 {SMEDL_NULL},
@@ -123,9 +154,12 @@ int route_Auctionmonitor_ch4(SMEDLValue *identities, SMEDLValue *params, void *a
 
         if (!process_Auctionmonitor_end_of_day(new_identities, new_params, aux)) {
             /* malloc fail */
+            SMEDL_PROFILE_POP();
             return 0;
         }
     }
+    SMEDL_PROFILE_POP();
+    return 1;
 }
 
 /* Intra queue processing function - Route events to the local wrappers. Return
@@ -133,17 +167,16 @@ int route_Auctionmonitor_ch4(SMEDLValue *identities, SMEDLValue *params, void *a
 static int handle_Auctionmonitor_intra() {
     int success = 1;
     int channel;
-    SMEDLValue *identities, *params;
+    SMEDLEvent *ev;
     void *aux;
 
-    while (pop_global_event(&intra_queue, &channel, &identities, &params, &aux)) {
+    while (pop_global_shared(&intra_queue, &channel, &ev, &aux)) {
         switch (channel) {
         }
 
-        /* Event params and identites were malloc'd. They are no longer needed.
-         * (String and opaque data were already free'd in the switch.) */
-        free(identities);
-        free(params);
+        /* Drop the queue's reference. Strings and opaque data live in the
+         * event, so there is nothing else to free. */
+        smedl_event_release(ev);
     }
     return success;
 }
@@ -153,71 +186,82 @@ static int handle_Auctionmonitor_intra() {
 static int handle_Auctionmonitor_inter() {
     int success = 1;
     int channel;
-    SMEDLValue *identities, *params;
+    SMEDLEvent *ev;
     void *aux;
 
-    while (pop_global_event(&inter_queue, &channel, &identities, &params, &aux)) {
+    while (pop_global_shared(&inter_queue, &channel, &ev, &aux)) {
         switch (channel) {
             case CHANNEL_Auctionmonitor_Auctionmonitor_alarm_recreation:
 #if DEBUG >= 4
                 fprintf(stderr, "Global wrapper 'Auctionmonitor' exporting for conn 'Auctionmonitor_alarm_recreation'\n");
 #endif
-                if (cb_Auctionmonitor_alarm_recreation != NULL) {
+                if (bcb_Auctionmonitor_alarm_recreation != NULL) {
+                    success = success && bcb_Auctionmonitor_alarm_recreation(ev, aux);
+                } else if (cb_Auctionmonitor_alarm_recreation != NULL) {
                     success = success &&
-                        cb_Auctionmonitor_alarm_recreation(identities, params, aux);
+                        cb_Auctionmonitor_alarm_recreation(ev->ids, ev->params, aux);
                 }
                 break;
             case CHANNEL_Auctionmonitor_Auctionmonitor_alarm_low_bid:
 #if DEBUG >= 4
                 fprintf(stderr, "Global wrapper 'Auctionmonitor' exporting for conn 'Auctionmonitor_alarm_low_bid'\n");
 #endif
-                if (cb_Auctionmonitor_alarm_low_bid != NULL) {
+                if (bcb_Auctionmonitor_alarm_low_bid != NULL) {
+                    success = success && bcb_Auctionmonitor_alarm_low_bid(ev, aux);
+                } else if (cb_Auctionmonitor_alarm_low_bid != NULL) {
                     success = success &&
-                        cb_Auctionmonitor_alarm_low_bid(identities, params, aux);
+                        cb_Auctionmonitor_alarm_low_bid(ev->ids, ev->params, aux);
                 }
                 break;
             case CHANNEL_Auctionmonitor_Auctionmonitor_alarm_sold_early:
 #if DEBUG >= 4
                 fprintf(stderr, "Global wrapper 'Auctionmonitor' exporting for conn 'Auctionmonitor_alarm_sold_early'\n");
 #endif
-                if (cb_Auctionmonitor_alarm_sold_early != NULL) {
+                if (bcb_Auctionmonitor_alarm_sold_early != NULL) {
+                    success = success && bcb_Auctionmonitor_alarm_sold_early(ev, aux);
+                } else if (cb_Auctionmonitor_alarm_sold_early != NULL) {
                     success = success &&
-                        cb_Auctionmonitor_alarm_sold_early(identities, params, aux);
+                        cb_Auctionmonitor_alarm_sold_early(ev->ids, ev->params, aux);
                 }
                 break;
             case CHANNEL_Auctionmonitor_Auctionmonitor_alarm_not_sold:
 #if DEBUG >= 4
                 fprintf(stderr, "Global wrapper 'Auctionmonitor' exporting for conn 'Auctionmonitor_alarm_not_sold'\n");
 #endif
-                if (cb_Auctionmonitor_alarm_not_sold != NULL) {
+                if (bcb_Auctionmonitor_alarm_not_sold != NULL) {
+                    success = success && bcb_Auctionmonitor_alarm_not_sold(ev, aux);
+                } else if (cb_Auctionmonitor_alarm_not_sold != NULL) {
                     success = success &&
-                        cb_Auctionmonitor_alarm_not_sold(identities, params, aux);
+                        cb_Auctionmonitor_alarm_not_sold(ev->ids, ev->params, aux);
                 }
                 break;
             case CHANNEL_Auctionmonitor_Auctionmonitor_alarm_action_after_end:
 #if DEBUG >= 4
                 fprintf(stderr, "Global wrapper 'Auctionmonitor' exporting for conn 'Auctionmonitor_alarm_action_after_end'\n");
 #endif
-                if (cb_Auctionmonitor_alarm_action_after_end != NULL) {
+                if (bcb_Auctionmonitor_alarm_action_after_end != NULL) {
+                    success = success && bcb_Auctionmonitor_alarm_action_after_end(ev, aux);
+                } else if (cb_Auctionmonitor_alarm_action_after_end != NULL) {
                     success = success &&
-                        cb_Auctionmonitor_alarm_action_after_end(identities, params, aux);
+                        cb_Auctionmonitor_alarm_action_after_end(ev->ids, ev->params, aux);
                 }
                 break;
             case CHANNEL_Auctionmonitor_Auctionmonitor_alarm_action_before_start:
 #if DEBUG >= 4
                 fprintf(stderr, "Global wrapper 'Auctionmonitor' exporting for conn 'Auctionmonitor_alarm_action_before_start'\n");
 #endif
-                if (cb_Auctionmonitor_alarm_action_before_start != NULL) {
+                if (bcb_Auctionmonitor_alarm_action_before_start != NULL) {
+                    success = success && bcb_Auctionmonitor_alarm_action_before_start(ev, aux);
+                } else if (cb_Auctionmonitor_alarm_action_before_start != NULL) {
                     success = success &&
-                        cb_Auctionmonitor_alarm_action_before_start(identities, params, aux);
+                        cb_Auctionmonitor_alarm_action_before_start(ev->ids, ev->params, aux);
                 }
                 break;
         }
 
-        /* Event params and identites were malloc'd. They are no longer needed.
-         * (String and opaque data were already free'd in the switch.) */
-        free(identities);
-        free(params);
+        /* Drop the queue's reference. Strings and opaque data live in the
+         * event, so there is nothing else to free. */
+        smedl_event_release(ev);
     }
     return success;
 }
@@ -242,64 +286,88 @@ static int handle_Auctionmonitor_queues() {
  *   exported event
  */
 int raise_Auctionmonitor_alarm_recreation(SMEDLValue *identities, SMEDLValue *params, void *aux) {
-    SMEDLValue *ids_copy = smedl_copy_array(identities, 1);
+    SMEDLEvent *ev = smedl_event_new(identities, 1, params, 0);
+    if (ev == NULL) {
+        /* malloc fail */
+        return 0;
+    }
     /* Store on inter queue */
-    SMEDLValue *params_inter = smedl_copy_array(params, 0);
-    if (!push_global_event(&inter_queue, CHANNEL_Auctionmonitor_Auctionmonitor_alarm_recreation, ids_copy, params_inter, aux)) {
+    if (!push_global_shared(&inter_queue, CHANNEL_Auctionmonitor_Auctionmonitor_alarm_recreation, ev, aux)) {
         /* malloc fail */
-        smedl_free_array(params_inter, 0);
+        smedl_event_release(ev);
         return 0;
     }
+    return 1;
 }
 int raise_Auctionmonitor_alarm_low_bid(SMEDLValue *identities, SMEDLValue *params, void *aux) {
-    SMEDLValue *ids_copy = smedl_copy_array(identities, 1);
+    SMEDLEvent *ev = smedl_event_new(identities, 1, params, 0);
+    if (ev == NULL) {
+        /* malloc fail */
+        return 0;
+    }
     /* Store on inter queue */
-    SMEDLValue *params_inter = smedl_copy_array(params, 0);
-    if (!push_global_event(&inter_queue, CHANNEL_Auctionmonitor_Auctionmonitor_alarm_low_bid, ids_copy, params_inter, aux)) {
+    if (!push_global_shared(&inter_queue, CHANNEL_Auctionmonitor_Auctionmonitor_alarm_low_bid, ev, aux)) {
         /* malloc fail */
-        smedl_free_array(params_inter, 0);
+        smedl_event_release(ev);
         return 0;
     }
+    return 1;
 }
 int raise_Auctionmonitor_alarm_sold_early(SMEDLValue *identities, SMEDLValue *params, void *aux) {
-    SMEDLValue *ids_copy = smedl_copy_array(identities, 1);
+    SMEDLEvent *ev = smedl_event_new(identities, 1, params, 0);
+    if (ev == NULL) {
+        /* malloc fail */
+        return 0;
+    }
     /* Store on inter queue */
-    SMEDLValue *params_inter = smedl_copy_array(params, 0);
-    if (!push_global_event(&inter_queue, CHANNEL_Auctionmonitor_Auctionmonitor_alarm_sold_early, ids_copy, params_inter, aux)) {
+    if (!push_global_shared(&inter_queue, CHANNEL_Auctionmonitor_Auctionmonitor_alarm_sold_early, ev, aux)) {
         /* malloc fail */
-        smedl_free_array(params_inter, 0);
+        smedl_event_release(ev);
         return 0;
     }
+    return 1;
 }
 int raise_Auctionmonitor_alarm_not_sold(SMEDLValue *identities, SMEDLValue *params, void *aux) {
-    SMEDLValue *ids_copy = smedl_copy_array(identities, 1);
+    SMEDLEvent *ev = smedl_event_new(identities, 1, params, 0);
+    if (ev == NULL) {
+        /* malloc fail */
+        return 0;
+    }
     /* Store on inter queue */
-    SMEDLValue *params_inter = smedl_copy_array(params, 0);
-    if (!push_global_event(&inter_queue, CHANNEL_Auctionmonitor_Auctionmonitor_alarm_not_sold, ids_copy, params_inter, aux)) {
+    if (!push_global_shared(&inter_queue, CHANNEL_Auctionmonitor_Auctionmonitor_alarm_not_sold, ev, aux)) {
         /* malloc fail */
-        smedl_free_array(params_inter, 0);
+        smedl_event_release(ev);
         return 0;
     }
+    return 1;
 }
 int raise_Auctionmonitor_alarm_action_after_end(SMEDLValue *identities, SMEDLValue *params, void *aux) {
-    SMEDLValue *ids_copy = smedl_copy_array(identities, 1);
+    SMEDLEvent *ev = smedl_event_new(identities, 1, params, 0);
+    if (ev == NULL) {
+        /* malloc fail */
+        return 0;
+    }
     /* Store on inter queue */
-    SMEDLValue *params_inter = smedl_copy_array(params, 0);
-    if (!push_global_event(&inter_queue, CHANNEL_Auctionmonitor_Auctionmonitor_alarm_action_after_end, ids_copy, params_inter, aux)) {
+    if (!push_global_shared(&inter_queue, CHANNEL_Auctionmonitor_Auctionmonitor_alarm_action_after_end, ev, aux)) {
         /* malloc fail */
-        smedl_free_array(params_inter, 0);
+        smedl_event_release(ev);
         return 0;
     }
+    return 1;
 }
 int raise_Auctionmonitor_alarm_action_before_start(SMEDLValue *identities, SMEDLValue *params, void *aux) {
-    SMEDLValue *ids_copy = smedl_copy_array(identities, 1);
+    SMEDLEvent *ev = smedl_event_new(identities, 1, params, 0);
+    if (ev == NULL) {
+        /* malloc fail */
+        return 0;
+    }
     /* Store on inter queue */
-    SMEDLValue *params_inter = smedl_copy_array(params, 0);
-    if (!push_global_event(&inter_queue, CHANNEL_Auctionmonitor_Auctionmonitor_alarm_action_before_start, ids_copy, params_inter, aux)) {
+    if (!push_global_shared(&inter_queue, CHANNEL_Auctionmonitor_Auctionmonitor_alarm_action_before_start, ev, aux)) {
         /* malloc fail */
-        smedl_free_array(params_inter, 0);
+        smedl_event_release(ev);
         return 0;
     }
+    return 1;
 }
 
 /* Global wrapper import interface - Called by the environment (other
@@ -335,6 +403,26 @@ int import_Auctionmonitor_ch4(SMEDLValue *identities, SMEDLValue *params, void *
     return handle_Auctionmonitor_queues() && success;
 }
 
+/* Routing functions for the batch import interface, indexed by import
+ * channel */
+static const SMEDLCallback import_routes[] = {
+    [IMPORT_Auctionmonitor_ch1] = route_Auctionmonitor_ch1,
+    [IMPORT_Auctionmonitor_ch2] = route_Auctionmonitor_ch2,
+    [IMPORT_Auctionmonitor_ch3] = route_Auctionmonitor_ch3,
+    [IMPORT_Auctionmonitor_ch4] = route_Auctionmonitor_ch4,
+};
+
+int import_Auctionmonitor_batch(SMEDLImportEvent *events, size_t count) {
+    int success = 1;
+
+    for (size_t i = 0; i < count; i++) {
+        SMEDLImportEvent *ev = &events[i];
+        success = import_routes[ev->channel](ev->identities, ev->params,
+                ev->aux) && success;
+    }
+    return handle_Auctionmonitor_inter() && success;
+}
+
 /* Global wrapper callback interface - Used to register callback functions to be
  * called by this global wrapper when it has an event to export to the
  * environment (other synchronous sets, the target system).
@@ -369,3 +457,38 @@ void callback_Auctionmonitor_Auctionmonitor_alarm_action_after_end(SMEDLCallback
 void callback_Auctionmonitor_Auctionmonitor_alarm_action_before_start(SMEDLCallback cb_func) {
     cb_Auctionmonitor_alarm_action_before_start = cb_func;
 }
+
+/* Global wrapper borrowed callback interface - Used to register callback
+ * functions to be called by this global wrapper when it has an event to export
+ * to the environment, passing the event itself instead of copies of its
+ * identities and params. When set, these are called instead of the callbacks
+ * registered above.
+ *
+ * Parameters:
+ * cb_func - A function pointer for the callback to register, or NULL to
+ *   unregister a callback. Must accept two parameters: The SMEDLEvent, which
+ *   is only borrowed for the duration of the call, and a void * for
+ *   passthrough data. */
+void callback_borrowed_Auctionmonitor_Auctionmonitor_alarm_recreation(SMEDLBorrowCallback cb_func) {
+    bcb_Auctionmonitor_alarm_recreation = cb_func;
+}
+
+void callback_borrowed_Auctionmonitor_Auctionmonitor_alarm_low_bid(SMEDLBorrowCallback cb_func) {
+    bcb_Auctionmonitor_alarm_low_bid = cb_func;
+}
+
+void callback_borrowed_Auctionmonitor_Auctionmonitor_alarm_sold_early(SMEDLBorrowCallback cb_func) {
+    bcb_Auctionmonitor_alarm_sold_early = cb_func;
+}
+
+void callback_borrowed_Auctionmonitor_Auctionmonitor_alarm_not_sold(SMEDLBorrowCallback cb_func) {
+    bcb_Auctionmonitor_alarm_not_sold = cb_func;
+}
+
+void callback_borrowed_Auctionmonitor_Auctionmonitor_alarm_action_after_end(SMEDLBorrowCallback cb_func) {
+    bcb_Auctionmonitor_alarm_action_after_end = cb_func;
+}
+
+void callback_borrowed_Auctionmonitor_Auctionmonitor_alarm_action_before_start(SMEDLBorrowCallback cb_func) {
+    bcb_Auctionmonitor_alarm_action_before_start = cb_func;
+}
@@ -2,6 +2,7 @@
 #define Auctionmonitor_GLOBAL_WRAPPER_H
 
 #include "smedl_types.h"
+#include "snapshot.h"
 
 /******************************************************************************
  * External Interface                                                         *
@@ -15,6 +16,17 @@ int init_Auctionmonitor_syncset();
  * wrapper and all the local wrappers and monitors it manages. */
 void free_Auctionmonitor_syncset();
 
+/* Snapshot interface - Write the monitors of every local wrapper to the
+ * snapshot (see snapshot.h). Return nonzero on success, zero on failure. */
+int snapshot_Auctionmonitor_syncset(SMEDLSnapshotWriter *w);
+
+/* Restore interfaces - Reserve room in the restore block for the monitors of
+ * every local wrapper in the snapshot, then restore them, between
+ * smedl_restore_begin() and smedl_restore_end() (see snapshot.h). Return
+ * nonzero on success, zero on failure. */
+int reserve_Auctionmonitor_syncset(SMEDLSnapshot *snap);
+int restore_Auctionmonitor_syncset(SMEDLSnapshot *snap);
+
 /* Global wrapper export interfaces - Called by monitors to place exported
  * events into the appropriate export queues, where they will later be routed to
  * the proper destinations inside and outside the synchronous set.
@@ -51,6 +63,27 @@ int import_Auctionmonitor_ch2(SMEDLValue *identities, SMEDLValue *params, void *
 int import_Auctionmonitor_ch3(SMEDLValue *identities, SMEDLValue *params, void *aux);
 int import_Auctionmonitor_ch4(SMEDLValue *identities, SMEDLValue *params, void *aux);
 
+/* Import channels for the batch import interface */
+typedef enum {
+    IMPORT_Auctionmonitor_ch1,
+    IMPORT_Auctionmonitor_ch2,
+    IMPORT_Auctionmonitor_ch3,
+    IMPORT_Auctionmonitor_ch4,
+} AuctionmonitorImportID;
+
+/* Global wrapper batch import interface - Called by the environment to import
+ * several events with one call. Events are routed in order. Events exported to
+ * the environment are queued and the export callbacks are called once, after
+ * the last event is routed.
+ * Returns nonzero on success, zero on failure.
+ *
+ * Parameters:
+ * events - An array of events. Each channel is a value from the import channel
+ *   enum above. identities, params, and aux are as for the single-event import
+ *   functions.
+ * count - The number of events in the array */
+int import_Auctionmonitor_batch(SMEDLImportEvent *events, size_t count);
+
 /* Global wrapper callback interface - Used to register callback functions to be
  * called by this global wrapper when it has an event to export to the
  * environment (other synchronous sets, the target system).
@@ -68,6 +101,24 @@ void callback_Auctionmonitor_Auctionmonitor_alarm_not_sold(SMEDLCallback cb_func
 void callback_Auctionmonitor_Auctionmonitor_alarm_action_after_end(SMEDLCallback cb_func);
 void callback_Auctionmonitor_Auctionmonitor_alarm_action_before_start(SMEDLCallback cb_func);
 
+/* Global wrapper borrowed callback interface - Used to register callback
+ * functions to be called by this global wrapper when it has an event to export
+ * to the environment, passing the event itself instead of copies of its
+ * identities and params. When set, these are called instead of the callbacks
+ * registered above.
+ *
+ * Parameters:
+ * cb_func - A function pointer for the callback to register, or NULL to
+ *   unregister a callback. Must accept two parameters: The SMEDLEvent, which
+ *   is only borrowed for the duration of the call, and a void * for
+ *   passthrough data. */
+void callback_borrowed_Auctionmonitor_Auctionmonitor_alarm_recreation(SMEDLBorrowCallback cb_func);
+void callback_borrowed_Auctionmonitor_Auctionmonitor_alarm_low_bid(SMEDLBorrowCallback cb_func);
+void callback_borrowed_Auctionmonitor_Auctionmonitor_alarm_sold_early(SMEDLBorrowCallback cb_func);
+void callback_borrowed_Auctionmonitor_Auctionmonitor_alarm_not_sold(SMEDLBorrowCallback cb_func);
+void callback_borrowed_Auctionmonitor_Auctionmonitor_alarm_action_after_end(SMEDLBorrowCallback cb_func);
+void callback_borrowed_Auctionmonitor_Auctionmonitor_alarm_action_before_start(SMEDLBorrowCallback cb_func);
+
 /******************************************************************************
  * End of External Interface                                                  *
  ******************************************************************************/
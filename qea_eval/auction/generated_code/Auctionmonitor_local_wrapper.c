@@ -6,6 +6,8 @@
 #include <string.h>
 #include "smedl_types.h"
 #include "monitor_map.h"
+#include "profile.h"
+#include "spill.h"
 #include "Auctionmonitor_global_wrapper.h"
 #include "Auctionmonitor_local_wrapper.h"
 #include "Auctionmonitor_mon.h"
@@ -32,47 +34,200 @@
 static MonitorMap monitor_map_all;
 static MonitorMap monitor_map_none;
 
+/* Population counters for the stats interface */
+static uint64_t dynamic_count, created_count, recycled_count;
+
+#ifdef SMEDL_SPILL_BUDGET
+/* Cold monitor storage (see spill.h).
+ *
+ * At most SMEDL_SPILL_BUDGET monitors are kept in memory. Before another is
+ * created or faulted in, the least recently used ones are spilled to the spill
+ * table, in SMEDL_SPILL_FILE, and freed. Monitors in memory are kept on a list
+ * from the most to the least recently used, and move to the front whenever an
+ * event is looked up for them. A spilled monitor is faulted back in when an
+ * event is looked up for it. Monitors with callbacks of their own are never
+ * spilled.
+ *
+ * 'end_of_day' broadcasts do not fault monitors in. The batch handler handles
+ * them for the monitors in memory, and they are counted in end_of_day_epoch. A
+ * spilled monitor records the count when it was spilled, and the broadcasts it
+ * missed are replayed when it is faulted in. Nothing else is broadcast through
+ * the batch handler; lookups with wildcards fault every spilled monitor in
+ * first, after which memory is back within the budget only once the next
+ * monitor is brought in. */
+static SMEDLSpill spill;
+static uint64_t end_of_day_epoch;
+
+/* Ends of the list of monitors in memory */
+static AuctionmonitorMonitor *lru_head, *lru_tail;
+
+/* Put a monitor at the front of the list */
+static void lru_push(AuctionmonitorMonitor *mon) {
+    mon->lru_prev = NULL;
+    mon->lru_next = lru_head;
+    if (lru_head != NULL) {
+        lru_head->lru_prev = mon;
+    } else {
+        lru_tail = mon;
+    }
+    lru_head = mon;
+}
+
+/* Take a monitor off the list */
+static void lru_unlink(AuctionmonitorMonitor *mon) {
+    if (mon->lru_prev != NULL) {
+        mon->lru_prev->lru_next = mon->lru_next;
+    } else {
+        lru_head = mon->lru_next;
+    }
+    if (mon->lru_next != NULL) {
+        mon->lru_next->lru_prev = mon->lru_prev;
+    } else {
+        lru_tail = mon->lru_prev;
+    }
+}
+
+/* Store a spilled monitor in the spill table, opening it first if needed.
+ * Return nonzero on success, zero on failure. */
+static int put_Auctionmonitor_spilled(AuctionmonitorIdentities *ids, AuctionmonitorSpilled *spilled) {
+    if (spill.table == NULL &&
+            !smedl_spill_open(&spill, SMEDL_SPILL_FILE, sizeof(AuctionmonitorIdentities), sizeof(AuctionmonitorSpilled))) {
+        return 0;
+    }
+    return smedl_spill_put(&spill, ids, spilled);
+}
+
+/* Spill least recently used monitors until there is room in memory for one
+ * more. If the spill table cannot be opened or grown, monitors stay in memory
+ * over the budget. */
+static void evict_Auctionmonitor_monitors() {
+    AuctionmonitorMonitor *mon = lru_tail;
+    while (monitor_map_all.count >= SMEDL_SPILL_BUDGET && mon != NULL) {
+        AuctionmonitorMonitor *prev = mon->lru_prev;
+        if (mon->callbacks == NULL) {
+            AuctionmonitorSpilled spilled;
+            spill_Auctionmonitor_monitor(mon, &spilled);
+            spilled.end_of_day_epoch = end_of_day_epoch;
+            if (!put_Auctionmonitor_spilled(&mon->identities, &spilled)) {
+#if DEBUG >= 1
+                fprintf(stderr, "Local wrapper 'Auctionmonitor' could not spill a monitor\n");
+#endif
+                return;
+            }
+            lru_unlink(mon);
+            monitormap_remove(&monitor_map_all, mon);
+            free_Auctionmonitor_monitor(mon);
+        }
+        mon = prev;
+    }
+}
+
+/* Bring a spilled monitor back into memory, catching up on the 'end_of_day'
+ * broadcasts it missed. Return a MonitorInstance for it, or INVALID_INSTANCE on
+ * failure (the monitor is lost). */
+static MonitorInstance * fault_Auctionmonitor_monitor(AuctionmonitorIdentities *ids, AuctionmonitorSpilled *spilled) {
+    replay_Auctionmonitor_end_of_day(spilled, end_of_day_epoch - spilled->end_of_day_epoch);
+    AuctionmonitorMonitor *mon = unspill_Auctionmonitor_monitor(ids, spilled);
+    if (mon == NULL) {
+        /* malloc fail */
+        return INVALID_INSTANCE;
+    }
+    MonitorInstance *inst = add_Auctionmonitor_monitor(mon);
+    if (inst == NULL) {
+        /* malloc fail */
+        free_Auctionmonitor_monitor(mon);
+        return INVALID_INSTANCE;
+    }
+    return inst;
+}
+
+/* Fault in the spilled monitor with the given identities, if there is one.
+ * Return a MonitorInstance for it, NULL if there is none, or INVALID_INSTANCE
+ * on failure. */
+static MonitorInstance * unspill_Auctionmonitor(AuctionmonitorIdentities *ids) {
+    AuctionmonitorSpilled *found = smedl_spill_find(&spill, ids);
+    if (found == NULL) {
+        return NULL;
+    }
+    /* Take it out of the table before making room, which may spill others */
+    AuctionmonitorSpilled spilled = *found;
+    smedl_spill_remove(&spill, found);
+    evict_Auctionmonitor_monitors();
+    return fault_Auctionmonitor_monitor(ids, &spilled);
+}
+
+/* Fault in every spilled monitor. Return nonzero on success, zero on
+ * failure. */
+static int unspill_all_Auctionmonitor() {
+    AuctionmonitorIdentities ids;
+    AuctionmonitorSpilled spilled;
+    while (smedl_spill_pop(&spill, &ids, &spilled)) {
+        if (fault_Auctionmonitor_monitor(&ids, &spilled) == INVALID_INSTANCE) {
+            return 0;
+        }
+    }
+    return 1;
+}
+#endif
+
 /* Monitor map hash functions - One for each monitor map */
 
-static uint64_t hash_all(SMEDLValue *ids) {
+static uint64_t hash_all(const void *key) {
+    const AuctionmonitorIdentities *ids = key;
     murmur_state s = MURMUR_INIT(0);
-    murmur(&ids[0].v.i, sizeof(ids[0].v.i), &s);
+    murmur(&ids->id0, sizeof(ids->id0), &s);
     return murmur_f(&s);
 }
 
-static uint64_t hash_none(SMEDLValue *ids) {
+static uint64_t hash_none(const void *key) {
     murmur_state s = MURMUR_INIT(0);
     return murmur_f(&s);
 }
 
 /* Monitor map equals functions - One for each monitor map */
 
-static int equals_all(SMEDLValue *ids1, SMEDLValue *ids2) {
-    if (ids1[0].v.i != ids2[0].v.i) {
+static int equals_all(const void *key1, const void *key2) {
+    const AuctionmonitorIdentities *ids1 = key1, *ids2 = key2;
+    if (ids1->id0 != ids2->id0) {
         return 0;
     }
     return 1;
 }
 
-static int equals_none(SMEDLValue *ids1, SMEDLValue *ids2) {
+static int equals_none(const void *key1, const void *key2) {
     return 1;
 }
 
-/* Register the global wrapper's export callbacks with the monitor */
-static void setup_Auctionmonitor_callbacks(AuctionmonitorMonitor *mon) {
-    register_Auctionmonitor_alarm_recreation(mon, raise_Auctionmonitor_alarm_recreation);
-    register_Auctionmonitor_alarm_low_bid(mon, raise_Auctionmonitor_alarm_low_bid);
-    register_Auctionmonitor_alarm_sold_early(mon, raise_Auctionmonitor_alarm_sold_early);
-    register_Auctionmonitor_alarm_not_sold(mon, raise_Auctionmonitor_alarm_not_sold);
-    register_Auctionmonitor_alarm_action_after_end(mon, raise_Auctionmonitor_alarm_action_after_end);
-    register_Auctionmonitor_alarm_action_before_start(mon, raise_Auctionmonitor_alarm_action_before_start);
-    registercleanup_Auctionmonitor(mon, recycle_Auctionmonitor_monitor);
+/* Identity conversion - Fill in an identity tuple from an array of SMEDLValue
+ * as given to the import interfaces. Wildcard identities are left as they
+ * are in the array; lookups with wildcards use monitor maps that ignore them. */
+static void load_Auctionmonitor_ids(AuctionmonitorIdentities *ids, SMEDLValue *identities) {
+    ids->id0 = identities[0].v.i;
+}
+
+/* Register the global wrapper's export callbacks in the callback table shared
+ * by all Auctionmonitor monitors */
+static void setup_Auctionmonitor_callbacks() {
+    AuctionmonitorCallbacks callbacks = {
+        .callback_alarm_recreation = raise_Auctionmonitor_alarm_recreation,
+        .callback_alarm_low_bid = raise_Auctionmonitor_alarm_low_bid,
+        .callback_alarm_sold_early = raise_Auctionmonitor_alarm_sold_early,
+        .callback_alarm_not_sold = raise_Auctionmonitor_alarm_not_sold,
+        .callback_alarm_action_after_end = raise_Auctionmonitor_alarm_action_after_end,
+        .callback_alarm_action_before_start = raise_Auctionmonitor_alarm_action_before_start,
+        .cleanup = recycle_Auctionmonitor_monitor,
+    };
+    registershared_Auctionmonitor(&callbacks);
 }
 
 /* Initialization interface - Initialize the local wrapper. Must be called once
  * before creating any monitors or importing any events.
  * Return nonzero on success, zero on failure. */
 int init_Auctionmonitor_local_wrapper() {
+    /* Count the monitor maps with the monitors (see memstats.h) */
+    SMEDL_MEM_REGISTER(&Auctionmonitor_memory);
+    monitor_map_all.account = &Auctionmonitor_memory;
+    monitor_map_none.account = &Auctionmonitor_memory;
     if (!monitormap_init(&monitor_map_all, offsetof(AuctionmonitorMonitor, identities), hash_all, equals_all)) {
         goto fail_init_monitor_map_all;
     }
@@ -80,6 +235,8 @@ int init_Auctionmonitor_local_wrapper() {
         goto fail_init_monitor_map_none;
     }
 
+    setup_Auctionmonitor_callbacks();
+
     return 1;
 
 fail_init_monitor_map_none:
@@ -91,16 +248,131 @@ fail_init_monitor_map_all:
 /* Cleanup interface - Tear down and free the resources used by this local
  * wrapper and all the monitors it manages */
 void free_Auctionmonitor_local_wrapper() {
+#ifdef SMEDL_SPILL_BUDGET
+    smedl_spill_close(&spill);
+    lru_head = lru_tail = NULL;
+#endif
     MonitorInstance *instances = monitormap_free(&monitor_map_all, 1);
     monitormap_free(&monitor_map_none, 0);
 
     while (instances != NULL) {
         MonitorInstance *tmp = instances->next;
-        smedl_free_array(((AuctionmonitorMonitor *) instances->mon)->identities, 1);
         free_Auctionmonitor_monitor(instances->mon);
-        free(instances);
+        SMEDL_FREE_OBJECT(&Auctionmonitor_memory, SMEDL_MEM_MAP_INSTANCE, instances);
         instances = tmp;
     }
+    free_Auctionmonitor_store();
+}
+
+/* Count interface - Return the number of live Auctionmonitor monitors */
+size_t count_Auctionmonitor_monitors() {
+#ifdef SMEDL_SPILL_BUDGET
+    return monitor_map_all.count + spill.count;
+#else
+    return monitor_map_all.count;
+#endif
+}
+
+/* Stats interface - Fill in the population of Auctionmonitor monitors and the
+ * health of its monitor maps */
+void stats_Auctionmonitor_monitors(MonitorStats *stats) {
+#ifdef SMEDL_SPILL_BUDGET
+    stats->live = monitor_map_all.count + spill.count;
+    stats->spilled = spill.count;
+#else
+    stats->live = monitor_map_all.count;
+    stats->spilled = 0;
+#endif
+    stats->dynamic = dynamic_count;
+    stats->created = created_count;
+    stats->recycled = recycled_count;
+    stats->map_count = 2;
+    stats->maps[0].name = "all";
+    monitormap_stats(&monitor_map_all, &stats->maps[0].stats);
+    stats->maps[1].name = "none";
+    monitormap_stats(&monitor_map_none, &stats->maps[1].stats);
+}
+
+/* Bytes in the snapshot record of a Auctionmonitor monitor: its identities, then
+ * its scenario states and state variables */
+#define Auctionmonitor_RECORD_SIZE (SMEDL_SNAPSHOT_INT + Auctionmonitor_SNAPSHOT_SIZE)
+
+/* Snapshot interface - Write the section for Auctionmonitor monitors to the snapshot
+ * (see snapshot.h). Return nonzero on success, zero on failure. */
+int snapshot_Auctionmonitor_monitors(SMEDLSnapshotWriter *w) {
+    smedl_snapshot_begin(w, "Auctionmonitor", Auctionmonitor_RECORD_SIZE, count_Auctionmonitor_monitors(),
+            dynamic_count, created_count, recycled_count);
+    for (size_t i = 0; i < monitor_map_all.capacity; i++) {
+        if (monitor_map_all.table[i].dib == 0) {
+            continue;
+        }
+        for (MonitorInstance *inst = monitor_map_all.table[i].head; inst != NULL; inst = inst->next) {
+            AuctionmonitorMonitor *mon = inst->mon;
+            smedl_snapshot_put_int(w, mon->identities.id0);
+            snapshot_Auctionmonitor_monitor(mon, w);
+        }
+    }
+#ifdef SMEDL_SPILL_BUDGET
+    /* Spilled monitors are written as they would be once faulted in */
+    size_t pos = 0;
+    const void *key, *value;
+    while (smedl_spill_next(&spill, &pos, &key, &value)) {
+        const AuctionmonitorIdentities *ids = key;
+        AuctionmonitorSpilled spilled = *(const AuctionmonitorSpilled *) value;
+        replay_Auctionmonitor_end_of_day(&spilled, end_of_day_epoch - spilled.end_of_day_epoch);
+        smedl_snapshot_put_int(w, ids->id0);
+        snapshot_Auctionmonitor_spilled(&spilled, w);
+    }
+#endif
+    return smedl_snapshot_end(w);
+}
+
+/* Restore interfaces - Reserve room in the restore block for the Auctionmonitor
+ * monitors in the snapshot, then restore them. Return nonzero on success,
+ * zero on failure. */
+int reserve_Auctionmonitor_monitors(SMEDLSnapshot *snap) {
+    return smedl_restore_reserve(snap, "Auctionmonitor", Auctionmonitor_RECORD_SIZE, sizeof(AuctionmonitorMonitor), 2);
+}
+
+int restore_Auctionmonitor_monitors(SMEDLSnapshot *snap) {
+    const SMEDLSnapshotSection *section = smedl_snapshot_section(snap, "Auctionmonitor", Auctionmonitor_RECORD_SIZE);
+    if (section == NULL) {
+        return 0;
+    }
+    if (!monitormap_reserve(&monitor_map_all, section->count)) {
+        return 0;
+    }
+    for (uint64_t i = 0; i < section->count; i++) {
+        /* The monitor struct and map nodes come from the restore block. */
+        AuctionmonitorIdentities ids;
+        ids.id0 = smedl_snapshot_get_int(snap);
+#ifdef SMEDL_SPILL_BUDGET
+        /* Monitors past the budget go straight to the spill table. (The room
+         * reserved for them in the restore block is never touched.) */
+        if (monitor_map_all.count >= SMEDL_SPILL_BUDGET) {
+            AuctionmonitorSpilled spilled;
+            restore_Auctionmonitor_spilled(&spilled, snap);
+            spilled.end_of_day_epoch = end_of_day_epoch;
+            if (!put_Auctionmonitor_spilled(&ids, &spilled)) {
+                return 0;
+            }
+            continue;
+        }
+#endif
+        AuctionmonitorMonitor *mon = init_Auctionmonitor_monitor(&ids);
+        if (mon == NULL) {
+            return 0;
+        }
+        restore_Auctionmonitor_monitor(mon, snap);
+        if (add_Auctionmonitor_monitor(mon) == NULL) {
+            free_Auctionmonitor_monitor(mon);
+            return 0;
+        }
+    }
+    dynamic_count = section->dynamic;
+    created_count = section->created;
+    recycled_count = section->recycled;
+    return !snap->error;
 }
 
 /* Creation interface - Instantiate a new Auctionmonitor monitor.
@@ -114,8 +386,15 @@ void free_Auctionmonitor_local_wrapper() {
  *   state can be retrieved with default_Auctionmonitor_state()
  *   and then just the desired variables can be updated. */
 int create_Auctionmonitor_monitor(SMEDLValue *identities, AuctionmonitorState *init_state) {
+    AuctionmonitorIdentities ids;
+    load_Auctionmonitor_ids(&ids, identities);
+
     /* Check if monitor with identities already exists */
-    if (monitormap_lookup(&monitor_map_all, identities) != NULL) {
+    if (MONITORMAP_LOOKUP(&monitor_map_all, &ids, hash_all, equals_all) != NULL
+#ifdef SMEDL_SPILL_BUDGET
+            || smedl_spill_find(&spill, &ids) != NULL
+#endif
+            ) {
 #if DEBUG >= 4
         fprintf(stderr, "Local wrapper 'Auctionmonitor' skipping explicit creation for existing monitor\n");
 #endif
@@ -125,27 +404,24 @@ int create_Auctionmonitor_monitor(SMEDLValue *identities, AuctionmonitorState *i
     fprintf(stderr, "Local wrapper 'Auctionmonitor' doing explicit creation\n");
 #endif
 
+#ifdef SMEDL_SPILL_BUDGET
+    evict_Auctionmonitor_monitors();
+#endif
+
     /* Initialize new monitor with identities and state */
-    SMEDLValue *ids_copy = smedl_copy_array(identities, 1);
-    if (ids_copy == NULL) {
-        /* malloc fail */
-        return 0;
-    }
-    AuctionmonitorMonitor *mon = init_Auctionmonitor_with_state(ids_copy, init_state);
+    AuctionmonitorMonitor *mon = init_Auctionmonitor_with_state(&ids, init_state);
     if (mon == NULL) {
         /* malloc fail */
-        smedl_free_array(ids_copy, 1);
         return 0;
     }
-    setup_Auctionmonitor_callbacks(mon);
 
     /* Store monitor in maps */
     if (add_Auctionmonitor_monitor(mon) == NULL) {
         /* malloc fail */
         free_Auctionmonitor_monitor(mon);
-        smedl_free_array(ids_copy, 1);
         return 0;
     }
+    created_count++;
     return 1;
 }
 
@@ -165,7 +441,9 @@ int process_Auctionmonitor_create_auction(SMEDLValue *identities, SMEDLValue *pa
 #endif
     /* Fetch the monitors to send the event to or do dynamic instantiation if
      * necessary */
-    MonitorInstance *instances = get_Auctionmonitor_monitors(identities);
+    SMEDL_PROFILE_PUSH(SMEDL_PROFILE_STAGE_LOOKUP);
+    MonitorInstance *instances = get_Auctionmonitor_monitors(identities, 1);
+    SMEDL_PROFILE_POP();
     if (instances == INVALID_INSTANCE) {
         /* malloc fail */
         return 0;
@@ -176,9 +454,11 @@ int process_Auctionmonitor_create_auction(SMEDLValue *identities, SMEDLValue *pa
     while (instances != NULL) {
         AuctionmonitorMonitor *mon = instances->mon;
         instances = instances->next;
+        SMEDL_PROFILE_PUSH(SMEDL_PROFILE_STAGE_EXECUTE);
         if (!execute_Auctionmonitor_create_auction(mon, params, aux)) {
             success = 0;
         }
+        SMEDL_PROFILE_POP();
     }
     return success;
 }
@@ -187,9 +467,11 @@ int process_Auctionmonitor_bid(SMEDLValue *identities, SMEDLValue *params, void
 #if DEBUG >= 4
     fprintf(stderr, "Local wrapper 'Auctionmonitor' processing event 'bid'\n");
 #endif
-    /* Fetch the monitors to send the event to or do dynamic instantiation if
-     * necessary */
-    MonitorInstance *instances = get_Auctionmonitor_monitors(identities);
+    /* Fetch the monitors to send the event to. 'bid' is not a creation
+     * event, so no dynamic instantiation is done */
+    SMEDL_PROFILE_PUSH(SMEDL_PROFILE_STAGE_LOOKUP);
+    MonitorInstance *instances = get_Auctionmonitor_monitors(identities, 0);
+    SMEDL_PROFILE_POP();
     if (instances == INVALID_INSTANCE) {
         /* malloc fail */
         return 0;
@@ -200,9 +482,11 @@ int process_Auctionmonitor_bid(SMEDLValue *identities, SMEDLValue *params, void
     while (instances != NULL) {
         AuctionmonitorMonitor *mon = instances->mon;
         instances = instances->next;
+        SMEDL_PROFILE_PUSH(SMEDL_PROFILE_STAGE_EXECUTE);
         if (!execute_Auctionmonitor_bid(mon, params, aux)) {
             success = 0;
         }
+        SMEDL_PROFILE_POP();
     }
     return success;
 }
@@ -211,9 +495,11 @@ int process_Auctionmonitor_sold(SMEDLValue *identities, SMEDLValue *params, void
 #if DEBUG >= 4
     fprintf(stderr, "Local wrapper 'Auctionmonitor' processing event 'sold'\n");
 #endif
-    /* Fetch the monitors to send the event to or do dynamic instantiation if
-     * necessary */
-    MonitorInstance *instances = get_Auctionmonitor_monitors(identities);
+    /* Fetch the monitors to send the event to. 'sold' is not a creation
+     * event, so no dynamic instantiation is done */
+    SMEDL_PROFILE_PUSH(SMEDL_PROFILE_STAGE_LOOKUP);
+    MonitorInstance *instances = get_Auctionmonitor_monitors(identities, 0);
+    SMEDL_PROFILE_POP();
     if (instances == INVALID_INSTANCE) {
         /* malloc fail */
         return 0;
@@ -224,9 +510,11 @@ int process_Auctionmonitor_sold(SMEDLValue *identities, SMEDLValue *params, void
     while (instances != NULL) {
         AuctionmonitorMonitor *mon = instances->mon;
         instances = instances->next;
+        SMEDL_PROFILE_PUSH(SMEDL_PROFILE_STAGE_EXECUTE);
         if (!execute_Auctionmonitor_sold(mon, params, aux)) {
             success = 0;
         }
+        SMEDL_PROFILE_POP();
     }
     return success;
 }
@@ -235,9 +523,25 @@ int process_Auctionmonitor_end_of_day(SMEDLValue *identities, SMEDLValue *params
 #if DEBUG >= 4
     fprintf(stderr, "Local wrapper 'Auctionmonitor' processing event 'end_of_day'\n");
 #endif
-    /* Fetch the monitors to send the event to or do dynamic instantiation if
-     * necessary */
-    MonitorInstance *instances = get_Auctionmonitor_monitors(identities);
+    /* Sent to every monitor: run the batch handler over the columnar store.
+     * 'end_of_day' raises no events, so no per-monitor macro-steps are
+     * needed. */
+    if (identities[0].t == SMEDL_NULL) {
+        SMEDL_PROFILE_PUSH(SMEDL_PROFILE_STAGE_EXECUTE);
+        int result = batch_Auctionmonitor_end_of_day(params, aux);
+        SMEDL_PROFILE_POP();
+#ifdef SMEDL_SPILL_BUDGET
+        /* Spilled monitors catch up when faulted in */
+        end_of_day_epoch++;
+#endif
+        return result;
+    }
+
+    /* Fetch the monitors to send the event to. 'end_of_day' is not a creation
+     * event, so no dynamic instantiation is done */
+    SMEDL_PROFILE_PUSH(SMEDL_PROFILE_STAGE_LOOKUP);
+    MonitorInstance *instances = get_Auctionmonitor_monitors(identities, 0);
+    SMEDL_PROFILE_POP();
     if (instances == INVALID_INSTANCE) {
         /* malloc fail */
         return 0;
@@ -248,9 +552,11 @@ int process_Auctionmonitor_end_of_day(SMEDLValue *identities, SMEDLValue *params
     while (instances != NULL) {
         AuctionmonitorMonitor *mon = instances->mon;
         instances = instances->next;
+        SMEDL_PROFILE_PUSH(SMEDL_PROFILE_STAGE_EXECUTE);
         if (!execute_Auctionmonitor_end_of_day(mon, params, aux)) {
             success = 0;
         }
+        SMEDL_PROFILE_POP();
     }
     return success;
 }
@@ -260,10 +566,13 @@ int process_Auctionmonitor_end_of_day(SMEDLValue *identities, SMEDLValue *params
 int recycle_Auctionmonitor_monitor(AuctionmonitorMonitor *mon) {
 #if DEBUG >= 4
         fprintf(stderr, "Recycling an instance of 'Auctionmonitor'\n");
+#endif
+#ifdef SMEDL_SPILL_BUDGET
+    lru_unlink(mon);
 #endif
     monitormap_remove(&monitor_map_all, mon);
-    smedl_free_array(mon->identities, 1);
     free_Auctionmonitor_monitor(mon);
+    recycled_count++;
     return 1;
 }
 
@@ -274,19 +583,22 @@ MonitorInstance * add_Auctionmonitor_monitor(AuctionmonitorMonitor *mon) {
     MonitorMap *prev_map = NULL;
     MonitorInstance *inst;
 
-    inst = monitormap_insert(&monitor_map_none, mon, prev_inst, prev_map);
+    inst = MONITORMAP_INSERT(&monitor_map_none, mon, prev_inst, prev_map, hash_none, equals_none);
     if (inst == NULL) {
         return NULL;
     }
     prev_inst = inst;
     prev_map = &monitor_map_none;
 
-    inst = monitormap_insert(&monitor_map_all, mon, prev_inst, prev_map);
+    inst = MONITORMAP_INSERT(&monitor_map_all, mon, prev_inst, prev_map, hash_all, equals_all);
     if (inst == NULL) {
         monitormap_removeinst(prev_map, prev_inst);
         return NULL;
     }
 
+#ifdef SMEDL_SPILL_BUDGET
+    lru_push(mon);
+#endif
     return inst;
 }
 
@@ -297,19 +609,42 @@ MonitorInstance * add_Auctionmonitor_monitor(AuctionmonitorMonitor *mon) {
  *
  * If there are no matching monitor instances but the identity list is fully
  * specified (i.e. there are no wildcards), create an instance with those
- * identities and return it.
+ * identities and return it. This is only done when create is nonzero, i.e.
+ * for creation events: events with a transition out of the initial state of
+ * at least one scenario. An instance created by any other event could never
+ * leave its initial states, so the event is simply dropped.
  *
  * Returns a linked list of MonitorInstance (which may be empty, i.e. NULL).
  * If dynamic instantiation fails, returns INVALID_INSTANCE. */
-MonitorInstance * get_Auctionmonitor_monitors(SMEDLValue *identities) {
+MonitorInstance * get_Auctionmonitor_monitors(SMEDLValue *identities, int create) {
+    AuctionmonitorIdentities ids;
+    load_Auctionmonitor_ids(&ids, identities);
+
     /* Look up from the proper monitor map */
     MonitorInstance *instances;
     int dynamic_instantiation = 0;
     if (identities[0].t == SMEDL_NULL) {
-        instances = monitormap_lookup(&monitor_map_none, identities);
+#ifdef SMEDL_SPILL_BUDGET
+        if (!unspill_all_Auctionmonitor()) {
+            return INVALID_INSTANCE;
+        }
+#endif
+        instances = MONITORMAP_LOOKUP(&monitor_map_none, &ids, hash_none, equals_none);
     } else {
-        instances = monitormap_lookup(&monitor_map_all, identities);
-        dynamic_instantiation = 1;
+        instances = MONITORMAP_LOOKUP(&monitor_map_all, &ids, hash_all, equals_all);
+        dynamic_instantiation = create;
+#ifdef SMEDL_SPILL_BUDGET
+        if (instances != NULL) {
+            AuctionmonitorMonitor *mon = instances->mon;
+            lru_unlink(mon);
+            lru_push(mon);
+        } else if (spill.count > 0) {
+            instances = unspill_Auctionmonitor(&ids);
+            if (instances == INVALID_INSTANCE) {
+                return INVALID_INSTANCE;
+            }
+        }
+#endif
     }
 
     /* Do dynamic instantiation if wildcards were fully specified and there
@@ -318,25 +653,21 @@ MonitorInstance * get_Auctionmonitor_monitors(SMEDLValue *identities) {
 #if DEBUG >= 4
         fprintf(stderr, "Dynamic instantiation for 'Auctionmonitor'\n");
 #endif
-        SMEDLValue *ids_copy = smedl_copy_array(identities, 1);
-        if (ids_copy == NULL) {
-            /* malloc fail */
-            return INVALID_INSTANCE;
-        }
-        AuctionmonitorMonitor *mon = init_Auctionmonitor_monitor(ids_copy);
+#ifdef SMEDL_SPILL_BUDGET
+        evict_Auctionmonitor_monitors();
+#endif
+        AuctionmonitorMonitor *mon = init_Auctionmonitor_monitor(&ids);
         if (mon == NULL) {
             /* malloc fail */
-            smedl_free_array(ids_copy, 1);
             return INVALID_INSTANCE;
         }
-        setup_Auctionmonitor_callbacks(mon);
         instances = add_Auctionmonitor_monitor(mon);
         if (instances == NULL) {
             /* malloc fail */
             free_Auctionmonitor_monitor(mon);
-            smedl_free_array(ids_copy, 1);
             return INVALID_INSTANCE;
         }
+        dynamic_count++;
     }
 
     return instances;
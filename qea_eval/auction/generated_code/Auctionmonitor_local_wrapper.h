@@ -4,6 +4,7 @@
 #include <stdint.h>
 #include "smedl_types.h"
 #include "monitor_map.h"
+#include "snapshot.h"
 #include "Auctionmonitor_mon.h"
 
 /******************************************************************************
@@ -19,6 +20,24 @@ int init_Auctionmonitor_local_wrapper();
  * wrapper and all the monitors it manages */
 void free_Auctionmonitor_local_wrapper();
 
+/* Count interface - Return the number of live Auctionmonitor monitors */
+size_t count_Auctionmonitor_monitors();
+
+/* Stats interface - Fill in the population of Auctionmonitor monitors and the
+ * health of its monitor maps */
+void stats_Auctionmonitor_monitors(MonitorStats *stats);
+
+/* Snapshot interface - Write the section for Auctionmonitor monitors to the snapshot
+ * (see snapshot.h). Return nonzero on success, zero on failure. */
+int snapshot_Auctionmonitor_monitors(SMEDLSnapshotWriter *w);
+
+/* Restore interfaces - Reserve room in the restore block for the Auctionmonitor
+ * monitors in the snapshot, then restore them, between smedl_restore_begin()
+ * and smedl_restore_end(). There must be no Auctionmonitor monitors yet. Return
+ * nonzero on success, zero on failure. */
+int reserve_Auctionmonitor_monitors(SMEDLSnapshot *snap);
+int restore_Auctionmonitor_monitors(SMEDLSnapshot *snap);
+
 /* Creation interface - Instantiate a new Auctionmonitor monitor.
  * Return nonzero on success or if monitor already exists, zero on failure.
  *
@@ -62,10 +81,13 @@ MonitorInstance * add_Auctionmonitor_monitor(AuctionmonitorMonitor *mon);
  *
  * If there are no matching monitor instances but the identity list is fully
  * specified (i.e. there are no wildcards), create an instance with those
- * identities and return it.
+ * identities and return it. This is only done when create is nonzero, i.e.
+ * for creation events: events with a transition out of the initial state of
+ * at least one scenario. An instance created by any other event could never
+ * leave its initial states, so the event is simply dropped.
  *
  * Returns a linked list of MonitorInstance (which may be empty, i.e. NULL).
  * If dynamic instantiation fails, returns INVALID_INSTANCE. */
-MonitorInstance * get_Auctionmonitor_monitors(SMEDLValue *identities);
+MonitorInstance * get_Auctionmonitor_monitors(SMEDLValue *identities, int create);
 
 #endif /* Auctionmonitor_LOCAL_WRAPPER_H */
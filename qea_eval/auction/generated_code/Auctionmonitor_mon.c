@@ -6,39 +6,118 @@
 #include "smedl_types.h"
 #include "event_queue.h"
 #include "Auctionmonitor_mon.h"
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+
+/* Columnar store holding the scenario states and state variables of every
+ * Auctionmonitor monitor */
+static AuctionmonitorStore store;
+
+/* Access a monitor's scenario state and state variables in the store */
+#define MAIN_STATE(mon) (store.main_state[(mon)->slot])
+#define STATE_VAR(mon, var) (store.var[(mon)->slot])
+
+/* Memory counted for Auctionmonitor monitors */
+SMEDLMemAccount Auctionmonitor_memory = {"Auctionmonitor"};
+
+/* Callback table shared by all Auctionmonitor monitors without their own */
+static AuctionmonitorCallbacks shared_callbacks;
+
+/* The callback table in effect for a monitor. In a unity build, the export
+ * functions call the global wrapper's raise_*() functions directly for
+ * monitors without a table of their own, since those are the shared callbacks
+ * the local wrapper registers. */
+#define CALLBACKS(mon) ((mon)->callbacks != NULL ? (mon)->callbacks : &shared_callbacks)
+
+/* Convert the monitor's identities to an array of SMEDLValue for the export
+ * callbacks */
+static void get_Auctionmonitor_id_values(AuctionmonitorMonitor *mon, SMEDLValue *values) {
+    values[0].t = SMEDL_INT;
+    values[0].v.i = mon->identities.id0;
+}
+
+/* Shared callback registration function - Set the callback table used by all
+ * Auctionmonitor monitors that have not registered callbacks of their own */
+void registershared_Auctionmonitor(const AuctionmonitorCallbacks *callbacks) {
+    shared_callbacks = *callbacks;
+}
+
+/* Give the monitor its own copy of the shared callback table so its callbacks
+ * can be changed without affecting other monitors. Return nonzero on success,
+ * zero on malloc failure. */
+static int own_Auctionmonitor_callbacks(AuctionmonitorMonitor *mon) {
+    if (mon->callbacks == NULL) {
+        mon->callbacks = SMEDL_MALLOC(&Auctionmonitor_memory, SMEDL_MEM_CALLBACKS,
+                sizeof(AuctionmonitorCallbacks));
+        if (mon->callbacks == NULL) {
+            return 0;
+        }
+        *mon->callbacks = shared_callbacks;
+    }
+    return 1;
+}
 
 /* Callback registration functions - Set the export callback for an exported
- * event */
+ * event on a single monitor */
 
-void register_Auctionmonitor_alarm_recreation(AuctionmonitorMonitor *mon, SMEDLCallback cb_func) {
-    mon->callback_alarm_recreation = cb_func;
+int register_Auctionmonitor_alarm_recreation(AuctionmonitorMonitor *mon, SMEDLCallback cb_func) {
+    if (!own_Auctionmonitor_callbacks(mon)) {
+        return 0;
+    }
+    mon->callbacks->callback_alarm_recreation = cb_func;
+    return 1;
 }
 
-void register_Auctionmonitor_alarm_low_bid(AuctionmonitorMonitor *mon, SMEDLCallback cb_func) {
-    mon->callback_alarm_low_bid = cb_func;
+int register_Auctionmonitor_alarm_low_bid(AuctionmonitorMonitor *mon, SMEDLCallback cb_func) {
+    if (!own_Auctionmonitor_callbacks(mon)) {
+        return 0;
+    }
+    mon->callbacks->callback_alarm_low_bid = cb_func;
+    return 1;
 }
 
-void register_Auctionmonitor_alarm_sold_early(AuctionmonitorMonitor *mon, SMEDLCallback cb_func) {
-    mon->callback_alarm_sold_early = cb_func;
+int register_Auctionmonitor_alarm_sold_early(AuctionmonitorMonitor *mon, SMEDLCallback cb_func) {
+    if (!own_Auctionmonitor_callbacks(mon)) {
+        return 0;
+    }
+    mon->callbacks->callback_alarm_sold_early = cb_func;
+    return 1;
 }
 
-void register_Auctionmonitor_alarm_not_sold(AuctionmonitorMonitor *mon, SMEDLCallback cb_func) {
-    mon->callback_alarm_not_sold = cb_func;
+int register_Auctionmonitor_alarm_not_sold(AuctionmonitorMonitor *mon, SMEDLCallback cb_func) {
+    if (!own_Auctionmonitor_callbacks(mon)) {
+        return 0;
+    }
+    mon->callbacks->callback_alarm_not_sold = cb_func;
+    return 1;
 }
 
-void register_Auctionmonitor_alarm_action_after_end(AuctionmonitorMonitor *mon, SMEDLCallback cb_func) {
-    mon->callback_alarm_action_after_end = cb_func;
+int register_Auctionmonitor_alarm_action_after_end(AuctionmonitorMonitor *mon, SMEDLCallback cb_func) {
+    if (!own_Auctionmonitor_callbacks(mon)) {
+        return 0;
+    }
+    mon->callbacks->callback_alarm_action_after_end = cb_func;
+    return 1;
 }
 
-void register_Auctionmonitor_alarm_action_before_start(AuctionmonitorMonitor *mon, SMEDLCallback cb_func) {
-    mon->callback_alarm_action_before_start = cb_func;
+int register_Auctionmonitor_alarm_action_before_start(AuctionmonitorMonitor *mon, SMEDLCallback cb_func) {
+    if (!own_Auctionmonitor_callbacks(mon)) {
+        return 0;
+    }
+    mon->callbacks->callback_alarm_action_before_start = cb_func;
+    return 1;
 }
 
 /* Cleanup callback registration function - Set the callback for when the
  * monitor is ready to be recycled. The callback is responsible for calling
  * free_Auctionmonitor_monitor(). */
-void registercleanup_Auctionmonitor(AuctionmonitorMonitor *mon, int (*cleanup_func)(AuctionmonitorMonitor *mon)) {
-    mon->cleanup = cleanup_func;
+int registercleanup_Auctionmonitor(AuctionmonitorMonitor *mon, int (*cleanup_func)(AuctionmonitorMonitor *mon)) {
+    if (!own_Auctionmonitor_callbacks(mon)) {
+        return 0;
+    }
+    mon->callbacks->cleanup = cleanup_func;
+    return 1;
 }
 
 /* Queue processing function - Call the handlers for all the events in the
@@ -50,6 +129,13 @@ static int handle_Auctionmonitor_queue(AuctionmonitorMonitor *mon) {
     SMEDLValue *params;
     void *aux;
 
+    /* Scenario execution flags only guard events raised within a macro-step.
+     * If nothing was raised, there is nothing to handle and no flags to
+     * reset. */
+    if (mon->event_queue.head == NULL) {
+        return 1;
+    }
+
     while (pop_event(&mon->event_queue, &event, &params, &aux)) {
         switch (event) {
             case EVENT_Auctionmonitor_alarm_recreation:
@@ -109,6 +195,186 @@ static int handle_Auctionmonitor_queue(AuctionmonitorMonitor *mon) {
 
 /* Imported events */
 
+#ifdef SMEDL_TABLE_DISPATCH
+
+/* Table-driven dispatch - Instead of a switch over the scenario state in every
+ * execute_* function, each scenario has a dense (state x imported event) table
+ * of transition indices. Index 0 means the scenario does not handle the event
+ * in that state. Transitions that perform the same guard and action from
+ * different states share an index. The transitions themselves are labels in
+ * the scenario's step function, reached with a computed goto where the
+ * compiler supports labels as values and a switch (jump table) otherwise. */
+
+/* Imported event indices (columns of the transition tables) */
+typedef enum {
+    IMPORT_Auctionmonitor_create_auction,
+    IMPORT_Auctionmonitor_bid,
+    IMPORT_Auctionmonitor_sold,
+    IMPORT_Auctionmonitor_end_of_day,
+} AuctionmonitorImport;
+
+/* main scenario transition table */
+static const unsigned char table_Auctionmonitor_main[5][4] = {
+    /*                   create_auction, bid, sold, end_of_day */
+    /* init */          {1, 0, 0, 0},
+    /* bidding */       {2, 3, 4, 5},
+    /* above_reserve */ {2, 6, 7, 5},
+    /* error */         {0, 0, 0, 0},
+    /* done */          {2, 8, 8, 9},
+};
+
+/* Raise an exported event with no parameters. Return nonzero on success, zero
+ * on malloc failure. */
+static int raise_empty_Auctionmonitor(AuctionmonitorMonitor *mon,
+        int (*queue_func)(AuctionmonitorMonitor *, SMEDLValue *, void *),
+        void *aux) {
+    SMEDLValue *new_params = malloc(sizeof(SMEDLValue) * 0);
+    if (new_params == NULL) {
+        /* malloc fail */
+        return 0;
+    }
+    queue_func(mon, new_params, aux);
+    return 1;
+}
+
+/* Take the main scenario transition for the given imported event from the
+ * current state, if any. Return nonzero on success, zero on failure. */
+static int step_Auctionmonitor_main(AuctionmonitorMonitor *mon, AuctionmonitorImport event, SMEDLValue *params, void *aux) {
+    unsigned char t = table_Auctionmonitor_main[MAIN_STATE(mon)][event];
+#ifdef __GNUC__
+    static const void *const transitions[] = {
+        &&t0, &&t1, &&t2, &&t3, &&t4, &&t5, &&t6, &&t7, &&t8, &&t9,
+    };
+    goto *transitions[t];
+#else
+    switch (t) {
+        case 1: goto t1;
+        case 2: goto t2;
+        case 3: goto t3;
+        case 4: goto t4;
+        case 5: goto t5;
+        case 6: goto t6;
+        case 7: goto t7;
+        case 8: goto t8;
+        case 9: goto t9;
+        default: goto t0;
+    }
+#endif
+
+t0: /* No transition for this event from this state */
+    return 1;
+
+t1: /* init -> create_auction(item, minimum, period) -> bidding */
+    STATE_VAR(mon, reserve_price) = params[1].v.i;
+    STATE_VAR(mon, duration) = params[2].v.i;
+    MAIN_STATE(mon) = STATE_Auctionmonitor_main_bidding;
+    return 1;
+
+t2: /* bidding, above_reserve, done -> create_auction -> error */
+    if (!raise_empty_Auctionmonitor(mon, queue_Auctionmonitor_alarm_recreation, aux)) {
+        return 0;
+    }
+    MAIN_STATE(mon) = STATE_Auctionmonitor_main_error;
+    return 1;
+
+t3: /* bidding -> bid(item, amount) -> above_reserve */
+    STATE_VAR(mon, current_price) = params[1].v.i;
+    MAIN_STATE(mon) = STATE_Auctionmonitor_main_above_reserve;
+    return 1;
+
+t4: /* bidding -> sold(item) -> error */
+    if (!raise_empty_Auctionmonitor(mon, queue_Auctionmonitor_alarm_sold_early, aux)) {
+        return 0;
+    }
+    MAIN_STATE(mon) = STATE_Auctionmonitor_main_error;
+    return 1;
+
+t5: /* bidding, above_reserve -> end_of_day() -> same state, else done */
+    if (STATE_VAR(mon, days_passed) < STATE_VAR(mon, duration) - 1) {
+        STATE_VAR(mon, days_passed)++;
+    } else {
+        MAIN_STATE(mon) = STATE_Auctionmonitor_main_done;
+    }
+    return 1;
+
+t6: /* above_reserve -> bid(item, amount) -> above_reserve */
+    if (params[1].v.i > STATE_VAR(mon, current_price)) {
+        STATE_VAR(mon, current_price) = params[1].v.i;
+    }
+    return 1;
+
+t7: /* above_reserve -> sold(item) -> error, else done */
+    if (STATE_VAR(mon, current_price) < STATE_VAR(mon, reserve_price)) {
+        if (!raise_empty_Auctionmonitor(mon, queue_Auctionmonitor_alarm_low_bid, aux)) {
+            return 0;
+        }
+        MAIN_STATE(mon) = STATE_Auctionmonitor_main_error;
+        return 1;
+    }
+    MAIN_STATE(mon) = STATE_Auctionmonitor_main_done;
+    return 1;
+
+t8: /* done -> bid, sold -> error */
+    if (!raise_empty_Auctionmonitor(mon, queue_Auctionmonitor_alarm_action_after_end, aux)) {
+        return 0;
+    }
+    MAIN_STATE(mon) = STATE_Auctionmonitor_main_error;
+    return 1;
+
+t9: /* done -> end_of_day() -> done */
+    return 1;
+}
+
+int execute_Auctionmonitor_create_auction(AuctionmonitorMonitor *mon, SMEDLValue *params, void *aux) {
+#if DEBUG >= 4
+    fprintf(stderr, "Monitor 'Auctionmonitor' handling imported event 'create_auction'\n");
+#endif
+    if (!step_Auctionmonitor_main(mon, IMPORT_Auctionmonitor_create_auction, params, aux)) {
+        return 0;
+    }
+
+    /* Finish the macro-step */
+    return handle_Auctionmonitor_queue(mon);
+}
+
+int execute_Auctionmonitor_bid(AuctionmonitorMonitor *mon, SMEDLValue *params, void *aux) {
+#if DEBUG >= 4
+    fprintf(stderr, "Monitor 'Auctionmonitor' handling imported event 'bid'\n");
+#endif
+    if (!step_Auctionmonitor_main(mon, IMPORT_Auctionmonitor_bid, params, aux)) {
+        return 0;
+    }
+
+    /* Finish the macro-step */
+    return handle_Auctionmonitor_queue(mon);
+}
+
+int execute_Auctionmonitor_sold(AuctionmonitorMonitor *mon, SMEDLValue *params, void *aux) {
+#if DEBUG >= 4
+    fprintf(stderr, "Monitor 'Auctionmonitor' handling imported event 'sold'\n");
+#endif
+    if (!step_Auctionmonitor_main(mon, IMPORT_Auctionmonitor_sold, params, aux)) {
+        return 0;
+    }
+
+    /* Finish the macro-step */
+    return handle_Auctionmonitor_queue(mon);
+}
+
+int execute_Auctionmonitor_end_of_day(AuctionmonitorMonitor *mon, SMEDLValue *params, void *aux) {
+#if DEBUG >= 4
+    fprintf(stderr, "Monitor 'Auctionmonitor' handling imported event 'end_of_day'\n");
+#endif
+    if (!step_Auctionmonitor_main(mon, IMPORT_Auctionmonitor_end_of_day, params, aux)) {
+        return 0;
+    }
+
+    /* Finish the macro-step */
+    return handle_Auctionmonitor_queue(mon);
+}
+
+#else /* SMEDL_TABLE_DISPATCH */
+
 int execute_Auctionmonitor_create_auction(AuctionmonitorMonitor *mon, SMEDLValue *params, void *aux) {
 #if DEBUG >= 4
     fprintf(stderr, "Monitor 'Auctionmonitor' handling imported event 'create_auction'\n");
@@ -116,13 +382,13 @@ int execute_Auctionmonitor_create_auction(AuctionmonitorMonitor *mon, SMEDLValue
 
     /* main scenario */
     //if (!mon->ef.main_flag) {
-        switch (mon->main_state) {
+        switch (MAIN_STATE(mon)) {
             case STATE_Auctionmonitor_main_init:
                 if (1) {
-                    mon->s.reserve_price = params[1].v.i;
-                    mon->s.duration = params[2].v.i;
+                    STATE_VAR(mon, reserve_price) = params[1].v.i;
+                    STATE_VAR(mon, duration) = params[2].v.i;
 
-                    mon->main_state = STATE_Auctionmonitor_main_bidding;
+                    MAIN_STATE(mon) = STATE_Auctionmonitor_main_bidding;
                 } else {
                     /* XXX Do something here: Event matches but conditions
                      * not met, no else */
@@ -140,7 +406,7 @@ int execute_Auctionmonitor_create_auction(AuctionmonitorMonitor *mon, SMEDLValue
                         queue_Auctionmonitor_alarm_recreation(mon, new_params, aux);
                     }
 
-                    mon->main_state = STATE_Auctionmonitor_main_error;
+                    MAIN_STATE(mon) = STATE_Auctionmonitor_main_error;
                 } else {
                     /* XXX Do something here: Event matches but conditions
                      * not met, no else */
@@ -158,7 +424,7 @@ int execute_Auctionmonitor_create_auction(AuctionmonitorMonitor *mon, SMEDLValue
                         queue_Auctionmonitor_alarm_recreation(mon, new_params, aux);
                     }
 
-                    mon->main_state = STATE_Auctionmonitor_main_error;
+                    MAIN_STATE(mon) = STATE_Auctionmonitor_main_error;
                 } else {
                     /* XXX Do something here: Event matches but conditions
                      * not met, no else */
@@ -176,7 +442,7 @@ int execute_Auctionmonitor_create_auction(AuctionmonitorMonitor *mon, SMEDLValue
                         queue_Auctionmonitor_alarm_recreation(mon, new_params, aux);
                     }
 
-                    mon->main_state = STATE_Auctionmonitor_main_error;
+                    MAIN_STATE(mon) = STATE_Auctionmonitor_main_error;
                 } else {
                     /* XXX Do something here: Event matches but conditions
                      * not met, no else */
@@ -202,12 +468,12 @@ int execute_Auctionmonitor_bid(AuctionmonitorMonitor *mon, SMEDLValue *params, v
 
     /* main scenario */
     //if (!mon->ef.main_flag) {
-        switch (mon->main_state) {
+        switch (MAIN_STATE(mon)) {
             case STATE_Auctionmonitor_main_bidding:
                 if (1) {
-                    mon->s.current_price = params[1].v.i;
+                    STATE_VAR(mon, current_price) = params[1].v.i;
 
-                    mon->main_state = STATE_Auctionmonitor_main_above_reserve;
+                    MAIN_STATE(mon) = STATE_Auctionmonitor_main_above_reserve;
                 } else {
                     /* XXX Do something here: Event matches but conditions
                      * not met, no else */
@@ -215,10 +481,10 @@ int execute_Auctionmonitor_bid(AuctionmonitorMonitor *mon, SMEDLValue *params, v
                 break;
 
             case STATE_Auctionmonitor_main_above_reserve:
-                if (params[1].v.i > mon->s.current_price) {
-                    mon->s.current_price = params[1].v.i;
+                if (params[1].v.i > STATE_VAR(mon, current_price)) {
+                    STATE_VAR(mon, current_price) = params[1].v.i;
 
-                    mon->main_state = STATE_Auctionmonitor_main_above_reserve;
+                    MAIN_STATE(mon) = STATE_Auctionmonitor_main_above_reserve;
                 } else {
                     /* XXX Do something here: Event matches but conditions
                      * not met, no else */
@@ -236,7 +502,7 @@ int execute_Auctionmonitor_bid(AuctionmonitorMonitor *mon, SMEDLValue *params, v
                         queue_Auctionmonitor_alarm_action_after_end(mon, new_params, aux);
                     }
 
-                    mon->main_state = STATE_Auctionmonitor_main_error;
+                    MAIN_STATE(mon) = STATE_Auctionmonitor_main_error;
                 } else {
                     /* XXX Do something here: Event matches but conditions
                      * not met, no else */
@@ -262,7 +528,7 @@ int execute_Auctionmonitor_sold(AuctionmonitorMonitor *mon, SMEDLValue *params,
 
     /* main scenario */
     //if (!mon->ef.main_flag) {
-        switch (mon->main_state) {
+        switch (MAIN_STATE(mon)) {
             case STATE_Auctionmonitor_main_bidding:
                 if (1) {
                     {
@@ -274,7 +540,7 @@ int execute_Auctionmonitor_sold(AuctionmonitorMonitor *mon, SMEDLValue *params,
                         queue_Auctionmonitor_alarm_sold_early(mon, new_params, aux);
                     }
 
-                    mon->main_state = STATE_Auctionmonitor_main_error;
+                    MAIN_STATE(mon) = STATE_Auctionmonitor_main_error;
                 } else {
                     /* XXX Do something here: Event matches but conditions
                      * not met, no else */
@@ -282,7 +548,7 @@ int execute_Auctionmonitor_sold(AuctionmonitorMonitor *mon, SMEDLValue *params,
                 break;
 
             case STATE_Auctionmonitor_main_above_reserve:
-                if (mon->s.current_price < mon->s.reserve_price) {
+                if (STATE_VAR(mon, current_price) < STATE_VAR(mon, reserve_price)) {
                     {
                         SMEDLValue *new_params = malloc(sizeof(SMEDLValue) * 0);
                         if (new_params == NULL) {
@@ -292,10 +558,10 @@ int execute_Auctionmonitor_sold(AuctionmonitorMonitor *mon, SMEDLValue *params,
                         queue_Auctionmonitor_alarm_low_bid(mon, new_params, aux);
                     }
 
-                    mon->main_state = STATE_Auctionmonitor_main_error;
+                    MAIN_STATE(mon) = STATE_Auctionmonitor_main_error;
                 } else {
 
-                    mon->main_state = STATE_Auctionmonitor_main_done;
+                    MAIN_STATE(mon) = STATE_Auctionmonitor_main_done;
                 }
                 break;
 
@@ -310,7 +576,7 @@ int execute_Auctionmonitor_sold(AuctionmonitorMonitor *mon, SMEDLValue *params,
                         queue_Auctionmonitor_alarm_action_after_end(mon, new_params, aux);
                     }
 
-                    mon->main_state = STATE_Auctionmonitor_main_error;
+                    MAIN_STATE(mon) = STATE_Auctionmonitor_main_error;
                 } else {
                     /* XXX Do something here: Event matches but conditions
                      * not met, no else */
@@ -336,33 +602,33 @@ int execute_Auctionmonitor_end_of_day(AuctionmonitorMonitor *mon, SMEDLValue *pa
 
     /* main scenario */
     //if (!mon->ef.main_flag) {
-        switch (mon->main_state) {
+        switch (MAIN_STATE(mon)) {
             case STATE_Auctionmonitor_main_bidding:
-                if (mon->s.days_passed < mon->s.duration - 1) {
-                    mon->s.days_passed++;
+                if (STATE_VAR(mon, days_passed) < STATE_VAR(mon, duration) - 1) {
+                    STATE_VAR(mon, days_passed)++;
 
-                    mon->main_state = STATE_Auctionmonitor_main_bidding;
+                    MAIN_STATE(mon) = STATE_Auctionmonitor_main_bidding;
                 } else {
 
-                    mon->main_state = STATE_Auctionmonitor_main_done;
+                    MAIN_STATE(mon) = STATE_Auctionmonitor_main_done;
                 }
                 break;
 
             case STATE_Auctionmonitor_main_above_reserve:
-                if (mon->s.days_passed < mon->s.duration - 1) {
-                    mon->s.days_passed++;
+                if (STATE_VAR(mon, days_passed) < STATE_VAR(mon, duration) - 1) {
+                    STATE_VAR(mon, days_passed)++;
 
-                    mon->main_state = STATE_Auctionmonitor_main_above_reserve;
+                    MAIN_STATE(mon) = STATE_Auctionmonitor_main_above_reserve;
                 } else {
 
-                    mon->main_state = STATE_Auctionmonitor_main_done;
+                    MAIN_STATE(mon) = STATE_Auctionmonitor_main_done;
                 }
                 break;
 
             case STATE_Auctionmonitor_main_done:
                 if (1) {
 
-                    mon->main_state = STATE_Auctionmonitor_main_done;
+                    MAIN_STATE(mon) = STATE_Auctionmonitor_main_done;
                 } else {
                     /* XXX Do something here: Event matches but conditions
                      * not met, no else */
@@ -381,6 +647,8 @@ int execute_Auctionmonitor_end_of_day(AuctionmonitorMonitor *mon, SMEDLValue *pa
     return handle_Auctionmonitor_queue(mon);
 }
 
+#endif /* SMEDL_TABLE_DISPATCH */
+
 /* Exported events */
 
 int execute_Auctionmonitor_alarm_recreation(AuctionmonitorMonitor *mon, SMEDLValue *params, void *aux) {
@@ -401,8 +669,18 @@ int queue_Auctionmonitor_alarm_recreation(AuctionmonitorMonitor *mon, SMEDLValue
 }
 
 int export_Auctionmonitor_alarm_recreation(AuctionmonitorMonitor *mon, SMEDLValue *params, void *aux) {
-    if (mon->callback_alarm_recreation != NULL) {
-        return (mon->callback_alarm_recreation)(mon->identities, params, aux);
+#ifdef SMEDL_UNITY
+    if (mon->callbacks == NULL) {
+        SMEDLValue identities[1];
+        get_Auctionmonitor_id_values(mon, identities);
+        return raise_Auctionmonitor_alarm_recreation(identities, params, aux);
+    }
+#endif
+    SMEDLCallback cb_func = CALLBACKS(mon)->callback_alarm_recreation;
+    if (cb_func != NULL) {
+        SMEDLValue identities[1];
+        get_Auctionmonitor_id_values(mon, identities);
+        return cb_func(identities, params, aux);
     }
     return 1;
 }
@@ -425,8 +703,18 @@ int queue_Auctionmonitor_alarm_low_bid(AuctionmonitorMonitor *mon, SMEDLValue *p
 }
 
 int export_Auctionmonitor_alarm_low_bid(AuctionmonitorMonitor *mon, SMEDLValue *params, void *aux) {
-    if (mon->callback_alarm_low_bid != NULL) {
-        return (mon->callback_alarm_low_bid)(mon->identities, params, aux);
+#ifdef SMEDL_UNITY
+    if (mon->callbacks == NULL) {
+        SMEDLValue identities[1];
+        get_Auctionmonitor_id_values(mon, identities);
+        return raise_Auctionmonitor_alarm_low_bid(identities, params, aux);
+    }
+#endif
+    SMEDLCallback cb_func = CALLBACKS(mon)->callback_alarm_low_bid;
+    if (cb_func != NULL) {
+        SMEDLValue identities[1];
+        get_Auctionmonitor_id_values(mon, identities);
+        return cb_func(identities, params, aux);
     }
     return 1;
 }
@@ -449,8 +737,18 @@ int queue_Auctionmonitor_alarm_sold_early(AuctionmonitorMonitor *mon, SMEDLValue
 }
 
 int export_Auctionmonitor_alarm_sold_early(AuctionmonitorMonitor *mon, SMEDLValue *params, void *aux) {
-    if (mon->callback_alarm_sold_early != NULL) {
-        return (mon->callback_alarm_sold_early)(mon->identities, params, aux);
+#ifdef SMEDL_UNITY
+    if (mon->callbacks == NULL) {
+        SMEDLValue identities[1];
+        get_Auctionmonitor_id_values(mon, identities);
+        return raise_Auctionmonitor_alarm_sold_early(identities, params, aux);
+    }
+#endif
+    SMEDLCallback cb_func = CALLBACKS(mon)->callback_alarm_sold_early;
+    if (cb_func != NULL) {
+        SMEDLValue identities[1];
+        get_Auctionmonitor_id_values(mon, identities);
+        return cb_func(identities, params, aux);
     }
     return 1;
 }
@@ -473,8 +771,18 @@ int queue_Auctionmonitor_alarm_not_sold(AuctionmonitorMonitor *mon, SMEDLValue *
 }
 
 int export_Auctionmonitor_alarm_not_sold(AuctionmonitorMonitor *mon, SMEDLValue *params, void *aux) {
-    if (mon->callback_alarm_not_sold != NULL) {
-        return (mon->callback_alarm_not_sold)(mon->identities, params, aux);
+#ifdef SMEDL_UNITY
+    if (mon->callbacks == NULL) {
+        SMEDLValue identities[1];
+        get_Auctionmonitor_id_values(mon, identities);
+        return raise_Auctionmonitor_alarm_not_sold(identities, params, aux);
+    }
+#endif
+    SMEDLCallback cb_func = CALLBACKS(mon)->callback_alarm_not_sold;
+    if (cb_func != NULL) {
+        SMEDLValue identities[1];
+        get_Auctionmonitor_id_values(mon, identities);
+        return cb_func(identities, params, aux);
     }
     return 1;
 }
@@ -497,8 +805,18 @@ int queue_Auctionmonitor_alarm_action_after_end(AuctionmonitorMonitor *mon, SMED
 }
 
 int export_Auctionmonitor_alarm_action_after_end(AuctionmonitorMonitor *mon, SMEDLValue *params, void *aux) {
-    if (mon->callback_alarm_action_after_end != NULL) {
-        return (mon->callback_alarm_action_after_end)(mon->identities, params, aux);
+#ifdef SMEDL_UNITY
+    if (mon->callbacks == NULL) {
+        SMEDLValue identities[1];
+        get_Auctionmonitor_id_values(mon, identities);
+        return raise_Auctionmonitor_alarm_action_after_end(identities, params, aux);
+    }
+#endif
+    SMEDLCallback cb_func = CALLBACKS(mon)->callback_alarm_action_after_end;
+    if (cb_func != NULL) {
+        SMEDLValue identities[1];
+        get_Auctionmonitor_id_values(mon, identities);
+        return cb_func(identities, params, aux);
     }
     return 1;
 }
@@ -521,19 +839,148 @@ int queue_Auctionmonitor_alarm_action_before_start(AuctionmonitorMonitor *mon, S
 }
 
 int export_Auctionmonitor_alarm_action_before_start(AuctionmonitorMonitor *mon, SMEDLValue *params, void *aux) {
-    if (mon->callback_alarm_action_before_start != NULL) {
-        return (mon->callback_alarm_action_before_start)(mon->identities, params, aux);
+#ifdef SMEDL_UNITY
+    if (mon->callbacks == NULL) {
+        SMEDLValue identities[1];
+        get_Auctionmonitor_id_values(mon, identities);
+        return raise_Auctionmonitor_alarm_action_before_start(identities, params, aux);
+    }
+#endif
+    SMEDLCallback cb_func = CALLBACKS(mon)->callback_alarm_action_before_start;
+    if (cb_func != NULL) {
+        SMEDLValue identities[1];
+        get_Auctionmonitor_id_values(mon, identities);
+        return cb_func(identities, params, aux);
     }
     return 1;
 }
 
+/* Batch event handling functions */
+
+int batch_Auctionmonitor_end_of_day(SMEDLValue *params, void *aux) {
+#if DEBUG >= 4
+    fprintf(stderr, "Monitor 'Auctionmonitor' handling imported event 'end_of_day' for %zu monitors\n", store.count);
+#endif
+    size_t i = 0;
+
+#ifdef __AVX2__
+    /* Four monitors per iteration. Lanes in bidding or above_reserve either
+     * take the guarded days_passed++ or move to done, which is written back
+     * with a blend. Lanes in any other state are left unchanged (done ->
+     * end_of_day() -> done is a self-loop with no action). */
+    const __m128i bidding = _mm_set1_epi32(STATE_Auctionmonitor_main_bidding);
+    const __m128i above_reserve = _mm_set1_epi32(STATE_Auctionmonitor_main_above_reserve);
+    const __m128i done = _mm_set1_epi32(STATE_Auctionmonitor_main_done);
+    const __m256i narrow = _mm256_setr_epi32(0, 2, 4, 6, 0, 0, 0, 0);
+    const __m256d one = _mm256_set1_pd(1);
+    for (; i + 4 <= store.count; i += 4) {
+        __m128i state = _mm_loadu_si128((__m128i *) &store.main_state[i]);
+        __m256d days_passed = _mm256_loadu_pd(&store.days_passed[i]);
+        __m256d duration = _mm256_loadu_pd(&store.duration[i]);
+
+        /* Lanes with a transition for this event (32-bit and 64-bit masks) */
+        __m128i active = _mm_or_si128(_mm_cmpeq_epi32(state, bidding),
+                _mm_cmpeq_epi32(state, above_reserve));
+        __m256d active_pd = _mm256_castsi256_pd(_mm256_cvtepi32_epi64(active));
+
+        /* Guard: days_passed < duration - 1 (64-bit and 32-bit masks) */
+        __m256d guard_pd = _mm256_cmp_pd(days_passed,
+                _mm256_sub_pd(duration, one), _CMP_LT_OQ);
+        __m128i guard = _mm256_castsi256_si128(_mm256_permutevar8x32_epi32(
+                    _mm256_castpd_si256(guard_pd), narrow));
+
+        /* Action: days_passed++ */
+        days_passed = _mm256_blendv_pd(days_passed,
+                _mm256_add_pd(days_passed, one),
+                _mm256_and_pd(active_pd, guard_pd));
+        _mm256_storeu_pd(&store.days_passed[i], days_passed);
+
+        /* Else: -> done */
+        state = _mm_blendv_epi8(state, done, _mm_andnot_si128(guard, active));
+        _mm_storeu_si128((__m128i *) &store.main_state[i], state);
+    }
+#endif
+
+    /* Remaining monitors one at a time */
+    for (; i < store.count; i++) {
+        switch (store.main_state[i]) {
+            case STATE_Auctionmonitor_main_bidding:
+            case STATE_Auctionmonitor_main_above_reserve:
+                if (store.days_passed[i] < store.duration[i] - 1) {
+                    store.days_passed[i]++;
+                } else {
+                    store.main_state[i] = STATE_Auctionmonitor_main_done;
+                }
+                break;
+        }
+    }
+
+    return 1;
+}
+
 /* Monitor management functions */
 
+/* Claim a slot in the columnar store for the monitor, growing the store if
+ * necessary. Return nonzero on success, zero on malloc failure. */
+static int alloc_Auctionmonitor_slot(AuctionmonitorMonitor *mon) {
+    if (store.count == store.capacity) {
+        size_t capacity = store.capacity == 0 ? 16 : store.capacity * 2;
+        void *tmp;
+        if ((tmp = SMEDL_REALLOC(&Auctionmonitor_memory, SMEDL_MEM_STORE, store.mon, sizeof(*store.mon) * capacity)) == NULL) {
+            return 0;
+        }
+        store.mon = tmp;
+        if ((tmp = SMEDL_REALLOC(&Auctionmonitor_memory, SMEDL_MEM_STORE, store.main_state, sizeof(*store.main_state) * capacity)) == NULL) {
+            return 0;
+        }
+        store.main_state = tmp;
+        if ((tmp = SMEDL_REALLOC(&Auctionmonitor_memory, SMEDL_MEM_STORE, store.reserve_price, sizeof(*store.reserve_price) * capacity)) == NULL) {
+            return 0;
+        }
+        store.reserve_price = tmp;
+        if ((tmp = SMEDL_REALLOC(&Auctionmonitor_memory, SMEDL_MEM_STORE, store.current_price, sizeof(*store.current_price) * capacity)) == NULL) {
+            return 0;
+        }
+        store.current_price = tmp;
+        if ((tmp = SMEDL_REALLOC(&Auctionmonitor_memory, SMEDL_MEM_STORE, store.duration, sizeof(*store.duration) * capacity)) == NULL) {
+            return 0;
+        }
+        store.duration = tmp;
+        if ((tmp = SMEDL_REALLOC(&Auctionmonitor_memory, SMEDL_MEM_STORE, store.days_passed, sizeof(*store.days_passed) * capacity)) == NULL) {
+            return 0;
+        }
+        store.days_passed = tmp;
+        store.capacity = capacity;
+    }
+
+    mon->slot = store.count;
+    store.mon[mon->slot] = mon;
+    store.count++;
+    return 1;
+}
+
+/* Release the monitor's slot in the columnar store by moving the monitor in
+ * the last slot into it */
+static void release_Auctionmonitor_slot(AuctionmonitorMonitor *mon) {
+    size_t last = store.count - 1;
+    if (mon->slot != last) {
+        store.mon[mon->slot] = store.mon[last];
+        store.mon[mon->slot]->slot = mon->slot;
+        store.main_state[mon->slot] = store.main_state[last];
+        store.reserve_price[mon->slot] = store.reserve_price[last];
+        store.current_price[mon->slot] = store.current_price[last];
+        store.duration[mon->slot] = store.duration[last];
+        store.days_passed[mon->slot] = store.days_passed[last];
+    }
+    store.count--;
+}
+
+
 /* Initialize a Auctionmonitor monitor with default state.
  * Return a pointer to the monitor. Must be freed with
  * free_Auctionmonitor_monitor() when no longer needed.
  * Returns NULL on malloc failure. */
-AuctionmonitorMonitor * init_Auctionmonitor_monitor(SMEDLValue *identities) {
+AuctionmonitorMonitor * init_Auctionmonitor_monitor(AuctionmonitorIdentities *identities) {
     AuctionmonitorState init_state;
 
     /* Initialize the monitor with default state */
@@ -572,31 +1019,34 @@ int default_Auctionmonitor_state(AuctionmonitorState *state) {
  * Return a pointer to the monitor. Must be freed with
  * free_Auctionmonitor_monitor() when no longer needed.
  * Returns NULL on malloc failure. */
-AuctionmonitorMonitor * init_Auctionmonitor_with_state(SMEDLValue *identities, AuctionmonitorState *init_state) {
-    AuctionmonitorMonitor *mon = malloc(sizeof(AuctionmonitorMonitor));
+AuctionmonitorMonitor * init_Auctionmonitor_with_state(AuctionmonitorIdentities *identities, AuctionmonitorState *init_state) {
+    AuctionmonitorMonitor *mon = SMEDL_ALLOC_OBJECT(&Auctionmonitor_memory, SMEDL_MEM_MONITOR,
+            sizeof(AuctionmonitorMonitor));
     if (mon == NULL) {
         return NULL;
     }
+    if (!alloc_Auctionmonitor_slot(mon)) {
+        SMEDL_FREE_OBJECT(&Auctionmonitor_memory, SMEDL_MEM_MONITOR, mon);
+        return NULL;
+    }
 
     /* Store the assigned identities */
-    mon->identities = identities;
+    mon->identities = *identities;
 
     /* Copy initial state vars in */
-    mon->s = *init_state;
+    STATE_VAR(mon, reserve_price) = init_state->reserve_price;
+    STATE_VAR(mon, current_price) = init_state->current_price;
+    STATE_VAR(mon, duration) = init_state->duration;
+    STATE_VAR(mon, days_passed) = init_state->days_passed;
 
     /* Set all scenarios to their initial state */
-    mon->main_state = 0;
+    MAIN_STATE(mon) = 0;
 
     /* Reset all scenario execution flags */
     memset(&mon->ef, 0, sizeof(mon->ef));
 
-    /* Set all export callbacks to NULL */
-    mon->callback_alarm_recreation = NULL;
-    mon->callback_alarm_low_bid = NULL;
-    mon->callback_alarm_sold_early = NULL;
-    mon->callback_alarm_not_sold = NULL;
-    mon->callback_alarm_action_after_end = NULL;
-    mon->callback_alarm_action_before_start = NULL;
+    /* Use the shared callback table */
+    mon->callbacks = NULL;
 
     /* Initialize event queue */
     mon->event_queue = (EventQueue){0};
@@ -606,5 +1056,102 @@ AuctionmonitorMonitor * init_Auctionmonitor_with_state(SMEDLValue *identities, A
 
 /* Free a Auctionmonitor monitor */
 void free_Auctionmonitor_monitor(AuctionmonitorMonitor *mon) {
-    free(mon);
+    release_Auctionmonitor_slot(mon);
+    SMEDL_FREE(&Auctionmonitor_memory, SMEDL_MEM_CALLBACKS, mon->callbacks);
+    SMEDL_FREE_OBJECT(&Auctionmonitor_memory, SMEDL_MEM_MONITOR, mon);
+}
+
+/* Free the columnar store. Call only after all Auctionmonitor monitors have
+ * been freed. */
+void free_Auctionmonitor_store() {
+    SMEDL_FREE(&Auctionmonitor_memory, SMEDL_MEM_STORE, store.mon);
+    SMEDL_FREE(&Auctionmonitor_memory, SMEDL_MEM_STORE, store.main_state);
+    SMEDL_FREE(&Auctionmonitor_memory, SMEDL_MEM_STORE, store.reserve_price);
+    SMEDL_FREE(&Auctionmonitor_memory, SMEDL_MEM_STORE, store.current_price);
+    SMEDL_FREE(&Auctionmonitor_memory, SMEDL_MEM_STORE, store.duration);
+    SMEDL_FREE(&Auctionmonitor_memory, SMEDL_MEM_STORE, store.days_passed);
+    store = (AuctionmonitorStore){0};
+}
+
+/* Append the monitor's scenario states and state variables to its snapshot
+ * record */
+void snapshot_Auctionmonitor_monitor(AuctionmonitorMonitor *mon, SMEDLSnapshotWriter *w) {
+    smedl_snapshot_put_state(w, MAIN_STATE(mon));
+    smedl_snapshot_put_float(w, STATE_VAR(mon, reserve_price));
+    smedl_snapshot_put_float(w, STATE_VAR(mon, current_price));
+    smedl_snapshot_put_float(w, STATE_VAR(mon, duration));
+    smedl_snapshot_put_float(w, STATE_VAR(mon, days_passed));
+}
+
+/* Get the monitor's scenario states and state variables back from its
+ * snapshot record */
+void restore_Auctionmonitor_monitor(AuctionmonitorMonitor *mon, SMEDLSnapshot *snap) {
+    MAIN_STATE(mon) = smedl_snapshot_get_state(snap);
+    STATE_VAR(mon, reserve_price) = smedl_snapshot_get_float(snap);
+    STATE_VAR(mon, current_price) = smedl_snapshot_get_float(snap);
+    STATE_VAR(mon, duration) = smedl_snapshot_get_float(snap);
+    STATE_VAR(mon, days_passed) = smedl_snapshot_get_float(snap);
+}
+
+/* Spill functions */
+
+/* Copy the monitor's scenario states and state variables out of the columnar
+ * store */
+void spill_Auctionmonitor_monitor(AuctionmonitorMonitor *mon, AuctionmonitorSpilled *spilled) {
+    spilled->main_state = MAIN_STATE(mon);
+    spilled->state.reserve_price = STATE_VAR(mon, reserve_price);
+    spilled->state.current_price = STATE_VAR(mon, current_price);
+    spilled->state.duration = STATE_VAR(mon, duration);
+    spilled->state.days_passed = STATE_VAR(mon, days_passed);
+}
+
+/* Initialize a monitor with the spilled scenario states and state variables.
+ * Return NULL on malloc failure. */
+AuctionmonitorMonitor * unspill_Auctionmonitor_monitor(AuctionmonitorIdentities *identities, AuctionmonitorSpilled *spilled) {
+    AuctionmonitorMonitor *mon = init_Auctionmonitor_with_state(identities, &spilled->state);
+    if (mon != NULL) {
+        MAIN_STATE(mon) = spilled->main_state;
+    }
+    return mon;
+}
+
+/* Apply 'end_of_day' to a spilled monitor count times. Each one either takes
+ * the guarded days_passed++ or moves to done, where 'end_of_day' changes
+ * nothing, so this stops as soon as it has no transition left to take. */
+void replay_Auctionmonitor_end_of_day(AuctionmonitorSpilled *spilled, uint64_t count) {
+    for (; count > 0; count--) {
+        switch (spilled->main_state) {
+            case STATE_Auctionmonitor_main_bidding:
+            case STATE_Auctionmonitor_main_above_reserve:
+                if (spilled->state.days_passed < spilled->state.duration - 1) {
+                    spilled->state.days_passed++;
+                } else {
+                    spilled->main_state = STATE_Auctionmonitor_main_done;
+                }
+                break;
+            default:
+                return;
+        }
+    }
+}
+
+/* Append a spilled monitor's scenario states and state variables to its
+ * snapshot record, as snapshot_Auctionmonitor_monitor() does for a monitor in
+ * memory */
+void snapshot_Auctionmonitor_spilled(const AuctionmonitorSpilled *spilled, SMEDLSnapshotWriter *w) {
+    smedl_snapshot_put_state(w, spilled->main_state);
+    smedl_snapshot_put_float(w, spilled->state.reserve_price);
+    smedl_snapshot_put_float(w, spilled->state.current_price);
+    smedl_snapshot_put_float(w, spilled->state.duration);
+    smedl_snapshot_put_float(w, spilled->state.days_passed);
+}
+
+/* Get a monitor's scenario states and state variables back from its snapshot
+ * record to be spilled */
+void restore_Auctionmonitor_spilled(AuctionmonitorSpilled *spilled, SMEDLSnapshot *snap) {
+    spilled->main_state = smedl_snapshot_get_state(snap);
+    spilled->state.reserve_price = smedl_snapshot_get_float(snap);
+    spilled->state.current_price = smedl_snapshot_get_float(snap);
+    spilled->state.duration = smedl_snapshot_get_float(snap);
+    spilled->state.days_passed = smedl_snapshot_get_float(snap);
 }
@@ -1,8 +1,15 @@
 #ifndef Auctionmonitor_MON_H
 #define Auctionmonitor_MON_H
 
+#include <stddef.h>
+#include <stdint.h>
 #include "smedl_types.h"
 #include "event_queue.h"
+#include "memstats.h"
+#include "snapshot.h"
+
+/* Memory counted for Auctionmonitor monitors (see memstats.h) */
+extern SMEDLMemAccount Auctionmonitor_memory;
 
 /* Internal/exported event enum for action queues */
 typedef enum {
@@ -33,14 +40,38 @@ typedef struct AuctionmonitorState {
     double days_passed;
 } AuctionmonitorState;
 
+/* Identities of a Auctionmonitor monitor.
+ * Stored inline in the AuctionmonitorMonitor struct. They are only converted to
+ * an array of SMEDLValue at the import and export interfaces. */
+typedef struct AuctionmonitorIdentities {
+    int id0;
+} AuctionmonitorIdentities;
+
+/* Callback table for Auctionmonitor monitors.
+ * Holds the exported event callbacks and the cleanup callback. One table is
+ * shared by all Auctionmonitor monitors; a monitor only gets its own copy once one of
+ * its callbacks is registered individually. */
+struct AuctionmonitorMonitor;
+typedef struct AuctionmonitorCallbacks {
+    SMEDLCallback callback_alarm_recreation;
+    SMEDLCallback callback_alarm_low_bid;
+    SMEDLCallback callback_alarm_sold_early;
+    SMEDLCallback callback_alarm_not_sold;
+    SMEDLCallback callback_alarm_action_after_end;
+    SMEDLCallback callback_alarm_action_before_start;
+    int (*cleanup)(struct AuctionmonitorMonitor *mon);
+} AuctionmonitorCallbacks;
+
 /* Auctionmonitor monitor struct.
- * Maintains all of the internal state for the monitor. */
+ * Maintains all of the internal state for the monitor, except for the
+ * scenario states and state variables, which live in the columnar store. */
 typedef struct AuctionmonitorMonitor {
-    /* Array of monitor's identities */
-    SMEDLValue *identities;
+    /* Monitor's identities */
+    AuctionmonitorIdentities identities;
 
-    /* Scenario states */
-    Auctionmonitor_main_State main_state;
+    /* Index of this monitor's scenario states and state variables in the
+     * columnar store */
+    size_t slot;
 
     /* Scenario execution flags (ensures each scenario only processes one event
      * per macro-step) */
@@ -48,40 +79,65 @@ typedef struct AuctionmonitorMonitor {
         unsigned int main_flag : 1;
     } ef;
 
-    /* State variables */
-    AuctionmonitorState s;
-
-    /* Exported event callback pointers */
-    SMEDLCallback callback_alarm_recreation;
-    SMEDLCallback callback_alarm_low_bid;
-    SMEDLCallback callback_alarm_sold_early;
-    SMEDLCallback callback_alarm_not_sold;
-    SMEDLCallback callback_alarm_action_after_end;
-    SMEDLCallback callback_alarm_action_before_start;
-
-    /* Cleanup callback pointer */
-    int (*cleanup)(struct AuctionmonitorMonitor *mon);
+    /* Callback table, or NULL to use the table shared by all Auctionmonitor
+     * monitors */
+    AuctionmonitorCallbacks *callbacks;
 
     /* Local event queue */
     EventQueue event_queue;
 
+#ifdef SMEDL_SPILL_BUDGET
+    /* Neighbors on the local wrapper's list of monitors in memory, from the
+     * most to the least recently used */
+    struct AuctionmonitorMonitor *lru_prev;
+    struct AuctionmonitorMonitor *lru_next;
+#endif
+
     //TODO mutex?
 } AuctionmonitorMonitor;
 
+/* Columnar store for Auctionmonitor.
+ * Scenario states and state variables of all Auctionmonitor monitors are kept
+ * in dense arrays, one per scenario and per state variable, indexed by each
+ * monitor's slot. This lets batch event handlers apply one event to every
+ * monitor with vector instructions. Slots are kept contiguous: when a monitor
+ * is freed, the monitor in the last slot moves into its place. */
+typedef struct AuctionmonitorStore {
+    size_t count;       /* Number of slots in use */
+    size_t capacity;    /* Number of slots allocated */
+    AuctionmonitorMonitor **mon;    /* Monitor occupying each slot */
+    /* Scenario states. 32 bits wide, so four states line up with four double
+     * state variables in a vector */
+    int32_t *main_state;
+    /* State variables */
+    double *reserve_price;
+    double *current_price;
+    double *duration;
+    double *days_passed;
+} AuctionmonitorStore;
+
+/* Shared callback registration function - Set the callback table used by all
+ * Auctionmonitor monitors that have not registered callbacks of their own. The
+ * table is copied. */
+void registershared_Auctionmonitor(const AuctionmonitorCallbacks *callbacks);
+
 /* Callback registration functions - Set the export callback for an exported
- * event. Set to NULL to unregister a callback. */
-void register_Auctionmonitor_alarm_recreation(AuctionmonitorMonitor *mon, SMEDLCallback cb_func);
-void register_Auctionmonitor_alarm_low_bid(AuctionmonitorMonitor *mon, SMEDLCallback cb_func);
-void register_Auctionmonitor_alarm_sold_early(AuctionmonitorMonitor *mon, SMEDLCallback cb_func);
-void register_Auctionmonitor_alarm_not_sold(AuctionmonitorMonitor *mon, SMEDLCallback cb_func);
-void register_Auctionmonitor_alarm_action_after_end(AuctionmonitorMonitor *mon, SMEDLCallback cb_func);
-void register_Auctionmonitor_alarm_action_before_start(AuctionmonitorMonitor *mon, SMEDLCallback cb_func);
+ * event on a single monitor. Set to NULL to unregister a callback. Return
+ * nonzero on success, zero on malloc failure. */
+int register_Auctionmonitor_alarm_recreation(AuctionmonitorMonitor *mon, SMEDLCallback cb_func);
+int register_Auctionmonitor_alarm_low_bid(AuctionmonitorMonitor *mon, SMEDLCallback cb_func);
+int register_Auctionmonitor_alarm_sold_early(AuctionmonitorMonitor *mon, SMEDLCallback cb_func);
+int register_Auctionmonitor_alarm_not_sold(AuctionmonitorMonitor *mon, SMEDLCallback cb_func);
+int register_Auctionmonitor_alarm_action_after_end(AuctionmonitorMonitor *mon, SMEDLCallback cb_func);
+int register_Auctionmonitor_alarm_action_before_start(AuctionmonitorMonitor *mon, SMEDLCallback cb_func);
 
 /* Cleanup callback registration function - Set the callback for when the
  * monitor is ready to be recycled. The callback is responsible for calling
  * free_Auctionmonitor_monitor(). It must accept the monitor pointer as a
- * parameter and return nonzero on success, zero on failure. */
-void registercleanup_Auctionmonitor(AuctionmonitorMonitor *mon, int (*cleanup_func)(AuctionmonitorMonitor *mon));
+ * parameter and return nonzero on success, zero on failure.
+ * Like the callback registration functions, this affects a single monitor and
+ * returns nonzero on success, zero on malloc failure. */
+int registercleanup_Auctionmonitor(AuctionmonitorMonitor *mon, int (*cleanup_func)(AuctionmonitorMonitor *mon));
 
 /* Event handling functions:
  *
@@ -123,13 +179,20 @@ int execute_Auctionmonitor_alarm_action_before_start(AuctionmonitorMonitor *mon,
 int queue_Auctionmonitor_alarm_action_before_start(AuctionmonitorMonitor *mon, SMEDLValue *params, void *aux);
 int export_Auctionmonitor_alarm_action_before_start(AuctionmonitorMonitor *mon, SMEDLValue *params, void *aux);
 
+/* Batch event handling functions - Process an imported event through the
+ * scenarios of every Auctionmonitor monitor at once, working directly on the
+ * columnar store. These exist only for imported events whose transitions
+ * raise no events, so there are no macro-step queues to handle afterward.
+ * Return nonzero on success, zero on failure. */
+int batch_Auctionmonitor_end_of_day(SMEDLValue *params, void *aux);
+
 /* Monitor management functions */
 
 /* Initialize a Auctionmonitor monitor with default state.
  * Return a pointer to the monitor. Must be freed with
  * free_Auctionmonitor_monitor() when no longer needed.
  * Returns NULL on malloc failure. */
-AuctionmonitorMonitor * init_Auctionmonitor_monitor(SMEDLValue *identities);
+AuctionmonitorMonitor * init_Auctionmonitor_monitor(AuctionmonitorIdentities *identities);
 
 /* Fill the provided AuctionmonitorState
  * with the default initial values for the monitor. Note that strings and
@@ -149,10 +212,45 @@ int default_Auctionmonitor_state(AuctionmonitorState *state);
  * Return a pointer to the monitor. Must be freed with
  * free_Auctionmonitor_monitor() when no longer needed.
  * Returns NULL on malloc failure. */
-AuctionmonitorMonitor * init_Auctionmonitor_with_state(SMEDLValue *identities, AuctionmonitorState *init_state);
+AuctionmonitorMonitor * init_Auctionmonitor_with_state(AuctionmonitorIdentities *identities, AuctionmonitorState *init_state);
 
-/* Free a Auctionmonitor monitor. NOTE: Does not free the identities. That must
- * be done by the caller, if necessary. */
+/* Free a Auctionmonitor monitor */
 void free_Auctionmonitor_monitor(AuctionmonitorMonitor *mon);
 
+/* Free the columnar store. Call only after all Auctionmonitor monitors have
+ * been freed. */
+void free_Auctionmonitor_store();
+
+/* Snapshot functions (see snapshot.h) - snapshot_Auctionmonitor_monitor() appends
+ * the monitor's scenario states and state variables to its record,
+ * Auctionmonitor_SNAPSHOT_SIZE bytes. restore_Auctionmonitor_monitor() gets them back into a
+ * monitor initialized with the same identities. */
+#define Auctionmonitor_SNAPSHOT_SIZE (SMEDL_SNAPSHOT_STATE + 4 * SMEDL_SNAPSHOT_FLOAT)
+void snapshot_Auctionmonitor_monitor(AuctionmonitorMonitor *mon, SMEDLSnapshotWriter *w);
+void restore_Auctionmonitor_monitor(AuctionmonitorMonitor *mon, SMEDLSnapshot *snap);
+
+/* Spilled Auctionmonitor monitor (see spill.h) - The scenario states and state
+ * variables of a monitor kept in the spill table rather than in memory */
+typedef struct AuctionmonitorSpilled {
+    /* 'end_of_day' broadcasts handled before the monitor was spilled. Set by
+     * the local wrapper, which counts them. */
+    uint64_t end_of_day_epoch;
+    AuctionmonitorState state;
+    int32_t main_state;
+} AuctionmonitorSpilled;
+
+/* Spill functions - spill_Auctionmonitor_monitor() copies the monitor's scenario
+ * states and state variables out of the columnar store before the monitor is
+ * freed. unspill_Auctionmonitor_monitor() initializes a monitor from them again,
+ * returning NULL on malloc failure. replay_Auctionmonitor_end_of_day() applies
+ * 'end_of_day' to a spilled monitor count times, as the batch handler would
+ * have had the monitor been in memory. snapshot_Auctionmonitor_spilled() and
+ * restore_Auctionmonitor_spilled() are snapshot_Auctionmonitor_monitor() and
+ * restore_Auctionmonitor_monitor() for a spilled monitor. */
+void spill_Auctionmonitor_monitor(AuctionmonitorMonitor *mon, AuctionmonitorSpilled *spilled);
+AuctionmonitorMonitor * unspill_Auctionmonitor_monitor(AuctionmonitorIdentities *identities, AuctionmonitorSpilled *spilled);
+void replay_Auctionmonitor_end_of_day(AuctionmonitorSpilled *spilled, uint64_t count);
+void snapshot_Auctionmonitor_spilled(const AuctionmonitorSpilled *spilled, SMEDLSnapshotWriter *w);
+void restore_Auctionmonitor_spilled(AuctionmonitorSpilled *spilled, SMEDLSnapshot *snap);
+
 #endif /* Auctionmonitor_MON_H */
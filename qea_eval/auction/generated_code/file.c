@@ -1,7 +1,10 @@
+#define _GNU_SOURCE
 #include <stdlib.h>
 #include <stdio.h>
 #include <stdarg.h>
 #include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
 /* Includes jsmn.h with proper #defines */
 #include "json.h"
 #include "file.h"
@@ -18,15 +21,23 @@ void err(const char *fmt, ...) {
 /* Initialize a parser reading from the named file. Returns nonzero if
  * successful, zero on failure. Cleanup with free_parser(). */
 int init_parser(JSONParser *parser, const char *fname) {
+    return init_parser_at(parser, fname, 0, 0);
+}
+
+/* Initialize a parser like init_parser(), but start offset bytes into the
+ * input, counting msg_count messages as already parsed */
+int init_parser_at(JSONParser *parser, const char *fname,
+        unsigned long long offset, size_t msg_count) {
     /* Open the file or use stdin */
+    int fd;
     if (fname != NULL) {
-        parser->f = fopen(fname, "r");
-        if (parser->f == NULL) {
+        fd = open(fname, O_RDONLY | O_CLOEXEC);
+        if (fd < 0) {
             err("Could not open %s for reading", fname);
             return 0;
         }
     } else {
-        parser->f = stdin;
+        fd = STDIN_FILENO;
     }
 
     /* Initial token allocation */
@@ -34,30 +45,111 @@ int init_parser(JSONParser *parser, const char *fname) {
     parser->tokens = malloc(sizeof(jsmntok_t) * parser->tokens_size);
     if (parser->tokens == NULL) {
         err("Out of memory");
-        fclose(parser->f);
+        close(fd);
         return 0;
     }
 
-    /* Initial buffer allocation */
-    parser->buf_size = 128;
-    parser->buf_wpos = 0;
-    parser->buf_rpos = 0;
+    /* Initial buffer allocation for messages that span buffers */
+    parser->buf_size = 4096;
+    parser->buf_len = 0;
     parser->buf = malloc(parser->buf_size);
     if (parser->buf == NULL) {
         err("Out of memory");
         free(parser->tokens);
-        fclose(parser->f);
+        close(fd);
         return 0;
     }
 
+    /* Start reading ahead */
+    if (!smedl_reader_open_at(&parser->reader, fd, offset)) {
+        if (parser->reader.unsupported) {
+            err("Input is %s-compressed, but support for it was not "
+                    "compiled in", parser->reader.format == SMEDL_TRACE_GZIP ?
+                    "gzip" : "zstd");
+        } else {
+            err("Could not start reading input");
+        }
+        free(parser->buf);
+        free(parser->tokens);
+        return 0;
+    }
+    parser->chunk = NULL;
+    parser->chunk_len = 0;
+    parser->chunk_pos = 0;
+    parser->chunk_offset = offset;
+    parser->msg_offset = offset;
+
     /* Initialize the jsmn parser */
     jsmn_init(&parser->parser);
-    parser->msg_count = 0;
+    parser->msg_count = msg_count;
     parser->status = JSONSTATUS_NORMAL;
 
     return 1;
 }
 
+/* Move on to the next buffer from the reader. Return nonzero on success, zero
+ * at the end of the input or on a read error (with parser->status set). */
+static int next_chunk(JSONParser *parser) {
+    parser->chunk_offset += parser->chunk_len;
+    parser->chunk_len = smedl_reader_next(&parser->reader, &parser->chunk);
+    parser->chunk_pos = 0;
+    if (parser->chunk_len == 0) {
+        if (parser->reader.error) {
+            err("Read error on input file");
+            parser->status = JSONSTATUS_READERR;
+        } else {
+            parser->status = JSONSTATUS_EOF;
+        }
+        return 0;
+    }
+    return 1;
+}
+
+/* Continue parsing the message at the start of js, which now holds len bytes.
+ * Return the jsmn result, growing the token array as needed. */
+static int parse(JSONParser *parser, const char *js, size_t len) {
+    int result;
+    do {
+        result = jsmn_parse(&parser->parser, js, len, parser->tokens,
+                parser->tokens_size);
+        if (result == JSMN_ERROR_NOMEM) {
+            /* Need more tokens */
+            parser->tokens_size *= 2;
+            jsmntok_t *tmp = realloc(parser->tokens, sizeof(jsmntok_t) *
+                    parser->tokens_size);
+            if (tmp == NULL) {
+                err("Out of memory");
+                parser->status = JSONSTATUS_NOMEM;
+                return JSMN_ERROR_NOMEM;
+            }
+            parser->tokens = tmp;
+        }
+    } while (result == JSMN_ERROR_NOMEM);
+    return result;
+}
+
+/* Append len bytes to the copy of the message that spans buffers. Return
+ * nonzero on success, zero if out of memory. */
+static int append_buf(JSONParser *parser, const char *data, size_t len) {
+    if (len > parser->buf_size - parser->buf_len) {
+        size_t new_size = parser->buf_size;
+        while (len > new_size - parser->buf_len) {
+            new_size *= 2;
+        }
+        char *tmp = realloc(parser->buf, new_size);
+        if (tmp == NULL) {
+            err("Out of memory");
+            parser->status = JSONSTATUS_NOMEM;
+            return 0;
+        }
+        parser->buf = tmp;
+        parser->buf_size = new_size;
+    }
+    memcpy(parser->buf + parser->buf_len, data, len);
+    parser->buf_len += len;
+    return 1;
+}
+
 /* Fetch the next message. If successful, returns an array of jsmntok_t
  * containing the parsed message. If there is an error or no more tokens,
  * return NULL. The reason for a NULL return can be determined by checking
@@ -69,73 +161,61 @@ int init_parser(JSONParser *parser, const char *fname) {
 jsmntok_t * next_message(JSONParser *parser, char **str) {
     int result;
 
-    /* Shift the previous message out of the buffer */
-    memmove(parser->buf, parser->buf + parser->buf_rpos,
-            parser->buf_size - parser->buf_rpos);
-    parser->buf_wpos -= parser->buf_rpos;
-    parser->buf_rpos = 0;
-
-    /* Is there any more data? */
-    if (feof(parser->f) && parser->buf_wpos == 0) {
-        parser->status = JSONSTATUS_EOF;
+    if (parser->status != JSONSTATUS_NORMAL) {
         return NULL;
     }
+    if (parser->chunk_pos == parser->chunk_len && !next_chunk(parser)) {
+        return NULL;
+    }
+    parser->msg_offset = parser->chunk_offset + parser->chunk_pos;
 
-    do {
-        /* Try to fill the buffer */
-        parser->buf_wpos += fread(parser->buf + parser->buf_wpos, 1,
-                parser->buf_size - parser->buf_wpos, parser->f);
-        if (ferror(parser->f)) {
-            err("Read error on input file");
-            parser->status = JSONSTATUS_READERR;
+    /* Usually the whole message is in the current buffer and can be parsed in
+     * place. Token positions are relative to the start of the message. */
+    const char *start = parser->chunk + parser->chunk_pos;
+    result = parse(parser, start, parser->chunk_len - parser->chunk_pos);
+    if (result >= 0) {
+        parser->chunk_pos += parser->tokens[0].end;
+        *str = (char *) start;
+        parser->msg_count++;
+        return parser->tokens;
+    }
+
+    /* Otherwise it runs off the end of the buffer. Copy what there is and
+     * keep adding from the following buffers in growing steps, so that not
+     * much more than the message itself is copied. jsmn picks up where it
+     * left off each time. */
+    parser->buf_len = 0;
+    size_t step = 4096;
+    while (result == JSMN_ERROR_PART) {
+        if (parser->chunk_pos == parser->chunk_len && !next_chunk(parser)) {
+            /* The input ended in the middle of the message (or in whitespace
+             * after the last one) */
             return NULL;
         }
-
-        /* Attempt to parse */
-        do {
-            result = jsmn_parse(&parser->parser, parser->buf, parser->buf_wpos,
-                    parser->tokens, parser->tokens_size);
-            if (result == JSMN_ERROR_NOMEM) {
-                /* Need more tokens */
-                parser->tokens_size *= 2;
-                jsmntok_t *tmp = realloc(parser->tokens, sizeof(jsmntok_t) *
-                        parser->tokens_size);
-                if (tmp == NULL) {
-                    err("Out of memory");
-                    parser->status = JSONSTATUS_NOMEM;
-                    return NULL;
-                }
-                parser->tokens = tmp;
-            }
-        } while (result == JSMN_ERROR_NOMEM);
-
-        if (result == JSMN_ERROR_PART) {
-            /* Need more buffer */
-            parser->buf_size *= 2;
-            char *tmp = realloc(parser->buf, parser->buf_size);
-            if (tmp == NULL) {
-                err("Out of memory");
-                parser->status = JSONSTATUS_NOMEM;
-                return NULL;
-            }
-            parser->buf = tmp;
+        size_t n = parser->chunk_len - parser->chunk_pos;
+        if (parser->buf_len > 0 && n > step) {
+            n = step;
+        }
+        if (!append_buf(parser, parser->chunk + parser->chunk_pos, n)) {
+            return NULL;
         }
-    /* Continue until either 1) we have enough tokens and buffer or 2) EOF */
-    } while (result == JSMN_ERROR_PART && !feof(parser->f));
+        parser->chunk_pos += n;
+        result = parse(parser, parser->buf, parser->buf_len);
+        step *= 2;
+    }
 
-    if (result == JSMN_ERROR_PART) {
-        /* Reached end of file. Return. */
-        parser->status = JSONSTATUS_EOF;
-        return NULL;
-    } else if (result == JSMN_ERROR_INVAL) {
+    if (result == JSMN_ERROR_INVAL) {
         /* Invalid JSON. Give up. */
         err("JSON message #%d is invalid", parser->msg_count + 1);
         parser->status = JSONSTATUS_INVALID;
         return NULL;
+    } else if (result < 0) {
+        return NULL;
     }
 
-    /* Success */
-    parser->buf_rpos += parser->tokens[0].end;
+    /* Success. Whatever was copied past the end of the message belongs to
+     * the following messages, which are still in the current buffer. */
+    parser->chunk_pos -= parser->buf_len - parser->tokens[0].end;
     *str = parser->buf;
     parser->msg_count++;
     return parser->tokens;
@@ -146,13 +226,64 @@ jsmntok_t * next_message(JSONParser *parser, char **str) {
 int free_parser(JSONParser *parser) {
     free(parser->buf);
     free(parser->tokens);
-    if (fclose(parser->f) == EOF) {
+    if (!smedl_reader_close(&parser->reader)) {
         err("Could not close input file");
         return 0;
     }
     return 1;
 }
 
+/* Copy aux text into the batch. Returns the AuxData for it, or NULL if out of
+ * memory. The batch must not be full. The AuxData is not valid until
+ * seal_aux_batch() is called. */
+AuxData * add_aux(AuxBatch *batch, const char *data, size_t len) {
+    /* The buffer may move while the batch is filled, so only the offset is
+     * stored until the batch is sealed */
+    if (batch->buf_len + len > batch->buf_size) {
+        size_t new_size = batch->buf_size ? batch->buf_size : 4096;
+        while (batch->buf_len + len > new_size) {
+            new_size *= 2;
+        }
+        char *tmp = realloc(batch->buf, new_size);
+        if (tmp == NULL) {
+            return NULL;
+        }
+        batch->buf = tmp;
+        batch->buf_size = new_size;
+    }
+    memcpy(batch->buf + batch->buf_len, data, len);
+
+    AuxData *aux = &batch->aux[batch->count];
+    batch->offset[batch->count] = batch->buf_len;
+    aux->data = NULL;
+    aux->len = len;
+    batch->buf_len += len;
+    batch->count++;
+    return aux;
+}
+
+/* Make every AuxData in the batch valid. Call after the last add_aux() and
+ * before handling the events that use them. */
+void seal_aux_batch(AuxBatch *batch) {
+    for (size_t i = 0; i < batch->count; i++) {
+        batch->aux[i].data = batch->buf + batch->offset[i];
+    }
+}
+
+/* Empty the batch so it can be reused. The buffer is kept. */
+void reset_aux_batch(AuxBatch *batch) {
+    batch->count = 0;
+    batch->buf_len = 0;
+}
+
+/* Free the batch's buffer */
+void free_aux_batch(AuxBatch *batch) {
+    free(batch->buf);
+    batch->buf = NULL;
+    batch->buf_size = 0;
+    reset_aux_batch(batch);
+}
+
 /* Print a null-terminated string with characters escaped if JSON requires it */
 void print_escaped(const char *str) {
     fputc('\"', stdout);
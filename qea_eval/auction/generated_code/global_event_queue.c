@@ -1,6 +1,7 @@
 #include <stdlib.h>
 #include "smedl_types.h"
 #include "global_event_queue.h"
+#include "memstats.h"
 
 /* Add an event to the queue. Return 1 if successful, 0 if malloc fails.
  *
@@ -13,13 +14,15 @@
 int push_global_event(GlobalEventQueue *q, int channel, SMEDLValue *ids,
         SMEDLValue *params, void *aux) {
     /* Create the GlobalEvent */
-    GlobalEvent *ge = malloc(sizeof(GlobalEvent));
+    GlobalEvent *ge = SMEDL_MALLOC(&smedl_mem_shared, SMEDL_MEM_QUEUE,
+            sizeof(GlobalEvent));
     if (ge == NULL) {
         return 0;
     }
     ge->channel = channel;
     ge->ids = ids;
     ge->params = params;
+    ge->ev = NULL;
     ge->aux = aux;
     ge->next = NULL;
 
@@ -62,6 +65,45 @@ int pop_global_event(GlobalEventQueue *q, int *channel, SMEDLValue **ids,
     *params = ge->params;
     *aux = ge->aux;
 
-    free(ge);
+    SMEDL_FREE(&smedl_mem_shared, SMEDL_MEM_QUEUE, ge);
     return 1;
 }
+
+/* Add a reference-counted event to the queue. The queue takes over the caller's
+ * reference. Return 1 if successful, 0 if malloc fails (in which case the
+ * caller still owns its reference).
+ *
+ * Parameters:
+ * q - Pointer to the EventQueue to push to
+ * channel - Channel ID (from the global wrapper's channel enum)
+ * ev - The event
+ * aux - Aux data to pass through */
+int push_global_shared(GlobalEventQueue *q, int channel, SMEDLEvent *ev,
+        void *aux) {
+    if (!push_global_event(q, channel, ev->ids, ev->params, aux)) {
+        return 0;
+    }
+    q->tail->ev = ev;
+    return 1;
+}
+
+/* Remove a reference-counted event from the queue. The caller takes over the
+ * queue's reference to the event and must release it. Return 1 if successful,
+ * 0 if the queue is empty.
+ *
+ * Parameters:
+ * q - Pointer to the EventQueue to pop from
+ * channel - Pointer to store the channel ID at
+ * ev - Pointer at which to store the event
+ * aux - Pointer to an Aux pointer to store the aux data in */
+int pop_global_shared(GlobalEventQueue *q, int *channel, SMEDLEvent **ev,
+        void **aux) {
+    /* Check if queue is empty */
+    if (q->head == NULL) {
+        return 0;
+    }
+    *ev = q->head->ev;
+
+    SMEDLValue *ids, *params;
+    return pop_global_event(q, channel, &ids, &params, aux);
+}
@@ -0,0 +1,289 @@
+/* For clock_gettime() and sigaction() */
+#define _POSIX_C_SOURCE 200809L
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <time.h>
+#include "latency.h"
+
+/* Buckets in each histogram (see bucket_index()) */
+#define SUB_COUNT ((uint64_t) 1 << SMEDL_LATENCY_SUB_BITS)
+#define BUCKETS ((SMEDL_LATENCY_MAX_BITS - SMEDL_LATENCY_SUB_BITS + 1) * \
+        SUB_COUNT)
+#define MAX_VALUE (((uint64_t) 1 << SMEDL_LATENCY_MAX_BITS) - 1)
+
+/* Ticks are converted to ns by multiplying by a fixed-point rate with this
+ * many fraction bits. Larger tick counts are clamped so the product cannot
+ * overflow. */
+#define RATE_BITS 16
+#define MAX_TICKS ((uint64_t) 1 << 47)
+
+typedef struct {
+    uint64_t count;
+    uint64_t sum;
+    uint64_t max;
+    uint64_t buckets[BUCKETS];
+} Histogram;
+
+static const char *const stage_names[SMEDL_STAGES] = {
+    [SMEDL_STAGE_PARSE] = "parse",
+    [SMEDL_STAGE_ENQUEUE] = "enqueue",
+    [SMEDL_STAGE_HANDLE] = "handle",
+    [SMEDL_STAGE_WRITE] = "write",
+};
+
+/* Histograms indexed by channel + 1 (so SMEDL_CHANNEL_MIXED is 0) and stage.
+ * Each is allocated when its first time is recorded. NULL before
+ * smedl_latency_init(). */
+static Histogram *(*histograms)[SMEDL_STAGES];
+static const char *const *latency_channel_names;
+static size_t channel_count;
+
+/* ns per tick, in fixed point, and the reference point it was calibrated
+ * from */
+static uint64_t rate;
+static uint64_t calib_ticks;
+static struct timespec calib_time;
+static size_t polls;
+
+/* Stopwatch for the event being read */
+static uint64_t lap_start;
+static uint64_t lap_elapsed;
+
+/* Channel of the events enqueued since the last batch, SMEDL_CHANNEL_MIXED,
+ * or -2 if none */
+static int batch_channel = -2;
+
+/* Set by SIGUSR1 */
+static volatile sig_atomic_t dump_requested;
+
+#if !defined(__x86_64__) && !defined(__i386__)
+uint64_t smedl_ticks(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec * 1000000000ULL + now.tv_nsec;
+}
+#endif
+
+static uint64_t elapsed_ns(const struct timespec *start) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (now.tv_sec - start->tv_sec) * 1000000000LL +
+        (now.tv_nsec - start->tv_nsec);
+}
+
+/* Set the rate from the ticks and time since the reference point. The
+ * reference point stays at startup, so ns grows without bound; the rate is
+ * computed in double, where ns << RATE_BITS would overflow uint64_t after
+ * about 78 hours. */
+static void calibrate(void) {
+#if defined(__x86_64__) || defined(__i386__)
+    uint64_t ns = elapsed_ns(&calib_time);
+    uint64_t ticks = smedl_ticks() - calib_ticks;
+    if (ticks > 0) {
+        rate = (uint64_t) ((double) ns * ((uint64_t) 1 << RATE_BITS) / ticks);
+    }
+#endif
+}
+
+/* Bucket for a value. Values below 2 * SUB_COUNT have their own bucket. Above
+ * that, each power of two [2^e, 2^(e+1)) is split into SUB_COUNT buckets of
+ * width 2^(e - SUB_BITS). */
+static size_t bucket_index(uint64_t v) {
+    if (v > MAX_VALUE) {
+        v = MAX_VALUE;
+    }
+    if (v < 2 * SUB_COUNT) {
+        return v;
+    }
+    int shift = 63 - __builtin_clzll(v) - SMEDL_LATENCY_SUB_BITS;
+    return ((size_t) shift << SMEDL_LATENCY_SUB_BITS) + (v >> shift);
+}
+
+/* Highest value that falls in a bucket */
+static uint64_t bucket_high(size_t i) {
+    if (i < 2 * SUB_COUNT) {
+        return i;
+    }
+    int shift = (i >> SMEDL_LATENCY_SUB_BITS) - 1;
+    uint64_t sub = (i & (SUB_COUNT - 1)) + SUB_COUNT;
+    return ((sub + 1) << shift) - 1;
+}
+
+static void dump_at_exit(void) {
+    smedl_latency_dump(stderr);
+    for (size_t i = 0; i <= channel_count; i++) {
+        for (int s = 0; s < SMEDL_STAGES; s++) {
+            free(histograms[i][s]);
+        }
+    }
+    free(histograms);
+    histograms = NULL;
+}
+
+static void request_dump(int sig) {
+    (void) sig;
+    dump_requested = 1;
+}
+
+int smedl_latency_init(const char *const *channels, size_t count) {
+    histograms = calloc(count + 1, sizeof(*histograms));
+    if (histograms == NULL) {
+        return 0;
+    }
+    latency_channel_names = channels;
+    channel_count = count;
+
+    /* Get a first rate over a millisecond. It is refined as the reference
+     * point recedes. */
+    rate = (uint64_t) 1 << RATE_BITS;
+    clock_gettime(CLOCK_MONOTONIC, &calib_time);
+    calib_ticks = smedl_ticks();
+#if defined(__x86_64__) || defined(__i386__)
+    while (elapsed_ns(&calib_time) < 1000000) {
+    }
+    calibrate();
+#endif
+
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = request_dump;
+    sa.sa_flags = SA_RESTART;
+    sigemptyset(&sa.sa_mask);
+    if (sigaction(SIGUSR1, &sa, NULL) || atexit(dump_at_exit)) {
+        free(histograms);
+        histograms = NULL;
+        return 0;
+    }
+    return 1;
+}
+
+void smedl_latency_record(int channel, SMEDLStage stage, uint64_t ticks) {
+    if (histograms == NULL) {
+        return;
+    }
+    Histogram **h = &histograms[channel + 1][stage];
+    if (*h == NULL) {
+        *h = calloc(1, sizeof(**h));
+        if (*h == NULL) {
+            return;
+        }
+    }
+    if (ticks > MAX_TICKS) {
+        ticks = MAX_TICKS;
+    }
+    uint64_t ns = (ticks * rate) >> RATE_BITS;
+    (*h)->count++;
+    (*h)->sum += ns;
+    if (ns > (*h)->max) {
+        (*h)->max = ns;
+    }
+    (*h)->buckets[bucket_index(ns)]++;
+
+    if (stage == SMEDL_STAGE_ENQUEUE) {
+        if (batch_channel == -2) {
+            batch_channel = channel;
+        } else if (batch_channel != channel) {
+            batch_channel = SMEDL_CHANNEL_MIXED;
+        }
+    }
+}
+
+void smedl_latency_record_batch(uint64_t ticks) {
+    if (batch_channel != -2) {
+        smedl_latency_record(batch_channel, SMEDL_STAGE_HANDLE, ticks);
+        batch_channel = -2;
+    }
+}
+
+void smedl_latency_start(void) {
+    lap_elapsed = 0;
+    lap_start = smedl_ticks();
+}
+
+void smedl_latency_pause(void) {
+    lap_elapsed += smedl_ticks() - lap_start;
+}
+
+void smedl_latency_resume(void) {
+    lap_start = smedl_ticks();
+}
+
+void smedl_latency_lap(int channel, SMEDLStage stage) {
+    uint64_t now = smedl_ticks();
+    smedl_latency_record(channel, stage, lap_elapsed + now - lap_start);
+    lap_elapsed = 0;
+    lap_start = now;
+}
+
+void smedl_latency_poll(void) {
+    if (++polls % SMEDL_LATENCY_CALIBRATE_INTERVAL == 0) {
+        calibrate();
+    }
+    if (dump_requested) {
+        dump_requested = 0;
+        smedl_latency_dump(stderr);
+    }
+}
+
+/* Print a histogram as a JSON object */
+static void dump_histogram(FILE *f, const Histogram *h) {
+    static const struct {
+        const char *name;
+        double fraction;
+    } percentiles[] = {
+        {"p50", 0.5}, {"p90", 0.9}, {"p99", 0.99}, {"p99.9", 0.999},
+    };
+    size_t p = 0;
+    uint64_t seen = 0;
+
+    fprintf(f, "{\"count\": %llu, \"mean\": %.1f", (unsigned long long)
+            h->count, (double) h->sum / h->count);
+    for (size_t i = 0; i < BUCKETS &&
+            p < sizeof(percentiles) / sizeof(percentiles[0]); i++) {
+        seen += h->buckets[i];
+        /* Nearest rank: the smallest value with at least the fraction of the
+         * count at or below it */
+        while (p < sizeof(percentiles) / sizeof(percentiles[0]) &&
+                seen >= percentiles[p].fraction * h->count) {
+            uint64_t v = bucket_high(i);
+            fprintf(f, ", \"%s\": %llu", percentiles[p].name,
+                    (unsigned long long) (v < h->max ? v : h->max));
+            p++;
+        }
+    }
+    fprintf(f, ", \"max\": %llu}", (unsigned long long) h->max);
+}
+
+void smedl_latency_dump(FILE *f) {
+    if (histograms == NULL) {
+        return;
+    }
+    calibrate();
+    fprintf(f, "{\"latency\": {\"ns_per_tick\": %.6f, \"channels\": {",
+            (double) rate / ((uint64_t) 1 << RATE_BITS));
+    int first_channel = 1;
+    for (size_t i = 0; i <= channel_count; i++) {
+        int first_stage = 1;
+        for (int s = 0; s < SMEDL_STAGES; s++) {
+            if (histograms[i][s] == NULL) {
+                continue;
+            }
+            if (first_stage) {
+                fprintf(f, "%s\"%s\": {", first_channel ? "" : ", ",
+                        i == 0 ? "mixed" : latency_channel_names[i - 1]);
+                first_channel = 0;
+                first_stage = 0;
+            } else {
+                fprintf(f, ", ");
+            }
+            fprintf(f, "\"%s\": ", stage_names[s]);
+            dump_histogram(f, histograms[i][s]);
+        }
+        if (!first_stage) {
+            fprintf(f, "}");
+        }
+    }
+    fprintf(f, "}}}\n");
+    fflush(f);
+}
@@ -28,6 +28,7 @@
 
 #include <stdint.h>
 #include "smedl_types.h"
+#include "memstats.h"
 
 /*****************************************************************************
  * Murmur hash
@@ -93,22 +94,58 @@ typedef struct MonitorMap {
     size_t grow_at;     /* When count reaches this size, enlarge */
     size_t shrink_at;   /* When count falls to this size, shrink (min 16) */
     size_t mask;        /* Mask to convert hash->index */
-    size_t offset;      /* Offset of identities array in monitor */
-    uint64_t (*hash)(SMEDLValue *ids);
-    int (*equals)(SMEDLValue *ids1, SMEDLValue *ids2);
+    size_t offset;      /* Offset of identity tuple in monitor */
+    uint64_t (*hash)(const void *ids);
+    int (*equals)(const void *ids1, const void *ids2);
     MonitorList *table;
+    uint64_t grows;         /* Number of times the table was enlarged */
+    uint64_t shrinks;       /* Number of times the table was shrunk */
+    uint64_t resize_ns;     /* Total time spent resizing */
+    uint64_t max_resize_ns; /* Longest resize */
+    SMEDLMemAccount *account; /* Where the table and instances are counted
+                                 (see memstats.h). NULL for
+                                 smedl_mem_shared. */
 } MonitorMap;
 
+/* Health of a MonitorMap, filled in by monitormap_stats() */
+typedef struct MonitorMapStats {
+    size_t capacity;        /* Buckets in the table */
+    size_t lists;           /* MonitorLists stored (distinct identities) */
+    size_t instances;       /* MonitorInstances in all lists */
+    size_t max_list;        /* Length of the longest MonitorList */
+    unsigned int max_dib;   /* Largest dib (buckets probed to find a list,
+                               1 if it is in its initial bucket) */
+    double mean_dib;        /* Mean dib over the lists */
+    uint64_t grows;
+    uint64_t shrinks;
+    uint64_t resize_ns;
+    uint64_t max_resize_ns;
+} MonitorMapStats;
+
 /* Initialize a MonitorMap. Returns nonzero if successful, zero on failure.
+ * Set map->account first for the table and instances to be counted for a
+ * monitor type.
  *
  * Parameters:
  * map - Pointer to the MonitorMap to initialize
- * offset - Offset of identities array within the monitor struct
+ * offset - Offset of the identity tuple within the monitor struct. The
+ *   identity tuple is the monitor's own typed struct (e.g.
+ *   <monitor>Identities); the map only ever passes pointers to it to the hash
+ *   and equality functions.
  * hash - Pointer to the hash function to use
  * equals - Pointer to the equality function to use */
 int monitormap_init(MonitorMap *map, size_t offset,
-                    uint64_t(*hash)(SMEDLValue *ids),
-                    int (*equals)(SMEDLValue *ids1, SMEDLValue *ids2));
+                    uint64_t(*hash)(const void *ids),
+                    int (*equals)(const void *ids1, const void *ids2));
+
+/* Grow a MonitorMap so that count more MonitorLists can be inserted without
+ * resizing it, as when restoring a snapshot (see snapshot.h). Returns nonzero
+ * if successful, zero on failure.
+ *
+ * Parameters:
+ * map - The MonitorMap to grow
+ * count - Number of MonitorLists to make room for */
+int monitormap_reserve(MonitorMap *map, size_t count);
 
 /* Insert a monitor into a MonitorMap. Returns a pointer to the MonitorInstance
  * if successful, or NULL on failure.
@@ -128,8 +165,26 @@ MonitorInstance * monitormap_insert(MonitorMap *map, void *mon,
  *
  * Parameters:
  * map - Pointer to the MonitorMap to look up in
- * ids - Array of SMEDLValues containing the identities to look up */
-MonitorInstance * monitormap_lookup(MonitorMap *map, SMEDLValue *ids);
+ * ids - Pointer to an identity tuple containing the identities to look up.
+ *   Only the identities the map hashes on need to be filled in. */
+MonitorInstance * monitormap_lookup(MonitorMap *map, const void *ids);
+
+/* MONITORMAP_LOOKUP() and MONITORMAP_INSERT() are monitormap_lookup() and
+ * monitormap_insert() for a map initialized with the given hash and equals
+ * functions. In a unity build (SMEDL_UNITY, defined by the system's *_unity.c
+ * file), monitor_map.c is in the same translation unit as the local wrappers,
+ * so the functions are called directly and can be inlined rather than called
+ * through the map's pointers. */
+#ifdef SMEDL_UNITY
+#define MONITORMAP_LOOKUP(map, ids, hash, equals) \
+    monitormap_lookup_with(map, ids, hash, equals)
+#define MONITORMAP_INSERT(map, mon, next_inst, next_map, hash, equals) \
+    monitormap_insert_with(map, mon, next_inst, next_map, hash, equals)
+#else
+#define MONITORMAP_LOOKUP(map, ids, hash, equals) monitormap_lookup(map, ids)
+#define MONITORMAP_INSERT(map, mon, next_inst, next_map, hash, equals) \
+    monitormap_insert(map, mon, next_inst, next_map)
+#endif
 
 /* Remove a monitor from the MonitorMap. Recursively remove from next maps, as
  * well.
@@ -154,8 +209,36 @@ void monitormap_removeinst(MonitorMap *map, MonitorInstance *inst);
  * map - The MonitorMap to clean up.
  * free_contents - If true, will clean up the instances from all their linked
  *   maps and return a linked list of all instances. Each instance must be
- *   freed when no longer needed.
+ *   freed when no longer needed (with SMEDL_FREE_OBJECT() from snapshot.h, in
+ *   the map's account and SMEDL_MEM_MAP_INSTANCE).
  */
 MonitorInstance * monitormap_free(MonitorMap *map, int free_contents);
 
+/* Fill in the health of a MonitorMap. This walks the whole table and every
+ * list, so it takes time proportional to the capacity and number of
+ * instances.
+ *
+ * Parameters:
+ * map - The MonitorMap to examine
+ * stats - Pointer to the MonitorMapStats to fill in */
+void monitormap_stats(MonitorMap *map, MonitorMapStats *stats);
+
+/* Most monitor maps kept by one local wrapper */
+#define MONITOR_STATS_MAPS 8
+
+/* Population of a monitor type and the health of its monitor maps, filled in
+ * by the stats interface of its local wrapper */
+typedef struct MonitorStats {
+    size_t live;            /* Monitors currently alive */
+    size_t spilled;         /* Of those, kept in a spill table (see spill.h) */
+    uint64_t dynamic;       /* Created by dynamic instantiation */
+    uint64_t created;       /* Created through the creation interface */
+    uint64_t recycled;      /* Freed on reaching a final state */
+    size_t map_count;       /* Monitor maps described below */
+    struct {
+        const char *name;   /* e.g. "all", "0_2", "none" */
+        MonitorMapStats stats;
+    } maps[MONITOR_STATS_MAPS];
+} MonitorStats;
+
 #endif /* MONITOR_MAP_H */
@@ -0,0 +1,137 @@
+#ifndef PROFILE_H
+#define PROFILE_H
+
+#include <stddef.h>
+#include <stdio.h>
+
+/* Hardware performance counter profile of the stages of handling events.
+ * Define SMEDL_PROFILE to enable it. Otherwise, the SMEDL_PROFILE_* macros
+ * below expand to nothing and nothing is counted.
+ *
+ * The counters are opened with perf_event_open() for the thread that calls
+ * smedl_profile_init() and count user space only:
+ * - cycles
+ * - instructions
+ * - l1d_misses (L1 data cache read misses)
+ * - llc_misses (last-level cache read misses)
+ * - branch_misses
+ * Counters the CPU or kernel does not offer (such as in most virtual
+ * machines) are listed as unavailable. If none can be opened, task_clock_ns
+ * (the thread's CPU time, a software counter) is counted instead, so the
+ * split between stages is still shown. Where the kernel allows it, counters
+ * are read with rdpmc rather than a system call.
+ *
+ * Counts are exclusive: a stage entered inside another (a lookup inside a
+ * route, say) is subtracted from the outer one. The stages are:
+ * - parse: reading and converting the message
+ * - route: the global wrapper's route_*() (building identities and params)
+ * - lookup: get_*_monitors() (including dynamic instantiation)
+ * - execute: execute_*() and the batch handlers
+ * - output: writing an event out of the system
+ * - other: everything else, such as the event queues and batching
+ * Parse and output are counted for the channel of the message. Route, lookup
+ * and execute are counted for the connection being routed, which is named
+ * like the channel it comes from. Work for no channel is listed as "none".
+ *
+ * The profile is printed to stderr as one line of JSON at exit:
+ * {"profile": {"counters": {"cycles": {"running": 1.00}, ...},
+ *     "unavailable": ["l1d_misses"], "channels": {
+ *         "<channel>": {
+ *             "<stage>": {"calls": 1000, "cycles": 412500,
+ *                 "instructions": 803211, ...},
+ *             ...
+ *         },
+ *         ...
+ *     }, "stages": {
+ *         "<stage>": {"calls": 5000, "cycles": 1927000, ...},
+ *         ...
+ * }}}
+ * "stages" totals each stage over all channels. running is the fraction of
+ * the time the counter was counting. It is below 1 if the kernel had to take
+ * turns with more counters than the CPU has. Counts are not scaled for it. */
+
+#ifndef SMEDL_PROFILE_MAX_CHANNELS
+#define SMEDL_PROFILE_MAX_CHANNELS 64
+#endif
+
+/* Deepest nesting of stages. Deeper stages are counted in the stage they are
+ * nested in. */
+#ifndef SMEDL_PROFILE_MAX_DEPTH
+#define SMEDL_PROFILE_MAX_DEPTH 32
+#endif
+
+/* Stages of handling an event */
+typedef enum {
+    SMEDL_PROFILE_STAGE_PARSE,
+    SMEDL_PROFILE_STAGE_ROUTE,
+    SMEDL_PROFILE_STAGE_LOOKUP,
+    SMEDL_PROFILE_STAGE_EXECUTE,
+    SMEDL_PROFILE_STAGE_OUTPUT,
+    SMEDL_PROFILE_STAGE_OTHER,
+    SMEDL_PROFILE_STAGES
+} SMEDLProfileStage;
+
+/* Channel for work not done for any channel. Listed as "none". */
+#define SMEDL_PROFILE_NONE (-1)
+
+/* Channel for a stage to be counted for the channel of the stage it is nested
+ * in */
+#define SMEDL_PROFILE_INHERIT (-2)
+
+/* Open the counters and start counting. The channels with the given names are
+ * numbered by system channel. More are added as connections with other names
+ * are routed. The names must stay valid. Prints the profile at exit. Return
+ * nonzero on success, zero if no counter could be opened. */
+int smedl_profile_init(const char *const *channels, size_t count);
+
+/* Enter a stage, counted for the given channel (or SMEDL_PROFILE_NONE or
+ * SMEDL_PROFILE_INHERIT) */
+void smedl_profile_push(SMEDLProfileStage stage, int channel);
+
+/* Leave the current stage */
+void smedl_profile_pop(void);
+
+/* Enter the route stage for the connection with the given name. *channel is
+ * the number of the channel with that name once found, and less than
+ * SMEDL_PROFILE_NONE before. */
+void smedl_profile_route(int *channel, const char *name);
+
+/* Enter the parse stage for a new message, leaving the parse stage of the
+ * previous message if it was skipped */
+void smedl_profile_start(void);
+
+/* Leave the parse stage, counting it for the given channel */
+void smedl_profile_parsed(int channel);
+
+/* Print the profile as one line of JSON */
+void smedl_profile_dump(FILE *f);
+
+#ifdef SMEDL_PROFILE
+#define SMEDL_PROFILE_PUSH(stage) \
+    smedl_profile_push(stage, SMEDL_PROFILE_INHERIT)
+#define SMEDL_PROFILE_POP() smedl_profile_pop()
+/* Enter the route stage. Declares a variable, so it must come at the start of
+ * a block. */
+#define SMEDL_PROFILE_ROUTE(name) \
+    static int smedl_profile_channel = SMEDL_PROFILE_INHERIT; \
+    smedl_profile_route(&smedl_profile_channel, name)
+#define SMEDL_PROFILE_OUTPUT(channel) \
+    smedl_profile_push(SMEDL_PROFILE_STAGE_OUTPUT, channel)
+#define SMEDL_PROFILE_START() smedl_profile_start()
+#define SMEDL_PROFILE_PARSED(channel) smedl_profile_parsed(channel)
+/* Time between events is counted as other work for no channel */
+#define SMEDL_PROFILE_PAUSE() \
+    smedl_profile_push(SMEDL_PROFILE_STAGE_OTHER, SMEDL_PROFILE_NONE)
+#define SMEDL_PROFILE_RESUME() smedl_profile_pop()
+#else
+#define SMEDL_PROFILE_PUSH(stage) ((void) 0)
+#define SMEDL_PROFILE_POP() ((void) 0)
+#define SMEDL_PROFILE_ROUTE(name)
+#define SMEDL_PROFILE_OUTPUT(channel) ((void) 0)
+#define SMEDL_PROFILE_START() ((void) 0)
+#define SMEDL_PROFILE_PARSED(channel) ((void) 0)
+#define SMEDL_PROFILE_PAUSE() ((void) 0)
+#define SMEDL_PROFILE_RESUME() ((void) 0)
+#endif
+
+#endif /* PROFILE_H */
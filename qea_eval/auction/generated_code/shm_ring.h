@@ -0,0 +1,173 @@
+#ifndef SHM_RING_H
+#define SHM_RING_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "smedl_types.h"
+#include "event_codec.h"
+
+/* Shared-memory event transport between a target process and a monitor
+ * process.
+ *
+ * The segment is a POSIX shared memory object holding a bounded ring of
+ * fixed-size cells. Any number of producers (target processes and threads)
+ * take a position with one compare-and-swap, claim its cell with another and
+ * fill it in place; one consumer (the monitor) reads them in position order.
+ * Each cell has a sequence number that tells whose turn it is, so no locks are
+ * taken. Producers wait on a futex when the ring is full and the consumer waits
+ * on another when it is empty. Futexes are only woken when the other side has
+ * said it is waiting.
+ *
+ * A cell holds one event in the encoding described in event_codec.h: the
+ * channel name followed by tagged params and optionally aux data (JSON text
+ * passed through to the output).
+ *
+ * The segment outlives both sides, which is what makes restarts clean:
+ * - If the monitor restarts, it picks up at the first cell it had not
+ *   released. While no monitor is attached, producers drop events instead of
+ *   blocking once the ring fills.
+ * - If a producer dies after claiming a cell but before publishing it, the
+ *   monitor skips the cell once it sees the owner is gone. A producer that
+ *   stalls between taking a position and claiming its cell for long enough
+ *   loses the cell to the monitor and takes another position. A cell is never
+ *   skipped while the producer that claimed it is alive, so it cannot be
+ *   handed to another producer while still being written.
+ * - If the process initializing the segment dies, the next one to open it
+ *   initializes it again.
+ * Remove the segment with smedl_shm_unlink() (or rm /dev/shm/<name>) once
+ * neither side needs it. */
+
+/* Number of cells in the ring. Must be a power of two. */
+#ifndef SMEDL_SHM_CELLS
+#define SMEDL_SHM_CELLS 4096
+#endif
+
+/* Size of each cell in bytes, including its 24-byte header. An event that does
+ * not fit is dropped. */
+#ifndef SMEDL_SHM_CELL_SIZE
+#define SMEDL_SHM_CELL_SIZE 256
+#endif
+
+/* How long a claimed cell may stay unpublished before the monitor checks
+ * whether its producer is still alive, in milliseconds */
+#ifndef SMEDL_SHM_STALL_MS
+#define SMEDL_SHM_STALL_MS 100
+#endif
+
+/* A cell. seq is the cell's position while it is free, one more than that once
+ * it has been published, and its position plus the ring size once the monitor
+ * has released it. */
+typedef struct {
+    uint64_t seq;
+    uint64_t claim;  /* Who owns the cell in this lap (see shm_ring.c) */
+    uint32_t len;    /* Bytes of data used. Zero for a skipped event. */
+    uint32_t pad;
+    unsigned char data[SMEDL_SHM_CELL_SIZE - 24];
+} SMEDLShmCell;
+
+/* The shared segment. Producer and consumer state are kept on separate cache
+ * lines. */
+typedef struct {
+    uint64_t magic;
+    uint32_t version;
+    uint32_t cell_size;
+    uint32_t cells;
+    uint32_t state;               /* 0 new, 2 ready, or being initialized
+                                   * (see shm_ring.c) */
+    char pad_header[40];
+
+    uint64_t enqueue_pos;         /* Next position to claim */
+    uint32_t space_futex;         /* Bumped when cells are released */
+    uint32_t producers_waiting;   /* Producers waiting for space */
+    uint64_t dropped;             /* Events dropped by producers */
+    char pad_producer[40];
+
+    uint64_t dequeue_pos;         /* Next position to read */
+    uint32_t data_futex;          /* Bumped when cells are published */
+    uint32_t consumer_waiting;    /* Nonzero while the monitor waits */
+    int32_t consumer;             /* Process ID of the monitor, or 0 */
+    char pad_consumer[44];
+
+    SMEDLShmCell cell[SMEDL_SHM_CELLS];
+} SMEDLShmRing;
+
+/* A mapped segment */
+typedef struct {
+    SMEDLShmRing *ring;
+    size_t size;
+    /* Monitor only: the claimed cell being waited on and since when */
+    uint64_t stall_pos;
+    uint64_t stall_since;
+} SMEDLShm;
+
+/* An event being written into a claimed cell. Start with
+ * smedl_shm_begin(), add params and aux, then call smedl_shm_commit(). */
+typedef struct {
+    SMEDLShm *shm;
+    SMEDLShmCell *cell;
+    uint64_t pos;
+    SMEDLEncoder enc;
+} SMEDLShmWriter;
+
+/* An event being read from a cell. Start with smedl_shm_next(), then decode
+ * it with the event_codec.h functions. */
+typedef struct {
+    SMEDLShmCell *cell;
+    SMEDLDecoder dec;
+} SMEDLShmReader;
+
+/* Open the named segment (e.g. "/auction"), creating and initializing it if it
+ * does not exist yet. Return nonzero on success, zero on failure (including a
+ * segment with a different layout). Cleanup with smedl_shm_close(). */
+int smedl_shm_open(SMEDLShm *shm, const char *name);
+
+/* Unmap the segment. The segment itself remains. */
+void smedl_shm_close(SMEDLShm *shm);
+
+/* Remove the named segment. Return nonzero on success, zero on failure. */
+int smedl_shm_unlink(const char *name);
+
+/* Producer interface */
+
+/* Claim a cell for an event on the named channel. If the ring is full, wait
+ * for the monitor to make room. Return nonzero on success, zero if the event
+ * had to be dropped because no monitor is attached. The params and aux
+ * functions and smedl_shm_commit() may still be called after a failure; they
+ * do nothing. */
+int smedl_shm_begin(SMEDLShm *shm, SMEDLShmWriter *w, const char *channel);
+
+/* Add a param to the event. Params must be added in order. */
+void smedl_shm_put_int(SMEDLShmWriter *w, int i);
+void smedl_shm_put_float(SMEDLShmWriter *w, double d);
+void smedl_shm_put_char(SMEDLShmWriter *w, char c);
+void smedl_shm_put_string(SMEDLShmWriter *w, const char *s);
+void smedl_shm_put_pointer(SMEDLShmWriter *w, void *p);
+
+/* Attach aux data to the event. Must be valid JSON text and be added after
+ * the last param. */
+void smedl_shm_put_aux(SMEDLShmWriter *w, const char *json, size_t len);
+
+/* Publish the event. Return nonzero on success, zero if it was dropped (it
+ * did not fit in a cell, or smedl_shm_begin() failed). */
+int smedl_shm_commit(SMEDLShmWriter *w);
+
+/* Consumer interface */
+
+/* Attach as the segment's monitor. Return nonzero on success, zero if another
+ * live process is already attached. */
+int smedl_shm_serve(SMEDLShm *shm);
+
+/* Detach as the segment's monitor */
+void smedl_shm_unserve(SMEDLShm *shm);
+
+/* Get the next event, waiting up to timeout_ms milliseconds for one to be
+ * published (zero to not wait). Return nonzero and fill in r if there is one,
+ * zero if not (or if interrupted by a signal). Events that producers dropped
+ * are skipped. Release the event with smedl_shm_release() when done with it. */
+int smedl_shm_next(SMEDLShm *shm, SMEDLShmReader *r, int timeout_ms);
+
+/* Give the cell back to the producers. Strings and aux data decoded from the
+ * event are no longer valid afterward. */
+void smedl_shm_release(SMEDLShm *shm, SMEDLShmReader *r);
+
+#endif /* SHM_RING_H */
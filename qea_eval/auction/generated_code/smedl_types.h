@@ -130,6 +130,39 @@ void smedl_free_array(SMEDLValue *array, size_t len);
  */
 void smedl_free_array_contents(SMEDLValue *array, size_t len);
 
+/*
+ * A reference-counted event: the identities and params of one event, along
+ * with the contents of any strings and opaques, packed into one allocation.
+ * Holders of a reference may read ids and params (and anything they point to)
+ * without copying them. ids is NULL if the event has no identities.
+ */
+typedef struct SMEDLEvent {
+    unsigned refs;
+    SMEDLValue *ids;
+    SMEDLValue *params;
+    SMEDLValue values[]; /* ids, then params, then string and opaque data */
+} SMEDLEvent;
+
+/*
+ * Pack copies of the given identities and params into a new SMEDLEvent with
+ * one reference, owned by the caller.
+ *
+ * Return the event, or NULL if it could not be made.
+ */
+SMEDLEvent * smedl_event_new(SMEDLValue *ids, size_t ids_len,
+        SMEDLValue *params, size_t params_len);
+
+/*
+ * Take another reference to the event.
+ */
+void smedl_event_retain(SMEDLEvent *ev);
+
+/*
+ * Drop a reference to the event. The event is freed when the last reference is
+ * dropped.
+ */
+void smedl_event_release(SMEDLEvent *ev);
+
 /*
  * Convert a pointer to string representation. Return nonzero on success, zero
  * on failure.
@@ -152,4 +185,23 @@ int smedl_string_to_pointer(const char *str, void **ptr);
 typedef int (*SMEDLCallback)(SMEDLValue *identities, SMEDLValue *params,
         void *aux);
 
+/*
+ * A callback function pointer for receiving exported events without copying
+ * them. The event is only borrowed for the duration of the call; to keep it
+ * longer, take a reference with smedl_event_retain(). Such functions must
+ * return nonzero on success, zero on failure.
+ */
+typedef int (*SMEDLBorrowCallback)(SMEDLEvent *ev, void *aux);
+
+/*
+ * An event imported into a global wrapper as part of a batch. channel is a
+ * value from the receiving synchronous set's import channel enum.
+ */
+typedef struct SMEDLImportEvent {
+    int channel;
+    SMEDLValue *identities;
+    SMEDLValue *params;
+    void *aux;
+} SMEDLImportEvent;
+
 #endif /* SMEDL_TYPES_H */
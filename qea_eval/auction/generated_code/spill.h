@@ -0,0 +1,78 @@
+#ifndef SPILL_H
+#define SPILL_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* On-disk storage for cold monitors.
+ *
+ * A spill table is a hash table with open addressing (Robin Hood hashing, like
+ * the monitor maps) kept in a file mapped with mmap(). Keys and values are
+ * fixed-size byte strings. A local wrapper spills a monitor by storing its
+ * identity tuple as the key and its scenario states and state variables as the
+ * value, then freeing the monitor, and faults it back in by taking the entry
+ * out again. Keys are hashed and compared bytewise, so any padding in them must
+ * be zeroed. Values are 8-byte aligned in the table.
+ *
+ * Only the pages of the file in use need to be in memory: the kernel writes the
+ * others back to disk and drops them when memory is short. The file is scratch
+ * space, private to the table: it is created with a unique name and removed as
+ * soon as it is created, so nothing is left behind once the table is closed or
+ * the process exits. The table doubles when it is 3/4 full, into a new file; it
+ * never shrinks. */
+
+/* The name, before its unique suffix, of the spill files of local wrappers
+ * built with SMEDL_SPILL_BUDGET */
+#ifndef SMEDL_SPILL_FILE
+#define SMEDL_SPILL_FILE "smedl.spill"
+#endif
+
+typedef struct SMEDLSpill {
+    const char *path;       /* Prefix of the file's name */
+    int fd;
+    unsigned char *table;   /* The mapped file */
+    size_t key_size;
+    size_t value_size;
+    size_t value_offset;    /* Offset of the value in a slot */
+    size_t slot_size;       /* Bytes per slot: header, key and value */
+    size_t capacity;        /* Slots, a power of 2 */
+    size_t mask;            /* Mask to convert hash->index */
+    size_t count;           /* Entries stored */
+    size_t grow_at;         /* When count reaches this size, enlarge */
+    size_t scan;            /* Where smedl_spill_pop() looks next */
+    unsigned char *scratch; /* Room for two slots, for moving entries */
+} SMEDLSpill;
+
+/* Create a spill table for keys and values of the given sizes in a new file
+ * named path followed by a unique suffix, e.g. "smedl.spill.a1B2c3". path must
+ * stay valid until the table is closed. Return nonzero on success, zero on
+ * failure. */
+int smedl_spill_open(SMEDLSpill *spill, const char *path, size_t key_size,
+        size_t value_size);
+
+/* Unmap and close the table. Its entries are lost. */
+void smedl_spill_close(SMEDLSpill *spill);
+
+/* Store an entry. The key must not be in the table already. Return nonzero on
+ * success, zero if the table could not grow. */
+int smedl_spill_put(SMEDLSpill *spill, const void *key, const void *value);
+
+/* Find the value stored for a key. Return a pointer to it in the table, or NULL
+ * if the key is not in the table. The pointer is valid until the table is next
+ * changed. */
+void * smedl_spill_find(SMEDLSpill *spill, const void *key);
+
+/* Remove the entry whose value was returned by smedl_spill_find() */
+void smedl_spill_remove(SMEDLSpill *spill, void *value);
+
+/* Take any entry out of the table, copying its key and value out. Return
+ * nonzero if there was one, zero if the table is empty. */
+int smedl_spill_pop(SMEDLSpill *spill, void *key, void *value);
+
+/* Iterate over the entries. Start with *pos at 0. Return nonzero and point key
+ * and value at the next entry in the table, or zero when there are no more.
+ * The table must not be changed in between. */
+int smedl_spill_next(const SMEDLSpill *spill, size_t *pos, const void **key,
+        const void **value);
+
+#endif /* SPILL_H */
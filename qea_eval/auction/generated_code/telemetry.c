@@ -0,0 +1,128 @@
+/* For clock_gettime() and sysconf() */
+#define _POSIX_C_SOURCE 200809L
+#include <stdio.h>
+#include <time.h>
+#include <unistd.h>
+#include "memstats.h"
+#include "telemetry.h"
+
+/* Clock for the interval. A coarse clock is enough and cheaper to read for
+ * every event. */
+#ifdef CLOCK_MONOTONIC_COARSE
+#define STATS_CLOCK CLOCK_MONOTONIC_COARSE
+#else
+#define STATS_CLOCK CLOCK_MONOTONIC
+#endif
+
+static FILE *stats_file;
+static void (*stats_write_monitors)(FILE *f);
+static long stats_interval_ms;
+static struct timespec stats_start;
+static long long stats_next_ms;
+
+/* Members written to the "monitors" object of the current line */
+static size_t stats_members;
+
+static long long elapsed_ms(void) {
+    struct timespec now;
+    clock_gettime(STATS_CLOCK, &now);
+    return (now.tv_sec - stats_start.tv_sec) * 1000LL +
+        (now.tv_nsec - stats_start.tv_nsec) / 1000000;
+}
+
+/* Return the resident set size in KiB, or -1 if it cannot be read */
+static long long rss_kb(void) {
+    FILE *f = fopen("/proc/self/statm", "r");
+    if (f == NULL) {
+        return -1;
+    }
+    long long size, resident;
+    int n = fscanf(f, "%lld %lld", &size, &resident);
+    fclose(f);
+    if (n != 2) {
+        return -1;
+    }
+    return resident * (sysconf(_SC_PAGESIZE) / 1024);
+}
+
+int smedl_stats_open(const char *path, long interval_ms,
+        void (*write_monitors)(FILE *f)) {
+    stats_file = fopen(path, "w");
+    if (stats_file == NULL) {
+        return 0;
+    }
+    stats_write_monitors = write_monitors;
+    stats_interval_ms = interval_ms;
+    clock_gettime(STATS_CLOCK, &stats_start);
+    smedl_stats_write(0);
+    return 1;
+}
+
+void smedl_stats_poll(size_t messages) {
+    if (stats_file != NULL && elapsed_ms() >= stats_next_ms) {
+        smedl_stats_write(messages);
+    }
+}
+
+void smedl_stats_write(size_t messages) {
+    if (stats_file == NULL) {
+        return;
+    }
+    long long ms = elapsed_ms();
+    long long rss = rss_kb();
+    fprintf(stats_file, "{\"ms\": %lld, \"messages\": %zu, ", ms, messages);
+    if (rss >= 0) {
+        fprintf(stats_file, "\"rss_kb\": %lld, ", rss);
+    } else {
+        fprintf(stats_file, "\"rss_kb\": null, ");
+    }
+#ifdef SMEDL_MEMSTATS
+    fprintf(stats_file, "\"memory\": ");
+    smedl_mem_write(stats_file);
+    fprintf(stats_file, ", ");
+#endif
+    fprintf(stats_file, "\"monitors\": {");
+    stats_members = 0;
+    stats_write_monitors(stats_file);
+    fprintf(stats_file, "}}\n");
+    fflush(stats_file);
+
+    /* Skip intervals missed while busy rather than catching up */
+    stats_next_ms = (ms / stats_interval_ms + 1) * stats_interval_ms;
+}
+
+void smedl_stats_close(size_t messages) {
+    if (stats_file == NULL) {
+        return;
+    }
+    smedl_stats_write(messages);
+    fclose(stats_file);
+    stats_file = NULL;
+}
+
+void smedl_stats_write_monitors(FILE *f, const char *name,
+        const MonitorStats *stats) {
+    fprintf(f, "%s\"%s\": {\"live\": %zu, \"spilled\": %zu, "
+            "\"dynamic\": %llu, \"created\": %llu, \"recycled\": %llu, "
+            "\"maps\": {",
+            stats_members++ > 0 ? ", " : "", name, stats->live, stats->spilled,
+            (unsigned long long) stats->dynamic,
+            (unsigned long long) stats->created,
+            (unsigned long long) stats->recycled);
+    for (size_t i = 0; i < stats->map_count; i++) {
+        const MonitorMapStats *m = &stats->maps[i].stats;
+        fprintf(f, "%s\"%s\": {\"capacity\": %zu, \"lists\": %zu, "
+                "\"instances\": %zu, \"max_list\": %zu, \"mean_list\": %.2f, "
+                "\"max_dib\": %u, \"mean_dib\": %.2f, \"grows\": %llu, "
+                "\"shrinks\": %llu, \"resize_ns\": %llu, "
+                "\"max_resize_ns\": %llu}",
+                i > 0 ? ", " : "", stats->maps[i].name, m->capacity,
+                m->lists, m->instances, m->max_list,
+                m->lists > 0 ? (double) m->instances / m->lists : 0.0,
+                m->max_dib, m->mean_dib, (unsigned long long) m->grows,
+                (unsigned long long) m->shrinks,
+                (unsigned long long) m->resize_ns,
+                (unsigned long long) m->max_resize_ns);
+    }
+    fprintf(f, "}}");
+}
@@ -0,0 +1,106 @@
+#ifndef CanSys_HPP
+#define CanSys_HPP
+
+#include "smedl.hpp"
+
+extern "C" {
+#include "CanSys_global_wrapper.h"
+}
+
+/* C++ interface to the CanSys synchronous set (see smedl.hpp). Link against
+ * libCanSys.a. */
+
+namespace smedl::CanSys {
+
+/* Owns the global wrapper */
+using System = Syncset<init_CanSys_syncset, free_CanSys_syncset>;
+
+/* Import channels */
+enum class Channel {
+    ch1,
+    ch2,
+    ch3,
+    ch7,
+};
+
+inline constexpr Channel ch1 = Channel::ch1;
+inline constexpr Channel ch2 = Channel::ch2;
+inline constexpr Channel ch3 = Channel::ch3;
+inline constexpr Channel ch7 = Channel::ch7;
+
+template <Channel C>
+struct ChannelTraits;
+
+template <>
+struct ChannelTraits<Channel::ch1> {
+    using Params = std::tuple<std::string, std::string>;
+    static constexpr auto import = import_CanSys_ch1;
+};
+
+template <>
+struct ChannelTraits<Channel::ch2> {
+    using Params = std::tuple<std::string, std::string>;
+    static constexpr auto import = import_CanSys_ch2;
+};
+
+template <>
+struct ChannelTraits<Channel::ch3> {
+    using Params = std::tuple<>;
+    static constexpr auto import = import_CanSys_ch3;
+};
+
+template <>
+struct ChannelTraits<Channel::ch7> {
+    using Params = std::tuple<std::string, std::string, int>;
+    static constexpr auto import = import_CanSys_ch7;
+};
+
+/* Import an event on channel C. Return true on success, false on failure. */
+template <Channel C, typename... Args>
+inline bool emit(Args &&...args) {
+    return emit_on<ChannelTraits<C>>(std::forward<Args>(args)...);
+}
+
+/* Events exported to the environment */
+enum class Export {
+    Collect_result,
+};
+
+inline constexpr Export Collect_result = Export::Collect_result;
+
+template <Export E>
+struct ExportTraits;
+
+template <>
+struct ExportTraits<Export::Collect_result> {
+    using Identities = std::tuple<>;
+    using Params = std::tuple<int>;
+    static constexpr auto connect = callback_CanSys_Collect_result;
+};
+
+/* Set the handler for exported event E, or unregister it with an empty
+ * handler */
+template <Export E>
+inline void on(typename detail::Export<ExportTraits<E>>::Handler handler) {
+    on_export<ExportTraits<E>>(std::move(handler));
+}
+
+/* Set the handler for exported event E when exported by the monitor with the
+ * given identities, or unregister it with an empty handler */
+template <Export E>
+inline void on(typename detail::Export<ExportTraits<E>>::Handlers::Key key,
+        typename detail::Export<ExportTraits<E>>::Handler handler) {
+    on_export<ExportTraits<E>>(std::move(key), std::move(handler));
+}
+
+/* Maps keyed by the identities of each monitor */
+template <typename T>
+using CandidateSelectionMap = MonitorMap<T, std::string, std::string>;
+template <typename T>
+using CandidateRankMap = MonitorMap<T, std::string, std::string, std::string>;
+template <typename T>
+using CollectVMap = MonitorMap<T, std::string>;
+
+} /* namespace smedl::CanSys */
+
+#endif /* CanSys_HPP */
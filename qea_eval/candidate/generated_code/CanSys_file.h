@@ -2,6 +2,7 @@
 #define CanSys_FILE_H
 
 #include "file.h"
+#include "shm_ring.h"
 
 /* Current message format version. Increment the major version whenever making
  * a backward-incompatible change to the message format. Increment the minor
@@ -39,12 +40,6 @@ typedef enum {
     SYSCHANNEL_ch2,
     SYSCHANNEL_ch3,
     SYSCHANNEL_ch7,
-    SYSCHANNEL_ch6,
-    SYSCHANNEL_ch8,
-    SYSCHANNEL_ch9,
-    SYSCHANNEL_ch5,
-    SYSCHANNEL_ch10,
-    SYSCHANNEL_ch11,
     SYSCHANNEL_Collect_result,
 } ChannelID;
 
@@ -60,14 +55,13 @@ int enqueue_ch1(SMEDLValue *identities, SMEDLValue *params, void *aux);
 int enqueue_ch2(SMEDLValue *identities, SMEDLValue *params, void *aux);
 int enqueue_ch3(SMEDLValue *identities, SMEDLValue *params, void *aux);
 int enqueue_ch7(SMEDLValue *identities, SMEDLValue *params, void *aux);
-int enqueue_ch6(SMEDLValue *identities, SMEDLValue *params, void *aux);
-int enqueue_ch8(SMEDLValue *identities, SMEDLValue *params, void *aux);
-int enqueue_ch9(SMEDLValue *identities, SMEDLValue *params, void *aux);
-int enqueue_ch5(SMEDLValue *identities, SMEDLValue *params, void *aux);
-int enqueue_ch10(SMEDLValue *identities, SMEDLValue *params, void *aux);
-int enqueue_ch11(SMEDLValue *identities, SMEDLValue *params, void *aux);
 int enqueue_Collect_result(SMEDLValue *identities, SMEDLValue *params, void *aux);
 
+/* Borrowed callbacks for events exported from global wrappers. These keep a
+ * reference to the exported event instead of copying it.
+ * Return nonzero on success, zero on failure. */
+int enqueue_borrowed_Collect_result(SMEDLEvent *ev, void *aux);
+
 /* Output functions for events that are "sent back to the target system."
  * Return nonzero on success, zero on failure. */
 int write_Collect_result(SMEDLValue *identities, SMEDLValue *params, void *aux);
@@ -83,6 +77,12 @@ void free_global_wrappers();
  * events are skipped (with a warning printed to stderr). */
 void read_events(JSONParser *parser);
 
+/* Receive and process events from the provided shared-memory segment until
+ * SIGINT or SIGTERM, then process the events already published. The caller
+ * must be attached as the segment's monitor. Any malformed events are skipped
+ * (with a warning printed to stderr). */
+void read_shm_events(SMEDLShm *shm);
+
 /* Verify the fmt_version and retrieve the other necessary components
  * (channel, params, aux). Return nonzero if successful, zero if something is
  * missing or incorrect.
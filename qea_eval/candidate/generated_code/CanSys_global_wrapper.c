@@ -0,0 +1,572 @@
+#if DEBUG > 0
+#include <stdio.h>
+#endif
+#include <stdlib.h>
+#include "smedl_types.h"
+#include "global_event_queue.h"
+#include "profile.h"
+#include "CanSys_global_wrapper.h"
+#include "CandidateSelection_local_wrapper.h"
+#include "CandidateRank_local_wrapper.h"
+#include "CollectV_local_wrapper.h"
+#include "Collect_local_wrapper.h"
+#include "CandidateSelection_mon.h"
+#include "CandidateRank_mon.h"
+#include "CollectV_mon.h"
+#include "Collect_mon.h"
+
+/* Global event queues - containing exported events */
+static GlobalEventQueue intra_queue;
+static GlobalEventQueue inter_queue;
+
+/* Callback function pointers */
+static SMEDLCallback cb_Collect_result;
+
+/* Borrowed callback function pointers. Used instead of the callbacks above
+ * when set. */
+static SMEDLBorrowCallback bcb_Collect_result;
+
+/* Initialization interface - Initialize the global wrapper. Must be called once
+ * before importing any events. Return nonzero on success, zero on failure. */
+int init_CanSys_syncset() {
+    /* Initialize all local wrappers */
+    if (!init_CandidateSelection_local_wrapper()) {
+        goto fail_init_CandidateSelection;
+    }
+    if (!init_CandidateRank_local_wrapper()) {
+        goto fail_init_CandidateRank;
+    }
+    if (!init_CollectV_local_wrapper()) {
+        goto fail_init_CollectV;
+    }
+    if (!init_Collect_local_wrapper()) {
+        goto fail_init_Collect;
+    }
+
+    return 1;
+
+fail_init_Collect:
+    free_CollectV_local_wrapper();
+fail_init_CollectV:
+    free_CandidateRank_local_wrapper();
+fail_init_CandidateRank:
+    free_CandidateSelection_local_wrapper();
+fail_init_CandidateSelection:
+    return 0;
+}
+
+/* Cleanup interface - Tear down and free the resources used by this global
+ * wrapper and all the local wrappers and monitors it manages. */
+void free_CanSys_syncset() {
+    /* Free local wrappers */
+    free_CandidateSelection_local_wrapper();
+    free_CandidateRank_local_wrapper();
+    free_CollectV_local_wrapper();
+    free_Collect_local_wrapper();
+
+    /* Unset callbacks */
+    cb_Collect_result = NULL;
+    bcb_Collect_result = NULL;
+}
+
+/* Snapshot interface - Write the monitors of every local wrapper to the
+ * snapshot (see snapshot.h). Return nonzero on success, zero on failure. */
+int snapshot_CanSys_syncset(SMEDLSnapshotWriter *w) {
+    return snapshot_CandidateSelection_monitors(w) &&
+        snapshot_CandidateRank_monitors(w) &&
+        snapshot_CollectV_monitors(w) &&
+        snapshot_Collect_monitors(w);
+}
+
+/* Restore interfaces - Reserve room in the restore block for the monitors of
+ * every local wrapper in the snapshot, then restore them. Return nonzero on
+ * success, zero on failure. */
+int reserve_CanSys_syncset(SMEDLSnapshot *snap) {
+    return reserve_CandidateSelection_monitors(snap) &&
+        reserve_CandidateRank_monitors(snap) &&
+        reserve_CollectV_monitors(snap) &&
+        reserve_Collect_monitors(snap);
+}
+
+int restore_CanSys_syncset(SMEDLSnapshot *snap) {
+    return restore_CandidateSelection_monitors(snap) &&
+        restore_CandidateRank_monitors(snap) &&
+        restore_CollectV_monitors(snap) &&
+        restore_Collect_monitors(snap);
+}
+
+/* Intra routing function - Called by import interface functions and intra queue
+ * processing function to route events to the local wrappers.
+ * Return nonzero on success, zero on failure. */
+int route_CanSys_ch1(SMEDLValue *identities, SMEDLValue *params, void *aux) {
+    #if DEBUG >= 4
+    fprintf(stderr, "Global wrapper 'CanSys' routing for conn 'ch1'\n");
+    #endif
+    SMEDL_PROFILE_ROUTE("ch1");
+    {
+        SMEDLValue new_identities[2] = {
+                params[1],
+                params[0],
+            };
+
+        SMEDLValue *new_params = params;
+
+        if (!process_CandidateSelection_member(new_identities, new_params, aux)) {
+            /* malloc fail */
+            SMEDL_PROFILE_POP();
+            return 0;
+        }
+    }
+    SMEDL_PROFILE_POP();
+    return 1;
+}
+int route_CanSys_ch2(SMEDLValue *identities, SMEDLValue *params, void *aux) {
+    #if DEBUG >= 4
+    fprintf(stderr, "Global wrapper 'CanSys' routing for conn 'ch2'\n");
+    #endif
+    SMEDL_PROFILE_ROUTE("ch2");
+    {
+        SMEDLValue new_identities[2] = {
+                params[1],
+                {SMEDL_NULL},
+            };
+
+        SMEDLValue *new_params = params;
+
+        if (!process_CandidateSelection_candidate(new_identities, new_params, aux)) {
+            /* malloc fail */
+            SMEDL_PROFILE_POP();
+            return 0;
+        }
+    }
+    SMEDL_PROFILE_POP();
+    return 1;
+}
+int route_CanSys_ch3(SMEDLValue *identities, SMEDLValue *params, void *aux) {
+    #if DEBUG >= 4
+    fprintf(stderr, "Global wrapper 'CanSys' routing for conn 'ch3'\n");
+    #endif
+    SMEDL_PROFILE_ROUTE("ch3");
+    {
+        SMEDLValue new_identities[2] = {
+                {SMEDL_NULL},
+                {SMEDL_NULL},
+            };
+
+        SMEDLValue *new_params = NULL;
+
+        if (!process_CandidateSelection_end(new_identities, new_params, aux)) {
+            /* malloc fail */
+            SMEDL_PROFILE_POP();
+            return 0;
+        }
+    }
+    SMEDL_PROFILE_POP();
+    return 1;
+}
+int route_CanSys_ch7(SMEDLValue *identities, SMEDLValue *params, void *aux) {
+    #if DEBUG >= 4
+    fprintf(stderr, "Global wrapper 'CanSys' routing for conn 'ch7'\n");
+    #endif
+    SMEDL_PROFILE_ROUTE("ch7");
+    {
+        SMEDLValue new_identities[3] = {
+                params[1],
+                params[0],
+                {SMEDL_NULL},
+            };
+
+        SMEDLValue *new_params = params;
+
+        if (!process_CandidateRank_rank(new_identities, new_params, aux)) {
+            /* malloc fail */
+            SMEDL_PROFILE_POP();
+            return 0;
+        }
+    }
+    SMEDL_PROFILE_POP();
+    return 1;
+}
+int route_CanSys_ch5(SMEDLValue *identities, SMEDLValue *params, void *aux) {
+    #if DEBUG >= 4
+    fprintf(stderr, "Global wrapper 'CanSys' routing for conn 'ch5'\n");
+    #endif
+    SMEDL_PROFILE_ROUTE("ch5");
+    {
+        SMEDLValue new_identities[2] = {
+                identities[2],
+                identities[1],
+            };
+
+        SMEDLValue *new_params = NULL;
+
+        if (!process_CandidateSelection_valid(new_identities, new_params, aux)) {
+            /* malloc fail */
+            SMEDL_PROFILE_POP();
+            return 0;
+        }
+    }
+    SMEDL_PROFILE_POP();
+    return 1;
+}
+int route_CanSys_ch6(SMEDLValue *identities, SMEDLValue *params, void *aux) {
+    #if DEBUG >= 4
+    fprintf(stderr, "Global wrapper 'CanSys' routing for conn 'ch6'\n");
+    #endif
+    SMEDL_PROFILE_ROUTE("ch6");
+    {
+        SMEDLValue new_identities[3] = {
+                params[0],
+                identities[1],
+                identities[0],
+            };
+
+        SMEDLValue *new_params = NULL;
+
+        if (!process_CandidateRank_shouldrank(new_identities, new_params, aux)) {
+            /* malloc fail */
+            SMEDL_PROFILE_POP();
+            return 0;
+        }
+    }
+    SMEDL_PROFILE_POP();
+    return 1;
+}
+int route_CanSys_ch8(SMEDLValue *identities, SMEDLValue *params, void *aux) {
+    #if DEBUG >= 4
+    fprintf(stderr, "Global wrapper 'CanSys' routing for conn 'ch8'\n");
+    #endif
+    SMEDL_PROFILE_ROUTE("ch8");
+    {
+        SMEDLValue *new_identities = identities + 1;
+
+        SMEDLValue *new_params = NULL;
+
+        if (!process_CollectV_addP(new_identities, new_params, aux)) {
+            /* malloc fail */
+            SMEDL_PROFILE_POP();
+            return 0;
+        }
+    }
+    SMEDL_PROFILE_POP();
+    return 1;
+}
+int route_CanSys_ch9(SMEDLValue *identities, SMEDLValue *params, void *aux) {
+    #if DEBUG >= 4
+    fprintf(stderr, "Global wrapper 'CanSys' routing for conn 'ch9'\n");
+    #endif
+    SMEDL_PROFILE_ROUTE("ch9");
+    {
+        SMEDLValue *new_identities = identities + 1;
+
+        SMEDLValue *new_params = params;
+
+        if (!process_CollectV_inRes(new_identities, new_params, aux)) {
+            /* malloc fail */
+            SMEDL_PROFILE_POP();
+            return 0;
+        }
+    }
+    SMEDL_PROFILE_POP();
+    return 1;
+}
+int route_CanSys_ch10(SMEDLValue *identities, SMEDLValue *params, void *aux) {
+    #if DEBUG >= 4
+    fprintf(stderr, "Global wrapper 'CanSys' routing for conn 'ch10'\n");
+    #endif
+    SMEDL_PROFILE_ROUTE("ch10");
+    {
+        SMEDLValue *new_identities = NULL;
+
+        SMEDLValue *new_params = NULL;
+
+        if (!process_Collect_addV(new_identities, new_params, aux)) {
+            /* malloc fail */
+            SMEDL_PROFILE_POP();
+            return 0;
+        }
+    }
+    SMEDL_PROFILE_POP();
+    return 1;
+}
+int route_CanSys_ch11(SMEDLValue *identities, SMEDLValue *params, void *aux) {
+    #if DEBUG >= 4
+    fprintf(stderr, "Global wrapper 'CanSys' routing for conn 'ch11'\n");
+    #endif
+    SMEDL_PROFILE_ROUTE("ch11");
+    {
+        SMEDLValue *new_identities = NULL;
+
+        SMEDLValue *new_params = params;
+
+        if (!process_Collect_inRes(new_identities, new_params, aux)) {
+            /* malloc fail */
+            SMEDL_PROFILE_POP();
+            return 0;
+        }
+    }
+    SMEDL_PROFILE_POP();
+    return 1;
+}
+
+/* Routing functions for the intra queue, indexed by channel */
+static const SMEDLCallback intra_routes[] = {
+    [CHANNEL_CanSys_ch5] = route_CanSys_ch5,
+    [CHANNEL_CanSys_ch6] = route_CanSys_ch6,
+    [CHANNEL_CanSys_ch8] = route_CanSys_ch8,
+    [CHANNEL_CanSys_ch9] = route_CanSys_ch9,
+    [CHANNEL_CanSys_ch10] = route_CanSys_ch10,
+    [CHANNEL_CanSys_ch11] = route_CanSys_ch11,
+};
+
+/* Intra queue processing function - Route events to the local wrappers. Return
+ * nonzero on success, zero on failure. */
+static int handle_CanSys_intra() {
+    int success = 1;
+    int channel;
+    SMEDLEvent *ev;
+    void *aux;
+
+    while (pop_global_shared(&intra_queue, &channel, &ev, &aux)) {
+        success = intra_routes[channel](ev->ids, ev->params, aux) && success;
+
+        /* Drop the queue's reference. Strings and opaque data live in the
+         * event, so there is nothing else to free. */
+        smedl_event_release(ev);
+    }
+    return success;
+}
+
+/* Inter queue processing function - Call the export callbacks. Return nonzero
+ * on success, zero on failure. */
+static int handle_CanSys_inter() {
+    int success = 1;
+    int channel;
+    SMEDLEvent *ev;
+    void *aux;
+
+    while (pop_global_shared(&inter_queue, &channel, &ev, &aux)) {
+        switch (channel) {
+            case CHANNEL_CanSys_Collect_result:
+#if DEBUG >= 4
+                fprintf(stderr, "Global wrapper 'CanSys' exporting for conn 'Collect_result'\n");
+#endif
+                if (bcb_Collect_result != NULL) {
+                    success = success && bcb_Collect_result(ev, aux);
+                } else if (cb_Collect_result != NULL) {
+                    success = success &&
+                        cb_Collect_result(ev->ids, ev->params, aux);
+                }
+                break;
+        }
+
+        /* Drop the queue's reference. Strings and opaque data live in the
+         * event, so there is nothing else to free. */
+        smedl_event_release(ev);
+    }
+    return success;
+}
+
+/* Queue processing function - Handle the events in the intra queue, then the
+ * inter queue. Return nonzero on success, zero on failure. */
+static int handle_CanSys_queues() {
+    int success = handle_CanSys_intra();
+    return handle_CanSys_inter() && success;
+}
+
+/* Global wrapper export interfaces - Called by monitors to place exported
+ * events into the appropriate export queues, where they will later be routed to
+ * the proper destinations inside and outside the synchronous set.
+ * Returns nonzero on success, zero on failure.
+ *
+ * Parameters:
+ * identites - An array of SMEDLValue of the proper length for the exporting
+ *   monitor
+ * params - An array of SMEDLValue, one for each parameter of the exported event
+ * aux - Extra data that was passed from the imported event that caused this
+ *   exported event
+ */
+int raise_CandidateRank_valid(SMEDLValue *identities, SMEDLValue *params, void *aux) {
+    SMEDLEvent *ev = smedl_event_new(identities, 3, params, 0);
+    if (ev == NULL) {
+        /* malloc fail */
+        return 0;
+    }
+    /* Store on intra queue */
+    if (!push_global_shared(&intra_queue, CHANNEL_CanSys_ch5, ev, aux)) {
+        /* malloc fail */
+        smedl_event_release(ev);
+        return 0;
+    }
+    return 1;
+}
+int raise_CandidateSelection_shouldrank(SMEDLValue *identities, SMEDLValue *params, void *aux) {
+    SMEDLEvent *ev = smedl_event_new(identities, 2, params, 1);
+    if (ev == NULL) {
+        /* malloc fail */
+        return 0;
+    }
+    /* Store on intra queue */
+    if (!push_global_shared(&intra_queue, CHANNEL_CanSys_ch6, ev, aux)) {
+        /* malloc fail */
+        smedl_event_release(ev);
+        return 0;
+    }
+    return 1;
+}
+int raise_CandidateSelection_addP(SMEDLValue *identities, SMEDLValue *params, void *aux) {
+    SMEDLEvent *ev = smedl_event_new(identities, 2, params, 0);
+    if (ev == NULL) {
+        /* malloc fail */
+        return 0;
+    }
+    /* Store on intra queue */
+    if (!push_global_shared(&intra_queue, CHANNEL_CanSys_ch8, ev, aux)) {
+        /* malloc fail */
+        smedl_event_release(ev);
+        return 0;
+    }
+    return 1;
+}
+int raise_CandidateSelection_result(SMEDLValue *identities, SMEDLValue *params, void *aux) {
+    SMEDLEvent *ev = smedl_event_new(identities, 2, params, 1);
+    if (ev == NULL) {
+        /* malloc fail */
+        return 0;
+    }
+    /* Store on intra queue */
+    if (!push_global_shared(&intra_queue, CHANNEL_CanSys_ch9, ev, aux)) {
+        /* malloc fail */
+        smedl_event_release(ev);
+        return 0;
+    }
+    return 1;
+}
+int raise_CollectV_addV(SMEDLValue *identities, SMEDLValue *params, void *aux) {
+    SMEDLEvent *ev = smedl_event_new(identities, 1, params, 0);
+    if (ev == NULL) {
+        /* malloc fail */
+        return 0;
+    }
+    /* Store on intra queue */
+    if (!push_global_shared(&intra_queue, CHANNEL_CanSys_ch10, ev, aux)) {
+        /* malloc fail */
+        smedl_event_release(ev);
+        return 0;
+    }
+    return 1;
+}
+int raise_CollectV_result(SMEDLValue *identities, SMEDLValue *params, void *aux) {
+    SMEDLEvent *ev = smedl_event_new(identities, 1, params, 1);
+    if (ev == NULL) {
+        /* malloc fail */
+        return 0;
+    }
+    /* Store on intra queue */
+    if (!push_global_shared(&intra_queue, CHANNEL_CanSys_ch11, ev, aux)) {
+        /* malloc fail */
+        smedl_event_release(ev);
+        return 0;
+    }
+    return 1;
+}
+int raise_Collect_result(SMEDLValue *identities, SMEDLValue *params, void *aux) {
+    SMEDLEvent *ev = smedl_event_new(identities, 0, params, 1);
+    if (ev == NULL) {
+        /* malloc fail */
+        return 0;
+    }
+    /* Store on inter queue */
+    if (!push_global_shared(&inter_queue, CHANNEL_CanSys_Collect_result, ev, aux)) {
+        /* malloc fail */
+        smedl_event_release(ev);
+        return 0;
+    }
+    return 1;
+}
+
+/* Global wrapper import interface - Called by the environment (other
+ * synchronous sets, the target system) to import events into this global
+ * wrapper. Each connection that this synchronous set receives has a separate
+ * function.
+ * Returns nonzero on success, zero on failure.
+ *
+ * Parameters:
+ * identities - An array of the source monitor's identities. If the connection
+ *   is from the target system, this parameter is ignored and can safely be set
+ *   to NULL.
+ * params - An array of the source event's parameters
+ * aux - Extra data to be passed through unchanged */
+
+int import_CanSys_ch1(SMEDLValue *identities, SMEDLValue *params, void *aux) {
+    int success = route_CanSys_ch1(identities, params, aux);
+    return handle_CanSys_queues() && success;
+}
+
+int import_CanSys_ch2(SMEDLValue *identities, SMEDLValue *params, void *aux) {
+    int success = route_CanSys_ch2(identities, params, aux);
+    return handle_CanSys_queues() && success;
+}
+
+int import_CanSys_ch3(SMEDLValue *identities, SMEDLValue *params, void *aux) {
+    int success = route_CanSys_ch3(identities, params, aux);
+    return handle_CanSys_queues() && success;
+}
+
+int import_CanSys_ch7(SMEDLValue *identities, SMEDLValue *params, void *aux) {
+    int success = route_CanSys_ch7(identities, params, aux);
+    return handle_CanSys_queues() && success;
+}
+
+/* Routing functions for the batch import interface, indexed by import
+ * channel */
+static const SMEDLCallback import_routes[] = {
+    [IMPORT_CanSys_ch1] = route_CanSys_ch1,
+    [IMPORT_CanSys_ch2] = route_CanSys_ch2,
+    [IMPORT_CanSys_ch3] = route_CanSys_ch3,
+    [IMPORT_CanSys_ch7] = route_CanSys_ch7,
+};
+
+int import_CanSys_batch(SMEDLImportEvent *events, size_t count) {
+    int success = 1;
+
+    for (size_t i = 0; i < count; i++) {
+        SMEDLImportEvent *ev = &events[i];
+        success = import_routes[ev->channel](ev->identities, ev->params,
+                ev->aux) && success;
+        /* Events raised within the synchronous set must be handled before
+         * the next import can observe their effects */
+        success = handle_CanSys_intra() && success;
+    }
+    return handle_CanSys_inter() && success;
+}
+
+/* Global wrapper callback interface - Used to register callback functions to be
+ * called by this global wrapper when it has an event to export to the
+ * environment (other synchronous sets, the target system).
+ *
+ * Parameters:
+ * cb_func - A function pointer for the callback to register, or NULL to
+ *   unregister a callback. Must accept three parameters: An array of SMEDLValue
+ *   for the source monitor's identities (or NULL if the source monitor has
+ *   none), another array of SMEDLValue for the source event's parameters, and
+ *   a void * for passthrough data. */
+
+void callback_CanSys_Collect_result(SMEDLCallback cb_func) {
+    cb_Collect_result = cb_func;
+}
+
+/* Global wrapper borrowed callback interface - Used to register callback
+ * functions to be called by this global wrapper when it has an event to export
+ * to the environment, passing the event itself instead of copies of its
+ * identities and params. When set, these are called instead of the callbacks
+ * registered above.
+ *
+ * Parameters:
+ * cb_func - A function pointer for the callback to register, or NULL to
+ *   unregister a callback. Must accept two parameters: The SMEDLEvent, which
+ *   is only borrowed for the duration of the call, and a void * for
+ *   passthrough data. */
+void callback_borrowed_CanSys_Collect_result(SMEDLBorrowCallback cb_func) {
+    bcb_Collect_result = cb_func;
+}
@@ -0,0 +1,143 @@
+#ifndef CanSys_GLOBAL_WRAPPER_H
+#define CanSys_GLOBAL_WRAPPER_H
+
+#include "smedl_types.h"
+#include "snapshot.h"
+
+/******************************************************************************
+ * External Interface                                                         *
+ ******************************************************************************/
+
+/* Initialization interface - Initialize the global wrapper. Must be called once
+ * before importing any events. Return nonzero on success, zero on failure. */
+int init_CanSys_syncset();
+
+/* Cleanup interface - Tear down and free the resources used by this global
+ * wrapper and all the local wrappers and monitors it manages. */
+void free_CanSys_syncset();
+
+/* Snapshot interface - Write the monitors of every local wrapper to the
+ * snapshot (see snapshot.h). Return nonzero on success, zero on failure. */
+int snapshot_CanSys_syncset(SMEDLSnapshotWriter *w);
+
+/* Restore interfaces - Reserve room in the restore block for the monitors of
+ * every local wrapper in the snapshot, then restore them, between
+ * smedl_restore_begin() and smedl_restore_end() (see snapshot.h). Return
+ * nonzero on success, zero on failure. */
+int reserve_CanSys_syncset(SMEDLSnapshot *snap);
+int restore_CanSys_syncset(SMEDLSnapshot *snap);
+
+/* Global wrapper export interfaces - Called by monitors to place exported
+ * events into the appropriate export queues, where they will later be routed to
+ * the proper destinations inside and outside the synchronous set.
+ * Returns nonzero on success, zero on failure.
+ *
+ * Parameters:
+ * identites - An array of SMEDLValue of the proper length for the exporting
+ *   monitor
+ * params - An array of SMEDLValue, one for each parameter of the exported event
+ * aux - Extra data that was passed from the imported event that caused this
+ *   exported event
+ */
+int raise_CandidateRank_valid(SMEDLValue *identities, SMEDLValue *params, void *aux);
+int raise_CandidateSelection_shouldrank(SMEDLValue *identities, SMEDLValue *params, void *aux);
+int raise_CandidateSelection_addP(SMEDLValue *identities, SMEDLValue *params, void *aux);
+int raise_CandidateSelection_result(SMEDLValue *identities, SMEDLValue *params, void *aux);
+int raise_CollectV_addV(SMEDLValue *identities, SMEDLValue *params, void *aux);
+int raise_CollectV_result(SMEDLValue *identities, SMEDLValue *params, void *aux);
+int raise_Collect_result(SMEDLValue *identities, SMEDLValue *params, void *aux);
+
+/* Global wrapper import interface - Called by the environment (other
+ * synchronous sets, the target system) to import events into this global
+ * wrapper. Each connection that this synchronous set receives has a separate
+ * function.
+ * Returns nonzero on success, zero on failure.
+ *
+ * Parameters:
+ * identities - An array of the source monitor's identities. If the connection
+ *   is from the target system, this parameter is ignored and can safely be set
+ *   to NULL.
+ * params - An array of the source event's parameters
+ * aux - Extra data to be passed through unchanged */
+int import_CanSys_ch1(SMEDLValue *identities, SMEDLValue *params, void *aux);
+int import_CanSys_ch2(SMEDLValue *identities, SMEDLValue *params, void *aux);
+int import_CanSys_ch3(SMEDLValue *identities, SMEDLValue *params, void *aux);
+int import_CanSys_ch7(SMEDLValue *identities, SMEDLValue *params, void *aux);
+
+/* Import channels for the batch import interface */
+typedef enum {
+    IMPORT_CanSys_ch1,
+    IMPORT_CanSys_ch2,
+    IMPORT_CanSys_ch3,
+    IMPORT_CanSys_ch7,
+} CanSysImportID;
+
+/* Global wrapper batch import interface - Called by the environment to import
+ * several events with one call. Events are routed in order. Events exported to
+ * the environment are queued and the export callbacks are called once, after
+ * the last event is routed.
+ * Any events a routed event raises within this synchronous set are handled
+ * before the next event is routed, since they may affect it.
+ * Returns nonzero on success, zero on failure.
+ *
+ * Parameters:
+ * events - An array of events. Each channel is a value from the import channel
+ *   enum above. identities, params, and aux are as for the single-event import
+ *   functions.
+ * count - The number of events in the array */
+int import_CanSys_batch(SMEDLImportEvent *events, size_t count);
+
+/* Global wrapper callback interface - Used to register callback functions to be
+ * called by this global wrapper when it has an event to export to the
+ * environment (other synchronous sets, the target system).
+ *
+ * Parameters:
+ * cb_func - A function pointer for the callback to register, or NULL to
+ *   unregister a callback. Must accept three parameters: An array of SMEDLValue
+ *   for the source monitor's identities (or NULL if the source monitor has
+ *   none), another array of SMEDLValue for the source event's parameters, and
+ *   a void * for passthrough data. */
+void callback_CanSys_Collect_result(SMEDLCallback cb_func);
+
+/* Global wrapper borrowed callback interface - Used to register callback
+ * functions to be called by this global wrapper when it has an event to export
+ * to the environment, passing the event itself instead of copies of its
+ * identities and params. When set, these are called instead of the callbacks
+ * registered above.
+ *
+ * Parameters:
+ * cb_func - A function pointer for the callback to register, or NULL to
+ *   unregister a callback. Must accept two parameters: The SMEDLEvent, which
+ *   is only borrowed for the duration of the call, and a void * for
+ *   passthrough data. */
+void callback_borrowed_CanSys_Collect_result(SMEDLBorrowCallback cb_func);
+
+/******************************************************************************
+ * End of External Interface                                                  *
+ ******************************************************************************/
+
+typedef enum {
+    CHANNEL_CanSys_Collect_result,
+    CHANNEL_CanSys_ch5,
+    CHANNEL_CanSys_ch6,
+    CHANNEL_CanSys_ch8,
+    CHANNEL_CanSys_ch9,
+    CHANNEL_CanSys_ch10,
+    CHANNEL_CanSys_ch11,
+} CanSysChannelID;
+
+/* Intra routing functions - Called by import interface functions and intra
+ * queue processing function to route events to the local wrappers.
+ * Return nonzero on success, zero on failure. */
+int route_CanSys_ch1(SMEDLValue *identities, SMEDLValue *params, void *aux);
+int route_CanSys_ch2(SMEDLValue *identities, SMEDLValue *params, void *aux);
+int route_CanSys_ch3(SMEDLValue *identities, SMEDLValue *params, void *aux);
+int route_CanSys_ch7(SMEDLValue *identities, SMEDLValue *params, void *aux);
+int route_CanSys_ch5(SMEDLValue *identities, SMEDLValue *params, void *aux);
+int route_CanSys_ch6(SMEDLValue *identities, SMEDLValue *params, void *aux);
+int route_CanSys_ch8(SMEDLValue *identities, SMEDLValue *params, void *aux);
+int route_CanSys_ch9(SMEDLValue *identities, SMEDLValue *params, void *aux);
+int route_CanSys_ch10(SMEDLValue *identities, SMEDLValue *params, void *aux);
+int route_CanSys_ch11(SMEDLValue *identities, SMEDLValue *params, void *aux);
+
+#endif /* CanSys_GLOBAL_WRAPPER_H */
@@ -0,0 +1,99 @@
+/* Unity build of the CanSys system ("make unity"): all of its source files in
+ * one translation unit, so that the compiler can inline across them. The
+ * local wrappers call their monitor maps' hash and equals functions directly
+ * (see MONITORMAP_LOOKUP() in monitor_map.h), and the monitors call the global
+ * wrapper's export functions directly (see CALLBACKS() in the *_mon.c
+ * files). */
+
+/* The feature test macros of all the files, which must come before any
+ * system header */
+#define _GNU_SOURCE
+#define SMEDL_UNITY
+
+/* First, since it includes the implementation of jsmn.h, which the other files
+ * include (through json.h) for the declarations only */
+#include "json.c"
+#include "smedl_types.c"
+#include "event_queue.c"
+#include "monitor_map.c"
+#include "global_event_queue.c"
+#include "file.c"
+#include "trace_reader.c"
+#include "event_codec.c"
+#include "shm_ring.c"
+#include "server.c"
+#include "latency.c"
+#include "telemetry.c"
+#include "profile.c"
+#include "memstats.c"
+#include "snapshot.c"
+#include "spill.c"
+#include "CanSys_file.c"
+
+/* Called directly by the monitors' export functions */
+#include "CanSys_global_wrapper.h"
+
+/* The files of each monitor use the same names for their static variables
+ * and functions, so they are prefixed with the monitor's name */
+
+#define shared_callbacks CandidateSelection_shared_callbacks
+#include "CandidateSelection_mon.c"
+#undef shared_callbacks
+
+#define shared_callbacks CandidateRank_shared_callbacks
+#include "CandidateRank_mon.c"
+#undef shared_callbacks
+
+#define shared_callbacks CollectV_shared_callbacks
+#include "CollectV_mon.c"
+#undef shared_callbacks
+
+#define shared_callbacks Collect_shared_callbacks
+#include "Collect_mon.c"
+#undef shared_callbacks
+
+#define monitor_map_all CandidateSelection_monitor_map_all
+#define dynamic_count CandidateSelection_dynamic_count
+#define created_count CandidateSelection_created_count
+#define recycled_count CandidateSelection_recycled_count
+#define hash_all CandidateSelection_hash_all
+#define equals_all CandidateSelection_equals_all
+#include "CandidateSelection_local_wrapper.c"
+#undef monitor_map_all
+#undef dynamic_count
+#undef created_count
+#undef recycled_count
+#undef hash_all
+#undef equals_all
+
+#define monitor_map_all CandidateRank_monitor_map_all
+#define dynamic_count CandidateRank_dynamic_count
+#define created_count CandidateRank_created_count
+#define recycled_count CandidateRank_recycled_count
+#define hash_all CandidateRank_hash_all
+#define equals_all CandidateRank_equals_all
+#include "CandidateRank_local_wrapper.c"
+#undef monitor_map_all
+#undef dynamic_count
+#undef created_count
+#undef recycled_count
+#undef hash_all
+#undef equals_all
+
+#define monitor_map_all CollectV_monitor_map_all
+#define dynamic_count CollectV_dynamic_count
+#define created_count CollectV_created_count
+#define recycled_count CollectV_recycled_count
+#define hash_all CollectV_hash_all
+#define equals_all CollectV_equals_all
+#include "CollectV_local_wrapper.c"
+#undef monitor_map_all
+#undef dynamic_count
+#undef created_count
+#undef recycled_count
+#undef hash_all
+#undef equals_all
+
+#include "Collect_local_wrapper.c"
+
+#include "CanSys_global_wrapper.c"
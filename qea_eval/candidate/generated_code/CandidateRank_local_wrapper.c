@@ -6,7 +6,8 @@
 #include <string.h>
 #include "smedl_types.h"
 #include "monitor_map.h"
-#include "CandidateRank_global_wrapper.h"
+#include "profile.h"
+#include "CanSys_global_wrapper.h"
 #include "CandidateRank_local_wrapper.h"
 #include "CandidateRank_mon.h"
 
@@ -32,58 +33,114 @@
 static MonitorMap monitor_map_0_1;
 static MonitorMap monitor_map_all;
 
+/* Population counters for the stats interface */
+static uint64_t dynamic_count, created_count, recycled_count;
+
 /* Monitor map hash functions - One for each monitor map */
 
-static uint64_t hash_0_1(SMEDLValue *ids) {
+static uint64_t hash_0_1(const void *key) {
+    const CandidateRankIdentities *ids = key;
     murmur_state s = MURMUR_INIT(0);
-    murmur(ids[0].v.s, strlen(ids[0].v.s), &s);
-    murmur(ids[1].v.s, strlen(ids[1].v.s), &s);
+    murmur(ids->id0, strlen(ids->id0), &s);
+    murmur(ids->id1, strlen(ids->id1), &s);
     return murmur_f(&s);
 }
 
-static uint64_t hash_all(SMEDLValue *ids) {
+static uint64_t hash_all(const void *key) {
+    const CandidateRankIdentities *ids = key;
     murmur_state s = MURMUR_INIT(0);
-    murmur(ids[0].v.s, strlen(ids[0].v.s), &s);
-    murmur(ids[1].v.s, strlen(ids[1].v.s), &s);
-    murmur(ids[2].v.s, strlen(ids[2].v.s), &s);
+    murmur(ids->id0, strlen(ids->id0), &s);
+    murmur(ids->id1, strlen(ids->id1), &s);
+    murmur(ids->id2, strlen(ids->id2), &s);
     return murmur_f(&s);
 }
 
 /* Monitor map equals functions - One for each monitor map */
 
-static int equals_0_1(SMEDLValue *ids1, SMEDLValue *ids2) {
-    if (strcmp(ids1[0].v.s, ids2[0].v.s)) {
+static int equals_0_1(const void *key1, const void *key2) {
+    const CandidateRankIdentities *ids1 = key1, *ids2 = key2;
+    if (strcmp(ids1->id0, ids2->id0)) {
         return 0;
     }
-    if (strcmp(ids1[1].v.s, ids2[1].v.s)) {
+    if (strcmp(ids1->id1, ids2->id1)) {
         return 0;
     }
     return 1;
 }
 
-static int equals_all(SMEDLValue *ids1, SMEDLValue *ids2) {
-    if (strcmp(ids1[0].v.s, ids2[0].v.s)) {
+static int equals_all(const void *key1, const void *key2) {
+    const CandidateRankIdentities *ids1 = key1, *ids2 = key2;
+    if (strcmp(ids1->id0, ids2->id0)) {
         return 0;
     }
-    if (strcmp(ids1[1].v.s, ids2[1].v.s)) {
+    if (strcmp(ids1->id1, ids2->id1)) {
         return 0;
     }
-    if (strcmp(ids1[2].v.s, ids2[2].v.s)) {
+    if (strcmp(ids1->id2, ids2->id2)) {
         return 0;
     }
     return 1;
 }
 
-/* Register the global wrapper's export callbacks with the monitor */
-static void setup_CandidateRank_callbacks(CandidateRankMonitor *mon) {
-    register_CandidateRank_valid(mon, raise_CandidateRank_valid);
-    registercleanup_CandidateRank(mon, recycle_CandidateRank_monitor);
+/* Identity conversion - Fill in an identity tuple from an array of SMEDLValue
+ * as given to the import interfaces. Wildcard identities are left as they
+ * are in the array; lookups with wildcards use monitor maps that ignore them.
+ * Strings are borrowed, not copied. */
+static void load_CandidateRank_ids(CandidateRankIdentities *ids, SMEDLValue *identities) {
+    ids->id0 = identities[0].v.s;
+    ids->id1 = identities[1].v.s;
+    ids->id2 = identities[2].v.s;
+}
+
+/* Free the strings owned by an identity tuple */
+static void free_CandidateRank_ids(CandidateRankIdentities *ids) {
+    SMEDL_FREE_OBJECT(&CandidateRank_memory, SMEDL_MEM_IDENTITY, ids->id0);
+    SMEDL_FREE_OBJECT(&CandidateRank_memory, SMEDL_MEM_IDENTITY, ids->id1);
+    SMEDL_FREE_OBJECT(&CandidateRank_memory, SMEDL_MEM_IDENTITY, ids->id2);
+}
+
+/* Replace the strings borrowed by load_CandidateRank_ids() with copies that a
+ * monitor can own. Return nonzero on success, zero on malloc failure. */
+static int copy_CandidateRank_ids(CandidateRankIdentities *ids) {
+    CandidateRankIdentities copy = {0};
+    if (!smedl_assign_string(&copy.id0, ids->id0)) {
+        goto fail;
+    }
+    SMEDL_MEM_ADOPT(&CandidateRank_memory, SMEDL_MEM_IDENTITY, copy.id0);
+    if (!smedl_assign_string(&copy.id1, ids->id1)) {
+        goto fail;
+    }
+    SMEDL_MEM_ADOPT(&CandidateRank_memory, SMEDL_MEM_IDENTITY, copy.id1);
+    if (!smedl_assign_string(&copy.id2, ids->id2)) {
+        goto fail;
+    }
+    SMEDL_MEM_ADOPT(&CandidateRank_memory, SMEDL_MEM_IDENTITY, copy.id2);
+    *ids = copy;
+    return 1;
+
+fail:
+    free_CandidateRank_ids(&copy);
+    return 0;
+}
+
+/* Register the global wrapper's export callbacks in the callback table shared
+ * by all CandidateRank monitors */
+static void setup_CandidateRank_callbacks() {
+    CandidateRankCallbacks callbacks = {
+        .callback_valid = raise_CandidateRank_valid,
+        .cleanup = recycle_CandidateRank_monitor,
+    };
+    registershared_CandidateRank(&callbacks);
 }
 
 /* Initialization interface - Initialize the local wrapper. Must be called once
  * before creating any monitors or importing any events.
  * Return nonzero on success, zero on failure. */
 int init_CandidateRank_local_wrapper() {
+    /* Count the monitor maps with the monitors (see memstats.h) */
+    SMEDL_MEM_REGISTER(&CandidateRank_memory);
+    monitor_map_0_1.account = &CandidateRank_memory;
+    monitor_map_all.account = &CandidateRank_memory;
     if (!monitormap_init(&monitor_map_0_1, offsetof(CandidateRankMonitor, identities), hash_0_1, equals_0_1)) {
         goto fail_init_monitor_map_0_1;
     }
@@ -91,6 +148,8 @@ int init_CandidateRank_local_wrapper() {
         goto fail_init_monitor_map_all;
     }
 
+    setup_CandidateRank_callbacks();
+
     return 1;
 
 fail_init_monitor_map_all:
@@ -107,13 +166,95 @@ void free_CandidateRank_local_wrapper() {
 
     while (instances != NULL) {
         MonitorInstance *tmp = instances->next;
-        smedl_free_array(((CandidateRankMonitor *) instances->mon)->identities, 3);
+        free_CandidateRank_ids(&((CandidateRankMonitor *) instances->mon)->identities);
         free_CandidateRank_monitor(instances->mon);
-        free(instances);
+        SMEDL_FREE_OBJECT(&CandidateRank_memory, SMEDL_MEM_MAP_INSTANCE, instances);
         instances = tmp;
     }
 }
 
+/* Count interface - Return the number of live CandidateRank monitors */
+size_t count_CandidateRank_monitors() {
+    return monitor_map_all.count;
+}
+
+/* Stats interface - Fill in the population of CandidateRank monitors and the
+ * health of its monitor maps */
+void stats_CandidateRank_monitors(MonitorStats *stats) {
+    stats->live = monitor_map_all.count;
+    stats->spilled = 0;
+    stats->dynamic = dynamic_count;
+    stats->created = created_count;
+    stats->recycled = recycled_count;
+    stats->map_count = 2;
+    stats->maps[0].name = "0_1";
+    monitormap_stats(&monitor_map_0_1, &stats->maps[0].stats);
+    stats->maps[1].name = "all";
+    monitormap_stats(&monitor_map_all, &stats->maps[1].stats);
+}
+
+/* Bytes in the snapshot record of a CandidateRank monitor: its identities, then
+ * its scenario states and state variables */
+#define CandidateRank_RECORD_SIZE (3 * SMEDL_SNAPSHOT_STRING + CandidateRank_SNAPSHOT_SIZE)
+
+/* Snapshot interface - Write the section for CandidateRank monitors to the snapshot
+ * (see snapshot.h). Return nonzero on success, zero on failure. */
+int snapshot_CandidateRank_monitors(SMEDLSnapshotWriter *w) {
+    smedl_snapshot_begin(w, "CandidateRank", CandidateRank_RECORD_SIZE, monitor_map_all.count,
+            dynamic_count, created_count, recycled_count);
+    for (size_t i = 0; i < monitor_map_all.capacity; i++) {
+        if (monitor_map_all.table[i].dib == 0) {
+            continue;
+        }
+        for (MonitorInstance *inst = monitor_map_all.table[i].head; inst != NULL; inst = inst->next) {
+            CandidateRankMonitor *mon = inst->mon;
+            smedl_snapshot_put_string(w, mon->identities.id0);
+            smedl_snapshot_put_string(w, mon->identities.id1);
+            smedl_snapshot_put_string(w, mon->identities.id2);
+            snapshot_CandidateRank_monitor(mon, w);
+        }
+    }
+    return smedl_snapshot_end(w);
+}
+
+/* Restore interfaces - Reserve room in the restore block for the CandidateRank
+ * monitors in the snapshot, then restore them. Return nonzero on success,
+ * zero on failure. */
+int reserve_CandidateRank_monitors(SMEDLSnapshot *snap) {
+    return smedl_restore_reserve(snap, "CandidateRank", CandidateRank_RECORD_SIZE, sizeof(CandidateRankMonitor), 2);
+}
+
+int restore_CandidateRank_monitors(SMEDLSnapshot *snap) {
+    const SMEDLSnapshotSection *section = smedl_snapshot_section(snap, "CandidateRank", CandidateRank_RECORD_SIZE);
+    if (section == NULL) {
+        return 0;
+    }
+    if (!monitormap_reserve(&monitor_map_all, section->count)) {
+        return 0;
+    }
+    for (uint64_t i = 0; i < section->count; i++) {
+        /* The monitor struct and map nodes come from the restore block. Identity strings point
+     * into the restore block. */
+        CandidateRankIdentities ids;
+        ids.id0 = smedl_snapshot_get_string(snap);
+        ids.id1 = smedl_snapshot_get_string(snap);
+        ids.id2 = smedl_snapshot_get_string(snap);
+        CandidateRankMonitor *mon = init_CandidateRank_monitor(&ids);
+        if (mon == NULL) {
+            return 0;
+        }
+        restore_CandidateRank_monitor(mon, snap);
+        if (add_CandidateRank_monitor(mon) == NULL) {
+            free_CandidateRank_monitor(mon);
+            return 0;
+        }
+    }
+    dynamic_count = section->dynamic;
+    created_count = section->created;
+    recycled_count = section->recycled;
+    return !snap->error;
+}
+
 /* Creation interface - Instantiate a new CandidateRank monitor.
  * Return nonzero on success or if monitor already exists, zero on failure.
  *
@@ -125,8 +266,11 @@ void free_CandidateRank_local_wrapper() {
  *   state can be retrieved with default_CandidateRank_state()
  *   and then just the desired variables can be updated. */
 int create_CandidateRank_monitor(SMEDLValue *identities, CandidateRankState *init_state) {
+    CandidateRankIdentities ids;
+    load_CandidateRank_ids(&ids, identities);
+
     /* Check if monitor with identities already exists */
-    if (monitormap_lookup(&monitor_map_all, identities) != NULL) {
+    if (MONITORMAP_LOOKUP(&monitor_map_all, &ids, hash_all, equals_all) != NULL) {
 #if DEBUG >= 4
         fprintf(stderr, "Local wrapper 'CandidateRank' skipping explicit creation for existing monitor\n");
 #endif
@@ -137,26 +281,25 @@ int create_CandidateRank_monitor(SMEDLValue *identities, CandidateRankState *ini
 #endif
 
     /* Initialize new monitor with identities and state */
-    SMEDLValue *ids_copy = smedl_copy_array(identities, 3);
-    if (ids_copy == NULL) {
+    if (!copy_CandidateRank_ids(&ids)) {
         /* malloc fail */
         return 0;
     }
-    CandidateRankMonitor *mon = init_CandidateRank_with_state(ids_copy, init_state);
+    CandidateRankMonitor *mon = init_CandidateRank_with_state(&ids, init_state);
     if (mon == NULL) {
         /* malloc fail */
-        smedl_free_array(ids_copy, 3);
+        free_CandidateRank_ids(&ids);
         return 0;
     }
-    setup_CandidateRank_callbacks(mon);
 
     /* Store monitor in maps */
     if (add_CandidateRank_monitor(mon) == NULL) {
         /* malloc fail */
         free_CandidateRank_monitor(mon);
-        smedl_free_array(ids_copy, 3);
+        free_CandidateRank_ids(&ids);
         return 0;
     }
+    created_count++;
     return 1;
 }
 
@@ -176,7 +319,9 @@ int process_CandidateRank_shouldrank(SMEDLValue *identities, SMEDLValue *params,
 #endif
     /* Fetch the monitors to send the event to or do dynamic instantiation if
      * necessary */
-    MonitorInstance *instances = get_CandidateRank_monitors(identities);
+    SMEDL_PROFILE_PUSH(SMEDL_PROFILE_STAGE_LOOKUP);
+    MonitorInstance *instances = get_CandidateRank_monitors(identities, 1);
+    SMEDL_PROFILE_POP();
     if (instances == INVALID_INSTANCE) {
         /* malloc fail */
         return 0;
@@ -187,9 +332,11 @@ int process_CandidateRank_shouldrank(SMEDLValue *identities, SMEDLValue *params,
     while (instances != NULL) {
         CandidateRankMonitor *mon = instances->mon;
         instances = instances->next;
+        SMEDL_PROFILE_PUSH(SMEDL_PROFILE_STAGE_EXECUTE);
         if (!execute_CandidateRank_shouldrank(mon, params, aux)) {
             success = 0;
         }
+        SMEDL_PROFILE_POP();
     }
     return success;
 }
@@ -198,9 +345,11 @@ int process_CandidateRank_rank(SMEDLValue *identities, SMEDLValue *params, void
 #if DEBUG >= 4
     fprintf(stderr, "Local wrapper 'CandidateRank' processing event 'rank'\n");
 #endif
-    /* Fetch the monitors to send the event to or do dynamic instantiation if
-     * necessary */
-    MonitorInstance *instances = get_CandidateRank_monitors(identities);
+    /* Fetch the monitors to send the event to. 'rank' is not a creation
+     * event, so no dynamic instantiation is done */
+    SMEDL_PROFILE_PUSH(SMEDL_PROFILE_STAGE_LOOKUP);
+    MonitorInstance *instances = get_CandidateRank_monitors(identities, 0);
+    SMEDL_PROFILE_POP();
     if (instances == INVALID_INSTANCE) {
         /* malloc fail */
         return 0;
@@ -211,9 +360,11 @@ int process_CandidateRank_rank(SMEDLValue *identities, SMEDLValue *params, void
     while (instances != NULL) {
         CandidateRankMonitor *mon = instances->mon;
         instances = instances->next;
+        SMEDL_PROFILE_PUSH(SMEDL_PROFILE_STAGE_EXECUTE);
         if (!execute_CandidateRank_rank(mon, params, aux)) {
             success = 0;
         }
+        SMEDL_PROFILE_POP();
     }
     return success;
 }
@@ -225,8 +376,9 @@ int recycle_CandidateRank_monitor(CandidateRankMonitor *mon) {
         fprintf(stderr, "Recycling an instance of 'CandidateRank'\n");
 #endif
     monitormap_remove(&monitor_map_all, mon);
-    smedl_free_array(mon->identities, 3);
+    free_CandidateRank_ids(&mon->identities);
     free_CandidateRank_monitor(mon);
+    recycled_count++;
     return 1;
 }
 
@@ -237,14 +389,14 @@ MonitorInstance * add_CandidateRank_monitor(CandidateRankMonitor *mon) {
     MonitorMap *prev_map = NULL;
     MonitorInstance *inst;
 
-    inst = monitormap_insert(&monitor_map_0_1, mon, prev_inst, prev_map);
+    inst = MONITORMAP_INSERT(&monitor_map_0_1, mon, prev_inst, prev_map, hash_0_1, equals_0_1);
     if (inst == NULL) {
         return NULL;
     }
     prev_inst = inst;
     prev_map = &monitor_map_0_1;
 
-    inst = monitormap_insert(&monitor_map_all, mon, prev_inst, prev_map);
+    inst = MONITORMAP_INSERT(&monitor_map_all, mon, prev_inst, prev_map, hash_all, equals_all);
     if (inst == NULL) {
         monitormap_removeinst(prev_map, prev_inst);
         return NULL;
@@ -260,19 +412,25 @@ MonitorInstance * add_CandidateRank_monitor(CandidateRankMonitor *mon) {
  *
  * If there are no matching monitor instances but the identity list is fully
  * specified (i.e. there are no wildcards), create an instance with those
- * identities and return it.
+ * identities and return it. This is only done when create is nonzero, i.e.
+ * for creation events: events with a transition out of the initial state of
+ * at least one scenario. An instance created by any other event could never
+ * leave its initial states, so the event is simply dropped.
  *
  * Returns a linked list of MonitorInstance (which may be empty, i.e. NULL).
  * If dynamic instantiation fails, returns INVALID_INSTANCE. */
-MonitorInstance * get_CandidateRank_monitors(SMEDLValue *identities) {
+MonitorInstance * get_CandidateRank_monitors(SMEDLValue *identities, int create) {
+    CandidateRankIdentities ids;
+    load_CandidateRank_ids(&ids, identities);
+
     /* Look up from the proper monitor map */
     MonitorInstance *instances;
     int dynamic_instantiation = 0;
     if (identities[2].t == SMEDL_NULL) {
-        instances = monitormap_lookup(&monitor_map_0_1, identities);
+        instances = MONITORMAP_LOOKUP(&monitor_map_0_1, &ids, hash_0_1, equals_0_1);
     } else {
-        instances = monitormap_lookup(&monitor_map_all, identities);
-        dynamic_instantiation = 1;
+        instances = MONITORMAP_LOOKUP(&monitor_map_all, &ids, hash_all, equals_all);
+        dynamic_instantiation = create;
     }
 
     /* Do dynamic instantiation if wildcards were fully specified and there
@@ -281,25 +439,24 @@ MonitorInstance * get_CandidateRank_monitors(SMEDLValue *identities) {
 #if DEBUG >= 4
         fprintf(stderr, "Dynamic instantiation for 'CandidateRank'\n");
 #endif
-        SMEDLValue *ids_copy = smedl_copy_array(identities, 3);
-        if (ids_copy == NULL) {
+        if (!copy_CandidateRank_ids(&ids)) {
             /* malloc fail */
             return INVALID_INSTANCE;
         }
-        CandidateRankMonitor *mon = init_CandidateRank_monitor(ids_copy);
+        CandidateRankMonitor *mon = init_CandidateRank_monitor(&ids);
         if (mon == NULL) {
             /* malloc fail */
-            smedl_free_array(ids_copy, 3);
+            free_CandidateRank_ids(&ids);
             return INVALID_INSTANCE;
         }
-        setup_CandidateRank_callbacks(mon);
         instances = add_CandidateRank_monitor(mon);
         if (instances == NULL) {
             /* malloc fail */
             free_CandidateRank_monitor(mon);
-            smedl_free_array(ids_copy, 3);
+            free_CandidateRank_ids(&ids);
             return INVALID_INSTANCE;
         }
+        dynamic_count++;
     }
 
     return instances;
@@ -7,18 +7,70 @@
 #include "event_queue.h"
 #include "CandidateRank_mon.h"
 
+/* Memory counted for CandidateRank monitors */
+SMEDLMemAccount CandidateRank_memory = {"CandidateRank"};
+
+/* Callback table shared by all CandidateRank monitors without their own */
+static CandidateRankCallbacks shared_callbacks;
+
+/* The callback table in effect for a monitor. In a unity build, the export
+ * functions call the global wrapper's raise_*() functions directly for
+ * monitors without a table of their own, since those are the shared callbacks
+ * the local wrapper registers. */
+#define CALLBACKS(mon) ((mon)->callbacks != NULL ? (mon)->callbacks : &shared_callbacks)
+
+/* Convert the monitor's identities to an array of SMEDLValue for the export
+ * callbacks */
+static void get_CandidateRank_id_values(CandidateRankMonitor *mon, SMEDLValue *values) {
+    values[0].t = SMEDL_STRING;
+    values[0].v.s = mon->identities.id0;
+    values[1].t = SMEDL_STRING;
+    values[1].v.s = mon->identities.id1;
+    values[2].t = SMEDL_STRING;
+    values[2].v.s = mon->identities.id2;
+}
+
+/* Shared callback registration function - Set the callback table used by all
+ * CandidateRank monitors that have not registered callbacks of their own */
+void registershared_CandidateRank(const CandidateRankCallbacks *callbacks) {
+    shared_callbacks = *callbacks;
+}
+
+/* Give the monitor its own copy of the shared callback table so its callbacks
+ * can be changed without affecting other monitors. Return nonzero on success,
+ * zero on malloc failure. */
+static int own_CandidateRank_callbacks(CandidateRankMonitor *mon) {
+    if (mon->callbacks == NULL) {
+        mon->callbacks = SMEDL_MALLOC(&CandidateRank_memory, SMEDL_MEM_CALLBACKS,
+                sizeof(CandidateRankCallbacks));
+        if (mon->callbacks == NULL) {
+            return 0;
+        }
+        *mon->callbacks = shared_callbacks;
+    }
+    return 1;
+}
+
 /* Callback registration functions - Set the export callback for an exported
- * event */
+ * event on a single monitor */
 
-void register_CandidateRank_valid(CandidateRankMonitor *mon, SMEDLCallback cb_func) {
-    mon->callback_valid = cb_func;
+int register_CandidateRank_valid(CandidateRankMonitor *mon, SMEDLCallback cb_func) {
+    if (!own_CandidateRank_callbacks(mon)) {
+        return 0;
+    }
+    mon->callbacks->callback_valid = cb_func;
+    return 1;
 }
 
 /* Cleanup callback registration function - Set the callback for when the
  * monitor is ready to be recycled. The callback is responsible for calling
  * free_CandidateRank_monitor(). */
-void registercleanup_CandidateRank(CandidateRankMonitor *mon, int (*cleanup_func)(CandidateRankMonitor *mon)) {
-    mon->cleanup = cleanup_func;
+int registercleanup_CandidateRank(CandidateRankMonitor *mon, int (*cleanup_func)(CandidateRankMonitor *mon)) {
+    if (!own_CandidateRank_callbacks(mon)) {
+        return 0;
+    }
+    mon->callbacks->cleanup = cleanup_func;
+    return 1;
 }
 
 /* Queue processing function - Call the handlers for all the events in the
@@ -30,6 +82,13 @@ static int handle_CandidateRank_queue(CandidateRankMonitor *mon) {
     SMEDLValue *params;
     void *aux;
 
+    /* Scenario execution flags only guard events raised within a macro-step.
+     * If nothing was raised, there is nothing to handle and no flags to
+     * reset. */
+    if (mon->event_queue.head == NULL) {
+        return 1;
+    }
+
     while (pop_event(&mon->event_queue, &event, &params, &aux)) {
         switch (event) {
             case EVENT_CandidateRank_valid:
@@ -157,8 +216,18 @@ int queue_CandidateRank_valid(CandidateRankMonitor *mon, SMEDLValue *params, voi
 }
 
 int export_CandidateRank_valid(CandidateRankMonitor *mon, SMEDLValue *params, void *aux) {
-    if (mon->callback_valid != NULL) {
-        return (mon->callback_valid)(mon->identities, params, aux);
+#ifdef SMEDL_UNITY
+    if (mon->callbacks == NULL) {
+        SMEDLValue identities[3];
+        get_CandidateRank_id_values(mon, identities);
+        return raise_CandidateRank_valid(identities, params, aux);
+    }
+#endif
+    SMEDLCallback cb_func = CALLBACKS(mon)->callback_valid;
+    if (cb_func != NULL) {
+        SMEDLValue identities[3];
+        get_CandidateRank_id_values(mon, identities);
+        return cb_func(identities, params, aux);
     }
     return 1;
 }
@@ -169,7 +238,7 @@ int export_CandidateRank_valid(CandidateRankMonitor *mon, SMEDLValue *params, vo
  * Return a pointer to the monitor. Must be freed with
  * free_CandidateRank_monitor() when no longer needed.
  * Returns NULL on malloc failure. */
-CandidateRankMonitor * init_CandidateRank_monitor(SMEDLValue *identities) {
+CandidateRankMonitor * init_CandidateRank_monitor(CandidateRankIdentities *identities) {
     CandidateRankState init_state;
 
     /* Initialize the monitor with default state */
@@ -204,14 +273,15 @@ int default_CandidateRank_state(CandidateRankState *state) {
  * Return a pointer to the monitor. Must be freed with
  * free_CandidateRank_monitor() when no longer needed.
  * Returns NULL on malloc failure. */
-CandidateRankMonitor * init_CandidateRank_with_state(SMEDLValue *identities, CandidateRankState *init_state) {
-    CandidateRankMonitor *mon = malloc(sizeof(CandidateRankMonitor));
+CandidateRankMonitor * init_CandidateRank_with_state(CandidateRankIdentities *identities, CandidateRankState *init_state) {
+    CandidateRankMonitor *mon = SMEDL_ALLOC_OBJECT(&CandidateRank_memory, SMEDL_MEM_MONITOR,
+            sizeof(CandidateRankMonitor));
     if (mon == NULL) {
         return NULL;
     }
 
     /* Store the assigned identities */
-    mon->identities = identities;
+    mon->identities = *identities;
 
     /* Copy initial state vars in */
     mon->s = *init_state;
@@ -222,8 +292,8 @@ CandidateRankMonitor * init_CandidateRank_with_state(SMEDLValue *identities, Can
     /* Reset all scenario execution flags */
     memset(&mon->ef, 0, sizeof(mon->ef));
 
-    /* Set all export callbacks to NULL */
-    mon->callback_valid = NULL;
+    /* Use the shared callback table */
+    mon->callbacks = NULL;
 
     /* Initialize event queue */
     mon->event_queue = (EventQueue){0};
@@ -233,5 +303,18 @@ CandidateRankMonitor * init_CandidateRank_with_state(SMEDLValue *identities, Can
 
 /* Free a CandidateRank monitor */
 void free_CandidateRank_monitor(CandidateRankMonitor *mon) {
-    free(mon);
+    SMEDL_FREE(&CandidateRank_memory, SMEDL_MEM_CALLBACKS, mon->callbacks);
+    SMEDL_FREE_OBJECT(&CandidateRank_memory, SMEDL_MEM_MONITOR, mon);
+}
+
+/* Append the monitor's scenario states and state variables to its snapshot
+ * record */
+void snapshot_CandidateRank_monitor(CandidateRankMonitor *mon, SMEDLSnapshotWriter *w) {
+    smedl_snapshot_put_state(w, mon->sce_state);
+}
+
+/* Get the monitor's scenario states and state variables back from its
+ * snapshot record */
+void restore_CandidateRank_monitor(CandidateRankMonitor *mon, SMEDLSnapshot *snap) {
+    mon->sce_state = smedl_snapshot_get_state(snap);
 }
@@ -3,6 +3,11 @@
 
 #include "smedl_types.h"
 #include "event_queue.h"
+#include "memstats.h"
+#include "snapshot.h"
+
+/* Memory counted for CandidateRank monitors (see memstats.h) */
+extern SMEDLMemAccount CandidateRank_memory;
 
 /* Internal/exported event enum for action queues */
 typedef enum {
@@ -22,14 +27,33 @@ typedef enum {
 typedef struct CandidateRankState {
 } CandidateRankState;
 
+/* Identities of a CandidateRank monitor.
+ * Stored inline in the CandidateRankMonitor struct. They are only converted to
+ * an array of SMEDLValue at the import and export interfaces. */
+typedef struct CandidateRankIdentities {
+    char *id0;
+    char *id1;
+    char *id2;
+} CandidateRankIdentities;
+
+/* Callback table for CandidateRank monitors.
+ * Holds the exported event callbacks and the cleanup callback. One table is
+ * shared by all CandidateRank monitors; a monitor only gets its own copy once one of
+ * its callbacks is registered individually. */
+struct CandidateRankMonitor;
+typedef struct CandidateRankCallbacks {
+    SMEDLCallback callback_valid;
+    int (*cleanup)(struct CandidateRankMonitor *mon);
+} CandidateRankCallbacks;
+
 /* CandidateRank monitor struct.
  * Maintains all of the internal state for the monitor. */
 typedef struct CandidateRankMonitor {
-    /* Array of monitor's identities */
-    SMEDLValue *identities;
+    /* Monitor's identities */
+    CandidateRankIdentities identities;
 
-    /* Scenario states */
-    CandidateRank_sce_State sce_state;
+    /* Scenario states (CandidateRank_*_State values, one byte each) */
+    unsigned char sce_state;
 
     /* Scenario execution flags (ensures each scenario only processes one event
      * per macro-step) */
@@ -40,11 +64,9 @@ typedef struct CandidateRankMonitor {
     /* State variables */
     CandidateRankState s;
 
-    /* Exported event callback pointers */
-    SMEDLCallback callback_valid;
-
-    /* Cleanup callback pointer */
-    int (*cleanup)(struct CandidateRankMonitor *mon);
+    /* Callback table, or NULL to use the table shared by all CandidateRank
+     * monitors */
+    CandidateRankCallbacks *callbacks;
 
     /* Local event queue */
     EventQueue event_queue;
@@ -52,15 +74,23 @@ typedef struct CandidateRankMonitor {
     //TODO mutex?
 } CandidateRankMonitor;
 
+/* Shared callback registration function - Set the callback table used by all
+ * CandidateRank monitors that have not registered callbacks of their own. The
+ * table is copied. */
+void registershared_CandidateRank(const CandidateRankCallbacks *callbacks);
+
 /* Callback registration functions - Set the export callback for an exported
- * event. Set to NULL to unregister a callback. */
-void register_CandidateRank_valid(CandidateRankMonitor *mon, SMEDLCallback cb_func);
+ * event on a single monitor. Set to NULL to unregister a callback. Return
+ * nonzero on success, zero on malloc failure. */
+int register_CandidateRank_valid(CandidateRankMonitor *mon, SMEDLCallback cb_func);
 
 /* Cleanup callback registration function - Set the callback for when the
  * monitor is ready to be recycled. The callback is responsible for calling
  * free_CandidateRank_monitor(). It must accept the monitor pointer as a
- * parameter and return nonzero on success, zero on failure. */
-void registercleanup_CandidateRank(CandidateRankMonitor *mon, int (*cleanup_func)(CandidateRankMonitor *mon));
+ * parameter and return nonzero on success, zero on failure.
+ * Like the callback registration functions, this affects a single monitor and
+ * returns nonzero on success, zero on malloc failure. */
+int registercleanup_CandidateRank(CandidateRankMonitor *mon, int (*cleanup_func)(CandidateRankMonitor *mon));
 
 /* Event handling functions:
  *
@@ -91,7 +121,7 @@ int export_CandidateRank_valid(CandidateRankMonitor *mon, SMEDLValue *params, vo
  * Return a pointer to the monitor. Must be freed with
  * free_CandidateRank_monitor() when no longer needed.
  * Returns NULL on malloc failure. */
-CandidateRankMonitor * init_CandidateRank_monitor(SMEDLValue *identities);
+CandidateRankMonitor * init_CandidateRank_monitor(CandidateRankIdentities *identities);
 
 /* Fill the provided CandidateRankState
  * with the default initial values for the monitor. Note that strings and
@@ -111,10 +141,18 @@ int default_CandidateRank_state(CandidateRankState *state);
  * Return a pointer to the monitor. Must be freed with
  * free_CandidateRank_monitor() when no longer needed.
  * Returns NULL on malloc failure. */
-CandidateRankMonitor * init_CandidateRank_with_state(SMEDLValue *identities, CandidateRankState *init_state);
+CandidateRankMonitor * init_CandidateRank_with_state(CandidateRankIdentities *identities, CandidateRankState *init_state);
 
-/* Free a CandidateRank monitor. NOTE: Does not free the identities. That must
- * be done by the caller, if necessary. */
+/* Free a CandidateRank monitor. NOTE: Does not free the identity strings. That
+ * must be done by the caller, if necessary. */
 void free_CandidateRank_monitor(CandidateRankMonitor *mon);
 
+/* Snapshot functions (see snapshot.h) - snapshot_CandidateRank_monitor() appends
+ * the monitor's scenario states and state variables to its record,
+ * CandidateRank_SNAPSHOT_SIZE bytes. restore_CandidateRank_monitor() gets them back into a
+ * monitor initialized with the same identities. */
+#define CandidateRank_SNAPSHOT_SIZE (SMEDL_SNAPSHOT_STATE)
+void snapshot_CandidateRank_monitor(CandidateRankMonitor *mon, SMEDLSnapshotWriter *w);
+void restore_CandidateRank_monitor(CandidateRankMonitor *mon, SMEDLSnapshot *snap);
+
 #endif /* CandidateRank_MON_H */
@@ -6,7 +6,8 @@
 #include <string.h>
 #include "smedl_types.h"
 #include "monitor_map.h"
-#include "CandidateSelection_global_wrapper.h"
+#include "profile.h"
+#include "CanSys_global_wrapper.h"
 #include "CandidateSelection_local_wrapper.h"
 #include "CandidateSelection_mon.h"
 
@@ -33,61 +34,112 @@ static MonitorMap monitor_map_all;
 static MonitorMap monitor_map_0;
 static MonitorMap monitor_map_none;
 
+/* Population counters for the stats interface */
+static uint64_t dynamic_count, created_count, recycled_count;
+
 /* Monitor map hash functions - One for each monitor map */
 
-static uint64_t hash_all(SMEDLValue *ids) {
+static uint64_t hash_all(const void *key) {
+    const CandidateSelectionIdentities *ids = key;
     murmur_state s = MURMUR_INIT(0);
-    murmur(ids[0].v.s, strlen(ids[0].v.s), &s);
-    murmur(ids[1].v.s, strlen(ids[1].v.s), &s);
+    murmur(ids->id0, strlen(ids->id0), &s);
+    murmur(ids->id1, strlen(ids->id1), &s);
     return murmur_f(&s);
 }
 
-static uint64_t hash_0(SMEDLValue *ids) {
+static uint64_t hash_0(const void *key) {
+    const CandidateSelectionIdentities *ids = key;
     murmur_state s = MURMUR_INIT(0);
-    murmur(ids[0].v.s, strlen(ids[0].v.s), &s);
+    murmur(ids->id0, strlen(ids->id0), &s);
     return murmur_f(&s);
 }
 
-static uint64_t hash_none(SMEDLValue *ids) {
+static uint64_t hash_none(const void *key) {
     murmur_state s = MURMUR_INIT(0);
     return murmur_f(&s);
 }
 
 /* Monitor map equals functions - One for each monitor map */
 
-static int equals_all(SMEDLValue *ids1, SMEDLValue *ids2) {
-    if (strcmp(ids1[0].v.s, ids2[0].v.s)) {
+static int equals_all(const void *key1, const void *key2) {
+    const CandidateSelectionIdentities *ids1 = key1, *ids2 = key2;
+    if (strcmp(ids1->id0, ids2->id0)) {
         return 0;
     }
-    if (strcmp(ids1[1].v.s, ids2[1].v.s)) {
+    if (strcmp(ids1->id1, ids2->id1)) {
         return 0;
     }
     return 1;
 }
 
-static int equals_0(SMEDLValue *ids1, SMEDLValue *ids2) {
-    if (strcmp(ids1[0].v.s, ids2[0].v.s)) {
+static int equals_0(const void *key1, const void *key2) {
+    const CandidateSelectionIdentities *ids1 = key1, *ids2 = key2;
+    if (strcmp(ids1->id0, ids2->id0)) {
         return 0;
     }
     return 1;
 }
 
-static int equals_none(SMEDLValue *ids1, SMEDLValue *ids2) {
+static int equals_none(const void *key1, const void *key2) {
     return 1;
 }
 
-/* Register the global wrapper's export callbacks with the monitor */
-static void setup_CandidateSelection_callbacks(CandidateSelectionMonitor *mon) {
-    register_CandidateSelection_shouldrank(mon, raise_CandidateSelection_shouldrank);
-    register_CandidateSelection_result(mon, raise_CandidateSelection_result);
-    register_CandidateSelection_addP(mon, raise_CandidateSelection_addP);
-    registercleanup_CandidateSelection(mon, recycle_CandidateSelection_monitor);
+/* Identity conversion - Fill in an identity tuple from an array of SMEDLValue
+ * as given to the import interfaces. Wildcard identities are left as they
+ * are in the array; lookups with wildcards use monitor maps that ignore them.
+ * Strings are borrowed, not copied. */
+static void load_CandidateSelection_ids(CandidateSelectionIdentities *ids, SMEDLValue *identities) {
+    ids->id0 = identities[0].v.s;
+    ids->id1 = identities[1].v.s;
+}
+
+/* Free the strings owned by an identity tuple */
+static void free_CandidateSelection_ids(CandidateSelectionIdentities *ids) {
+    SMEDL_FREE_OBJECT(&CandidateSelection_memory, SMEDL_MEM_IDENTITY, ids->id0);
+    SMEDL_FREE_OBJECT(&CandidateSelection_memory, SMEDL_MEM_IDENTITY, ids->id1);
+}
+
+/* Replace the strings borrowed by load_CandidateSelection_ids() with copies that a
+ * monitor can own. Return nonzero on success, zero on malloc failure. */
+static int copy_CandidateSelection_ids(CandidateSelectionIdentities *ids) {
+    CandidateSelectionIdentities copy = {0};
+    if (!smedl_assign_string(&copy.id0, ids->id0)) {
+        goto fail;
+    }
+    SMEDL_MEM_ADOPT(&CandidateSelection_memory, SMEDL_MEM_IDENTITY, copy.id0);
+    if (!smedl_assign_string(&copy.id1, ids->id1)) {
+        goto fail;
+    }
+    SMEDL_MEM_ADOPT(&CandidateSelection_memory, SMEDL_MEM_IDENTITY, copy.id1);
+    *ids = copy;
+    return 1;
+
+fail:
+    free_CandidateSelection_ids(&copy);
+    return 0;
+}
+
+/* Register the global wrapper's export callbacks in the callback table shared
+ * by all CandidateSelection monitors */
+static void setup_CandidateSelection_callbacks() {
+    CandidateSelectionCallbacks callbacks = {
+        .callback_shouldrank = raise_CandidateSelection_shouldrank,
+        .callback_result = raise_CandidateSelection_result,
+        .callback_addP = raise_CandidateSelection_addP,
+        .cleanup = recycle_CandidateSelection_monitor,
+    };
+    registershared_CandidateSelection(&callbacks);
 }
 
 /* Initialization interface - Initialize the local wrapper. Must be called once
  * before creating any monitors or importing any events.
  * Return nonzero on success, zero on failure. */
 int init_CandidateSelection_local_wrapper() {
+    /* Count the monitor maps with the monitors (see memstats.h) */
+    SMEDL_MEM_REGISTER(&CandidateSelection_memory);
+    monitor_map_all.account = &CandidateSelection_memory;
+    monitor_map_0.account = &CandidateSelection_memory;
+    monitor_map_none.account = &CandidateSelection_memory;
     if (!monitormap_init(&monitor_map_all, offsetof(CandidateSelectionMonitor, identities), hash_all, equals_all)) {
         goto fail_init_monitor_map_all;
     }
@@ -98,6 +150,8 @@ int init_CandidateSelection_local_wrapper() {
         goto fail_init_monitor_map_none;
     }
 
+    setup_CandidateSelection_callbacks();
+
     return 1;
 
 fail_init_monitor_map_none:
@@ -117,13 +171,95 @@ void free_CandidateSelection_local_wrapper() {
 
     while (instances != NULL) {
         MonitorInstance *tmp = instances->next;
-        smedl_free_array(((CandidateSelectionMonitor *) instances->mon)->identities, 2);
+        free_CandidateSelection_ids(&((CandidateSelectionMonitor *) instances->mon)->identities);
         free_CandidateSelection_monitor(instances->mon);
-        free(instances);
+        SMEDL_FREE_OBJECT(&CandidateSelection_memory, SMEDL_MEM_MAP_INSTANCE, instances);
         instances = tmp;
     }
 }
 
+/* Count interface - Return the number of live CandidateSelection monitors */
+size_t count_CandidateSelection_monitors() {
+    return monitor_map_all.count;
+}
+
+/* Stats interface - Fill in the population of CandidateSelection monitors and the
+ * health of its monitor maps */
+void stats_CandidateSelection_monitors(MonitorStats *stats) {
+    stats->live = monitor_map_all.count;
+    stats->spilled = 0;
+    stats->dynamic = dynamic_count;
+    stats->created = created_count;
+    stats->recycled = recycled_count;
+    stats->map_count = 3;
+    stats->maps[0].name = "all";
+    monitormap_stats(&monitor_map_all, &stats->maps[0].stats);
+    stats->maps[1].name = "0";
+    monitormap_stats(&monitor_map_0, &stats->maps[1].stats);
+    stats->maps[2].name = "none";
+    monitormap_stats(&monitor_map_none, &stats->maps[2].stats);
+}
+
+/* Bytes in the snapshot record of a CandidateSelection monitor: its identities, then
+ * its scenario states and state variables */
+#define CandidateSelection_RECORD_SIZE (2 * SMEDL_SNAPSHOT_STRING + CandidateSelection_SNAPSHOT_SIZE)
+
+/* Snapshot interface - Write the section for CandidateSelection monitors to the snapshot
+ * (see snapshot.h). Return nonzero on success, zero on failure. */
+int snapshot_CandidateSelection_monitors(SMEDLSnapshotWriter *w) {
+    smedl_snapshot_begin(w, "CandidateSelection", CandidateSelection_RECORD_SIZE, monitor_map_all.count,
+            dynamic_count, created_count, recycled_count);
+    for (size_t i = 0; i < monitor_map_all.capacity; i++) {
+        if (monitor_map_all.table[i].dib == 0) {
+            continue;
+        }
+        for (MonitorInstance *inst = monitor_map_all.table[i].head; inst != NULL; inst = inst->next) {
+            CandidateSelectionMonitor *mon = inst->mon;
+            smedl_snapshot_put_string(w, mon->identities.id0);
+            smedl_snapshot_put_string(w, mon->identities.id1);
+            snapshot_CandidateSelection_monitor(mon, w);
+        }
+    }
+    return smedl_snapshot_end(w);
+}
+
+/* Restore interfaces - Reserve room in the restore block for the CandidateSelection
+ * monitors in the snapshot, then restore them. Return nonzero on success,
+ * zero on failure. */
+int reserve_CandidateSelection_monitors(SMEDLSnapshot *snap) {
+    return smedl_restore_reserve(snap, "CandidateSelection", CandidateSelection_RECORD_SIZE, sizeof(CandidateSelectionMonitor), 3);
+}
+
+int restore_CandidateSelection_monitors(SMEDLSnapshot *snap) {
+    const SMEDLSnapshotSection *section = smedl_snapshot_section(snap, "CandidateSelection", CandidateSelection_RECORD_SIZE);
+    if (section == NULL) {
+        return 0;
+    }
+    if (!monitormap_reserve(&monitor_map_all, section->count)) {
+        return 0;
+    }
+    for (uint64_t i = 0; i < section->count; i++) {
+        /* The monitor struct and map nodes come from the restore block. Identity strings point
+     * into the restore block. */
+        CandidateSelectionIdentities ids;
+        ids.id0 = smedl_snapshot_get_string(snap);
+        ids.id1 = smedl_snapshot_get_string(snap);
+        CandidateSelectionMonitor *mon = init_CandidateSelection_monitor(&ids);
+        if (mon == NULL) {
+            return 0;
+        }
+        restore_CandidateSelection_monitor(mon, snap);
+        if (add_CandidateSelection_monitor(mon) == NULL) {
+            free_CandidateSelection_monitor(mon);
+            return 0;
+        }
+    }
+    dynamic_count = section->dynamic;
+    created_count = section->created;
+    recycled_count = section->recycled;
+    return !snap->error;
+}
+
 /* Creation interface - Instantiate a new CandidateSelection monitor.
  * Return nonzero on success or if monitor already exists, zero on failure.
  *
@@ -135,8 +271,11 @@ void free_CandidateSelection_local_wrapper() {
  *   state can be retrieved with default_CandidateSelection_state()
  *   and then just the desired variables can be updated. */
 int create_CandidateSelection_monitor(SMEDLValue *identities, CandidateSelectionState *init_state) {
+    CandidateSelectionIdentities ids;
+    load_CandidateSelection_ids(&ids, identities);
+
     /* Check if monitor with identities already exists */
-    if (monitormap_lookup(&monitor_map_all, identities) != NULL) {
+    if (MONITORMAP_LOOKUP(&monitor_map_all, &ids, hash_all, equals_all) != NULL) {
 #if DEBUG >= 4
         fprintf(stderr, "Local wrapper 'CandidateSelection' skipping explicit creation for existing monitor\n");
 #endif
@@ -147,26 +286,25 @@ int create_CandidateSelection_monitor(SMEDLValue *identities, CandidateSelection
 #endif
 
     /* Initialize new monitor with identities and state */
-    SMEDLValue *ids_copy = smedl_copy_array(identities, 2);
-    if (ids_copy == NULL) {
+    if (!copy_CandidateSelection_ids(&ids)) {
         /* malloc fail */
         return 0;
     }
-    CandidateSelectionMonitor *mon = init_CandidateSelection_with_state(ids_copy, init_state);
+    CandidateSelectionMonitor *mon = init_CandidateSelection_with_state(&ids, init_state);
     if (mon == NULL) {
         /* malloc fail */
-        smedl_free_array(ids_copy, 2);
+        free_CandidateSelection_ids(&ids);
         return 0;
     }
-    setup_CandidateSelection_callbacks(mon);
 
     /* Store monitor in maps */
     if (add_CandidateSelection_monitor(mon) == NULL) {
         /* malloc fail */
         free_CandidateSelection_monitor(mon);
-        smedl_free_array(ids_copy, 2);
+        free_CandidateSelection_ids(&ids);
         return 0;
     }
+    created_count++;
     return 1;
 }
 
@@ -186,7 +324,9 @@ int process_CandidateSelection_member(SMEDLValue *identities, SMEDLValue *params
 #endif
     /* Fetch the monitors to send the event to or do dynamic instantiation if
      * necessary */
-    MonitorInstance *instances = get_CandidateSelection_monitors(identities);
+    SMEDL_PROFILE_PUSH(SMEDL_PROFILE_STAGE_LOOKUP);
+    MonitorInstance *instances = get_CandidateSelection_monitors(identities, 1);
+    SMEDL_PROFILE_POP();
     if (instances == INVALID_INSTANCE) {
         /* malloc fail */
         return 0;
@@ -197,9 +337,11 @@ int process_CandidateSelection_member(SMEDLValue *identities, SMEDLValue *params
     while (instances != NULL) {
         CandidateSelectionMonitor *mon = instances->mon;
         instances = instances->next;
+        SMEDL_PROFILE_PUSH(SMEDL_PROFILE_STAGE_EXECUTE);
         if (!execute_CandidateSelection_member(mon, params, aux)) {
             success = 0;
         }
+        SMEDL_PROFILE_POP();
     }
     return success;
 }
@@ -208,9 +350,11 @@ int process_CandidateSelection_candidate(SMEDLValue *identities, SMEDLValue *par
 #if DEBUG >= 4
     fprintf(stderr, "Local wrapper 'CandidateSelection' processing event 'candidate'\n");
 #endif
-    /* Fetch the monitors to send the event to or do dynamic instantiation if
-     * necessary */
-    MonitorInstance *instances = get_CandidateSelection_monitors(identities);
+    /* Fetch the monitors to send the event to. 'candidate' is not a creation
+     * event, so no dynamic instantiation is done */
+    SMEDL_PROFILE_PUSH(SMEDL_PROFILE_STAGE_LOOKUP);
+    MonitorInstance *instances = get_CandidateSelection_monitors(identities, 0);
+    SMEDL_PROFILE_POP();
     if (instances == INVALID_INSTANCE) {
         /* malloc fail */
         return 0;
@@ -221,9 +365,11 @@ int process_CandidateSelection_candidate(SMEDLValue *identities, SMEDLValue *par
     while (instances != NULL) {
         CandidateSelectionMonitor *mon = instances->mon;
         instances = instances->next;
+        SMEDL_PROFILE_PUSH(SMEDL_PROFILE_STAGE_EXECUTE);
         if (!execute_CandidateSelection_candidate(mon, params, aux)) {
             success = 0;
         }
+        SMEDL_PROFILE_POP();
     }
     return success;
 }
@@ -232,9 +378,11 @@ int process_CandidateSelection_countcan(SMEDLValue *identities, SMEDLValue *para
 #if DEBUG >= 4
     fprintf(stderr, "Local wrapper 'CandidateSelection' processing event 'countcan'\n");
 #endif
-    /* Fetch the monitors to send the event to or do dynamic instantiation if
-     * necessary */
-    MonitorInstance *instances = get_CandidateSelection_monitors(identities);
+    /* Fetch the monitors to send the event to. 'countcan' is not a creation
+     * event, so no dynamic instantiation is done */
+    SMEDL_PROFILE_PUSH(SMEDL_PROFILE_STAGE_LOOKUP);
+    MonitorInstance *instances = get_CandidateSelection_monitors(identities, 0);
+    SMEDL_PROFILE_POP();
     if (instances == INVALID_INSTANCE) {
         /* malloc fail */
         return 0;
@@ -245,9 +393,11 @@ int process_CandidateSelection_countcan(SMEDLValue *identities, SMEDLValue *para
     while (instances != NULL) {
         CandidateSelectionMonitor *mon = instances->mon;
         instances = instances->next;
+        SMEDL_PROFILE_PUSH(SMEDL_PROFILE_STAGE_EXECUTE);
         if (!execute_CandidateSelection_countcan(mon, params, aux)) {
             success = 0;
         }
+        SMEDL_PROFILE_POP();
     }
     return success;
 }
@@ -258,7 +408,9 @@ int process_CandidateSelection_valid(SMEDLValue *identities, SMEDLValue *params,
 #endif
     /* Fetch the monitors to send the event to or do dynamic instantiation if
      * necessary */
-    MonitorInstance *instances = get_CandidateSelection_monitors(identities);
+    SMEDL_PROFILE_PUSH(SMEDL_PROFILE_STAGE_LOOKUP);
+    MonitorInstance *instances = get_CandidateSelection_monitors(identities, 1);
+    SMEDL_PROFILE_POP();
     if (instances == INVALID_INSTANCE) {
         /* malloc fail */
         return 0;
@@ -269,9 +421,11 @@ int process_CandidateSelection_valid(SMEDLValue *identities, SMEDLValue *params,
     while (instances != NULL) {
         CandidateSelectionMonitor *mon = instances->mon;
         instances = instances->next;
+        SMEDL_PROFILE_PUSH(SMEDL_PROFILE_STAGE_EXECUTE);
         if (!execute_CandidateSelection_valid(mon, params, aux)) {
             success = 0;
         }
+        SMEDL_PROFILE_POP();
     }
     return success;
 }
@@ -282,7 +436,9 @@ int process_CandidateSelection_end(SMEDLValue *identities, SMEDLValue *params, v
 #endif
     /* Fetch the monitors to send the event to or do dynamic instantiation if
      * necessary */
-    MonitorInstance *instances = get_CandidateSelection_monitors(identities);
+    SMEDL_PROFILE_PUSH(SMEDL_PROFILE_STAGE_LOOKUP);
+    MonitorInstance *instances = get_CandidateSelection_monitors(identities, 1);
+    SMEDL_PROFILE_POP();
     if (instances == INVALID_INSTANCE) {
         /* malloc fail */
         return 0;
@@ -293,9 +449,11 @@ int process_CandidateSelection_end(SMEDLValue *identities, SMEDLValue *params, v
     while (instances != NULL) {
         CandidateSelectionMonitor *mon = instances->mon;
         instances = instances->next;
+        SMEDL_PROFILE_PUSH(SMEDL_PROFILE_STAGE_EXECUTE);
         if (!execute_CandidateSelection_end(mon, params, aux)) {
             success = 0;
         }
+        SMEDL_PROFILE_POP();
     }
     return success;
 }
@@ -307,8 +465,9 @@ int recycle_CandidateSelection_monitor(CandidateSelectionMonitor *mon) {
         fprintf(stderr, "Recycling an instance of 'CandidateSelection'\n");
 #endif
     monitormap_remove(&monitor_map_all, mon);
-    smedl_free_array(mon->identities, 2);
+    free_CandidateSelection_ids(&mon->identities);
     free_CandidateSelection_monitor(mon);
+    recycled_count++;
     return 1;
 }
 
@@ -319,14 +478,14 @@ MonitorInstance * add_CandidateSelection_monitor(CandidateSelectionMonitor *mon)
     MonitorMap *prev_map = NULL;
     MonitorInstance *inst;
 
-    inst = monitormap_insert(&monitor_map_0, mon, prev_inst, prev_map);
+    inst = MONITORMAP_INSERT(&monitor_map_0, mon, prev_inst, prev_map, hash_0, equals_0);
     if (inst == NULL) {
         return NULL;
     }
     prev_inst = inst;
     prev_map = &monitor_map_0;
 
-    inst = monitormap_insert(&monitor_map_none, mon, prev_inst, prev_map);
+    inst = MONITORMAP_INSERT(&monitor_map_none, mon, prev_inst, prev_map, hash_none, equals_none);
     if (inst == NULL) {
         monitormap_removeinst(prev_map, prev_inst);
         return NULL;
@@ -334,7 +493,7 @@ MonitorInstance * add_CandidateSelection_monitor(CandidateSelectionMonitor *mon)
     prev_inst = inst;
     prev_map = &monitor_map_none;
 
-    inst = monitormap_insert(&monitor_map_all, mon, prev_inst, prev_map);
+    inst = MONITORMAP_INSERT(&monitor_map_all, mon, prev_inst, prev_map, hash_all, equals_all);
     if (inst == NULL) {
         monitormap_removeinst(prev_map, prev_inst);
         return NULL;
@@ -350,22 +509,28 @@ MonitorInstance * add_CandidateSelection_monitor(CandidateSelectionMonitor *mon)
  *
  * If there are no matching monitor instances but the identity list is fully
  * specified (i.e. there are no wildcards), create an instance with those
- * identities and return it.
+ * identities and return it. This is only done when create is nonzero, i.e.
+ * for creation events: events with a transition out of the initial state of
+ * at least one scenario. An instance created by any other event could never
+ * leave its initial states, so the event is simply dropped.
  *
  * Returns a linked list of MonitorInstance (which may be empty, i.e. NULL).
  * If dynamic instantiation fails, returns INVALID_INSTANCE. */
-MonitorInstance * get_CandidateSelection_monitors(SMEDLValue *identities) {
+MonitorInstance * get_CandidateSelection_monitors(SMEDLValue *identities, int create) {
+    CandidateSelectionIdentities ids;
+    load_CandidateSelection_ids(&ids, identities);
+
     /* Look up from the proper monitor map */
     MonitorInstance *instances;
     int dynamic_instantiation = 0;
     if (identities[0].t == SMEDL_NULL) {
-        instances = monitormap_lookup(&monitor_map_none, identities);
+        instances = MONITORMAP_LOOKUP(&monitor_map_none, &ids, hash_none, equals_none);
     } else {
         if (identities[1].t == SMEDL_NULL) {
-            instances = monitormap_lookup(&monitor_map_0, identities);
+            instances = MONITORMAP_LOOKUP(&monitor_map_0, &ids, hash_0, equals_0);
         } else {
-            instances = monitormap_lookup(&monitor_map_all, identities);
-            dynamic_instantiation = 1;
+            instances = MONITORMAP_LOOKUP(&monitor_map_all, &ids, hash_all, equals_all);
+            dynamic_instantiation = create;
         }
     }
 
@@ -375,25 +540,24 @@ MonitorInstance * get_CandidateSelection_monitors(SMEDLValue *identities) {
 #if DEBUG >= 4
         fprintf(stderr, "Dynamic instantiation for 'CandidateSelection'\n");
 #endif
-        SMEDLValue *ids_copy = smedl_copy_array(identities, 2);
-        if (ids_copy == NULL) {
+        if (!copy_CandidateSelection_ids(&ids)) {
             /* malloc fail */
             return INVALID_INSTANCE;
         }
-        CandidateSelectionMonitor *mon = init_CandidateSelection_monitor(ids_copy);
+        CandidateSelectionMonitor *mon = init_CandidateSelection_monitor(&ids);
         if (mon == NULL) {
             /* malloc fail */
-            smedl_free_array(ids_copy, 2);
+            free_CandidateSelection_ids(&ids);
             return INVALID_INSTANCE;
         }
-        setup_CandidateSelection_callbacks(mon);
         instances = add_CandidateSelection_monitor(mon);
         if (instances == NULL) {
             /* malloc fail */
             free_CandidateSelection_monitor(mon);
-            smedl_free_array(ids_copy, 2);
+            free_CandidateSelection_ids(&ids);
             return INVALID_INSTANCE;
         }
+        dynamic_count++;
     }
 
     return instances;
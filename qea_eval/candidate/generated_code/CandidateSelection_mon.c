@@ -7,26 +7,84 @@
 #include "event_queue.h"
 #include "CandidateSelection_mon.h"
 
+/* Memory counted for CandidateSelection monitors */
+SMEDLMemAccount CandidateSelection_memory = {"CandidateSelection"};
+
+/* Callback table shared by all CandidateSelection monitors without their own */
+static CandidateSelectionCallbacks shared_callbacks;
+
+/* The callback table in effect for a monitor. In a unity build, the export
+ * functions call the global wrapper's raise_*() functions directly for
+ * monitors without a table of their own, since those are the shared callbacks
+ * the local wrapper registers. */
+#define CALLBACKS(mon) ((mon)->callbacks != NULL ? (mon)->callbacks : &shared_callbacks)
+
+/* Convert the monitor's identities to an array of SMEDLValue for the export
+ * callbacks */
+static void get_CandidateSelection_id_values(CandidateSelectionMonitor *mon, SMEDLValue *values) {
+    values[0].t = SMEDL_STRING;
+    values[0].v.s = mon->identities.id0;
+    values[1].t = SMEDL_STRING;
+    values[1].v.s = mon->identities.id1;
+}
+
+/* Shared callback registration function - Set the callback table used by all
+ * CandidateSelection monitors that have not registered callbacks of their own */
+void registershared_CandidateSelection(const CandidateSelectionCallbacks *callbacks) {
+    shared_callbacks = *callbacks;
+}
+
+/* Give the monitor its own copy of the shared callback table so its callbacks
+ * can be changed without affecting other monitors. Return nonzero on success,
+ * zero on malloc failure. */
+static int own_CandidateSelection_callbacks(CandidateSelectionMonitor *mon) {
+    if (mon->callbacks == NULL) {
+        mon->callbacks = SMEDL_MALLOC(&CandidateSelection_memory, SMEDL_MEM_CALLBACKS,
+                sizeof(CandidateSelectionCallbacks));
+        if (mon->callbacks == NULL) {
+            return 0;
+        }
+        *mon->callbacks = shared_callbacks;
+    }
+    return 1;
+}
+
 /* Callback registration functions - Set the export callback for an exported
- * event */
+ * event on a single monitor */
 
-void register_CandidateSelection_shouldrank(CandidateSelectionMonitor *mon, SMEDLCallback cb_func) {
-    mon->callback_shouldrank = cb_func;
+int register_CandidateSelection_shouldrank(CandidateSelectionMonitor *mon, SMEDLCallback cb_func) {
+    if (!own_CandidateSelection_callbacks(mon)) {
+        return 0;
+    }
+    mon->callbacks->callback_shouldrank = cb_func;
+    return 1;
 }
 
-void register_CandidateSelection_result(CandidateSelectionMonitor *mon, SMEDLCallback cb_func) {
-    mon->callback_result = cb_func;
+int register_CandidateSelection_result(CandidateSelectionMonitor *mon, SMEDLCallback cb_func) {
+    if (!own_CandidateSelection_callbacks(mon)) {
+        return 0;
+    }
+    mon->callbacks->callback_result = cb_func;
+    return 1;
 }
 
-void register_CandidateSelection_addP(CandidateSelectionMonitor *mon, SMEDLCallback cb_func) {
-    mon->callback_addP = cb_func;
+int register_CandidateSelection_addP(CandidateSelectionMonitor *mon, SMEDLCallback cb_func) {
+    if (!own_CandidateSelection_callbacks(mon)) {
+        return 0;
+    }
+    mon->callbacks->callback_addP = cb_func;
+    return 1;
 }
 
 /* Cleanup callback registration function - Set the callback for when the
  * monitor is ready to be recycled. The callback is responsible for calling
  * free_CandidateSelection_monitor(). */
-void registercleanup_CandidateSelection(CandidateSelectionMonitor *mon, int (*cleanup_func)(CandidateSelectionMonitor *mon)) {
-    mon->cleanup = cleanup_func;
+int registercleanup_CandidateSelection(CandidateSelectionMonitor *mon, int (*cleanup_func)(CandidateSelectionMonitor *mon)) {
+    if (!own_CandidateSelection_callbacks(mon)) {
+        return 0;
+    }
+    mon->callbacks->cleanup = cleanup_func;
+    return 1;
 }
 
 /* Queue processing function - Call the handlers for all the events in the
@@ -38,6 +96,13 @@ static int handle_CandidateSelection_queue(CandidateSelectionMonitor *mon) {
     SMEDLValue *params;
     void *aux;
 
+    /* Scenario execution flags only guard events raised within a macro-step.
+     * If nothing was raised, there is nothing to handle and no flags to
+     * reset. */
+    if (mon->event_queue.head == NULL) {
+        return 1;
+    }
+
     while (pop_event(&mon->event_queue, &event, &params, &aux)) {
         switch (event) {
             case EVENT_CandidateSelection_check:
@@ -345,8 +410,18 @@ int queue_CandidateSelection_shouldrank(CandidateSelectionMonitor *mon, SMEDLVal
 }
 
 int export_CandidateSelection_shouldrank(CandidateSelectionMonitor *mon, SMEDLValue *params, void *aux) {
-    if (mon->callback_shouldrank != NULL) {
-        return (mon->callback_shouldrank)(mon->identities, params, aux);
+#ifdef SMEDL_UNITY
+    if (mon->callbacks == NULL) {
+        SMEDLValue identities[2];
+        get_CandidateSelection_id_values(mon, identities);
+        return raise_CandidateSelection_shouldrank(identities, params, aux);
+    }
+#endif
+    SMEDLCallback cb_func = CALLBACKS(mon)->callback_shouldrank;
+    if (cb_func != NULL) {
+        SMEDLValue identities[2];
+        get_CandidateSelection_id_values(mon, identities);
+        return cb_func(identities, params, aux);
     }
     return 1;
 }
@@ -369,8 +444,18 @@ int queue_CandidateSelection_result(CandidateSelectionMonitor *mon, SMEDLValue *
 }
 
 int export_CandidateSelection_result(CandidateSelectionMonitor *mon, SMEDLValue *params, void *aux) {
-    if (mon->callback_result != NULL) {
-        return (mon->callback_result)(mon->identities, params, aux);
+#ifdef SMEDL_UNITY
+    if (mon->callbacks == NULL) {
+        SMEDLValue identities[2];
+        get_CandidateSelection_id_values(mon, identities);
+        return raise_CandidateSelection_result(identities, params, aux);
+    }
+#endif
+    SMEDLCallback cb_func = CALLBACKS(mon)->callback_result;
+    if (cb_func != NULL) {
+        SMEDLValue identities[2];
+        get_CandidateSelection_id_values(mon, identities);
+        return cb_func(identities, params, aux);
     }
     return 1;
 }
@@ -393,8 +478,18 @@ int queue_CandidateSelection_addP(CandidateSelectionMonitor *mon, SMEDLValue *pa
 }
 
 int export_CandidateSelection_addP(CandidateSelectionMonitor *mon, SMEDLValue *params, void *aux) {
-    if (mon->callback_addP != NULL) {
-        return (mon->callback_addP)(mon->identities, params, aux);
+#ifdef SMEDL_UNITY
+    if (mon->callbacks == NULL) {
+        SMEDLValue identities[2];
+        get_CandidateSelection_id_values(mon, identities);
+        return raise_CandidateSelection_addP(identities, params, aux);
+    }
+#endif
+    SMEDLCallback cb_func = CALLBACKS(mon)->callback_addP;
+    if (cb_func != NULL) {
+        SMEDLValue identities[2];
+        get_CandidateSelection_id_values(mon, identities);
+        return cb_func(identities, params, aux);
     }
     return 1;
 }
@@ -405,7 +500,7 @@ int export_CandidateSelection_addP(CandidateSelectionMonitor *mon, SMEDLValue *p
  * Return a pointer to the monitor. Must be freed with
  * free_CandidateSelection_monitor() when no longer needed.
  * Returns NULL on malloc failure. */
-CandidateSelectionMonitor * init_CandidateSelection_monitor(SMEDLValue *identities) {
+CandidateSelectionMonitor * init_CandidateSelection_monitor(CandidateSelectionIdentities *identities) {
     CandidateSelectionState init_state;
 
     /* Initialize the monitor with default state */
@@ -441,14 +536,15 @@ int default_CandidateSelection_state(CandidateSelectionState *state) {
  * Return a pointer to the monitor. Must be freed with
  * free_CandidateSelection_monitor() when no longer needed.
  * Returns NULL on malloc failure. */
-CandidateSelectionMonitor * init_CandidateSelection_with_state(SMEDLValue *identities, CandidateSelectionState *init_state) {
-    CandidateSelectionMonitor *mon = malloc(sizeof(CandidateSelectionMonitor));
+CandidateSelectionMonitor * init_CandidateSelection_with_state(CandidateSelectionIdentities *identities, CandidateSelectionState *init_state) {
+    CandidateSelectionMonitor *mon = SMEDL_ALLOC_OBJECT(&CandidateSelection_memory, SMEDL_MEM_MONITOR,
+            sizeof(CandidateSelectionMonitor));
     if (mon == NULL) {
         return NULL;
     }
 
     /* Store the assigned identities */
-    mon->identities = identities;
+    mon->identities = *identities;
 
     /* Copy initial state vars in */
     mon->s = *init_state;
@@ -461,10 +557,8 @@ CandidateSelectionMonitor * init_CandidateSelection_with_state(SMEDLValue *ident
     /* Reset all scenario execution flags */
     memset(&mon->ef, 0, sizeof(mon->ef));
 
-    /* Set all export callbacks to NULL */
-    mon->callback_shouldrank = NULL;
-    mon->callback_result = NULL;
-    mon->callback_addP = NULL;
+    /* Use the shared callback table */
+    mon->callbacks = NULL;
 
     /* Initialize event queue */
     mon->event_queue = (EventQueue){0};
@@ -474,5 +568,24 @@ CandidateSelectionMonitor * init_CandidateSelection_with_state(SMEDLValue *ident
 
 /* Free a CandidateSelection monitor */
 void free_CandidateSelection_monitor(CandidateSelectionMonitor *mon) {
-    free(mon);
+    SMEDL_FREE(&CandidateSelection_memory, SMEDL_MEM_CALLBACKS, mon->callbacks);
+    SMEDL_FREE_OBJECT(&CandidateSelection_memory, SMEDL_MEM_MONITOR, mon);
+}
+
+/* Append the monitor's scenario states and state variables to its snapshot
+ * record */
+void snapshot_CandidateSelection_monitor(CandidateSelectionMonitor *mon, SMEDLSnapshotWriter *w) {
+    smedl_snapshot_put_state(w, mon->sce_state);
+    smedl_snapshot_put_state(w, mon->sce1_state);
+    smedl_snapshot_put_state(w, mon->sce2_state);
+    smedl_snapshot_put_int(w, mon->s.canNum);
+}
+
+/* Get the monitor's scenario states and state variables back from its
+ * snapshot record */
+void restore_CandidateSelection_monitor(CandidateSelectionMonitor *mon, SMEDLSnapshot *snap) {
+    mon->sce_state = smedl_snapshot_get_state(snap);
+    mon->sce1_state = smedl_snapshot_get_state(snap);
+    mon->sce2_state = smedl_snapshot_get_state(snap);
+    mon->s.canNum = smedl_snapshot_get_int(snap);
 }
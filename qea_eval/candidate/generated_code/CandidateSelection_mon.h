@@ -3,6 +3,11 @@
 
 #include "smedl_types.h"
 #include "event_queue.h"
+#include "memstats.h"
+#include "snapshot.h"
+
+/* Memory counted for CandidateSelection monitors (see memstats.h) */
+extern SMEDLMemAccount CandidateSelection_memory;
 
 /* Internal/exported event enum for action queues */
 typedef enum {
@@ -31,16 +36,36 @@ typedef struct CandidateSelectionState {
     int canNum;
 } CandidateSelectionState;
 
+/* Identities of a CandidateSelection monitor.
+ * Stored inline in the CandidateSelectionMonitor struct. They are only converted to
+ * an array of SMEDLValue at the import and export interfaces. */
+typedef struct CandidateSelectionIdentities {
+    char *id0;
+    char *id1;
+} CandidateSelectionIdentities;
+
+/* Callback table for CandidateSelection monitors.
+ * Holds the exported event callbacks and the cleanup callback. One table is
+ * shared by all CandidateSelection monitors; a monitor only gets its own copy once one of
+ * its callbacks is registered individually. */
+struct CandidateSelectionMonitor;
+typedef struct CandidateSelectionCallbacks {
+    SMEDLCallback callback_shouldrank;
+    SMEDLCallback callback_result;
+    SMEDLCallback callback_addP;
+    int (*cleanup)(struct CandidateSelectionMonitor *mon);
+} CandidateSelectionCallbacks;
+
 /* CandidateSelection monitor struct.
  * Maintains all of the internal state for the monitor. */
 typedef struct CandidateSelectionMonitor {
-    /* Array of monitor's identities */
-    SMEDLValue *identities;
+    /* Monitor's identities */
+    CandidateSelectionIdentities identities;
 
-    /* Scenario states */
-    CandidateSelection_sce_State sce_state;
-    CandidateSelection_sce1_State sce1_state;
-    CandidateSelection_sce2_State sce2_state;
+    /* Scenario states (CandidateSelection_*_State values, one byte each) */
+    unsigned char sce_state;
+    unsigned char sce1_state;
+    unsigned char sce2_state;
 
     /* Scenario execution flags (ensures each scenario only processes one event
      * per macro-step) */
@@ -53,13 +78,9 @@ typedef struct CandidateSelectionMonitor {
     /* State variables */
     CandidateSelectionState s;
 
-    /* Exported event callback pointers */
-    SMEDLCallback callback_shouldrank;
-    SMEDLCallback callback_result;
-    SMEDLCallback callback_addP;
-
-    /* Cleanup callback pointer */
-    int (*cleanup)(struct CandidateSelectionMonitor *mon);
+    /* Callback table, or NULL to use the table shared by all CandidateSelection
+     * monitors */
+    CandidateSelectionCallbacks *callbacks;
 
     /* Local event queue */
     EventQueue event_queue;
@@ -67,17 +88,25 @@ typedef struct CandidateSelectionMonitor {
     //TODO mutex?
 } CandidateSelectionMonitor;
 
+/* Shared callback registration function - Set the callback table used by all
+ * CandidateSelection monitors that have not registered callbacks of their own. The
+ * table is copied. */
+void registershared_CandidateSelection(const CandidateSelectionCallbacks *callbacks);
+
 /* Callback registration functions - Set the export callback for an exported
- * event. Set to NULL to unregister a callback. */
-void register_CandidateSelection_shouldrank(CandidateSelectionMonitor *mon, SMEDLCallback cb_func);
-void register_CandidateSelection_result(CandidateSelectionMonitor *mon, SMEDLCallback cb_func);
-void register_CandidateSelection_addP(CandidateSelectionMonitor *mon, SMEDLCallback cb_func);
+ * event on a single monitor. Set to NULL to unregister a callback. Return
+ * nonzero on success, zero on malloc failure. */
+int register_CandidateSelection_shouldrank(CandidateSelectionMonitor *mon, SMEDLCallback cb_func);
+int register_CandidateSelection_result(CandidateSelectionMonitor *mon, SMEDLCallback cb_func);
+int register_CandidateSelection_addP(CandidateSelectionMonitor *mon, SMEDLCallback cb_func);
 
 /* Cleanup callback registration function - Set the callback for when the
  * monitor is ready to be recycled. The callback is responsible for calling
  * free_CandidateSelection_monitor(). It must accept the monitor pointer as a
- * parameter and return nonzero on success, zero on failure. */
-void registercleanup_CandidateSelection(CandidateSelectionMonitor *mon, int (*cleanup_func)(CandidateSelectionMonitor *mon));
+ * parameter and return nonzero on success, zero on failure.
+ * Like the callback registration functions, this affects a single monitor and
+ * returns nonzero on success, zero on malloc failure. */
+int registercleanup_CandidateSelection(CandidateSelectionMonitor *mon, int (*cleanup_func)(CandidateSelectionMonitor *mon));
 
 /* Event handling functions:
  *
@@ -119,7 +148,7 @@ int export_CandidateSelection_addP(CandidateSelectionMonitor *mon, SMEDLValue *p
  * Return a pointer to the monitor. Must be freed with
  * free_CandidateSelection_monitor() when no longer needed.
  * Returns NULL on malloc failure. */
-CandidateSelectionMonitor * init_CandidateSelection_monitor(SMEDLValue *identities);
+CandidateSelectionMonitor * init_CandidateSelection_monitor(CandidateSelectionIdentities *identities);
 
 /* Fill the provided CandidateSelectionState
  * with the default initial values for the monitor. Note that strings and
@@ -139,10 +168,18 @@ int default_CandidateSelection_state(CandidateSelectionState *state);
  * Return a pointer to the monitor. Must be freed with
  * free_CandidateSelection_monitor() when no longer needed.
  * Returns NULL on malloc failure. */
-CandidateSelectionMonitor * init_CandidateSelection_with_state(SMEDLValue *identities, CandidateSelectionState *init_state);
+CandidateSelectionMonitor * init_CandidateSelection_with_state(CandidateSelectionIdentities *identities, CandidateSelectionState *init_state);
 
-/* Free a CandidateSelection monitor. NOTE: Does not free the identities. That must
- * be done by the caller, if necessary. */
+/* Free a CandidateSelection monitor. NOTE: Does not free the identity strings. That
+ * must be done by the caller, if necessary. */
 void free_CandidateSelection_monitor(CandidateSelectionMonitor *mon);
 
+/* Snapshot functions (see snapshot.h) - snapshot_CandidateSelection_monitor() appends
+ * the monitor's scenario states and state variables to its record,
+ * CandidateSelection_SNAPSHOT_SIZE bytes. restore_CandidateSelection_monitor() gets them back into a
+ * monitor initialized with the same identities. */
+#define CandidateSelection_SNAPSHOT_SIZE (3 * SMEDL_SNAPSHOT_STATE + SMEDL_SNAPSHOT_INT)
+void snapshot_CandidateSelection_monitor(CandidateSelectionMonitor *mon, SMEDLSnapshotWriter *w);
+void restore_CandidateSelection_monitor(CandidateSelectionMonitor *mon, SMEDLSnapshot *snap);
+
 #endif /* CandidateSelection_MON_H */
@@ -6,7 +6,8 @@
 #include <string.h>
 #include "smedl_types.h"
 #include "monitor_map.h"
-#include "CollectV_global_wrapper.h"
+#include "profile.h"
+#include "CanSys_global_wrapper.h"
 #include "CollectV_local_wrapper.h"
 #include "CollectV_mon.h"
 
@@ -31,38 +32,81 @@
  */
 static MonitorMap monitor_map_all;
 
+/* Population counters for the stats interface */
+static uint64_t dynamic_count, created_count, recycled_count;
+
 /* Monitor map hash functions - One for each monitor map */
 
-static uint64_t hash_all(SMEDLValue *ids) {
+static uint64_t hash_all(const void *key) {
+    const CollectVIdentities *ids = key;
     murmur_state s = MURMUR_INIT(0);
-    murmur(ids[0].v.s, strlen(ids[0].v.s), &s);
+    murmur(ids->id0, strlen(ids->id0), &s);
     return murmur_f(&s);
 }
 
 /* Monitor map equals functions - One for each monitor map */
 
-static int equals_all(SMEDLValue *ids1, SMEDLValue *ids2) {
-    if (strcmp(ids1[0].v.s, ids2[0].v.s)) {
+static int equals_all(const void *key1, const void *key2) {
+    const CollectVIdentities *ids1 = key1, *ids2 = key2;
+    if (strcmp(ids1->id0, ids2->id0)) {
         return 0;
     }
     return 1;
 }
 
-/* Register the global wrapper's export callbacks with the monitor */
-static void setup_CollectV_callbacks(CollectVMonitor *mon) {
-    register_CollectV_result(mon, raise_CollectV_result);
-    register_CollectV_addV(mon, raise_CollectV_addV);
-    registercleanup_CollectV(mon, recycle_CollectV_monitor);
+/* Identity conversion - Fill in an identity tuple from an array of SMEDLValue
+ * as given to the import interfaces. Wildcard identities are left as they
+ * are in the array; lookups with wildcards use monitor maps that ignore them.
+ * Strings are borrowed, not copied. */
+static void load_CollectV_ids(CollectVIdentities *ids, SMEDLValue *identities) {
+    ids->id0 = identities[0].v.s;
+}
+
+/* Free the strings owned by an identity tuple */
+static void free_CollectV_ids(CollectVIdentities *ids) {
+    SMEDL_FREE_OBJECT(&CollectV_memory, SMEDL_MEM_IDENTITY, ids->id0);
+}
+
+/* Replace the strings borrowed by load_CollectV_ids() with copies that a
+ * monitor can own. Return nonzero on success, zero on malloc failure. */
+static int copy_CollectV_ids(CollectVIdentities *ids) {
+    CollectVIdentities copy = {0};
+    if (!smedl_assign_string(&copy.id0, ids->id0)) {
+        goto fail;
+    }
+    SMEDL_MEM_ADOPT(&CollectV_memory, SMEDL_MEM_IDENTITY, copy.id0);
+    *ids = copy;
+    return 1;
+
+fail:
+    free_CollectV_ids(&copy);
+    return 0;
+}
+
+/* Register the global wrapper's export callbacks in the callback table shared
+ * by all CollectV monitors */
+static void setup_CollectV_callbacks() {
+    CollectVCallbacks callbacks = {
+        .callback_result = raise_CollectV_result,
+        .callback_addV = raise_CollectV_addV,
+        .cleanup = recycle_CollectV_monitor,
+    };
+    registershared_CollectV(&callbacks);
 }
 
 /* Initialization interface - Initialize the local wrapper. Must be called once
  * before creating any monitors or importing any events.
  * Return nonzero on success, zero on failure. */
 int init_CollectV_local_wrapper() {
+    /* Count the monitor maps with the monitors (see memstats.h) */
+    SMEDL_MEM_REGISTER(&CollectV_memory);
+    monitor_map_all.account = &CollectV_memory;
     if (!monitormap_init(&monitor_map_all, offsetof(CollectVMonitor, identities), hash_all, equals_all)) {
         goto fail_init_monitor_map_all;
     }
 
+    setup_CollectV_callbacks();
+
     return 1;
 
 fail_init_monitor_map_all:
@@ -76,13 +120,89 @@ void free_CollectV_local_wrapper() {
 
     while (instances != NULL) {
         MonitorInstance *tmp = instances->next;
-        smedl_free_array(((CollectVMonitor *) instances->mon)->identities, 1);
+        free_CollectV_ids(&((CollectVMonitor *) instances->mon)->identities);
         free_CollectV_monitor(instances->mon);
-        free(instances);
+        SMEDL_FREE_OBJECT(&CollectV_memory, SMEDL_MEM_MAP_INSTANCE, instances);
         instances = tmp;
     }
 }
 
+/* Count interface - Return the number of live CollectV monitors */
+size_t count_CollectV_monitors() {
+    return monitor_map_all.count;
+}
+
+/* Stats interface - Fill in the population of CollectV monitors and the
+ * health of its monitor maps */
+void stats_CollectV_monitors(MonitorStats *stats) {
+    stats->live = monitor_map_all.count;
+    stats->spilled = 0;
+    stats->dynamic = dynamic_count;
+    stats->created = created_count;
+    stats->recycled = recycled_count;
+    stats->map_count = 1;
+    stats->maps[0].name = "all";
+    monitormap_stats(&monitor_map_all, &stats->maps[0].stats);
+}
+
+/* Bytes in the snapshot record of a CollectV monitor: its identities, then
+ * its scenario states and state variables */
+#define CollectV_RECORD_SIZE (SMEDL_SNAPSHOT_STRING + CollectV_SNAPSHOT_SIZE)
+
+/* Snapshot interface - Write the section for CollectV monitors to the snapshot
+ * (see snapshot.h). Return nonzero on success, zero on failure. */
+int snapshot_CollectV_monitors(SMEDLSnapshotWriter *w) {
+    smedl_snapshot_begin(w, "CollectV", CollectV_RECORD_SIZE, monitor_map_all.count,
+            dynamic_count, created_count, recycled_count);
+    for (size_t i = 0; i < monitor_map_all.capacity; i++) {
+        if (monitor_map_all.table[i].dib == 0) {
+            continue;
+        }
+        for (MonitorInstance *inst = monitor_map_all.table[i].head; inst != NULL; inst = inst->next) {
+            CollectVMonitor *mon = inst->mon;
+            smedl_snapshot_put_string(w, mon->identities.id0);
+            snapshot_CollectV_monitor(mon, w);
+        }
+    }
+    return smedl_snapshot_end(w);
+}
+
+/* Restore interfaces - Reserve room in the restore block for the CollectV
+ * monitors in the snapshot, then restore them. Return nonzero on success,
+ * zero on failure. */
+int reserve_CollectV_monitors(SMEDLSnapshot *snap) {
+    return smedl_restore_reserve(snap, "CollectV", CollectV_RECORD_SIZE, sizeof(CollectVMonitor), 1);
+}
+
+int restore_CollectV_monitors(SMEDLSnapshot *snap) {
+    const SMEDLSnapshotSection *section = smedl_snapshot_section(snap, "CollectV", CollectV_RECORD_SIZE);
+    if (section == NULL) {
+        return 0;
+    }
+    if (!monitormap_reserve(&monitor_map_all, section->count)) {
+        return 0;
+    }
+    for (uint64_t i = 0; i < section->count; i++) {
+        /* The monitor struct and map nodes come from the restore block. Identity strings point
+     * into the restore block. */
+        CollectVIdentities ids;
+        ids.id0 = smedl_snapshot_get_string(snap);
+        CollectVMonitor *mon = init_CollectV_monitor(&ids);
+        if (mon == NULL) {
+            return 0;
+        }
+        restore_CollectV_monitor(mon, snap);
+        if (add_CollectV_monitor(mon) == NULL) {
+            free_CollectV_monitor(mon);
+            return 0;
+        }
+    }
+    dynamic_count = section->dynamic;
+    created_count = section->created;
+    recycled_count = section->recycled;
+    return !snap->error;
+}
+
 /* Creation interface - Instantiate a new CollectV monitor.
  * Return nonzero on success or if monitor already exists, zero on failure.
  *
@@ -94,8 +214,11 @@ void free_CollectV_local_wrapper() {
  *   state can be retrieved with default_CollectV_state()
  *   and then just the desired variables can be updated. */
 int create_CollectV_monitor(SMEDLValue *identities, CollectVState *init_state) {
+    CollectVIdentities ids;
+    load_CollectV_ids(&ids, identities);
+
     /* Check if monitor with identities already exists */
-    if (monitormap_lookup(&monitor_map_all, identities) != NULL) {
+    if (MONITORMAP_LOOKUP(&monitor_map_all, &ids, hash_all, equals_all) != NULL) {
 #if DEBUG >= 4
         fprintf(stderr, "Local wrapper 'CollectV' skipping explicit creation for existing monitor\n");
 #endif
@@ -106,26 +229,25 @@ int create_CollectV_monitor(SMEDLValue *identities, CollectVState *init_state) {
 #endif
 
     /* Initialize new monitor with identities and state */
-    SMEDLValue *ids_copy = smedl_copy_array(identities, 1);
-    if (ids_copy == NULL) {
+    if (!copy_CollectV_ids(&ids)) {
         /* malloc fail */
         return 0;
     }
-    CollectVMonitor *mon = init_CollectV_with_state(ids_copy, init_state);
+    CollectVMonitor *mon = init_CollectV_with_state(&ids, init_state);
     if (mon == NULL) {
         /* malloc fail */
-        smedl_free_array(ids_copy, 1);
+        free_CollectV_ids(&ids);
         return 0;
     }
-    setup_CollectV_callbacks(mon);
 
     /* Store monitor in maps */
     if (add_CollectV_monitor(mon) == NULL) {
         /* malloc fail */
         free_CollectV_monitor(mon);
-        smedl_free_array(ids_copy, 1);
+        free_CollectV_ids(&ids);
         return 0;
     }
+    created_count++;
     return 1;
 }
 
@@ -145,7 +267,9 @@ int process_CollectV_addP(SMEDLValue *identities, SMEDLValue *params, void *aux)
 #endif
     /* Fetch the monitors to send the event to or do dynamic instantiation if
      * necessary */
-    MonitorInstance *instances = get_CollectV_monitors(identities);
+    SMEDL_PROFILE_PUSH(SMEDL_PROFILE_STAGE_LOOKUP);
+    MonitorInstance *instances = get_CollectV_monitors(identities, 1);
+    SMEDL_PROFILE_POP();
     if (instances == INVALID_INSTANCE) {
         /* malloc fail */
         return 0;
@@ -156,9 +280,11 @@ int process_CollectV_addP(SMEDLValue *identities, SMEDLValue *params, void *aux)
     while (instances != NULL) {
         CollectVMonitor *mon = instances->mon;
         instances = instances->next;
+        SMEDL_PROFILE_PUSH(SMEDL_PROFILE_STAGE_EXECUTE);
         if (!execute_CollectV_addP(mon, params, aux)) {
             success = 0;
         }
+        SMEDL_PROFILE_POP();
     }
     return success;
 }
@@ -169,7 +295,9 @@ int process_CollectV_inRes(SMEDLValue *identities, SMEDLValue *params, void *aux
 #endif
     /* Fetch the monitors to send the event to or do dynamic instantiation if
      * necessary */
-    MonitorInstance *instances = get_CollectV_monitors(identities);
+    SMEDL_PROFILE_PUSH(SMEDL_PROFILE_STAGE_LOOKUP);
+    MonitorInstance *instances = get_CollectV_monitors(identities, 1);
+    SMEDL_PROFILE_POP();
     if (instances == INVALID_INSTANCE) {
         /* malloc fail */
         return 0;
@@ -180,9 +308,11 @@ int process_CollectV_inRes(SMEDLValue *identities, SMEDLValue *params, void *aux
     while (instances != NULL) {
         CollectVMonitor *mon = instances->mon;
         instances = instances->next;
+        SMEDL_PROFILE_PUSH(SMEDL_PROFILE_STAGE_EXECUTE);
         if (!execute_CollectV_inRes(mon, params, aux)) {
             success = 0;
         }
+        SMEDL_PROFILE_POP();
     }
     return success;
 }
@@ -194,8 +324,9 @@ int recycle_CollectV_monitor(CollectVMonitor *mon) {
         fprintf(stderr, "Recycling an instance of 'CollectV'\n");
 #endif
     monitormap_remove(&monitor_map_all, mon);
-    smedl_free_array(mon->identities, 1);
+    free_CollectV_ids(&mon->identities);
     free_CollectV_monitor(mon);
+    recycled_count++;
     return 1;
 }
 
@@ -206,7 +337,7 @@ MonitorInstance * add_CollectV_monitor(CollectVMonitor *mon) {
     MonitorMap *prev_map = NULL;
     MonitorInstance *inst;
 
-    inst = monitormap_insert(&monitor_map_all, mon, prev_inst, prev_map);
+    inst = MONITORMAP_INSERT(&monitor_map_all, mon, prev_inst, prev_map, hash_all, equals_all);
     if (inst == NULL) {
         return NULL;
     }
@@ -221,16 +352,22 @@ MonitorInstance * add_CollectV_monitor(CollectVMonitor *mon) {
  *
  * If there are no matching monitor instances but the identity list is fully
  * specified (i.e. there are no wildcards), create an instance with those
- * identities and return it.
+ * identities and return it. This is only done when create is nonzero, i.e.
+ * for creation events: events with a transition out of the initial state of
+ * at least one scenario. An instance created by any other event could never
+ * leave its initial states, so the event is simply dropped.
  *
  * Returns a linked list of MonitorInstance (which may be empty, i.e. NULL).
  * If dynamic instantiation fails, returns INVALID_INSTANCE. */
-MonitorInstance * get_CollectV_monitors(SMEDLValue *identities) {
+MonitorInstance * get_CollectV_monitors(SMEDLValue *identities, int create) {
+    CollectVIdentities ids;
+    load_CollectV_ids(&ids, identities);
+
     /* Look up from the proper monitor map */
     MonitorInstance *instances;
     int dynamic_instantiation = 0;
-    instances = monitormap_lookup(&monitor_map_all, identities);
-    dynamic_instantiation = 1;
+    instances = MONITORMAP_LOOKUP(&monitor_map_all, &ids, hash_all, equals_all);
+    dynamic_instantiation = create;
 
     /* Do dynamic instantiation if wildcards were fully specified and there
      * are no matching monitors */
@@ -238,25 +375,24 @@ MonitorInstance * get_CollectV_monitors(SMEDLValue *identities) {
 #if DEBUG >= 4
         fprintf(stderr, "Dynamic instantiation for 'CollectV'\n");
 #endif
-        SMEDLValue *ids_copy = smedl_copy_array(identities, 1);
-        if (ids_copy == NULL) {
+        if (!copy_CollectV_ids(&ids)) {
             /* malloc fail */
             return INVALID_INSTANCE;
         }
-        CollectVMonitor *mon = init_CollectV_monitor(ids_copy);
+        CollectVMonitor *mon = init_CollectV_monitor(&ids);
         if (mon == NULL) {
             /* malloc fail */
-            smedl_free_array(ids_copy, 1);
+            free_CollectV_ids(&ids);
             return INVALID_INSTANCE;
         }
-        setup_CollectV_callbacks(mon);
         instances = add_CollectV_monitor(mon);
         if (instances == NULL) {
             /* malloc fail */
             free_CollectV_monitor(mon);
-            smedl_free_array(ids_copy, 1);
+            free_CollectV_ids(&ids);
             return INVALID_INSTANCE;
         }
+        dynamic_count++;
     }
 
     return instances;
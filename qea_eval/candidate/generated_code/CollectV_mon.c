@@ -7,22 +7,74 @@
 #include "event_queue.h"
 #include "CollectV_mon.h"
 
+/* Memory counted for CollectV monitors */
+SMEDLMemAccount CollectV_memory = {"CollectV"};
+
+/* Callback table shared by all CollectV monitors without their own */
+static CollectVCallbacks shared_callbacks;
+
+/* The callback table in effect for a monitor. In a unity build, the export
+ * functions call the global wrapper's raise_*() functions directly for
+ * monitors without a table of their own, since those are the shared callbacks
+ * the local wrapper registers. */
+#define CALLBACKS(mon) ((mon)->callbacks != NULL ? (mon)->callbacks : &shared_callbacks)
+
+/* Convert the monitor's identities to an array of SMEDLValue for the export
+ * callbacks */
+static void get_CollectV_id_values(CollectVMonitor *mon, SMEDLValue *values) {
+    values[0].t = SMEDL_STRING;
+    values[0].v.s = mon->identities.id0;
+}
+
+/* Shared callback registration function - Set the callback table used by all
+ * CollectV monitors that have not registered callbacks of their own */
+void registershared_CollectV(const CollectVCallbacks *callbacks) {
+    shared_callbacks = *callbacks;
+}
+
+/* Give the monitor its own copy of the shared callback table so its callbacks
+ * can be changed without affecting other monitors. Return nonzero on success,
+ * zero on malloc failure. */
+static int own_CollectV_callbacks(CollectVMonitor *mon) {
+    if (mon->callbacks == NULL) {
+        mon->callbacks = SMEDL_MALLOC(&CollectV_memory, SMEDL_MEM_CALLBACKS,
+                sizeof(CollectVCallbacks));
+        if (mon->callbacks == NULL) {
+            return 0;
+        }
+        *mon->callbacks = shared_callbacks;
+    }
+    return 1;
+}
+
 /* Callback registration functions - Set the export callback for an exported
- * event */
+ * event on a single monitor */
 
-void register_CollectV_result(CollectVMonitor *mon, SMEDLCallback cb_func) {
-    mon->callback_result = cb_func;
+int register_CollectV_result(CollectVMonitor *mon, SMEDLCallback cb_func) {
+    if (!own_CollectV_callbacks(mon)) {
+        return 0;
+    }
+    mon->callbacks->callback_result = cb_func;
+    return 1;
 }
 
-void register_CollectV_addV(CollectVMonitor *mon, SMEDLCallback cb_func) {
-    mon->callback_addV = cb_func;
+int register_CollectV_addV(CollectVMonitor *mon, SMEDLCallback cb_func) {
+    if (!own_CollectV_callbacks(mon)) {
+        return 0;
+    }
+    mon->callbacks->callback_addV = cb_func;
+    return 1;
 }
 
 /* Cleanup callback registration function - Set the callback for when the
  * monitor is ready to be recycled. The callback is responsible for calling
  * free_CollectV_monitor(). */
-void registercleanup_CollectV(CollectVMonitor *mon, int (*cleanup_func)(CollectVMonitor *mon)) {
-    mon->cleanup = cleanup_func;
+int registercleanup_CollectV(CollectVMonitor *mon, int (*cleanup_func)(CollectVMonitor *mon)) {
+    if (!own_CollectV_callbacks(mon)) {
+        return 0;
+    }
+    mon->callbacks->cleanup = cleanup_func;
+    return 1;
 }
 
 /* Queue processing function - Call the handlers for all the events in the
@@ -34,6 +86,13 @@ static int handle_CollectV_queue(CollectVMonitor *mon) {
     SMEDLValue *params;
     void *aux;
 
+    /* Scenario execution flags only guard events raised within a macro-step.
+     * If nothing was raised, there is nothing to handle and no flags to
+     * reset. */
+    if (mon->event_queue.head == NULL) {
+        return 1;
+    }
+
     while (pop_event(&mon->event_queue, &event, &params, &aux)) {
         switch (event) {
             case EVENT_CollectV_check:
@@ -258,8 +317,18 @@ int queue_CollectV_result(CollectVMonitor *mon, SMEDLValue *params, void *aux) {
 }
 
 int export_CollectV_result(CollectVMonitor *mon, SMEDLValue *params, void *aux) {
-    if (mon->callback_result != NULL) {
-        return (mon->callback_result)(mon->identities, params, aux);
+#ifdef SMEDL_UNITY
+    if (mon->callbacks == NULL) {
+        SMEDLValue identities[1];
+        get_CollectV_id_values(mon, identities);
+        return raise_CollectV_result(identities, params, aux);
+    }
+#endif
+    SMEDLCallback cb_func = CALLBACKS(mon)->callback_result;
+    if (cb_func != NULL) {
+        SMEDLValue identities[1];
+        get_CollectV_id_values(mon, identities);
+        return cb_func(identities, params, aux);
     }
     return 1;
 }
@@ -282,8 +351,18 @@ int queue_CollectV_addV(CollectVMonitor *mon, SMEDLValue *params, void *aux) {
 }
 
 int export_CollectV_addV(CollectVMonitor *mon, SMEDLValue *params, void *aux) {
-    if (mon->callback_addV != NULL) {
-        return (mon->callback_addV)(mon->identities, params, aux);
+#ifdef SMEDL_UNITY
+    if (mon->callbacks == NULL) {
+        SMEDLValue identities[1];
+        get_CollectV_id_values(mon, identities);
+        return raise_CollectV_addV(identities, params, aux);
+    }
+#endif
+    SMEDLCallback cb_func = CALLBACKS(mon)->callback_addV;
+    if (cb_func != NULL) {
+        SMEDLValue identities[1];
+        get_CollectV_id_values(mon, identities);
+        return cb_func(identities, params, aux);
     }
     return 1;
 }
@@ -294,7 +373,7 @@ int export_CollectV_addV(CollectVMonitor *mon, SMEDLValue *params, void *aux) {
  * Return a pointer to the monitor. Must be freed with
  * free_CollectV_monitor() when no longer needed.
  * Returns NULL on malloc failure. */
-CollectVMonitor * init_CollectV_monitor(SMEDLValue *identities) {
+CollectVMonitor * init_CollectV_monitor(CollectVIdentities *identities) {
     CollectVState init_state;
 
     /* Initialize the monitor with default state */
@@ -331,14 +410,15 @@ int default_CollectV_state(CollectVState *state) {
  * Return a pointer to the monitor. Must be freed with
  * free_CollectV_monitor() when no longer needed.
  * Returns NULL on malloc failure. */
-CollectVMonitor * init_CollectV_with_state(SMEDLValue *identities, CollectVState *init_state) {
-    CollectVMonitor *mon = malloc(sizeof(CollectVMonitor));
+CollectVMonitor * init_CollectV_with_state(CollectVIdentities *identities, CollectVState *init_state) {
+    CollectVMonitor *mon = SMEDL_ALLOC_OBJECT(&CollectV_memory, SMEDL_MEM_MONITOR,
+            sizeof(CollectVMonitor));
     if (mon == NULL) {
         return NULL;
     }
 
     /* Store the assigned identities */
-    mon->identities = identities;
+    mon->identities = *identities;
 
     /* Copy initial state vars in */
     mon->s = *init_state;
@@ -351,9 +431,8 @@ CollectVMonitor * init_CollectV_with_state(SMEDLValue *identities, CollectVState
     /* Reset all scenario execution flags */
     memset(&mon->ef, 0, sizeof(mon->ef));
 
-    /* Set all export callbacks to NULL */
-    mon->callback_result = NULL;
-    mon->callback_addV = NULL;
+    /* Use the shared callback table */
+    mon->callbacks = NULL;
 
     /* Initialize event queue */
     mon->event_queue = (EventQueue){0};
@@ -363,5 +442,26 @@ CollectVMonitor * init_CollectV_with_state(SMEDLValue *identities, CollectVState
 
 /* Free a CollectV monitor */
 void free_CollectV_monitor(CollectVMonitor *mon) {
-    free(mon);
+    SMEDL_FREE(&CollectV_memory, SMEDL_MEM_CALLBACKS, mon->callbacks);
+    SMEDL_FREE_OBJECT(&CollectV_memory, SMEDL_MEM_MONITOR, mon);
+}
+
+/* Append the monitor's scenario states and state variables to its snapshot
+ * record */
+void snapshot_CollectV_monitor(CollectVMonitor *mon, SMEDLSnapshotWriter *w) {
+    smedl_snapshot_put_state(w, mon->sce_state);
+    smedl_snapshot_put_state(w, mon->sce1_state);
+    smedl_snapshot_put_state(w, mon->sce2_state);
+    smedl_snapshot_put_int(w, mon->s.pNum);
+    smedl_snapshot_put_int(w, mon->s.res);
+}
+
+/* Get the monitor's scenario states and state variables back from its
+ * snapshot record */
+void restore_CollectV_monitor(CollectVMonitor *mon, SMEDLSnapshot *snap) {
+    mon->sce_state = smedl_snapshot_get_state(snap);
+    mon->sce1_state = smedl_snapshot_get_state(snap);
+    mon->sce2_state = smedl_snapshot_get_state(snap);
+    mon->s.pNum = smedl_snapshot_get_int(snap);
+    mon->s.res = smedl_snapshot_get_int(snap);
 }
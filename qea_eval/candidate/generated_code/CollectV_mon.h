@@ -3,6 +3,11 @@
 
 #include "smedl_types.h"
 #include "event_queue.h"
+#include "memstats.h"
+#include "snapshot.h"
+
+/* Memory counted for CollectV monitors (see memstats.h) */
+extern SMEDLMemAccount CollectV_memory;
 
 /* Internal/exported event enum for action queues */
 typedef enum {
@@ -31,16 +36,34 @@ typedef struct CollectVState {
     int res;
 } CollectVState;
 
+/* Identities of a CollectV monitor.
+ * Stored inline in the CollectVMonitor struct. They are only converted to
+ * an array of SMEDLValue at the import and export interfaces. */
+typedef struct CollectVIdentities {
+    char *id0;
+} CollectVIdentities;
+
+/* Callback table for CollectV monitors.
+ * Holds the exported event callbacks and the cleanup callback. One table is
+ * shared by all CollectV monitors; a monitor only gets its own copy once one of
+ * its callbacks is registered individually. */
+struct CollectVMonitor;
+typedef struct CollectVCallbacks {
+    SMEDLCallback callback_result;
+    SMEDLCallback callback_addV;
+    int (*cleanup)(struct CollectVMonitor *mon);
+} CollectVCallbacks;
+
 /* CollectV monitor struct.
  * Maintains all of the internal state for the monitor. */
 typedef struct CollectVMonitor {
-    /* Array of monitor's identities */
-    SMEDLValue *identities;
+    /* Monitor's identities */
+    CollectVIdentities identities;
 
-    /* Scenario states */
-    CollectV_sce_State sce_state;
-    CollectV_sce1_State sce1_state;
-    CollectV_sce2_State sce2_state;
+    /* Scenario states (CollectV_*_State values, one byte each) */
+    unsigned char sce_state;
+    unsigned char sce1_state;
+    unsigned char sce2_state;
 
     /* Scenario execution flags (ensures each scenario only processes one event
      * per macro-step) */
@@ -53,12 +76,9 @@ typedef struct CollectVMonitor {
     /* State variables */
     CollectVState s;
 
-    /* Exported event callback pointers */
-    SMEDLCallback callback_result;
-    SMEDLCallback callback_addV;
-
-    /* Cleanup callback pointer */
-    int (*cleanup)(struct CollectVMonitor *mon);
+    /* Callback table, or NULL to use the table shared by all CollectV
+     * monitors */
+    CollectVCallbacks *callbacks;
 
     /* Local event queue */
     EventQueue event_queue;
@@ -66,16 +86,24 @@ typedef struct CollectVMonitor {
     //TODO mutex?
 } CollectVMonitor;
 
+/* Shared callback registration function - Set the callback table used by all
+ * CollectV monitors that have not registered callbacks of their own. The
+ * table is copied. */
+void registershared_CollectV(const CollectVCallbacks *callbacks);
+
 /* Callback registration functions - Set the export callback for an exported
- * event. Set to NULL to unregister a callback. */
-void register_CollectV_result(CollectVMonitor *mon, SMEDLCallback cb_func);
-void register_CollectV_addV(CollectVMonitor *mon, SMEDLCallback cb_func);
+ * event on a single monitor. Set to NULL to unregister a callback. Return
+ * nonzero on success, zero on malloc failure. */
+int register_CollectV_result(CollectVMonitor *mon, SMEDLCallback cb_func);
+int register_CollectV_addV(CollectVMonitor *mon, SMEDLCallback cb_func);
 
 /* Cleanup callback registration function - Set the callback for when the
  * monitor is ready to be recycled. The callback is responsible for calling
  * free_CollectV_monitor(). It must accept the monitor pointer as a
- * parameter and return nonzero on success, zero on failure. */
-void registercleanup_CollectV(CollectVMonitor *mon, int (*cleanup_func)(CollectVMonitor *mon));
+ * parameter and return nonzero on success, zero on failure.
+ * Like the callback registration functions, this affects a single monitor and
+ * returns nonzero on success, zero on malloc failure. */
+int registercleanup_CollectV(CollectVMonitor *mon, int (*cleanup_func)(CollectVMonitor *mon));
 
 /* Event handling functions:
  *
@@ -111,7 +139,7 @@ int export_CollectV_addV(CollectVMonitor *mon, SMEDLValue *params, void *aux);
  * Return a pointer to the monitor. Must be freed with
  * free_CollectV_monitor() when no longer needed.
  * Returns NULL on malloc failure. */
-CollectVMonitor * init_CollectV_monitor(SMEDLValue *identities);
+CollectVMonitor * init_CollectV_monitor(CollectVIdentities *identities);
 
 /* Fill the provided CollectVState
  * with the default initial values for the monitor. Note that strings and
@@ -131,10 +159,18 @@ int default_CollectV_state(CollectVState *state);
  * Return a pointer to the monitor. Must be freed with
  * free_CollectV_monitor() when no longer needed.
  * Returns NULL on malloc failure. */
-CollectVMonitor * init_CollectV_with_state(SMEDLValue *identities, CollectVState *init_state);
+CollectVMonitor * init_CollectV_with_state(CollectVIdentities *identities, CollectVState *init_state);
 
-/* Free a CollectV monitor. NOTE: Does not free the identities. That must
- * be done by the caller, if necessary. */
+/* Free a CollectV monitor. NOTE: Does not free the identity strings. That
+ * must be done by the caller, if necessary. */
 void free_CollectV_monitor(CollectVMonitor *mon);
 
+/* Snapshot functions (see snapshot.h) - snapshot_CollectV_monitor() appends
+ * the monitor's scenario states and state variables to its record,
+ * CollectV_SNAPSHOT_SIZE bytes. restore_CollectV_monitor() gets them back into a
+ * monitor initialized with the same identities. */
+#define CollectV_SNAPSHOT_SIZE (3 * SMEDL_SNAPSHOT_STATE + 2 * SMEDL_SNAPSHOT_INT)
+void snapshot_CollectV_monitor(CollectVMonitor *mon, SMEDLSnapshotWriter *w);
+void restore_CollectV_monitor(CollectVMonitor *mon, SMEDLSnapshot *snap);
+
 #endif /* CollectV_MON_H */
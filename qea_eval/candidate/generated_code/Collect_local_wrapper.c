@@ -6,28 +6,34 @@
 #include <string.h>
 #include "smedl_types.h"
 #include "monitor_map.h"
-#include "Collect_global_wrapper.h"
+#include "profile.h"
+#include "CanSys_global_wrapper.h"
 #include "Collect_local_wrapper.h"
 #include "Collect_mon.h"
 
 /* Singleton monitor */
 static CollectMonitor *monitor;
 
-/* Register the global wrapper's export callbacks with the monitor */
-static void setup_Collect_callbacks(CollectMonitor *mon) {
-    register_Collect_result(mon, raise_Collect_result);
+/* Register the global wrapper's export callbacks in the callback table shared
+ * by all Collect monitors */
+static void setup_Collect_callbacks() {
+    CollectCallbacks callbacks = {
+        .callback_result = raise_Collect_result,
+    };
+    registershared_Collect(&callbacks);
 }
 
 /* Initialization interface - Initialize the local wrapper. Must be called once
  * before creating any monitors or importing any events.
  * Return nonzero on success, zero on failure. */
 int init_Collect_local_wrapper() {
+    SMEDL_MEM_REGISTER(&Collect_memory);
     /* Initialize the singleton */
-    monitor = init_Collect_monitor(NULL);
+    monitor = init_Collect_monitor();
     if (monitor == NULL) {
         return 0;
     }
-    setup_Collect_callbacks(monitor);
+    setup_Collect_callbacks();
     return 1;
 }
 
@@ -37,6 +43,54 @@ void free_Collect_local_wrapper() {
     free_Collect_monitor(monitor);
 }
 
+/* Count interface - Return the number of live Collect monitors */
+size_t count_Collect_monitors() {
+    /* Singleton monitor */
+    return 1;
+}
+
+/* Stats interface - Fill in the population of Collect monitors and the
+ * health of its monitor maps */
+void stats_Collect_monitors(MonitorStats *stats) {
+    /* Singleton monitor */
+    stats->live = 1;
+    stats->spilled = 0;
+    stats->dynamic = 0;
+    stats->created = 0;
+    stats->recycled = 0;
+    stats->map_count = 0;
+}
+
+/* Bytes in the snapshot record of the Collect monitor: its scenario states
+ * and state variables */
+#define Collect_RECORD_SIZE Collect_SNAPSHOT_SIZE
+
+/* Snapshot interface - Write the section for Collect monitors to the snapshot
+ * (see snapshot.h). Return nonzero on success, zero on failure. */
+int snapshot_Collect_monitors(SMEDLSnapshotWriter *w) {
+    /* Singleton monitor */
+    smedl_snapshot_begin(w, "Collect", Collect_RECORD_SIZE, 1, 0, 0, 0);
+    snapshot_Collect_monitor(monitor, w);
+    return smedl_snapshot_end(w);
+}
+
+/* Restore interfaces - Reserve room in the restore block for the Collect
+ * monitors in the snapshot, then restore them. Return nonzero on success,
+ * zero on failure. */
+int reserve_Collect_monitors(SMEDLSnapshot *snap) {
+    /* Singleton monitor - Restored in place, so only its section is checked */
+    return smedl_restore_reserve(snap, "Collect", Collect_RECORD_SIZE, 0, 0);
+}
+
+int restore_Collect_monitors(SMEDLSnapshot *snap) {
+    const SMEDLSnapshotSection *section = smedl_snapshot_section(snap, "Collect", Collect_RECORD_SIZE);
+    if (section == NULL || section->count != 1) {
+        return 0;
+    }
+    restore_Collect_monitor(monitor, snap);
+    return !snap->error;
+}
+
 /* Creation interface - Instantiate a new Collect monitor.
  * Return nonzero on success or if monitor already exists, zero on failure.
  *
@@ -67,7 +121,10 @@ int process_Collect_addV(SMEDLValue *identities, SMEDLValue *params, void *aux)
     fprintf(stderr, "Local wrapper 'Collect' processing event 'addV'\n");
 #endif
     /* Send event to the singleton monitor */
-    return execute_Collect_addV(monitor, params, aux);
+    SMEDL_PROFILE_PUSH(SMEDL_PROFILE_STAGE_EXECUTE);
+    int result = execute_Collect_addV(monitor, params, aux);
+    SMEDL_PROFILE_POP();
+    return result;
 }
 
 int process_Collect_inRes(SMEDLValue *identities, SMEDLValue *params, void *aux) {
@@ -75,5 +132,8 @@ int process_Collect_inRes(SMEDLValue *identities, SMEDLValue *params, void *aux)
     fprintf(stderr, "Local wrapper 'Collect' processing event 'inRes'\n");
 #endif
     /* Send event to the singleton monitor */
-    return execute_Collect_inRes(monitor, params, aux);
+    SMEDL_PROFILE_PUSH(SMEDL_PROFILE_STAGE_EXECUTE);
+    int result = execute_Collect_inRes(monitor, params, aux);
+    SMEDL_PROFILE_POP();
+    return result;
 }
@@ -4,6 +4,7 @@
 #include <stdint.h>
 #include "smedl_types.h"
 #include "monitor_map.h"
+#include "snapshot.h"
 #include "Collect_mon.h"
 
 /******************************************************************************
@@ -19,6 +20,24 @@ int init_Collect_local_wrapper();
  * wrapper and all the monitors it manages */
 void free_Collect_local_wrapper();
 
+/* Count interface - Return the number of live Collect monitors */
+size_t count_Collect_monitors();
+
+/* Stats interface - Fill in the population of Collect monitors and the
+ * health of its monitor maps */
+void stats_Collect_monitors(MonitorStats *stats);
+
+/* Snapshot interface - Write the section for Collect monitors to the snapshot
+ * (see snapshot.h). Return nonzero on success, zero on failure. */
+int snapshot_Collect_monitors(SMEDLSnapshotWriter *w);
+
+/* Restore interfaces - Reserve room in the restore block for the Collect
+ * monitors in the snapshot, then restore them, between smedl_restore_begin()
+ * and smedl_restore_end(). There must be no Collect monitors yet. Return
+ * nonzero on success, zero on failure. */
+int reserve_Collect_monitors(SMEDLSnapshot *snap);
+int restore_Collect_monitors(SMEDLSnapshot *snap);
+
 /* Creation interface - Instantiate a new Collect monitor.
  * Return nonzero on success or if monitor already exists, zero on failure.
  *
@@ -7,18 +7,59 @@
 #include "event_queue.h"
 #include "Collect_mon.h"
 
+/* Memory counted for Collect monitors */
+SMEDLMemAccount Collect_memory = {"Collect"};
+
+/* Callback table shared by all Collect monitors without their own */
+static CollectCallbacks shared_callbacks;
+
+/* The callback table in effect for a monitor. In a unity build, the export
+ * functions call the global wrapper's raise_*() functions directly for
+ * monitors without a table of their own, since those are the shared callbacks
+ * the local wrapper registers. */
+#define CALLBACKS(mon) ((mon)->callbacks != NULL ? (mon)->callbacks : &shared_callbacks)
+
+/* Shared callback registration function - Set the callback table used by all
+ * Collect monitors that have not registered callbacks of their own */
+void registershared_Collect(const CollectCallbacks *callbacks) {
+    shared_callbacks = *callbacks;
+}
+
+/* Give the monitor its own copy of the shared callback table so its callbacks
+ * can be changed without affecting other monitors. Return nonzero on success,
+ * zero on malloc failure. */
+static int own_Collect_callbacks(CollectMonitor *mon) {
+    if (mon->callbacks == NULL) {
+        mon->callbacks = SMEDL_MALLOC(&Collect_memory, SMEDL_MEM_CALLBACKS,
+                sizeof(CollectCallbacks));
+        if (mon->callbacks == NULL) {
+            return 0;
+        }
+        *mon->callbacks = shared_callbacks;
+    }
+    return 1;
+}
+
 /* Callback registration functions - Set the export callback for an exported
- * event */
+ * event on a single monitor */
 
-void register_Collect_result(CollectMonitor *mon, SMEDLCallback cb_func) {
-    mon->callback_result = cb_func;
+int register_Collect_result(CollectMonitor *mon, SMEDLCallback cb_func) {
+    if (!own_Collect_callbacks(mon)) {
+        return 0;
+    }
+    mon->callbacks->callback_result = cb_func;
+    return 1;
 }
 
 /* Cleanup callback registration function - Set the callback for when the
  * monitor is ready to be recycled. The callback is responsible for calling
  * free_Collect_monitor(). */
-void registercleanup_Collect(CollectMonitor *mon, int (*cleanup_func)(CollectMonitor *mon)) {
-    mon->cleanup = cleanup_func;
+int registercleanup_Collect(CollectMonitor *mon, int (*cleanup_func)(CollectMonitor *mon)) {
+    if (!own_Collect_callbacks(mon)) {
+        return 0;
+    }
+    mon->callbacks->cleanup = cleanup_func;
+    return 1;
 }
 
 /* Queue processing function - Call the handlers for all the events in the
@@ -30,6 +71,13 @@ static int handle_Collect_queue(CollectMonitor *mon) {
     SMEDLValue *params;
     void *aux;
 
+    /* Scenario execution flags only guard events raised within a macro-step.
+     * If nothing was raised, there is nothing to handle and no flags to
+     * reset. */
+    if (mon->event_queue.head == NULL) {
+        return 1;
+    }
+
     while (pop_event(&mon->event_queue, &event, &params, &aux)) {
         switch (event) {
             case EVENT_Collect_result:
@@ -195,8 +243,14 @@ int queue_Collect_result(CollectMonitor *mon, SMEDLValue *params, void *aux) {
 }
 
 int export_Collect_result(CollectMonitor *mon, SMEDLValue *params, void *aux) {
-    if (mon->callback_result != NULL) {
-        return (mon->callback_result)(mon->identities, params, aux);
+#ifdef SMEDL_UNITY
+    if (mon->callbacks == NULL) {
+        return raise_Collect_result(NULL, params, aux);
+    }
+#endif
+    SMEDLCallback cb_func = CALLBACKS(mon)->callback_result;
+    if (cb_func != NULL) {
+        return cb_func(NULL, params, aux);
     }
     return 1;
 }
@@ -207,7 +261,7 @@ int export_Collect_result(CollectMonitor *mon, SMEDLValue *params, void *aux) {
  * Return a pointer to the monitor. Must be freed with
  * free_Collect_monitor() when no longer needed.
  * Returns NULL on malloc failure. */
-CollectMonitor * init_Collect_monitor(SMEDLValue *identities) {
+CollectMonitor * init_Collect_monitor() {
     CollectState init_state;
 
     /* Initialize the monitor with default state */
@@ -215,7 +269,7 @@ CollectMonitor * init_Collect_monitor(SMEDLValue *identities) {
         /* malloc fail */
         return NULL;
     }
-    CollectMonitor *result = init_Collect_with_state(identities, &init_state);
+    CollectMonitor *result = init_Collect_with_state(&init_state);
     if (result == NULL) {
         /* malloc fail. Need to clean up strings and opaques in init_state. */
     }
@@ -245,15 +299,13 @@ int default_Collect_state(CollectState *state) {
  * Return a pointer to the monitor. Must be freed with
  * free_Collect_monitor() when no longer needed.
  * Returns NULL on malloc failure. */
-CollectMonitor * init_Collect_with_state(SMEDLValue *identities, CollectState *init_state) {
-    CollectMonitor *mon = malloc(sizeof(CollectMonitor));
+CollectMonitor * init_Collect_with_state(CollectState *init_state) {
+    CollectMonitor *mon = SMEDL_ALLOC_OBJECT(&Collect_memory, SMEDL_MEM_MONITOR,
+            sizeof(CollectMonitor));
     if (mon == NULL) {
         return NULL;
     }
 
-    /* Store the assigned identities */
-    mon->identities = identities;
-
     /* Copy initial state vars in */
     mon->s = *init_state;
 
@@ -264,8 +316,8 @@ CollectMonitor * init_Collect_with_state(SMEDLValue *identities, CollectState *i
     /* Reset all scenario execution flags */
     memset(&mon->ef, 0, sizeof(mon->ef));
 
-    /* Set all export callbacks to NULL */
-    mon->callback_result = NULL;
+    /* Use the shared callback table */
+    mon->callbacks = NULL;
 
     /* Initialize event queue */
     mon->event_queue = (EventQueue){0};
@@ -275,5 +327,26 @@ CollectMonitor * init_Collect_with_state(SMEDLValue *identities, CollectState *i
 
 /* Free a Collect monitor */
 void free_Collect_monitor(CollectMonitor *mon) {
-    free(mon);
+    SMEDL_FREE(&Collect_memory, SMEDL_MEM_CALLBACKS, mon->callbacks);
+    SMEDL_FREE_OBJECT(&Collect_memory, SMEDL_MEM_MONITOR, mon);
+}
+
+/* Append the monitor's scenario states and state variables to its snapshot
+ * record */
+void snapshot_Collect_monitor(CollectMonitor *mon, SMEDLSnapshotWriter *w) {
+    smedl_snapshot_put_state(w, mon->sce_state);
+    smedl_snapshot_put_state(w, mon->sce1_state);
+    smedl_snapshot_put_int(w, mon->s.vNum);
+    smedl_snapshot_put_int(w, mon->s.vNumTemp);
+    smedl_snapshot_put_int(w, mon->s.res);
+}
+
+/* Get the monitor's scenario states and state variables back from its
+ * snapshot record */
+void restore_Collect_monitor(CollectMonitor *mon, SMEDLSnapshot *snap) {
+    mon->sce_state = smedl_snapshot_get_state(snap);
+    mon->sce1_state = smedl_snapshot_get_state(snap);
+    mon->s.vNum = smedl_snapshot_get_int(snap);
+    mon->s.vNumTemp = smedl_snapshot_get_int(snap);
+    mon->s.res = smedl_snapshot_get_int(snap);
 }
@@ -3,6 +3,11 @@
 
 #include "smedl_types.h"
 #include "event_queue.h"
+#include "memstats.h"
+#include "snapshot.h"
+
+/* Memory counted for Collect monitors (see memstats.h) */
+extern SMEDLMemAccount Collect_memory;
 
 /* Internal/exported event enum for action queues */
 typedef enum {
@@ -27,15 +32,22 @@ typedef struct CollectState {
     int res;
 } CollectState;
 
+/* Callback table for Collect monitors.
+ * Holds the exported event callbacks and the cleanup callback. One table is
+ * shared by all Collect monitors; a monitor only gets its own copy once one of
+ * its callbacks is registered individually. */
+struct CollectMonitor;
+typedef struct CollectCallbacks {
+    SMEDLCallback callback_result;
+    int (*cleanup)(struct CollectMonitor *mon);
+} CollectCallbacks;
+
 /* Collect monitor struct.
  * Maintains all of the internal state for the monitor. */
 typedef struct CollectMonitor {
-    /* Array of monitor's identities */
-    SMEDLValue *identities;
-
-    /* Scenario states */
-    Collect_sce_State sce_state;
-    Collect_sce1_State sce1_state;
+    /* Scenario states (Collect_*_State values, one byte each) */
+    unsigned char sce_state;
+    unsigned char sce1_state;
 
     /* Scenario execution flags (ensures each scenario only processes one event
      * per macro-step) */
@@ -47,11 +59,9 @@ typedef struct CollectMonitor {
     /* State variables */
     CollectState s;
 
-    /* Exported event callback pointers */
-    SMEDLCallback callback_result;
-
-    /* Cleanup callback pointer */
-    int (*cleanup)(struct CollectMonitor *mon);
+    /* Callback table, or NULL to use the table shared by all Collect
+     * monitors */
+    CollectCallbacks *callbacks;
 
     /* Local event queue */
     EventQueue event_queue;
@@ -59,15 +69,23 @@ typedef struct CollectMonitor {
     //TODO mutex?
 } CollectMonitor;
 
+/* Shared callback registration function - Set the callback table used by all
+ * Collect monitors that have not registered callbacks of their own. The
+ * table is copied. */
+void registershared_Collect(const CollectCallbacks *callbacks);
+
 /* Callback registration functions - Set the export callback for an exported
- * event. Set to NULL to unregister a callback. */
-void register_Collect_result(CollectMonitor *mon, SMEDLCallback cb_func);
+ * event on a single monitor. Set to NULL to unregister a callback. Return
+ * nonzero on success, zero on malloc failure. */
+int register_Collect_result(CollectMonitor *mon, SMEDLCallback cb_func);
 
 /* Cleanup callback registration function - Set the callback for when the
  * monitor is ready to be recycled. The callback is responsible for calling
  * free_Collect_monitor(). It must accept the monitor pointer as a
- * parameter and return nonzero on success, zero on failure. */
-void registercleanup_Collect(CollectMonitor *mon, int (*cleanup_func)(CollectMonitor *mon));
+ * parameter and return nonzero on success, zero on failure.
+ * Like the callback registration functions, this affects a single monitor and
+ * returns nonzero on success, zero on malloc failure. */
+int registercleanup_Collect(CollectMonitor *mon, int (*cleanup_func)(CollectMonitor *mon));
 
 /* Event handling functions:
  *
@@ -98,7 +116,7 @@ int export_Collect_result(CollectMonitor *mon, SMEDLValue *params, void *aux);
  * Return a pointer to the monitor. Must be freed with
  * free_Collect_monitor() when no longer needed.
  * Returns NULL on malloc failure. */
-CollectMonitor * init_Collect_monitor(SMEDLValue *identities);
+CollectMonitor * init_Collect_monitor();
 
 /* Fill the provided CollectState
  * with the default initial values for the monitor. Note that strings and
@@ -118,10 +136,17 @@ int default_Collect_state(CollectState *state);
  * Return a pointer to the monitor. Must be freed with
  * free_Collect_monitor() when no longer needed.
  * Returns NULL on malloc failure. */
-CollectMonitor * init_Collect_with_state(SMEDLValue *identities, CollectState *init_state);
+CollectMonitor * init_Collect_with_state(CollectState *init_state);
 
-/* Free a Collect monitor. NOTE: Does not free the identities. That must
- * be done by the caller, if necessary. */
+/* Free a Collect monitor */
 void free_Collect_monitor(CollectMonitor *mon);
 
+/* Snapshot functions (see snapshot.h) - snapshot_Collect_monitor() appends
+ * the monitor's scenario states and state variables to its record,
+ * Collect_SNAPSHOT_SIZE bytes. restore_Collect_monitor() gets them back into a
+ * monitor initialized with the same identities. */
+#define Collect_SNAPSHOT_SIZE (2 * SMEDL_SNAPSHOT_STATE + 3 * SMEDL_SNAPSHOT_INT)
+void snapshot_Collect_monitor(CollectMonitor *mon, SMEDLSnapshotWriter *w);
+void restore_Collect_monitor(CollectMonitor *mon, SMEDLSnapshot *snap);
+
 #endif /* Collect_MON_H */
@@ -1,6 +1,7 @@
 #include <stdlib.h>
 #include "smedl_types.h"
 #include "event_queue.h"
+#include "memstats.h"
 
 /* Add an event to the queue. Return 1 if successful, 0 if malloc fails.
  *
@@ -11,7 +12,7 @@
  * aux - Aux data to pass through */
 int push_event(EventQueue *q, int event, SMEDLValue *params, void *aux) {
     /* Create the Event */
-    Event *e = malloc(sizeof(Event));
+    Event *e = SMEDL_MALLOC(&smedl_mem_shared, SMEDL_MEM_QUEUE, sizeof(Event));
     if (e == NULL) {
         return 0;
     }
@@ -56,6 +57,6 @@ int pop_event(EventQueue *q, int *event, SMEDLValue **params, void **aux) {
     *params = e->params;
     *aux = e->aux;
 
-    free(e);
+    SMEDL_FREE(&smedl_mem_shared, SMEDL_MEM_QUEUE, e);
     return 1;
 }
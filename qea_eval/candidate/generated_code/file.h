@@ -3,6 +3,7 @@
 
 /* Includes jsmn.h with proper #defines */
 #include "json.h"
+#include "trace_reader.h"
 
 /* Print a message to stderr followed by a newline. Arguments like printf. */
 void err(const char *fmt, ...);
@@ -16,19 +17,26 @@ typedef enum {
     JSONSTATUS_NOMEM    /* Out of memory */
 } JSONStatus;
 
-/* Parser state struct. Initialize with init_parser() */
+/* Parser state struct. Initialize with init_parser()
+ *
+ * Messages are parsed in place in the buffers handed out by the reader. Only a
+ * message that spans two or more buffers is copied, into buf. */
 typedef struct JSONParser {
-    FILE *f;
+    SMEDLTraceReader reader;
     jsmn_parser parser;
     jsmntok_t *tokens;
     size_t tokens_size;
-    char *buf;
+    const char *chunk; /* Buffer from the reader being parsed */
+    size_t chunk_len;
+    size_t chunk_pos;  /* Start of the next message in the chunk */
+    unsigned long long chunk_offset; /* Input offset of the chunk */
+    char *buf;         /* Copy of a message that spans buffers */
     size_t buf_size;
-    size_t buf_wpos; /* Buffer write position (end of most recent fread) */
-    size_t buf_rpos; /* Buffer read position (end of most recent object) */
+    size_t buf_len;
 
     /* The following can be queried after init_parser */
     size_t msg_count; /* Number of messages that have been parsed */
+    unsigned long long msg_offset; /* Input offset of the last message parsed */
     JSONStatus status; /* Will indicate why next_message() returned NULL */
 } JSONParser;
 
@@ -38,10 +46,50 @@ typedef struct {
     size_t len;
 } AuxData;
 
+/* Number of messages read ahead before the queue is handled. Events for a
+ * synchronous set are imported into it in batches of up to this many. */
+#ifndef FILE_BATCH_SIZE
+#define FILE_BATCH_SIZE 1024
+#endif
+
+/* Aux data for the messages read ahead in one batch. The parser buffer is
+ * reused for each message, so the aux text must be copied out of it.
+ * Initialize all members to zero before using. Cleanup with free_aux_batch().
+ */
+typedef struct {
+    AuxData aux[FILE_BATCH_SIZE];
+    size_t offset[FILE_BATCH_SIZE]; /* Offset of each aux text in buf */
+    size_t count;
+    char *buf;
+    size_t buf_size;
+    size_t buf_len;
+} AuxBatch;
+
+/* Copy aux text into the batch. Returns the AuxData for it, or NULL if out of
+ * memory. The batch must not be full. The AuxData is not valid until
+ * seal_aux_batch() is called. */
+AuxData * add_aux(AuxBatch *batch, const char *data, size_t len);
+
+/* Make every AuxData in the batch valid. Call after the last add_aux() and
+ * before handling the events that use them. */
+void seal_aux_batch(AuxBatch *batch);
+
+/* Empty the batch so it can be reused. The buffer is kept. */
+void reset_aux_batch(AuxBatch *batch);
+
+/* Free the batch's buffer */
+void free_aux_batch(AuxBatch *batch);
+
 /* Initialize a parser reading from the named file. Returns nonzero if
  * successful, zero on failure. Cleanup with free_parser(). */
 int init_parser(JSONParser *parser, const char *fname);
 
+/* Initialize a parser like init_parser(), but start offset bytes into the
+ * input (see smedl_reader_open_at()), counting msg_count messages as already
+ * parsed. Used to pick up where a snapshot was taken (see snapshot.h). */
+int init_parser_at(JSONParser *parser, const char *fname,
+        unsigned long long offset, size_t msg_count);
+
 /* Fetch the next message. If successful, returns an array of jsmntok_t
  * containing the parsed message. If there is an error or no more tokens,
  * return NULL. The reason for a NULL return can be determined by checking
@@ -0,0 +1,162 @@
+#include <stdlib.h>
+#include <malloc.h>
+#include "memstats.h"
+
+/* mallinfo2() appeared in glibc 2.33 */
+#if defined(__GLIBC__) && \
+    (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 33))
+#define HAVE_MALLINFO2
+#endif
+
+static const char *const category_names[SMEDL_MEM_CATEGORIES] = {
+    [SMEDL_MEM_MONITOR] = "monitors",
+    [SMEDL_MEM_CALLBACKS] = "callbacks",
+    [SMEDL_MEM_STORE] = "stores",
+    [SMEDL_MEM_IDENTITY] = "identities",
+    [SMEDL_MEM_MAP_TABLE] = "map_tables",
+    [SMEDL_MEM_MAP_INSTANCE] = "map_instances",
+    [SMEDL_MEM_EVENT] = "events",
+    [SMEDL_MEM_QUEUE] = "queues",
+    [SMEDL_MEM_RESTORED] = "restored",
+};
+
+SMEDLMemAccount smedl_mem_shared = {"shared"};
+
+/* Registered accounts, in order, with smedl_mem_shared always last */
+static SMEDLMemAccount *accounts = &smedl_mem_shared;
+static SMEDLMemAccount **accounts_end = &accounts;
+
+static void count(SMEDLMemAccount *account, SMEDLMemCategory category,
+        void *ptr) {
+    account->bytes[category] += malloc_usable_size(ptr);
+    account->blocks[category]++;
+}
+
+static void uncount(SMEDLMemAccount *account, SMEDLMemCategory category,
+        void *ptr) {
+    account->bytes[category] -= malloc_usable_size(ptr);
+    account->blocks[category]--;
+}
+
+static void write_at_exit(void) {
+    fprintf(stderr, "{\"memory\": ");
+    smedl_mem_write(stderr);
+    fprintf(stderr, "}\n");
+    fflush(stderr);
+}
+
+int smedl_mem_init(void) {
+    return !atexit(write_at_exit);
+}
+
+void smedl_mem_register(SMEDLMemAccount *account) {
+    if (account->registered || account == &smedl_mem_shared) {
+        return;
+    }
+    account->registered = 1;
+    account->next = *accounts_end;
+    *accounts_end = account;
+    accounts_end = &account->next;
+}
+
+void * smedl_mem_malloc(SMEDLMemAccount *account, SMEDLMemCategory category,
+        size_t size) {
+    void *ptr = malloc(size);
+    if (ptr != NULL) {
+        count(account, category, ptr);
+    }
+    return ptr;
+}
+
+void * smedl_mem_calloc(SMEDLMemAccount *account, SMEDLMemCategory category,
+        size_t n, size_t size) {
+    void *ptr = calloc(n, size);
+    if (ptr != NULL) {
+        count(account, category, ptr);
+    }
+    return ptr;
+}
+
+void * smedl_mem_realloc(SMEDLMemAccount *account, SMEDLMemCategory category,
+        void *ptr, size_t size) {
+    size_t old_size = ptr != NULL ? malloc_usable_size(ptr) : 0;
+    void *new_ptr = realloc(ptr, size);
+    if (new_ptr == NULL) {
+        return NULL;
+    }
+    account->bytes[category] += malloc_usable_size(new_ptr) - old_size;
+    if (ptr == NULL) {
+        account->blocks[category]++;
+    }
+    return new_ptr;
+}
+
+void smedl_mem_free(SMEDLMemAccount *account, SMEDLMemCategory category,
+        void *ptr) {
+    if (ptr != NULL) {
+        uncount(account, category, ptr);
+        free(ptr);
+    }
+}
+
+void smedl_mem_adopt(SMEDLMemAccount *account, SMEDLMemCategory category,
+        void *ptr) {
+    if (ptr != NULL) {
+        count(account, category, ptr);
+    }
+}
+
+/* Print bytes per monitor, or null if there are no monitors */
+static void write_per_monitor(FILE *f, size_t bytes, size_t live) {
+    if (live > 0) {
+        fprintf(f, "%.2f", (double) bytes / live);
+    } else {
+        fprintf(f, "null");
+    }
+}
+
+void smedl_mem_write(FILE *f) {
+    size_t counted = 0;
+    size_t live = 0;
+    for (SMEDLMemAccount *a = accounts; a != NULL; a = a->next) {
+        for (int c = 0; c < SMEDL_MEM_CATEGORIES; c++) {
+            counted += a->bytes[c];
+        }
+        live += a->blocks[SMEDL_MEM_MONITOR];
+    }
+
+#ifdef HAVE_MALLINFO2
+    struct mallinfo2 info = mallinfo2();
+    fprintf(f, "{\"heap_bytes\": %zu, ", info.uordblks + info.hblkhd);
+#else
+    fprintf(f, "{\"heap_bytes\": null, ");
+#endif
+    fprintf(f, "\"counted_bytes\": %zu, \"live\": %zu, "
+            "\"bytes_per_monitor\": ", counted, live);
+    write_per_monitor(f, counted, live);
+
+    fprintf(f, ", \"accounts\": {");
+    for (SMEDLMemAccount *a = accounts; a != NULL; a = a->next) {
+        size_t bytes = 0;
+        for (int c = 0; c < SMEDL_MEM_CATEGORIES; c++) {
+            bytes += a->bytes[c];
+        }
+        fprintf(f, "%s\"%s\": {\"live\": %zu, \"bytes\": %zu, "
+                "\"bytes_per_monitor\": ", a == accounts ? "" : ", ",
+                a->name, a->blocks[SMEDL_MEM_MONITOR], bytes);
+        write_per_monitor(f, bytes, a->blocks[SMEDL_MEM_MONITOR]);
+        fprintf(f, ", \"categories\": {");
+        int first = 1;
+        for (int c = 0; c < SMEDL_MEM_CATEGORIES; c++) {
+            if (a->blocks[c] == 0) {
+                continue;
+            }
+            fprintf(f, "%s\"%s\": {\"bytes\": %zu, \"blocks\": %zu}",
+                    first ? "" : ", ", category_names[c], a->bytes[c],
+                    a->blocks[c]);
+            first = 0;
+        }
+        fprintf(f, "}}");
+    }
+    fprintf(f, "}}");
+}
@@ -1,9 +1,17 @@
+/* For clock_gettime() */
+#define _POSIX_C_SOURCE 200809L
 #include <stddef.h>
 #include <stdlib.h>
 #include <stdint.h>
 #include <assert.h>
+#include <time.h>
 #include "smedl_types.h"
 #include "monitor_map.h"
+#include "snapshot.h"
+
+/* Account the map's memory is counted in */
+#define MAP_ACCOUNT(map) \
+    ((map)->account != NULL ? (map)->account : &smedl_mem_shared)
 
 /*****************************************************************************
  * Murmur hash
@@ -124,18 +132,18 @@ MonitorInstance dummy_instance;
  * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
  * IN THE SOFTWARE.*/
 
-#define IDS_OF(mon) (*(SMEDLValue **) ((mon) + map->offset))
+#define IDS_OF(mon) ((const void *) ((char *) (mon) + map->offset))
 
 /* Initialize a MonitorMap. Returns nonzero if successful, zero on failure.
  *
  * Parameters:
  * map - Pointer to the MonitorMap to initialize
- * offset - Offset of identities array within the monitor struct
+ * offset - Offset of the identity tuple within the monitor struct
  * hash - Pointer to the hash function to use
  * equals - Pointer to the equality function to use */
 int monitormap_init(MonitorMap *map, size_t offset,
-                    uint64_t(*hash)(SMEDLValue *ids),
-                    int (*equals)(SMEDLValue *ids1, SMEDLValue *ids2)) {
+                    uint64_t(*hash)(const void *ids),
+                    int (*equals)(const void *ids1, const void *ids2)) {
     map->capacity = MIN_CAPACITY;
     map->mask = map->capacity - 1;
     map->count = 0;
@@ -144,7 +152,13 @@ int monitormap_init(MonitorMap *map, size_t offset,
     map->offset = offset;
     map->hash = hash;
     map->equals = equals;
-    map->table = calloc(map->capacity, sizeof(MonitorList));
+    map->grows = 0;
+    map->shrinks = 0;
+    map->resize_ns = 0;
+    map->max_resize_ns = 0;
+    map->table = SMEDL_CALLOC(MAP_ACCOUNT(map), SMEDL_MEM_MAP_TABLE,
+            map->capacity, sizeof(MonitorList));
+    return map->table != NULL;
 }
 
 /* Grow or shrink the monitor map to the new capacity. Return nonzero if
@@ -155,7 +169,10 @@ int monitormap_init(MonitorMap *map, size_t offset,
  * capacity - New capacity. Must be a power of two!
  */
 static int monitormap_resize(MonitorMap *map, size_t capacity) {
-    MonitorList *new_table = calloc(capacity, sizeof(MonitorList));
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    MonitorList *new_table = SMEDL_CALLOC(MAP_ACCOUNT(map), SMEDL_MEM_MAP_TABLE,
+            capacity, sizeof(MonitorList));
     if (new_table == NULL) {
         return 0;
     }
@@ -183,27 +200,52 @@ static int monitormap_resize(MonitorMap *map, size_t capacity) {
             map->table[i].dib++;
         }
     }
-    free(map->table);
+    SMEDL_FREE(MAP_ACCOUNT(map), SMEDL_MEM_MAP_TABLE, map->table);
     map->table = new_table;
+    if (capacity > map->capacity) {
+        map->grows++;
+    } else {
+        map->shrinks++;
+    }
     map->capacity = capacity;
     map->mask = mask;
     map->grow_at = map->capacity * GROW_THRESHOLD;
     map->shrink_at = map->capacity * SHRINK_THRESHOLD;
+
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    uint64_t ns = (end.tv_sec - start.tv_sec) * 1000000000LL +
+        (end.tv_nsec - start.tv_nsec);
+    map->resize_ns += ns;
+    if (ns > map->max_resize_ns) {
+        map->max_resize_ns = ns;
+    }
     return 1;
 }
 
-/* Insert a monitor into a MonitorMap. Returns a pointer to the MonitorInstance
- * if successful, or NULL on failure.
+/* Grow the monitor map so that count more MonitorLists can be inserted without
+ * resizing it. Returns nonzero if successful, zero on failure.
  *
  * Parameters:
- * map - The MonitorMap to insert into
- * mon - Pointer to the <monitor>Mon to be inserted
- * next_inst - Pointer to this monitor's instance in another MonitorMap, or
- *   NULL. (To improve removal efficiency.)
- * next_map - Pointer to the map containing next_inst */
-MonitorInstance * monitormap_insert(MonitorMap *map, void *mon,
-                                    MonitorInstance *next_inst,
-                                    MonitorMap *next_map) {
+ * map - Pointer to the MonitorMap to grow
+ * count - Number of MonitorLists to make room for */
+int monitormap_reserve(MonitorMap *map, size_t count) {
+    size_t capacity = map->capacity;
+    while (map->count + count >= (size_t) (capacity * GROW_THRESHOLD)) {
+        capacity *= 2;
+    }
+    if (capacity == map->capacity) {
+        return 1;
+    }
+    return monitormap_resize(map, capacity);
+}
+
+/* monitormap_insert() with the map's hash and equality functions passed in, so
+ * that they are called directly where they are known (see MONITORMAP_INSERT()
+ * in monitor_map.h) */
+static inline MonitorInstance * monitormap_insert_with(MonitorMap *map,
+        void *mon, MonitorInstance *next_inst, MonitorMap *next_map,
+        uint64_t (*hash)(const void *ids),
+        int (*equals)(const void *ids1, const void *ids2)) {
     if (map->count == map->grow_at) {
         if (!monitormap_resize(map, map->capacity * 2)) {
             return NULL;
@@ -211,7 +253,8 @@ MonitorInstance * monitormap_insert(MonitorMap *map, void *mon,
     }
 
     MonitorList entry;
-    entry.head = malloc(sizeof(MonitorInstance));
+    entry.head = SMEDL_ALLOC_OBJECT(MAP_ACCOUNT(map), SMEDL_MEM_MAP_INSTANCE,
+            sizeof(MonitorInstance));
     if (entry.head == NULL) {
         return NULL;
     }
@@ -220,7 +263,7 @@ MonitorInstance * monitormap_insert(MonitorMap *map, void *mon,
     entry.head->prev = NULL;
     entry.head->next_inst = next_inst;
     entry.head->next_map = next_map;
-    entry.hash = map->hash(IDS_OF(mon));
+    entry.hash = hash(IDS_OF(mon));
     entry.dib = 1;
     size_t i = entry.hash & map->mask;
     MonitorInstance *retval = entry.head;
@@ -231,7 +274,7 @@ MonitorInstance * monitormap_insert(MonitorMap *map, void *mon,
             map->count++;
             return retval;
         } else if (map->table[i].hash == entry.hash &&
-                map->equals(IDS_OF(mon), IDS_OF(map->table[i].head->mon))) {
+                equals(IDS_OF(mon), IDS_OF(map->table[i].head->mon))) {
             entry.head->next = map->table[i].head;
             map->table[i].head->prev = entry.head;
             map->table[i].head = entry.head;
@@ -248,22 +291,41 @@ MonitorInstance * monitormap_insert(MonitorMap *map, void *mon,
     }
 }
 
+/* Insert a monitor into a MonitorMap. Returns a pointer to the MonitorInstance
+ * if successful, or NULL on failure.
+ *
+ * Parameters:
+ * map - The MonitorMap to insert into
+ * mon - Pointer to the <monitor>Mon to be inserted
+ * next_inst - Pointer to this monitor's instance in another MonitorMap, or
+ *   NULL. (To improve removal efficiency.)
+ * next_map - Pointer to the map containing next_inst */
+MonitorInstance * monitormap_insert(MonitorMap *map, void *mon,
+                                    MonitorInstance *next_inst,
+                                    MonitorMap *next_map) {
+    return monitormap_insert_with(map, mon, next_inst, next_map, map->hash,
+            map->equals);
+}
+
 /* Find the index in the hash table for a particular set of monitor identities.
  * If not found, return ((size_t) -1).
  *
  * Parameters:
  * map - Pointer to the MonitorMap to look up in
- * ids - Array of SMEDLValues containing the identities to look up */
-static size_t monitormap_lookup_index(MonitorMap *map, SMEDLValue *ids) {
-    uint64_t hash = map->hash(ids);
-    size_t i = hash & map->mask;
+ * ids - Pointer to an identity tuple containing the identities to look up
+ * hash, equals - The map's hash and equality functions */
+static inline size_t monitormap_lookup_index_with(MonitorMap *map,
+        const void *ids, uint64_t (*hash)(const void *ids),
+        int (*equals)(const void *ids1, const void *ids2)) {
+    uint64_t h = hash(ids);
+    size_t i = h & map->mask;
 
     while (1) {
         if (map->table[i].dib == 0) {
             return ((size_t) -1);
         }
-        if (map->table[i].hash == hash &&
-                map->equals(ids, IDS_OF(map->table[i].head->mon))) {
+        if (map->table[i].hash == h &&
+                equals(ids, IDS_OF(map->table[i].head->mon))) {
             return i;
         }
         i++;
@@ -271,14 +333,16 @@ static size_t monitormap_lookup_index(MonitorMap *map, SMEDLValue *ids) {
     }
 }
 
-/* Fetch a list of monitors matching the identities given. If there are none,
- * return NULL.
- *
- * Parameters:
- * map - Pointer to the MonitorMap to look up in
- * ids - Array of SMEDLValues containing the identities to look up */
-MonitorInstance * monitormap_lookup(MonitorMap *map, SMEDLValue *ids) {
-    size_t i = monitormap_lookup_index(map, ids);
+static size_t monitormap_lookup_index(MonitorMap *map, const void *ids) {
+    return monitormap_lookup_index_with(map, ids, map->hash, map->equals);
+}
+
+/* monitormap_lookup() with the map's hash and equality functions passed in
+ * (see MONITORMAP_LOOKUP() in monitor_map.h) */
+static inline MonitorInstance * monitormap_lookup_with(MonitorMap *map,
+        const void *ids, uint64_t (*hash)(const void *ids),
+        int (*equals)(const void *ids1, const void *ids2)) {
+    size_t i = monitormap_lookup_index_with(map, ids, hash, equals);
     if (i == (size_t) -1) {
         return NULL;
     } else {
@@ -286,6 +350,16 @@ MonitorInstance * monitormap_lookup(MonitorMap *map, SMEDLValue *ids) {
     }
 }
 
+/* Fetch a list of monitors matching the identities given. If there are none,
+ * return NULL.
+ *
+ * Parameters:
+ * map - Pointer to the MonitorMap to look up in
+ * ids - Pointer to an identity tuple containing the identities to look up */
+MonitorInstance * monitormap_lookup(MonitorMap *map, const void *ids) {
+    return monitormap_lookup_with(map, ids, map->hash, map->equals);
+}
+
 /* Remove a MonitorInstance from the MonitorList in bucket i. Remove it from
  * the next MonitorMap as well, if there is one. Then free the MonitorInstance.
  *
@@ -308,7 +382,7 @@ static void monitormap_remove_from_list(MonitorMap *map, MonitorInstance *inst,
     if (inst->next_map != NULL) {
         monitormap_removeinst(inst->next_map, inst->next_inst);
     }
-    free(inst);
+    SMEDL_FREE_OBJECT(MAP_ACCOUNT(map), SMEDL_MEM_MAP_INSTANCE, inst);
 }
 
 /* Remove the MonitorList in bucket i from the map.
@@ -327,6 +401,7 @@ static void monitormap_remove_list(MonitorMap *map, size_t i) {
             break;
         }
         map->table[prev_i] = map->table[i];
+        map->table[prev_i].dib--;
     }
     map->count--;
     if (map->capacity > MIN_CAPACITY && map->count <= map->shrink_at) {
@@ -393,7 +468,7 @@ MonitorInstance * monitormap_free(MonitorMap *map, int free_contents) {
                 MonitorInstance *inst = map->table[i].head;
                 while (inst != NULL) {
                     if (inst->next_map != NULL) {
-                        monitormap_removeinst(inst->next_map, inst);
+                        monitormap_removeinst(inst->next_map, inst->next_inst);
                     }
                     MonitorInstance *tmp = inst->next;
                     inst->next = result;
@@ -403,6 +478,47 @@ MonitorInstance * monitormap_free(MonitorMap *map, int free_contents) {
             }
         }
     }
-    free(map->table);
+    SMEDL_FREE(MAP_ACCOUNT(map), SMEDL_MEM_MAP_TABLE, map->table);
     return result;
 }
+
+/* Fill in the health of a MonitorMap. This walks the whole table and every
+ * list, so it takes time proportional to the capacity and number of
+ * instances.
+ *
+ * Parameters:
+ * map - The MonitorMap to examine
+ * stats - Pointer to the MonitorMapStats to fill in */
+void monitormap_stats(MonitorMap *map, MonitorMapStats *stats) {
+    uint64_t dib_sum = 0;
+
+    stats->capacity = map->capacity;
+    stats->lists = 0;
+    stats->instances = 0;
+    stats->max_list = 0;
+    stats->max_dib = 0;
+    for (size_t i = 0; i < map->capacity; i++) {
+        if (map->table[i].dib == 0) {
+            continue;
+        }
+        stats->lists++;
+        dib_sum += map->table[i].dib;
+        if (map->table[i].dib > stats->max_dib) {
+            stats->max_dib = map->table[i].dib;
+        }
+        size_t len = 0;
+        for (MonitorInstance *inst = map->table[i].head; inst != NULL;
+                inst = inst->next) {
+            len++;
+        }
+        stats->instances += len;
+        if (len > stats->max_list) {
+            stats->max_list = len;
+        }
+    }
+    stats->mean_dib = stats->lists > 0 ? (double) dib_sum / stats->lists : 0;
+    stats->grows = map->grows;
+    stats->shrinks = map->shrinks;
+    stats->resize_ns = map->resize_ns;
+    stats->max_resize_ns = map->max_resize_ns;
+}
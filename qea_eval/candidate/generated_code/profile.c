@@ -0,0 +1,392 @@
+/* For syscall() */
+#define _GNU_SOURCE
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#include "profile.h"
+
+/* Counters that may be opened, and the one opened instead if none of them
+ * can be */
+static const struct {
+    const char *name;
+    uint32_t type;
+    uint64_t config;
+} counter_events[] = {
+    {"cycles", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+    {"instructions", PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+    {"l1d_misses", PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_L1D |
+        (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+        (PERF_COUNT_HW_CACHE_RESULT_MISS << 16)},
+    {"llc_misses", PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_LL |
+        (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+        (PERF_COUNT_HW_CACHE_RESULT_MISS << 16)},
+    {"branch_misses", PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES},
+    {"task_clock_ns", PERF_TYPE_SOFTWARE, PERF_COUNT_SW_TASK_CLOCK},
+};
+#define HARDWARE_EVENTS 5
+#define MAX_COUNTERS HARDWARE_EVENTS
+
+typedef struct {
+    int fd;
+    /* The counter's mmap page, if it can be read with rdpmc, else NULL */
+    struct perf_event_mmap_page *page;
+    const char *name;
+    /* Value at the last stage change */
+    uint64_t last;
+} Counter;
+
+typedef struct {
+    uint64_t calls;
+    uint64_t counts[MAX_COUNTERS];
+} Total;
+
+typedef struct {
+    SMEDLProfileStage stage;
+    int channel;
+    uint64_t counts[MAX_COUNTERS];
+} Frame;
+
+static const char *const profile_stage_names[SMEDL_PROFILE_STAGES] = {
+    [SMEDL_PROFILE_STAGE_PARSE] = "parse",
+    [SMEDL_PROFILE_STAGE_ROUTE] = "route",
+    [SMEDL_PROFILE_STAGE_LOOKUP] = "lookup",
+    [SMEDL_PROFILE_STAGE_EXECUTE] = "execute",
+    [SMEDL_PROFILE_STAGE_OUTPUT] = "output",
+    [SMEDL_PROFILE_STAGE_OTHER] = "other",
+};
+
+static Counter counters[MAX_COUNTERS];
+static size_t counter_count;
+/* Names of the hardware counters that could not be opened */
+static const char *unavailable[HARDWARE_EVENTS];
+static size_t unavailable_count;
+
+static const char *profile_channel_names[SMEDL_PROFILE_MAX_CHANNELS];
+static size_t channel_count;
+
+/* Totals indexed by channel + 1 (so SMEDL_PROFILE_NONE is 0) and stage */
+static Total totals[SMEDL_PROFILE_MAX_CHANNELS + 1][SMEDL_PROFILE_STAGES];
+
+/* Stages entered and not yet left. The bottom one is other work for no
+ * channel and is never left. Stages entered past the deepest are not pushed,
+ * only counted in overflow so leaving them is ignored too. */
+static Frame stack[SMEDL_PROFILE_MAX_DEPTH];
+static int depth;
+static size_t overflow;
+
+/* Nonzero once smedl_profile_init() succeeded */
+static int profiling;
+
+#if defined(__x86_64__) || defined(__i386__)
+static inline uint64_t rdpmc(uint32_t counter) {
+    uint32_t low, high;
+    __asm__ volatile("rdpmc" : "=a" (low), "=d" (high) : "c" (counter));
+    return low | (uint64_t) high << 32;
+}
+#endif
+
+/* Read a counter's current value */
+static uint64_t read_counter(Counter *c) {
+#if defined(__x86_64__) || defined(__i386__)
+    if (c->page != NULL) {
+        /* See the comment on struct perf_event_mmap_page in
+         * linux/perf_event.h */
+        volatile struct perf_event_mmap_page *pc = c->page;
+        uint32_t seq;
+        uint64_t count;
+        do {
+            seq = pc->lock;
+            __asm__ volatile("" ::: "memory");
+            uint32_t index = pc->index;
+            count = pc->offset;
+            if (pc->cap_user_rdpmc && index != 0) {
+                unsigned width = pc->pmc_width;
+                uint64_t pmc = rdpmc(index - 1);
+                count += (uint64_t) ((int64_t) (pmc << (64 - width)) >>
+                        (64 - width));
+            }
+            __asm__ volatile("" ::: "memory");
+        } while (pc->lock != seq);
+        return count;
+    }
+#endif
+    uint64_t values[3];
+    if (read(c->fd, values, sizeof(values)) != sizeof(values)) {
+        return c->last;
+    }
+    return values[0];
+}
+
+/* Add the counts since the last stage change to the current stage */
+static void charge(void) {
+    Frame *f = &stack[depth];
+    for (size_t i = 0; i < counter_count; i++) {
+        uint64_t now = read_counter(&counters[i]);
+        f->counts[i] += now - counters[i].last;
+        counters[i].last = now;
+    }
+}
+
+/* Add a stage that was left to the totals */
+static void retire(const Frame *f) {
+    Total *t = &totals[f->channel + 1][f->stage];
+    t->calls++;
+    for (size_t i = 0; i < counter_count; i++) {
+        t->counts[i] += f->counts[i];
+    }
+}
+
+/* Return the number of the channel with the given name, adding it if it is
+ * new, or SMEDL_PROFILE_NONE if there is no room */
+static int find_channel(const char *name) {
+    for (size_t i = 0; i < channel_count; i++) {
+        if (!strcmp(profile_channel_names[i], name)) {
+            return i;
+        }
+    }
+    if (channel_count == SMEDL_PROFILE_MAX_CHANNELS) {
+        return SMEDL_PROFILE_NONE;
+    }
+    profile_channel_names[channel_count] = name;
+    return channel_count++;
+}
+
+/* Open a counter for this thread. Return its fd, or -1 on failure. */
+static int open_counter(uint32_t type, uint64_t config) {
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = type;
+    attr.config = config;
+    attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED |
+        PERF_FORMAT_TOTAL_TIME_RUNNING;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    return syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+}
+
+/* Map a counter's page so it can be read with rdpmc. Leaves page NULL if it
+ * cannot be. */
+static void map_counter(Counter *c) {
+#if defined(__x86_64__) || defined(__i386__)
+    long size = sysconf(_SC_PAGESIZE);
+    void *page = mmap(NULL, size, PROT_READ, MAP_SHARED, c->fd, 0);
+    if (page == MAP_FAILED) {
+        return;
+    }
+    if (((struct perf_event_mmap_page *) page)->cap_user_rdpmc) {
+        c->page = page;
+    } else {
+        munmap(page, size);
+    }
+#else
+    (void) c;
+#endif
+}
+
+static void profile_at_exit(void) {
+    /* Leave every stage, down to the bottom one */
+    charge();
+    while (depth > 0) {
+        retire(&stack[depth--]);
+    }
+    retire(&stack[0]);
+    memset(stack[0].counts, 0, sizeof(stack[0].counts));
+    profiling = 0;
+
+    smedl_profile_dump(stderr);
+    for (size_t i = 0; i < counter_count; i++) {
+        if (counters[i].page != NULL) {
+            munmap(counters[i].page, sysconf(_SC_PAGESIZE));
+        }
+        close(counters[i].fd);
+    }
+}
+
+int smedl_profile_init(const char *const *channels, size_t count) {
+    for (size_t i = 0; i < count && i < SMEDL_PROFILE_MAX_CHANNELS; i++) {
+        profile_channel_names[i] = channels[i];
+    }
+    channel_count = count < SMEDL_PROFILE_MAX_CHANNELS ? count :
+        SMEDL_PROFILE_MAX_CHANNELS;
+
+    for (size_t i = 0; i < HARDWARE_EVENTS; i++) {
+        int fd = open_counter(counter_events[i].type,
+                counter_events[i].config);
+        if (fd < 0) {
+            unavailable[unavailable_count++] = counter_events[i].name;
+            continue;
+        }
+        counters[counter_count].fd = fd;
+        counters[counter_count].name = counter_events[i].name;
+        map_counter(&counters[counter_count]);
+        counter_count++;
+    }
+    if (counter_count == 0) {
+        int fd = open_counter(counter_events[HARDWARE_EVENTS].type,
+                counter_events[HARDWARE_EVENTS].config);
+        if (fd < 0) {
+            return 0;
+        }
+        counters[0].fd = fd;
+        counters[0].name = counter_events[HARDWARE_EVENTS].name;
+        counter_count = 1;
+    }
+
+    if (atexit(profile_at_exit)) {
+        for (size_t i = 0; i < counter_count; i++) {
+            if (counters[i].page != NULL) {
+                munmap(counters[i].page, sysconf(_SC_PAGESIZE));
+            }
+            close(counters[i].fd);
+        }
+        counter_count = 0;
+        return 0;
+    }
+
+    stack[0].stage = SMEDL_PROFILE_STAGE_OTHER;
+    stack[0].channel = SMEDL_PROFILE_NONE;
+    for (size_t i = 0; i < counter_count; i++) {
+        counters[i].last = read_counter(&counters[i]);
+    }
+    profiling = 1;
+    return 1;
+}
+
+void smedl_profile_push(SMEDLProfileStage stage, int channel) {
+    if (!profiling) {
+        return;
+    }
+    if (depth + 1 == SMEDL_PROFILE_MAX_DEPTH) {
+        overflow++;
+        return;
+    }
+    charge();
+    Frame *f = &stack[++depth];
+    f->stage = stage;
+    f->channel = channel == SMEDL_PROFILE_INHERIT ? stack[depth - 1].channel :
+        channel;
+    memset(f->counts, 0, sizeof(f->counts));
+}
+
+void smedl_profile_pop(void) {
+    if (!profiling) {
+        return;
+    }
+    if (overflow > 0) {
+        overflow--;
+        return;
+    }
+    if (depth == 0) {
+        return;
+    }
+    charge();
+    retire(&stack[depth--]);
+}
+
+void smedl_profile_route(int *channel, const char *name) {
+    if (!profiling) {
+        return;
+    }
+    if (*channel < SMEDL_PROFILE_NONE) {
+        *channel = find_channel(name);
+    }
+    smedl_profile_push(SMEDL_PROFILE_STAGE_ROUTE, *channel);
+}
+
+void smedl_profile_start(void) {
+    if (!profiling) {
+        return;
+    }
+    if (overflow == 0 && stack[depth].stage == SMEDL_PROFILE_STAGE_PARSE) {
+        smedl_profile_pop();
+    }
+    smedl_profile_push(SMEDL_PROFILE_STAGE_PARSE, SMEDL_PROFILE_NONE);
+}
+
+void smedl_profile_parsed(int channel) {
+    if (!profiling) {
+        return;
+    }
+    if (overflow == 0 && stack[depth].stage == SMEDL_PROFILE_STAGE_PARSE) {
+        stack[depth].channel = channel;
+        smedl_profile_pop();
+    }
+}
+
+/* Print the counts of a total as members of a JSON object */
+static void dump_total(FILE *f, const Total *t) {
+    fprintf(f, "{\"calls\": %llu", (unsigned long long) t->calls);
+    for (size_t i = 0; i < counter_count; i++) {
+        fprintf(f, ", \"%s\": %llu", counters[i].name,
+                (unsigned long long) t->counts[i]);
+    }
+    fprintf(f, "}");
+}
+
+void smedl_profile_dump(FILE *f) {
+    if (counter_count == 0) {
+        return;
+    }
+    fprintf(f, "{\"profile\": {\"counters\": {");
+    for (size_t i = 0; i < counter_count; i++) {
+        uint64_t values[3];
+        double running = 0;
+        if (read(counters[i].fd, values, sizeof(values)) == sizeof(values) &&
+                values[1] > 0) {
+            running = (double) values[2] / values[1];
+        }
+        fprintf(f, "%s\"%s\": {\"running\": %.2f}", i > 0 ? ", " : "",
+                counters[i].name, running);
+    }
+    fprintf(f, "}, \"unavailable\": [");
+    for (size_t i = 0; i < unavailable_count; i++) {
+        fprintf(f, "%s\"%s\"", i > 0 ? ", " : "", unavailable[i]);
+    }
+
+    /* Channels in order, with "none" last */
+    fprintf(f, "], \"channels\": {");
+    int first_channel = 1;
+    for (size_t n = 1; n <= channel_count + 1; n++) {
+        size_t i = n % (channel_count + 1);
+        int first_stage = 1;
+        for (int s = 0; s < SMEDL_PROFILE_STAGES; s++) {
+            if (totals[i][s].calls == 0) {
+                continue;
+            }
+            if (first_stage) {
+                fprintf(f, "%s\"%s\": {", first_channel ? "" : ", ",
+                        i == 0 ? "none" : profile_channel_names[i - 1]);
+                first_channel = 0;
+                first_stage = 0;
+            } else {
+                fprintf(f, ", ");
+            }
+            fprintf(f, "\"%s\": ", profile_stage_names[s]);
+            dump_total(f, &totals[i][s]);
+        }
+        if (!first_stage) {
+            fprintf(f, "}");
+        }
+    }
+
+    fprintf(f, "}, \"stages\": {");
+    for (int s = 0; s < SMEDL_PROFILE_STAGES; s++) {
+        Total sum;
+        memset(&sum, 0, sizeof(sum));
+        for (size_t i = 0; i <= channel_count; i++) {
+            sum.calls += totals[i][s].calls;
+            for (size_t c = 0; c < counter_count; c++) {
+                sum.counts[c] += totals[i][s].counts[c];
+            }
+        }
+        fprintf(f, "%s\"%s\": ", s > 0 ? ", " : "", profile_stage_names[s]);
+        dump_total(f, &sum);
+    }
+    fprintf(f, "}}}\n");
+    fflush(f);
+}
@@ -7,6 +7,7 @@
 #include <string.h>
 #include <pthread.h>
 #include "smedl_types.h"
+#include "memstats.h"
 
 /* Compare two opaque values for equality only. Return nonzero if equal, zero
  * if not */
@@ -285,6 +286,70 @@ void smedl_free_array_contents(SMEDLValue *array, size_t len) {
     }
 }
 
+/*
+ * Pack copies of the given identities and params into a new SMEDLEvent with
+ * one reference, owned by the caller.
+ *
+ * Return the event, or NULL if it could not be made.
+ */
+SMEDLEvent * smedl_event_new(SMEDLValue *ids, size_t ids_len,
+        SMEDLValue *params, size_t params_len) {
+    size_t len = ids_len + params_len;
+
+    /* Size the string and opaque data so everything fits in one block */
+    size_t size = sizeof(SMEDLEvent) + sizeof(SMEDLValue) * len;
+    for (size_t i = 0; i < len; i++) {
+        SMEDLValue *val = i < ids_len ? &ids[i] : &params[i - ids_len];
+        if (val->t == SMEDL_STRING) {
+            size += strlen(val->v.s) + 1;
+        } else if (val->t == SMEDL_OPAQUE) {
+            size += val->v.o.size;
+        }
+    }
+
+    SMEDLEvent *ev = SMEDL_MALLOC(&smedl_mem_shared, SMEDL_MEM_EVENT, size);
+    if (ev == NULL) {
+        return NULL;
+    }
+    ev->refs = 1;
+    ev->ids = ids_len > 0 ? ev->values : NULL;
+    ev->params = ev->values + ids_len;
+
+    char *data = (char *) (ev->values + len);
+    for (size_t i = 0; i < len; i++) {
+        SMEDLValue *val = i < ids_len ? &ids[i] : &params[i - ids_len];
+        ev->values[i] = *val;
+        if (val->t == SMEDL_STRING) {
+            size_t str_size = strlen(val->v.s) + 1;
+            memcpy(data, val->v.s, str_size);
+            ev->values[i].v.s = data;
+            data += str_size;
+        } else if (val->t == SMEDL_OPAQUE) {
+            memcpy(data, val->v.o.data, val->v.o.size);
+            ev->values[i].v.o.data = data;
+            data += val->v.o.size;
+        }
+    }
+    return ev;
+}
+
+/*
+ * Take another reference to the event.
+ */
+void smedl_event_retain(SMEDLEvent *ev) {
+    ev->refs++;
+}
+
+/*
+ * Drop a reference to the event. The event is freed when the last reference is
+ * dropped.
+ */
+void smedl_event_release(SMEDLEvent *ev) {
+    if (--ev->refs == 0) {
+        SMEDL_FREE(&smedl_mem_shared, SMEDL_MEM_EVENT, ev);
+    }
+}
+
 /*
  * Convert a pointer to string representation. Return nonzero on success, zero
  * on failure.
@@ -0,0 +1,258 @@
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include "memstats.h"
+
+/* Checkpoints of the whole monitoring state.
+ *
+ * A snapshot holds every live monitor of every monitor type (identities,
+ * scenario states and state variables), the population counters of each type,
+ * and the position in the input: the offset of the next message and the
+ * number of messages before it. Event queues are not saved, so snapshots are
+ * only taken between batches, when the queues are empty. Neither are callback
+ * tables registered for individual monitors; restored monitors use the shared
+ * ones.
+ *
+ * The file is a header followed by one section per monitor type. A section is
+ * a section header, a fixed-size record for each monitor, and the strings the
+ * records refer to. Records are packed in native byte order, so a snapshot is
+ * only meant to be restored by the same build on the same machine: ints as 32
+ * bits, floats as doubles, pointers as 64 bits, strings as 64-bit offsets into
+ * the section's strings, and scenario states as one byte. Sections start on
+ * 8-byte boundaries.
+ *
+ * Snapshots are restored from a read-only mapping of the file, in time
+ * proportional to its size. The monitor structs and monitor map nodes of the
+ * restored monitors are carved out of a single allocation, the restore block,
+ * and each section's strings are copied into it at once and used in place as
+ * the monitors' identities. So restoring makes no allocation per monitor
+ * (monitor map tables and columnar stores still grow as usual). Memory in the
+ * restore block is not reused when restored monitors are freed; it is freed as
+ * a whole with smedl_restore_free().
+ *
+ * To restore:
+ * 1. smedl_snapshot_open()
+ * 2. reserve_<syncset>_syncset() for each synchronous set, which calls
+ *    smedl_restore_reserve() for each monitor type
+ * 3. smedl_restore_begin()
+ * 4. restore_<syncset>_syncset() for each synchronous set
+ * 5. smedl_restore_end() and smedl_snapshot_close()
+ */
+
+/* Where the file adapter writes its snapshots when built with
+ * SMEDL_SNAPSHOT_INTERVAL */
+#ifndef SMEDL_SNAPSHOT_FILE
+#define SMEDL_SNAPSHOT_FILE "smedl.snapshot"
+#endif
+
+#define SMEDL_SNAPSHOT_MAGIC "SMEDLSNP"
+#define SMEDL_SNAPSHOT_VERSION 1
+
+/* Bytes taken by each kind of field in a record */
+#define SMEDL_SNAPSHOT_INT 4
+#define SMEDL_SNAPSHOT_FLOAT 8
+#define SMEDL_SNAPSHOT_POINTER 8
+#define SMEDL_SNAPSHOT_STRING 8
+#define SMEDL_SNAPSHOT_STATE 1
+
+typedef struct SMEDLSnapshotHeader {
+    char magic[8];          /* SMEDL_SNAPSHOT_MAGIC, not NUL-terminated */
+    uint32_t version;       /* SMEDL_SNAPSHOT_VERSION */
+    uint32_t sections;      /* Sections that follow */
+    uint64_t size;          /* Size of the file, to detect truncation */
+    uint64_t offset;        /* Input offset of the next message */
+    uint64_t msg_count;     /* Messages before it */
+} SMEDLSnapshotHeader;
+
+typedef struct SMEDLSnapshotSection {
+    char name[56];          /* Monitor type, NUL-terminated */
+    uint64_t count;         /* Records */
+    uint64_t record_size;   /* Bytes per record */
+    uint64_t strings_size;  /* Bytes of strings after the records */
+    uint64_t dynamic;       /* Population counters (see MonitorStats) */
+    uint64_t created;
+    uint64_t recycled;
+} SMEDLSnapshotSection;
+
+/* Writing */
+
+/* Snapshot being written. Initialize with smedl_snapshot_create(). */
+typedef struct SMEDLSnapshotWriter {
+    FILE *f;
+    SMEDLSnapshotHeader header;
+    SMEDLSnapshotSection section;   /* Current section */
+    long section_pos;               /* File position of its header */
+    uint64_t record_bytes;          /* Record bytes written in it */
+    char *strings;                  /* Its strings */
+    size_t strings_len, strings_size;
+    int error;
+} SMEDLSnapshotWriter;
+
+/* Create the snapshot file at path for the given input position. Return
+ * nonzero on success, zero on failure. Finish with smedl_snapshot_finish(),
+ * even on failure. */
+int smedl_snapshot_create(SMEDLSnapshotWriter *w, const char *path,
+        uint64_t offset, uint64_t msg_count);
+
+/* Start the section for a monitor type with count monitors */
+void smedl_snapshot_begin(SMEDLSnapshotWriter *w, const char *name,
+        size_t record_size, uint64_t count, uint64_t dynamic,
+        uint64_t created, uint64_t recycled);
+
+/* Append a field to the current record. Records are the fields of each
+ * monitor in order, so the fields must be put in the same order the local
+ * wrapper and monitor get them back in. */
+void smedl_snapshot_put_int(SMEDLSnapshotWriter *w, int value);
+void smedl_snapshot_put_float(SMEDLSnapshotWriter *w, double value);
+void smedl_snapshot_put_pointer(SMEDLSnapshotWriter *w, void *value);
+void smedl_snapshot_put_string(SMEDLSnapshotWriter *w, const char *value);
+void smedl_snapshot_put_state(SMEDLSnapshotWriter *w, unsigned int value);
+
+/* End the current section. Return nonzero on success, zero if anything has
+ * failed so far (including a section with the wrong number of records). */
+int smedl_snapshot_end(SMEDLSnapshotWriter *w);
+
+/* Complete the file, sync it to disk and close it. Return nonzero if the
+ * whole snapshot was written, zero on failure. */
+int smedl_snapshot_finish(SMEDLSnapshotWriter *w);
+
+/* Write a snapshot to path, replacing it only once the new one is complete:
+ * it is written to "<path>.tmp" and renamed. write_monitors writes the
+ * sections, normally by calling snapshot_<syncset>_syncset() for each
+ * synchronous set. Return nonzero on success, zero on failure. */
+int smedl_snapshot_save(const char *path, uint64_t offset, uint64_t msg_count,
+        int (*write_monitors)(SMEDLSnapshotWriter *w));
+
+/* Like smedl_snapshot_save(), but in a child process, which works on a
+ * copy-on-write image of the monitoring state while the caller carries on. If
+ * the previous snapshot is still being written, this one is skipped. Return
+ * nonzero if the child was started or skipped, zero if fork() failed. */
+int smedl_snapshot_fork(const char *path, uint64_t offset, uint64_t msg_count,
+        int (*write_monitors)(SMEDLSnapshotWriter *w));
+
+/* Wait for a snapshot being written by smedl_snapshot_fork() to finish.
+ * Return nonzero if every snapshot written in the background so far
+ * succeeded, zero if any failed. */
+int smedl_snapshot_wait(void);
+
+/* Restoring */
+
+/* Snapshot being restored. Initialize with smedl_snapshot_open(). */
+typedef struct SMEDLSnapshot {
+    const unsigned char *data;  /* The mapped file */
+    size_t size;
+    uint64_t offset;            /* Input offset of the next message */
+    uint64_t msg_count;         /* Messages before it */
+    /* Current section */
+    const unsigned char *pos;   /* Next field */
+    const unsigned char *end;   /* End of its records */
+    const char *strings;        /* Its strings, in the restore block */
+    uint64_t strings_size;
+    int error;                  /* A field was out of bounds */
+} SMEDLSnapshot;
+
+/* Map the snapshot at path and check its header and sections. Return nonzero
+ * on success, zero on failure. Cleanup with smedl_snapshot_close(). */
+int smedl_snapshot_open(SMEDLSnapshot *s, const char *path);
+
+/* Unmap the snapshot */
+void smedl_snapshot_close(SMEDLSnapshot *s);
+
+/* Reserve room in the restore block for a monitor type: monitor_size bytes for
+ * each monitor struct and a monitor map node for each of its maps, plus its
+ * strings. Use a monitor_size of zero for singletons, which are restored into
+ * the existing monitor. Return nonzero on success, zero if the snapshot has no
+ * section for the monitor type or its records are not record_size bytes. */
+int smedl_restore_reserve(SMEDLSnapshot *s, const char *name,
+        size_t record_size, size_t monitor_size, size_t maps);
+
+/* Allocate the restore block with the room reserved and start allocating
+ * monitor structs and monitor map nodes from it. Return nonzero on success,
+ * zero on malloc failure. */
+int smedl_restore_begin(void);
+
+/* Go to the section for a monitor type and copy its strings into the restore
+ * block. Return the section header, or NULL if there is no such section or its
+ * records are not record_size bytes. */
+const SMEDLSnapshotSection * smedl_snapshot_section(SMEDLSnapshot *s,
+        const char *name, size_t record_size);
+
+/* Get the next field of the current record. Strings point into the restore
+ * block. */
+int smedl_snapshot_get_int(SMEDLSnapshot *s);
+double smedl_snapshot_get_float(SMEDLSnapshot *s);
+void * smedl_snapshot_get_pointer(SMEDLSnapshot *s);
+char * smedl_snapshot_get_string(SMEDLSnapshot *s);
+unsigned int smedl_snapshot_get_state(SMEDLSnapshot *s);
+
+/* Allocate from the restore block. Return NULL if the room reserved is used
+ * up. */
+void * smedl_restore_alloc(size_t size);
+
+/* Go back to allocating monitor structs and monitor map nodes with
+ * SMEDL_MALLOC() */
+void smedl_restore_end(void);
+
+/* Free the restore block. Call only after all restored monitors have been
+ * freed. */
+void smedl_restore_free(void);
+
+/* Nonzero between smedl_restore_begin() and smedl_restore_end() */
+extern int smedl_restoring;
+
+/* Range of the restore block */
+extern uintptr_t smedl_restored_base;
+extern size_t smedl_restored_size;
+
+/* Whether ptr points into the restore block */
+#define SMEDL_RESTORED(ptr) \
+    ((uintptr_t) (ptr) - smedl_restored_base < smedl_restored_size)
+
+/* An arena that monitor structs and monitor map nodes are allocated from in
+ * place of SMEDL_MALLOC(), installed by a program embedding the monitors (see
+ * MonitorArena in smedl.hpp). alloc() returns NULL for a block the arena
+ * cannot hold, which is then allocated with SMEDL_MALLOC() as usual. Blocks in
+ * [base, base + size) are given back with free(). SMEDL_MEMSTATS does not count
+ * blocks in the arena. */
+typedef struct SMEDLArena {
+    uintptr_t base;
+    size_t size;
+    void * (*alloc)(size_t size);
+    void (*free)(void *ptr);
+} SMEDLArena;
+
+/* The arena in use, or NULL. It may only be changed while there are no
+ * monitors, and must not be removed while any of its blocks are in use. */
+extern SMEDLArena *smedl_arena;
+
+/* Whether ptr points into the arena in use */
+#define SMEDL_IN_ARENA(ptr) \
+    (smedl_arena != NULL && \
+     (uintptr_t) (ptr) - smedl_arena->base < smedl_arena->size)
+
+/* Allocate a monitor struct or monitor map node: from the restore block while
+ * restoring, otherwise from the arena if there is one and it can hold the
+ * block, otherwise with SMEDL_MALLOC() */
+#define SMEDL_ALLOC_OBJECT(account, category, size) \
+    (smedl_restoring ? smedl_restore_alloc(size) : \
+        smedl_arena != NULL ? \
+            (smedl_arena->alloc(size) ?: \
+                SMEDL_MALLOC(account, category, size)) : \
+        SMEDL_MALLOC(account, category, size))
+
+/* Free a block allocated with SMEDL_ALLOC_OBJECT(), or an identity string.
+ * Anything in the restore block is left for smedl_restore_free(). */
+#define SMEDL_FREE_OBJECT(account, category, ptr) \
+    do { \
+        void *smedl_ptr_ = (ptr); \
+        if (SMEDL_IN_ARENA(smedl_ptr_)) { \
+            smedl_arena->free(smedl_ptr_); \
+        } else if (!SMEDL_RESTORED(smedl_ptr_)) { \
+            SMEDL_FREE(account, category, smedl_ptr_); \
+        } \
+    } while (0)
+
+#endif /* SNAPSHOT_H */